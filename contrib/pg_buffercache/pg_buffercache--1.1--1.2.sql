@@ -0,0 +1,14 @@
+/* contrib/pg_buffercache/pg_buffercache--1.1--1.2.sql */
+
+-- complain if script is sourced in psql, rather than via ALTER EXTENSION
+\echo Use "ALTER EXTENSION pg_buffercache UPDATE TO '1.2'" to load this file. \quit
+
+CREATE FUNCTION pg_buffercache_pin_stats(
+	OUT pins_held int4,
+	OUT shared_pins int8,
+	OUT refcount_spills int8,
+	OUT refcount_hash_hits int8,
+	OUT clock_sweep_ticks int8)
+RETURNS record
+AS 'MODULE_PATHNAME', 'pg_buffercache_pin_stats'
+LANGUAGE C STRICT VOLATILE;
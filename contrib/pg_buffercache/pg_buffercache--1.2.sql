@@ -1,4 +1,4 @@
-/* contrib/pg_buffercache/pg_buffercache--1.1.sql */
+/* contrib/pg_buffercache/pg_buffercache--1.2.sql */
 
 -- complain if script is sourced in psql, rather than via CREATE EXTENSION
 \echo Use "CREATE EXTENSION pg_buffercache" to load this file. \quit
@@ -16,6 +16,17 @@ CREATE VIEW pg_buffercache AS
 	 relforknumber int2, relblocknumber int8, isdirty bool, usagecount int2,
 	 pinning_backends int4);
 
+-- Statistics about the current backend's buffer pins.
+CREATE FUNCTION pg_buffercache_pin_stats(
+	OUT pins_held int4,
+	OUT shared_pins int8,
+	OUT refcount_spills int8,
+	OUT refcount_hash_hits int8,
+	OUT clock_sweep_ticks int8)
+RETURNS record
+AS 'MODULE_PATHNAME', 'pg_buffercache_pin_stats'
+LANGUAGE C STRICT VOLATILE;
+
 -- Don't want these to be available to public.
 REVOKE ALL ON FUNCTION pg_buffercache_pages() FROM PUBLIC;
 REVOKE ALL ON pg_buffercache FROM PUBLIC;
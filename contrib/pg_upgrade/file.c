@@ -11,6 +11,11 @@
 
 #include "pg_upgrade.h"
 
+#include "access/visibilitymap.h"
+#include "storage/bufpage.h"
+#include "storage/checksum.h"
+#include "storage/checksum_impl.h"
+
 #include <fcntl.h>
 
 
@@ -123,6 +128,126 @@ linkAndUpdateFile(pageCnvCtx *pageConverter,
 }
 
 
+/*
+ * rewriteVisibilityMap()
+ *
+ * Copies a visibility map file from src to dst, converting it from the
+ * format with one all-visible bit per heap page to the one with an
+ * all-visible and an all-frozen bit per heap page.  Each old page becomes
+ * two new pages with the old page's header.  The all-visible bits are kept
+ * and the all-frozen bits are left clear; the next vacuum sets them.
+ */
+const char *
+rewriteVisibilityMap(const char *fromfile, const char *tofile)
+{
+	int			src_fd;
+	int			dst_fd;
+	char		buffer[BLCKSZ];
+	char		new_vmbuf[BLCKSZ];
+	ssize_t		bytesRead;
+	off_t		src_filesize;
+	struct stat statbuf;
+	BlockNumber new_blkno = 0;
+	int			old_bytes_per_page;
+	const char *msg = NULL;
+
+	/* Old-format map bytes that fit on one new-format page */
+	old_bytes_per_page = (BLCKSZ - MAXALIGN(SizeOfPageHeaderData)) / 2;
+
+	if ((src_fd = open(fromfile, O_RDONLY | PG_BINARY, 0)) < 0)
+		return getErrorText(errno);
+
+	if (fstat(src_fd, &statbuf) != 0)
+	{
+		msg = getErrorText(errno);
+		close(src_fd);
+		return msg;
+	}
+	src_filesize = statbuf.st_size;
+
+	if ((dst_fd = open(tofile, O_RDWR | O_CREAT | O_EXCL | PG_BINARY,
+					   S_IRUSR | S_IWUSR)) < 0)
+	{
+		msg = getErrorText(errno);
+		close(src_fd);
+		return msg;
+	}
+
+	while ((bytesRead = read(src_fd, buffer, BLCKSZ)) == BLCKSZ)
+	{
+		char	   *old_cur = buffer + MAXALIGN(SizeOfPageHeaderData);
+		char	   *old_blkend = buffer + BLCKSZ;
+		bool		old_lastblk;
+
+		old_lastblk = (lseek(src_fd, 0, SEEK_CUR) == src_filesize);
+
+		while (old_cur < old_blkend)
+		{
+			char	   *old_break = old_cur + old_bytes_per_page;
+			char	   *new_cur = new_vmbuf + MAXALIGN(SizeOfPageHeaderData);
+			bool		empty = true;
+
+			memset(new_vmbuf, 0, BLCKSZ);
+			memcpy(new_vmbuf, buffer, SizeOfPageHeaderData);
+
+			/* Spread each old byte's eight bits over two new bytes */
+			for (; old_cur < old_break; old_cur++)
+			{
+				uint8		byte = *(uint8 *) old_cur;
+				uint16		new_vmbits = 0;
+				int			i;
+
+				for (i = 0; i < BITS_PER_BYTE; i++)
+				{
+					if (byte & (1 << i))
+					{
+						empty = false;
+						new_vmbits |= VISIBILITYMAP_ALL_VISIBLE << (BITS_PER_HEAPBLOCK * i);
+					}
+				}
+
+				new_cur[0] = (char) (new_vmbits & 0xFF);
+				new_cur[1] = (char) (new_vmbits >> 8);
+				new_cur += 2;
+			}
+
+			/*
+			 * Don't write out an empty second half of the last page, so that
+			 * the one-page maps of small relations stay one page.
+			 */
+			if (old_lastblk && old_cur == old_blkend && empty)
+				break;
+
+			if (new_cluster.controldata.data_checksum_version != 0)
+				((PageHeader) new_vmbuf)->pd_checksum =
+					pg_checksum_page(new_vmbuf, new_blkno);
+
+			errno = 0;
+			if (write(dst_fd, new_vmbuf, BLCKSZ) != BLCKSZ)
+			{
+				/* if write didn't set errno, assume problem is no disk space */
+				msg = getErrorText(errno ? errno : ENOSPC);
+				break;
+			}
+			new_blkno++;
+		}
+
+		if (msg)
+			break;
+	}
+
+	if (msg == NULL && bytesRead < 0)
+		msg = getErrorText(errno);
+	else if (msg == NULL && bytesRead != 0)
+		msg = "found partial page in source file";
+
+	close(src_fd);
+	close(dst_fd);
+
+	return msg;
+}
+
+
 #ifndef WIN32
 static int
 copy_file(const char *srcfile, const char *dstfile, bool force)
@@ -128,6 +128,12 @@ extern char *output_files[];
  */
 #define JSONB_FORMAT_CHANGE_CAT_VER 201409291
 
+/*
+ * Visibility map gained a second, all-frozen, bit per heap page with this
+ * catalog version.
+ */
+#define VISIBILITY_MAP_FROZEN_BIT_CAT_VER 201502041
+
 /*
  * Each relation is represented by a relinfo structure.
  */
@@ -400,6 +406,7 @@ const char *copyAndUpdateFile(pageCnvCtx *pageConverter, const char *src,
 				  const char *dst, bool force);
 const char *linkAndUpdateFile(pageCnvCtx *pageConverter, const char *src,
 				  const char *dst);
+const char *rewriteVisibilityMap(const char *fromfile, const char *tofile);
 
 void		check_hard_link(void);
 FILE	   *fopen_priv(const char *path, const char *mode);
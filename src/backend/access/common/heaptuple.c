@@ -75,6 +75,100 @@
  * ----------------------------------------------------------------
  */
 
+/*
+ * heap_fixed_natts
+ *		Number of leading fixed-width attributes of the tuple descriptor
+ *
+ * The offsets of these attributes within the tuple data don't depend on the
+ * tuple, as long as none of them is null.  On first call for a descriptor we
+ * store the offsets in attcacheoff and remember the count in the descriptor,
+ * so that the deforming loops below can fetch these attributes without any
+ * per-attribute alignment, length or null checks.
+ */
+static inline int
+heap_fixed_natts(TupleDesc tupleDesc)
+{
+	if (tupleDesc->tdnfixedatts < 0)
+	{
+		Form_pg_attribute *att = tupleDesc->attrs;
+		long		off = 0;
+		int			attnum;
+
+		for (attnum = 0; attnum < tupleDesc->natts; attnum++)
+		{
+			Form_pg_attribute thisatt = att[attnum];
+
+			if (thisatt->attlen <= 0)
+				break;
+
+			off = att_align_nominal(off, thisatt->attalign);
+			thisatt->attcacheoff = off;
+			off += thisatt->attlen;
+		}
+
+		tupleDesc->tdnfixedatts = attnum;
+	}
+
+	return tupleDesc->tdnfixedatts;
+}
+
+/*
+ * heap_leading_notnull
+ *		Number of attributes, up to natts, before the first null one
+ *
+ * bp is the tuple's null bitmap.  Whole bytes of the bitmap are checked at
+ * a time where possible.
+ */
+static inline int
+heap_leading_notnull(bits8 *bp, int natts)
+{
+	int			attnum = 0;
+
+	while (attnum + 8 <= natts && bp[attnum >> 3] == 0xFF)
+		attnum += 8;
+	while (attnum < natts && !att_isnull(attnum, bp))
+		attnum++;
+
+	return attnum;
+}
+
+/*
+ * heap_deform_fixed
+ *		Extract the leading fixed-width, non-null attributes of a tuple
+ *
+ * Returns the number of attributes extracted, and sets *offp to the offset
+ * just past the last of them.  The caller continues with the generic loop
+ * from there; since the attributes extracted so far are neither null nor
+ * variable-width, it can go on using attcacheoff.
+ */
+static inline int
+heap_deform_fixed(TupleDesc tupleDesc, char *tp, bits8 *bp, bool hasnulls,
+				  int natts, Datum *values, bool *isnull, long *offp)
+{
+	Form_pg_attribute *att = tupleDesc->attrs;
+	int			nfixed;
+	int			attnum;
+
+	nfixed = Min(heap_fixed_natts(tupleDesc), natts);
+	if (hasnulls)
+		nfixed = heap_leading_notnull(bp, nfixed);
+
+	for (attnum = 0; attnum < nfixed; attnum++)
+	{
+		Form_pg_attribute thisatt = att[attnum];
+
+		values[attnum] = fetchatt(thisatt, tp + thisatt->attcacheoff);
+		isnull[attnum] = false;
+	}
+
+	if (nfixed > 0)
+		*offp = att[nfixed - 1]->attcacheoff + att[nfixed - 1]->attlen;
+	else
+		*offp = 0;
+
+	return nfixed;
+}
+
 
 /*
  * heap_compute_data_size
@@ -929,9 +1023,10 @@ heap_deform_tuple(HeapTuple tuple, TupleDesc tupleDesc,
 
 	tp = (char *) tup + tup->t_hoff;
 
-	off = 0;
+	attnum = heap_deform_fixed(tupleDesc, tp, bp, hasnulls, natts,
+							   values, isnull, &off);
 
-	for (attnum = 0; attnum < natts; attnum++)
+	for (; attnum < natts; attnum++)
 	{
 		Form_pg_attribute thisatt = att[attnum];
 
@@ -1065,10 +1160,13 @@ slot_deform_tuple(TupleTableSlot *slot, int natts)
 	 * loop state.
 	 */
 	attnum = slot->tts_nvalid;
+	tp = (char *) tup + tup->t_hoff;
+
 	if (attnum == 0)
 	{
-		/* Start from the first attribute */
-		off = 0;
+		/* Start from the first attribute, taking the fixed ones in bulk */
+		attnum = heap_deform_fixed(tupleDesc, tp, bp, hasnulls, natts,
+								   values, isnull, &off);
 		slow = false;
 	}
 	else
@@ -1078,8 +1176,6 @@ slot_deform_tuple(TupleTableSlot *slot, int natts)
 		slow = slot->tts_slow;
 	}
 
-	tp = (char *) tup + tup->t_hoff;
-
 	for (; attnum < natts; attnum++)
 	{
 		Form_pg_attribute thisatt = att[attnum];
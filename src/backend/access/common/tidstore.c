@@ -0,0 +1,371 @@
+/*-------------------------------------------------------------------------
+ *
+ * tidstore.c
+ *	  Compact, block-grouped storage for a set of heap TIDs
+ *
+ * A TidStore holds the TIDs VACUUM has found to be dead, and answers the
+ * "is this TID dead?" question asked for every index tuple during index
+ * vacuuming.  TIDs are added a heap block at a time, in block number order.
+ *
+ * Each block gets an 8-byte TidStoreBlock entry.  If the block has one or two
+ * dead offsets, they are stored right in the entry.  Otherwise the offsets go
+ * into a container in the data area, stored either as a sorted array of
+ * OffsetNumbers or as a bitmap with one bit per line pointer, whichever is
+ * smaller.  Compared to a flat array of ItemPointerData, this takes about the
+ * same space when dead tuples are sparse, and a small fraction of it when
+ * they are dense, which is the common case for tables that need vacuuming.
+ * A lookup is a binary search over the blocks followed by a bit test or a
+ * short binary search, rather than a binary search over all the TIDs.
+ *
+ * The store is a single chunk of memory: the block entries grow upwards from
+ * the start, and the containers grow downwards from the end.  All references
+ * within it are offsets, so it can just as well live in shared memory.
+ *
+ *
+ * Portions Copyright (c) 1996-2015, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/access/common/tidstore.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/htup_details.h"
+#include "access/tidstore.h"
+#include "utils/memutils.h"
+
+/*
+ * If TIDSTORE_INLINE is set in ts_container, its low bits hold the first
+ * offset and the next TIDSTORE_INLINE_BITS hold the second one, or zero if
+ * there's only one.  Otherwise ts_container is the distance of the block's
+ * container from the end of the store, counted in uint16 units.
+ */
+#define TIDSTORE_INLINE			0x80000000
+#define TIDSTORE_INLINE_BITS	12
+#define TIDSTORE_INLINE_MASK	((1 << TIDSTORE_INLINE_BITS) - 1)
+
+/*
+ * A container starts with a uint16 header word.  If TIDSTORE_BITMAP is set,
+ * the rest of the word is the number of bitmap bytes that follow, else it's
+ * the number of OffsetNumbers that follow.
+ */
+#define TIDSTORE_BITMAP			0x8000
+
+/* bitmap bytes for offsets 1..maxoff, rounded up to keep containers aligned */
+#define TIDSTORE_BITMAP_BYTES(maxoff) \
+	(((maxoff) + 2 * BITS_PER_BYTE - 1) / (2 * BITS_PER_BYTE) * 2)
+
+/* the most space one heap block can take up */
+#define TIDSTORE_MAX_BLOCK_BYTES \
+	(sizeof(TidStoreBlock) + sizeof(uint16) + \
+	 TIDSTORE_BITMAP_BYTES(MaxHeapTuplesPerPage))
+
+/* ts_container can address this much data */
+#define TIDSTORE_MAX_DATA		((Size) (TIDSTORE_INLINE - 1) * sizeof(uint16))
+
+#define tidstore_container(ts, pos) \
+	((uint16 *) ((char *) (ts) + (ts)->ts_size) - (pos))
+
+
+/*
+ * tidstore_size_for_blocks
+ *
+ * Returns the size of a store big enough to hold every TID of nblocks heap
+ * blocks.  Callers use this to avoid allocating more than a relation could
+ * ever need.
+ */
+Size
+tidstore_size_for_blocks(BlockNumber nblocks)
+{
+	Size		header = offsetof(TidStore, ts_blocks);
+
+	if (nblocks > (MaxAllocHugeSize - header) / TIDSTORE_MAX_BLOCK_BYTES)
+		return MaxAllocHugeSize;
+
+	return MAXALIGN(header + nblocks * TIDSTORE_MAX_BLOCK_BYTES);
+}
+
+/*
+ * tidstore_estimate
+ *
+ * Returns the number of bytes a store created with the given max_bytes
+ * actually takes.  The store is always big enough for at least one heap
+ * block, however small max_bytes is.
+ */
+Size
+tidstore_estimate(Size max_bytes)
+{
+	Size		size;
+
+	size = Max(max_bytes, tidstore_size_for_blocks(1));
+	return MAXALIGN_DOWN(Min(size, MaxAllocHugeSize));
+}
+
+/*
+ * tidstore_create
+ *
+ * Returns a new, empty store using at most max_bytes of memory, allocated in
+ * the current memory context.
+ */
+TidStore *
+tidstore_create(Size max_bytes)
+{
+	Size		size = tidstore_estimate(max_bytes);
+
+	return tidstore_init(MemoryContextAllocHuge(CurrentMemoryContext, size),
+						 size);
+}
+
+/*
+ * tidstore_init
+ *
+ * Sets up a new, empty store in the given space, which must be MAXALIGN'd
+ * and size bytes long, size having been obtained from tidstore_estimate.
+ * This is how a store is placed in shared memory.
+ */
+TidStore *
+tidstore_init(void *space, Size size)
+{
+	TidStore   *ts = (TidStore *) space;
+
+	StaticAssertStmt(MaxHeapTuplesPerPage <= TIDSTORE_INLINE_MASK,
+					 "heap offsets must fit in an inline TID store entry");
+	StaticAssertStmt(TIDSTORE_BITMAP_BYTES(MaxHeapTuplesPerPage) < TIDSTORE_BITMAP,
+					 "heap page bitmap must fit in a TID store container");
+	Assert(size >= tidstore_size_for_blocks(1) && size == MAXALIGN(size));
+
+	ts->ts_size = size;
+	tidstore_reset(ts);
+
+	return ts;
+}
+
+/*
+ * tidstore_reset
+ *
+ * Forgets all the TIDs in the store.
+ */
+void
+tidstore_reset(TidStore *ts)
+{
+	ts->ts_num_tids = 0;
+	ts->ts_num_blocks = 0;
+	ts->ts_data_used = 0;
+}
+
+/*
+ * tidstore_is_full
+ *
+ * Returns true if the store might not have room for another heap block.
+ */
+bool
+tidstore_is_full(TidStore *ts)
+{
+	Size		used;
+
+	if (ts->ts_data_used + TIDSTORE_MAX_BLOCK_BYTES > TIDSTORE_MAX_DATA)
+		return true;
+
+	used = offsetof(TidStore, ts_blocks) +
+		ts->ts_num_blocks * sizeof(TidStoreBlock) +
+		ts->ts_data_used;
+
+	return used + TIDSTORE_MAX_BLOCK_BYTES > ts->ts_size;
+}
+
+/*
+ * tidstore_add_offsets
+ *
+ * Adds the given offsets, which must be in ascending order, of one heap
+ * block.  The block must come after all blocks already in the store, and the
+ * caller must have checked that the store isn't full.
+ */
+void
+tidstore_add_offsets(TidStore *ts, BlockNumber blkno,
+					 OffsetNumber *offsets, int noffsets)
+{
+	TidStoreBlock *block;
+
+	Assert(noffsets > 0 && noffsets <= MaxHeapTuplesPerPage);
+	Assert(OffsetNumberIsValid(offsets[0]) &&
+		   offsets[noffsets - 1] <= MaxHeapTuplesPerPage);
+
+	if (tidstore_is_full(ts))
+		elog(ERROR, "TID store is full");
+	if (ts->ts_num_blocks > 0 &&
+		ts->ts_blocks[ts->ts_num_blocks - 1].ts_blkno >= blkno)
+		elog(ERROR, "TIDs must be added to a TID store in block number order");
+
+	block = &ts->ts_blocks[ts->ts_num_blocks];
+	block->ts_blkno = blkno;
+
+	if (noffsets <= 2)
+	{
+		block->ts_container = TIDSTORE_INLINE | offsets[0];
+		if (noffsets == 2)
+			block->ts_container |= offsets[1] << TIDSTORE_INLINE_BITS;
+	}
+	else
+	{
+		Size		arraybytes = noffsets * sizeof(OffsetNumber);
+		Size		bitmapbytes = TIDSTORE_BITMAP_BYTES(offsets[noffsets - 1]);
+		uint16	   *container;
+		int			i;
+
+		ts->ts_data_used += sizeof(uint16) + Min(arraybytes, bitmapbytes);
+		block->ts_container = ts->ts_data_used / sizeof(uint16);
+		container = tidstore_container(ts, block->ts_container);
+
+		if (bitmapbytes <= arraybytes)
+		{
+			uint8	   *bitmap = (uint8 *) (container + 1);
+
+			container[0] = TIDSTORE_BITMAP | bitmapbytes;
+			memset(bitmap, 0, bitmapbytes);
+			for (i = 0; i < noffsets; i++)
+			{
+				int			bit = offsets[i] - 1;
+
+				bitmap[bit / BITS_PER_BYTE] |= 1 << (bit % BITS_PER_BYTE);
+			}
+		}
+		else
+		{
+			container[0] = noffsets;
+			memcpy(container + 1, offsets, arraybytes);
+		}
+	}
+
+	ts->ts_num_blocks++;
+	ts->ts_num_tids += noffsets;
+}
+
+/*
+ * tidstore_lookup
+ *
+ * Returns true if the given TID is in the store.
+ */
+bool
+tidstore_lookup(TidStore *ts, ItemPointer tid)
+{
+	BlockNumber blkno = ItemPointerGetBlockNumber(tid);
+	OffsetNumber off = ItemPointerGetOffsetNumber(tid);
+	int			lo = 0;
+	int			hi = ts->ts_num_blocks - 1;
+	uint32		c;
+	uint16	   *container;
+
+	Assert(OffsetNumberIsValid(off));
+
+	/* quick exit for TIDs outside the range of stored blocks */
+	if (hi < 0 ||
+		blkno < ts->ts_blocks[0].ts_blkno ||
+		blkno > ts->ts_blocks[hi].ts_blkno)
+		return false;
+
+	for (;;)
+	{
+		int			mid;
+
+		if (lo > hi)
+			return false;
+		mid = lo + (hi - lo) / 2;
+		if (ts->ts_blocks[mid].ts_blkno < blkno)
+			lo = mid + 1;
+		else if (ts->ts_blocks[mid].ts_blkno > blkno)
+			hi = mid - 1;
+		else
+		{
+			c = ts->ts_blocks[mid].ts_container;
+			break;
+		}
+	}
+
+	if (c & TIDSTORE_INLINE)
+		return (off == (c & TIDSTORE_INLINE_MASK) ||
+				off == ((c >> TIDSTORE_INLINE_BITS) & TIDSTORE_INLINE_MASK));
+
+	container = tidstore_container(ts, c);
+	if (container[0] & TIDSTORE_BITMAP)
+	{
+		uint8	   *bitmap = (uint8 *) (container + 1);
+		int			nbytes = container[0] & ~TIDSTORE_BITMAP;
+		int			bit = off - 1;
+
+		if (bit / BITS_PER_BYTE >= nbytes)
+			return false;
+		return (bitmap[bit / BITS_PER_BYTE] & (1 << (bit % BITS_PER_BYTE))) != 0;
+	}
+	else
+	{
+		OffsetNumber *array = (OffsetNumber *) (container + 1);
+
+		lo = 0;
+		hi = container[0] - 1;
+		while (lo <= hi)
+		{
+			int			mid = lo + (hi - lo) / 2;
+
+			if (array[mid] < off)
+				lo = mid + 1;
+			else if (array[mid] > off)
+				hi = mid - 1;
+			else
+				return true;
+		}
+		return false;
+	}
+}
+
+/*
+ * tidstore_get_offsets
+ *
+ * Fetches the block number and the offsets of the blockindex'th block in the
+ * store.  offsets must have room for MaxHeapTuplesPerPage entries.  Returns
+ * the number of offsets, which come out in ascending order.
+ */
+int
+tidstore_get_offsets(TidStore *ts, int blockindex,
+					 BlockNumber *blkno, OffsetNumber *offsets)
+{
+	uint32		c;
+	uint16	   *container;
+	int			noffsets = 0;
+
+	Assert(blockindex >= 0 && blockindex < ts->ts_num_blocks);
+
+	*blkno = ts->ts_blocks[blockindex].ts_blkno;
+	c = ts->ts_blocks[blockindex].ts_container;
+
+	if (c & TIDSTORE_INLINE)
+	{
+		offsets[noffsets++] = c & TIDSTORE_INLINE_MASK;
+		if ((c >> TIDSTORE_INLINE_BITS) & TIDSTORE_INLINE_MASK)
+			offsets[noffsets++] = (c >> TIDSTORE_INLINE_BITS) & TIDSTORE_INLINE_MASK;
+		return noffsets;
+	}
+
+	container = tidstore_container(ts, c);
+	if (container[0] & TIDSTORE_BITMAP)
+	{
+		uint8	   *bitmap = (uint8 *) (container + 1);
+		int			nbytes = container[0] & ~TIDSTORE_BITMAP;
+		int			bit;
+
+		for (bit = 0; bit < nbytes * BITS_PER_BYTE; bit++)
+		{
+			if (bitmap[bit / BITS_PER_BYTE] & (1 << (bit % BITS_PER_BYTE)))
+				offsets[noffsets++] = bit + 1;
+		}
+	}
+	else
+	{
+		noffsets = container[0];
+		memcpy(offsets, container + 1, noffsets * sizeof(OffsetNumber));
+	}
+
+	return noffsets;
+}
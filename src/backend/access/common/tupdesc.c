@@ -92,6 +92,7 @@ CreateTemplateTupleDesc(int natts, bool hasoid)
 	desc->tdtypmod = -1;
 	desc->tdhasoid = hasoid;
 	desc->tdrefcount = -1;		/* assume not reference-counted */
+	desc->tdnfixedatts = -1;
 
 	return desc;
 }
@@ -125,6 +126,7 @@ CreateTupleDesc(int natts, bool hasoid, Form_pg_attribute *attrs)
 	desc->tdtypmod = -1;
 	desc->tdhasoid = hasoid;
 	desc->tdrefcount = -1;		/* assume not reference-counted */
+	desc->tdnfixedatts = -1;
 
 	return desc;
 }
@@ -252,6 +254,7 @@ TupleDescCopyEntry(TupleDesc dst, AttrNumber dstAttno,
 	 */
 	dst->attrs[dstAttno - 1]->attnum = dstAttno;
 	dst->attrs[dstAttno - 1]->attcacheoff = -1;
+	dst->tdnfixedatts = -1;
 
 	/* since we're not copying constraints or defaults, clear these */
 	dst->attrs[dstAttno - 1]->attnotnull = false;
@@ -527,6 +530,7 @@ TupleDescInitEntry(TupleDesc desc,
 	att->attstattarget = -1;
 	att->attcacheoff = -1;
 	att->atttypmod = typmod;
+	desc->tdnfixedatts = -1;
 
 	att->attnum = attributeNumber;
 	att->attndims = attdim;
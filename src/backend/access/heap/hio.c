@@ -28,6 +28,9 @@
 /*
  * RelationPutHeapTuple - place tuple at specified page
  *
+ * If 'token' is true, the tuple is being inserted speculatively, and its
+ * t_ctid holds a speculative insertion token that must be left alone.
+ *
  * !!! EREPORT(ERROR) IS DISALLOWED HERE !!!  Must PANIC on failure!!!
  *
  * Note - caller must hold BUFFER_LOCK_EXCLUSIVE on the buffer.
@@ -35,7 +38,8 @@
 void
 RelationPutHeapTuple(Relation relation,
 					 Buffer buffer,
-					 HeapTuple tuple)
+					 HeapTuple tuple,
+					 bool token)
 {
 	Page		pageHeader;
 	OffsetNumber offnum;
@@ -54,10 +58,17 @@ RelationPutHeapTuple(Relation relation,
 	/* Update tuple->t_self to the actual position where it was stored */
 	ItemPointerSet(&(tuple->t_self), BufferGetBlockNumber(buffer), offnum);
 
-	/* Insert the correct position into CTID of the stored tuple, too */
-	itemId = PageGetItemId(pageHeader, offnum);
-	item = PageGetItem(pageHeader, itemId);
-	((HeapTupleHeader) item)->t_ctid = tuple->t_self;
+	/*
+	 * Insert the correct position into CTID of the stored tuple, too (unless
+	 * this is a speculative insertion, in which case the token is held in
+	 * CTID field instead)
+	 */
+	if (!token)
+	{
+		itemId = PageGetItemId(pageHeader, offnum);
+		item = PageGetItem(pageHeader, itemId);
+		((HeapTupleHeader) item)->t_ctid = tuple->t_self;
+	}
 }
 
 /*
@@ -97,6 +108,68 @@ ReadBufferBI(Relation relation, BlockNumber targetBlock,
 	return buffer;
 }
 
+/*
+ * Extend a relation by multiple blocks to avoid future contention on the
+ * relation extension lock.  Our caller should hold the extension lock, and
+ * is about to add one more block for its own use after these.
+ *
+ * The new blocks are zero-filled on disk with a single smgrzeroextend call,
+ * initialized as empty heap pages in shared buffers, and then entered into
+ * the FSM, including its upper levels, so that backends that were waiting
+ * for the extension lock find them there instead of extending further.
+ */
+static void
+RelationAddExtraBlocks(Relation relation, BulkInsertState bistate)
+{
+	BufferAccessStrategy strategy = bistate ? bistate->strategy : NULL;
+	BlockNumber firstBlock;
+	Size		freespace = 0;
+	int			lockWaiters;
+	int			extraBlocks;
+	int			i;
+
+	/* Use the length of the lock wait queue to judge how much to extend. */
+	lockWaiters = RelationExtensionLockWaiterCount(relation);
+	if (lockWaiters <= 0)
+		return;
+
+	/*
+	 * Each waiter typically wants just one page, but will be back for more
+	 * soon if it's doing a bulk load; so give each of them a good number of
+	 * pages.  The cap keeps a burst of contention from bloating the table.
+	 */
+	extraBlocks = Min(512, lockWaiters * 20);
+
+	RelationOpenSmgr(relation);
+	firstBlock = smgrnblocks(relation->rd_smgr, MAIN_FORKNUM);
+	smgrzeroextend(relation->rd_smgr, MAIN_FORKNUM, firstBlock, extraBlocks,
+				   false);
+
+	for (i = 0; i < extraBlocks; i++)
+	{
+		Buffer		buffer;
+		Page		page;
+
+		/* The block is known to be all zeroes, so there's no need to read it */
+		buffer = ReadBufferExtended(relation, MAIN_FORKNUM, firstBlock + i,
+									RBM_ZERO_AND_LOCK, strategy);
+		page = BufferGetPage(buffer);
+
+		/*
+		 * Initialize the page; it need not be WAL-logged, since the first
+		 * insertion into it will reinitialize it during replay.  If we crash
+		 * before it is written out, VACUUM will find it all-zeroes and fix
+		 * it.
+		 */
+		PageInit(page, BufferGetPageSize(buffer), 0);
+		MarkBufferDirty(buffer);
+		freespace = PageGetHeapFreeSpace(page);
+		UnlockReleaseBuffer(buffer);
+	}
+
+	RecordNewPagesWithFreeSpace(relation, firstBlock, extraBlocks, freespace);
+}
+
 /*
  * For each heap page which is all-visible, acquire a pin on the appropriate
  * visibility map page, if we haven't already got one.
@@ -295,6 +368,7 @@ RelationGetBufferForTuple(Relation relation, Size len,
 		}
 	}
 
+loop:
 	while (targetBlock != InvalidBlockNumber)
 	{
 		/*
@@ -427,8 +501,36 @@ RelationGetBufferForTuple(Relation relation, Size len,
 	 */
 	needLock = !RELATION_IS_LOCAL(relation);
 
+	/*
+	 * If we need the lock but are not able to acquire it immediately, other
+	 * backends are extending the relation too, so we add a batch of extra
+	 * blocks for them while we're at it.  That only helps them if they can
+	 * find those blocks in the FSM, though.
+	 */
 	if (needLock)
-		LockRelationForExtension(relation, ExclusiveLock);
+	{
+		if (!use_fsm)
+			LockRelationForExtension(relation, ExclusiveLock);
+		else if (!ConditionalLockRelationForExtension(relation, ExclusiveLock))
+		{
+			/* Couldn't get the lock immediately; wait for it. */
+			LockRelationForExtension(relation, ExclusiveLock);
+
+			/*
+			 * Check if some other backend has added pages for us while we
+			 * were waiting on the lock.  If so, use those instead.
+			 */
+			targetBlock = GetPageWithFreeSpace(relation, len + saveFreeSpace);
+			if (targetBlock != InvalidBlockNumber)
+			{
+				UnlockRelationForExtension(relation, ExclusiveLock);
+				goto loop;
+			}
+
+			/* Time to bulk-extend. */
+			RelationAddExtraBlocks(relation, bistate);
+		}
+	}
 
 	/*
 	 * XXX This does an lseek - rather expensive - but at the moment it is the
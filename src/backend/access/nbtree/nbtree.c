@@ -19,6 +19,7 @@
 #include "postgres.h"
 
 #include "access/nbtree.h"
+#include "access/parallel.h"
 #include "access/relscan.h"
 #include "access/xlog.h"
 #include "catalog/index.h"
@@ -31,23 +32,6 @@
 #include "utils/memutils.h"
 
 
-/* Working state for btbuild and its callback */
-typedef struct
-{
-	bool		isUnique;
-	bool		haveDead;
-	Relation	heapRel;
-	BTSpool    *spool;
-
-	/*
-	 * spool2 is needed only when the index is an unique index. Dead tuples
-	 * are put into spool2 instead of spool in order to avoid uniqueness
-	 * check.
-	 */
-	BTSpool    *spool2;
-	double		indtuples;
-} BTBuildState;
-
 /* Working state needed by btvacuumpage */
 typedef struct
 {
@@ -63,12 +47,6 @@ typedef struct
 } BTVacState;
 
 
-static void btbuildCallback(Relation index,
-				HeapTuple htup,
-				Datum *values,
-				bool *isnull,
-				bool tupleIsAlive,
-				void *state);
 static void btvacuumscan(IndexVacuumInfo *info, IndexBulkDeleteResult *stats,
 			 IndexBulkDeleteCallback callback, void *callback_state,
 			 BTCycleId cycleid);
@@ -95,6 +73,7 @@ btbuild(PG_FUNCTION_ARGS)
 	buildstate.spool = NULL;
 	buildstate.spool2 = NULL;
 	buildstate.indtuples = 0;
+	buildstate.pcxt = NULL;
 
 #ifdef BTREE_BUILD_STATS
 	if (log_btree_build_stats)
@@ -109,18 +88,27 @@ btbuild(PG_FUNCTION_ARGS)
 		elog(ERROR, "index \"%s\" already contains data",
 			 RelationGetRelationName(index));
 
-	buildstate.spool = _bt_spoolinit(heap, index, indexInfo->ii_Unique, false);
+	if (indexInfo->ii_ParallelWorkers > 0)
+	{
+		/* workers scan and sort; the spools merge what they produce */
+		reltuples = _bt_parallel_heapscan(&buildstate, index, indexInfo);
+	}
+	else
+	{
+		buildstate.spool = _bt_spoolinit(heap, index, indexInfo->ii_Unique,
+										 false);
 
-	/*
-	 * If building a unique index, put dead tuples in a second spool to keep
-	 * them out of the uniqueness check.
-	 */
-	if (indexInfo->ii_Unique)
-		buildstate.spool2 = _bt_spoolinit(heap, index, false, true);
+		/*
+		 * If building a unique index, put dead tuples in a second spool to
+		 * keep them out of the uniqueness check.
+		 */
+		if (indexInfo->ii_Unique)
+			buildstate.spool2 = _bt_spoolinit(heap, index, false, true);
 
-	/* do the heap scan */
-	reltuples = IndexBuildHeapScan(heap, index, indexInfo, true,
-								   btbuildCallback, (void *) &buildstate);
+		/* do the heap scan */
+		reltuples = IndexBuildHeapScan(heap, index, indexInfo, true,
+									   btbuildCallback, (void *) &buildstate);
+	}
 
 	/* okay, all heap tuples are indexed */
 	if (buildstate.spool2 && !buildstate.haveDead)
@@ -140,6 +128,10 @@ btbuild(PG_FUNCTION_ARGS)
 	if (buildstate.spool2)
 		_bt_spooldestroy(buildstate.spool2);
 
+	/* the workers' sorted runs are no longer needed */
+	if (buildstate.pcxt)
+		DestroyParallelContext(buildstate.pcxt);
+
 #ifdef BTREE_BUILD_STATS
 	if (log_btree_build_stats)
 	{
@@ -160,9 +152,10 @@ btbuild(PG_FUNCTION_ARGS)
 }
 
 /*
- * Per-tuple callback from IndexBuildHeapScan
+ * Per-tuple callback from IndexBuildHeapScan, in the leader and in parallel
+ * workers alike
  */
-static void
+void
 btbuildCallback(Relation index,
 				HeapTuple htup,
 				Datum *values,
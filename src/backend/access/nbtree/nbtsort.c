@@ -67,8 +67,12 @@
 #include "postgres.h"
 
 #include "access/nbtree.h"
+#include "access/parallel.h"
+#include "access/relscan.h"
+#include "access/xact.h"
 #include "access/xlog.h"
 #include "access/xloginsert.h"
+#include "catalog/index.h"
 #include "miscadmin.h"
 #include "storage/smgr.h"
 #include "tcop/tcopprot.h"
@@ -90,6 +94,35 @@ struct BTSpool
 	bool		isunique;
 };
 
+/*
+ * Keys for the parts of a parallel btree build's shared state, within the
+ * parallel context's table of contents.
+ */
+#define PARALLEL_KEY_BTREE_SHARED		UINT64CONST(1)
+#define PARALLEL_KEY_HEAP_SCAN			UINT64CONST(2)
+#define PARALLEL_KEY_TUPLESORT			UINT64CONST(3)
+#define PARALLEL_KEY_TUPLESORT_SPOOL2	UINT64CONST(4)
+
+/*
+ * Status record shared by the participants of a parallel btree build.  Each
+ * participant adds its own results in at the end of its scan.
+ */
+typedef struct BTShared
+{
+	/* Set up by the leader before launching the workers */
+	Oid			heaprelid;
+	Oid			indexrelid;
+	bool		isunique;
+	int			sortmem;		/* kB of sort memory for each participant */
+
+	/* Accumulated results, protected by mutex */
+	slock_t		mutex;
+	double		reltuples;
+	double		indtuples;
+	bool		havedead;
+	bool		brokenhotchain;
+} BTShared;
+
 /*
  * Status record for a btree page being built.  We have one of these
  * for each active tree level.
@@ -138,6 +171,15 @@ static void _bt_buildadd(BTWriteState *wstate, BTPageState *state,
 static void _bt_uppershutdown(BTWriteState *wstate, BTPageState *state);
 static void _bt_load(BTWriteState *wstate,
 		 BTSpool *btspool, BTSpool *btspool2);
+static BTSpool *_bt_spoolinit_shared(Relation heap, Relation index,
+					 bool isunique, int workMem,
+					 Sharedsort *shared, bool leader);
+static void _bt_parallel_scan_and_sort(Relation heap, Relation index,
+						   IndexInfo *indexInfo, BTShared *btshared,
+						   ParallelHeapScanDesc pscan,
+						   Sharedsort *sharedsort,
+						   Sharedsort *sharedsort2);
+static void _bt_parallel_build_main(dsm_segment *seg, shm_toc *toc);
 
 
 /*
@@ -831,3 +873,228 @@ _bt_load(BTWriteState *wstate, BTSpool *btspool, BTSpool *btspool2)
 		smgrimmedsync(wstate->index->rd_smgr, MAIN_FORKNUM);
 	}
 }
+
+
+/*
+ * Parallel build support
+ *
+ * In a parallel build, the heap is scanned with a parallel heap scan by
+ * the leader and its workers together.  Each participant spools the index
+ * tuples from the blocks it claims into its own worker sort of a shared
+ * sort (two, for a unique index), and leaves its sorted run in the shared
+ * sort's files.  The leader's spools are then set up as the leaders of the
+ * shared sorts, and _bt_leafbuild merges the runs as it loads the index.
+ */
+
+/*
+ * create a spool whose sort takes part in the shared sort 'shared', as a
+ * worker or as the leader that merges the workers' output
+ */
+static BTSpool *
+_bt_spoolinit_shared(Relation heap, Relation index, bool isunique,
+					 int workMem, Sharedsort *shared, bool leader)
+{
+	BTSpool    *btspool = (BTSpool *) palloc0(sizeof(BTSpool));
+
+	btspool->heap = heap;
+	btspool->index = index;
+	btspool->isunique = isunique;
+	btspool->sortstate = tuplesort_begin_index_btree(heap, index, isunique,
+													 workMem, false);
+	if (leader)
+		tuplesort_attach_leader(btspool->sortstate, shared);
+	else
+		tuplesort_attach_worker(btspool->sortstate, shared);
+
+	return btspool;
+}
+
+/*
+ * _bt_parallel_heapscan() -- scan the heap and sort with parallel workers
+ *
+ * Launches up to indexInfo->ii_ParallelWorkers workers, and takes part in
+ * the scan and sort itself.  When they have all finished, buildstate's
+ * spools are set up to merge the participants' sorted runs, and the
+ * parallel context, which holds those runs, is left in buildstate->pcxt for
+ * the caller to destroy after the spools.
+ *
+ * Returns the number of heap tuples scanned, like IndexBuildHeapScan.
+ */
+double
+_bt_parallel_heapscan(BTBuildState *buildstate, Relation index,
+					  IndexInfo *indexInfo)
+{
+	Relation	heap = buildstate->heapRel;
+	ParallelContext *pcxt;
+	BTShared   *btshared;
+	ParallelHeapScanDesc pscan;
+	Sharedsort *sharedsort;
+	Sharedsort *sharedsort2 = NULL;
+	int			nparticipants = indexInfo->ii_ParallelWorkers + 1;
+
+	Assert(!indexInfo->ii_Concurrent);
+
+	EnterParallelMode();
+	pcxt = CreateParallelContext(_bt_parallel_build_main,
+								 indexInfo->ii_ParallelWorkers);
+
+	shm_toc_estimate_chunk(&pcxt->estimator, sizeof(BTShared));
+	shm_toc_estimate_chunk(&pcxt->estimator, heap_parallelscan_estimate());
+	shm_toc_estimate_chunk(&pcxt->estimator, tuplesort_estimate_shared());
+	if (buildstate->isUnique)
+	{
+		shm_toc_estimate_chunk(&pcxt->estimator, tuplesort_estimate_shared());
+		shm_toc_estimate_keys(&pcxt->estimator, 4);
+	}
+	else
+		shm_toc_estimate_keys(&pcxt->estimator, 3);
+
+	InitializeParallelDSM(pcxt);
+
+	btshared = shm_toc_allocate(pcxt->toc, sizeof(BTShared));
+	btshared->heaprelid = RelationGetRelid(heap);
+	btshared->indexrelid = RelationGetRelid(index);
+	btshared->isunique = buildstate->isUnique;
+	btshared->sortmem = Max(maintenance_work_mem / nparticipants, 64);
+	SpinLockInit(&btshared->mutex);
+	btshared->reltuples = 0;
+	btshared->indtuples = 0;
+	btshared->havedead = false;
+	btshared->brokenhotchain = false;
+	shm_toc_insert(pcxt->toc, PARALLEL_KEY_BTREE_SHARED, btshared);
+
+	pscan = shm_toc_allocate(pcxt->toc, heap_parallelscan_estimate());
+	heap_parallelscan_initialize(pscan, heap);
+	shm_toc_insert(pcxt->toc, PARALLEL_KEY_HEAP_SCAN, pscan);
+
+	sharedsort = shm_toc_allocate(pcxt->toc, tuplesort_estimate_shared());
+	tuplesort_initialize_shared(sharedsort, nparticipants, pcxt->seg);
+	shm_toc_insert(pcxt->toc, PARALLEL_KEY_TUPLESORT, sharedsort);
+
+	if (buildstate->isUnique)
+	{
+		sharedsort2 = shm_toc_allocate(pcxt->toc, tuplesort_estimate_shared());
+		tuplesort_initialize_shared(sharedsort2, nparticipants, pcxt->seg);
+		shm_toc_insert(pcxt->toc, PARALLEL_KEY_TUPLESORT_SPOOL2, sharedsort2);
+	}
+
+	buildstate->pcxt = pcxt;
+	LaunchParallelWorkers(pcxt);
+
+	/* Do our share of the scan while the workers do theirs */
+	_bt_parallel_scan_and_sort(heap, index, indexInfo, btshared, pscan,
+							   sharedsort, sharedsort2);
+
+	/* Any error a worker raised is re-thrown here */
+	WaitForParallelWorkersToFinish(pcxt);
+	ExitParallelMode();
+
+	/* Everyone is done, so the totals can be read without the lock */
+	buildstate->indtuples = btshared->indtuples;
+	buildstate->haveDead = btshared->havedead;
+	if (btshared->brokenhotchain)
+		indexInfo->ii_BrokenHotChain = true;
+
+	buildstate->spool = _bt_spoolinit_shared(heap, index, buildstate->isUnique,
+											 maintenance_work_mem,
+											 sharedsort, true);
+	if (buildstate->isUnique)
+		buildstate->spool2 = _bt_spoolinit_shared(heap, index, false,
+												  work_mem, sharedsort2, true);
+
+	return btshared->reltuples;
+}
+
+/*
+ * Scan this participant's share of the heap into worker sorts of the shared
+ * sorts, sort it, and add our results to the shared totals.  sharedsort2 is
+ * NULL unless the index is unique.
+ */
+static void
+_bt_parallel_scan_and_sort(Relation heap, Relation index,
+						   IndexInfo *indexInfo, BTShared *btshared,
+						   ParallelHeapScanDesc pscan,
+						   Sharedsort *sharedsort,
+						   Sharedsort *sharedsort2)
+{
+	BTBuildState buildstate;
+	double		reltuples;
+
+	buildstate.isUnique = btshared->isunique;
+	buildstate.haveDead = false;
+	buildstate.heapRel = heap;
+	buildstate.spool = _bt_spoolinit_shared(heap, index, btshared->isunique,
+											btshared->sortmem,
+											sharedsort, false);
+	buildstate.spool2 = NULL;
+	if (sharedsort2)
+		buildstate.spool2 = _bt_spoolinit_shared(heap, index, false, work_mem,
+												 sharedsort2, false);
+	buildstate.indtuples = 0;
+	buildstate.pcxt = NULL;
+
+	reltuples = IndexBuildHeapParallelScan(heap, index, indexInfo, pscan,
+										   btbuildCallback,
+										   (void *) &buildstate);
+
+	/* leave our sorted runs where the leader will look for them */
+	tuplesort_performsort(buildstate.spool->sortstate);
+	if (buildstate.spool2)
+		tuplesort_performsort(buildstate.spool2->sortstate);
+
+	SpinLockAcquire(&btshared->mutex);
+	btshared->reltuples += reltuples;
+	btshared->indtuples += buildstate.indtuples;
+	if (buildstate.haveDead)
+		btshared->havedead = true;
+	if (indexInfo->ii_BrokenHotChain)
+		btshared->brokenhotchain = true;
+	SpinLockRelease(&btshared->mutex);
+
+	_bt_spooldestroy(buildstate.spool);
+	if (buildstate.spool2)
+		_bt_spooldestroy(buildstate.spool2);
+}
+
+/*
+ * Main entry point for a parallel btree build worker.
+ */
+static void
+_bt_parallel_build_main(dsm_segment *seg, shm_toc *toc)
+{
+	BTShared   *btshared;
+	ParallelHeapScanDesc pscan;
+	Sharedsort *sharedsort;
+	Sharedsort *sharedsort2 = NULL;
+	Relation	heapRel;
+	Relation	indexRel;
+	IndexInfo  *indexInfo;
+
+	btshared = shm_toc_lookup(toc, PARALLEL_KEY_BTREE_SHARED);
+	pscan = shm_toc_lookup(toc, PARALLEL_KEY_HEAP_SCAN);
+
+	sharedsort = shm_toc_lookup(toc, PARALLEL_KEY_TUPLESORT);
+	tuplesort_attach_shared(sharedsort, seg);
+	if (btshared->isunique)
+	{
+		sharedsort2 = shm_toc_lookup(toc, PARALLEL_KEY_TUPLESORT_SPOOL2);
+		tuplesort_attach_shared(sharedsort2, seg);
+	}
+
+	/*
+	 * The leader holds at least ShareLock on the heap and AccessExclusiveLock
+	 * on the index until we are done, and waits for us meanwhile.  Asking
+	 * for locks of our own could only queue us behind someone waiting for the
+	 * leader, which is a deadlock the lock manager can't see.
+	 */
+	heapRel = heap_open(btshared->heaprelid, NoLock);
+	indexRel = index_open(btshared->indexrelid, NoLock);
+
+	indexInfo = BuildIndexInfo(indexRel);
+
+	_bt_parallel_scan_and_sort(heapRel, indexRel, indexInfo, btshared, pscan,
+							   sharedsort, sharedsort2);
+
+	index_close(indexRel, NoLock);
+	heap_close(heapRel, NoLock);
+}
@@ -0,0 +1,627 @@
+/*-------------------------------------------------------------------------
+ *
+ * parallel.c
+ *	  Infrastructure for launching parallel workers
+ *
+ * A ParallelContext describes a dynamic shared memory segment and a set of
+ * background workers that attach to it.  The master backend serializes into
+ * the segment everything a worker needs to behave as though it were running
+ * inside the master's transaction: the GUC settings, the current user and
+ * security context, the XIDs the master considers current, its combo CIDs
+ * and its active snapshot.  Each worker restores that state and then calls
+ * the caller-supplied entrypoint, which finds the rest of its input in the
+ * segment's table of contents.
+ *
+ * Workers may only read.  They never get an XID of their own, and they
+ * cannot use the command ID they inherited to mark tuples.  The master must
+ * be in parallel mode from before it creates the context until its workers
+ * have exited, so that the state they copied stays accurate.
+ *
+ * If a worker fails, the first error is saved in the segment, and the
+ * master re-throws it the next time it checks for worker errors.
+ *
+ * Portions Copyright (c) 1996-2015, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * IDENTIFICATION
+ *	  src/backend/access/transam/parallel.c
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include "access/parallel.h"
+#include "access/xact.h"
+#include "libpq/pqsignal.h"
+#include "miscadmin.h"
+#include "storage/dsm.h"
+#include "storage/ipc.h"
+#include "storage/proc.h"
+#include "storage/procsignal.h"
+#include "storage/spin.h"
+#include "tcop/tcopprot.h"
+#include "utils/combocid.h"
+#include "utils/guc.h"
+#include "utils/memutils.h"
+#include "utils/resowner.h"
+#include "utils/snapmgr.h"
+
+
+/* Magic number for parallel context TOC. */
+#define PARALLEL_MAGIC						0x50477c7c
+
+/*
+ * Magic numbers for the per-context parallel state, chosen so as not to
+ * collide with the small keys that callers use for their own data.
+ */
+#define PARALLEL_KEY_FIXED					UINT64CONST(0xFFFFFFFFFFFF0001)
+#define PARALLEL_KEY_GUC					UINT64CONST(0xFFFFFFFFFFFF0002)
+#define PARALLEL_KEY_COMBO_CID				UINT64CONST(0xFFFFFFFFFFFF0003)
+#define PARALLEL_KEY_TRANSACTION_STATE		UINT64CONST(0xFFFFFFFFFFFF0004)
+#define PARALLEL_KEY_ACTIVE_SNAPSHOT		UINT64CONST(0xFFFFFFFFFFFF0005)
+
+/* Room for each part of a worker's error report */
+#define PARALLEL_ERROR_MSGLEN				1024
+
+/* Fixed-size parallel state. */
+typedef struct FixedParallelState
+{
+	/* Fixed-size state that workers must restore. */
+	Oid			database_id;
+	Oid			current_user_id;
+	int			sec_context;
+	PGPROC	   *parallel_master_pgproc;
+	parallel_worker_main_type entrypoint;
+
+	/* Mutex protects remaining fields. */
+	slock_t		mutex;
+
+	/* Workers that have claimed a worker number, and that have finished. */
+	int			nworkers_started;
+	int			nworkers_finished;
+
+	/* The first error reported by any worker. */
+	bool		error_reported;
+	int			error_sqlerrcode;
+	char		error_message[PARALLEL_ERROR_MSGLEN];
+	char		error_detail[PARALLEL_ERROR_MSGLEN];
+	char		error_hint[PARALLEL_ERROR_MSGLEN];
+} FixedParallelState;
+
+/*
+ * Our parallel worker number.  We initialize this to -1, meaning that we are
+ * not a parallel worker.  In parallel workers, it will be set to a value >= 0
+ * and < the number of workers before any user code is invoked; each parallel
+ * worker will get a different parallel worker number.
+ */
+int			ParallelWorkerNumber = -1;
+
+/* List of active parallel contexts. */
+static dlist_head pcxt_list = DLIST_STATIC_INIT(pcxt_list);
+
+static void ParallelWorkerMain(Datum main_arg);
+
+
+/*
+ * Establish a new parallel context.  Unless there is an error, the context
+ * should be destroyed before exiting the current subtransaction.
+ */
+ParallelContext *
+CreateParallelContext(parallel_worker_main_type entrypoint, int nworkers)
+{
+	MemoryContext oldcontext;
+	ParallelContext *pcxt;
+
+	/* It is unsafe to create a parallel context if not in parallel mode. */
+	Assert(IsInParallelMode());
+
+	/* Number of workers should be non-negative. */
+	Assert(nworkers >= 0);
+
+	/*
+	 * If dynamic shared memory is not available, we won't be able to use
+	 * background workers.
+	 */
+	if (dynamic_shared_memory_type == DSM_IMPL_NONE)
+		nworkers = 0;
+
+	/* We might be running in a short-lived memory context. */
+	oldcontext = MemoryContextSwitchTo(TopTransactionContext);
+
+	/* Initialize a new ParallelContext. */
+	pcxt = palloc0(sizeof(ParallelContext));
+	pcxt->subid = GetCurrentSubTransactionId();
+	pcxt->nworkers = nworkers;
+	pcxt->entrypoint = entrypoint;
+	shm_toc_initialize_estimator(&pcxt->estimator);
+	dlist_push_head(&pcxt_list, &pcxt->node);
+
+	/* Restore previous memory context. */
+	MemoryContextSwitchTo(oldcontext);
+
+	return pcxt;
+}
+
+/*
+ * Establish the dynamic shared memory segment for a parallel context and
+ * copy state and other bookkeeping information that will be needed by
+ * parallel workers into it.  The caller must already have added its own
+ * chunks and keys to pcxt->estimator; it stores its data in the segment
+ * once this returns.
+ */
+void
+InitializeParallelDSM(ParallelContext *pcxt)
+{
+	MemoryContext oldcontext;
+	Size		segsize;
+	Size		gucspacelen = 0;
+	Size		combocidlen = 0;
+	Size		tstatelen = 0;
+	Size		asnaplen = 0;
+	Snapshot	active_snapshot = GetActiveSnapshot();
+	FixedParallelState *fps;
+	char	   *gucspace;
+	char	   *combocidspace;
+	char	   *tstatespace;
+	char	   *asnapspace;
+
+	/* We might be running in a very short-lived memory context. */
+	oldcontext = MemoryContextSwitchTo(TopTransactionContext);
+
+	/* Allow space to store the fixed-size parallel state. */
+	shm_toc_estimate_chunk(&pcxt->estimator, sizeof(FixedParallelState));
+	shm_toc_estimate_keys(&pcxt->estimator, 1);
+
+	/* Estimate space for the state that workers must restore. */
+	gucspacelen = EstimateGUCStateSpace();
+	shm_toc_estimate_chunk(&pcxt->estimator, gucspacelen);
+	combocidlen = EstimateComboCIDStateSpace();
+	shm_toc_estimate_chunk(&pcxt->estimator, combocidlen);
+	tstatelen = EstimateTransactionStateSpace();
+	shm_toc_estimate_chunk(&pcxt->estimator, tstatelen);
+	asnaplen = EstimateSnapshotSpace(active_snapshot);
+	shm_toc_estimate_chunk(&pcxt->estimator, asnaplen);
+	shm_toc_estimate_keys(&pcxt->estimator, 4);
+
+	/* Create the DSM segment and a table of contents in it. */
+	segsize = shm_toc_estimate(&pcxt->estimator);
+	pcxt->seg = dsm_create(segsize);
+	pcxt->toc = shm_toc_create(PARALLEL_MAGIC,
+							   dsm_segment_address(pcxt->seg),
+							   segsize);
+
+	/* Initialize fixed-size state in shared memory. */
+	fps = (FixedParallelState *)
+		shm_toc_allocate(pcxt->toc, sizeof(FixedParallelState));
+	fps->database_id = MyDatabaseId;
+	GetUserIdAndSecContext(&fps->current_user_id, &fps->sec_context);
+	fps->parallel_master_pgproc = MyProc;
+	fps->entrypoint = pcxt->entrypoint;
+	SpinLockInit(&fps->mutex);
+	fps->nworkers_started = 0;
+	fps->nworkers_finished = 0;
+	fps->error_reported = false;
+	shm_toc_insert(pcxt->toc, PARALLEL_KEY_FIXED, fps);
+
+	/* Serialize GUC settings. */
+	gucspace = shm_toc_allocate(pcxt->toc, gucspacelen);
+	SerializeGUCState(gucspacelen, gucspace);
+	shm_toc_insert(pcxt->toc, PARALLEL_KEY_GUC, gucspace);
+
+	/* Serialize combo CID state. */
+	combocidspace = shm_toc_allocate(pcxt->toc, combocidlen);
+	SerializeComboCIDState(combocidlen, combocidspace);
+	shm_toc_insert(pcxt->toc, PARALLEL_KEY_COMBO_CID, combocidspace);
+
+	/* Serialize transaction state. */
+	tstatespace = shm_toc_allocate(pcxt->toc, tstatelen);
+	SerializeTransactionState(tstatelen, tstatespace);
+	shm_toc_insert(pcxt->toc, PARALLEL_KEY_TRANSACTION_STATE, tstatespace);
+
+	/* Serialize the active snapshot. */
+	asnapspace = shm_toc_allocate(pcxt->toc, asnaplen);
+	SerializeSnapshot(active_snapshot, asnapspace);
+	shm_toc_insert(pcxt->toc, PARALLEL_KEY_ACTIVE_SNAPSHOT, asnapspace);
+
+	/* Restore previous memory context. */
+	MemoryContextSwitchTo(oldcontext);
+}
+
+/*
+ * Reinitialize the dynamic shared memory segment for a parallel context such
+ * that we could launch workers for it again.  Any workers still running from
+ * the previous launch are terminated first.
+ */
+void
+ReinitializeParallelDSM(ParallelContext *pcxt)
+{
+	FixedParallelState *fps;
+	int			i;
+
+	if (pcxt->worker != NULL)
+	{
+		for (i = 0; i < pcxt->nworkers_launched; ++i)
+			TerminateBackgroundWorker(pcxt->worker[i]);
+		for (i = 0; i < pcxt->nworkers_launched; ++i)
+		{
+			WaitForBackgroundWorkerShutdown(pcxt->worker[i]);
+			pfree(pcxt->worker[i]);
+		}
+		pfree(pcxt->worker);
+		pcxt->worker = NULL;
+		set_latch_on_sigusr1 = pcxt->save_set_latch_on_sigusr1;
+	}
+	pcxt->nworkers_launched = 0;
+
+	/* Reset the shared state that the workers update. */
+	fps = shm_toc_lookup(pcxt->toc, PARALLEL_KEY_FIXED);
+	fps->nworkers_started = 0;
+	fps->nworkers_finished = 0;
+	fps->error_reported = false;
+}
+
+/*
+ * Launch parallel workers.
+ *
+ * We make do with however many of the requested workers the postmaster has
+ * slots for; pcxt->nworkers_launched tells how many were registered.
+ */
+void
+LaunchParallelWorkers(ParallelContext *pcxt)
+{
+	MemoryContext oldcontext;
+	BackgroundWorker worker;
+	int			i;
+
+	/* Skip this if we have no workers. */
+	if (pcxt->nworkers == 0)
+		return;
+
+	/* If we do have workers, we'd better have a DSM segment. */
+	Assert(pcxt->seg != NULL);
+
+	/* We might be running in a short-lived memory context. */
+	oldcontext = MemoryContextSwitchTo(TopTransactionContext);
+
+	/* Configure a worker. */
+	memset(&worker, 0, sizeof(worker));
+	snprintf(worker.bgw_name, BGW_MAXLEN, "parallel worker for PID %d",
+			 MyProcPid);
+	worker.bgw_flags =
+		BGWORKER_SHMEM_ACCESS | BGWORKER_BACKEND_DATABASE_CONNECTION;
+	worker.bgw_start_time = BgWorkerStart_ConsistentState;
+	worker.bgw_restart_time = BGW_NEVER_RESTART;
+	worker.bgw_main = ParallelWorkerMain;
+	worker.bgw_main_arg = UInt32GetDatum(dsm_segment_handle(pcxt->seg));
+	worker.bgw_notify_pid = MyProcPid;
+
+	/*
+	 * The postmaster tells us about the workers' exits with SIGUSR1; have it
+	 * set our latch, so that nobody waiting for the workers sleeps through
+	 * an exit.
+	 */
+	pcxt->save_set_latch_on_sigusr1 = set_latch_on_sigusr1;
+	set_latch_on_sigusr1 = true;
+
+	pcxt->worker = palloc0(sizeof(BackgroundWorkerHandle *) * pcxt->nworkers);
+	for (i = 0; i < pcxt->nworkers; ++i)
+	{
+		if (!RegisterDynamicBackgroundWorker(&worker,
+											 &pcxt->worker[pcxt->nworkers_launched]))
+			break;
+		pcxt->nworkers_launched++;
+	}
+
+	/* Restore previous memory context. */
+	MemoryContextSwitchTo(oldcontext);
+}
+
+/*
+ * Have all the workers we launched exited?
+ *
+ * Callers that wait on a latch for worker output use this to find out that
+ * no more output can arrive from workers that never got going.
+ */
+bool
+ParallelWorkersStopped(ParallelContext *pcxt)
+{
+	int			i;
+
+	for (i = 0; i < pcxt->nworkers_launched; ++i)
+	{
+		pid_t		pid;
+
+		if (GetBackgroundWorkerPid(pcxt->worker[i], &pid) != BGWH_STOPPED)
+			return false;
+	}
+
+	return true;
+}
+
+/*
+ * Re-throw the first error reported by any worker, if there is one.
+ */
+void
+CheckParallelWorkerErrors(ParallelContext *pcxt)
+{
+	FixedParallelState *fps;
+	bool		error_reported;
+
+	if (pcxt->toc == NULL)
+		return;
+
+	fps = shm_toc_lookup(pcxt->toc, PARALLEL_KEY_FIXED);
+	SpinLockAcquire(&fps->mutex);
+	error_reported = fps->error_reported;
+	SpinLockRelease(&fps->mutex);
+
+	/* once a worker has reported, nobody writes the error fields again */
+	if (error_reported)
+		ereport(ERROR,
+				(errcode(fps->error_sqlerrcode),
+				 errmsg_internal("%s", fps->error_message),
+				 fps->error_detail[0] != '\0' ?
+				 errdetail_internal("%s", fps->error_detail) : 0,
+				 fps->error_hint[0] != '\0' ?
+				 errhint("%s", fps->error_hint) : 0,
+				 errcontext("parallel worker")));
+}
+
+/*
+ * Wait for all workers to exit, and re-throw any error they reported.
+ *
+ * A worker that claimed a worker number but exited without either finishing
+ * or reporting an error may have left part of the work undone, so that is an
+ * error too.
+ */
+void
+WaitForParallelWorkersToFinish(ParallelContext *pcxt)
+{
+	FixedParallelState *fps;
+	int			nworkers_started;
+	int			nworkers_finished;
+	int			i;
+
+	for (i = 0; i < pcxt->nworkers_launched; ++i)
+	{
+		if (WaitForBackgroundWorkerShutdown(pcxt->worker[i]) ==
+			BGWH_POSTMASTER_DIED)
+			ereport(FATAL,
+					(errcode(ERRCODE_ADMIN_SHUTDOWN),
+					 errmsg("postmaster exited during a parallel operation")));
+	}
+
+	CheckParallelWorkerErrors(pcxt);
+
+	if (pcxt->toc == NULL)
+		return;
+	fps = shm_toc_lookup(pcxt->toc, PARALLEL_KEY_FIXED);
+	SpinLockAcquire(&fps->mutex);
+	nworkers_started = fps->nworkers_started;
+	nworkers_finished = fps->nworkers_finished;
+	SpinLockRelease(&fps->mutex);
+
+	if (nworkers_finished < nworkers_started)
+		ereport(ERROR,
+				(errcode(ERRCODE_INTERNAL_ERROR),
+				 errmsg("parallel worker exited unexpectedly")));
+}
+
+/*
+ * Destroy a parallel context.
+ *
+ * Any workers still running are terminated, and we wait for them to exit
+ * before detaching from the segment, so that nothing they do can outlive
+ * the context.  Errors they may have reported are ignored; the caller wants
+ * them only if it calls WaitForParallelWorkersToFinish first.
+ */
+void
+DestroyParallelContext(ParallelContext *pcxt)
+{
+	int			i;
+
+	if (pcxt->worker != NULL)
+	{
+		for (i = 0; i < pcxt->nworkers_launched; ++i)
+			TerminateBackgroundWorker(pcxt->worker[i]);
+		for (i = 0; i < pcxt->nworkers_launched; ++i)
+			WaitForBackgroundWorkerShutdown(pcxt->worker[i]);
+		set_latch_on_sigusr1 = pcxt->save_set_latch_on_sigusr1;
+	}
+
+	/*
+	 * Only now forget the context, so that if we error out while waiting,
+	 * AtEOXact_Parallel still finds it and finishes the job.
+	 */
+	dlist_delete(&pcxt->node);
+
+	if (pcxt->worker != NULL)
+	{
+		for (i = 0; i < pcxt->nworkers_launched; ++i)
+			pfree(pcxt->worker[i]);
+		pfree(pcxt->worker);
+	}
+
+	if (pcxt->seg != NULL)
+		dsm_detach(pcxt->seg);
+
+	pfree(pcxt);
+}
+
+/*
+ * End-of-subtransaction cleanup for parallel contexts.
+ *
+ * New contexts are pushed at the head of pcxt_list, so those belonging to
+ * the ending subtransaction are all at the front.
+ */
+void
+AtEOSubXact_Parallel(bool isCommit, SubTransactionId mySubId)
+{
+	while (!dlist_is_empty(&pcxt_list))
+	{
+		ParallelContext *pcxt;
+
+		pcxt = dlist_head_element(ParallelContext, node, &pcxt_list);
+		if (pcxt->subid != mySubId)
+			break;
+		if (isCommit)
+			elog(WARNING, "leaked parallel context");
+		DestroyParallelContext(pcxt);
+	}
+}
+
+/*
+ * End-of-transaction cleanup for parallel contexts.
+ */
+void
+AtEOXact_Parallel(bool isCommit)
+{
+	while (!dlist_is_empty(&pcxt_list))
+	{
+		ParallelContext *pcxt;
+
+		pcxt = dlist_head_element(ParallelContext, node, &pcxt_list);
+		if (isCommit)
+			elog(WARNING, "leaked parallel context");
+		DestroyParallelContext(pcxt);
+	}
+}
+
+/*
+ * Main entrypoint for parallel workers.
+ */
+static void
+ParallelWorkerMain(Datum main_arg)
+{
+	dsm_segment *seg;
+	shm_toc    *toc;
+	FixedParallelState *fps;
+	char	   *gucspace;
+	char	   *combocidspace;
+	char	   *tstatespace;
+	char	   *asnapspace;
+	Snapshot	snapshot;
+	MemoryContext workercontext;
+
+	/* Establish signal handlers. */
+	pqsignal(SIGTERM, die);
+	BackgroundWorkerUnblockSignals();
+
+	/* Set up a resource owner. */
+	CurrentResourceOwner = ResourceOwnerCreate(NULL, "parallel worker");
+
+	/* Now that we have a resource owner, we can attach to the segment. */
+	seg = dsm_attach(DatumGetUInt32(main_arg));
+	if (seg == NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("could not map dynamic shared memory segment")));
+	toc = shm_toc_attach(PARALLEL_MAGIC, dsm_segment_address(seg));
+	if (toc == NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+			   errmsg("invalid magic number in dynamic shared memory segment")));
+
+	/* Determine and set our worker number. */
+	fps = shm_toc_lookup(toc, PARALLEL_KEY_FIXED);
+	Assert(fps != NULL);
+	SpinLockAcquire(&fps->mutex);
+	ParallelWorkerNumber = fps->nworkers_started++;
+	SpinLockRelease(&fps->mutex);
+
+	/*
+	 * Connect as the bootstrap superuser, so that the login restrictions of
+	 * the master's role don't apply to us; the GUC state restored below
+	 * installs the master's session user and role.
+	 */
+	BackgroundWorkerInitializeConnectionByOid(fps->database_id, InvalidOid);
+
+	StartTransactionCommand();
+
+	/*
+	 * Restore GUC values from the master before adopting its security
+	 * context, because some GUCs can't be set in a security-restricted
+	 * operation.
+	 */
+	gucspace = shm_toc_lookup(toc, PARALLEL_KEY_GUC);
+	Assert(gucspace != NULL);
+	RestoreGUCState(gucspace);
+	SetUserIdAndSecContext(fps->current_user_id, fps->sec_context);
+
+	/* Crank up a transaction state matching the master's. */
+	tstatespace = shm_toc_lookup(toc, PARALLEL_KEY_TRANSACTION_STATE);
+	Assert(tstatespace != NULL);
+	RestoreTransactionState(tstatespace);
+
+	/* Restore combo CID state. */
+	combocidspace = shm_toc_lookup(toc, PARALLEL_KEY_COMBO_CID);
+	Assert(combocidspace != NULL);
+	RestoreComboCIDState(combocidspace);
+
+	/* From now on, our transaction state must not change. */
+	EnterParallelMode();
+
+	/*
+	 * Any catalog snapshot taken while connecting predates the state we just
+	 * restored, and would hide the master's uncommitted catalog changes.
+	 */
+	InvalidateCatalogSnapshot();
+
+	/*
+	 * Adopt the master's active snapshot as our transaction snapshot too;
+	 * this also advertises its xmin, which the master's own xmin protects
+	 * until we have done so.
+	 */
+	asnapspace = shm_toc_lookup(toc, PARALLEL_KEY_ACTIVE_SNAPSHOT);
+	Assert(asnapspace != NULL);
+	snapshot = RestoreSnapshot(asnapspace);
+	RestoreTransactionSnapshot(snapshot, fps->parallel_master_pgproc);
+	PushActiveSnapshot(snapshot);
+
+	/*
+	 * Time to do the real work.  If it fails, leave the error where the
+	 * master can find it before exiting the way any background worker does.
+	 */
+	workercontext = CurrentMemoryContext;
+	PG_TRY();
+	{
+		fps->entrypoint(seg, toc);
+	}
+	PG_CATCH();
+	{
+		ErrorData  *edata;
+
+		MemoryContextSwitchTo(workercontext);
+		edata = CopyErrorData();
+
+		SpinLockAcquire(&fps->mutex);
+		if (!fps->error_reported)
+		{
+			fps->error_reported = true;
+			fps->error_sqlerrcode = edata->sqlerrcode;
+			strlcpy(fps->error_message,
+					edata->message ? edata->message : "",
+					PARALLEL_ERROR_MSGLEN);
+			strlcpy(fps->error_detail,
+					edata->detail ? edata->detail : "",
+					PARALLEL_ERROR_MSGLEN);
+			strlcpy(fps->error_hint,
+					edata->hint ? edata->hint : "",
+					PARALLEL_ERROR_MSGLEN);
+		}
+		SpinLockRelease(&fps->mutex);
+
+		PG_RE_THROW();
+	}
+	PG_END_TRY();
+
+	PopActiveSnapshot();
+	CommitTransactionCommand();
+
+	SpinLockAcquire(&fps->mutex);
+	fps->nworkers_finished++;
+	SpinLockRelease(&fps->mutex);
+
+	dsm_detach(seg);
+}
@@ -22,6 +22,7 @@
 
 #include "access/commit_ts.h"
 #include "access/multixact.h"
+#include "access/parallel.h"
 #include "access/subtrans.h"
 #include "access/transam.h"
 #include "access/twophase.h"
@@ -51,6 +52,7 @@
 #include "storage/smgr.h"
 #include "utils/catcache.h"
 #include "utils/combocid.h"
+#include "utils/builtins.h"
 #include "utils/guc.h"
 #include "utils/inval.h"
 #include "utils/memutils.h"
@@ -152,6 +154,7 @@ typedef struct TransactionStateData
 	bool		prevXactReadOnly;		/* entry-time xact r/o state */
 	bool		startedInRecovery;		/* did we start in recovery? */
 	bool		didLogXid;		/* has xid been included in WAL record? */
+	int			parallelModeLevel;		/* Enter/ExitParallelMode counter */
 	struct TransactionStateData *parent;		/* back link to parent */
 } TransactionStateData;
 
@@ -182,6 +185,7 @@ static TransactionStateData TopTransactionStateData = {
 	false,						/* entry-time xact r/o state */
 	false,						/* startedInRecovery */
 	false,						/* didLogXid */
+	0,							/* parallelModeLevel */
 	NULL						/* link to parent state block */
 };
 
@@ -202,6 +206,28 @@ static SubTransactionId currentSubTransactionId;
 static CommandId currentCommandId;
 static bool currentCommandIdUsed;
 
+/*
+ * In a parallel worker, the XIDs the master backend considers current are
+ * kept here, sorted, so that TransactionIdIsCurrentTransactionId gives the
+ * same answers in the worker as in the master.  nParallelCurrentXids is zero
+ * except while a parallel worker's transaction is running.
+ */
+static int	nParallelCurrentXids = 0;
+static TransactionId *ParallelCurrentXids;
+
+/*
+ * Layout of the transaction state built by SerializeTransactionState.
+ */
+typedef struct SerializedTransactionState
+{
+	CommandId	currentCommandId;
+	int			nParallelCurrentXids;
+	TransactionId parallelCurrentXids[FLEXIBLE_ARRAY_MEMBER];
+} SerializedTransactionState;
+
+#define SerializedTransactionStateHeaderSize \
+	offsetof(SerializedTransactionState, parallelCurrentXids)
+
 /*
  * xactStartTimestamp is the value of transaction_timestamp().
  * stmtStartTimestamp is the value of statement_timestamp().
@@ -459,6 +485,13 @@ AssignTransactionId(TransactionState s)
 	Assert(!TransactionIdIsValid(s->transactionId));
 	Assert(s->state == TRANS_INPROGRESS);
 
+	/*
+	 * Workers synchronize transaction state at the beginning of the parallel
+	 * operation, so we can't account for new XIDs after that point.
+	 */
+	if (IsInParallelMode() || IsParallelWorker())
+		elog(ERROR, "cannot assign TransactionIds during a parallel operation");
+
 	/*
 	 * Ensure parent(s) have XIDs, so that a child always has an XID later
 	 * than its parent.  Musn't recurse here, or we might get a stack overflow
@@ -642,10 +675,60 @@ GetCurrentCommandId(bool used)
 {
 	/* this is global to a transaction, not subtransaction-local */
 	if (used)
+	{
+		/*
+		 * Workers borrow the master's command ID, and the master can't start
+		 * using it either while they depend on it staying unused.
+		 */
+		if (IsInParallelMode() || IsParallelWorker())
+			elog(ERROR, "cannot modify data during a parallel operation");
 		currentCommandIdUsed = true;
+	}
 	return currentCommandId;
 }
 
+/*
+ *	EnterParallelMode
+ *
+ * Parallel mode lasts while workers may be running with a copy of our
+ * transaction state.  That copy can't be updated, so while in parallel mode
+ * we refuse anything that would change it: assigning XIDs, creating combo
+ * CIDs, writing tuples or starting a new command.  Calls nest; a
+ * subtransaction starts at its parent's level, and leaves with the parent's
+ * level unaffected.
+ */
+void
+EnterParallelMode(void)
+{
+	TransactionState s = CurrentTransactionState;
+
+	Assert(s->parallelModeLevel >= 0);
+
+	++s->parallelModeLevel;
+}
+
+/*
+ *	ExitParallelMode
+ */
+void
+ExitParallelMode(void)
+{
+	TransactionState s = CurrentTransactionState;
+
+	Assert(s->parallelModeLevel > 0);
+
+	--s->parallelModeLevel;
+}
+
+/*
+ *	IsInParallelMode
+ */
+bool
+IsInParallelMode(void)
+{
+	return CurrentTransactionState->parallelModeLevel != 0;
+}
+
 /*
  *	GetCurrentTransactionStartTimestamp
  */
@@ -735,6 +818,36 @@ TransactionIdIsCurrentTransactionId(TransactionId xid)
 	if (!TransactionIdIsNormal(xid))
 		return false;
 
+	/*
+	 * In a parallel worker, the XIDs we must consider as current are stored
+	 * in ParallelCurrentXids rather than the transaction-state stack.  Note
+	 * that the XIDs in this array are sorted numerically rather than
+	 * according to transactionIdPrecedes order.
+	 */
+	if (nParallelCurrentXids > 0)
+	{
+		int			low,
+					high;
+
+		low = 0;
+		high = nParallelCurrentXids - 1;
+		while (low <= high)
+		{
+			int			middle;
+			TransactionId probe;
+
+			middle = low + (high - low) / 2;
+			probe = ParallelCurrentXids[middle];
+			if (probe == xid)
+				return true;
+			else if (probe < xid)
+				low = middle + 1;
+			else
+				high = middle - 1;
+		}
+		return false;
+	}
+
 	/*
 	 * We will return true for the Xid of the current subtransaction, any of
 	 * its subcommitted children, any of its parents, or any of their
@@ -802,6 +915,14 @@ CommandCounterIncrement(void)
 	 */
 	if (currentCommandIdUsed)
 	{
+		/*
+		 * Workers synchronize transaction state at the beginning of each
+		 * parallel operation, so we can't account for new commands after that
+		 * point.
+		 */
+		if (IsInParallelMode() || IsParallelWorker())
+			elog(ERROR, "cannot start commands during a parallel operation");
+
 		currentCommandId += 1;
 		if (currentCommandId == InvalidCommandId)
 		{
@@ -825,6 +946,108 @@ CommandCounterIncrement(void)
 	}
 }
 
+/*
+ * EstimateTransactionStateSpace
+ *		Estimate the amount of space that will be needed by
+ *		SerializeTransactionState.
+ */
+Size
+EstimateTransactionStateSpace(void)
+{
+	TransactionState s;
+	Size		nxids = 0;
+
+	for (s = CurrentTransactionState; s != NULL; s = s->parent)
+	{
+		if (s->state == TRANS_ABORT)
+			continue;
+		if (TransactionIdIsValid(s->transactionId))
+			nxids = add_size(nxids, 1);
+		nxids = add_size(nxids, s->nChildXids);
+	}
+
+	return add_size(SerializedTransactionStateHeaderSize,
+					mul_size(sizeof(TransactionId), nxids));
+}
+
+/*
+ * SerializeTransactionState
+ *		Write out relevant details of our transaction state that will be
+ *		needed by a parallel worker.
+ *
+ * We need to save the current command ID and every XID that
+ * TransactionIdIsCurrentTransactionId would accept, so that the worker
+ * judges tuple visibility the same way we do.  The XIDs are sorted so that
+ * the worker can binary-search them.
+ */
+void
+SerializeTransactionState(Size maxsize, char *start_address)
+{
+	SerializedTransactionState *result;
+	TransactionState s;
+	int			nxids = 0;
+
+	result = (SerializedTransactionState *) start_address;
+	result->currentCommandId = currentCommandId;
+
+	for (s = CurrentTransactionState; s != NULL; s = s->parent)
+	{
+		if (s->state == TRANS_ABORT)
+			continue;
+		if (TransactionIdIsValid(s->transactionId))
+			nxids++;
+		nxids += s->nChildXids;
+	}
+	if (SerializedTransactionStateHeaderSize +
+		nxids * sizeof(TransactionId) > maxsize)
+		elog(ERROR, "not enough space to serialize transaction state");
+
+	nxids = 0;
+	for (s = CurrentTransactionState; s != NULL; s = s->parent)
+	{
+		if (s->state == TRANS_ABORT)
+			continue;
+		if (TransactionIdIsValid(s->transactionId))
+			result->parallelCurrentXids[nxids++] = s->transactionId;
+		memcpy(&result->parallelCurrentXids[nxids], s->childXids,
+			   s->nChildXids * sizeof(TransactionId));
+		nxids += s->nChildXids;
+	}
+	qsort(result->parallelCurrentXids, nxids, sizeof(TransactionId),
+		  xidComparator);
+	result->nParallelCurrentXids = nxids;
+}
+
+/*
+ * RestoreTransactionState
+ *		Adopt the transaction state serialized by the master backend.
+ *
+ * This must be called in a parallel worker, inside a freshly started
+ * transaction that has not yet been assigned an XID.
+ */
+void
+RestoreTransactionState(char *tstatespace)
+{
+	SerializedTransactionState *tstate;
+
+	Assert(IsParallelWorker());
+	Assert(!TransactionIdIsValid(CurrentTransactionState->transactionId));
+
+	tstate = (SerializedTransactionState *) tstatespace;
+	currentCommandId = tstate->currentCommandId;
+	currentCommandIdUsed = false;
+
+	if (tstate->nParallelCurrentXids > 0)
+	{
+		ParallelCurrentXids = (TransactionId *)
+			MemoryContextAlloc(TopTransactionContext,
+						 tstate->nParallelCurrentXids * sizeof(TransactionId));
+		memcpy(ParallelCurrentXids, tstate->parallelCurrentXids,
+			   tstate->nParallelCurrentXids * sizeof(TransactionId));
+	}
+	nParallelCurrentXids = tstate->nParallelCurrentXids;
+}
+
 /*
  * ForceSyncCommit
  *
@@ -1749,6 +1972,8 @@ StartTransaction(void)
 	currentSubTransactionId = TopSubTransactionId;
 	currentCommandId = FirstCommandId;
 	currentCommandIdUsed = false;
+	nParallelCurrentXids = 0;
+	s->parallelModeLevel = 0;
 
 	/*
 	 * initialize reported xid accounting
@@ -1888,6 +2113,9 @@ CommitTransaction(void)
 	/* close large objects before lower-level cleanup */
 	AtEOXact_LargeObject(true);
 
+	/* shut down any parallel workers the executor failed to clean up */
+	AtEOXact_Parallel(true);
+
 	/*
 	 * Mark serializable transaction as complete for predicate locking
 	 * purposes.  This should be done as late as we can put it and still allow
@@ -1996,6 +2224,8 @@ CommitTransaction(void)
 	AtEOXact_SMgr();
 	AtEOXact_Files();
 	AtEOXact_ComboCid();
+	nParallelCurrentXids = 0;
+	s->parallelModeLevel = 0;
 	AtEOXact_HashTables(true);
 	AtEOXact_PgStat(true);
 	AtEOXact_Snapshot(true);
@@ -2093,6 +2323,9 @@ PrepareTransaction(void)
 	/* close large objects before lower-level cleanup */
 	AtEOXact_LargeObject(true);
 
+	/* shut down any parallel workers the executor failed to clean up */
+	AtEOXact_Parallel(true);
+
 	/*
 	 * Mark serializable transaction as complete for predicate locking
 	 * purposes.  This should be done as late as we can put it and still allow
@@ -2263,6 +2496,8 @@ PrepareTransaction(void)
 	AtEOXact_SMgr();
 	AtEOXact_Files();
 	AtEOXact_ComboCid();
+	nParallelCurrentXids = 0;
+	s->parallelModeLevel = 0;
 	AtEOXact_HashTables(true);
 	/* don't call AtEOXact_PgStat here; we fixed pgstat state above */
 	AtEOXact_Snapshot(true);
@@ -2379,6 +2614,8 @@ AbortTransaction(void)
 	AfterTriggerEndXact(false); /* 'false' means it's abort */
 	AtAbort_Portals();
 	AtEOXact_LargeObject(false);
+	AtEOXact_Parallel(false);
+	s->parallelModeLevel = 0;
 	AtAbort_Notify();
 	AtEOXact_RelationMap(false);
 	AtAbort_Twophase();
@@ -2430,6 +2667,7 @@ AbortTransaction(void)
 		AtEOXact_SMgr();
 		AtEOXact_Files();
 		AtEOXact_ComboCid();
+		nParallelCurrentXids = 0;
 		AtEOXact_HashTables(false);
 		AtEOXact_PgStat(false);
 		pgstat_report_xact_timestamp(0);
@@ -4183,6 +4421,7 @@ CommitSubTransaction(void)
 						s->parent->curTransactionOwner);
 	AtEOSubXact_LargeObject(true, s->subTransactionId,
 							s->parent->subTransactionId);
+	AtEOSubXact_Parallel(true, s->subTransactionId);
 	AtSubCommit_Notify();
 
 	CallSubXactCallbacks(SUBXACT_EVENT_COMMIT_SUB, s->subTransactionId,
@@ -4327,6 +4566,7 @@ AbortSubTransaction(void)
 						   s->parent->curTransactionOwner);
 		AtEOSubXact_LargeObject(false, s->subTransactionId,
 								s->parent->subTransactionId);
+		AtEOSubXact_Parallel(false, s->subTransactionId);
 		AtSubAbort_Notify();
 
 		/* Advertise the fact that we aborted in pg_clog. */
@@ -4455,6 +4695,7 @@ PushTransaction(void)
 	s->blockState = TBLOCK_SUBBEGIN;
 	GetUserIdAndSecContext(&s->prevUser, &s->prevSecContext);
 	s->prevXactReadOnly = XactReadOnly;
+	s->parallelModeLevel = p->parallelModeLevel;
 
 	CurrentTransactionState = s;
 
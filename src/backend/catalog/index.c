@@ -36,6 +36,7 @@
 #include "catalog/heap.h"
 #include "catalog/index.h"
 #include "catalog/objectaccess.h"
+#include "catalog/pg_am.h"
 #include "catalog/pg_collation.h"
 #include "catalog/pg_constraint.h"
 #include "catalog/pg_operator.h"
@@ -51,6 +52,7 @@
 #include "nodes/makefuncs.h"
 #include "nodes/nodeFuncs.h"
 #include "optimizer/clauses.h"
+#include "optimizer/planner.h"
 #include "parser/parser.h"
 #include "storage/bufmgr.h"
 #include "storage/lmgr.h"
@@ -105,6 +107,15 @@ static void UpdateIndexRelation(Oid indexoid, Oid heapoid,
 static void index_update_stats(Relation rel,
 				   bool hasindex, bool isprimary,
 				   double reltuples);
+static double IndexBuildHeapScanInternal(Relation heapRelation,
+						   Relation indexRelation,
+						   IndexInfo *indexInfo,
+						   bool allow_sync,
+						   BlockNumber start_blockno,
+						   BlockNumber numblocks,
+						   ParallelHeapScanDesc pscan,
+						   IndexBuildCallback callback,
+						   void *callback_state);
 static void IndexCheckExclusion(Relation heapRelation,
 					Relation indexRelation,
 					IndexInfo *indexInfo);
@@ -1659,6 +1670,11 @@ BuildIndexInfo(Relation index)
 		ii->ii_ExclusionStrats = NULL;
 	}
 
+	/* speculative insertion info is filled in separately, if needed */
+	ii->ii_UniqueOps = NULL;
+	ii->ii_UniqueProcs = NULL;
+	ii->ii_UniqueStrats = NULL;
+
 	/* other info */
 	ii->ii_Unique = indexStruct->indisunique;
 	ii->ii_ReadyForInserts = IndexIsReady(indexStruct);
@@ -1666,10 +1682,62 @@ BuildIndexInfo(Relation index)
 	/* initialize index-build state to default */
 	ii->ii_Concurrent = false;
 	ii->ii_BrokenHotChain = false;
+	ii->ii_ParallelWorkers = 0;
 
 	return ii;
 }
 
+/* ----------------
+ *		BuildSpeculativeIndexInfo
+ *			Add extra state to IndexInfo record
+ *
+ * For unique indexes, we usually don't want to add info to the IndexInfo for
+ * checking uniqueness, since the B-Tree AM handles that directly.  However,
+ * in the case of speculative insertion, additional support is required.
+ *
+ * Do this processing here rather than in BuildIndexInfo() to not incur the
+ * overhead in the common non-speculative cases.
+ * ----------------
+ */
+void
+BuildSpeculativeIndexInfo(Relation index, IndexInfo *ii)
+{
+	int			ncols = index->rd_rel->relnatts;
+	int			i;
+
+	/*
+	 * fetch info for checking unique indexes
+	 */
+	Assert(ii->ii_Unique);
+
+	if (index->rd_rel->relam != BTREE_AM_OID)
+		elog(ERROR, "unexpected non-btree speculative unique index");
+
+	ii->ii_UniqueOps = (Oid *) palloc(sizeof(Oid) * ncols);
+	ii->ii_UniqueProcs = (Oid *) palloc(sizeof(Oid) * ncols);
+	ii->ii_UniqueStrats = (uint16 *) palloc(sizeof(uint16) * ncols);
+
+	/*
+	 * We have to look up the operator's strategy number.  This provides a
+	 * cross-check that the operator does match the index.
+	 */
+	/* We need the func OIDs and strategy numbers too */
+	for (i = 0; i < ncols; i++)
+	{
+		ii->ii_UniqueStrats[i] = BTEqualStrategyNumber;
+		ii->ii_UniqueOps[i] =
+			get_opfamily_member(index->rd_opfamily[i],
+								index->rd_opcintype[i],
+								index->rd_opcintype[i],
+								ii->ii_UniqueStrats[i]);
+		if (!OidIsValid(ii->ii_UniqueOps[i]))
+			elog(ERROR, "missing operator %d(%u,%u) in opfamily %u",
+				 ii->ii_UniqueStrats[i], index->rd_opcintype[i],
+				 index->rd_opcintype[i], index->rd_opfamily[i]);
+		ii->ii_UniqueProcs[i] = get_opcode(ii->ii_UniqueOps[i]);
+	}
+}
+
 /* ----------------
  *		FormIndexDatum
  *			Construct values[] and isnull[] arrays for a new index tuple.
@@ -1866,7 +1934,7 @@ index_update_stats(Relation rel,
 		BlockNumber relallvisible;
 
 		if (rd_rel->relkind != RELKIND_INDEX)
-			relallvisible = visibilitymap_count(rel);
+			visibilitymap_count(rel, &relallvisible, NULL);
 		else	/* don't bother for indexes */
 			relallvisible = 0;
 
@@ -1948,10 +2016,26 @@ index_build(Relation heapRelation,
 	procedure = indexRelation->rd_am->ambuild;
 	Assert(RegProcedureIsValid(procedure));
 
-	ereport(DEBUG1,
-			(errmsg("building index \"%s\" on table \"%s\"",
-					RelationGetRelationName(indexRelation),
-					RelationGetRelationName(heapRelation))));
+	/*
+	 * Only btree builds can be divided among parallel workers, and only
+	 * ordinary ones; a concurrent build must see just what its snapshot does.
+	 */
+	if (indexRelation->rd_rel->relam == BTREE_AM_OID &&
+		!indexInfo->ii_Concurrent)
+		indexInfo->ii_ParallelWorkers =
+			plan_create_index_workers(heapRelation, indexRelation);
+
+	if (indexInfo->ii_ParallelWorkers == 0)
+		ereport(DEBUG1,
+				(errmsg("building index \"%s\" on table \"%s\"",
+						RelationGetRelationName(indexRelation),
+						RelationGetRelationName(heapRelation))));
+	else
+		ereport(DEBUG1,
+				(errmsg("building index \"%s\" on table \"%s\" with request for %d parallel workers",
+						RelationGetRelationName(indexRelation),
+						RelationGetRelationName(heapRelation),
+						indexInfo->ii_ParallelWorkers)));
 
 	/*
 	 * Switch to the table owner's userid, so that any index functions are run
@@ -2124,6 +2208,47 @@ IndexBuildHeapRangeScan(Relation heapRelation,
 						BlockNumber numblocks,
 						IndexBuildCallback callback,
 						void *callback_state)
+{
+	return IndexBuildHeapScanInternal(heapRelation, indexRelation,
+									  indexInfo, allow_sync,
+									  start_blockno, numblocks, NULL,
+									  callback, callback_state);
+}
+
+/*
+ * As IndexBuildHeapScan, except that the heap is scanned as part of the
+ * parallel heap scan 'pscan': only the blocks this backend claims from it
+ * are visited, and the other participants index the rest.  The count
+ * returned, and indexInfo->ii_BrokenHotChain, cover only our blocks.
+ *
+ * This is only for ordinary (not concurrent) builds.
+ */
+double
+IndexBuildHeapParallelScan(Relation heapRelation,
+						   Relation indexRelation,
+						   IndexInfo *indexInfo,
+						   ParallelHeapScanDesc pscan,
+						   IndexBuildCallback callback,
+						   void *callback_state)
+{
+	Assert(!indexInfo->ii_Concurrent);
+
+	return IndexBuildHeapScanInternal(heapRelation, indexRelation,
+									  indexInfo, false,
+									  0, InvalidBlockNumber, pscan,
+									  callback, callback_state);
+}
+
+static double
+IndexBuildHeapScanInternal(Relation heapRelation,
+						   Relation indexRelation,
+						   IndexInfo *indexInfo,
+						   bool allow_sync,
+						   BlockNumber start_blockno,
+						   BlockNumber numblocks,
+						   ParallelHeapScanDesc pscan,
+						   IndexBuildCallback callback,
+						   void *callback_state)
 {
 	bool		is_system_catalog;
 	bool		checking_uniqueness;
@@ -2188,15 +2313,20 @@ IndexBuildHeapRangeScan(Relation heapRelation,
 		OldestXmin = GetOldestXmin(heapRelation, true);
 	}
 
-	scan = heap_beginscan_strat(heapRelation,	/* relation */
-								snapshot,		/* snapshot */
-								0,		/* number of keys */
-								NULL,	/* scan key */
-								true,	/* buffer access strategy OK */
-								allow_sync);	/* syncscan OK? */
-
-	/* set our scan endpoints */
-	heap_setscanlimits(scan, start_blockno, numblocks);
+	if (pscan != NULL)
+		scan = heap_beginscan_parallel(heapRelation, snapshot, pscan);
+	else
+	{
+		scan = heap_beginscan_strat(heapRelation,	/* relation */
+									snapshot,	/* snapshot */
+									0,	/* number of keys */
+									NULL,		/* scan key */
+									true,		/* buffer access strategy OK */
+									allow_sync);		/* syncscan OK? */
+
+		/* set our scan endpoints */
+		heap_setscanlimits(scan, start_blockno, numblocks);
+	}
 
 	reltuples = 0;
 
@@ -2609,7 +2739,7 @@ IndexCheckExclusion(Relation heapRelation,
 		check_exclusion_constraint(heapRelation,
 								   indexRelation, indexInfo,
 								   &(heapTuple->t_self), values, isnull,
-								   estate, true, false);
+								   estate, true);
 	}
 
 	heap_endscan(scan);
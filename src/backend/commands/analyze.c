@@ -43,6 +43,7 @@
 #include "storage/lmgr.h"
 #include "storage/proc.h"
 #include "storage/procarray.h"
+#include "storage/readstream.h"
 #include "utils/acl.h"
 #include "utils/attoptcache.h"
 #include "utils/datum.h"
@@ -92,6 +93,8 @@ static void BlockSampler_Init(BlockSampler bs, BlockNumber nblocks,
 				  int samplesize);
 static bool BlockSampler_HasMore(BlockSampler bs);
 static BlockNumber BlockSampler_Next(BlockSampler bs);
+static BlockNumber acquire_sample_next_block(void *callback_private,
+						  void *per_block_data);
 static void compute_index_stats(Relation onerel, double totalrows,
 					AnlIndexData *indexdata, int nindexes,
 					HeapTuple *rows, int numrows,
@@ -581,14 +584,20 @@ do_analyze_rel(Relation onerel, VacuumStmt *vacstmt,
 	 * inherited stats.
 	 */
 	if (!inh)
+	{
+		BlockNumber relallvisible;
+
+		visibilitymap_count(onerel, &relallvisible, NULL);
+
 		vac_update_relstats(onerel,
 							relpages,
 							totalrows,
-							visibilitymap_count(onerel),
+							relallvisible,
 							hasindex,
 							InvalidTransactionId,
 							InvalidMultiXactId,
 							in_outer_xact);
+	}
 
 	/*
 	 * Same for indexes. Vacuum always scans all indexes, so if we're part of
@@ -1034,6 +1043,21 @@ BlockSampler_Next(BlockSampler bs)
 	return bs->t++;
 }
 
+/*
+ * acquire_sample_next_block -- read stream callback for acquire_sample_rows
+ *
+ * Hands out the blocks chosen by the block sampler.
+ */
+static BlockNumber
+acquire_sample_next_block(void *callback_private, void *per_block_data)
+{
+	BlockSampler bs = (BlockSampler) callback_private;
+
+	if (!BlockSampler_HasMore(bs))
+		return InvalidBlockNumber;
+	return BlockSampler_Next(bs);
+}
+
 /*
  * acquire_sample_rows -- acquire a random sample of rows from the table
  *
@@ -1081,6 +1105,8 @@ acquire_sample_rows(Relation onerel, int elevel,
 	TransactionId OldestXmin;
 	BlockSamplerData bs;
 	double		rstate;
+	ReadStream *stream;
+	Buffer		targbuffer;
 
 	Assert(targrows > 0);
 
@@ -1094,11 +1120,18 @@ acquire_sample_rows(Relation onerel, int elevel,
 	/* Prepare for sampling rows */
 	rstate = anl_init_selection_state(targrows);
 
+	/*
+	 * The sampled blocks are read through a read stream, which asks the
+	 * block sampler for them ahead of time so that it can prefetch them, and
+	 * combine the reads of neighbouring ones.
+	 */
+	stream = BeginReadStream(onerel, MAIN_FORKNUM, vac_strategy,
+							 acquire_sample_next_block, &bs, 0);
+
 	/* Outer loop over blocks to sample */
-	while (BlockSampler_HasMore(&bs))
+	while ((targbuffer = ReadStreamNextBuffer(stream, NULL)) != InvalidBuffer)
 	{
-		BlockNumber targblock = BlockSampler_Next(&bs);
-		Buffer		targbuffer;
+		BlockNumber targblock = BufferGetBlockNumber(targbuffer);
 		Page		targpage;
 		OffsetNumber targoffset,
 					maxoffset;
@@ -1108,14 +1141,12 @@ acquire_sample_rows(Relation onerel, int elevel,
 		/*
 		 * We must maintain a pin on the target page's buffer to ensure that
 		 * the maxoffset value stays good (else concurrent VACUUM might delete
-		 * tuples out from under us).  Hence, pin the page until we are done
-		 * looking at it.  We also choose to hold sharelock on the buffer
-		 * throughout --- we could release and re-acquire sharelock for each
-		 * tuple, but since we aren't doing much work per tuple, the extra
-		 * lock traffic is probably better avoided.
+		 * tuples out from under us).  Hence, keep the page pinned until we
+		 * are done looking at it.  We also choose to hold sharelock on the
+		 * buffer throughout --- we could release and re-acquire sharelock
+		 * for each tuple, but since we aren't doing much work per tuple, the
+		 * extra lock traffic is probably better avoided.
 		 */
-		targbuffer = ReadBufferExtended(onerel, MAIN_FORKNUM, targblock,
-										RBM_NORMAL, vac_strategy);
 		LockBuffer(targbuffer, BUFFER_LOCK_SHARE);
 		targpage = BufferGetPage(targbuffer);
 		maxoffset = PageGetMaxOffsetNumber(targpage);
@@ -1267,6 +1298,8 @@ acquire_sample_rows(Relation onerel, int elevel,
 		UnlockReleaseBuffer(targbuffer);
 	}
 
+	EndReadStream(stream);
+
 	/*
 	 * If we didn't find as many tuples as we wanted then we're done. No sort
 	 * is needed, since they're already in order.
@@ -172,7 +172,7 @@ unique_key_recheck(PG_FUNCTION_ARGS)
 		 */
 		check_exclusion_constraint(trigdata->tg_relation, indexRel, indexInfo,
 								   &(new_row->t_self), values, isnull,
-								   estate, false, false);
+								   estate, false);
 	}
 
 	/*
@@ -56,6 +56,7 @@
 #include "storage/smgr.h"
 #include "utils/acl.h"
 #include "utils/builtins.h"
+#include "utils/catcache.h"
 #include "utils/fmgroids.h"
 #include "utils/pg_locale.h"
 #include "utils/snapmgr.h"
@@ -894,6 +895,12 @@ dropdb(const char *dbname, bool missing_ok)
 	 */
 	DropDatabaseBuffers(db_id);
 
+	/*
+	 * Likewise for its catalog tuples in the shared catalog cache, which
+	 * could otherwise be served to a new database that gets the same OID.
+	 */
+	SharedCatCacheDropDatabase(db_id);
+
 	/*
 	 * Tell the stats collector to forget it immediately, too.
 	 */
@@ -2101,6 +2108,9 @@ dbase_redo(XLogReaderState *record)
 		/* Drop pages for this database that are in the shared buffer cache */
 		DropDatabaseBuffers(xlrec->db_id);
 
+		/* And its tuples in the shared catalog cache */
+		SharedCatCacheDropDatabase(xlrec->db_id);
+
 		/* Also, clean out any fsync requests that might be pending in md.c */
 		ForgetDatabaseFsyncRequests(xlrec->db_id);
 
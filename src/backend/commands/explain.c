@@ -21,6 +21,7 @@
 #include "commands/prepare.h"
 #include "executor/hashjoin.h"
 #include "foreign/fdwapi.h"
+#include "jit/jit.h"
 #include "nodes/nodeFuncs.h"
 #include "optimizer/clauses.h"
 #include "parser/parsetree.h"
@@ -82,6 +83,9 @@ static void show_merge_append_keys(MergeAppendState *mstate, List *ancestors,
 					   ExplainState *es);
 static void show_agg_keys(AggState *astate, List *ancestors,
 			  ExplainState *es);
+static void show_grouping_set_keys(PlanState *planstate, Agg *aggnode,
+					   Sort *sortnode, List *ancestors,
+			  ExplainState *es);
 static void show_group_keys(GroupState *gstate, List *ancestors,
 				ExplainState *es);
 static void show_sort_group_keys(PlanState *planstate, const char *qlabel,
@@ -92,6 +96,7 @@ static void show_sortorder_options(StringInfo buf, Node *sortexpr,
 					   Oid sortOperator, Oid collation, bool nullsFirst);
 static void show_sort_info(SortState *sortstate, ExplainState *es);
 static void show_hash_info(HashState *hashstate, ExplainState *es);
+static void show_hashagg_info(AggState *aggstate, ExplainState *es);
 static void show_tidbitmap_info(BitmapHeapScanState *planstate,
 					ExplainState *es);
 static void show_instrumentation_count(const char *qlabel, int which,
@@ -103,7 +108,8 @@ static void ExplainIndexScanDetails(Oid indexid, ScanDirection indexorderdir,
 static void ExplainScanTarget(Scan *plan, ExplainState *es);
 static void ExplainModifyTarget(ModifyTable *plan, ExplainState *es);
 static void ExplainTargetRel(Plan *plan, Index rti, ExplainState *es);
-static void show_modifytable_info(ModifyTableState *mtstate, ExplainState *es);
+static void show_modifytable_info(ModifyTableState *mtstate, List *ancestors,
+					  ExplainState *es);
 static void ExplainMemberNodes(List *plans, PlanState **planstates,
 				   List *ancestors, ExplainState *es);
 static void ExplainSubPlans(List *plans, List *ancestors,
@@ -337,7 +343,7 @@ ExplainOneQuery(Query *query, IntoClause *into, ExplainState *es,
 		INSTR_TIME_SET_CURRENT(planstart);
 
 		/* plan the query */
-		plan = pg_plan_query(query, 0, params);
+		plan = pg_plan_query(query, into ? 0 : CURSOR_OPT_PARALLEL_OK, params);
 
 		INSTR_TIME_SET_CURRENT(planduration);
 		INSTR_TIME_SUBTRACT(planduration, planstart);
@@ -518,6 +524,10 @@ ExplainOnePlan(PlannedStmt *plannedstmt, IntoClause *into, ExplainState *es,
 	if (es->analyze)
 		ExplainPrintTriggers(es, queryDesc);
 
+	/* Print info about JIT compilation, if any was done */
+	if (es->analyze)
+		ExplainPrintJIT(es, queryDesc);
+
 	/*
 	 * Close down the query and free resources.  Include time for this in the
 	 * total execution time (although it should be pretty minimal).
@@ -609,6 +619,96 @@ ExplainPrintTriggers(ExplainState *es, QueryDesc *queryDesc)
 	ExplainCloseGroup("Triggers", "Triggers", false, es);
 }
 
+/*
+ * ExplainPrintJIT -
+ *	  append information about JIT compilation done for a query to es->str
+ *
+ * Nothing is printed if the query wasn't JIT compiled.
+ */
+void
+ExplainPrintJIT(ExplainState *es, QueryDesc *queryDesc)
+{
+	JitContext *jc = queryDesc->estate->es_jit;
+	JitInstrumentation *ji;
+	instr_time	total_time;
+
+	if (jc == NULL)
+		return;
+
+	ji = &jc->instr;
+
+	INSTR_TIME_SET_ZERO(total_time);
+	INSTR_TIME_ADD(total_time, ji->generation_counter);
+	INSTR_TIME_ADD(total_time, ji->optimization_counter);
+	INSTR_TIME_ADD(total_time, ji->emission_counter);
+
+	ExplainOpenGroup("JIT", "JIT", true, es);
+
+	if (es->format == EXPLAIN_FORMAT_TEXT)
+	{
+		appendStringInfoString(es->str, "JIT:\n");
+		es->indent += 1;
+
+		appendStringInfoSpaces(es->str, es->indent * 2);
+		appendStringInfo(es->str, "Functions: %d\n", ji->created_functions);
+
+		appendStringInfoSpaces(es->str, es->indent * 2);
+		appendStringInfo(es->str, "Options: Optimization %s, Expressions %s, Deforming %s\n",
+						 (jc->flags & PGJIT_OPT3) ? "true" : "false",
+						 (jc->flags & PGJIT_EXPR) ? "true" : "false",
+						 (jc->flags & PGJIT_DEFORM) ? "true" : "false");
+
+		if (es->timing)
+		{
+			appendStringInfoSpaces(es->str, es->indent * 2);
+			appendStringInfo(es->str,
+							 "Timing: Generation %.3f ms, Optimization %.3f ms, Emission %.3f ms, Total %.3f ms\n",
+							 1000.0 * INSTR_TIME_GET_DOUBLE(ji->generation_counter),
+							 1000.0 * INSTR_TIME_GET_DOUBLE(ji->optimization_counter),
+							 1000.0 * INSTR_TIME_GET_DOUBLE(ji->emission_counter),
+							 1000.0 * INSTR_TIME_GET_DOUBLE(total_time));
+		}
+
+		es->indent -= 1;
+	}
+	else
+	{
+		ExplainPropertyInteger("Functions", ji->created_functions, es);
+
+		ExplainOpenGroup("Options", "Options", true, es);
+		ExplainProperty("Optimization",
+						(jc->flags & PGJIT_OPT3) ? "true" : "false",
+						true, es);
+		ExplainProperty("Expressions",
+						(jc->flags & PGJIT_EXPR) ? "true" : "false",
+						true, es);
+		ExplainProperty("Deforming",
+						(jc->flags & PGJIT_DEFORM) ? "true" : "false",
+						true, es);
+		ExplainCloseGroup("Options", "Options", true, es);
+
+		if (es->timing)
+		{
+			ExplainOpenGroup("Timing", "Timing", true, es);
+			ExplainPropertyFloat("Generation",
+						1000.0 * INSTR_TIME_GET_DOUBLE(ji->generation_counter),
+								 3, es);
+			ExplainPropertyFloat("Optimization",
+					  1000.0 * INSTR_TIME_GET_DOUBLE(ji->optimization_counter),
+								 3, es);
+			ExplainPropertyFloat("Emission",
+						  1000.0 * INSTR_TIME_GET_DOUBLE(ji->emission_counter),
+								 3, es);
+			ExplainPropertyFloat("Total",
+								 1000.0 * INSTR_TIME_GET_DOUBLE(total_time),
+								 3, es);
+			ExplainCloseGroup("Timing", "Timing", true, es);
+		}
+	}
+
+	ExplainCloseGroup("JIT", "JIT", true, es);
+}
+
 /*
  * ExplainQueryText -
  *	  add a "Query Text" node that contains the actual text of the query
@@ -739,6 +839,9 @@ ExplainPreScanNode(PlanState *planstate, Bitmapset **rels_used)
 			/* cf ExplainModifyTarget */
 			*rels_used = bms_add_member(*rels_used,
 					  linitial_int(((ModifyTable *) plan)->resultRelations));
+			if (((ModifyTable *) plan)->exclRelRTI)
+				*rels_used = bms_add_member(*rels_used,
+										((ModifyTable *) plan)->exclRelRTI);
 			break;
 		default:
 			break;
@@ -1019,6 +1122,9 @@ ExplainNode(PlanState *planstate, List *ancestors,
 		case T_Limit:
 			pname = sname = "Limit";
 			break;
+		case T_Gather:
+			pname = sname = "Gather";
+			break;
 		case T_Hash:
 			pname = sname = "Hash";
 			break;
@@ -1433,6 +1539,8 @@ ExplainNode(PlanState *planstate, List *ancestors,
 			if (plan->qual)
 				show_instrumentation_count("Rows Removed by Filter", 1,
 										   planstate, es);
+			if (es->analyze)
+				show_hashagg_info((AggState *) planstate, es);
 			break;
 		case T_Group:
 			show_group_keys((GroupState *) planstate, ancestors, es);
@@ -1458,11 +1566,19 @@ ExplainNode(PlanState *planstate, List *ancestors,
 										   planstate, es);
 			break;
 		case T_ModifyTable:
-			show_modifytable_info((ModifyTableState *) planstate, es);
+			show_modifytable_info((ModifyTableState *) planstate, ancestors,
+								  es);
 			break;
 		case T_Hash:
 			show_hash_info((HashState *) planstate, es);
 			break;
+		case T_Gather:
+			ExplainPropertyInteger("Workers Planned",
+								   ((Gather *) plan)->num_workers, es);
+			if (es->analyze)
+				ExplainPropertyInteger("Workers Launched",
+						((GatherState *) planstate)->nworkers_launched, es);
+			break;
 		default:
 			break;
 	}
@@ -1817,7 +1933,32 @@ show_agg_keys(AggState *astate, List *ancestors,
 {
 	Agg		   *plan = (Agg *) astate->ss.ps.plan;
 
-	if (plan->numCols > 0)
+	if (plan->groupingSets)
+	{
+		ListCell   *lc;
+
+		/*
+		 * Show the sets computed from the input order, then, for each
+		 * chained rollup, the order the input is re-sorted into and the sets
+		 * computed from that.  All the key columns refer to the tlist of the
+		 * child plan.
+		 */
+		ancestors = lcons(astate, ancestors);
+		ExplainOpenGroup("Grouping Sets", "Grouping Sets", false, es);
+		show_grouping_set_keys(outerPlanState(astate), plan, NULL,
+							   ancestors, es);
+		foreach(lc, plan->chain)
+		{
+			Agg		   *aggnode = (Agg *) lfirst(lc);
+
+			show_grouping_set_keys(outerPlanState(astate), aggnode,
+								   (Sort *) aggnode->plan.lefttree,
+								   ancestors, es);
+		}
+		ExplainCloseGroup("Grouping Sets", "Grouping Sets", false, es);
+		ancestors = list_delete_first(ancestors);
+	}
+	else if (plan->numCols > 0)
 	{
 		/* The key columns refer to the tlist of the child plan */
 		ancestors = lcons(astate, ancestors);
@@ -1829,6 +1970,77 @@ show_agg_keys(AggState *astate, List *ancestors,
 	}
 }
 
+/*
+ * Show one phase of an Agg node with grouping sets: the sort order of its
+ * input, unless it's the first phase, and the sets it computes.  Each set is
+ * a prefix of the Agg's grouping columns.
+ */
+static void
+show_grouping_set_keys(PlanState *planstate, Agg *aggnode, Sort *sortnode,
+					   List *ancestors, ExplainState *es)
+{
+	Plan	   *plan = planstate->plan;
+	List	   *context;
+	List	   *result = NIL;
+	StringInfoData setbuf;
+	bool		useprefix;
+	ListCell   *lc;
+
+	ExplainOpenGroup("Grouping Set", NULL, true, es);
+
+	if (sortnode)
+	{
+		show_sort_group_keys(planstate, "Sort Key",
+							 sortnode->numCols, sortnode->sortColIdx,
+							 sortnode->sortOperators, sortnode->collations,
+							 sortnode->nullsFirst,
+							 ancestors, es);
+		if (es->format == EXPLAIN_FORMAT_TEXT)
+			es->indent++;
+	}
+
+	initStringInfo(&setbuf);
+
+	/* Set up deparsing context */
+	context = set_deparse_context_planstate(es->deparse_cxt,
+											(Node *) planstate,
+											ancestors);
+	useprefix = (list_length(es->rtable) > 1 || es->verbose);
+
+	foreach(lc, aggnode->groupingSets)
+	{
+		int			nkeys = list_length((List *) lfirst(lc));
+		int			keyno;
+
+		resetStringInfo(&setbuf);
+		appendStringInfoChar(&setbuf, '(');
+		for (keyno = 0; keyno < nkeys; keyno++)
+		{
+			AttrNumber	keyresno = aggnode->grpColIdx[keyno];
+			TargetEntry *target = get_tle_by_resno(plan->targetlist,
+												   keyresno);
+
+			if (!target)
+				elog(ERROR, "no tlist entry for key %d", keyresno);
+			if (keyno > 0)
+				appendStringInfoString(&setbuf, ", ");
+			appendStringInfoString(&setbuf,
+								   deparse_expression((Node *) target->expr,
+													  context,
+													  useprefix, true));
+		}
+		appendStringInfoChar(&setbuf, ')');
+		result = lappend(result, pstrdup(setbuf.data));
+	}
+
+	ExplainPropertyList("Group Keys", result, es);
+
+	if (sortnode && es->format == EXPLAIN_FORMAT_TEXT)
+		es->indent--;
+
+	ExplainCloseGroup("Grouping Set", NULL, true, es);
+}
+
 /*
  * Show the grouping keys for a Group node.
  */
@@ -2042,6 +2254,22 @@ show_hash_info(HashState *hashstate, ExplainState *es)
 	}
 }
 
+/*
+ * Show the number of batches used by a hashed Agg node that spilled to disk
+ */
+static void
+show_hashagg_info(AggState *aggstate, ExplainState *es)
+{
+	Agg		   *agg = (Agg *) aggstate->ss.ps.plan;
+
+	if (agg->aggstrategy != AGG_HASHED || aggstate->hash_batches_used == 0)
+		return;
+
+	/* count the initial pass over the input as a batch, too */
+	ExplainPropertyInteger("Hash Batches", aggstate->hash_batches_used + 1,
+						   es);
+}
+
 /*
  * If it's EXPLAIN ANALYZE, show exact/lossy pages for a BitmapHeapScan node
  */
@@ -2315,8 +2543,10 @@ ExplainTargetRel(Plan *plan, Index rti, ExplainState *es)
  * Show extra information for a ModifyTable node
  */
 static void
-show_modifytable_info(ModifyTableState *mtstate, ExplainState *es)
+show_modifytable_info(ModifyTableState *mtstate, List *ancestors,
+					  ExplainState *es)
 {
+	ModifyTable *node = (ModifyTable *) mtstate->ps.plan;
 	FdwRoutine *fdwroutine = mtstate->resultRelInfo->ri_FdwRoutine;
 
 	/*
@@ -2328,7 +2558,6 @@ show_modifytable_info(ModifyTableState *mtstate, ExplainState *es)
 	if (fdwroutine != NULL &&
 		fdwroutine->ExplainForeignModify != NULL)
 	{
-		ModifyTable *node = (ModifyTable *) mtstate->ps.plan;
 		List	   *fdw_private = (List *) linitial(node->fdwPrivLists);
 
 		fdwroutine->ExplainForeignModify(mtstate,
@@ -2337,6 +2566,54 @@ show_modifytable_info(ModifyTableState *mtstate, ExplainState *es)
 										 0,
 										 es);
 	}
+
+	/* Show ON CONFLICT details, if any */
+	if (node->onConflictAction != ONCONFLICT_NONE)
+	{
+		List	   *idxNames = NIL;
+		ListCell   *lst;
+
+		ExplainPropertyText("Conflict Resolution",
+							node->onConflictAction == ONCONFLICT_NOTHING ?
+							"NOTHING" : "UPDATE",
+							es);
+
+		/*
+		 * Don't display arbiter indexes at all when DO NOTHING variant
+		 * implicitly ignores all conflicts
+		 */
+		foreach(lst, node->arbiterIndexes)
+			idxNames = lappend(idxNames, get_rel_name(lfirst_oid(lst)));
+		if (idxNames)
+			ExplainPropertyList("Conflict Arbiter Indexes", idxNames, es);
+
+		/* ON CONFLICT DO UPDATE WHERE qual is specially displayed */
+		if (node->onConflictWhere)
+		{
+			show_upper_qual((List *) node->onConflictWhere, "Conflict Filter",
+							&mtstate->ps, ancestors, es);
+			show_instrumentation_count("Rows Removed by Conflict Filter", 1,
+									   &mtstate->ps, es);
+		}
+
+		/* EXPLAIN ANALYZE display of actual outcome for each tuple proposed */
+		if (es->analyze && mtstate->ps.instrument)
+		{
+			double		total;
+			double		insert_path;
+			double		other_path;
+
+			InstrEndLoop(mtstate->mt_plans[0]->instrument);
+
+			/* count the number of source rows */
+			total = mtstate->mt_plans[0]->instrument->ntuples;
+			other_path = mtstate->ps.instrument->nfiltered2;
+			insert_path = total - other_path;
+
+			ExplainPropertyFloat("Tuples Inserted", insert_path, 0, es);
+			ExplainPropertyFloat("Conflicting Tuples", other_path, 0, es);
+		}
+	}
 }
 
 /*
@@ -4,24 +4,30 @@
  *	  Concurrent ("lazy") vacuuming.
  *
  *
- * The major space usage for LAZY VACUUM is storage for the array of dead
- * tuple TIDs, with the next biggest need being storage for per-disk-page
- * free space info.  We want to ensure we can vacuum even the very largest
- * relations with finite memory space usage.  To do that, we set upper bounds
- * on the number of tuples and pages we will keep track of at once.
+ * The major space usage for LAZY VACUUM is storage for the dead tuple TIDs,
+ * with the next biggest need being storage for per-disk-page free space
+ * info.  We want to ensure we can vacuum even the very largest relations
+ * with finite memory space usage.  To do that, we set upper bounds on the
+ * number of tuples and pages we will keep track of at once.
  *
  * We are willing to use at most maintenance_work_mem (or perhaps
  * autovacuum_work_mem) memory space to keep track of dead tuples.  We
- * initially allocate an array of TIDs of that size, with an upper limit that
- * depends on table size (this limit ensures we don't allocate a huge area
- * uselessly for vacuuming small tables).  If the array threatens to overflow,
- * we suspend the heap scan phase and perform a pass of index cleanup and page
- * compaction, then resume the heap scan with an empty TID array.
+ * initially allocate a TID store (see access/common/tidstore.c) of that size,
+ * with an upper limit that depends on table size (this limit ensures we don't
+ * allocate a huge area uselessly for vacuuming small tables).  If the store
+ * threatens to overflow, we suspend the heap scan phase and perform a pass of
+ * index cleanup and page compaction, then resume the heap scan with an empty
+ * store.
  *
  * If we're processing a table with no indexes, we can just vacuum each page
  * as we go; there's no need to save up multiple tuples to minimize the number
  * of index scans performed.  So we don't use maintenance_work_mem memory for
- * the TID array, just enough to hold as many heap tuples as fit on one page.
+ * the TID store, just enough to hold the dead tuples of one page.
+ *
+ * If the table has several sizable indexes, each pass of index vacuuming can
+ * be shared with dynamic background workers; the TID store is then put in a
+ * dynamic shared memory segment, where the workers can see it.  See
+ * lazy_parallel_vacuum_indexes.
  *
  *
  * Portions Copyright (c) 1996-2015, PostgreSQL Global Development Group
@@ -42,8 +48,10 @@
 #include "access/heapam_xlog.h"
 #include "access/htup_details.h"
 #include "access/multixact.h"
+#include "access/tidstore.h"
 #include "access/transam.h"
 #include "access/visibilitymap.h"
+#include "access/xact.h"
 #include "access/xlog.h"
 #include "catalog/catalog.h"
 #include "catalog/storage.h"
@@ -53,12 +61,22 @@
 #include "pgstat.h"
 #include "portability/instr_time.h"
 #include "postmaster/autovacuum.h"
+#include "postmaster/bgworker.h"
 #include "storage/bufmgr.h"
+#include "storage/dsm.h"
 #include "storage/freespace.h"
 #include "storage/lmgr.h"
+#include "storage/proc.h"
+#include "storage/procsignal.h"
+#include "storage/readstream.h"
+#include "storage/shm_toc.h"
+#include "storage/spin.h"
+#include "tcop/tcopprot.h"
+#include "utils/guc.h"
 #include "utils/lsyscache.h"
 #include "utils/memutils.h"
 #include "utils/pg_rusage.h"
+#include "utils/resowner.h"
 #include "utils/timestamp.h"
 #include "utils/tqual.h"
 
@@ -84,19 +102,63 @@
 #define VACUUM_TRUNCATE_LOCK_WAIT_INTERVAL		50		/* ms */
 #define VACUUM_TRUNCATE_LOCK_TIMEOUT			5000	/* ms */
 
-/*
- * Guesstimation of number of dead tuples per page.  This is used to
- * provide an upper limit to memory allocated when vacuuming small
- * tables.
- */
-#define LAZY_ALLOC_TUPLES		MaxHeapTuplesPerPage
-
 /*
  * Before we consider skipping a page that's marked as clean in
  * visibility map, we must've seen at least this many clean pages.
  */
 #define SKIP_PAGES_THRESHOLD	((BlockNumber) 32)
 
+/*
+ * Indexes smaller than this aren't worth launching a parallel worker for;
+ * we only use workers if at least two indexes are at least this big.
+ */
+#define PARALLEL_VACUUM_MIN_INDEX_PAGES	((BlockNumber) 64)
+
+/* Keys of the shared memory table of contents for parallel index vacuum */
+#define PARALLEL_VACUUM_MAGIC			0x50564143
+#define PARALLEL_VACUUM_KEY_SHARED		1
+#define PARALLEL_VACUUM_KEY_DEAD_TIDS	2
+#define PARALLEL_VACUUM_KEY_GUC			3
+
+/*
+ * Per-index slot in shared memory.  A worker that has bulk-deleted the index
+ * leaves its statistics here for the leader.  This relies on no index AM
+ * returning anything bigger than a plain IndexBulkDeleteResult.
+ */
+typedef struct LVSharedIndex
+{
+	Oid			indexoid;
+	bool		vacuumed;		/* bulk-deleted by a worker in this pass? */
+	bool		has_stats;		/* is stats valid? */
+	IndexBulkDeleteResult stats;
+	char		rusage[128];	/* the worker's pg_rusage_show() report */
+} LVSharedIndex;
+
+/*
+ * State shared between the leader and the workers of parallel index vacuum.
+ * The indexes of a pass are handed out in order, starting from next_index.
+ */
+typedef struct LVShared
+{
+	Oid			dboid;			/* database to connect to */
+	Oid			relowner;		/* user to run index functions as */
+	int			elevel;			/* message level of index AMs */
+	double		num_heap_tuples;	/* for IndexVacuumInfo */
+	int			cost_limit;		/* each participant's vacuum_cost_limit */
+	int			nindexes;
+	slock_t		mutex;			/* protects next_index */
+	int			next_index;
+	LVSharedIndex indexes[FLEXIBLE_ARRAY_MEMBER];
+} LVShared;
+
+/* The leader's handle on parallel index vacuum */
+typedef struct LVParallelState
+{
+	dsm_segment *seg;
+	LVShared   *lvshared;
+	int			nworkers;		/* number of workers to launch per pass */
+} LVParallelState;
+
 typedef struct LVRelStats
 {
 	/* hasindex = true means two-pass strategy; false means one-pass */
@@ -106,6 +168,7 @@ typedef struct LVRelStats
 	BlockNumber rel_pages;		/* total number of pages */
 	BlockNumber scanned_pages;	/* number of pages we examined */
 	BlockNumber	pinskipped_pages; /* # of pages we skipped due to a pin */
+	BlockNumber frozenskipped_pages;	/* # of frozen pages we skipped */
 	double		scanned_tuples; /* counts only tuples on scanned pages */
 	double		old_rel_tuples; /* previous value of pg_class.reltuples */
 	double		new_rel_tuples; /* new estimated total # of tuples */
@@ -113,16 +176,45 @@ typedef struct LVRelStats
 	BlockNumber pages_removed;
 	double		tuples_deleted;
 	BlockNumber nonempty_pages; /* actually, last nonempty page + 1 */
-	/* List of TIDs of tuples we intend to delete */
-	/* NB: this list is ordered by TID address */
-	int			num_dead_tuples;	/* current # of entries */
-	int			max_dead_tuples;	/* # slots allocated in array */
-	ItemPointer dead_tuples;	/* array of ItemPointerData */
+	/* TIDs of tuples we intend to delete, added in block number order */
+	TidStore   *dead_tids;
+	/* set up if indexes are vacuumed in parallel; dead_tids is shared then */
+	LVParallelState *lps;
 	int			num_index_scans;
 	TransactionId latestRemovedXid;
 	bool		lock_waiter_detected;
 } LVRelStats;
 
+/*
+ * State of the read stream callback of lazy_scan_heap, which decides which
+ * pages to skip according to the visibility map.  The per-block data it
+ * passes along is the block's all_visible_according_to_vm flag.
+ */
+typedef struct LVScanState
+{
+	Relation	onerel;
+	LVRelStats *vacrelstats;
+	bool		scan_all;
+	BlockNumber nblocks;
+	BlockNumber next_block;		/* next block to consider */
+	BlockNumber next_unskippable_block;
+	bool		skipping_blocks;
+	Buffer		vmbuffer;		/* visibility map page pinned by callback */
+} LVScanState;
+
+/*
+ * State of the read stream callback of lazy_vacuum_heap, which walks the
+ * blocks of the TID store.  The per-block data is the block's index there.
+ */
+typedef struct LVVacuumState
+{
+	TidStore   *dead_tids;
+	int			next_index;		/* next block index to hand out */
+} LVVacuumState;
+
+
+/* GUC parameter */
+int			max_parallel_vacuum_workers = 2;
 
 /* A few variables that don't seem worth passing around as parameters */
 static int	elevel = -1;
@@ -137,26 +229,45 @@ static BufferAccessStrategy vac_strategy;
 /* non-export function prototypes */
 static void lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 			   Relation *Irel, int nindexes, bool scan_all);
+static BlockNumber lazy_scan_next_block(void *callback_private,
+					 void *per_block_data);
+static BlockNumber lazy_scan_next_unskippable(LVScanState *scanstate,
+						   BlockNumber blkno);
 static void lazy_vacuum_heap(Relation onerel, LVRelStats *vacrelstats);
+static BlockNumber lazy_vacuum_next_block(void *callback_private,
+					   void *per_block_data);
 static bool lazy_check_needs_freeze(Buffer buf);
+static void lazy_vacuum_all_indexes(Relation *Irel, int nindexes,
+						IndexBulkDeleteResult **indstats,
+						LVRelStats *vacrelstats);
 static void lazy_vacuum_index(Relation indrel,
 				  IndexBulkDeleteResult **stats,
 				  LVRelStats *vacrelstats);
 static void lazy_cleanup_index(Relation indrel,
 				   IndexBulkDeleteResult *stats,
 				   LVRelStats *vacrelstats);
-static int lazy_vacuum_page(Relation onerel, BlockNumber blkno, Buffer buffer,
-				 int tupindex, LVRelStats *vacrelstats, Buffer *vmbuffer);
+static void lazy_vacuum_page(Relation onerel, BlockNumber blkno, Buffer buffer,
+				 OffsetNumber *deadoffsets, int ndead,
+				 LVRelStats *vacrelstats, Buffer *vmbuffer);
 static void lazy_truncate_heap(Relation onerel, LVRelStats *vacrelstats);
 static BlockNumber count_nondeletable_pages(Relation onerel,
 						 LVRelStats *vacrelstats);
-static void lazy_space_alloc(LVRelStats *vacrelstats, BlockNumber relblocks);
-static void lazy_record_dead_tuple(LVRelStats *vacrelstats,
-					   ItemPointer itemptr);
+static void lazy_space_alloc(LVRelStats *vacrelstats, Relation onerel,
+				 BlockNumber relblocks, Relation *Irel, int nindexes);
+static void lazy_space_free(LVRelStats *vacrelstats);
+static int	lazy_parallel_workers(Relation *Irel, int nindexes);
+static void lazy_begin_parallel(LVRelStats *vacrelstats, Relation onerel,
+					Relation *Irel, int nindexes, int nworkers,
+					Size maxbytes);
+static void lazy_parallel_vacuum_indexes(Relation *Irel, int nindexes,
+							 IndexBulkDeleteResult **indstats,
+							 LVRelStats *vacrelstats);
+static int	lazy_parallel_next_index(LVShared *lvshared);
+static void lazy_parallel_wait_for_worker(BackgroundWorkerHandle *handle);
+static void lazy_parallel_vacuum_main(Datum main_arg);
 static bool lazy_tid_reaped(ItemPointer itemptr, void *state);
-static int	vac_cmp_itemptr(const void *left, const void *right);
 static bool heap_page_is_all_visible(Relation rel, Buffer buf,
-						 TransactionId *visibility_cutoff_xid);
+						 TransactionId *visibility_cutoff_xid, bool *all_frozen);
 
 
 /*
@@ -244,13 +355,14 @@ lazy_vacuum_rel(Relation onerel, VacuumStmt *vacstmt,
 	vac_close_indexes(nindexes, Irel, NoLock);
 
 	/*
-	 * Compute whether we actually scanned the whole relation. If we did, we
-	 * can adjust relfrozenxid and relminmxid.
+	 * Compute whether we actually scanned all the unfrozen pages. If we did,
+	 * we can adjust relfrozenxid and relminmxid.
 	 *
 	 * NB: We need to check this before truncating the relation, because that
 	 * will change ->rel_pages.
 	 */
-	if (vacrelstats->scanned_pages < vacrelstats->rel_pages)
+	if ((vacrelstats->scanned_pages + vacrelstats->frozenskipped_pages)
+		< vacrelstats->rel_pages)
 	{
 		Assert(!scan_all);
 		scanned_all = false;
@@ -287,8 +399,9 @@ lazy_vacuum_rel(Relation onerel, VacuumStmt *vacstmt,
 	 * is all-visible we'd definitely like to know that.  But clamp the value
 	 * to be not more than what we're setting relpages to.
 	 *
-	 * Also, don't change relfrozenxid/relminmxid if we skipped any pages,
-	 * since then we don't know for certain that all tuples have a newer xmin.
+	 * Also, don't change relfrozenxid/relminmxid if we skipped any pages
+	 * that aren't all-frozen, since then we don't know for certain that all
+	 * tuples have a newer xmin.
 	 */
 	new_rel_pages = vacrelstats->rel_pages;
 	new_rel_tuples = vacrelstats->new_rel_tuples;
@@ -298,7 +411,7 @@ lazy_vacuum_rel(Relation onerel, VacuumStmt *vacstmt,
 		new_rel_tuples = vacrelstats->old_rel_tuples;
 	}
 
-	new_rel_allvisible = visibilitymap_count(onerel);
+	visibilitymap_count(onerel, &new_rel_allvisible, NULL);
 	if (new_rel_allvisible > new_rel_pages)
 		new_rel_allvisible = new_rel_pages;
 
@@ -356,10 +469,11 @@ lazy_vacuum_rel(Relation onerel, VacuumStmt *vacstmt,
 							 get_namespace_name(RelationGetNamespace(onerel)),
 							 RelationGetRelationName(onerel),
 							 vacrelstats->num_index_scans);
-			appendStringInfo(&buf, _("pages: %u removed, %u remain, %u skipped due to pins\n"),
+			appendStringInfo(&buf, _("pages: %u removed, %u remain, %u skipped due to pins, %u skipped frozen\n"),
 							 vacrelstats->pages_removed,
 							 vacrelstats->rel_pages,
-							 vacrelstats->pinskipped_pages);
+							 vacrelstats->pinskipped_pages,
+							 vacrelstats->frozenskipped_pages);
 			appendStringInfo(&buf,
 							 _("tuples: %.0f removed, %.0f remain, %.0f are dead but not yet removable\n"),
 							 vacrelstats->tuples_deleted,
@@ -422,9 +536,9 @@ vacuum_log_cleanup_info(Relation rel, LVRelStats *vacrelstats)
  *		page, and set commit status bits (see heap_page_prune).  It also builds
  *		lists of dead tuples and pages with free space, calculates statistics
  *		on the number of live tuples in the heap, and marks pages as
- *		all-visible if appropriate.  When done, or when we run low on space for
- *		dead-tuple TIDs, invoke vacuuming of indexes and call lazy_vacuum_heap
- *		to reclaim dead line pointers.
+ *		all-visible and all-frozen if appropriate.  When done, or when we run
+ *		low on space for dead-tuple TIDs, invoke vacuuming of indexes and call
+ *		lazy_vacuum_heap to reclaim dead line pointers.
  *
  *		If there are no indexes then we can reclaim line pointers on the fly;
  *		dead line pointers need only be retained until all index pointers that
@@ -448,9 +562,10 @@ lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 	int			i;
 	PGRUsage	ru0;
 	Buffer		vmbuffer = InvalidBuffer;
-	BlockNumber next_not_all_visible_block;
-	bool		skipping_all_visible_blocks;
+	LVScanState scanstate;
+	ReadStream *stream;
 	xl_heap_freeze_tuple *frozen;
+	OffsetNumber deadoffsets[MaxHeapTuplesPerPage];
 	StringInfoData	buf;
 
 	pg_rusage_init(&ru0);
@@ -473,7 +588,7 @@ lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 	vacrelstats->nonempty_pages = 0;
 	vacrelstats->latestRemovedXid = InvalidTransactionId;
 
-	lazy_space_alloc(vacrelstats, nblocks);
+	lazy_space_alloc(vacrelstats, onerel, nblocks, Irel, nindexes);
 	frozen = palloc(sizeof(xl_heap_freeze_tuple) * MaxHeapTuplesPerPage);
 
 	/*
@@ -482,91 +597,76 @@ lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 	 * consecutive pages.  Since we're reading sequentially, the OS should be
 	 * doing readahead for us, so there's no gain in skipping a page now and
 	 * then; that's likely to disable readahead and so be counterproductive.
-	 * Also, skipping even a single page means that we can't update
-	 * relfrozenxid, so we only want to do it if we can skip a goodly number
-	 * of pages.
+	 * Also, skipping even a single page that isn't all-frozen means that we
+	 * can't update relfrozenxid, so we only want to do it if we can skip a
+	 * goodly number of pages.
 	 *
-	 * Before entering the main loop, establish the invariant that
-	 * next_not_all_visible_block is the next block number >= blkno that's not
-	 * all-visible according to the visibility map, or nblocks if there's no
-	 * such block.  Also, we set up the skipping_all_visible_blocks flag,
-	 * which is needed because we need hysteresis in the decision: once we've
-	 * started skipping blocks, we may as well skip everything up to the next
-	 * not-all-visible block.
+	 * When scan_all is set, we can't skip pages just because they are
+	 * all-visible, but we can still skip pages that are all-frozen, since
+	 * such pages do not need freezing and do not affect the value that we can
+	 * safely set for relfrozenxid or relminmxid.
 	 *
-	 * Note: if scan_all is true, we won't actually skip any pages; but we
-	 * maintain next_not_all_visible_block anyway, so as to set up the
-	 * all_visible_according_to_vm flag correctly for each page.
+	 * The pages are read through a read stream, which reads consecutive pages
+	 * with one system call and prefetches the ones ahead; the skipping is
+	 * done by its callback, lazy_scan_next_block.  That keeps track of
+	 * next_unskippable_block, the next block number that we can't skip based
+	 * on the visibility map, either all-visible for a regular scan or
+	 * all-frozen for a scan_all scan, and of the skipping_blocks flag, which
+	 * is needed because we want hysteresis in the decision: once we've
+	 * started skipping blocks, we may as well skip everything up to the next
+	 * not-all-visible (or not-all-frozen) block.
 	 *
-	 * Note: The value returned by visibilitymap_test could be slightly
+	 * Note: The value returned by visibilitymap_get_status could be slightly
 	 * out-of-date, since we make this test before reading the corresponding
 	 * heap page or locking the buffer.  This is OK.  If we mistakenly think
-	 * that the page is all-visible when in fact the flag's just been cleared,
-	 * we might fail to vacuum the page.  But it's OK to skip pages when
-	 * scan_all is not set, so no great harm done; the next vacuum will find
-	 * them.  If we make the reverse mistake and vacuum a page unnecessarily,
-	 * it'll just be a no-op.
+	 * that the page is all-visible or all-frozen when in fact the flag's just
+	 * been cleared, we might fail to vacuum the page.  It's easy to see that
+	 * skipping a page when scan_all is not set is not a very big deal; we
+	 * might leave some dead tuples lying around, but the next vacuum will
+	 * find them.  But even when scan_all is set, it's still OK if we miss a
+	 * page whose all-frozen marking has just been cleared.  Any new XIDs just
+	 * added to that page are necessarily newer than the GlobalXmin we
+	 * computed, so they'll have no effect on the value to which we can
+	 * safely set relfrozenxid.  A similar argument applies for MXIDs and
+	 * relminmxid.
 	 */
-	for (next_not_all_visible_block = 0;
-		 next_not_all_visible_block < nblocks;
-		 next_not_all_visible_block++)
-	{
-		if (!visibilitymap_test(onerel, next_not_all_visible_block, &vmbuffer))
-			break;
-		vacuum_delay_point();
-	}
-	if (next_not_all_visible_block >= SKIP_PAGES_THRESHOLD)
-		skipping_all_visible_blocks = true;
-	else
-		skipping_all_visible_blocks = false;
-
-	for (blkno = 0; blkno < nblocks; blkno++)
+	scanstate.onerel = onerel;
+	scanstate.vacrelstats = vacrelstats;
+	scanstate.scan_all = scan_all;
+	scanstate.nblocks = nblocks;
+	scanstate.next_block = 0;
+	scanstate.vmbuffer = InvalidBuffer;
+	scanstate.next_unskippable_block = lazy_scan_next_unskippable(&scanstate,
+																  0);
+	scanstate.skipping_blocks =
+		(scanstate.next_unskippable_block >= SKIP_PAGES_THRESHOLD);
+
+	stream = BeginReadStream(onerel, MAIN_FORKNUM, vac_strategy,
+							 lazy_scan_next_block, &scanstate, sizeof(bool));
+
+	for (;;)
 	{
 		Buffer		buf;
+		void	   *per_block_data;
 		Page		page;
 		OffsetNumber offnum,
 					maxoff;
 		bool		tupgone,
 					hastup;
-		int			prev_dead_count;
+		int			ndead;
 		int			nfrozen;
 		Size		freespace;
 		bool		all_visible_according_to_vm;
 		bool		all_visible;
+		bool		all_frozen = true;	/* provided all_visible is also true */
 		bool		has_dead_tuples;
 		TransactionId visibility_cutoff_xid = InvalidTransactionId;
 
-		if (blkno == next_not_all_visible_block)
-		{
-			/* Time to advance next_not_all_visible_block */
-			for (next_not_all_visible_block++;
-				 next_not_all_visible_block < nblocks;
-				 next_not_all_visible_block++)
-			{
-				if (!visibilitymap_test(onerel, next_not_all_visible_block,
-										&vmbuffer))
-					break;
-				vacuum_delay_point();
-			}
-
-			/*
-			 * We know we can't skip the current block.  But set up
-			 * skipping_all_visible_blocks to do the right thing at the
-			 * following blocks.
-			 */
-			if (next_not_all_visible_block - blkno > SKIP_PAGES_THRESHOLD)
-				skipping_all_visible_blocks = true;
-			else
-				skipping_all_visible_blocks = false;
-			all_visible_according_to_vm = false;
-		}
-		else
-		{
-			/* Current block is all-visible */
-			if (skipping_all_visible_blocks && !scan_all)
-				continue;
-			all_visible_according_to_vm = true;
-		}
+		buf = ReadStreamNextBuffer(stream, &per_block_data);
+		if (!BufferIsValid(buf))
+			break;
+		blkno = BufferGetBlockNumber(buf);
+		all_visible_according_to_vm = *(bool *) per_block_data;
 
 		vacuum_delay_point();
 
@@ -574,29 +674,32 @@ lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 		 * If we are close to overrunning the available space for dead-tuple
 		 * TIDs, pause and do a cycle of vacuuming before we tackle this page.
 		 */
-		if ((vacrelstats->max_dead_tuples - vacrelstats->num_dead_tuples) < MaxHeapTuplesPerPage &&
-			vacrelstats->num_dead_tuples > 0)
+		if (tidstore_is_full(vacrelstats->dead_tids))
 		{
 			/*
 			 * Before beginning index vacuuming, we release any pin we may
 			 * hold on the visibility map page.  This isn't necessary for
 			 * correctness, but we do it anyway to avoid holding the pin
-			 * across a lengthy, unrelated operation.
+			 * across a lengthy, unrelated operation.  (The pins on this and
+			 * the next few heap pages held by the read stream are harmless:
+			 * lazy_vacuum_heap only visits pages we've already scanned.)
 			 */
 			if (BufferIsValid(vmbuffer))
 			{
 				ReleaseBuffer(vmbuffer);
 				vmbuffer = InvalidBuffer;
 			}
+			if (BufferIsValid(scanstate.vmbuffer))
+			{
+				ReleaseBuffer(scanstate.vmbuffer);
+				scanstate.vmbuffer = InvalidBuffer;
+			}
 
 			/* Log cleanup info before we touch indexes */
 			vacuum_log_cleanup_info(onerel, vacrelstats);
 
 			/* Remove index entries */
-			for (i = 0; i < nindexes; i++)
-				lazy_vacuum_index(Irel[i],
-								  &indstats[i],
-								  vacrelstats);
+			lazy_vacuum_all_indexes(Irel, nindexes, indstats, vacrelstats);
 			/* Remove tuples from heap */
 			lazy_vacuum_heap(onerel, vacrelstats);
 
@@ -605,7 +708,7 @@ lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 			 * not to reset latestRemovedXid since we want that value to be
 			 * valid.
 			 */
-			vacrelstats->num_dead_tuples = 0;
+			tidstore_reset(vacrelstats->dead_tids);
 			vacrelstats->num_index_scans++;
 		}
 
@@ -613,15 +716,12 @@ lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 		 * Pin the visibility map page in case we need to mark the page
 		 * all-visible.  In most cases this will be very cheap, because we'll
 		 * already have the correct page pinned anyway.  However, it's
-		 * possible that (a) next_not_all_visible_block is covered by a
-		 * different VM page than the current block or (b) we released our pin
-		 * and did a cycle of index vacuuming.
+		 * possible that (a) the current block is covered by a different VM
+		 * page than the previous one or (b) we released our pin and did a
+		 * cycle of index vacuuming.
 		 */
 		visibilitymap_pin(onerel, blkno, &vmbuffer);
 
-		buf = ReadBufferExtended(onerel, MAIN_FORKNUM, blkno,
-								 RBM_NORMAL, vac_strategy);
-
 		/* We need buffer cleanup lock so that we can prune HOT chains. */
 		if (!ConditionalLockBufferForCleanup(buf))
 		{
@@ -734,9 +834,11 @@ lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 					PageGetLSN(page) == InvalidXLogRecPtr)
 					log_newpage_buffer(buf, true);
 
+				/* empty pages are all-frozen too */
 				PageSetAllVisible(page);
 				visibilitymap_set(onerel, blkno, buf, InvalidXLogRecPtr,
-								  vmbuffer, InvalidTransactionId);
+								  vmbuffer, InvalidTransactionId,
+								  VISIBILITYMAP_ALL_VISIBLE | VISIBILITYMAP_ALL_FROZEN);
 				END_CRIT_SECTION();
 			}
 
@@ -761,7 +863,7 @@ lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 		has_dead_tuples = false;
 		nfrozen = 0;
 		hastup = false;
-		prev_dead_count = vacrelstats->num_dead_tuples;
+		ndead = 0;
 		maxoff = PageGetMaxOffsetNumber(page);
 
 		/*
@@ -800,7 +902,7 @@ lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 			 */
 			if (ItemIdIsDead(itemid))
 			{
-				lazy_record_dead_tuple(vacrelstats, &(tuple.t_self));
+				deadoffsets[ndead++] = offnum;
 				all_visible = false;
 				continue;
 			}
@@ -905,7 +1007,7 @@ lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 
 			if (tupgone)
 			{
-				lazy_record_dead_tuple(vacrelstats, &(tuple.t_self));
+				deadoffsets[ndead++] = offnum;
 				HeapTupleHeaderAdvanceLatestRemovedXid(tuple.t_data,
 											 &vacrelstats->latestRemovedXid);
 				tups_vacuumed += 1;
@@ -913,6 +1015,8 @@ lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 			}
 			else
 			{
+				bool		tuple_totally_frozen;
+
 				num_tuples += 1;
 				hastup = true;
 
@@ -921,8 +1025,12 @@ lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 				 * freezing.  Note we already have exclusive buffer lock.
 				 */
 				if (heap_prepare_freeze_tuple(tuple.t_data, FreezeLimit,
-										  MultiXactCutoff, &frozen[nfrozen]))
+										  MultiXactCutoff, &frozen[nfrozen],
+										  &tuple_totally_frozen))
 					frozen[nfrozen++].offset = offnum;
+
+				if (!tuple_totally_frozen)
+					all_frozen = false;
 			}
 		}						/* scan along page */
 
@@ -964,13 +1072,14 @@ lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 
 		/*
 		 * If there are no indexes then we can vacuum the page right now
-		 * instead of doing a second scan.
+		 * instead of doing a second scan.  Otherwise remember the dead
+		 * tuples until we've removed their index entries.
 		 */
-		if (nindexes == 0 &&
-			vacrelstats->num_dead_tuples > 0)
+		if (nindexes == 0 && ndead > 0)
 		{
 			/* Remove tuples from heap */
-			lazy_vacuum_page(onerel, blkno, buf, 0, vacrelstats, &vmbuffer);
+			lazy_vacuum_page(onerel, blkno, buf, deadoffsets, ndead,
+							 vacrelstats, &vmbuffer);
 			has_dead_tuples = false;
 
 			/*
@@ -978,15 +1087,23 @@ lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 			 * not to reset latestRemovedXid since we want that value to be
 			 * valid.
 			 */
-			vacrelstats->num_dead_tuples = 0;
+			ndead = 0;
 			vacuumed_pages++;
 		}
+		else if (ndead > 0)
+			tidstore_add_offsets(vacrelstats->dead_tids, blkno,
+								 deadoffsets, ndead);
 
 		freespace = PageGetHeapFreeSpace(page);
 
 		/* mark page all-visible, if appropriate */
 		if (all_visible && !all_visible_according_to_vm)
 		{
+			uint8		flags = VISIBILITYMAP_ALL_VISIBLE;
+
+			if (all_frozen)
+				flags |= VISIBILITYMAP_ALL_FROZEN;
+
 			/*
 			 * It should never be the case that the visibility map page is set
 			 * while the page-level bit is clear, but the reverse is allowed
@@ -1003,7 +1120,7 @@ lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 			PageSetAllVisible(page);
 			MarkBufferDirty(buf);
 			visibilitymap_set(onerel, blkno, buf, InvalidXLogRecPtr,
-							  vmbuffer, visibility_cutoff_xid);
+							  vmbuffer, visibility_cutoff_xid, flags);
 		}
 
 		/*
@@ -1014,11 +1131,12 @@ lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 		 * that something bad has happened.
 		 */
 		else if (all_visible_according_to_vm && !PageIsAllVisible(page)
-				 && visibilitymap_test(onerel, blkno, &vmbuffer))
+				 && VM_ALL_VISIBLE(onerel, blkno, &vmbuffer))
 		{
 			elog(WARNING, "page is not marked all-visible but visibility map bit is set in relation \"%s\" page %u",
 				 relname, blkno);
-			visibilitymap_clear(onerel, blkno, vmbuffer);
+			visibilitymap_clear(onerel, blkno, vmbuffer,
+								VISIBILITYMAP_VALID_BITS);
 		}
 
 		/*
@@ -1040,7 +1158,26 @@ lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 				 relname, blkno);
 			PageClearAllVisible(page);
 			MarkBufferDirty(buf);
-			visibilitymap_clear(onerel, blkno, vmbuffer);
+			visibilitymap_clear(onerel, blkno, vmbuffer,
+								VISIBILITYMAP_VALID_BITS);
+		}
+
+		/*
+		 * If the all-visible page turns out to be all-frozen but not marked
+		 * as such, we should so mark it.  Note that all_frozen is only valid
+		 * if all_visible is true, so we must check both.
+		 */
+		else if (all_visible_according_to_vm && all_visible && all_frozen &&
+				 !VM_ALL_FROZEN(onerel, blkno, &vmbuffer))
+		{
+			/*
+			 * We can pass InvalidTransactionId as the cutoff XID here,
+			 * because setting the all-frozen bit doesn't cause recovery
+			 * conflicts.
+			 */
+			visibilitymap_set(onerel, blkno, buf, InvalidXLogRecPtr,
+							  vmbuffer, InvalidTransactionId,
+							  VISIBILITYMAP_ALL_FROZEN);
 		}
 
 		UnlockReleaseBuffer(buf);
@@ -1056,10 +1193,14 @@ lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 		 * page, so remember its free space as-is.  (This path will always be
 		 * taken if there are no indexes.)
 		 */
-		if (vacrelstats->num_dead_tuples == prev_dead_count)
+		if (ndead == 0)
 			RecordPageWithFreeSpace(onerel, blkno, freespace);
 	}
 
+	EndReadStream(stream);
+	if (BufferIsValid(scanstate.vmbuffer))
+		ReleaseBuffer(scanstate.vmbuffer);
+
 	pfree(frozen);
 
 	/* save stats for use later */
@@ -1084,21 +1225,21 @@ lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 
 	/* If any tuples need to be deleted, perform final vacuum cycle */
 	/* XXX put a threshold on min number of tuples here? */
-	if (vacrelstats->num_dead_tuples > 0)
+	if (tidstore_num_tids(vacrelstats->dead_tids) > 0)
 	{
 		/* Log cleanup info before we touch indexes */
 		vacuum_log_cleanup_info(onerel, vacrelstats);
 
 		/* Remove index entries */
-		for (i = 0; i < nindexes; i++)
-			lazy_vacuum_index(Irel[i],
-							  &indstats[i],
-							  vacrelstats);
+		lazy_vacuum_all_indexes(Irel, nindexes, indstats, vacrelstats);
 		/* Remove tuples from heap */
 		lazy_vacuum_heap(onerel, vacrelstats);
 		vacrelstats->num_index_scans++;
 	}
 
+	/* The TID store isn't needed anymore */
+	lazy_space_free(vacrelstats);
+
 	/* Do post-vacuum cleanup and statistics update for each index */
 	for (i = 0; i < nindexes; i++)
 		lazy_cleanup_index(Irel[i], indstats[i], vacrelstats);
@@ -1122,6 +1263,8 @@ lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 					 nunused);
 	appendStringInfo(&buf, _("Skipped %u pages due to buffer pins.\n"),
 					 vacrelstats->pinskipped_pages);
+	appendStringInfo(&buf, _("%u pages are entirely frozen and were skipped.\n"),
+					 vacrelstats->frozenskipped_pages);
 	appendStringInfo(&buf, _("%u pages are entirely empty.\n"),
 					 empty_pages);
 	appendStringInfo(&buf, _("%s."),
@@ -1137,6 +1280,110 @@ lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 }
 
 
+/*
+ *	lazy_scan_next_block() -- read stream callback for lazy_scan_heap
+ *
+ *		Returns the next block that lazy_scan_heap has to look at, skipping
+ *		over the pages that the visibility map says don't need vacuuming,
+ *		as explained in lazy_scan_heap.
+ */
+static BlockNumber
+lazy_scan_next_block(void *callback_private, void *per_block_data)
+{
+	LVScanState *scanstate = (LVScanState *) callback_private;
+	bool	   *all_visible_according_to_vm = (bool *) per_block_data;
+
+	while (scanstate->next_block < scanstate->nblocks)
+	{
+		BlockNumber blkno = scanstate->next_block++;
+
+		if (blkno == scanstate->next_unskippable_block)
+		{
+			/* Time to advance next_unskippable_block */
+			scanstate->next_unskippable_block =
+				lazy_scan_next_unskippable(scanstate, blkno + 1);
+
+			/*
+			 * We know we can't skip the current block.  But set up
+			 * skipping_blocks to do the right thing at the following blocks.
+			 */
+			scanstate->skipping_blocks =
+				(scanstate->next_unskippable_block - blkno > SKIP_PAGES_THRESHOLD);
+
+			/*
+			 * Normally, the fact that we can't skip this block must mean that
+			 * it's not all-visible.  But in a scan_all vacuum we know only
+			 * that it's not all-frozen, so it might still be all-visible.
+			 */
+			*all_visible_according_to_vm = scanstate->scan_all &&
+				VM_ALL_VISIBLE(scanstate->onerel, blkno, &scanstate->vmbuffer);
+			return blkno;
+		}
+
+		/*
+		 * The current block is potentially skippable; if we've seen a long
+		 * enough run of skippable blocks to justify skipping it, go ahead and
+		 * skip.  Otherwise, the page must be at least all-visible if not
+		 * all-frozen, so we can set all_visible_according_to_vm = true.
+		 */
+		if (scanstate->skipping_blocks)
+		{
+			/*
+			 * Tricky, tricky.  If this is a scan_all vacuum, the page must
+			 * have been all-frozen at the time we checked whether it was
+			 * skippable, but it might not be any more.  We must be careful to
+			 * count it as a skipped all-frozen page in that case, or else
+			 * we'll think we can't update relfrozenxid and relminmxid.  If
+			 * it's not a scan_all vacuum, we don't know whether it was
+			 * all-frozen, so we have to recheck; but in this case an
+			 * approximate answer is OK.
+			 */
+			if (scanstate->scan_all ||
+				VM_ALL_FROZEN(scanstate->onerel, blkno, &scanstate->vmbuffer))
+				scanstate->vacrelstats->frozenskipped_pages++;
+			continue;
+		}
+
+		*all_visible_according_to_vm = true;
+		return blkno;
+	}
+
+	return InvalidBlockNumber;
+}
+
+/*
+ *	lazy_scan_next_unskippable() -- find the next block we can't skip
+ *
+ *		Returns the first block number >= blkno that isn't all-visible (or,
+ *		for a scan_all vacuum, all-frozen) in the visibility map, or nblocks
+ *		if there's no such block.
+ */
+static BlockNumber
+lazy_scan_next_unskippable(LVScanState *scanstate, BlockNumber blkno)
+{
+	for (; blkno < scanstate->nblocks; blkno++)
+	{
+		uint8		vmstatus;
+
+		vmstatus = visibilitymap_get_status(scanstate->onerel, blkno,
+											&scanstate->vmbuffer);
+		if (scanstate->scan_all)
+		{
+			if ((vmstatus & VISIBILITYMAP_ALL_FROZEN) == 0)
+				break;
+		}
+		else
+		{
+			if ((vmstatus & VISIBILITYMAP_ALL_VISIBLE) == 0)
+				break;
+		}
+		vacuum_delay_point();
+	}
+
+	return blkno;
+}
+
+
 /*
  *	lazy_vacuum_heap() -- second pass over the heap
  *
@@ -1151,35 +1398,52 @@ lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 static void
 lazy_vacuum_heap(Relation onerel, LVRelStats *vacrelstats)
 {
-	int			tupindex;
+	TidStore   *dead_tids = vacrelstats->dead_tids;
+	OffsetNumber deadoffsets[MaxHeapTuplesPerPage];
+	LVVacuumState vacstate;
+	double		ntuples;
 	int			npages;
 	PGRUsage	ru0;
 	Buffer		vmbuffer = InvalidBuffer;
+	ReadStream *stream;
+	Buffer		buf;
+	void	   *per_block_data;
 
 	pg_rusage_init(&ru0);
+	ntuples = 0;
 	npages = 0;
 
-	tupindex = 0;
-	while (tupindex < vacrelstats->num_dead_tuples)
+	/*
+	 * The pages with dead tuples are in block number order in the TID store,
+	 * so the read stream can combine the reads of neighbouring ones.  It
+	 * passes along each block's index in the store.
+	 */
+	vacstate.dead_tids = dead_tids;
+	vacstate.next_index = 0;
+	stream = BeginReadStream(onerel, MAIN_FORKNUM, vac_strategy,
+							 lazy_vacuum_next_block, &vacstate, sizeof(int));
+
+	while ((buf = ReadStreamNextBuffer(stream, &per_block_data)) != InvalidBuffer)
 	{
 		BlockNumber tblk;
-		Buffer		buf;
+		int			ndead;
 		Page		page;
 		Size		freespace;
 
 		vacuum_delay_point();
 
-		tblk = ItemPointerGetBlockNumber(&vacrelstats->dead_tuples[tupindex]);
-		buf = ReadBufferExtended(onerel, MAIN_FORKNUM, tblk, RBM_NORMAL,
-								 vac_strategy);
+		ndead = tidstore_get_offsets(dead_tids, *(int *) per_block_data,
+									 &tblk, deadoffsets);
+		Assert(tblk == BufferGetBlockNumber(buf));
 		if (!ConditionalLockBufferForCleanup(buf))
 		{
+			/* leave the dead line pointers for the next vacuum */
 			ReleaseBuffer(buf);
-			++tupindex;
 			continue;
 		}
-		tupindex = lazy_vacuum_page(onerel, tblk, buf, tupindex, vacrelstats,
-									&vmbuffer);
+		lazy_vacuum_page(onerel, tblk, buf, deadoffsets, ndead, vacrelstats,
+						 &vmbuffer);
+		ntuples += ndead;
 
 		/* Now that we've compacted the page, record its available space */
 		page = BufferGetPage(buf);
@@ -1190,6 +1454,8 @@ lazy_vacuum_heap(Relation onerel, LVRelStats *vacrelstats)
 		npages++;
 	}
 
+	EndReadStream(stream);
+
 	if (BufferIsValid(vmbuffer))
 	{
 		ReleaseBuffer(vmbuffer);
@@ -1197,44 +1463,57 @@ lazy_vacuum_heap(Relation onerel, LVRelStats *vacrelstats)
 	}
 
 	ereport(elevel,
-			(errmsg("\"%s\": removed %d row versions in %d pages",
+			(errmsg("\"%s\": removed %.0f row versions in %d pages",
 					RelationGetRelationName(onerel),
-					tupindex, npages),
+					ntuples, npages),
 			 errdetail("%s.",
 					   pg_rusage_show(&ru0))));
 }
 
+/*
+ *	lazy_vacuum_next_block() -- read stream callback for lazy_vacuum_heap
+ */
+static BlockNumber
+lazy_vacuum_next_block(void *callback_private, void *per_block_data)
+{
+	LVVacuumState *vacstate = (LVVacuumState *) callback_private;
+	int			blockindex = vacstate->next_index;
+
+	if (blockindex >= tidstore_num_blocks(vacstate->dead_tids))
+		return InvalidBlockNumber;
+
+	vacstate->next_index++;
+	*(int *) per_block_data = blockindex;
+	return vacstate->dead_tids->ts_blocks[blockindex].ts_blkno;
+}
+
 /*
  *	lazy_vacuum_page() -- free dead tuples on a page
  *					 and repair its fragmentation.
  *
  * Caller must hold pin and buffer cleanup lock on the buffer.
  *
- * tupindex is the index in vacrelstats->dead_tuples of the first dead
- * tuple for this page.  We assume the rest follow sequentially.
- * The return value is the first tupindex after the tuples of this page.
+ * deadoffsets holds the ndead line pointers of this page to be freed.
  */
-static int
+static void
 lazy_vacuum_page(Relation onerel, BlockNumber blkno, Buffer buffer,
-				 int tupindex, LVRelStats *vacrelstats, Buffer *vmbuffer)
+				 OffsetNumber *deadoffsets, int ndead,
+				 LVRelStats *vacrelstats, Buffer *vmbuffer)
 {
 	Page		page = BufferGetPage(buffer);
 	OffsetNumber unused[MaxOffsetNumber];
 	int			uncnt = 0;
+	int			i;
 	TransactionId visibility_cutoff_xid;
+	bool		all_frozen;
 
 	START_CRIT_SECTION();
 
-	for (; tupindex < vacrelstats->num_dead_tuples; tupindex++)
+	for (i = 0; i < ndead; i++)
 	{
-		BlockNumber tblk;
-		OffsetNumber toff;
+		OffsetNumber toff = deadoffsets[i];
 		ItemId		itemid;
 
-		tblk = ItemPointerGetBlockNumber(&vacrelstats->dead_tuples[tupindex]);
-		if (tblk != blkno)
-			break;				/* past end of tuples for this block */
-		toff = ItemPointerGetOffsetNumber(&vacrelstats->dead_tuples[tupindex]);
 		itemid = PageGetItemId(page, toff);
 		ItemIdSetUnused(itemid);
 		unused[uncnt++] = toff;
@@ -1273,22 +1552,30 @@ lazy_vacuum_page(Relation onerel, BlockNumber blkno, Buffer buffer,
 	 * dirty, exclusively locked, and, if needed, a full page image has been
 	 * emitted in the log_heap_clean() above.
 	 */
-	if (heap_page_is_all_visible(onerel, buffer, &visibility_cutoff_xid))
+	if (heap_page_is_all_visible(onerel, buffer, &visibility_cutoff_xid,
+								 &all_frozen))
 		PageSetAllVisible(page);
 
 	/*
 	 * All the changes to the heap page have been done. If the all-visible
-	 * flag is now set, also set the VM bit.
+	 * flag is now set, also set the VM all-visible bit (and, if possible, the
+	 * all-frozen bit) unless this has already been done previously.
 	 */
-	if (PageIsAllVisible(page) &&
-		!visibilitymap_test(onerel, blkno, vmbuffer))
+	if (PageIsAllVisible(page))
 	{
+		uint8		vm_status = visibilitymap_get_status(onerel, blkno, vmbuffer);
+		uint8		flags = 0;
+
+		if ((vm_status & VISIBILITYMAP_ALL_VISIBLE) == 0)
+			flags |= VISIBILITYMAP_ALL_VISIBLE;
+		if ((vm_status & VISIBILITYMAP_ALL_FROZEN) == 0 && all_frozen)
+			flags |= VISIBILITYMAP_ALL_FROZEN;
+
 		Assert(BufferIsValid(*vmbuffer));
-		visibilitymap_set(onerel, blkno, buffer, InvalidXLogRecPtr, *vmbuffer,
-						  visibility_cutoff_xid);
+		if (flags != 0)
+			visibilitymap_set(onerel, blkno, buffer, InvalidXLogRecPtr,
+							  *vmbuffer, visibility_cutoff_xid, flags);
 	}
-
-	return tupindex;
 }
 
 /*
@@ -1336,11 +1623,34 @@ lazy_check_needs_freeze(Buffer buf)
 }
 
 
+/*
+ *	lazy_vacuum_all_indexes() -- vacuum all indexes of the relation.
+ *
+ *		This is one pass of index vacuuming, done in parallel if that has
+ *		been set up.
+ */
+static void
+lazy_vacuum_all_indexes(Relation *Irel, int nindexes,
+						IndexBulkDeleteResult **indstats,
+						LVRelStats *vacrelstats)
+{
+	int			i;
+
+	if (vacrelstats->lps != NULL)
+	{
+		lazy_parallel_vacuum_indexes(Irel, nindexes, indstats, vacrelstats);
+		return;
+	}
+
+	for (i = 0; i < nindexes; i++)
+		lazy_vacuum_index(Irel[i], &indstats[i], vacrelstats);
+}
+
 /*
  *	lazy_vacuum_index() -- vacuum one index relation.
  *
  *		Delete all the index entries pointing to tuples listed in
- *		vacrelstats->dead_tuples, and update running statistics.
+ *		vacrelstats->dead_tids, and update running statistics.
  */
 static void
 lazy_vacuum_index(Relation indrel,
@@ -1361,12 +1671,12 @@ lazy_vacuum_index(Relation indrel,
 
 	/* Do bulk deletion */
 	*stats = index_bulk_delete(&ivinfo, *stats,
-							   lazy_tid_reaped, (void *) vacrelstats);
+							   lazy_tid_reaped, (void *) vacrelstats->dead_tids);
 
 	ereport(elevel,
-			(errmsg("scanned index \"%s\" to remove %d row versions",
+			(errmsg("scanned index \"%s\" to remove %.0f row versions",
 					RelationGetRelationName(indrel),
-					vacrelstats->num_dead_tuples),
+					(double) tidstore_num_tids(vacrelstats->dead_tids)),
 			 errdetail("%s.", pg_rusage_show(&ru0))));
 }
 
@@ -1670,115 +1980,75 @@ count_nondeletable_pages(Relation onerel, LVRelStats *vacrelstats)
  * See the comments at the head of this file for rationale.
  */
 static void
-lazy_space_alloc(LVRelStats *vacrelstats, BlockNumber relblocks)
+lazy_space_alloc(LVRelStats *vacrelstats, Relation onerel,
+				 BlockNumber relblocks, Relation *Irel, int nindexes)
 {
-	long		maxtuples;
+	Size		maxbytes;
+	int			nworkers;
 	int			vac_work_mem = IsAutoVacuumWorkerProcess() &&
 	autovacuum_work_mem != -1 ?
 	autovacuum_work_mem : maintenance_work_mem;
 
 	if (vacrelstats->hasindex)
 	{
-		maxtuples = (vac_work_mem * 1024L) / sizeof(ItemPointerData);
-		maxtuples = Min(maxtuples, INT_MAX);
-		maxtuples = Min(maxtuples, MaxAllocSize / sizeof(ItemPointerData));
-
-		/* curious coding here to ensure the multiplication can't overflow */
-		if ((BlockNumber) (maxtuples / LAZY_ALLOC_TUPLES) > relblocks)
-			maxtuples = relblocks * LAZY_ALLOC_TUPLES;
-
-		/* stay sane if small maintenance_work_mem */
-		maxtuples = Max(maxtuples, MaxHeapTuplesPerPage);
+		maxbytes = (Size) vac_work_mem * 1024;
+		maxbytes = Min(maxbytes, tidstore_size_for_blocks(relblocks));
 	}
 	else
 	{
-		maxtuples = MaxHeapTuplesPerPage;
+		/* tidstore_create rounds this up to room for one page */
+		maxbytes = 0;
 	}
 
-	vacrelstats->num_dead_tuples = 0;
-	vacrelstats->max_dead_tuples = (int) maxtuples;
-	vacrelstats->dead_tuples = (ItemPointer)
-		palloc(maxtuples * sizeof(ItemPointerData));
+	nworkers = lazy_parallel_workers(Irel, nindexes);
+	if (nworkers > 0)
+		lazy_begin_parallel(vacrelstats, onerel, Irel, nindexes, nworkers,
+							maxbytes);
+	else
+		vacrelstats->dead_tids = tidstore_create(maxbytes);
 }
 
 /*
- * lazy_record_dead_tuple - remember one deletable tuple
+ * lazy_space_free - release the TID store, and end parallel index vacuum
  */
 static void
-lazy_record_dead_tuple(LVRelStats *vacrelstats,
-					   ItemPointer itemptr)
+lazy_space_free(LVRelStats *vacrelstats)
 {
-	/*
-	 * The array shouldn't overflow under normal behavior, but perhaps it
-	 * could if we are given a really small maintenance_work_mem. In that
-	 * case, just forget the last few tuples (we'll get 'em next time).
-	 */
-	if (vacrelstats->num_dead_tuples < vacrelstats->max_dead_tuples)
+	if (vacrelstats->lps != NULL)
 	{
-		vacrelstats->dead_tuples[vacrelstats->num_dead_tuples] = *itemptr;
-		vacrelstats->num_dead_tuples++;
+		/* the store lives in the segment */
+		dsm_detach(vacrelstats->lps->seg);
+		pfree(vacrelstats->lps);
+		vacrelstats->lps = NULL;
 	}
+	else
+		pfree(vacrelstats->dead_tids);
+	vacrelstats->dead_tids = NULL;
 }
 
 /*
  *	lazy_tid_reaped() -- is a particular tid deletable?
  *
  *		This has the right signature to be an IndexBulkDeleteCallback.
- *
- *		Assumes dead_tuples array is in sorted order.
  */
 static bool
 lazy_tid_reaped(ItemPointer itemptr, void *state)
 {
-	LVRelStats *vacrelstats = (LVRelStats *) state;
-	ItemPointer res;
-
-	res = (ItemPointer) bsearch((void *) itemptr,
-								(void *) vacrelstats->dead_tuples,
-								vacrelstats->num_dead_tuples,
-								sizeof(ItemPointerData),
-								vac_cmp_itemptr);
-
-	return (res != NULL);
-}
-
-/*
- * Comparator routines for use with qsort() and bsearch().
- */
-static int
-vac_cmp_itemptr(const void *left, const void *right)
-{
-	BlockNumber lblk,
-				rblk;
-	OffsetNumber loff,
-				roff;
+	TidStore   *dead_tids = (TidStore *) state;
 
-	lblk = ItemPointerGetBlockNumber((ItemPointer) left);
-	rblk = ItemPointerGetBlockNumber((ItemPointer) right);
-
-	if (lblk < rblk)
-		return -1;
-	if (lblk > rblk)
-		return 1;
-
-	loff = ItemPointerGetOffsetNumber((ItemPointer) left);
-	roff = ItemPointerGetOffsetNumber((ItemPointer) right);
-
-	if (loff < roff)
-		return -1;
-	if (loff > roff)
-		return 1;
-
-	return 0;
+	return tidstore_lookup(dead_tids, itemptr);
 }
 
 /*
  * Check if every tuple in the given page is visible to all current and future
  * transactions. Also return the visibility_cutoff_xid which is the highest
- * xmin amongst the visible tuples.
+ * xmin amongst the visible tuples, and all_frozen which implies that all
+ * tuples of this page are frozen.
  */
 static bool
-heap_page_is_all_visible(Relation rel, Buffer buf, TransactionId *visibility_cutoff_xid)
+heap_page_is_all_visible(Relation rel, Buffer buf,
+						 TransactionId *visibility_cutoff_xid,
+						 bool *all_frozen)
 {
 	Page		page = BufferGetPage(buf);
 	BlockNumber	blockno = BufferGetBlockNumber(buf);
@@ -1787,6 +2057,7 @@ heap_page_is_all_visible(Relation rel, Buffer buf, TransactionId *visibility_cut
 	bool		all_visible = true;
 
 	*visibility_cutoff_xid = InvalidTransactionId;
+	*all_frozen = true;
 
 	/*
 	 * This is a stripped down version of the line pointer scan in
@@ -1851,6 +2122,11 @@ heap_page_is_all_visible(Relation rel, Buffer buf, TransactionId *visibility_cut
 					/* Track newest xmin on page. */
 					if (TransactionIdFollows(xmin, *visibility_cutoff_xid))
 						*visibility_cutoff_xid = xmin;
+
+					/* Check whether this tuple is already frozen or not */
+					if (all_visible && *all_frozen &&
+						heap_tuple_needs_eventual_freeze(tuple.t_data))
+						*all_frozen = false;
 				}
 				break;
 
@@ -1867,5 +2143,424 @@ heap_page_is_all_visible(Relation rel, Buffer buf, TransactionId *visibility_cut
 		}
 	}							/* scan along page */
 
+	/* all_frozen is meaningless unless the page is also all-visible */
+	if (!all_visible)
+		*all_frozen = false;
+
 	return all_visible;
 }
+
+
+/*
+ * Parallel index vacuum
+ *
+ * For each pass of index vacuuming, the leader registers dynamic background
+ * workers, and then it and the workers take indexes off the shared list until
+ * there are none left.  The dead tuple TIDs, the leader's GUC settings and
+ * one result slot per index are in a dynamic shared memory segment that lives
+ * as long as the heap scan.  The workers open the indexes themselves, but
+ * only if they can lock them without waiting, since the lock manager doesn't
+ * know that a worker acts on the leader's behalf: if a worker queued up
+ * behind someone who is in turn waiting for the leader's lock, nobody would
+ * notice the deadlock.  Any index that no worker managed to vacuum, for that
+ * or any other reason, is vacuumed by the leader once the workers are gone.
+ * So it's never an error if fewer workers than planned, or none, can be
+ * started.  Index cleanup, which updates pg_class, is done by the leader.
+ */
+
+/*
+ * lazy_parallel_workers - decide how many workers to use for index vacuum
+ */
+static int
+lazy_parallel_workers(Relation *Irel, int nindexes)
+{
+	int			nbig = 0;
+	int			i;
+
+	/*
+	 * Autovacuum balances its cost limit across its own workers, and
+	 * shouldn't use up the worker slots anyway.
+	 */
+	if (max_parallel_vacuum_workers <= 0 || nindexes < 2 ||
+		!IsUnderPostmaster || IsAutoVacuumWorkerProcess())
+		return 0;
+
+	for (i = 0; i < nindexes; i++)
+	{
+		if (RelationGetNumberOfBlocks(Irel[i]) >= PARALLEL_VACUUM_MIN_INDEX_PAGES)
+			nbig++;
+	}
+
+	/* the leader takes care of one index itself */
+	if (nbig < 2)
+		return 0;
+	return Min(max_parallel_vacuum_workers, nbig - 1);
+}
+
+/*
+ * lazy_begin_parallel - set up the shared memory for parallel index vacuum
+ *
+ * This creates the TID store in the segment, too.
+ */
+static void
+lazy_begin_parallel(LVRelStats *vacrelstats, Relation onerel,
+					Relation *Irel, int nindexes, int nworkers, Size maxbytes)
+{
+	LVParallelState *lps;
+	LVShared   *lvshared;
+	shm_toc_estimator e;
+	shm_toc    *toc;
+	Size		sharedsize;
+	Size		tidsize;
+	Size		gucsize;
+	Size		segsize;
+	char	   *gucstate;
+	int			i;
+
+	sharedsize = offsetof(LVShared, indexes) + nindexes * sizeof(LVSharedIndex);
+	tidsize = tidstore_estimate(maxbytes);
+	gucsize = EstimateGUCStateSpace();
+
+	shm_toc_initialize_estimator(&e);
+	shm_toc_estimate_chunk(&e, sharedsize);
+	shm_toc_estimate_chunk(&e, tidsize);
+	shm_toc_estimate_chunk(&e, gucsize);
+	shm_toc_estimate_keys(&e, 3);
+	segsize = shm_toc_estimate(&e);
+
+	lps = (LVParallelState *) palloc(sizeof(LVParallelState));
+	lps->seg = dsm_create(segsize);
+	lps->nworkers = nworkers;
+	toc = shm_toc_create(PARALLEL_VACUUM_MAGIC,
+						 dsm_segment_address(lps->seg), segsize);
+
+	lvshared = (LVShared *) shm_toc_allocate(toc, sharedsize);
+	lvshared->dboid = MyDatabaseId;
+	lvshared->relowner = onerel->rd_rel->relowner;
+	lvshared->elevel = elevel;
+	lvshared->num_heap_tuples = 0;
+	lvshared->cost_limit = VacuumCostLimit;
+	lvshared->nindexes = nindexes;
+	SpinLockInit(&lvshared->mutex);
+	lvshared->next_index = nindexes;	/* nothing to do until a pass starts */
+	for (i = 0; i < nindexes; i++)
+	{
+		lvshared->indexes[i].indexoid = RelationGetRelid(Irel[i]);
+		lvshared->indexes[i].vacuumed = false;
+		lvshared->indexes[i].has_stats = false;
+	}
+	shm_toc_insert(toc, PARALLEL_VACUUM_KEY_SHARED, lvshared);
+	lps->lvshared = lvshared;
+
+	vacrelstats->dead_tids = tidstore_init(shm_toc_allocate(toc, tidsize),
+										   tidsize);
+	shm_toc_insert(toc, PARALLEL_VACUUM_KEY_DEAD_TIDS, vacrelstats->dead_tids);
+
+	gucstate = (char *) shm_toc_allocate(toc, gucsize);
+	SerializeGUCState(gucsize, gucstate);
+	shm_toc_insert(toc, PARALLEL_VACUUM_KEY_GUC, gucstate);
+
+	vacrelstats->lps = lps;
+}
+
+/*
+ *	lazy_parallel_vacuum_indexes() -- one pass of parallel index vacuum.
+ */
+static void
+lazy_parallel_vacuum_indexes(Relation *Irel, int nindexes,
+							 IndexBulkDeleteResult **indstats,
+							 LVRelStats *vacrelstats)
+{
+	LVParallelState *lps = vacrelstats->lps;
+	LVShared   *lvshared = lps->lvshared;
+	BackgroundWorker worker;
+	BackgroundWorkerHandle **handles;
+	bool	   *leader_vacuumed;
+	volatile int nlaunched = 0;
+	int			save_cost_limit = VacuumCostLimit;
+	bool		save_set_latch_on_sigusr1 = set_latch_on_sigusr1;
+	int			i;
+
+	/*
+	 * Reset the list of indexes, and hand over the statistics accumulated by
+	 * the earlier passes.  The cost limit is divided among the participants,
+	 * so that a parallel pass does no more I/O per unit of time than a
+	 * serial one would.
+	 */
+	lvshared->num_heap_tuples = vacrelstats->old_rel_tuples;
+	lvshared->cost_limit = Max(VacuumCostLimit / (lps->nworkers + 1), 1);
+	for (i = 0; i < nindexes; i++)
+	{
+		LVSharedIndex *slot = &lvshared->indexes[i];
+
+		slot->vacuumed = false;
+		slot->has_stats = (indstats[i] != NULL);
+		if (slot->has_stats)
+			memcpy(&slot->stats, indstats[i], sizeof(IndexBulkDeleteResult));
+	}
+	lvshared->next_index = 0;
+
+	memset(&worker, 0, sizeof(worker));
+	snprintf(worker.bgw_name, BGW_MAXLEN, "parallel vacuum worker for PID %d",
+			 MyProcPid);
+	worker.bgw_flags =
+		BGWORKER_SHMEM_ACCESS | BGWORKER_BACKEND_DATABASE_CONNECTION;
+	worker.bgw_start_time = BgWorkerStart_ConsistentState;
+	worker.bgw_restart_time = BGW_NEVER_RESTART;
+	worker.bgw_main = lazy_parallel_vacuum_main;
+	worker.bgw_main_arg = UInt32GetDatum(dsm_segment_handle(lps->seg));
+	worker.bgw_notify_pid = MyProcPid;
+
+	handles = (BackgroundWorkerHandle **)
+		palloc(lps->nworkers * sizeof(BackgroundWorkerHandle *));
+	leader_vacuumed = (bool *) palloc0(nindexes * sizeof(bool));
+
+	/* The postmaster tells us about the workers' exits with SIGUSR1 */
+	set_latch_on_sigusr1 = true;
+
+	PG_TRY();
+	{
+		/* If we run out of worker slots, just make do with what we got */
+		for (i = 0; i < lps->nworkers; i++)
+		{
+			if (!RegisterDynamicBackgroundWorker(&worker, &handles[nlaunched]))
+				break;
+			nlaunched++;
+		}
+
+		ereport(elevel,
+				(errmsg("launched %d of %d parallel vacuum workers for index vacuuming",
+						nlaunched, lps->nworkers)));
+
+		if (nlaunched > 0)
+			VacuumCostLimit = lvshared->cost_limit;
+
+		/* Vacuum indexes alongside the workers */
+		while ((i = lazy_parallel_next_index(lvshared)) >= 0)
+		{
+			lazy_vacuum_index(Irel[i], &indstats[i], vacrelstats);
+			leader_vacuumed[i] = true;
+		}
+
+		/* They must all be gone before the TID store can change */
+		for (i = 0; i < nlaunched; i++)
+			lazy_parallel_wait_for_worker(handles[i]);
+	}
+	PG_CATCH();
+	{
+		/*
+		 * The workers still use the segment and the TID store, so don't let
+		 * the error unwind past them.  Holding interrupts keeps another
+		 * cancel from cutting the wait short.
+		 */
+		HOLD_INTERRUPTS();
+		for (i = 0; i < nlaunched; i++)
+			TerminateBackgroundWorker(handles[i]);
+		for (i = 0; i < nlaunched; i++)
+			WaitForBackgroundWorkerShutdown(handles[i]);
+		RESUME_INTERRUPTS();
+		VacuumCostLimit = save_cost_limit;
+		set_latch_on_sigusr1 = save_set_latch_on_sigusr1;
+		PG_RE_THROW();
+	}
+	PG_END_TRY();
+
+	VacuumCostLimit = save_cost_limit;
+	set_latch_on_sigusr1 = save_set_latch_on_sigusr1;
+
+	/* Collect the workers' results, and vacuum what they left over */
+	for (i = 0; i < nindexes; i++)
+	{
+		LVSharedIndex *slot = &lvshared->indexes[i];
+
+		if (leader_vacuumed[i])
+			continue;
+
+		if (!slot->vacuumed)
+		{
+			lazy_vacuum_index(Irel[i], &indstats[i], vacrelstats);
+			continue;
+		}
+
+		if (slot->has_stats)
+		{
+			if (indstats[i] == NULL)
+				indstats[i] = (IndexBulkDeleteResult *)
+					palloc(sizeof(IndexBulkDeleteResult));
+			memcpy(indstats[i], &slot->stats, sizeof(IndexBulkDeleteResult));
+		}
+
+		ereport(elevel,
+				(errmsg("scanned index \"%s\" to remove %.0f row versions",
+						RelationGetRelationName(Irel[i]),
+						(double) tidstore_num_tids(vacrelstats->dead_tids)),
+				 errdetail("%s.", slot->rusage)));
+	}
+
+	pfree(handles);
+	pfree(leader_vacuumed);
+}
+
+/*
+ * lazy_parallel_next_index - claim the next index to vacuum, or return -1
+ */
+static int
+lazy_parallel_next_index(LVShared *lvshared)
+{
+	int			i = -1;
+
+	SpinLockAcquire(&lvshared->mutex);
+	if (lvshared->next_index < lvshared->nindexes)
+		i = lvshared->next_index++;
+	SpinLockRelease(&lvshared->mutex);
+
+	return i;
+}
+
+/*
+ * lazy_parallel_wait_for_worker - wait for a worker to exit
+ *
+ * Since we registered as the worker's notify process, the postmaster
+ * signals us whenever the worker starts or stops; the caller must have set
+ * set_latch_on_sigusr1 so that this sets our latch.
+ */
+static void
+lazy_parallel_wait_for_worker(BackgroundWorkerHandle *handle)
+{
+	for (;;)
+	{
+		BgwHandleStatus status;
+		pid_t		pid;
+		int			rc;
+
+		CHECK_FOR_INTERRUPTS();
+
+		status = GetBackgroundWorkerPid(handle, &pid);
+		if (status == BGWH_STOPPED)
+			return;
+		if (status == BGWH_POSTMASTER_DIED)
+			ereport(FATAL,
+					(errcode(ERRCODE_ADMIN_SHUTDOWN),
+					 errmsg("postmaster exited during a parallel vacuum")));
+
+		rc = WaitLatch(MyLatch, WL_LATCH_SET | WL_POSTMASTER_DEATH, 0);
+		if (rc & WL_POSTMASTER_DEATH)
+			ereport(FATAL,
+					(errcode(ERRCODE_ADMIN_SHUTDOWN),
+					 errmsg("postmaster exited during a parallel vacuum")));
+		ResetLatch(MyLatch);
+	}
+}
+
+/*
+ * lazy_parallel_vacuum_main - entry point of a parallel vacuum worker
+ *
+ * The worker bulk-deletes indexes until there are none left in this pass.
+ * An error simply ends the worker; the leader then vacuums whatever index
+ * the worker was working on.
+ */
+static void
+lazy_parallel_vacuum_main(Datum main_arg)
+{
+	dsm_segment *seg;
+	shm_toc    *toc;
+	LVShared   *lvshared;
+	TidStore   *dead_tids;
+	char	   *gucstate;
+	BufferAccessStrategy bstrategy;
+	int			i;
+
+	pqsignal(SIGTERM, die);
+	BackgroundWorkerUnblockSignals();
+
+	CurrentResourceOwner = ResourceOwnerCreate(NULL, "parallel vacuum worker");
+
+	seg = dsm_attach(DatumGetUInt32(main_arg));
+	if (seg == NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("could not map dynamic shared memory segment")));
+	toc = shm_toc_attach(PARALLEL_VACUUM_MAGIC, dsm_segment_address(seg));
+	if (toc == NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+			   errmsg("invalid magic number in dynamic shared memory segment")));
+	lvshared = (LVShared *) shm_toc_lookup(toc, PARALLEL_VACUUM_KEY_SHARED);
+	dead_tids = (TidStore *) shm_toc_lookup(toc, PARALLEL_VACUUM_KEY_DEAD_TIDS);
+	gucstate = (char *) shm_toc_lookup(toc, PARALLEL_VACUUM_KEY_GUC);
+
+	/*
+	 * Connect as the bootstrap superuser, so that we don't trip over the
+	 * login restrictions of the leader's role.
+	 */
+	BackgroundWorkerInitializeConnectionByOid(lvshared->dboid, InvalidOid);
+
+	StartTransactionCommand();
+	RestoreGUCState(gucstate);
+
+	/*
+	 * Bulk deletion can run user-defined code, e.g. GIN's pending list
+	 * cleanup evaluates the opclass functions.  Run it as the table owner
+	 * under the same restrictions as the leader; see vacuum_rel().
+	 */
+	SetUserIdAndSecContext(lvshared->relowner, SECURITY_RESTRICTED_OPERATION);
+
+	/* Let concurrent VACUUMs ignore us, as they ignore the leader */
+	LWLockAcquire(ProcArrayLock, LW_EXCLUSIVE);
+	MyPgXact->vacuumFlags |= PROC_IN_VACUUM;
+	LWLockRelease(ProcArrayLock);
+
+	VacuumCostLimit = lvshared->cost_limit;
+	VacuumCostActive = (VacuumCostDelay > 0);
+	VacuumCostBalance = 0;
+
+	bstrategy = GetAccessStrategy(BAS_VACUUM);
+
+	while ((i = lazy_parallel_next_index(lvshared)) >= 0)
+	{
+		LVSharedIndex *slot = &lvshared->indexes[i];
+		IndexBulkDeleteResult *stats = NULL;
+		IndexVacuumInfo ivinfo;
+		Relation	indrel;
+		PGRUsage	ru0;
+
+		/* leave the index to the leader rather than risk an unseen deadlock */
+		if (!ConditionalLockRelationOid(slot->indexoid, RowExclusiveLock))
+			continue;
+		indrel = index_open(slot->indexoid, NoLock);
+
+		pg_rusage_init(&ru0);
+
+		if (slot->has_stats)
+		{
+			stats = (IndexBulkDeleteResult *)
+				palloc(sizeof(IndexBulkDeleteResult));
+			memcpy(stats, &slot->stats, sizeof(IndexBulkDeleteResult));
+		}
+
+		ivinfo.index = indrel;
+		ivinfo.analyze_only = false;
+		ivinfo.estimated_count = true;
+		ivinfo.message_level = lvshared->elevel;
+		ivinfo.num_heap_tuples = lvshared->num_heap_tuples;
+		ivinfo.strategy = bstrategy;
+
+		stats = index_bulk_delete(&ivinfo, stats,
+								  lazy_tid_reaped, (void *) dead_tids);
+
+		/* nobody else looks at the slot until the leader has seen us exit */
+		slot->has_stats = (stats != NULL);
+		if (stats != NULL)
+			memcpy(&slot->stats, stats, sizeof(IndexBulkDeleteResult));
+		strlcpy(slot->rusage, pg_rusage_show(&ru0), sizeof(slot->rusage));
+		slot->vacuumed = true;
+
+		/* keep the lock until commit */
+		index_close(indrel, NoLock);
+		if (stats != NULL)
+			pfree(stats);
+	}
+
+	CommitTransactionCommand();
+	dsm_detach(seg);
+}
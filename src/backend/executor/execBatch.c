@@ -0,0 +1,450 @@
+/*-------------------------------------------------------------------------
+ *
+ * execBatch.c
+ *	  Routines for batch-at-a-time execution.
+ *
+ * The qual and aggregation kernels here run over whole column arrays of a
+ * TupleBatch.  They are written without data-dependent branches, treating
+ * rows that failed the quals (or are null) as contributing nothing, so that
+ * the compiler can vectorize them; this file is compiled with
+ * CFLAGS_VECTOR for that reason.
+ *
+ * The kernels work on int2, int4 and int8 columns, computing in int64.
+ * Each is instantiated for the three lengths, so that the conversion from
+ * Datum is not decided per value.  (int8 columns are only transported where
+ * int8 is pass-by-value, ie, where Datum is 64 bits wide.)
+ *
+ *
+ * Portions Copyright (c) 1996-2015, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/executor/execBatch.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/skey.h"
+#include "catalog/pg_opfamily.h"
+#include "catalog/pg_type.h"
+#include "executor/execBatch.h"
+#include "nodes/nodeFuncs.h"
+#include "utils/lsyscache.h"
+
+
+/* GUC */
+bool		batch_execution = true;
+
+#define BATCH_INT64_MIN		(-INT64CONST(0x7FFFFFFFFFFFFFFF) - 1)
+#define BATCH_INT64_MAX		INT64CONST(0x7FFFFFFFFFFFFFFF)
+
+/* Run LOOP(get), with get the DatumGetXXX macro for an integer column */
+#define BATCH_INT_SWITCH(attlen, LOOP) \
+	switch (attlen) \
+	{ \
+		case sizeof(int16): \
+			LOOP(DatumGetInt16); \
+			break; \
+		case sizeof(int32): \
+			LOOP(DatumGetInt32); \
+			break; \
+		default: \
+			LOOP(DatumGetInt64); \
+			break; \
+	}
+
+
+/*
+ * Make an empty batch, with room for up to maxcols columns and maxquals
+ * quals.
+ */
+TupleBatch *
+MakeTupleBatch(int maxcols, int maxquals)
+{
+	TupleBatch *batch;
+
+	batch = (TupleBatch *) palloc0(sizeof(TupleBatch));
+	batch->maxcols = maxcols;
+	batch->attnums = (AttrNumber *) palloc(maxcols * sizeof(AttrNumber));
+	batch->attlens = (int16 *) palloc(maxcols * sizeof(int16));
+	batch->quals = (BatchQual *) palloc(Max(maxquals, 1) * sizeof(BatchQual));
+	batch->selected = (bool *) palloc(EXEC_BATCH_SIZE * sizeof(bool));
+	batch->values = (Datum **) palloc(maxcols * sizeof(Datum *));
+	batch->isnull = (bool **) palloc(maxcols * sizeof(bool *));
+
+	return batch;
+}
+
+/*
+ * Add a column to a batch, returning its index.
+ */
+int
+AddBatchColumn(TupleBatch *batch, AttrNumber attnum, int16 attlen)
+{
+	int			col = batch->ncols++;
+
+	Assert(col < batch->maxcols);
+	Assert(attnum > 0);
+
+	batch->attnums[col] = attnum;
+	batch->attlens[col] = attlen;
+	batch->maxattnum = Max(batch->maxattnum, attnum);
+	batch->values[col] = (Datum *) palloc(EXEC_BATCH_SIZE * sizeof(Datum));
+	batch->isnull[col] = (bool *) palloc(EXEC_BATCH_SIZE * sizeof(bool));
+
+	return col;
+}
+
+/*
+ * If this is an integer type whose values can be transported in a batch,
+ * return its length, else 0.
+ */
+static int16
+batch_int_typlen(Oid typid)
+{
+	switch (typid)
+	{
+		case INT2OID:
+			return sizeof(int16);
+		case INT4OID:
+			return sizeof(int32);
+		case INT8OID:
+#ifdef USE_FLOAT8_BYVAL			/* controls int8 too */
+			return sizeof(int64);
+#else
+			return 0;
+#endif
+		default:
+			return 0;
+	}
+}
+
+/*
+ * Set up the quals of a batch from a scan node's (implicitly ANDed) qual
+ * list, adding the columns they need.  The batch must have been made with
+ * room for all of the quals.
+ *
+ * Returns false if any of the quals is something other than a comparison
+ * of an integer column of the scanned relation with a non-null integer
+ * constant; the batch is then unusable.
+ */
+bool
+ExecBatchBuildQuals(TupleBatch *batch, List *qual, Index scanrelid)
+{
+	ListCell   *lc;
+
+	foreach(lc, qual)
+	{
+		OpExpr	   *opexpr = (OpExpr *) lfirst(lc);
+		Node	   *leftop;
+		Node	   *rightop;
+		Var		   *var;
+		Const	   *con;
+		Oid			opno;
+		bool		negate = false;
+		bool		commuted = false;
+		int			strategy;
+		BatchQual  *bqual;
+		int			col;
+
+		if (!IsA(opexpr, OpExpr) || list_length(opexpr->args) != 2)
+			return false;
+		leftop = (Node *) linitial(opexpr->args);
+		rightop = (Node *) lsecond(opexpr->args);
+
+		if (IsA(leftop, Var) && IsA(rightop, Const))
+		{
+			var = (Var *) leftop;
+			con = (Const *) rightop;
+		}
+		else if (IsA(leftop, Const) && IsA(rightop, Var))
+		{
+			var = (Var *) rightop;
+			con = (Const *) leftop;
+			commuted = true;
+		}
+		else
+			return false;
+
+		if (var->varno != scanrelid || var->varlevelsup != 0 ||
+			var->varattno <= 0 || batch_int_typlen(var->vartype) == 0)
+			return false;
+		if (con->constisnull || batch_int_typlen(con->consttype) == 0)
+			return false;
+
+		/*
+		 * The operator must be one of the btree comparison operators for
+		 * integers, or the negator of integer equality.  Those have the
+		 * obvious semantics, so we needn't call them.
+		 */
+		opno = opexpr->opno;
+		strategy = get_op_opfamily_strategy(opno, INTEGER_BTREE_FAM_OID);
+		if (strategy == 0)
+		{
+			opno = get_negator(opno);
+			if (!OidIsValid(opno) ||
+				get_op_opfamily_strategy(opno, INTEGER_BTREE_FAM_OID) !=
+				BTEqualStrategyNumber)
+				return false;
+			strategy = BTEqualStrategyNumber;
+			negate = true;
+		}
+
+		bqual = &batch->quals[batch->nquals++];
+
+		/* reuse the column if we're transporting it already */
+		for (col = 0; col < batch->ncols; col++)
+		{
+			if (batch->attnums[col] == var->varattno)
+				break;
+		}
+		if (col == batch->ncols)
+		{
+			if (batch->ncols >= batch->maxcols)
+				return false;
+			col = AddBatchColumn(batch, var->varattno,
+								 batch_int_typlen(var->vartype));
+		}
+		bqual->col = col;
+
+		switch (con->consttype)
+		{
+			case INT2OID:
+				bqual->constval = DatumGetInt16(con->constvalue);
+				break;
+			case INT4OID:
+				bqual->constval = DatumGetInt32(con->constvalue);
+				break;
+			default:
+				bqual->constval = DatumGetInt64(con->constvalue);
+				break;
+		}
+
+		switch (strategy)
+		{
+			case BTLessStrategyNumber:
+				bqual->cmptype = commuted ? BATCH_CMP_GT : BATCH_CMP_LT;
+				break;
+			case BTLessEqualStrategyNumber:
+				bqual->cmptype = commuted ? BATCH_CMP_GE : BATCH_CMP_LE;
+				break;
+			case BTEqualStrategyNumber:
+				bqual->cmptype = negate ? BATCH_CMP_NE : BATCH_CMP_EQ;
+				break;
+			case BTGreaterEqualStrategyNumber:
+				bqual->cmptype = commuted ? BATCH_CMP_LE : BATCH_CMP_GE;
+				break;
+			case BTGreaterStrategyNumber:
+				bqual->cmptype = commuted ? BATCH_CMP_LT : BATCH_CMP_GT;
+				break;
+			default:
+				elog(ERROR, "unrecognized StrategyNumber: %d", strategy);
+		}
+	}
+
+	return true;
+}
+
+#define BATCH_QUAL_LOOP(get, op) \
+	for (i = 0; i < nrows; i++) \
+		selected[i] &= !isnull[i] & ((int64) get(values[i]) op constval)
+
+#define BATCH_QUAL_CASES(get) \
+	switch (qual->cmptype) \
+	{ \
+		case BATCH_CMP_LT: \
+			BATCH_QUAL_LOOP(get, <); \
+			break; \
+		case BATCH_CMP_LE: \
+			BATCH_QUAL_LOOP(get, <=); \
+			break; \
+		case BATCH_CMP_EQ: \
+			BATCH_QUAL_LOOP(get, ==); \
+			break; \
+		case BATCH_CMP_GE: \
+			BATCH_QUAL_LOOP(get, >=); \
+			break; \
+		case BATCH_CMP_GT: \
+			BATCH_QUAL_LOOP(get, >); \
+			break; \
+		case BATCH_CMP_NE: \
+			BATCH_QUAL_LOOP(get, !=); \
+			break; \
+	}
+
+/*
+ * Evaluate the quals of a batch, setting its selection array.
+ */
+void
+ExecBatchQual(TupleBatch *batch)
+{
+	int			nrows = batch->nrows;
+	bool	   *selected = batch->selected;
+	int			nselected = 0;
+	int			q;
+	int			i;
+
+	memset(selected, true, nrows * sizeof(bool));
+
+	for (q = 0; q < batch->nquals; q++)
+	{
+		BatchQual  *qual = &batch->quals[q];
+		Datum	   *values = batch->values[qual->col];
+		bool	   *isnull = batch->isnull[qual->col];
+		int64		constval = qual->constval;
+
+		BATCH_INT_SWITCH(batch->attlens[qual->col], BATCH_QUAL_CASES);
+	}
+
+	for (i = 0; i < nrows; i++)
+		nselected += selected[i];
+	batch->nselected = nselected;
+}
+
+/*
+ * Count the selected non-null values of a column.
+ */
+int64
+ExecBatchCount(TupleBatch *batch, int col)
+{
+	int			nrows = batch->nrows;
+	bool	   *selected = batch->selected;
+	bool	   *isnull = batch->isnull[col];
+	int64		count = 0;
+	int			i;
+
+	for (i = 0; i < nrows; i++)
+		count += selected[i] & !isnull[i];
+
+	return count;
+}
+
+#define BATCH_SUM_LOOP(get) \
+	for (i = 0; i < nrows; i++) \
+	{ \
+		bool		ok = selected[i] & !isnull[i]; \
+		\
+		count += ok; \
+		total += ok ? (int64) get(values[i]) : 0; \
+	}
+
+/*
+ * Sum the selected non-null values of an int2 or int4 column into *sum,
+ * returning their number.  A batch is too short for that to overflow.
+ */
+int64
+ExecBatchSumInt(TupleBatch *batch, int col, int64 *sum)
+{
+	int			nrows = batch->nrows;
+	bool	   *selected = batch->selected;
+	Datum	   *values = batch->values[col];
+	bool	   *isnull = batch->isnull[col];
+	int64		count = 0;
+	int64		total = 0;
+	int			i;
+
+	Assert(batch->attlens[col] != sizeof(int64));
+	BATCH_INT_SWITCH(batch->attlens[col], BATCH_SUM_LOOP);
+
+	*sum = total;
+	return count;
+}
+
+/*
+ * Sum the selected non-null values of an int8 column, returning their
+ * number.  To avoid overflow the sum is computed in two parts, the sum of
+ * the values' high halves (as signed numbers) and that of their low halves
+ * (unsigned); the total is *sum_hi * 2^32 + *sum_lo.
+ */
+int64
+ExecBatchSumInt8(TupleBatch *batch, int col, int64 *sum_hi, int64 *sum_lo)
+{
+	int			nrows = batch->nrows;
+	bool	   *selected = batch->selected;
+	Datum	   *values = batch->values[col];
+	bool	   *isnull = batch->isnull[col];
+	int64		count = 0;
+	int64		hi = 0;
+	int64		lo = 0;
+	int			i;
+
+	Assert(batch->attlens[col] == sizeof(int64));
+
+	for (i = 0; i < nrows; i++)
+	{
+		bool		ok = selected[i] & !isnull[i];
+		uint64		v = (uint64) DatumGetInt64(values[i]);
+
+		count += ok;
+		hi += ok ? (int64) (int32) (v >> 32) : 0;
+		lo += ok ? (int64) (v & UINT64CONST(0xFFFFFFFF)) : 0;
+	}
+
+	*sum_hi = hi;
+	*sum_lo = lo;
+	return count;
+}
+
+#define BATCH_MAX_LOOP(get) \
+	for (i = 0; i < nrows; i++) \
+	{ \
+		bool		ok = selected[i] & !isnull[i]; \
+		int64		v = (int64) get(values[i]); \
+		\
+		max = (ok && v > max) ? v : max; \
+		found |= ok; \
+	}
+
+/*
+ * Compute the largest of the selected non-null values of a column.
+ * Returns false if there are none.
+ */
+bool
+ExecBatchMaxInt(TupleBatch *batch, int col, int64 *result)
+{
+	int			nrows = batch->nrows;
+	bool	   *selected = batch->selected;
+	Datum	   *values = batch->values[col];
+	bool	   *isnull = batch->isnull[col];
+	int64		max = BATCH_INT64_MIN;
+	bool		found = false;
+	int			i;
+
+	BATCH_INT_SWITCH(batch->attlens[col], BATCH_MAX_LOOP);
+
+	*result = max;
+	return found;
+}
+
+#define BATCH_MIN_LOOP(get) \
+	for (i = 0; i < nrows; i++) \
+	{ \
+		bool		ok = selected[i] & !isnull[i]; \
+		int64		v = (int64) get(values[i]); \
+		\
+		min = (ok && v < min) ? v : min; \
+		found |= ok; \
+	}
+
+/*
+ * Compute the smallest of the selected non-null values of a column.
+ * Returns false if there are none.
+ */
+bool
+ExecBatchMinInt(TupleBatch *batch, int col, int64 *result)
+{
+	int			nrows = batch->nrows;
+	bool	   *selected = batch->selected;
+	Datum	   *values = batch->values[col];
+	bool	   *isnull = batch->isnull[col];
+	int64		min = BATCH_INT64_MAX;
+	bool		found = false;
+	int			i;
+
+	BATCH_INT_SWITCH(batch->attlens[col], BATCH_MIN_LOOP);
+
+	*result = min;
+	return found;
+}
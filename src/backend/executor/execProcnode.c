@@ -20,6 +20,7 @@
  *	 INTERFACE ROUTINES
  *		ExecInitNode	-		initialize a plan node and its subplans
  *		ExecProcNode	-		get a tuple by executing the plan node
+ *		ExecProcNodeBatch -		get a batch of rows from the plan node
  *		ExecEndNode		-		shut down a plan node and its subplans
  *
  *	 NOTES
@@ -77,6 +78,7 @@
  */
 #include "postgres.h"
 
+#include "executor/execBatch.h"
 #include "executor/executor.h"
 #include "executor/nodeAgg.h"
 #include "executor/nodeAppend.h"
@@ -88,6 +90,7 @@
 #include "executor/nodeCustom.h"
 #include "executor/nodeForeignscan.h"
 #include "executor/nodeFunctionscan.h"
+#include "executor/nodeGather.h"
 #include "executor/nodeGroup.h"
 #include "executor/nodeHash.h"
 #include "executor/nodeHashjoin.h"
@@ -321,6 +324,11 @@ ExecInitNode(Plan *node, EState *estate, int eflags)
 												 estate, eflags);
 			break;
 
+		case T_Gather:
+			result = (PlanState *) ExecInitGather((Gather *) node,
+												  estate, eflags);
+			break;
+
 		default:
 			elog(ERROR, "unrecognized node type: %d", (int) nodeTag(node));
 			result = NULL;		/* keep compiler quiet */
@@ -510,6 +518,10 @@ ExecProcNode(PlanState *node)
 			result = ExecLimit((LimitState *) node);
 			break;
 
+		case T_GatherState:
+			result = ExecGather((GatherState *) node);
+			break;
+
 		default:
 			elog(ERROR, "unrecognized node type: %d", (int) nodeTag(node));
 			result = NULL;
@@ -578,6 +590,73 @@ MultiExecProcNode(PlanState *node)
 }
 
 
+/* ----------------------------------------------------------------
+ *		ExecInitBatch
+ *
+ *		Set up to fetch the given output columns (numbered from 1) of
+ *		a node in batches, see execBatch.h.  Returns NULL if the node
+ *		can't do that for these columns, or batch execution is disabled;
+ *		the caller must then use ExecProcNode as usual.
+ * ----------------------------------------------------------------
+ */
+TupleBatch *
+ExecInitBatch(PlanState *node, int ncols, AttrNumber *cols)
+{
+	if (!batch_execution)
+		return NULL;
+
+	switch (nodeTag(node))
+	{
+		case T_SeqScanState:
+			return ExecSeqScanInitBatch((SeqScanState *) node, ncols, cols);
+
+		default:
+			return NULL;
+	}
+}
+
+/* ----------------------------------------------------------------
+ *		ExecProcNodeBatch
+ *
+ *		Fill a batch set up by ExecInitBatch with the next rows of
+ *		the node.  Returns false when there are no more rows.
+ *
+ * This has the same responsibilities as ExecProcNode; the instrumentation
+ * counts the rows that passed the node's quals.
+ * ----------------------------------------------------------------
+ */
+bool
+ExecProcNodeBatch(PlanState *node, TupleBatch *batch)
+{
+	bool		result;
+
+	CHECK_FOR_INTERRUPTS();
+
+	if (node->chgParam != NULL) /* something changed */
+		ExecReScan(node);		/* let ReScan handle this */
+
+	if (node->instrument)
+		InstrStartNode(node->instrument);
+
+	switch (nodeTag(node))
+	{
+		case T_SeqScanState:
+			result = ExecSeqScanBatch((SeqScanState *) node, batch);
+			break;
+
+		default:
+			elog(ERROR, "unrecognized node type: %d", (int) nodeTag(node));
+			result = false;		/* keep compiler quiet */
+			break;
+	}
+
+	if (node->instrument)
+		InstrStopNode(node->instrument, result ? batch->nselected : 0.0);
+
+	return result;
+}
+
+
 /* ----------------------------------------------------------------
  *		ExecEndNode
  *
@@ -750,6 +829,10 @@ ExecEndNode(PlanState *node)
 			ExecEndLimit((LimitState *) node);
 			break;
 
+		case T_GatherState:
+			ExecEndGather((GatherState *) node);
+			break;
+
 		default:
 			elog(ERROR, "unrecognized node type: %d", (int) nodeTag(node));
 			break;
@@ -32,6 +32,10 @@
  *		ExecMakeFunctionResult (and substitute routines) rather than at every
  *		single node.  This is a compromise that trades off precision of the
  *		stack limit setting to gain speed.
+ *
+ *		Expressions made of the most common node types are flattened into a
+ *		linear array of steps on first use, and then run by ExecEvalFlatExpr
+ *		without recursing through the ExprState tree; see execExpr.h.
  */
 
 #include "postgres.h"
@@ -43,8 +47,10 @@
 #include "catalog/pg_type.h"
 #include "commands/typecmds.h"
 #include "executor/execdebug.h"
+#include "executor/execExpr.h"
 #include "executor/nodeSubplan.h"
 #include "funcapi.h"
+#include "jit/jit.h"
 #include "miscadmin.h"
 #include "nodes/makefuncs.h"
 #include "nodes/nodeFuncs.h"
@@ -68,6 +74,9 @@ static bool isAssignmentIndirectionExpr(ExprState *exprstate);
 static Datum ExecEvalAggref(AggrefExprState *aggref,
 			   ExprContext *econtext,
 			   bool *isNull, ExprDoneCond *isDone);
+static Datum ExecEvalGroupingFuncExpr(GroupingFuncExprState *gstate,
+						 ExprContext *econtext,
+						 bool *isNull, ExprDoneCond *isDone);
 static Datum ExecEvalWindowFunc(WindowFuncExprState *wfunc,
 				   ExprContext *econtext,
 				   bool *isNull, ExprDoneCond *isDone);
@@ -182,6 +191,10 @@ static Datum ExecEvalArrayCoerceExpr(ArrayCoerceExprState *astate,
 						bool *isNull, ExprDoneCond *isDone);
 static Datum ExecEvalCurrentOfExpr(ExprState *exprstate, ExprContext *econtext,
 					  bool *isNull, ExprDoneCond *isDone);
+static Datum ExecFlattenExpr(ExprState *state, ExprContext *econtext,
+				bool *isNull, ExprDoneCond *isDone);
+static Datum ExecEvalFlatExpr(ExprState *state, ExprContext *econtext,
+				 bool *isNull, ExprDoneCond *isDone);
 
 
 /* ----------------------------------------------------------------
@@ -539,6 +552,45 @@ ExecEvalAggref(AggrefExprState *aggref, ExprContext *econtext,
 	return econtext->ecxt_aggvalues[aggref->aggno];
 }
 
+/* ----------------------------------------------------------------
+ *		ExecEvalGroupingFuncExpr
+ *
+ *		Return a bitmask with a bit for each (unevaluated) argument expression
+ *		(rightmost arg is least significant bit).
+ *
+ *		A bit is set if the corresponding expression is NOT part of the set of
+ *		grouping expressions in the current grouping set, that is, if the
+ *		column reads as null in the row being projected.
+ * ----------------------------------------------------------------
+ */
+static Datum
+ExecEvalGroupingFuncExpr(GroupingFuncExprState *gstate,
+						 ExprContext *econtext,
+						 bool *isNull,
+						 ExprDoneCond *isDone)
+{
+	int			result = 0;
+	Bitmapset  *nulled_cols = gstate->aggstate->nulled_cols;
+	ListCell   *lc;
+
+	if (isDone)
+		*isDone = ExprSingleResult;
+
+	*isNull = false;
+
+	foreach(lc, (gstate->clauses))
+	{
+		int			attnum = lfirst_int(lc);
+
+		result = result << 1;
+
+		if (bms_is_member(attnum, nulled_cols))
+			result = result | 1;
+	}
+
+	return Int32GetDatum(result);
+}
+
 /* ----------------------------------------------------------------
  *		ExecEvalWindowFunc
  *
@@ -560,6 +612,55 @@ ExecEvalWindowFunc(WindowFuncExprState *wfunc, ExprContext *econtext,
 	return econtext->ecxt_aggvalues[wfunc->wfuncno];
 }
 
+/* ----------------------------------------------------------------
+ *		CheckVarSlotCompatibility
+ *
+ *		Make the one-time checks on a scalar Var done before its value is
+ *		first fetched from the given slot.
+ * ----------------------------------------------------------------
+ */
+void
+CheckVarSlotCompatibility(TupleTableSlot *slot, AttrNumber attnum, Oid vartype)
+{
+	/*
+	 * What we have to check for here is the possibility of an attribute
+	 * having been changed in type since the plan tree was created.  Ideally
+	 * the plan will get invalidated and not re-used, but just in case, we
+	 * keep these defenses.
+	 *
+	 * Note: we allow a reference to a dropped attribute.  slot_getattr will
+	 * force a NULL result in such cases.
+	 *
+	 * Note: ideally we'd check typmod as well as typid, but that seems
+	 * impractical at the moment: in many cases the tupdesc will have been
+	 * generated by ExecTypeFromTL(), and that can't guarantee to generate an
+	 * accurate typmod in all cases, because some expression node types don't
+	 * carry typmod.
+	 */
+	if (attnum > 0)
+	{
+		TupleDesc	slot_tupdesc = slot->tts_tupleDescriptor;
+		Form_pg_attribute attr;
+
+		if (attnum > slot_tupdesc->natts)		/* should never happen */
+			elog(ERROR, "attribute number %d exceeds number of columns %d",
+				 attnum, slot_tupdesc->natts);
+
+		attr = slot_tupdesc->attrs[attnum - 1];
+
+		/* can't check type if dropped, since atttypid is probably 0 */
+		if (!attr->attisdropped)
+		{
+			if (vartype != attr->atttypid)
+				ereport(ERROR,
+						(errmsg("attribute %d has wrong type", attnum),
+						 errdetail("Table has type %s, but query expects %s.",
+								   format_type_be(attr->atttypid),
+								   format_type_be(vartype))));
+		}
+	}
+}
+
 /* ----------------------------------------------------------------
  *		ExecEvalScalarVar
  *
@@ -608,43 +709,10 @@ ExecEvalScalarVar(ExprState *exprstate, ExprContext *econtext,
 
 	/*
 	 * If it's a user attribute, check validity (bogus system attnums will be
-	 * caught inside slot_getattr).  What we have to check for here is the
-	 * possibility of an attribute having been changed in type since the plan
-	 * tree was created.  Ideally the plan will get invalidated and not
-	 * re-used, but just in case, we keep these defenses.  Fortunately it's
-	 * sufficient to check once on the first time through.
-	 *
-	 * Note: we allow a reference to a dropped attribute.  slot_getattr will
-	 * force a NULL result in such cases.
-	 *
-	 * Note: ideally we'd check typmod as well as typid, but that seems
-	 * impractical at the moment: in many cases the tupdesc will have been
-	 * generated by ExecTypeFromTL(), and that can't guarantee to generate an
-	 * accurate typmod in all cases, because some expression node types don't
-	 * carry typmod.
+	 * caught inside slot_getattr).  Fortunately it's sufficient to check once
+	 * on the first time through.
 	 */
-	if (attnum > 0)
-	{
-		TupleDesc	slot_tupdesc = slot->tts_tupleDescriptor;
-		Form_pg_attribute attr;
-
-		if (attnum > slot_tupdesc->natts)		/* should never happen */
-			elog(ERROR, "attribute number %d exceeds number of columns %d",
-				 attnum, slot_tupdesc->natts);
-
-		attr = slot_tupdesc->attrs[attnum - 1];
-
-		/* can't check type if dropped, since atttypid is probably 0 */
-		if (!attr->attisdropped)
-		{
-			if (variable->vartype != attr->atttypid)
-				ereport(ERROR,
-						(errmsg("attribute %d has wrong type", attnum),
-						 errdetail("Table has type %s, but query expects %s.",
-								   format_type_be(attr->atttypid),
-								   format_type_be(variable->vartype))));
-		}
-	}
+	CheckVarSlotCompatibility(slot, attnum, variable->vartype);
 
 	/* Skip the checking on future executions of node */
 	exprstate->evalfunc = ExecEvalScalarVarFast;
@@ -4339,6 +4407,681 @@ ExecEvalCurrentOfExpr(ExprState *exprstate, ExprContext *econtext,
 }
 
 
+/* ----------------------------------------------------------------
+ *		Flattened expression evaluation
+ *
+ * Expression trees rooted at a function or operator call, a boolean
+ * operator or a scalar null test are translated into an ExprEvalProgram
+ * the first time they are evaluated, and thereafter run by
+ * ExecEvalFlatExpr.  As with init_fcache, doing this on first use rather
+ * than in ExecInitExpr avoids the work for expressions that are never
+ * evaluated, and lets us look at the actual input slots.
+ * ----------------------------------------------------------------
+ */
+
+/*
+ * Can the given node be turned into steps of its own, rather than a single
+ * EEOP_EXPR step running its ExprState subtree?
+ */
+static bool
+ExecCanFlattenNode(ExprState *state)
+{
+	Expr	   *node = state->expr;
+
+	switch (nodeTag(node))
+	{
+		case T_Var:
+			return ((Var *) node)->varattno != InvalidAttrNumber;
+		case T_Const:
+			return true;
+		case T_Param:
+			return ((Param *) node)->paramkind == PARAM_EXEC;
+		case T_FuncExpr:
+		case T_OpExpr:
+		case T_RelabelType:
+			return true;
+		case T_BoolExpr:
+			/* AND and OR steps assume there are at least two arguments */
+			return ((BoolExpr *) node)->boolop == NOT_EXPR ||
+				list_length(((BoolExprState *) state)->args) >= 2;
+		case T_NullTest:
+			return !((NullTest *) node)->argisrow;
+		default:
+			return false;
+	}
+}
+
+/*
+ * Return the evalfunc that evaluates the given node, one of those for which
+ * ExecInitExpr installs ExecFlattenExpr, as a tree.
+ */
+static ExprStateEvalFunc
+ExecTreeEvalFunc(ExprState *state)
+{
+	Expr	   *node = state->expr;
+
+	switch (nodeTag(node))
+	{
+		case T_FuncExpr:
+			return (ExprStateEvalFunc) ExecEvalFunc;
+		case T_OpExpr:
+			return (ExprStateEvalFunc) ExecEvalOper;
+		case T_BoolExpr:
+			switch (((BoolExpr *) node)->boolop)
+			{
+				case AND_EXPR:
+					return (ExprStateEvalFunc) ExecEvalAnd;
+				case OR_EXPR:
+					return (ExprStateEvalFunc) ExecEvalOr;
+				case NOT_EXPR:
+					return (ExprStateEvalFunc) ExecEvalNot;
+				default:
+					elog(ERROR, "unrecognized boolop: %d",
+						 (int) ((BoolExpr *) node)->boolop);
+			}
+			break;
+		case T_NullTest:
+			return (ExprStateEvalFunc) ExecEvalNullTest;
+		default:
+			break;
+	}
+
+	elog(ERROR, "unrecognized node type: %d", (int) nodeTag(node));
+	return NULL;				/* keep compiler quiet */
+}
+
+/*
+ * Append a copy of *step to the program, returning its index.
+ */
+static int
+ExprEvalPushStep(ExprEvalProgram *prog, ExprEvalStep *step)
+{
+	if (prog->nsteps >= prog->maxsteps)
+	{
+		prog->maxsteps *= 2;
+		prog->steps = (ExprEvalStep *)
+			repalloc(prog->steps, prog->maxsteps * sizeof(ExprEvalStep));
+	}
+	prog->steps[prog->nsteps] = *step;
+
+	return prog->nsteps++;
+}
+
+/*
+ * Append the steps computing the given ExprState subtree to the program,
+ * arranging for the subtree's value to be stored into resvalue and resnull.
+ */
+static void
+ExecFlattenExprRecurse(ExprEvalProgram *prog, ExprState *state,
+					   ExprContext *econtext,
+					   Datum *resvalue, bool *resnull)
+{
+	Expr	   *node = state->expr;
+	ExprEvalStep scratch;
+
+	/* Guard against stack overflow due to overly complex expressions */
+	check_stack_depth();
+
+	memset(&scratch, 0, sizeof(scratch));
+	scratch.resvalue = resvalue;
+	scratch.resnull = resnull;
+
+	if (!ExecCanFlattenNode(state))
+	{
+		scratch.opcode = EEOP_EXPR;
+		scratch.d.expr.state = state;
+		ExprEvalPushStep(prog, &scratch);
+		return;
+	}
+
+	switch (nodeTag(node))
+	{
+		case T_Var:
+			{
+				Var		   *variable = (Var *) node;
+
+				switch (variable->varno)
+				{
+					case INNER_VAR:
+						scratch.opcode = EEOP_INNER_VAR_FIRST;
+						break;
+					case OUTER_VAR:
+						scratch.opcode = EEOP_OUTER_VAR_FIRST;
+						break;
+						/* INDEX_VAR is handled by default case */
+					default:
+						scratch.opcode = EEOP_SCAN_VAR_FIRST;
+						break;
+				}
+				scratch.d.var.attnum = variable->varattno;
+				scratch.d.var.vartype = variable->vartype;
+				ExprEvalPushStep(prog, &scratch);
+				break;
+			}
+		case T_Const:
+			{
+				Const	   *con = (Const *) node;
+
+				scratch.opcode = EEOP_CONST;
+				scratch.d.constval.value = con->constvalue;
+				scratch.d.constval.isnull = con->constisnull;
+				ExprEvalPushStep(prog, &scratch);
+				break;
+			}
+		case T_Param:
+			scratch.opcode = EEOP_PARAM_EXEC;
+			scratch.d.param.paramid = ((Param *) node)->paramid;
+			ExprEvalPushStep(prog, &scratch);
+			break;
+		case T_FuncExpr:
+		case T_OpExpr:
+			{
+				FuncExprState *fcache = (FuncExprState *) state;
+				FunctionCallInfo fcinfo = &fcache->fcinfo_data;
+				ListCell   *arg;
+				int			i;
+
+				if (fcache->func.fn_oid == InvalidOid)
+				{
+					if (IsA(node, FuncExpr))
+						init_fcache(((FuncExpr *) node)->funcid,
+									((FuncExpr *) node)->inputcollid,
+									fcache, econtext->ecxt_per_query_memory,
+									true);
+					else
+						init_fcache(((OpExpr *) node)->opfuncid,
+									((OpExpr *) node)->inputcollid,
+									fcache, econtext->ecxt_per_query_memory,
+									true);
+				}
+				/* ExecFlattenExpr has made sure there are no sets */
+				Assert(!fcache->func.fn_retset);
+
+				/* Arguments are computed straight into the call struct */
+				i = 0;
+				foreach(arg, fcache->args)
+				{
+					ExecFlattenExprRecurse(prog, (ExprState *) lfirst(arg),
+										   econtext,
+										   &fcinfo->arg[i],
+										   &fcinfo->argnull[i]);
+					i++;
+				}
+
+				if (pgstat_track_functions <= fcache->func.fn_stats)
+					scratch.opcode = fcache->func.fn_strict && i > 0 ?
+						EEOP_FUNCEXPR_STRICT : EEOP_FUNCEXPR;
+				else
+					scratch.opcode = fcache->func.fn_strict && i > 0 ?
+						EEOP_FUNCEXPR_STRICT_FUSAGE : EEOP_FUNCEXPR_FUSAGE;
+				scratch.d.func.fcinfo = fcinfo;
+				scratch.d.func.fn_addr = fcache->func.fn_addr;
+				scratch.d.func.nargs = i;
+				ExprEvalPushStep(prog, &scratch);
+				break;
+			}
+		case T_RelabelType:
+			/* no-op at runtime, just compute the argument in place */
+			ExecFlattenExprRecurse(prog, ((GenericExprState *) state)->arg,
+								   econtext, resvalue, resnull);
+			break;
+		case T_BoolExpr:
+			{
+				BoolExprState *bstate = (BoolExprState *) state;
+				BoolExpr   *boolexpr = (BoolExpr *) node;
+				ListCell   *arg;
+				int		   *jumps;
+				int			njumps = 0;
+				int			i;
+
+				if (boolexpr->boolop == NOT_EXPR)
+				{
+					ExecFlattenExprRecurse(prog,
+										   (ExprState *) linitial(bstate->args),
+										   econtext, resvalue, resnull);
+					scratch.opcode = EEOP_BOOL_NOT;
+					ExprEvalPushStep(prog, &scratch);
+					break;
+				}
+
+				/*
+				 * Each argument is computed into our own result, and followed
+				 * by a step that either jumps to the end, when the result is
+				 * known, or remembers whether a NULL was seen.
+				 */
+				scratch.d.boolexpr.anynull = (bool *) palloc(sizeof(bool));
+				jumps = (int *) palloc(list_length(bstate->args) * sizeof(int));
+
+				foreach(arg, bstate->args)
+				{
+					ExecFlattenExprRecurse(prog, (ExprState *) lfirst(arg),
+										   econtext, resvalue, resnull);
+
+					if (boolexpr->boolop == AND_EXPR)
+					{
+						if (arg == list_head(bstate->args))
+							scratch.opcode = EEOP_BOOL_AND_STEP_FIRST;
+						else if (lnext(arg) == NULL)
+							scratch.opcode = EEOP_BOOL_AND_STEP_LAST;
+						else
+							scratch.opcode = EEOP_BOOL_AND_STEP;
+					}
+					else
+					{
+						if (arg == list_head(bstate->args))
+							scratch.opcode = EEOP_BOOL_OR_STEP_FIRST;
+						else if (lnext(arg) == NULL)
+							scratch.opcode = EEOP_BOOL_OR_STEP_LAST;
+						else
+							scratch.opcode = EEOP_BOOL_OR_STEP;
+					}
+					scratch.d.boolexpr.jumpdone = -1;	/* set below */
+					jumps[njumps++] = ExprEvalPushStep(prog, &scratch);
+				}
+
+				for (i = 0; i < njumps; i++)
+					prog->steps[jumps[i]].d.boolexpr.jumpdone = prog->nsteps;
+				pfree(jumps);
+				break;
+			}
+		case T_NullTest:
+			{
+				NullTestState *nstate = (NullTestState *) state;
+
+				ExecFlattenExprRecurse(prog, nstate->arg, econtext,
+									   resvalue, resnull);
+				if (((NullTest *) node)->nulltesttype == IS_NULL)
+					scratch.opcode = EEOP_NULLTEST_ISNULL;
+				else
+					scratch.opcode = EEOP_NULLTEST_ISNOTNULL;
+				ExprEvalPushStep(prog, &scratch);
+				break;
+			}
+		default:
+			elog(ERROR, "unrecognized node type: %d", (int) nodeTag(node));
+			break;
+	}
+}
+
+/* ----------------------------------------------------------------
+ *		ExecFlattenExpr
+ *
+ *		Build the flattened program for an expression and evaluate it.
+ *
+ * This is called only the first time through; it changes the ExprState's
+ * function pointer to go to ExecEvalFlatExpr on subsequent uses, or, if the
+ * expression can't be flattened, to the node's ordinary evalfunc.  When the
+ * query is to be JIT compiled, the program is handed to the JIT provider,
+ * which installs a compiled function instead if it can.
+ * ----------------------------------------------------------------
+ */
+static Datum
+ExecFlattenExpr(ExprState *state, ExprContext *econtext,
+				bool *isNull, ExprDoneCond *isDone)
+{
+	ExprEvalProgram *prog;
+	ExprEvalStep scratch;
+	MemoryContext oldcontext;
+
+	/*
+	 * Sets are only handled by ExecMakeFunctionResult and friends.  Checking
+	 * the root is enough: expression_returns_set looks through everything
+	 * that we'd flatten.
+	 */
+	if (!ExecCanFlattenNode(state) ||
+		expression_returns_set((Node *) state->expr))
+	{
+		state->evalfunc = ExecTreeEvalFunc(state);
+		return ExecEvalExpr(state, econtext, isNull, isDone);
+	}
+
+	oldcontext = MemoryContextSwitchTo(econtext->ecxt_per_query_memory);
+
+	prog = (ExprEvalProgram *) palloc0(sizeof(ExprEvalProgram));
+	prog->maxsteps = 16;
+	prog->steps = (ExprEvalStep *)
+		palloc(prog->maxsteps * sizeof(ExprEvalStep));
+
+	ExecFlattenExprRecurse(prog, state, econtext,
+						   &prog->resvalue, &prog->resnull);
+
+	memset(&scratch, 0, sizeof(scratch));
+	scratch.opcode = EEOP_DONE;
+	ExprEvalPushStep(prog, &scratch);
+
+	MemoryContextSwitchTo(oldcontext);
+
+	state->evalprog = prog;
+	state->evalfunc = ExecEvalFlatExpr;
+
+	/* If JIT is enabled for this query, the provider may replace evalfunc */
+	jit_compile_expr(state, econtext);
+
+	return ExecEvalExpr(state, econtext, isNull, isDone);
+}
+
+/*
+ * Out-of-line implementations of the more complex steps, shared by
+ * ExecEvalFlatExpr and JIT compiled expressions.
+ */
+
+/* Evaluate an EEOP_PARAM_EXEC step */
+void
+ExecEvalStepParamExec(ExprEvalStep *op, ExprContext *econtext)
+{
+	ParamExecData *prm;
+
+	prm = &(econtext->ecxt_param_exec_vals[op->d.param.paramid]);
+	if (prm->execPlan != NULL)
+	{
+		/* Parameter not evaluated yet, so go do it */
+		ExecSetParamPlan(prm->execPlan, econtext);
+		/* ExecSetParamPlan should have processed this param... */
+		Assert(prm->execPlan == NULL);
+	}
+	*op->resvalue = prm->value;
+	*op->resnull = prm->isnull;
+}
+
+/*
+ * Call the function of an EEOP_FUNCEXPR_FUSAGE or
+ * EEOP_FUNCEXPR_STRICT_FUSAGE step, once any null arguments have been dealt
+ * with.
+ */
+void
+ExecEvalStepFuncUsage(ExprEvalStep *op, ExprContext *econtext)
+{
+	FunctionCallInfo fcinfo = op->d.func.fcinfo;
+	PgStat_FunctionCallUsage fcusage;
+
+	pgstat_init_function_usage(fcinfo, &fcusage);
+	fcinfo->isnull = false;
+	*op->resvalue = (op->d.func.fn_addr) (fcinfo);
+	*op->resnull = fcinfo->isnull;
+	pgstat_end_function_usage(&fcusage, true);
+}
+
+/* Evaluate an EEOP_EXPR step */
+void
+ExecEvalStepExpr(ExprEvalStep *op, ExprContext *econtext)
+{
+	*op->resvalue = ExecEvalExpr(op->d.expr.state, econtext,
+								 op->resnull, NULL);
+}
+
+/*
+ * Fetch a scalar Var's value, taking it directly from the slot's arrays if
+ * the tuple has already been deformed that far.
+ */
+static inline Datum
+ExecFetchVar(TupleTableSlot *slot, AttrNumber attnum, bool *isNull)
+{
+	if (attnum > 0 && attnum <= slot->tts_nvalid)
+	{
+		*isNull = slot->tts_isnull[attnum - 1];
+		return slot->tts_values[attnum - 1];
+	}
+	return slot_getattr(slot, attnum, isNull);
+}
+
+/*
+ * With GCC and compatible compilers the interpreter jumps straight from the
+ * end of one step to the code of the next, through a table of label
+ * addresses, rather than going back through a switch statement.  That
+ * makes the branches much more predictable.
+ */
+#if defined(__GNUC__)
+#define EEO_USE_COMPUTED_GOTO
+#endif
+
+#ifdef EEO_USE_COMPUTED_GOTO
+#define EEO_SWITCH()
+#define EEO_CASE(name)		CASE_##name
+#define EEO_DISPATCH()		goto *dispatch_table[op->opcode]
+#else
+#define EEO_SWITCH()		starteval: switch ((int) op->opcode)
+#define EEO_CASE(name)		case name
+#define EEO_DISPATCH()		goto starteval
+#endif
+
+#define EEO_NEXT() \
+	do { \
+		op++; \
+		EEO_DISPATCH(); \
+	} while (0)
+
+#define EEO_JUMP(stepno) \
+	do { \
+		op = &prog->steps[stepno]; \
+		EEO_DISPATCH(); \
+	} while (0)
+
+/* ----------------------------------------------------------------
+ *		ExecEvalFlatExpr
+ *
+ *		Run the flattened program of an expression.
+ * ----------------------------------------------------------------
+ */
+static Datum
+ExecEvalFlatExpr(ExprState *state, ExprContext *econtext,
+				 bool *isNull, ExprDoneCond *isDone)
+{
+	ExprEvalProgram *prog = state->evalprog;
+	ExprEvalStep *op = prog->steps;
+
+#ifdef EEO_USE_COMPUTED_GOTO
+	static const void *const dispatch_table[] = {
+		&&CASE_EEOP_DONE,
+		&&CASE_EEOP_INNER_VAR_FIRST,
+		&&CASE_EEOP_OUTER_VAR_FIRST,
+		&&CASE_EEOP_SCAN_VAR_FIRST,
+		&&CASE_EEOP_INNER_VAR,
+		&&CASE_EEOP_OUTER_VAR,
+		&&CASE_EEOP_SCAN_VAR,
+		&&CASE_EEOP_CONST,
+		&&CASE_EEOP_PARAM_EXEC,
+		&&CASE_EEOP_FUNCEXPR,
+		&&CASE_EEOP_FUNCEXPR_STRICT,
+		&&CASE_EEOP_FUNCEXPR_FUSAGE,
+		&&CASE_EEOP_FUNCEXPR_STRICT_FUSAGE,
+		&&CASE_EEOP_BOOL_AND_STEP_FIRST,
+		&&CASE_EEOP_BOOL_AND_STEP,
+		&&CASE_EEOP_BOOL_AND_STEP_LAST,
+		&&CASE_EEOP_BOOL_OR_STEP_FIRST,
+		&&CASE_EEOP_BOOL_OR_STEP,
+		&&CASE_EEOP_BOOL_OR_STEP_LAST,
+		&&CASE_EEOP_BOOL_NOT,
+		&&CASE_EEOP_NULLTEST_ISNULL,
+		&&CASE_EEOP_NULLTEST_ISNOTNULL,
+		&&CASE_EEOP_EXPR
+	};
+
+	StaticAssertStmt(lengthof(dispatch_table) == EEOP_LAST,
+					 "dispatch_table out of whack with ExprEvalOp");
+#endif
+
+	if (isDone)
+		*isDone = ExprSingleResult;
+
+	EEO_DISPATCH();
+
+	EEO_SWITCH()
+	{
+		EEO_CASE(EEOP_DONE):
+			goto out;
+
+		EEO_CASE(EEOP_INNER_VAR_FIRST):
+			CheckVarSlotCompatibility(econtext->ecxt_innertuple,
+									  op->d.var.attnum, op->d.var.vartype);
+			op->opcode = EEOP_INNER_VAR;
+			/* FALLTHROUGH */
+
+		EEO_CASE(EEOP_INNER_VAR):
+			*op->resvalue = ExecFetchVar(econtext->ecxt_innertuple,
+										 op->d.var.attnum, op->resnull);
+			EEO_NEXT();
+
+		EEO_CASE(EEOP_OUTER_VAR_FIRST):
+			CheckVarSlotCompatibility(econtext->ecxt_outertuple,
+									  op->d.var.attnum, op->d.var.vartype);
+			op->opcode = EEOP_OUTER_VAR;
+			/* FALLTHROUGH */
+
+		EEO_CASE(EEOP_OUTER_VAR):
+			*op->resvalue = ExecFetchVar(econtext->ecxt_outertuple,
+										 op->d.var.attnum, op->resnull);
+			EEO_NEXT();
+
+		EEO_CASE(EEOP_SCAN_VAR_FIRST):
+			CheckVarSlotCompatibility(econtext->ecxt_scantuple,
+									  op->d.var.attnum, op->d.var.vartype);
+			op->opcode = EEOP_SCAN_VAR;
+			/* FALLTHROUGH */
+
+		EEO_CASE(EEOP_SCAN_VAR):
+			*op->resvalue = ExecFetchVar(econtext->ecxt_scantuple,
+										 op->d.var.attnum, op->resnull);
+			EEO_NEXT();
+
+		EEO_CASE(EEOP_CONST):
+			*op->resvalue = op->d.constval.value;
+			*op->resnull = op->d.constval.isnull;
+			EEO_NEXT();
+
+		EEO_CASE(EEOP_PARAM_EXEC):
+			ExecEvalStepParamExec(op, econtext);
+			EEO_NEXT();
+
+		EEO_CASE(EEOP_FUNCEXPR):
+			{
+				FunctionCallInfo fcinfo = op->d.func.fcinfo;
+
+				fcinfo->isnull = false;
+				*op->resvalue = (op->d.func.fn_addr) (fcinfo);
+				*op->resnull = fcinfo->isnull;
+				EEO_NEXT();
+			}
+
+		EEO_CASE(EEOP_FUNCEXPR_STRICT):
+			{
+				FunctionCallInfo fcinfo = op->d.func.fcinfo;
+				int			i;
+
+				for (i = 0; i < op->d.func.nargs; i++)
+				{
+					if (fcinfo->argnull[i])
+					{
+						*op->resvalue = (Datum) 0;
+						*op->resnull = true;
+						EEO_NEXT();
+					}
+				}
+				fcinfo->isnull = false;
+				*op->resvalue = (op->d.func.fn_addr) (fcinfo);
+				*op->resnull = fcinfo->isnull;
+				EEO_NEXT();
+			}
+
+		EEO_CASE(EEOP_FUNCEXPR_FUSAGE):
+			ExecEvalStepFuncUsage(op, econtext);
+			EEO_NEXT();
+
+		EEO_CASE(EEOP_FUNCEXPR_STRICT_FUSAGE):
+			{
+				FunctionCallInfo fcinfo = op->d.func.fcinfo;
+				int			i;
+
+				for (i = 0; i < op->d.func.nargs; i++)
+				{
+					if (fcinfo->argnull[i])
+					{
+						*op->resvalue = (Datum) 0;
+						*op->resnull = true;
+						EEO_NEXT();
+					}
+				}
+				ExecEvalStepFuncUsage(op, econtext);
+				EEO_NEXT();
+			}
+
+			/*
+			 * For AND, a non-null FALSE argument decides the result.  If none
+			 * turns up, the result is NULL if any argument was NULL, else
+			 * TRUE; cf. ExecEvalAnd.
+			 */
+		EEO_CASE(EEOP_BOOL_AND_STEP_FIRST):
+			*op->d.boolexpr.anynull = false;
+			/* FALLTHROUGH */
+
+		EEO_CASE(EEOP_BOOL_AND_STEP):
+			if (*op->resnull)
+				*op->d.boolexpr.anynull = true;
+			else if (!DatumGetBool(*op->resvalue))
+				EEO_JUMP(op->d.boolexpr.jumpdone);
+			EEO_NEXT();
+
+		EEO_CASE(EEOP_BOOL_AND_STEP_LAST):
+			if (*op->resnull)
+				;				/* result is already NULL */
+			else if (!DatumGetBool(*op->resvalue))
+				EEO_JUMP(op->d.boolexpr.jumpdone);
+			else if (*op->d.boolexpr.anynull)
+			{
+				*op->resvalue = (Datum) 0;
+				*op->resnull = true;
+			}
+			EEO_NEXT();
+
+			/* OR is the same, with the roles of TRUE and FALSE swapped */
+		EEO_CASE(EEOP_BOOL_OR_STEP_FIRST):
+			*op->d.boolexpr.anynull = false;
+			/* FALLTHROUGH */
+
+		EEO_CASE(EEOP_BOOL_OR_STEP):
+			if (*op->resnull)
+				*op->d.boolexpr.anynull = true;
+			else if (DatumGetBool(*op->resvalue))
+				EEO_JUMP(op->d.boolexpr.jumpdone);
+			EEO_NEXT();
+
+		EEO_CASE(EEOP_BOOL_OR_STEP_LAST):
+			if (*op->resnull)
+				;				/* result is already NULL */
+			else if (DatumGetBool(*op->resvalue))
+				EEO_JUMP(op->d.boolexpr.jumpdone);
+			else if (*op->d.boolexpr.anynull)
+			{
+				*op->resvalue = (Datum) 0;
+				*op->resnull = true;
+			}
+			EEO_NEXT();
+
+		EEO_CASE(EEOP_BOOL_NOT):
+			/* a NULL argument gives a NULL result */
+			if (!*op->resnull)
+				*op->resvalue = BoolGetDatum(!DatumGetBool(*op->resvalue));
+			EEO_NEXT();
+
+		EEO_CASE(EEOP_NULLTEST_ISNULL):
+			*op->resvalue = BoolGetDatum(*op->resnull);
+			*op->resnull = false;
+			EEO_NEXT();
+
+		EEO_CASE(EEOP_NULLTEST_ISNOTNULL):
+			*op->resvalue = BoolGetDatum(!*op->resnull);
+			*op->resnull = false;
+			EEO_NEXT();
+
+		EEO_CASE(EEOP_EXPR):
+			ExecEvalStepExpr(op, econtext);
+			EEO_NEXT();
+	}
+
+out:
+	*isNull = prog->resnull;
+	return prog->resvalue;
+}
+
 /*
  * ExecEvalExprSwitchContext
  *
@@ -4491,6 +5234,28 @@ ExecInitExpr(Expr *node, PlanState *parent)
 				state = (ExprState *) astate;
 			}
 			break;
+		case T_GroupingFunc:
+			{
+				GroupingFunc *grp_node = (GroupingFunc *) node;
+				GroupingFuncExprState *grp_state = makeNode(GroupingFuncExprState);
+				Agg		   *agg;
+
+				if (!parent || !IsA(parent, AggState) || !IsA(parent->plan, Agg))
+					elog(ERROR, "parent of GROUPING is not Agg node");
+
+				grp_state->aggstate = (AggState *) parent;
+
+				agg = (Agg *) (parent->plan);
+
+				if (agg->groupingSets)
+					grp_state->clauses = grp_node->cols;
+				else
+					grp_state->clauses = NIL;
+
+				state = (ExprState *) grp_state;
+				state->evalfunc = (ExprStateEvalFunc) ExecEvalGroupingFuncExpr;
+			}
+			break;
 		case T_WindowFunc:
 			{
 				WindowFunc *wfunc = (WindowFunc *) node;
@@ -4558,7 +5323,8 @@ ExecInitExpr(Expr *node, PlanState *parent)
 				FuncExpr   *funcexpr = (FuncExpr *) node;
 				FuncExprState *fstate = makeNode(FuncExprState);
 
-				fstate->xprstate.evalfunc = (ExprStateEvalFunc) ExecEvalFunc;
+				/* see ExecFlattenExpr */
+				fstate->xprstate.evalfunc = ExecFlattenExpr;
 				fstate->args = (List *)
 					ExecInitExpr((Expr *) funcexpr->args, parent);
 				fstate->func.fn_oid = InvalidOid;		/* not initialized */
@@ -4570,7 +5336,8 @@ ExecInitExpr(Expr *node, PlanState *parent)
 				OpExpr	   *opexpr = (OpExpr *) node;
 				FuncExprState *fstate = makeNode(FuncExprState);
 
-				fstate->xprstate.evalfunc = (ExprStateEvalFunc) ExecEvalOper;
+				/* see ExecFlattenExpr */
+				fstate->xprstate.evalfunc = ExecFlattenExpr;
 				fstate->args = (List *)
 					ExecInitExpr((Expr *) opexpr->args, parent);
 				fstate->func.fn_oid = InvalidOid;		/* not initialized */
@@ -4622,13 +5389,10 @@ ExecInitExpr(Expr *node, PlanState *parent)
 				switch (boolexpr->boolop)
 				{
 					case AND_EXPR:
-						bstate->xprstate.evalfunc = (ExprStateEvalFunc) ExecEvalAnd;
-						break;
 					case OR_EXPR:
-						bstate->xprstate.evalfunc = (ExprStateEvalFunc) ExecEvalOr;
-						break;
 					case NOT_EXPR:
-						bstate->xprstate.evalfunc = (ExprStateEvalFunc) ExecEvalNot;
+						/* see ExecFlattenExpr */
+						bstate->xprstate.evalfunc = ExecFlattenExpr;
 						break;
 					default:
 						elog(ERROR, "unrecognized boolop: %d",
@@ -5034,7 +5798,8 @@ ExecInitExpr(Expr *node, PlanState *parent)
 				NullTest   *ntest = (NullTest *) node;
 				NullTestState *nstate = makeNode(NullTestState);
 
-				nstate->xprstate.evalfunc = (ExprStateEvalFunc) ExecEvalNullTest;
+				/* see ExecFlattenExpr */
+				nstate->xprstate.evalfunc = ExecFlattenExpr;
 				nstate->arg = ExecInitExpr(ntest->arg, parent);
 				nstate->argdesc = NULL;
 				state = (ExprState *) nstate;
@@ -84,6 +84,41 @@
  *	  need some fallback logic to use this, since there's no Aggref node
  *	  for a window function.)
  *
+ *	  In AGG_HASHED mode, we keep an estimate of the memory used by the hash
+ *	  table's entries and transition values.  When that passes work_mem, the
+ *	  table stops accepting new groups: input tuples that belong to groups
+ *	  already in the table are still aggregated, but all other tuples are
+ *	  written out to one of HASHAGG_NUM_PARTITIONS temp files, chosen by the
+ *	  next few bits of the tuple's grouping hash value.  Once the groups in
+ *	  memory have been emitted, the table is emptied and each spill file is
+ *	  processed in turn as a new input (a "batch"), which may itself spill
+ *	  again using the following hash bits.  If we run out of hash bits, we
+ *	  stop spilling and let the table grow beyond work_mem instead, since
+ *	  further partitioning could not split the remaining groups anyway.
+ *
+ *	  With grouping sets, the planner divides the sets into rollups: lists
+ *	  of sets in which each set is a prefix of the one before it, so that
+ *	  all of a rollup's sets can be computed from input sorted on its
+ *	  longest set.  We process one rollup per "phase".  Phase 0 reads the
+ *	  outer plan, which is already sorted suitably; each later phase is
+ *	  described by an Agg node in the chain list of our plan node, whose
+ *	  Sort child says how to re-sort the input for it.  While reading the
+ *	  input of one phase we feed it to a tuplesort for the next.  Within a
+ *	  phase we keep transition values for every set at once; when a group
+ *	  boundary is crossed, the sets whose groups ended are the leading ones
+ *	  (the longest), and we emit a row for each of them, with the grouping
+ *	  columns the set doesn't use set to null, before starting new groups
+ *	  for them.  Each set's transition values live in a separate memory
+ *	  context, so that one set can be reset while the others carry on.
+ *
+ *	  Plain aggregation whose aggregates each take at most a single input
+ *	  column, without DISTINCT, ORDER BY or FILTER, may read its input in
+ *	  batches (see execBatch.h) if the outer plan can deliver them.  The
+ *	  common integer count, sum, avg, min and max aggregates then advance
+ *	  their transition values a whole column of a batch at a time, using the
+ *	  kernels in execBatch.c; other aggregates still get their transition
+ *	  function called once per input row, minus the per-row plan node calls.
+ *
  *
  * Portions Copyright (c) 1996-2015, PostgreSQL Global Development Group
  * Portions Copyright (c) 1994, Regents of the University of California
@@ -100,6 +135,8 @@
 #include "catalog/objectaccess.h"
 #include "catalog/pg_aggregate.h"
 #include "catalog/pg_proc.h"
+#include "catalog/pg_type.h"
+#include "executor/execBatch.h"
 #include "executor/executor.h"
 #include "executor/nodeAgg.h"
 #include "miscadmin.h"
@@ -108,6 +145,7 @@
 #include "optimizer/tlist.h"
 #include "parser/parse_agg.h"
 #include "parser/parse_coerce.h"
+#include "storage/buffile.h"
 #include "utils/acl.h"
 #include "utils/builtins.h"
 #include "utils/lsyscache.h"
@@ -115,7 +153,24 @@
 #include "utils/syscache.h"
 #include "utils/tuplesort.h"
 #include "utils/datum.h"
+#include "utils/fmgroids.h"
+
 
+/*
+ * How to advance an aggregate's transition value from a batch of input rows;
+ * see choose_batch_kernel.
+ */
+typedef enum AggBatchKernel
+{
+	AGG_BATCH_GENERIC,			/* call transfn for each selected row */
+	AGG_BATCH_COUNT_STAR,		/* count(*) */
+	AGG_BATCH_COUNT,			/* count(any) */
+	AGG_BATCH_SUM_INT,			/* sum(int2), sum(int4) */
+	AGG_BATCH_AVG_INT,			/* avg(int2), avg(int4) */
+	AGG_BATCH_SUM_INT8,			/* sum(int8), avg(int8) */
+	AGG_BATCH_MAX_INT,			/* max() of integer types */
+	AGG_BATCH_MIN_INT			/* min() of integer types */
+} AggBatchKernel;
 
 /*
  * AggStatePerAggData - per-aggregate working state for the Agg scan
@@ -240,10 +295,10 @@ typedef struct AggStatePerAggData
 	 * requires ORDER BY, we pass the input values into a Tuplesort object;
 	 * then at completion of the input tuple group, we scan the sorted values,
 	 * eliminate duplicates if needed, and run the transition function on the
-	 * rest.
+	 * rest.  With grouping sets there is one sort object per set.
 	 */
 
-	Tuplesortstate *sortstate;	/* sort object, if DISTINCT or ORDER BY */
+	Tuplesortstate **sortstates;	/* sort objects, if DISTINCT or ORDER BY */
 
 	/*
 	 * This field is a pre-initialized FunctionCallInfo struct used for
@@ -252,6 +307,13 @@ typedef struct AggStatePerAggData
 	 * worth the extra space consumption.
 	 */
 	FunctionCallInfoData transfn_fcinfo;
+
+	/*
+	 * When the input is read in batches: how to advance the transition value
+	 * from a batch, and the batch column holding the input (-1 if none).
+	 */
+	AggBatchKernel batchkernel;
+	int			batchcol;
 }	AggStatePerAggData;
 
 /*
@@ -265,7 +327,7 @@ typedef struct AggStatePerAggData
  * each input group, if it's AGG_SORTED mode.  In AGG_HASHED mode, the
  * hash table contains an array of these structs for each tuple group.
  *
- * Logically, the sortstate field belongs in this struct, but we do not
+ * Logically, the sortstates field belongs in this struct, but we do not
  * keep it here for space reasons: we don't support DISTINCT aggregates
  * in AGG_HASHED mode, so there's no reason to use up a pointer field
  * in every entry of the hashtable.
@@ -286,6 +348,22 @@ typedef struct AggStatePerGroupData
 	 */
 } AggStatePerGroupData;
 
+/*
+ * AggStatePerPhaseData - per-rollup working state, used with grouping sets
+ *
+ * The sets of a phase are in order of decreasing length, and each is a
+ * prefix of the grouping columns of the phase's Agg node.
+ */
+typedef struct AggStatePerPhaseData
+{
+	Agg		   *aggnode;		/* Agg node for the phase */
+	Sort	   *sortnode;		/* input sort order; NULL for phase 0 */
+	int			numsets;		/* number of grouping sets */
+	int		   *gset_lengths;	/* lengths of the grouping sets */
+	Bitmapset **nulled_cols;	/* per set, grouped columns it doesn't use */
+	FmgrInfo   *eqfunctions;	/* equality fns for the grouping columns */
+} AggStatePerPhaseData;
+
 /*
  * To implement hashed aggregation, we need a hashtable that stores a
  * representative tuple and an array of AggStatePerGroup structs for each
@@ -301,6 +379,39 @@ typedef struct AggHashEntryData
 	AggStatePerGroupData pergroup[1];	/* VARIABLE LENGTH ARRAY */
 }	AggHashEntryData;	/* VARIABLE LENGTH STRUCT */
 
+/*
+ * Spilling of AGG_HASHED input to disk.  Each pass over the input (the
+ * original outer plan, or a batch read back from disk) partitions the tuples
+ * it cannot aggregate in memory by HASHAGG_PARTITION_BITS further bits of
+ * their hash value (see nodeAgg.h).
+ */
+#define HASHAGG_MAX_HASH_BITS	32
+
+/*
+ * The per-group memory estimate can't foresee how far pass-by-reference or
+ * internal transition values (array_agg, string_agg, ...) will grow, so the
+ * memory really allocated for the hash table and transition values is
+ * measured as groups are added: at every new group while there are fewer
+ * than HASHAGG_MEM_CHECK_FRACTION, and after that whenever the number of
+ * groups has grown by that fraction, which keeps the total cost of the
+ * measurements linear in the number of groups.
+ */
+#define HASHAGG_MEM_CHECK_FRACTION	16
+
+/* Temp files being written during the current pass */
+typedef struct HashAggSpill
+{
+	int			used_bits;		/* hash bits consumed by previous passes */
+	BufFile    *partitions[HASHAGG_NUM_PARTITIONS];
+} HashAggSpill;
+
+/* A spill file that has been completely written and awaits processing */
+typedef struct HashAggBatch
+{
+	int			used_bits;		/* hash bits consumed to reach this batch */
+	BufFile    *file;			/* spilled input tuples */
+} HashAggBatch;
+
 
 static void initialize_aggregates(AggState *aggstate,
 					  AggStatePerAgg peragg,
@@ -308,7 +419,10 @@ static void initialize_aggregates(AggState *aggstate,
 static void advance_transition_function(AggState *aggstate,
 							AggStatePerAgg peraggstate,
 							AggStatePerGroup pergroupstate);
-static void advance_aggregates(AggState *aggstate, AggStatePerGroup pergroup);
+static void advance_aggregates(AggState *aggstate, AggStatePerGroup pergroup,
+				   int firstset, int lastset);
+static void select_current_set(AggState *aggstate, int setno);
+static void initialize_grouping_set(AggState *aggstate, int setno);
 static void process_ordered_aggregate_single(AggState *aggstate,
 								 AggStatePerAgg peraggstate,
 								 AggStatePerGroup pergroupstate);
@@ -325,14 +439,35 @@ static void build_hash_table(AggState *aggstate);
 static AggHashEntry lookup_hash_entry(AggState *aggstate,
 				  TupleTableSlot *inputslot);
 static TupleTableSlot *agg_retrieve_direct(AggState *aggstate);
+static TupleTableSlot *agg_retrieve_batch(AggState *aggstate);
+static void advance_aggregates_batch(AggState *aggstate,
+						 AggStatePerGroup pergroup, TupleBatch *batch);
+static AggBatchKernel choose_batch_kernel(AggStatePerAgg peraggstate);
+static TupleBatch *agg_init_batch(AggState *aggstate);
+static TupleTableSlot *agg_retrieve_grouping_sets(AggState *aggstate);
+static TupleTableSlot *project_grouping_set(AggState *aggstate, int setno);
+static TupleTableSlot *fetch_input_tuple(AggState *aggstate);
+static int count_finished_sets(AggState *aggstate, TupleTableSlot *slot);
+static void initialize_phase(AggState *aggstate, int newphase);
 static void agg_fill_hash_table(AggState *aggstate);
 static TupleTableSlot *agg_retrieve_hash_table(AggState *aggstate);
+static uint32 hashagg_hash_tuple(AggState *aggstate, TupleTableSlot *slot);
+static void hashagg_spill_tuple(AggState *aggstate, TupleTableSlot *slot,
+					uint32 hashvalue);
+static void hashagg_finish_spill(AggState *aggstate);
+static void hashagg_next_batch(AggState *aggstate);
+static TupleTableSlot *hashagg_batch_read(AggState *aggstate,
+				   HashAggBatch *batch, uint32 *hashvalue);
+static void hashagg_reset_spill_state(AggState *aggstate);
 static Datum GetAggInitVal(Datum textInitVal, Oid transtype);
 
 
 /*
  * Initialize all aggregates for a new group of input values.
  *
+ * With grouping sets, this initializes the aggregates of the current set;
+ * pergroup must point to that set's entries.
+ *
  * When called, CurrentMemoryContext should be the per-query context.
  */
 static void
@@ -356,8 +491,8 @@ initialize_aggregates(AggState *aggstate,
 			 * In case of rescan, maybe there could be an uncompleted sort
 			 * operation?  Clean it up if so.
 			 */
-			if (peraggstate->sortstate)
-				tuplesort_end(peraggstate->sortstate);
+			if (peraggstate->sortstates[aggstate->current_set])
+				tuplesort_end(peraggstate->sortstates[aggstate->current_set]);
 
 			/*
 			 * We use a plain Datum sorter when there's a single input column;
@@ -368,7 +503,7 @@ initialize_aggregates(AggState *aggstate,
 			 * tuplesort_begin_heap() case when the abbreviated key
 			 * optimization can thereby be used, even when numInputs is 1.
 			 */
-			peraggstate->sortstate =
+			peraggstate->sortstates[aggstate->current_set] =
 				(peraggstate->numInputs == 1) ?
 				tuplesort_begin_datum(peraggstate->evaldesc->attrs[0]->atttypid,
 									  peraggstate->sortOperators[0],
@@ -528,17 +663,24 @@ advance_transition_function(AggState *aggstate,
  * to ExecEvalExpr.  pergroup is the array of per-group structs to use
  * (this might be in a hashtable entry).
  *
+ * With grouping sets, pergroup holds numaggs entries for each set, and we
+ * advance the sets numbered firstset up to (not including) lastset; the
+ * aggregate inputs are evaluated only once for all of them.  Without grouping
+ * sets, pass 0 and 1.
+ *
  * When called, CurrentMemoryContext should be the per-query context.
  */
 static void
-advance_aggregates(AggState *aggstate, AggStatePerGroup pergroup)
+advance_aggregates(AggState *aggstate, AggStatePerGroup pergroup,
+				   int firstset, int lastset)
 {
+	int			numaggs = aggstate->numaggs;
 	int			aggno;
+	int			setno;
 
-	for (aggno = 0; aggno < aggstate->numaggs; aggno++)
+	for (aggno = 0; aggno < numaggs; aggno++)
 	{
 		AggStatePerAgg peraggstate = &aggstate->peragg[aggno];
-		AggStatePerGroup pergroupstate = &pergroup[aggno];
 		ExprState  *filter = peraggstate->aggrefstate->aggfilter;
 		int			numTransInputs = peraggstate->numTransInputs;
 		int			i;
@@ -582,33 +724,79 @@ advance_aggregates(AggState *aggstate, AggStatePerGroup pergroup)
 					continue;
 			}
 
-			/* OK, put the tuple into the tuplesort object */
-			if (peraggstate->numInputs == 1)
-				tuplesort_putdatum(peraggstate->sortstate,
-								   slot->tts_values[0],
-								   slot->tts_isnull[0]);
-			else
-				tuplesort_puttupleslot(peraggstate->sortstate, slot);
+			/* OK, put the tuple into the tuplesort object of each set */
+			for (setno = firstset; setno < lastset; setno++)
+			{
+				if (peraggstate->numInputs == 1)
+					tuplesort_putdatum(peraggstate->sortstates[setno],
+									   slot->tts_values[0],
+									   slot->tts_isnull[0]);
+				else
+					tuplesort_puttupleslot(peraggstate->sortstates[setno],
+										   slot);
+			}
 		}
 		else
 		{
 			/* We can apply the transition function immediately */
 			FunctionCallInfo fcinfo = &peraggstate->transfn_fcinfo;
 
-			/* Load values into fcinfo */
-			/* Start from 1, since the 0th arg will be the transition value */
-			Assert(slot->tts_nvalid >= numTransInputs);
-			for (i = 0; i < numTransInputs; i++)
+			for (setno = firstset; setno < lastset; setno++)
 			{
-				fcinfo->arg[i + 1] = slot->tts_values[i];
-				fcinfo->argnull[i + 1] = slot->tts_isnull[i];
-			}
+				AggStatePerGroup pergroupstate =
+				&pergroup[setno * numaggs + aggno];
 
-			advance_transition_function(aggstate, peraggstate, pergroupstate);
+				/*
+				 * Load values into fcinfo.  We must do this for each set,
+				 * since the transition function may scribble on them.  Start
+				 * from 1, since the 0th arg will be the transition value.
+				 */
+				Assert(slot->tts_nvalid >= numTransInputs);
+				for (i = 0; i < numTransInputs; i++)
+				{
+					fcinfo->arg[i + 1] = slot->tts_values[i];
+					fcinfo->argnull[i + 1] = slot->tts_isnull[i];
+				}
+
+				select_current_set(aggstate, setno);
+				advance_transition_function(aggstate, peraggstate,
+											pergroupstate);
+			}
 		}
 	}
 }
 
+/*
+ * Make setno the grouping set whose transition values we work on: this
+ * selects its memory context and DISTINCT/ORDER BY sort objects.  Without
+ * grouping sets there is only set 0, and nothing to switch.
+ */
+static void
+select_current_set(AggState *aggstate, int setno)
+{
+	aggstate->current_set = setno;
+	if (aggstate->aggcontexts)
+		aggstate->aggcontext =
+			aggstate->aggcontexts[setno]->ecxt_per_tuple_memory;
+}
+
+/*
+ * Discard the transition values of a grouping set and initialize them for
+ * a new group.
+ *
+ * We use ReScanExprContext not just a memory context reset so that any
+ * shutdown callbacks the set's aggregates registered are called.
+ */
+static void
+initialize_grouping_set(AggState *aggstate, int setno)
+{
+	select_current_set(aggstate, setno);
+	ReScanExprContext(aggstate->aggcontexts[setno]);
+	MemoryContextResetAndDeleteChildren(aggstate->aggcontext);
+	initialize_aggregates(aggstate, aggstate->peragg,
+						  &aggstate->pergroup[setno * aggstate->numaggs]);
+}
+
 
 /*
  * Run the transition function for a DISTINCT or ORDER BY aggregate
@@ -644,9 +832,11 @@ process_ordered_aggregate_single(AggState *aggstate,
 	Datum	   *newVal;
 	bool	   *isNull;
 
+	Tuplesortstate *sortstate = peraggstate->sortstates[aggstate->current_set];
+
 	Assert(peraggstate->numDistinctCols < 2);
 
-	tuplesort_performsort(peraggstate->sortstate);
+	tuplesort_performsort(sortstate);
 
 	/* Load the column into argument 1 (arg 0 will be transition value) */
 	newVal = fcinfo->arg + 1;
@@ -658,7 +848,7 @@ process_ordered_aggregate_single(AggState *aggstate,
 	 * pfree them when they are no longer needed.
 	 */
 
-	while (tuplesort_getdatum(peraggstate->sortstate, true,
+	while (tuplesort_getdatum(sortstate, true,
 							  newVal, isNull))
 	{
 		/*
@@ -702,8 +892,8 @@ process_ordered_aggregate_single(AggState *aggstate,
 	if (!oldIsNull && !peraggstate->inputtypeByVal)
 		pfree(DatumGetPointer(oldVal));
 
-	tuplesort_end(peraggstate->sortstate);
-	peraggstate->sortstate = NULL;
+	tuplesort_end(sortstate);
+	peraggstate->sortstates[aggstate->current_set] = NULL;
 }
 
 /*
@@ -721,6 +911,7 @@ process_ordered_aggregate_multi(AggState *aggstate,
 								AggStatePerGroup pergroupstate)
 {
 	MemoryContext workcontext = aggstate->tmpcontext->ecxt_per_tuple_memory;
+	Tuplesortstate *sortstate = peraggstate->sortstates[aggstate->current_set];
 	FunctionCallInfo fcinfo = &peraggstate->transfn_fcinfo;
 	TupleTableSlot *slot1 = peraggstate->evalslot;
 	TupleTableSlot *slot2 = peraggstate->uniqslot;
@@ -729,13 +920,13 @@ process_ordered_aggregate_multi(AggState *aggstate,
 	bool		haveOldValue = false;
 	int			i;
 
-	tuplesort_performsort(peraggstate->sortstate);
+	tuplesort_performsort(sortstate);
 
 	ExecClearTuple(slot1);
 	if (slot2)
 		ExecClearTuple(slot2);
 
-	while (tuplesort_gettupleslot(peraggstate->sortstate, true, slot1))
+	while (tuplesort_gettupleslot(sortstate, true, slot1))
 	{
 		/*
 		 * Extract the first numTransInputs columns as datums to pass to the
@@ -783,8 +974,8 @@ process_ordered_aggregate_multi(AggState *aggstate,
 	if (slot2)
 		ExecClearTuple(slot2);
 
-	tuplesort_end(peraggstate->sortstate);
-	peraggstate->sortstate = NULL;
+	tuplesort_end(sortstate);
+	peraggstate->sortstates[aggstate->current_set] = NULL;
 }
 
 /*
@@ -1025,6 +1216,10 @@ hash_agg_entry_size(int numAggs)
  * Find or create a hashtable entry for the tuple group containing the
  * given tuple.
  *
+ * Once the hash table has grown past work_mem, no new entries are created;
+ * NULL is returned instead if the tuple's group is not already present, and
+ * the caller must spill the tuple.
+ *
  * When called, CurrentMemoryContext should be the per-query context.
  */
 static AggHashEntry
@@ -1033,7 +1228,7 @@ lookup_hash_entry(AggState *aggstate, TupleTableSlot *inputslot)
 	TupleTableSlot *hashslot = aggstate->hashslot;
 	ListCell   *l;
 	AggHashEntry entry;
-	bool		isnew;
+	bool		isnew = false;
 
 	/* if first time through, initialize hashslot by cloning input slot */
 	if (hashslot->tts_tupleDescriptor == NULL)
@@ -1056,17 +1251,283 @@ lookup_hash_entry(AggState *aggstate, TupleTableSlot *inputslot)
 	/* find or create the hashtable entry using the filtered tuple */
 	entry = (AggHashEntry) LookupTupleHashEntry(aggstate->hashtable,
 												hashslot,
-												&isnew);
+									aggstate->hash_spill_mode ? NULL : &isnew);
 
 	if (isnew)
 	{
+		long		ngroups;
+		int			used_bits;
+
 		/* initialize aggregates for new tuple group */
 		initialize_aggregates(aggstate, aggstate->peragg, entry->pergroup);
+
+		/*
+		 * Account for the new group, and stop creating groups if that takes
+		 * us past work_mem, provided there are hash bits left to partition
+		 * the remaining input by.  The running estimate is replaced by the
+		 * real size of aggcontext from time to time, to take in the growth
+		 * of the existing groups' transition values.
+		 */
+		aggstate->hash_mem_used += aggstate->hash_entry_size +
+			entry->shared.firstTuple->t_len;
+		ngroups = hash_get_num_entries(aggstate->hashtable->hashtab);
+		if (aggstate->hash_mem_used > work_mem * 1024L ||
+			ngroups >= aggstate->hash_mem_check_at)
+		{
+			aggstate->hash_mem_used =
+				MemoryContextMemAllocated(aggstate->aggcontext, true);
+			aggstate->hash_mem_check_at =
+				ngroups + Max(ngroups / HASHAGG_MEM_CHECK_FRACTION, 1);
+		}
+
+		used_bits = aggstate->hash_cur_batch ?
+			aggstate->hash_cur_batch->used_bits : 0;
+		if (aggstate->hash_mem_used > work_mem * 1024L &&
+			used_bits + HASHAGG_PARTITION_BITS <= HASHAGG_MAX_HASH_BITS)
+			aggstate->hash_spill_mode = true;
 	}
 
 	return entry;
 }
 
+/*
+ * Compute the grouping hash value of an input tuple, for choosing the spill
+ * partition it goes to.
+ *
+ * This must be a function of the grouping columns only, so that all tuples
+ * of a group end up in the same partition.
+ */
+static uint32
+hashagg_hash_tuple(AggState *aggstate, TupleTableSlot *slot)
+{
+	Agg		   *node = (Agg *) aggstate->ss.ps.plan;
+	MemoryContext oldContext;
+	uint32		hashkey = 0;
+	int			i;
+
+	/* Need to run the hash functions in short-lived context */
+	oldContext = MemoryContextSwitchTo(aggstate->tmpcontext->ecxt_per_tuple_memory);
+
+	for (i = 0; i < node->numCols; i++)
+	{
+		Datum		attr;
+		bool		isNull;
+
+		/* rotate hashkey left 1 bit at each step */
+		hashkey = (hashkey << 1) | ((hashkey & 0x80000000) ? 1 : 0);
+
+		attr = slot_getattr(slot, node->grpColIdx[i], &isNull);
+
+		if (!isNull)			/* treat nulls as having hash key 0 */
+			hashkey ^= DatumGetUInt32(FunctionCall1(&aggstate->hashfunctions[i],
+													attr));
+	}
+
+	MemoryContextSwitchTo(oldContext);
+
+	return hashkey;
+}
+
+/*
+ * Write an input tuple whose group is not in the hash table to the spill
+ * file of its partition.
+ *
+ * Each tuple is written as its hash value followed by the MinimalTuple,
+ * the same layout nodeHashjoin.c uses for its batch files.
+ */
+static void
+hashagg_spill_tuple(AggState *aggstate, TupleTableSlot *slot, uint32 hashvalue)
+{
+	HashAggSpill *spill = aggstate->hash_spill;
+	MinimalTuple tuple;
+	int			partno;
+	BufFile    *file;
+	size_t		written;
+
+	if (spill == NULL)
+	{
+		spill = (HashAggSpill *) palloc0(sizeof(HashAggSpill));
+		spill->used_bits = aggstate->hash_cur_batch ?
+			aggstate->hash_cur_batch->used_bits : 0;
+		aggstate->hash_spill = spill;
+		aggstate->hash_spilled = true;
+	}
+
+	/* Use the highest hash bits not consumed by earlier passes */
+	partno = (hashvalue << spill->used_bits) >>
+		(HASHAGG_MAX_HASH_BITS - HASHAGG_PARTITION_BITS);
+
+	file = spill->partitions[partno];
+	if (file == NULL)
+	{
+		file = BufFileCreateTemp(false);
+		spill->partitions[partno] = file;
+	}
+
+	tuple = ExecFetchSlotMinimalTuple(slot);
+
+	written = BufFileWrite(file, (void *) &hashvalue, sizeof(uint32));
+	if (written != sizeof(uint32))
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not write to hash-aggregate temporary file: %m")));
+
+	written = BufFileWrite(file, (void *) tuple, tuple->t_len);
+	if (written != tuple->t_len)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not write to hash-aggregate temporary file: %m")));
+}
+
+/*
+ * At the end of a pass over the input, turn the partitions written during
+ * the pass into batches to be processed later.
+ */
+static void
+hashagg_finish_spill(AggState *aggstate)
+{
+	HashAggSpill *spill = aggstate->hash_spill;
+	int			partno;
+
+	if (spill == NULL)
+		return;
+
+	for (partno = 0; partno < HASHAGG_NUM_PARTITIONS; partno++)
+	{
+		BufFile    *file = spill->partitions[partno];
+		HashAggBatch *batch;
+
+		if (file == NULL)
+			continue;
+
+		/* rewind, which also flushes the buffered data */
+		if (BufFileSeek(file, 0, 0L, SEEK_SET))
+			ereport(ERROR,
+					(errcode_for_file_access(),
+				  errmsg("could not rewind hash-aggregate temporary file: %m")));
+
+		batch = (HashAggBatch *) palloc(sizeof(HashAggBatch));
+		batch->used_bits = spill->used_bits + HASHAGG_PARTITION_BITS;
+		batch->file = file;
+		aggstate->hash_batches = lappend(aggstate->hash_batches, batch);
+	}
+
+	pfree(spill);
+	aggstate->hash_spill = NULL;
+}
+
+/*
+ * Empty the hash table and make the next pending batch the current input.
+ */
+static void
+hashagg_next_batch(AggState *aggstate)
+{
+	HashAggBatch *batch;
+
+	Assert(aggstate->hash_batches != NIL);
+	Assert(aggstate->hash_cur_batch == NULL);
+
+	/*
+	 * Run any aggregate shutdown callbacks for the groups we are about to
+	 * discard, then release the hash table and all transition values.
+	 */
+	ReScanExprContext(aggstate->ss.ps.ps_ExprContext);
+	MemoryContextResetAndDeleteChildren(aggstate->aggcontext);
+	build_hash_table(aggstate);
+	aggstate->hash_mem_used = 0;
+	aggstate->hash_mem_check_at = 0;
+	aggstate->hash_spill_mode = false;
+	aggstate->table_filled = false;
+
+	batch = (HashAggBatch *) linitial(aggstate->hash_batches);
+	aggstate->hash_batches = list_delete_first(aggstate->hash_batches);
+	aggstate->hash_cur_batch = batch;
+	aggstate->hash_batches_used++;
+}
+
+/*
+ * Read the next tuple of a batch into the spill slot, or return an empty
+ * slot at end of batch.
+ */
+static TupleTableSlot *
+hashagg_batch_read(AggState *aggstate, HashAggBatch *batch,
+				   uint32 *hashvalue)
+{
+	uint32		header[2];
+	size_t		nread;
+	MinimalTuple tuple;
+
+	/*
+	 * Since both the hash value and the MinimalTuple length word are uint32,
+	 * we can read them both in one BufFileRead() call without any type
+	 * cheating.
+	 */
+	nread = BufFileRead(batch->file, (void *) header, sizeof(header));
+	if (nread == 0)				/* end of file */
+		return ExecClearTuple(aggstate->hash_spill_slot);
+	if (nread != sizeof(header))
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not read from hash-aggregate temporary file: %m")));
+	*hashvalue = header[0];
+	tuple = (MinimalTuple) palloc(header[1]);
+	tuple->t_len = header[1];
+	nread = BufFileRead(batch->file,
+						(void *) ((char *) tuple + sizeof(uint32)),
+						header[1] - sizeof(uint32));
+	if (nread != header[1] - sizeof(uint32))
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not read from hash-aggregate temporary file: %m")));
+	return ExecStoreMinimalTuple(tuple, aggstate->hash_spill_slot, true);
+}
+
+/*
+ * Close all spill files and forget about pending batches.
+ */
+static void
+hashagg_reset_spill_state(AggState *aggstate)
+{
+	HashAggSpill *spill = aggstate->hash_spill;
+	HashAggBatch *batch = aggstate->hash_cur_batch;
+	ListCell   *lc;
+
+	if (spill != NULL)
+	{
+		int			partno;
+
+		for (partno = 0; partno < HASHAGG_NUM_PARTITIONS; partno++)
+		{
+			if (spill->partitions[partno] != NULL)
+				BufFileClose(spill->partitions[partno]);
+		}
+		pfree(spill);
+		aggstate->hash_spill = NULL;
+	}
+
+	if (batch != NULL)
+	{
+		BufFileClose(batch->file);
+		pfree(batch);
+		aggstate->hash_cur_batch = NULL;
+	}
+
+	foreach(lc, aggstate->hash_batches)
+	{
+		batch = (HashAggBatch *) lfirst(lc);
+		BufFileClose(batch->file);
+		pfree(batch);
+	}
+	list_free(aggstate->hash_batches);
+	aggstate->hash_batches = NIL;
+
+	aggstate->hash_mem_used = 0;
+	aggstate->hash_mem_check_at = 0;
+	aggstate->hash_spill_mode = false;
+	aggstate->hash_spilled = false;
+	aggstate->hash_batches_used = 0;
+}
+
 /*
  * ExecAgg -
  *
@@ -1115,6 +1576,10 @@ ExecAgg(AggState *node)
 			agg_fill_hash_table(node);
 		return agg_retrieve_hash_table(node);
 	}
+	else if (node->phases)
+		return agg_retrieve_grouping_sets(node);
+	else if (node->batch)
+		return agg_retrieve_batch(node);
 	else
 		return agg_retrieve_direct(node);
 }
@@ -1224,7 +1689,7 @@ agg_retrieve_direct(AggState *aggstate)
 			 */
 			for (;;)
 			{
-				advance_aggregates(aggstate, pergroup);
+				advance_aggregates(aggstate, pergroup, 0, 1);
 
 				/* Reset per-input-tuple context after each tuple */
 				ResetExprContext(tmpcontext);
@@ -1327,88 +1792,696 @@ agg_retrieve_direct(AggState *aggstate)
 }
 
 /*
- * ExecAgg for hashed case: phase 1, read input and build hash table
+ * ExecAgg for plain aggregation reading its input in batches
+ *
+ * Like agg_retrieve_direct, except that there's always exactly one group,
+ * and that the whole input is aggregated a batch at a time.
  */
-static void
-agg_fill_hash_table(AggState *aggstate)
+static TupleTableSlot *
+agg_retrieve_batch(AggState *aggstate)
 {
-	PlanState  *outerPlan;
-	ExprContext *tmpcontext;
-	AggHashEntry entry;
-	TupleTableSlot *outerslot;
+	PlanState  *outerPlan = outerPlanState(aggstate);
+	ExprContext *econtext = aggstate->ss.ps.ps_ExprContext;
+	ExprContext *tmpcontext = aggstate->tmpcontext;
+	Datum	   *aggvalues = econtext->ecxt_aggvalues;
+	bool	   *aggnulls = econtext->ecxt_aggnulls;
+	AggStatePerAgg peragg = aggstate->peragg;
+	AggStatePerGroup pergroup = aggstate->pergroup;
+	TupleBatch *batch = aggstate->batch;
+	int			aggno;
 
-	/*
-	 * get state info from node
-	 */
-	outerPlan = outerPlanState(aggstate);
-	/* tmpcontext is the per-input-tuple expression context */
-	tmpcontext = aggstate->tmpcontext;
+	/* Initialize working state, as agg_retrieve_direct does for a group */
+	ReScanExprContext(econtext);
+
+	MemoryContextResetAndDeleteChildren(aggstate->aggcontext);
+
+	initialize_aggregates(aggstate, peragg, pergroup);
+
+	/* We only get here once per scan of the input */
+	batch->eof = false;
+
+	while (ExecProcNodeBatch(outerPlan, batch))
+	{
+		advance_aggregates_batch(aggstate, pergroup, batch);
+
+		/* Reset per-input-tuple context after each batch */
+		ResetExprContext(tmpcontext);
+	}
+	aggstate->agg_done = true;
 
 	/*
-	 * Process each outer-plan tuple, and then fetch the next one, until we
-	 * exhaust the outer plan.
+	 * There are no references to non-aggregated input columns, since we're
+	 * not grouping; give them an empty slot, like agg_retrieve_direct does
+	 * when there's no input at all.
 	 */
-	for (;;)
+	econtext->ecxt_outertuple = aggstate->ss.ss_ScanTupleSlot;
+
+	for (aggno = 0; aggno < aggstate->numaggs; aggno++)
+		finalize_aggregate(aggstate, &peragg[aggno], &pergroup[aggno],
+						   &aggvalues[aggno], &aggnulls[aggno]);
+
+	/* Check the qual (HAVING clause), and project the result row */
+	if (ExecQual(aggstate->ss.ps.qual, econtext, false))
 	{
-		outerslot = ExecProcNode(outerPlan);
-		if (TupIsNull(outerslot))
-			break;
-		/* set up for advance_aggregates call */
-		tmpcontext->ecxt_outertuple = outerslot;
+		TupleTableSlot *result;
+		ExprDoneCond isDone;
 
-		/* Find or build hashtable entry for this tuple's group */
-		entry = lookup_hash_entry(aggstate, outerslot);
+		result = ExecProject(aggstate->ss.ps.ps_ProjInfo, &isDone);
+
+		if (isDone != ExprEndResult)
+		{
+			aggstate->ss.ps.ps_TupFromTlist =
+				(isDone == ExprMultipleResult);
+			return result;
+		}
+	}
+	else
+		InstrCountFiltered1(aggstate, 1);
 
-		/* Advance the aggregates */
-		advance_aggregates(aggstate, entry->pergroup);
+	return NULL;
+}
 
-		/* Reset per-input-tuple context after each tuple */
-		ResetExprContext(tmpcontext);
+/*
+ * Convert between int64 and a Datum of an integer type of length typlen.
+ */
+static int64
+batch_datum_get_int(Datum value, int16 typlen)
+{
+	switch (typlen)
+	{
+		case sizeof(int16):
+			return DatumGetInt16(value);
+		case sizeof(int32):
+			return DatumGetInt32(value);
+		default:
+			return DatumGetInt64(value);
 	}
+}
 
-	aggstate->table_filled = true;
-	/* Initialize to walk the hash table */
-	ResetTupleHashIterator(aggstate->hashtable, &aggstate->hashiter);
+static Datum
+batch_int_get_datum(int64 value, int16 typlen)
+{
+	switch (typlen)
+	{
+		case sizeof(int16):
+			return Int16GetDatum((int16) value);
+		case sizeof(int32):
+			return Int32GetDatum((int32) value);
+		default:
+			return Int64GetDatum(value);
+	}
 }
 
 /*
- * ExecAgg for hashed case: phase 2, retrieving groups from hash table
+ * Advance all the aggregates for the selected rows of a batch.  This must
+ * produce the same transition values as calling advance_aggregates for each
+ * of the rows would have.
+ *
+ * When called, CurrentMemoryContext should be the per-query context.
  */
-static TupleTableSlot *
-agg_retrieve_hash_table(AggState *aggstate)
+static void
+advance_aggregates_batch(AggState *aggstate, AggStatePerGroup pergroup,
+						 TupleBatch *batch)
 {
-	ExprContext *econtext;
-	Datum	   *aggvalues;
-	bool	   *aggnulls;
-	AggStatePerAgg peragg;
-	AggStatePerGroup pergroup;
-	AggHashEntry entry;
-	TupleTableSlot *firstSlot;
 	int			aggno;
 
-	/*
-	 * get state info from node
-	 */
-	/* econtext is the per-output-tuple expression context */
-	econtext = aggstate->ss.ps.ps_ExprContext;
-	aggvalues = econtext->ecxt_aggvalues;
-	aggnulls = econtext->ecxt_aggnulls;
-	peragg = aggstate->peragg;
-	firstSlot = aggstate->ss.ss_ScanTupleSlot;
-
-	/*
-	 * We loop retrieving groups until we find one satisfying
-	 * aggstate->ss.ps.qual
-	 */
-	while (!aggstate->agg_done)
+	for (aggno = 0; aggno < aggstate->numaggs; aggno++)
 	{
-		/*
-		 * Find the next entry in the hash table
-		 */
-		entry = (AggHashEntry) ScanTupleHashTable(&aggstate->hashiter);
-		if (entry == NULL)
+		AggStatePerAgg peraggstate = &aggstate->peragg[aggno];
+		AggStatePerGroup pergroupstate = &pergroup[aggno];
+		int			col = peraggstate->batchcol;
+		int64		count;
+		int64		sum;
+		int64		sum_lo;
+		int64		value;
+		MemoryContext oldContext;
+
+		switch (peraggstate->batchkernel)
 		{
-			/* No more entries in hashtable, so done */
+			case AGG_BATCH_GENERIC:
+				{
+					FunctionCallInfo fcinfo = &peraggstate->transfn_fcinfo;
+					int			i;
+
+					for (i = 0; i < batch->nrows; i++)
+					{
+						if (!batch->selected[i])
+							continue;
+						if (col >= 0)
+						{
+							fcinfo->arg[1] = batch->values[col][i];
+							fcinfo->argnull[1] = batch->isnull[col][i];
+						}
+						advance_transition_function(aggstate, peraggstate,
+													pergroupstate);
+						ResetExprContext(aggstate->tmpcontext);
+					}
+				}
+				break;
+
+			case AGG_BATCH_COUNT_STAR:
+				pergroupstate->transValue =
+					Int64GetDatum(DatumGetInt64(pergroupstate->transValue) +
+								  batch->nselected);
+				break;
+
+			case AGG_BATCH_COUNT:
+				pergroupstate->transValue =
+					Int64GetDatum(DatumGetInt64(pergroupstate->transValue) +
+								  ExecBatchCount(batch, col));
+				break;
+
+			case AGG_BATCH_SUM_INT:
+				/* int2_sum and int4_sum start from the first non-null input */
+				if (ExecBatchSumInt(batch, col, &sum) > 0)
+				{
+					if (!pergroupstate->transValueIsNull)
+						sum += DatumGetInt64(pergroupstate->transValue);
+					pergroupstate->transValue = Int64GetDatum(sum);
+					pergroupstate->transValueIsNull = false;
+				}
+				break;
+
+			case AGG_BATCH_AVG_INT:
+				count = ExecBatchSumInt(batch, col, &sum);
+				if (count > 0 && !pergroupstate->transValueIsNull)
+					int_avg_accum_batch(pergroupstate->transValue,
+										count, sum);
+				break;
+
+			case AGG_BATCH_SUM_INT8:
+				count = ExecBatchSumInt8(batch, col, &sum, &sum_lo);
+				oldContext =
+					MemoryContextSwitchTo(aggstate->tmpcontext->ecxt_per_tuple_memory);
+				pergroupstate->transValue =
+					int8_avg_accum_batch(&peraggstate->transfn_fcinfo,
+										 pergroupstate->transValueIsNull ?
+										 PointerGetDatum(NULL) :
+										 pergroupstate->transValue,
+										 count, sum, sum_lo);
+				pergroupstate->transValueIsNull = false;
+				MemoryContextSwitchTo(oldContext);
+				break;
+
+			case AGG_BATCH_MAX_INT:
+			case AGG_BATCH_MIN_INT:
+				if (peraggstate->batchkernel == AGG_BATCH_MAX_INT ?
+					!ExecBatchMaxInt(batch, col, &value) :
+					!ExecBatchMinInt(batch, col, &value))
+					break;
+
+				/* The first non-null input becomes the transition value */
+				if (pergroupstate->noTransValue)
+				{
+					pergroupstate->transValue =
+						batch_int_get_datum(value, peraggstate->transtypeLen);
+					pergroupstate->transValueIsNull = false;
+					pergroupstate->noTransValue = false;
+				}
+				else if (!pergroupstate->transValueIsNull)
+				{
+					int64		oldvalue;
+
+					oldvalue = batch_datum_get_int(pergroupstate->transValue,
+												   peraggstate->transtypeLen);
+					if (peraggstate->batchkernel == AGG_BATCH_MAX_INT ?
+						value > oldvalue : value < oldvalue)
+						pergroupstate->transValue =
+							batch_int_get_datum(value,
+												peraggstate->transtypeLen);
+				}
+				break;
+		}
+	}
+}
+
+/*
+ * ExecAgg for grouping sets
+ *
+ * See the comments at the head of the file for the general scheme.  The
+ * first tuple of the groups now in progress is kept in the scan tuple slot;
+ * when we cross a group boundary, the first tuple of the next group waits in
+ * grp_firstTuple until the finished sets have been emitted.
+ */
+static TupleTableSlot *
+agg_retrieve_grouping_sets(AggState *aggstate)
+{
+	ExprContext *tmpcontext = aggstate->tmpcontext;
+	TupleTableSlot *firstSlot = aggstate->ss.ss_ScanTupleSlot;
+	TupleTableSlot *outerslot;
+	TupleTableSlot *result;
+	AggStatePerPhase phase;
+	int			numsets;
+	int			setno;
+
+	while (!aggstate->agg_done)
+	{
+		phase = &aggstate->phases[aggstate->current_phase];
+		numsets = phase->numsets;
+
+		/* Emit a row for each finished set, longest first */
+		if (aggstate->projected_set < aggstate->gset_finished)
+		{
+			setno = aggstate->projected_set++;
+			result = project_grouping_set(aggstate, setno);
+			if (result != NULL)
+				return result;
+			continue;
+		}
+
+		if (aggstate->gset_finished > 0)
+		{
+			if (aggstate->input_done)
+			{
+				/* This phase is complete; move on to the next, if any */
+				if (aggstate->current_phase + 1 < aggstate->numphases)
+					initialize_phase(aggstate, aggstate->current_phase + 1);
+				else
+					aggstate->agg_done = true;
+				continue;
+			}
+
+			/*
+			 * Start new groups for the sets that finished, beginning with the
+			 * tuple that ended their old ones.  The other sets have already
+			 * seen that tuple.
+			 */
+			ExecStoreTuple(aggstate->grp_firstTuple,
+						   firstSlot,
+						   InvalidBuffer,
+						   true);
+			aggstate->grp_firstTuple = NULL;	/* don't keep two pointers */
+
+			for (setno = 0; setno < aggstate->gset_finished; setno++)
+				initialize_grouping_set(aggstate, setno);
+
+			tmpcontext->ecxt_outertuple = firstSlot;
+			advance_aggregates(aggstate, aggstate->pergroup,
+							   0, aggstate->gset_finished);
+			ResetExprContext(tmpcontext);
+
+			aggstate->gset_finished = 0;
+			aggstate->projected_set = 0;
+		}
+		else if (TupIsNull(firstSlot))
+		{
+			/* Start of a phase: begin the first groups of all the sets */
+			for (setno = 0; setno < numsets; setno++)
+				initialize_grouping_set(aggstate, setno);
+
+			outerslot = fetch_input_tuple(aggstate);
+			if (TupIsNull(outerslot))
+			{
+				/*
+				 * No input at all.  Only the empty grouping sets, which sort
+				 * last, produce a row; they see all the grouping columns as
+				 * null.
+				 */
+				aggstate->input_done = true;
+				ExecStoreAllNullTuple(firstSlot);
+				for (setno = 0; setno < numsets; setno++)
+				{
+					if (phase->gset_lengths[setno] == 0)
+						break;
+				}
+				aggstate->projected_set = setno;
+				aggstate->gset_finished = numsets;
+				continue;
+			}
+
+			ExecStoreTuple(ExecCopySlotTuple(outerslot),
+						   firstSlot,
+						   InvalidBuffer,
+						   true);
+
+			tmpcontext->ecxt_outertuple = firstSlot;
+			advance_aggregates(aggstate, aggstate->pergroup, 0, numsets);
+			ResetExprContext(tmpcontext);
+		}
+
+		/*
+		 * Process each input tuple until we exhaust the input or cross the
+		 * group boundary of at least one set.
+		 */
+		for (;;)
+		{
+			int			finished;
+
+			outerslot = fetch_input_tuple(aggstate);
+			if (TupIsNull(outerslot))
+			{
+				/* every set's last group is done */
+				aggstate->input_done = true;
+				aggstate->gset_finished = numsets;
+				aggstate->projected_set = 0;
+				break;
+			}
+			tmpcontext->ecxt_outertuple = outerslot;
+
+			finished = count_finished_sets(aggstate, outerslot);
+			if (finished > 0)
+			{
+				/*
+				 * Save the first input tuple of the sets' next groups, and
+				 * let the sets that carry on see it now.
+				 */
+				aggstate->grp_firstTuple = ExecCopySlotTuple(outerslot);
+				advance_aggregates(aggstate, aggstate->pergroup,
+								   finished, numsets);
+				ResetExprContext(tmpcontext);
+				aggstate->gset_finished = finished;
+				aggstate->projected_set = 0;
+				break;
+			}
+
+			advance_aggregates(aggstate, aggstate->pergroup, 0, numsets);
+
+			/* Reset per-input-tuple context after each tuple */
+			ResetExprContext(tmpcontext);
+		}
+	}
+
+	/* No more groups */
+	return NULL;
+}
+
+/*
+ * Finalize the aggregates of a finished grouping set, and form its output
+ * row from them and the representative input tuple.  Returns NULL if the row
+ * fails the HAVING qual.
+ */
+static TupleTableSlot *
+project_grouping_set(AggState *aggstate, int setno)
+{
+	AggStatePerPhase phase = &aggstate->phases[aggstate->current_phase];
+	ExprContext *econtext = aggstate->ss.ps.ps_ExprContext;
+	TupleTableSlot *firstSlot = aggstate->ss.ss_ScanTupleSlot;
+	AggStatePerGroup pergroup;
+	int			aggno;
+	int			attno;
+
+	/*
+	 * Clear the per-output-tuple context for each row.  Aggregate shutdown
+	 * callbacks are registered with the per-set contexts instead, so a reset
+	 * is enough here.
+	 */
+	ResetExprContext(econtext);
+
+	select_current_set(aggstate, setno);
+	pergroup = &aggstate->pergroup[setno * aggstate->numaggs];
+
+	for (aggno = 0; aggno < aggstate->numaggs; aggno++)
+	{
+		AggStatePerAgg peraggstate = &aggstate->peragg[aggno];
+		AggStatePerGroup pergroupstate = &pergroup[aggno];
+
+		if (peraggstate->numSortCols > 0)
+		{
+			if (peraggstate->numInputs == 1)
+				process_ordered_aggregate_single(aggstate,
+												 peraggstate,
+												 pergroupstate);
+			else
+				process_ordered_aggregate_multi(aggstate,
+												peraggstate,
+												pergroupstate);
+		}
+
+		finalize_aggregate(aggstate, peraggstate, pergroupstate,
+						   &econtext->ecxt_aggvalues[aggno],
+						   &econtext->ecxt_aggnulls[aggno]);
+	}
+
+	/*
+	 * The grouping columns this set doesn't group by read as null.  Since we
+	 * emit the sets of a phase longest first, and each is a prefix of the one
+	 * before, we never need to un-null a column of the same tuple.
+	 */
+	slot_getallattrs(firstSlot);
+	attno = -1;
+	while ((attno = bms_next_member(phase->nulled_cols[setno], attno)) >= 0)
+		firstSlot->tts_isnull[attno - 1] = true;
+
+	/* GROUPING() reports the same columns; see ExecEvalGroupingFuncExpr */
+	aggstate->nulled_cols = phase->nulled_cols[setno];
+
+	econtext->ecxt_outertuple = firstSlot;
+
+	/*
+	 * Check the qual (HAVING clause), then form and return a projection tuple
+	 * using the aggregate results and the representative input tuple.
+	 */
+	if (ExecQual(aggstate->ss.ps.qual, econtext, false))
+	{
+		TupleTableSlot *result;
+		ExprDoneCond isDone;
+
+		result = ExecProject(aggstate->ss.ps.ps_ProjInfo, &isDone);
+
+		if (isDone != ExprEndResult)
+		{
+			aggstate->ss.ps.ps_TupFromTlist =
+				(isDone == ExprMultipleResult);
+			return result;
+		}
+	}
+	else
+		InstrCountFiltered1(aggstate, 1);
+
+	return NULL;
+}
+
+/*
+ * Fetch the next input tuple of the current grouping-sets phase, from the
+ * outer plan or from the tuplesort the previous phase filled, and pass it on
+ * to the tuplesort for the next phase, if any.
+ */
+static TupleTableSlot *
+fetch_input_tuple(AggState *aggstate)
+{
+	TupleTableSlot *slot;
+
+	if (aggstate->sort_in)
+	{
+		if (!tuplesort_gettupleslot(aggstate->sort_in, true,
+									aggstate->sort_slot))
+			return NULL;
+		slot = aggstate->sort_slot;
+	}
+	else
+		slot = ExecProcNode(outerPlanState(aggstate));
+
+	if (!TupIsNull(slot) && aggstate->sort_out)
+		tuplesort_puttupleslot(aggstate->sort_out, slot);
+
+	return slot;
+}
+
+/*
+ * Count the grouping sets of the current phase whose group ends before the
+ * given input tuple.  As the sets are prefixes of one another in order of
+ * decreasing length, those are the leading ones: all the sets before the
+ * first one whose columns still match the group's first tuple.
+ */
+static int
+count_finished_sets(AggState *aggstate, TupleTableSlot *slot)
+{
+	AggStatePerPhase phase = &aggstate->phases[aggstate->current_phase];
+	TupleTableSlot *firstSlot = aggstate->ss.ss_ScanTupleSlot;
+	int			setno;
+
+	for (setno = 0; setno < phase->numsets; setno++)
+	{
+		int			length = phase->gset_lengths[setno];
+
+		if (length == 0 ||
+			execTuplesMatch(firstSlot,
+							slot,
+							length, phase->aggnode->grpColIdx,
+							phase->eqfunctions,
+							aggstate->tmpcontext->ecxt_per_tuple_memory))
+			break;
+	}
+
+	return setno;
+}
+
+/*
+ * Switch to the given grouping-sets phase.  Phase 0 reads the outer plan;
+ * any later phase reads the tuplesort built while reading the previous one.
+ * Either way, we start building the sorted input of the following phase.
+ */
+static void
+initialize_phase(AggState *aggstate, int newphase)
+{
+	/* The previous phase's input is no longer needed */
+	if (aggstate->sort_in)
+	{
+		tuplesort_end(aggstate->sort_in);
+		aggstate->sort_in = NULL;
+	}
+
+	if (newphase == 0)
+	{
+		/* Discard any partly-built input of phase 1, after a rescan */
+		if (aggstate->sort_out)
+		{
+			tuplesort_end(aggstate->sort_out);
+			aggstate->sort_out = NULL;
+		}
+	}
+	else
+	{
+		Assert(newphase == aggstate->current_phase + 1);
+		Assert(aggstate->sort_out != NULL);
+		aggstate->sort_in = aggstate->sort_out;
+		aggstate->sort_out = NULL;
+		tuplesort_performsort(aggstate->sort_in);
+	}
+
+	if (newphase + 1 < aggstate->numphases)
+	{
+		Sort	   *sortnode = aggstate->phases[newphase + 1].sortnode;
+		TupleDesc	tupDesc = aggstate->ss.ss_ScanTupleSlot->tts_tupleDescriptor;
+
+		aggstate->sort_out = tuplesort_begin_heap(tupDesc,
+												  sortnode->numCols,
+												  sortnode->sortColIdx,
+												  sortnode->sortOperators,
+												  sortnode->collations,
+												  sortnode->nullsFirst,
+												  work_mem,
+												  false);
+	}
+
+	aggstate->current_phase = newphase;
+	aggstate->input_done = false;
+	aggstate->gset_finished = 0;
+	aggstate->projected_set = 0;
+	ExecClearTuple(aggstate->ss.ss_ScanTupleSlot);
+}
+
+/*
+ * ExecAgg for hashed case: phase 1, read input and build hash table
+ *
+ * The input is either the outer plan or, after the first pass, a batch of
+ * tuples spilled by a previous pass.
+ */
+static void
+agg_fill_hash_table(AggState *aggstate)
+{
+	PlanState  *outerPlan;
+	ExprContext *tmpcontext;
+	HashAggBatch *batch;
+	AggHashEntry entry;
+	TupleTableSlot *outerslot;
+	uint32		hashvalue = 0;
+
+	/*
+	 * get state info from node
+	 */
+	outerPlan = outerPlanState(aggstate);
+	/* tmpcontext is the per-input-tuple expression context */
+	tmpcontext = aggstate->tmpcontext;
+	batch = aggstate->hash_cur_batch;
+
+	/*
+	 * Process each input tuple, and then fetch the next one, until we
+	 * exhaust the input.
+	 */
+	for (;;)
+	{
+		if (batch == NULL)
+			outerslot = ExecProcNode(outerPlan);
+		else
+			outerslot = hashagg_batch_read(aggstate, batch, &hashvalue);
+		if (TupIsNull(outerslot))
+			break;
+		/* set up for advance_aggregates call */
+		tmpcontext->ecxt_outertuple = outerslot;
+
+		/* Find or build hashtable entry for this tuple's group */
+		entry = lookup_hash_entry(aggstate, outerslot);
+
+		if (entry != NULL)
+		{
+			/* Advance the aggregates */
+			advance_aggregates(aggstate, entry->pergroup, 0, 1);
+		}
+		else
+		{
+			/* No room for a new group; save the tuple for a later batch */
+			if (batch == NULL)
+				hashvalue = hashagg_hash_tuple(aggstate, outerslot);
+			hashagg_spill_tuple(aggstate, outerslot, hashvalue);
+		}
+
+		/* Reset per-input-tuple context after each tuple */
+		ResetExprContext(tmpcontext);
+	}
+
+	/* We're done with the current batch, if any */
+	if (batch != NULL)
+	{
+		BufFileClose(batch->file);
+		pfree(batch);
+		aggstate->hash_cur_batch = NULL;
+	}
+
+	/* Queue up whatever we spilled during this pass */
+	hashagg_finish_spill(aggstate);
+
+	aggstate->table_filled = true;
+	/* Initialize to walk the hash table */
+	ResetTupleHashIterator(aggstate->hashtable, &aggstate->hashiter);
+}
+
+/*
+ * ExecAgg for hashed case: phase 2, retrieving groups from hash table
+ */
+static TupleTableSlot *
+agg_retrieve_hash_table(AggState *aggstate)
+{
+	ExprContext *econtext;
+	Datum	   *aggvalues;
+	bool	   *aggnulls;
+	AggStatePerAgg peragg;
+	AggStatePerGroup pergroup;
+	AggHashEntry entry;
+	TupleTableSlot *firstSlot;
+	int			aggno;
+
+	/*
+	 * get state info from node
+	 */
+	/* econtext is the per-output-tuple expression context */
+	econtext = aggstate->ss.ps.ps_ExprContext;
+	aggvalues = econtext->ecxt_aggvalues;
+	aggnulls = econtext->ecxt_aggnulls;
+	peragg = aggstate->peragg;
+	firstSlot = aggstate->ss.ss_ScanTupleSlot;
+
+	/*
+	 * We loop retrieving groups until we find one satisfying
+	 * aggstate->ss.ps.qual
+	 */
+	while (!aggstate->agg_done)
+	{
+		/*
+		 * Find the next entry in the hash table
+		 */
+		entry = (AggHashEntry) ScanTupleHashTable(&aggstate->hashiter);
+		if (entry == NULL)
+		{
+			if (aggstate->hash_batches != NIL)
+			{
+				/* Refill the hash table from the next spilled batch */
+				hashagg_next_batch(aggstate);
+				agg_fill_hash_table(aggstate);
+				continue;
+			}
+
+			/* No more entries in hashtable, so done */
 			aggstate->agg_done = TRUE;
 			return NULL;
 		}
@@ -1519,7 +2592,30 @@ ExecInitAgg(Agg *node, EState *estate, int eflags)
 	aggstate->agg_done = false;
 	aggstate->pergroup = NULL;
 	aggstate->grp_firstTuple = NULL;
+	aggstate->numphases = 0;
+	aggstate->current_phase = 0;
+	aggstate->phases = NULL;
+	aggstate->maxsets = 1;
+	aggstate->current_set = 0;
+	aggstate->aggcontexts = NULL;
+	aggstate->all_grouped_cols = NULL;
+	aggstate->gset_finished = 0;
+	aggstate->projected_set = 0;
+	aggstate->input_done = false;
+	aggstate->sort_in = NULL;
+	aggstate->sort_out = NULL;
+	aggstate->sort_slot = NULL;
 	aggstate->hashtable = NULL;
+	aggstate->hash_entry_size = 0;
+	aggstate->hash_mem_used = 0;
+	aggstate->hash_mem_check_at = 0;
+	aggstate->hash_spill_mode = false;
+	aggstate->hash_spilled = false;
+	aggstate->hash_spill = NULL;
+	aggstate->hash_batches = NIL;
+	aggstate->hash_cur_batch = NULL;
+	aggstate->hash_batches_used = 0;
+	aggstate->batch = NULL;
 
 	/*
 	 * Create expression contexts.  We need two, one for per-input-tuple
@@ -1537,13 +2633,87 @@ ExecInitAgg(Agg *node, EState *estate, int eflags)
 	 * context are driven by a simple decision: we want to reset the
 	 * aggcontext at group boundaries (if not hashing) and in ExecReScanAgg to
 	 * recover no-longer-wanted space.
+	 *
+	 * With grouping sets, each set needs its own such context, since the
+	 * groups of different sets end at different times.  We make them
+	 * ExprContexts so that shutdown callbacks registered by the aggregates
+	 * can be attached to the right set.
 	 */
-	aggstate->aggcontext =
-		AllocSetContextCreate(CurrentMemoryContext,
-							  "AggContext",
-							  ALLOCSET_DEFAULT_MINSIZE,
-							  ALLOCSET_DEFAULT_INITSIZE,
-							  ALLOCSET_DEFAULT_MAXSIZE);
+	if (node->groupingSets)
+	{
+		int			numphases = 1 + list_length(node->chain);
+		int			phaseno;
+		int			setno;
+
+		aggstate->numphases = numphases;
+		aggstate->phases = (AggStatePerPhase)
+			palloc0(sizeof(AggStatePerPhaseData) * numphases);
+
+		for (phaseno = 0; phaseno < numphases; phaseno++)
+		{
+			AggStatePerPhase phase = &aggstate->phases[phaseno];
+			Agg		   *aggnode;
+			ListCell   *lc;
+
+			if (phaseno == 0)
+				aggnode = node;
+			else
+				aggnode = (Agg *) list_nth(node->chain, phaseno - 1);
+
+			phase->aggnode = aggnode;
+			phase->sortnode = (phaseno == 0) ? NULL :
+				(Sort *) aggnode->plan.lefttree;
+			phase->numsets = list_length(aggnode->groupingSets);
+			phase->gset_lengths = (int *) palloc(sizeof(int) * phase->numsets);
+			phase->nulled_cols = (Bitmapset **)
+				palloc0(sizeof(Bitmapset *) * phase->numsets);
+
+			setno = 0;
+			foreach(lc, aggnode->groupingSets)
+				phase->gset_lengths[setno++] = list_length((List *) lfirst(lc));
+
+			if (aggnode->numCols > 0)
+				phase->eqfunctions =
+					execTuplesMatchPrepare(aggnode->numCols,
+										   aggnode->grpOperators);
+
+			for (setno = 0; setno < aggnode->numCols; setno++)
+				aggstate->all_grouped_cols =
+					bms_add_member(aggstate->all_grouped_cols,
+								   aggnode->grpColIdx[setno]);
+
+			aggstate->maxsets = Max(aggstate->maxsets, phase->numsets);
+		}
+
+		/* Now that we know all the grouped columns, see what each set nulls */
+		for (phaseno = 0; phaseno < numphases; phaseno++)
+		{
+			AggStatePerPhase phase = &aggstate->phases[phaseno];
+
+			for (setno = 0; setno < phase->numsets; setno++)
+			{
+				Bitmapset  *cols = bms_copy(aggstate->all_grouped_cols);
+				int			i;
+
+				for (i = 0; i < phase->gset_lengths[setno]; i++)
+					cols = bms_del_member(cols, phase->aggnode->grpColIdx[i]);
+				phase->nulled_cols[setno] = cols;
+			}
+		}
+
+		aggstate->aggcontexts = (ExprContext **)
+			palloc(sizeof(ExprContext *) * aggstate->maxsets);
+		for (setno = 0; setno < aggstate->maxsets; setno++)
+			aggstate->aggcontexts[setno] = CreateExprContext(estate);
+		aggstate->aggcontext = aggstate->aggcontexts[0]->ecxt_per_tuple_memory;
+	}
+	else
+		aggstate->aggcontext =
+			AllocSetContextCreate(CurrentMemoryContext,
+								  "AggContext",
+								  ALLOCSET_DEFAULT_MINSIZE,
+								  ALLOCSET_DEFAULT_INITSIZE,
+								  ALLOCSET_DEFAULT_MAXSIZE);
 
 	/*
 	 * tuple table initialization
@@ -1551,6 +2721,9 @@ ExecInitAgg(Agg *node, EState *estate, int eflags)
 	ExecInitScanTupleSlot(estate, &aggstate->ss);
 	ExecInitResultTupleSlot(estate, &aggstate->ss.ps);
 	aggstate->hashslot = ExecInitExtraTupleSlot(estate);
+	aggstate->hash_spill_slot = ExecInitExtraTupleSlot(estate);
+	if (node->groupingSets)
+		aggstate->sort_slot = ExecInitExtraTupleSlot(estate);
 
 	/*
 	 * initialize child expressions
@@ -1583,6 +2756,9 @@ ExecInitAgg(Agg *node, EState *estate, int eflags)
 	 * initialize source tuple type.
 	 */
 	ExecAssignScanTypeFromOuterPlan(&aggstate->ss);
+	if (node->groupingSets)
+		ExecSetSlotDescriptor(aggstate->sort_slot,
+							  aggstate->ss.ss_ScanTupleSlot->tts_tupleDescriptor);
 
 	/*
 	 * Initialize result tuple type and projection info.
@@ -1644,12 +2820,18 @@ ExecInitAgg(Agg *node, EState *estate, int eflags)
 		aggstate->table_filled = false;
 		/* Compute the columns we actually need to hash on */
 		aggstate->hash_needed = find_hash_columns(aggstate);
+		/* Spilled tuples are read back in the outer plan's format */
+		ExecSetSlotDescriptor(aggstate->hash_spill_slot,
+							  ExecGetResultType(outerPlanState(aggstate)));
+		/* Per-group memory estimate; transition space is added below */
+		aggstate->hash_entry_size = hash_agg_entry_size(aggstate->numaggs);
 	}
 	else
 	{
 		AggStatePerGroup pergroup;
 
-		pergroup = (AggStatePerGroup) palloc0(sizeof(AggStatePerGroupData) * numaggs);
+		pergroup = (AggStatePerGroup)
+			palloc0(sizeof(AggStatePerGroupData) * numaggs * aggstate->maxsets);
 		aggstate->pergroup = pergroup;
 	}
 
@@ -1712,7 +2894,8 @@ ExecInitAgg(Agg *node, EState *estate, int eflags)
 		/* Begin filling in the peraggstate data */
 		peraggstate->aggrefstate = aggrefstate;
 		peraggstate->aggref = aggref;
-		peraggstate->sortstate = NULL;
+		peraggstate->sortstates = (Tuplesortstate **)
+			palloc0(sizeof(Tuplesortstate *) * aggstate->maxsets);
 
 		/* Fetch the pg_aggregate row */
 		aggTuple = SearchSysCache1(AGGFNOID,
@@ -1838,6 +3021,35 @@ ExecInitAgg(Agg *node, EState *estate, int eflags)
 						&peraggstate->transtypeLen,
 						&peraggstate->transtypeByVal);
 
+		/*
+		 * In hashed mode, add the space each group's transition value is
+		 * likely to need to the per-group memory estimate.  This follows the
+		 * planner's reasoning in count_agg_clauses_walker.
+		 */
+		if (node->aggstrategy == AGG_HASHED)
+		{
+			if (!peraggstate->transtypeByVal)
+			{
+				int32		avgwidth;
+
+				if (peraggstate->transtypeLen > 0)
+					avgwidth = peraggstate->transtypeLen;
+				else if (aggform->aggtransspace > 0)
+					avgwidth = aggform->aggtransspace;
+				else
+					avgwidth = get_typavgwidth(aggtranstype, -1);
+				aggstate->hash_entry_size += MAXALIGN(avgwidth) +
+					2 * sizeof(void *);
+			}
+			else if (aggtranstype == INTERNALOID)
+			{
+				if (aggform->aggtransspace > 0)
+					aggstate->hash_entry_size += aggform->aggtransspace;
+				else
+					aggstate->hash_entry_size += ALLOCSET_DEFAULT_INITSIZE;
+			}
+		}
+
 		/*
 		 * initval is potentially null, so don't try to access it as a struct
 		 * field. Must do it the hard way with SysCacheGetAttr.
@@ -1996,9 +3208,131 @@ ExecInitAgg(Agg *node, EState *estate, int eflags)
 	/* Update numaggs to match number of unique aggregates found */
 	aggstate->numaggs = aggno + 1;
 
+	if (node->groupingSets)
+		initialize_phase(aggstate, 0);
+
+	/*
+	 * Read the input in batches if possible.  That's only done for plain
+	 * aggregation, which needn't look at input rows individually.
+	 */
+	if (node->aggstrategy == AGG_PLAIN && !node->groupingSets)
+		aggstate->batch = agg_init_batch(aggstate);
+
 	return aggstate;
 }
 
+/*
+ * Choose how to advance an aggregate's transition value from a batch.
+ *
+ * The builtin count, sum, avg, min and max aggregates on integer types have
+ * kernels working on whole columns; the transition values they build are
+ * exactly those that their transition functions would have.  The kernels
+ * that keep an int8 transition value in the Datum need int8 to be pass by
+ * value.  For everything else the transition function is called per row.
+ */
+static AggBatchKernel
+choose_batch_kernel(AggStatePerAgg peraggstate)
+{
+	switch (peraggstate->transfn_oid)
+	{
+		case F_INT8INC:
+			if (peraggstate->transtypeByVal)
+				return AGG_BATCH_COUNT_STAR;
+			break;
+		case F_INT8INC_ANY:
+			if (peraggstate->transtypeByVal)
+				return AGG_BATCH_COUNT;
+			break;
+		case F_INT2_SUM:
+		case F_INT4_SUM:
+			if (peraggstate->transtypeByVal)
+				return AGG_BATCH_SUM_INT;
+			break;
+		case F_INT2_AVG_ACCUM:
+		case F_INT4_AVG_ACCUM:
+			return AGG_BATCH_AVG_INT;
+		case F_INT8_AVG_ACCUM:
+			return AGG_BATCH_SUM_INT8;
+		case F_INT2LARGER:
+		case F_INT4LARGER:
+		case F_INT8LARGER:
+			if (peraggstate->transtypeByVal)
+				return AGG_BATCH_MAX_INT;
+			break;
+		case F_INT2SMALLER:
+		case F_INT4SMALLER:
+		case F_INT8SMALLER:
+			if (peraggstate->transtypeByVal)
+				return AGG_BATCH_MIN_INT;
+			break;
+		default:
+			break;
+	}
+
+	return AGG_BATCH_GENERIC;
+}
+
+/*
+ * Set up to read the input of a plain aggregation in batches, if possible.
+ *
+ * Each aggregate must have at most one argument, which must be a plain
+ * input column, and no DISTINCT, ORDER BY or FILTER clause.  The outer plan
+ * node then decides whether it can deliver those columns in batches.
+ * Returns NULL if the input is to be read a row at a time.
+ */
+static TupleBatch *
+agg_init_batch(AggState *aggstate)
+{
+	int			numaggs = aggstate->numaggs;
+	AttrNumber *cols;
+	int			ncols = 0;
+	int			aggno;
+	TupleBatch *batch;
+
+	cols = (AttrNumber *) palloc(Max(numaggs, 1) * sizeof(AttrNumber));
+
+	for (aggno = 0; aggno < numaggs; aggno++)
+	{
+		AggStatePerAgg peraggstate = &aggstate->peragg[aggno];
+		Aggref	   *aggref = peraggstate->aggref;
+		Var		   *var;
+		int			col;
+
+		if (peraggstate->numSortCols > 0 ||
+			aggref->aggfilter != NULL ||
+			AGGKIND_IS_ORDERED_SET(aggref->aggkind) ||
+			list_length(aggref->args) > 1 ||
+			peraggstate->numTransInputs != list_length(aggref->args))
+			return NULL;
+
+		peraggstate->batchkernel = choose_batch_kernel(peraggstate);
+		peraggstate->batchcol = -1;
+
+		if (aggref->args == NIL)
+			continue;
+
+		var = (Var *) ((TargetEntry *) linitial(aggref->args))->expr;
+		if (!IsA(var, Var) || var->varno != OUTER_VAR)
+			return NULL;
+
+		/* input columns shared by several aggregates are fetched once */
+		for (col = 0; col < ncols; col++)
+		{
+			if (cols[col] == var->varattno)
+				break;
+		}
+		if (col == ncols)
+			cols[ncols++] = var->varattno;
+		peraggstate->batchcol = col;
+	}
+
+	batch = ExecInitBatch(outerPlanState(aggstate), ncols, cols);
+
+	pfree(cols);
+
+	return batch;
+}
+
 static Datum
 GetAggInitVal(Datum textInitVal, Oid transtype)
 {
@@ -2020,18 +3354,34 @@ ExecEndAgg(AggState *node)
 {
 	PlanState  *outerPlan;
 	int			aggno;
+	int			setno;
 
 	/* Make sure we have closed any open tuplesorts */
 	for (aggno = 0; aggno < node->numaggs; aggno++)
 	{
 		AggStatePerAgg peraggstate = &node->peragg[aggno];
 
-		if (peraggstate->sortstate)
-			tuplesort_end(peraggstate->sortstate);
+		for (setno = 0; setno < node->maxsets; setno++)
+		{
+			if (peraggstate->sortstates[setno])
+				tuplesort_end(peraggstate->sortstates[setno]);
+		}
 	}
+	if (node->sort_in)
+		tuplesort_end(node->sort_in);
+	if (node->sort_out)
+		tuplesort_end(node->sort_out);
 
 	/* And ensure any agg shutdown callbacks have been called */
 	ReScanExprContext(node->ss.ps.ps_ExprContext);
+	if (node->aggcontexts)
+	{
+		for (setno = 0; setno < node->maxsets; setno++)
+			ReScanExprContext(node->aggcontexts[setno]);
+	}
+
+	/* Release any hash aggregation spill files */
+	hashagg_reset_spill_state(node);
 
 	/*
 	 * Free both the expr contexts.
@@ -2043,7 +3393,9 @@ ExecEndAgg(AggState *node)
 	/* clean up tuple table */
 	ExecClearTuple(node->ss.ss_ScanTupleSlot);
 
-	MemoryContextDelete(node->aggcontext);
+	/* with grouping sets, aggcontext belongs to one of the aggcontexts */
+	if (node->aggcontexts == NULL)
+		MemoryContextDelete(node->aggcontext);
 
 	outerPlan = outerPlanState(node);
 	ExecEndNode(outerPlan);
@@ -2054,6 +3406,7 @@ ExecReScanAgg(AggState *node)
 {
 	ExprContext *econtext = node->ss.ps.ps_ExprContext;
 	int			aggno;
+	int			setno;
 
 	node->agg_done = false;
 
@@ -2073,13 +3426,17 @@ ExecReScanAgg(AggState *node)
 		/*
 		 * If we do have the hash table and the subplan does not have any
 		 * parameter changes, then we can just rescan the existing hash table;
-		 * no need to build it again.
+		 * no need to build it again.  That doesn't work if we spilled, since
+		 * the table then only holds the groups of the last batch.
 		 */
-		if (node->ss.ps.lefttree->chgParam == NULL)
+		if (node->ss.ps.lefttree->chgParam == NULL && !node->hash_spilled)
 		{
 			ResetTupleHashIterator(node->hashtable, &node->hashiter);
 			return;
 		}
+
+		/* Forget about any spill files; we'll read the input afresh */
+		hashagg_reset_spill_state(node);
 	}
 
 	/* Make sure we have closed any open tuplesorts */
@@ -2087,9 +3444,12 @@ ExecReScanAgg(AggState *node)
 	{
 		AggStatePerAgg peraggstate = &node->peragg[aggno];
 
-		if (peraggstate->sortstate)
-			tuplesort_end(peraggstate->sortstate);
-		peraggstate->sortstate = NULL;
+		for (setno = 0; setno < node->maxsets; setno++)
+		{
+			if (peraggstate->sortstates[setno])
+				tuplesort_end(peraggstate->sortstates[setno]);
+			peraggstate->sortstates[setno] = NULL;
+		}
 	}
 
 	/* We don't need to ReScanExprContext here; ExecReScan already did it */
@@ -2110,9 +3470,24 @@ ExecReScanAgg(AggState *node)
 	 * allocated in a sub-context of the aggcontext. We're going to rebuild
 	 * the hash table from scratch, so we need to use
 	 * MemoryContextResetAndDeleteChildren() to avoid leaking the old hash
-	 * table's memory context header.
+	 * table's memory context header.  With grouping sets, reset each set's
+	 * context, which also calls any shutdown callbacks registered there, and
+	 * go back to the first phase.
 	 */
-	MemoryContextResetAndDeleteChildren(node->aggcontext);
+	if (node->aggcontexts)
+	{
+		for (setno = 0; setno < node->maxsets; setno++)
+		{
+			ExprContext *aggcontext = node->aggcontexts[setno];
+
+			ReScanExprContext(aggcontext);
+			MemoryContextResetAndDeleteChildren(aggcontext->ecxt_per_tuple_memory);
+		}
+		select_current_set(node, 0);
+		initialize_phase(node, 0);
+	}
+	else
+		MemoryContextResetAndDeleteChildren(node->aggcontext);
 
 	if (((Agg *) node->ss.ps.plan)->aggstrategy == AGG_HASHED)
 	{
@@ -2126,7 +3501,7 @@ ExecReScanAgg(AggState *node)
 		 * Reset the per-group state (in particular, mark transvalues null)
 		 */
 		MemSet(node->pergroup, 0,
-			   sizeof(AggStatePerGroupData) * node->numaggs);
+			   sizeof(AggStatePerGroupData) * node->numaggs * node->maxsets);
 	}
 
 	/*
@@ -2247,8 +3622,15 @@ AggRegisterCallback(FunctionCallInfo fcinfo,
 	if (fcinfo->context && IsA(fcinfo->context, AggState))
 	{
 		AggState   *aggstate = (AggState *) fcinfo->context;
+		ExprContext *cxt;
+
+		/* With grouping sets, the callback goes with the current set */
+		if (aggstate->aggcontexts)
+			cxt = aggstate->aggcontexts[aggstate->current_set];
+		else
+			cxt = aggstate->ss.ps.ps_ExprContext;
 
-		RegisterExprContextCallback(aggstate->ss.ps.ps_ExprContext, func, arg);
+		RegisterExprContextCallback(cxt, func, arg);
 
 		return;
 	}
@@ -0,0 +1,735 @@
+/*-------------------------------------------------------------------------
+ *
+ * nodeGather.c
+ *	  Support routines for scanning a relation with parallel workers.
+ *
+ * A Gather node's child is a sequential scan.  On the first call, Gather
+ * sets up a parallel heap scan of the child's relation in a dynamic shared
+ * memory segment, ships a copy of the child plan to some background workers,
+ * and gives each worker a tuple queue.  The workers run the child plan over
+ * whichever blocks they claim from the shared scan, and send the resulting
+ * tuples to the master through their queues.  The master runs its own copy
+ * of the child plan the same way, and returns tuples from the queues and
+ * from its local scan as they become available.
+ *
+ * The child may also be a Sort over the sequential scan.  Then each
+ * participant, the master included, sorts whatever it scans into a shared
+ * sort, and the workers send nothing through their queues.  Once all of
+ * them are done, the master's Sort merges their sorted runs, and Gather
+ * returns its output in order.
+ *
+ * Or the child may be an inner HashJoin of two sequential scans, the inner
+ * one under its Hash node.  Both scans are then parallel, and instead of
+ * each building a hash table of its own share of the inner relation, the
+ * participants build one in the shared memory segment together, and probe
+ * it with their shares of the outer relation; see executor/hashjoin.h.
+ *
+ * If no workers can be launched, the master simply does all the work.
+ *
+ * Portions Copyright (c) 1996-2015, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/executor/nodeGather.c
+ *
+ *-------------------------------------------------------------------------
+ */
+/*
+ * INTERFACE ROUTINES
+ *		ExecGather			- return the next tuple from any participant
+ *		ExecInitGather		- initialize node and subnodes
+ *		ExecEndGather		- shutdown node and subnodes
+ *		ExecReScanGather	- rescan the relation
+ */
+#include "postgres.h"
+
+#include "access/parallel.h"
+#include "access/relscan.h"
+#include "access/xact.h"
+#include "executor/executor.h"
+#include "executor/nodeGather.h"
+#include "executor/nodeHashjoin.h"
+#include "executor/nodeSeqscan.h"
+#include "executor/nodeSort.h"
+#include "miscadmin.h"
+#include "nodes/nodeFuncs.h"
+#include "optimizer/planmain.h"
+#include "storage/lmgr.h"
+#include "storage/proc.h"
+#include "storage/shm_mq.h"
+#include "utils/memutils.h"
+#include "utils/snapmgr.h"
+#include "utils/tqual.h"
+
+
+/* Keys for the parts of the parallel state that belong to Gather */
+#define PARALLEL_KEY_SCAN			UINT64CONST(1)
+#define PARALLEL_KEY_PLAN			UINT64CONST(2)
+#define PARALLEL_KEY_RANGE_TABLE	UINT64CONST(3)
+#define PARALLEL_KEY_TUPLE_QUEUE	UINT64CONST(4)
+#define PARALLEL_KEY_EXECUTOR_FLAGS	UINT64CONST(5)
+#define PARALLEL_KEY_TUPLESORT		UINT64CONST(6)
+#define PARALLEL_KEY_INNER_SCAN		UINT64CONST(7)
+#define PARALLEL_KEY_HASHJOIN		UINT64CONST(8)
+
+/* Size of each worker's tuple queue */
+#define PARALLEL_TUPLE_QUEUE_SIZE	65536
+
+static SeqScanState *gather_scan_state(PlanState *child,
+				  SeqScanState **inner);
+static void ExecGatherLaunchWorkers(GatherState *node);
+static void ExecShutdownGatherWorkers(GatherState *node);
+static TupleTableSlot *gather_getnext(GatherState *node);
+static MinimalTuple gather_readnext(GatherState *node);
+static void gather_forget_reader(GatherState *node, int i);
+static void gather_fix_opfuncids(Plan *plan);
+static void ParallelGatherMain(dsm_segment *seg, shm_toc *toc);
+
+
+/* ----------------------------------------------------------------
+ *		ExecInitGather
+ * ----------------------------------------------------------------
+ */
+GatherState *
+ExecInitGather(Gather *node, EState *estate, int eflags)
+{
+	GatherState *gatherstate;
+
+	/* Gather node doesn't have innerPlan node. */
+	Assert(innerPlan(node) == NULL);
+
+	/* Workers can't scan backwards, or mark and restore. */
+	Assert(!(eflags & (EXEC_FLAG_BACKWARD | EXEC_FLAG_MARK)));
+
+	/*
+	 * create state structure
+	 */
+	gatherstate = makeNode(GatherState);
+	gatherstate->ps.plan = (Plan *) node;
+	gatherstate->ps.state = estate;
+
+	/*
+	 * Miscellaneous initialization
+	 *
+	 * create expression context for node
+	 */
+	ExecAssignExprContext(estate, &gatherstate->ps);
+
+	/*
+	 * tuple table initialization
+	 */
+	ExecInitResultTupleSlot(estate, &gatherstate->ps);
+	gatherstate->funnel_slot = ExecInitExtraTupleSlot(estate);
+
+	/*
+	 * now initialize outer plan; the parallel scan is set up on the first
+	 * call, since EXPLAIN without ANALYZE never needs the workers.  A rescan
+	 * starts everything over, so the child needn't support REWIND; a shared
+	 * sort couldn't.
+	 */
+	eflags &= ~EXEC_FLAG_REWIND;
+	outerPlanState(gatherstate) = ExecInitNode(outerPlan(node), estate, eflags);
+	(void) gather_scan_state(outerPlanState(gatherstate), NULL);
+
+	/*
+	 * Gather shares its child's target list and doesn't project, like
+	 * Material.
+	 */
+	ExecAssignResultTypeFromTL(&gatherstate->ps);
+	gatherstate->ps.ps_ProjInfo = NULL;
+	ExecSetSlotDescriptor(gatherstate->funnel_slot,
+						  ExecGetResultType(outerPlanState(gatherstate)));
+
+	return gatherstate;
+}
+
+/* ----------------------------------------------------------------
+ *		ExecGather
+ *
+ *		Launches the workers on the first call, and then returns the next
+ *		tuple produced by any participant.
+ * ----------------------------------------------------------------
+ */
+TupleTableSlot *
+ExecGather(GatherState *node)
+{
+	if (!node->initialized)
+	{
+		ExecGatherLaunchWorkers(node);
+
+		/*
+		 * A shared sort's workers send us nothing.  Sort our own share of the
+		 * input, and once everybody is done, let the Sort merge the runs.
+		 */
+		if (node->sharedsort != NULL)
+		{
+			ExecSortShareInput((SortState *) outerPlanState(node));
+			WaitForParallelWorkersToFinish(node->pcxt);
+			ExecShutdownGatherWorkers(node);
+		}
+
+		node->need_to_scan_locally = true;
+		node->initialized = true;
+	}
+
+	return gather_getnext(node);
+}
+
+/* ----------------------------------------------------------------
+ *		ExecEndGather
+ *
+ *		frees any storage allocated through C routines.
+ * ----------------------------------------------------------------
+ */
+void
+ExecEndGather(GatherState *node)
+{
+	ExecEndNode(outerPlanState(node));
+	ExecShutdownGatherWorkers(node);
+	if (node->pcxt != NULL)
+	{
+		DestroyParallelContext(node->pcxt);
+		node->pcxt = NULL;
+		ExitParallelMode();
+	}
+	ExecFreeExprContext(&node->ps);
+	ExecClearTuple(node->ps.ps_ResultTupleSlot);
+	ExecClearTuple(node->funnel_slot);
+}
+
+/* ----------------------------------------------------------------
+ *		ExecReScanGather
+ *
+ *		Stops any workers that are still running, and resets the shared
+ *		scan, so that the next call starts over with fresh workers.
+ * ----------------------------------------------------------------
+ */
+void
+ExecReScanGather(GatherState *node)
+{
+	ExecShutdownGatherWorkers(node);
+	if (node->pcxt != NULL)
+	{
+		ReinitializeParallelDSM(node->pcxt);
+		heap_parallelscan_reinitialize(node->pscan);
+		if (node->inner_pscan != NULL)
+			heap_parallelscan_reinitialize(node->inner_pscan);
+	}
+	node->initialized = false;
+	ExecClearTuple(node->funnel_slot);
+
+	/*
+	 * if chgParam of subnode is not null then plan will be re-scanned by
+	 * first ExecProcNode.  The files of a shared sort or hash table can't be
+	 * dropped until the child has let go of them, though, so rescan that
+	 * right away.
+	 */
+	if (node->sharedsort != NULL)
+	{
+		ExecReScan(node->ps.lefttree);
+		tuplesort_reinitialize_shared(node->sharedsort);
+	}
+	else if (node->sharedhash != NULL)
+	{
+		ExecReScan(node->ps.lefttree);
+		ExecHashJoinReInitializeShared((HashJoinState *) node->ps.lefttree);
+	}
+	else if (node->ps.lefttree->chgParam == NULL)
+		ExecReScan(node->ps.lefttree);
+}
+
+/*
+ * gather_scan_state
+ *
+ * Return the sequential scan at the bottom of a Gather node's child, which
+ * is either the scan itself, a Sort of it, or an inner HashJoin of it with
+ * another scan.  If inner isn't NULL, *inner is set to the HashJoin's inner
+ * scan, or NULL for the other children.
+ */
+static SeqScanState *
+gather_scan_state(PlanState *child, SeqScanState **inner)
+{
+	PlanState  *scan = child;
+	PlanState  *inner_scan = NULL;
+
+	if (IsA(scan, SortState))
+		scan = outerPlanState(scan);
+	else if (IsA(scan, HashJoinState) &&
+			 ((HashJoinState *) scan)->js.jointype == JOIN_INNER)
+	{
+		inner_scan = outerPlanState(innerPlanState(scan));
+		scan = outerPlanState(scan);
+		if (!IsA(inner_scan, SeqScanState))
+			elog(ERROR, "unexpected child of Gather node: %d",
+				 (int) nodeTag(child));
+	}
+	if (!IsA(scan, SeqScanState))
+		elog(ERROR, "unexpected child of Gather node: %d",
+			 (int) nodeTag(child));
+
+	if (inner != NULL)
+		*inner = (SeqScanState *) inner_scan;
+	return (SeqScanState *) scan;
+}
+
+/*
+ * ExecGatherLaunchWorkers
+ *
+ * Set up the shared state, if we haven't already, and launch the workers.
+ * When parallelism isn't possible, leave node->pcxt unset and launch nothing;
+ * the local scan then covers the whole relation.
+ */
+static void
+ExecGatherLaunchWorkers(GatherState *node)
+{
+	Gather	   *gather = (Gather *) node->ps.plan;
+	EState	   *estate = node->ps.state;
+	PlanState  *child = outerPlanState(node);
+	SeqScanState *inner;
+	SeqScanState *scan = gather_scan_state(child, &inner);
+	ParallelContext *pcxt = node->pcxt;
+	char	   *queuespace;
+	int			i;
+
+	Assert(node->nreaders == 0);
+
+	if (pcxt == NULL)
+	{
+		char	   *plan_string;
+		char	   *rtable_string;
+		Size		plan_len;
+		Size		rtable_len;
+		char	   *space;
+		int		   *eflags;
+
+		/*
+		 * The workers must see exactly what we see, so only an MVCC snapshot
+		 * will do; and serializable transactions would need their predicate
+		 * locks shared, which we don't do.
+		 */
+		if (gather->num_workers <= 0 || !IsUnderPostmaster ||
+			!IsMVCCSnapshot(estate->es_snapshot) ||
+			IsolationIsSerializable())
+			return;
+
+		plan_string = nodeToString(outerPlan(gather));
+		plan_len = strlen(plan_string) + 1;
+		rtable_string = nodeToString(estate->es_range_table);
+		rtable_len = strlen(rtable_string) + 1;
+
+		/*
+		 * The workers copy our transaction state, and may be relaunched by
+		 * rescans using the same copy, so it must stay fixed until the
+		 * context is destroyed.
+		 */
+		EnterParallelMode();
+		pcxt = CreateParallelContext(ParallelGatherMain, gather->num_workers);
+
+		shm_toc_estimate_chunk(&pcxt->estimator, heap_parallelscan_estimate());
+		shm_toc_estimate_chunk(&pcxt->estimator, plan_len);
+		shm_toc_estimate_chunk(&pcxt->estimator, rtable_len);
+		shm_toc_estimate_chunk(&pcxt->estimator,
+							   mul_size(PARALLEL_TUPLE_QUEUE_SIZE,
+										pcxt->nworkers));
+		shm_toc_estimate_chunk(&pcxt->estimator, sizeof(int));
+		shm_toc_estimate_keys(&pcxt->estimator, 5);
+		if (IsA(child, SortState))
+		{
+			shm_toc_estimate_chunk(&pcxt->estimator,
+								   tuplesort_estimate_shared());
+			shm_toc_estimate_keys(&pcxt->estimator, 1);
+		}
+		if (IsA(child, HashJoinState))
+		{
+			shm_toc_estimate_chunk(&pcxt->estimator,
+								   heap_parallelscan_estimate());
+			shm_toc_estimate_chunk(&pcxt->estimator,
+				ExecHashJoinEstimateShared((HashJoinState *) child,
+										   pcxt->nworkers + 1));
+			shm_toc_estimate_keys(&pcxt->estimator, 2);
+		}
+
+		/* the workers adopt the executor's snapshot, whatever is active */
+		PushActiveSnapshot(estate->es_snapshot);
+		InitializeParallelDSM(pcxt);
+		PopActiveSnapshot();
+
+		node->pscan = shm_toc_allocate(pcxt->toc, heap_parallelscan_estimate());
+		heap_parallelscan_initialize(node->pscan,
+									 scan->ss_currentRelation);
+		shm_toc_insert(pcxt->toc, PARALLEL_KEY_SCAN, node->pscan);
+
+		space = shm_toc_allocate(pcxt->toc, plan_len);
+		memcpy(space, plan_string, plan_len);
+		shm_toc_insert(pcxt->toc, PARALLEL_KEY_PLAN, space);
+
+		space = shm_toc_allocate(pcxt->toc, rtable_len);
+		memcpy(space, rtable_string, rtable_len);
+		shm_toc_insert(pcxt->toc, PARALLEL_KEY_RANGE_TABLE, space);
+
+		space = shm_toc_allocate(pcxt->toc,
+								 mul_size(PARALLEL_TUPLE_QUEUE_SIZE,
+										  pcxt->nworkers));
+		shm_toc_insert(pcxt->toc, PARALLEL_KEY_TUPLE_QUEUE, space);
+
+		/*
+		 * Whether scan tuples must be projected to add or remove an OID
+		 * depends on the executor flags, and the workers' tuples have to
+		 * match ours.
+		 */
+		eflags = shm_toc_allocate(pcxt->toc, sizeof(int));
+		*eflags = estate->es_top_eflags &
+			(EXEC_FLAG_WITH_OIDS | EXEC_FLAG_WITHOUT_OIDS);
+		shm_toc_insert(pcxt->toc, PARALLEL_KEY_EXECUTOR_FLAGS, eflags);
+
+		/* every worker may take part in a shared sort, and so do we */
+		if (IsA(child, SortState))
+		{
+			node->sharedsort = shm_toc_allocate(pcxt->toc,
+												tuplesort_estimate_shared());
+			tuplesort_initialize_shared(node->sharedsort, pcxt->nworkers + 1,
+										pcxt->seg);
+			shm_toc_insert(pcxt->toc, PARALLEL_KEY_TUPLESORT,
+						   node->sharedsort);
+			ExecSortInitializeShared((SortState *) child, node->sharedsort);
+		}
+
+		/* likewise in a shared hash table, built from a second scan */
+		if (IsA(child, HashJoinState))
+		{
+			HashJoinState *hjstate = (HashJoinState *) child;
+
+			node->inner_pscan = shm_toc_allocate(pcxt->toc,
+												 heap_parallelscan_estimate());
+			heap_parallelscan_initialize(node->inner_pscan,
+										 inner->ss_currentRelation);
+			shm_toc_insert(pcxt->toc, PARALLEL_KEY_INNER_SCAN,
+						   node->inner_pscan);
+
+			node->sharedhash = shm_toc_allocate(pcxt->toc,
+				ExecHashJoinEstimateShared(hjstate, pcxt->nworkers + 1));
+			ExecHashJoinInitializeShared(hjstate, node->sharedhash,
+										 pcxt->nworkers + 1, pcxt->seg);
+			shm_toc_insert(pcxt->toc, PARALLEL_KEY_HASHJOIN,
+						   node->sharedhash);
+		}
+
+		pfree(plan_string);
+		pfree(rtable_string);
+
+		node->pcxt = pcxt;
+		node->queue = palloc(sizeof(shm_mq *) * pcxt->nworkers);
+		node->reader = palloc(sizeof(shm_mq_handle *) * pcxt->nworkers);
+
+		/* from now on, our own scans claim blocks from the shared state */
+		ExecSeqScanInitializeParallel(scan, node->pscan);
+		if (inner != NULL)
+			ExecSeqScanInitializeParallel(inner, node->inner_pscan);
+	}
+
+	/* Create a fresh queue for each worker, with us as the receiver. */
+	queuespace = shm_toc_lookup(pcxt->toc, PARALLEL_KEY_TUPLE_QUEUE);
+	for (i = 0; i < pcxt->nworkers; i++)
+	{
+		shm_mq	   *mq;
+
+		mq = shm_mq_create(queuespace + i * PARALLEL_TUPLE_QUEUE_SIZE,
+						   PARALLEL_TUPLE_QUEUE_SIZE);
+		shm_mq_set_receiver(mq, MyProc);
+		node->queue[i] = mq;
+	}
+
+	LaunchParallelWorkers(pcxt);
+	node->nworkers_launched = pcxt->nworkers_launched;
+
+	/*
+	 * Workers number themselves in the order they start, so only the first
+	 * nworkers_launched queues can ever get a sender.
+	 */
+	for (i = 0; i < pcxt->nworkers_launched; i++)
+		node->reader[i] = shm_mq_attach(node->queue[i], pcxt->seg, NULL);
+	node->nreaders = pcxt->nworkers_launched;
+	node->nextreader = 0;
+}
+
+/*
+ * ExecShutdownGatherWorkers
+ *
+ * Stop reading from the workers.  If we stop before they are done, they
+ * find their queues detached and quit.
+ */
+static void
+ExecShutdownGatherWorkers(GatherState *node)
+{
+	while (node->nreaders > 0)
+		gather_forget_reader(node, node->nreaders - 1);
+}
+
+/*
+ * gather_getnext
+ *
+ * Return the next tuple from a worker's queue or from the local scan,
+ * waiting on our latch when the workers have nothing for us and the local
+ * scan is finished.
+ */
+static TupleTableSlot *
+gather_getnext(GatherState *node)
+{
+	PlanState  *outerPlan = outerPlanState(node);
+	TupleTableSlot *slot;
+	MinimalTuple tup;
+
+	while (node->nreaders > 0 || node->need_to_scan_locally)
+	{
+		CHECK_FOR_INTERRUPTS();
+
+		if (node->nreaders > 0)
+		{
+			tup = gather_readnext(node);
+			if (tup != NULL)
+				return ExecStoreMinimalTuple(tup, node->funnel_slot, true);
+		}
+
+		if (node->need_to_scan_locally)
+		{
+			slot = ExecProcNode(outerPlan);
+			if (!TupIsNull(slot))
+				return slot;
+			node->need_to_scan_locally = false;
+			continue;
+		}
+
+		if (node->nreaders == 0)
+			break;
+
+		/*
+		 * Nothing is ready.  A worker that never managed to start can't
+		 * detach its queue, so once all workers have exited, give up on
+		 * queues that never got a sender.
+		 */
+		if (ParallelWorkersStopped(node->pcxt))
+		{
+			int			i;
+
+			for (i = node->nreaders - 1; i >= 0; i--)
+			{
+				if (shm_mq_get_sender(node->queue[i]) == NULL)
+					gather_forget_reader(node, i);
+			}
+			if (node->nreaders == 0)
+				WaitForParallelWorkersToFinish(node->pcxt);
+			continue;
+		}
+
+		WaitLatch(MyLatch, WL_LATCH_SET, 0);
+		ResetLatch(MyLatch);
+	}
+
+	return ExecClearTuple(node->funnel_slot);
+}
+
+/*
+ * gather_readnext
+ *
+ * Try each queue once, without waiting, and return a copy of the first
+ * tuple found, or NULL if none of the queues has one ready.
+ */
+static MinimalTuple
+gather_readnext(GatherState *node)
+{
+	int			nvisited = 0;
+
+	while (node->nreaders > 0 && nvisited < node->nreaders)
+	{
+		shm_mq_result result;
+		Size		nbytes;
+		void	   *data;
+
+		result = shm_mq_receive(node->reader[node->nextreader],
+								&nbytes, &data, true);
+
+		if (result == SHM_MQ_SUCCESS)
+		{
+			MinimalTuple tup = palloc(nbytes);
+
+			memcpy(tup, data, nbytes);
+			node->nextreader = (node->nextreader + 1) % node->nreaders;
+			return tup;
+		}
+
+		if (result == SHM_MQ_DETACHED)
+		{
+			/* the worker is done, or has failed */
+			CheckParallelWorkerErrors(node->pcxt);
+			gather_forget_reader(node, node->nextreader);
+			if (node->nreaders == 0)
+			{
+				/* make sure nobody quit without finishing its share */
+				WaitForParallelWorkersToFinish(node->pcxt);
+				return NULL;
+			}
+			if (node->nextreader >= node->nreaders)
+				node->nextreader = 0;
+			continue;
+		}
+
+		Assert(result == SHM_MQ_WOULD_BLOCK);
+		node->nextreader = (node->nextreader + 1) % node->nreaders;
+		nvisited++;
+	}
+
+	return NULL;
+}
+
+/*
+ * gather_forget_reader
+ *
+ * Detach from the i'th remaining queue and remove it from the arrays.
+ */
+static void
+gather_forget_reader(GatherState *node, int i)
+{
+	shm_mq_detach(node->queue[i]);
+	pfree(node->reader[i]);
+	--node->nreaders;
+	memmove(&node->queue[i], &node->queue[i + 1],
+			sizeof(shm_mq *) * (node->nreaders - i));
+	memmove(&node->reader[i], &node->reader[i + 1],
+			sizeof(shm_mq_handle *) * (node->nreaders - i));
+}
+
+/*
+ * gather_fix_opfuncids
+ *
+ * Reading a plan drops its operators' function OIDs, so a worker has to look
+ * them up again, throughout the plan tree.
+ */
+static void
+gather_fix_opfuncids(Plan *plan)
+{
+	if (plan == NULL)
+		return;
+
+	fix_opfuncids((Node *) plan->targetlist);
+	fix_opfuncids((Node *) plan->qual);
+	if (IsA(plan, HashJoin))
+	{
+		fix_opfuncids((Node *) ((HashJoin *) plan)->join.joinqual);
+		fix_opfuncids((Node *) ((HashJoin *) plan)->hashclauses);
+	}
+
+	gather_fix_opfuncids(plan->lefttree);
+	gather_fix_opfuncids(plan->righttree);
+}
+
+/*
+ * ParallelGatherMain
+ *
+ * Entrypoint of a Gather worker: run the child plan over the blocks we
+ * claim from the shared scan, and send each resulting tuple to the master.
+ * A Sort child instead sorts our share into the shared sort, and returns
+ * nothing for us to send.
+ */
+static void
+ParallelGatherMain(dsm_segment *seg, shm_toc *toc)
+{
+	ParallelHeapScanDesc pscan;
+	ParallelHeapScanDesc inner_pscan;
+	SeqScanState *scan;
+	SeqScanState *inner;
+	char	   *queuespace;
+	shm_mq	   *mq;
+	shm_mq_handle *mqh;
+	Plan	   *plan;
+	List	   *rtable;
+	EState	   *estate;
+	PlanState  *planstate;
+	MemoryContext oldcontext;
+
+	pscan = shm_toc_lookup(toc, PARALLEL_KEY_SCAN);
+	inner_pscan = shm_toc_lookup(toc, PARALLEL_KEY_INNER_SCAN);
+	queuespace = shm_toc_lookup(toc, PARALLEL_KEY_TUPLE_QUEUE);
+
+	/* Attach to our queue first, so the master notices if we quit early. */
+	mq = (shm_mq *) (queuespace +
+					 ParallelWorkerNumber * PARALLEL_TUPLE_QUEUE_SIZE);
+	shm_mq_set_sender(mq, MyProc);
+	mqh = shm_mq_attach(mq, seg, NULL);
+
+	/*
+	 * The master holds AccessShareLock on the relations.  Rather than risk
+	 * waiting behind a conflicting request queued after it, which would be a
+	 * deadlock the lock manager can't see, leave the scan to the others.
+	 */
+	if (!ConditionalLockRelationOid(pscan->phs_relid, AccessShareLock) ||
+		(inner_pscan != NULL &&
+		 !ConditionalLockRelationOid(inner_pscan->phs_relid,
+									 AccessShareLock)))
+	{
+		shm_mq_detach(mq);
+		return;
+	}
+
+	plan = (Plan *) stringToNode(shm_toc_lookup(toc, PARALLEL_KEY_PLAN));
+	rtable = (List *) stringToNode(shm_toc_lookup(toc,
+												  PARALLEL_KEY_RANGE_TABLE));
+
+	gather_fix_opfuncids(plan);
+
+	estate = CreateExecutorState();
+	estate->es_range_table = rtable;
+	estate->es_snapshot = GetActiveSnapshot();
+	estate->es_crosscheck_snapshot = InvalidSnapshot;
+	estate->es_top_eflags = *(int *) shm_toc_lookup(toc,
+											  PARALLEL_KEY_EXECUTOR_FLAGS);
+
+	oldcontext = MemoryContextSwitchTo(estate->es_query_cxt);
+
+	planstate = ExecInitNode(plan, estate, estate->es_top_eflags);
+	if (IsA(planstate, SortState))
+	{
+		Sharedsort *sharedsort = shm_toc_lookup(toc, PARALLEL_KEY_TUPLESORT);
+
+		tuplesort_attach_shared(sharedsort, seg);
+		ExecSortInitializeShared((SortState *) planstate, sharedsort);
+	}
+	else if (IsA(planstate, HashJoinState))
+	{
+		ParallelHashJoinState *sharedhash;
+
+		sharedhash = shm_toc_lookup(toc, PARALLEL_KEY_HASHJOIN);
+		ExecHashJoinAttachShared((HashJoinState *) planstate, sharedhash,
+								 seg);
+	}
+	scan = gather_scan_state(planstate, &inner);
+	ExecSeqScanInitializeParallel(scan, pscan);
+	if (inner != NULL)
+		ExecSeqScanInitializeParallel(inner, inner_pscan);
+
+	for (;;)
+	{
+		TupleTableSlot *slot;
+		MinimalTuple tuple;
+
+		CHECK_FOR_INTERRUPTS();
+
+		slot = ExecProcNode(planstate);
+		if (TupIsNull(slot))
+			break;
+
+		tuple = ExecFetchSlotMinimalTuple(slot);
+		if (shm_mq_send(mqh, tuple->t_len, tuple, false) == SHM_MQ_DETACHED)
+			break;				/* the master needs no more tuples */
+	}
+
+	ExecEndNode(planstate);
+
+	/* release the tuple descriptors pinned by the slots, as ExecEndPlan does */
+	ExecResetTupleTable(estate->es_tupleTable, false);
+
+	MemoryContextSwitchTo(oldcontext);
+	FreeExecutorState(estate);
+
+	shm_mq_detach(mq);
+}
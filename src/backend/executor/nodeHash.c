@@ -25,6 +25,7 @@
 #include <limits.h>
 
 #include "access/htup_details.h"
+#include "access/parallel.h"
 #include "catalog/pg_statistic.h"
 #include "commands/tablespace.h"
 #include "executor/execdebug.h"
@@ -32,6 +33,7 @@
 #include "executor/nodeHash.h"
 #include "executor/nodeHashjoin.h"
 #include "miscadmin.h"
+#include "storage/proc.h"
 #include "utils/dynahash.h"
 #include "utils/memutils.h"
 #include "utils/lsyscache.h"
@@ -50,6 +52,42 @@ static void ExecHashRemoveNextSkewBucket(HashJoinTable hashtable);
 
 static void *dense_alloc(HashJoinTable hashtable, Size size);
 
+static void ExecHashTableInsertShared(HashJoinTable hashtable,
+						  MinimalTuple tuple,
+						  uint32 hashvalue,
+						  int bucketno,
+						  int batchno);
+static HashJoinTuple shared_alloc(HashJoinTable hashtable, Size size);
+static void ExecChooseSharedHashTableSize(Hash *node, int nparticipants,
+							  int *numbuckets,
+							  int *numbatches,
+							  Size *space_allowed);
+static Size ExecHashSharedSpaceOffset(int nparticipants, int nbatch);
+static void ExecHashSharedResetState(ParallelHashJoinState *pstate);
+static void ExecHashSharedWait(HashJoinTable hashtable, int generation);
+static void ExecHashSharedNextPhase(HashJoinTable hashtable);
+static void ExecHashSharedDetach(ParallelHashJoinState *pstate,
+					 int participant);
+static void ExecHashSharedWakeAll(ParallelHashJoinState *pstate);
+static void ExecHashSharedOnDetach(dsm_segment *seg, Datum arg);
+static bool *ExecHashSharedFileFlag(ParallelHashJoinState *pstate, bool inner,
+					   int batchno, int pass, int participant);
+static void ExecHashSharedFileName(char *name, bool inner,
+					   int batchno, int pass, int participant);
+static void ExecHashSharedDeleteFiles(ParallelHashJoinState *pstate,
+						  bool inner, int batchno, int pass);
+
+/* the tuple at an offset in a shared table, or NULL for offset 0 */
+#define SharedHashTuple(hashtable, offset) \
+	((offset) == 0 ? NULL : \
+	 (HashJoinTuple) ((char *) (hashtable)->parallel_state + (offset)))
+
+/* the next tuple in a bucket's list */
+#define ExecHashNextTuple(hashtable, hashTuple) \
+	((hashtable)->parallel_state != NULL ? \
+	 SharedHashTuple(hashtable, (hashTuple)->next.shared) : \
+	 (hashTuple)->next.unshared)
+
 /* ----------------------------------------------------------------
  *		ExecHash
  *
@@ -129,8 +167,22 @@ MultiExecHash(HashState *node)
 		}
 	}
 
+	if (hashtable->parallel_state != NULL)
+	{
+		ParallelHashJoinState *pstate = hashtable->parallel_state;
+
+		/*
+		 * A shared table has a fixed size, so there is nothing to resize;
+		 * just make our batch files ready for the others, and count our
+		 * tuples in for the check for an empty inner relation.
+		 */
+		ExecHashTableEndLoadShared(hashtable);
+		SpinLockAcquire(&pstate->mutex);
+		pstate->totalTuples += hashtable->totalTuples;
+		SpinLockRelease(&pstate->mutex);
+	}
 	/* resize the hash table if needed (NTUP_PER_BUCKET exceeded) */
-	if (hashtable->nbuckets != hashtable->nbuckets_optimal)
+	else if (hashtable->nbuckets != hashtable->nbuckets_optimal)
 	{
 		/* We never decrease the number of buckets. */
 		Assert(hashtable->nbuckets_optimal > hashtable->nbuckets);
@@ -144,7 +196,8 @@ MultiExecHash(HashState *node)
 	}
 
 	/* Account for the buckets in spaceUsed (reported in EXPLAIN ANALYZE) */
-	hashtable->spaceUsed += hashtable->nbuckets * sizeof(HashJoinTuple);
+	if (hashtable->parallel_state == NULL)
+		hashtable->spaceUsed += hashtable->nbuckets * sizeof(HashJoinTuple);
 	if (hashtable->spaceUsed > hashtable->spacePeak)
 		hashtable->spacePeak = hashtable->spaceUsed;
 
@@ -253,7 +306,8 @@ ExecEndHash(HashState *node)
  * ----------------------------------------------------------------
  */
 HashJoinTable
-ExecHashTableCreate(Hash *node, List *hashOperators, bool keepNulls)
+ExecHashTableCreate(Hash *node, List *hashOperators, bool keepNulls,
+					ParallelHashJoinState *pstate)
 {
 	HashJoinTable hashtable;
 	Plan	   *outerNode;
@@ -273,9 +327,17 @@ ExecHashTableCreate(Hash *node, List *hashOperators, bool keepNulls)
 	 */
 	outerNode = outerPlan(node);
 
-	ExecChooseHashTableSize(outerNode->plan_rows, outerNode->plan_width,
-							OidIsValid(node->skewTable),
-							&nbuckets, &nbatch, &num_skew_mcvs);
+	if (pstate != NULL)
+	{
+		/* a shared table was sized when its state was initialized */
+		nbuckets = pstate->nbuckets;
+		nbatch = pstate->nbatch;
+		num_skew_mcvs = 0;
+	}
+	else
+		ExecChooseHashTableSize(outerNode->plan_rows, outerNode->plan_width,
+								OidIsValid(node->skewTable), 1,
+								&nbuckets, &nbatch, &num_skew_mcvs);
 
 #ifdef HJDEBUG
 	printf("nbatch = %d, nbuckets = %d\n", nbatch, nbuckets);
@@ -320,6 +382,22 @@ ExecHashTableCreate(Hash *node, List *hashOperators, bool keepNulls)
 	hashtable->spaceAllowedSkew =
 		hashtable->spaceAllowed * SKEW_WORK_MEM_PERCENT / 100;
 	hashtable->chunks = NULL;
+	hashtable->parallel_state = pstate;
+	hashtable->shared_buckets = NULL;
+	hashtable->participant = IsParallelWorker() ? ParallelWorkerNumber + 1 : 0;
+	hashtable->attached = false;
+	hashtable->curpass = 0;
+	hashtable->saveOuter = false;
+	hashtable->sharedChunk = NULL;
+	hashtable->sharedChunkFree = 0;
+	hashtable->overflowFile = NULL;
+	hashtable->sharedReadFile = NULL;
+	if (pstate != NULL)
+	{
+		hashtable->spaceAllowed = pstate->spaceAllowed;
+		hashtable->shared_buckets = (pg_atomic_uint32 *)
+			((char *) pstate + pstate->bucketsOffset);
+	}
 
 	/*
 	 * Get info about the hash functions to be used for each hash key. Also
@@ -367,10 +445,11 @@ ExecHashTableCreate(Hash *node, List *hashOperators, bool keepNulls)
 
 	oldcxt = MemoryContextSwitchTo(hashtable->hashCxt);
 
-	if (nbatch > 1)
+	if (nbatch > 1 || pstate != NULL)
 	{
 		/*
-		 * allocate and initialize the file arrays in hashCxt
+		 * allocate and initialize the file arrays in hashCxt; a shared table
+		 * may need batch 0's too, for the outer tuples of an overflowed batch
 		 */
 		hashtable->innerBatchFile = (BufFile **)
 			palloc0(nbatch * sizeof(BufFile *));
@@ -387,14 +466,15 @@ ExecHashTableCreate(Hash *node, List *hashOperators, bool keepNulls)
 	 */
 	MemoryContextSwitchTo(hashtable->batchCxt);
 
-	hashtable->buckets = (HashJoinTuple *)
-		palloc0(nbuckets * sizeof(HashJoinTuple));
+	if (pstate == NULL)
+		hashtable->buckets = (HashJoinTuple *)
+			palloc0(nbuckets * sizeof(HashJoinTuple));
 
 	/*
 	 * Set up for skew optimization, if possible and there's a need for more
 	 * than one batch.  (In a one-batch join, there's no point in it.)
 	 */
-	if (nbatch > 1)
+	if (nbatch > 1 && pstate == NULL)
 		ExecHashBuildSkewHash(hashtable, node, num_skew_mcvs);
 
 	MemoryContextSwitchTo(oldcxt);
@@ -415,6 +495,7 @@ ExecHashTableCreate(Hash *node, List *hashOperators, bool keepNulls)
 
 void
 ExecChooseHashTableSize(double ntuples, int tupwidth, bool useskew,
+						int nparticipants,
 						int *numbuckets,
 						int *numbatches,
 						int *num_skew_mcvs)
@@ -444,9 +525,14 @@ ExecChooseHashTableSize(double ntuples, int tupwidth, bool useskew,
 	inner_rel_bytes = ntuples * tupsize;
 
 	/*
-	 * Target in-memory hashtable size is work_mem kilobytes.
+	 * Target in-memory hashtable size is work_mem kilobytes, for each of the
+	 * participants if the table is shared.  A shared table must stay small
+	 * enough for its tuples to be linked by 32-bit offsets.
 	 */
 	hash_table_bytes = work_mem * 1024L;
+	if (nparticipants > 1)
+		hash_table_bytes = (long) Min((double) hash_table_bytes * nparticipants,
+									  (double) MaxAllocSize);
 
 	/*
 	 * If skew optimization is possible, estimate the number of skew buckets
@@ -491,6 +577,8 @@ ExecChooseHashTableSize(double ntuples, int tupwidth, bool useskew,
 	 * work_mem.
 	 */
 	max_pointers = (work_mem * 1024L) / sizeof(void *);
+	if (nparticipants > 1)
+		max_pointers = hash_table_bytes / sizeof(void *);
 	/* also ensure we avoid integer overflow in nbatch and nbuckets */
 	max_pointers = Min(max_pointers, INT_MAX / 2);
 	dbuckets = ceil(ntuples / NTUP_PER_BUCKET);
@@ -558,6 +646,22 @@ ExecHashTableDestroy(HashJoinTable hashtable)
 {
 	int			i;
 
+	/*
+	 * A shared table may have batch 0's outer file and a couple of others
+	 * open, and we must let the other participants go on without us.
+	 */
+	if (hashtable->parallel_state != NULL)
+	{
+		if (hashtable->outerBatchFile[0])
+			BufFileClose(hashtable->outerBatchFile[0]);
+		if (hashtable->overflowFile)
+			BufFileClose(hashtable->overflowFile);
+		if (hashtable->sharedReadFile)
+			BufFileClose(hashtable->sharedReadFile);
+		if (hashtable->attached)
+			ExecHashTableDetachShared(hashtable);
+	}
+
 	/*
 	 * Make sure all the temp files are closed.  We skip batch 0, since it
 	 * can't have any temp files (and the arrays might not even exist if
@@ -695,7 +799,7 @@ ExecHashIncreaseNumBatches(HashJoinTable hashtable)
 				memcpy(copyTuple, hashTuple, hashTupleSize);
 
 				/* and add it back to the appropriate bucket */
-				copyTuple->next = hashtable->buckets[bucketno];
+				copyTuple->next.unshared = hashtable->buckets[bucketno];
 				hashtable->buckets[bucketno] = copyTuple;
 			}
 			else
@@ -797,7 +901,7 @@ ExecHashIncreaseNumBuckets(HashJoinTable hashtable)
 									  &bucketno, &batchno);
 
 			/* add the tuple to the proper bucket */
-			hashTuple->next = hashtable->buckets[bucketno];
+			hashTuple->next.unshared = hashtable->buckets[bucketno];
 			hashtable->buckets[bucketno] = hashTuple;
 
 			/* advance index past the tuple */
@@ -836,6 +940,13 @@ ExecHashTableInsert(HashJoinTable hashtable,
 	ExecHashGetBucketAndBatch(hashtable, hashvalue,
 							  &bucketno, &batchno);
 
+	if (hashtable->parallel_state != NULL)
+	{
+		ExecHashTableInsertShared(hashtable, tuple, hashvalue,
+								  bucketno, batchno);
+		return;
+	}
+
 	/*
 	 * decide whether to put the tuple in the hash table or a temp file
 	 */
@@ -864,7 +975,7 @@ ExecHashTableInsert(HashJoinTable hashtable,
 		HeapTupleHeaderClearMatch(HJTUPLE_MINTUPLE(hashTuple));
 
 		/* Push it onto the front of the bucket's list */
-		hashTuple->next = hashtable->buckets[bucketno];
+		hashTuple->next.unshared = hashtable->buckets[bucketno];
 		hashtable->buckets[bucketno] = hashTuple;
 
 		/*
@@ -1066,9 +1177,12 @@ ExecScanHashBucket(HashJoinState *hjstate,
 	 * otherwise scan the standard hashtable bucket.
 	 */
 	if (hashTuple != NULL)
-		hashTuple = hashTuple->next;
+		hashTuple = ExecHashNextTuple(hashtable, hashTuple);
 	else if (hjstate->hj_CurSkewBucketNo != INVALID_SKEW_BUCKET_NO)
 		hashTuple = hashtable->skewBucket[hjstate->hj_CurSkewBucketNo]->tuples;
+	else if (hashtable->parallel_state != NULL)
+		hashTuple = SharedHashTuple(hashtable,
+			pg_atomic_read_u32(&hashtable->shared_buckets[hjstate->hj_CurBucketNo]));
 	else
 		hashTuple = hashtable->buckets[hjstate->hj_CurBucketNo];
 
@@ -1094,7 +1208,7 @@ ExecScanHashBucket(HashJoinState *hjstate,
 			}
 		}
 
-		hashTuple = hashTuple->next;
+		hashTuple = ExecHashNextTuple(hashtable, hashTuple);
 	}
 
 	/*
@@ -1144,7 +1258,7 @@ ExecScanHashTableForUnmatched(HashJoinState *hjstate, ExprContext *econtext)
 		 * bucket.
 		 */
 		if (hashTuple != NULL)
-			hashTuple = hashTuple->next;
+			hashTuple = hashTuple->next.unshared;
 		else if (hjstate->hj_CurBucketNo < hashtable->nbuckets)
 		{
 			hashTuple = hashtable->buckets[hjstate->hj_CurBucketNo];
@@ -1183,7 +1297,7 @@ ExecScanHashTableForUnmatched(HashJoinState *hjstate, ExprContext *econtext)
 				return true;
 			}
 
-			hashTuple = hashTuple->next;
+			hashTuple = hashTuple->next.unshared;
 		}
 	}
 
@@ -1236,7 +1350,8 @@ ExecHashTableResetMatchFlags(HashJoinTable hashtable)
 	/* Reset all flags in the main table ... */
 	for (i = 0; i < hashtable->nbuckets; i++)
 	{
-		for (tuple = hashtable->buckets[i]; tuple != NULL; tuple = tuple->next)
+		for (tuple = hashtable->buckets[i]; tuple != NULL;
+			 tuple = tuple->next.unshared)
 			HeapTupleHeaderClearMatch(HJTUPLE_MINTUPLE(tuple));
 	}
 
@@ -1246,7 +1361,8 @@ ExecHashTableResetMatchFlags(HashJoinTable hashtable)
 		int			j = hashtable->skewBucketNums[i];
 		HashSkewBucket *skewBucket = hashtable->skewBucket[j];
 
-		for (tuple = skewBucket->tuples; tuple != NULL; tuple = tuple->next)
+		for (tuple = skewBucket->tuples; tuple != NULL;
+			 tuple = tuple->next.unshared)
 			HeapTupleHeaderClearMatch(HJTUPLE_MINTUPLE(tuple));
 	}
 }
@@ -1498,7 +1614,7 @@ ExecHashSkewTableInsert(HashJoinTable hashtable,
 	HeapTupleHeaderClearMatch(HJTUPLE_MINTUPLE(hashTuple));
 
 	/* Push it onto the front of the skew bucket's list */
-	hashTuple->next = hashtable->skewBucket[bucketNumber]->tuples;
+	hashTuple->next.unshared = hashtable->skewBucket[bucketNumber]->tuples;
 	hashtable->skewBucket[bucketNumber]->tuples = hashTuple;
 
 	/* Account for space used, and back off if we've used too much */
@@ -1547,7 +1663,7 @@ ExecHashRemoveNextSkewBucket(HashJoinTable hashtable)
 	hashTuple = bucket->tuples;
 	while (hashTuple != NULL)
 	{
-		HashJoinTuple nextHashTuple = hashTuple->next;
+		HashJoinTuple nextHashTuple = hashTuple->next.unshared;
 		MinimalTuple tuple;
 		Size		tupleSize;
 
@@ -1563,7 +1679,7 @@ ExecHashRemoveNextSkewBucket(HashJoinTable hashtable)
 		if (batchno == hashtable->curbatch)
 		{
 			/* Move the tuple to the main hash table */
-			hashTuple->next = hashtable->buckets[bucketno];
+			hashTuple->next.unshared = hashtable->buckets[bucketno];
 			hashtable->buckets[bucketno] = hashTuple;
 			/* We have reduced skew space, but overall space doesn't change */
 			hashtable->spaceUsedSkew -= tupleSize;
@@ -1691,3 +1807,779 @@ dense_alloc(HashJoinTable hashtable, Size size)
 	/* return pointer to the start of the tuple memory */
 	return ptr;
 }
+
+/*
+ * ExecHashTableInsertShared
+ *		insert a tuple into a shared hash table, or save it for later
+ *
+ * Tuples of the current batch go into the shared tuple space, unless it is
+ * full, in which case they wait in our overflow file for the next pass over
+ * the batch.  Tuples of later batches go to our own batch files.
+ */
+static void
+ExecHashTableInsertShared(HashJoinTable hashtable,
+						  MinimalTuple tuple,
+						  uint32 hashvalue,
+						  int bucketno,
+						  int batchno)
+{
+	ParallelHashJoinState *pstate = hashtable->parallel_state;
+
+	if (batchno == hashtable->curbatch)
+	{
+		pg_atomic_uint32 *bucket = &hashtable->shared_buckets[bucketno];
+		HashJoinTuple hashTuple;
+		Size		hashTupleSize;
+		uint32		offset;
+		uint32		head;
+
+		hashTupleSize = HJTUPLE_OVERHEAD + tuple->t_len;
+		hashTuple = shared_alloc(hashtable, hashTupleSize);
+		if (hashTuple == NULL)
+		{
+			if (hashtable->overflowFile == NULL)
+				hashtable->overflowFile =
+					ExecHashTableCreateSharedFile(hashtable, true, batchno,
+												  hashtable->curpass + 1);
+			ExecHashJoinSaveTuple(tuple, hashvalue, &hashtable->overflowFile);
+			return;
+		}
+
+		hashTuple->hashvalue = hashvalue;
+		memcpy(HJTUPLE_MINTUPLE(hashTuple), tuple, tuple->t_len);
+		HeapTupleHeaderClearMatch(HJTUPLE_MINTUPLE(hashTuple));
+
+		/* Push it onto the front of the bucket's list */
+		offset = (uint32) ((char *) hashTuple - (char *) pstate);
+		head = pg_atomic_read_u32(bucket);
+		do
+		{
+			hashTuple->next.shared = head;
+		} while (!pg_atomic_compare_exchange_u32(bucket, &head, offset));
+
+		/* Account for our share of the space, for EXPLAIN ANALYZE */
+		hashtable->spaceUsed += hashTupleSize;
+		if (hashtable->spaceUsed > hashtable->spacePeak)
+			hashtable->spacePeak = hashtable->spaceUsed;
+	}
+	else
+	{
+		/*
+		 * put the tuple into one of our batch files; the number of batches
+		 * never changes, so this happens only while loading batch 0
+		 */
+		Assert(batchno > hashtable->curbatch);
+		if (hashtable->innerBatchFile[batchno] == NULL)
+			hashtable->innerBatchFile[batchno] =
+				ExecHashTableCreateSharedFile(hashtable, true, batchno, 0);
+		ExecHashJoinSaveTuple(tuple, hashvalue,
+							  &hashtable->innerBatchFile[batchno]);
+	}
+}
+
+/*
+ * Allocate 'size' bytes from the tuple space of a shared hash table
+ *
+ * As in dense_alloc, small tuples are packed into chunks, which here are
+ * pieces of the shared space that we claim for ourselves, so that we take
+ * the lock only once per chunk.  Returns NULL, and notes that the current
+ * pass overflowed, if the space is used up.
+ */
+static HashJoinTuple
+shared_alloc(HashJoinTable hashtable, Size size)
+{
+	ParallelHashJoinState *pstate = hashtable->parallel_state;
+	char	   *ptr = NULL;
+	Size		want;
+
+	/* just in case the size is not already aligned properly */
+	size = MAXALIGN(size);
+
+	/* There is enough space in our current chunk, let's add the tuple */
+	if (size <= hashtable->sharedChunkFree)
+	{
+		ptr = hashtable->sharedChunk;
+		hashtable->sharedChunk += size;
+		hashtable->sharedChunkFree -= size;
+		return (HashJoinTuple) ptr;
+	}
+
+	/* A tuple that doesn't fit at all would overflow every pass */
+	if (size > pstate->spaceAllowed)
+		ereport(ERROR,
+				(errcode(ERRCODE_PROGRAM_LIMIT_EXCEEDED),
+				 errmsg("hash table row is too big: size %zu, maximum size %zu",
+						size, pstate->spaceAllowed),
+				 errhint("Consider increasing the configuration parameter \"work_mem\".")));
+
+	/*
+	 * Claim a fresh chunk, or exactly enough for a tuple larger than 1/4 of
+	 * the chunk size.  Near the end of the space, take whatever is left.
+	 */
+	want = (size > HASH_CHUNK_THRESHOLD) ? size : HASH_CHUNK_SIZE;
+	SpinLockAcquire(&pstate->mutex);
+	if (pstate->spaceUsed + want > pstate->spaceAllowed)
+		want = pstate->spaceAllowed - pstate->spaceUsed;
+	if (want >= size)
+	{
+		ptr = (char *) pstate + pstate->spaceOffset + pstate->spaceUsed;
+		pstate->spaceUsed += want;
+	}
+	else
+		pstate->overflow = true;
+	SpinLockRelease(&pstate->mutex);
+
+	/* We'll fill the rest of a new chunk ourselves */
+	if (ptr != NULL && size <= HASH_CHUNK_THRESHOLD)
+	{
+		hashtable->sharedChunk = ptr + size;
+		hashtable->sharedChunkFree = want - size;
+	}
+
+	return (HashJoinTuple) ptr;
+}
+
+/*
+ * ExecChooseSharedHashTableSize
+ *		size a hash table shared by nparticipants processes
+ *
+ * The buckets and batches are chosen as for a private table, but with
+ * work_mem for each participant.  The tuple space gets the rest of that
+ * memory, but we don't reserve more than twice the expected size of a batch
+ * (or work_mem, if that's more), since an estimate that turns out to be too
+ * low costs only extra passes over a batch.
+ */
+static void
+ExecChooseSharedHashTableSize(Hash *node, int nparticipants,
+							  int *numbuckets,
+							  int *numbatches,
+							  Size *space_allowed)
+{
+	Plan	   *outerNode = outerPlan(node);
+	double		ntuples = outerNode->plan_rows;
+	double		batch_bytes;
+	double		space_bytes;
+	int			num_skew_mcvs;
+
+	ExecChooseHashTableSize(ntuples, outerNode->plan_width, false,
+							nparticipants,
+							numbuckets, numbatches, &num_skew_mcvs);
+
+	/* Force a plausible relation size if no info, as above */
+	if (ntuples <= 0.0)
+		ntuples = 1000.0;
+	batch_bytes = ntuples * (HJTUPLE_OVERHEAD +
+							 MAXALIGN(sizeof(MinimalTupleData)) +
+							 MAXALIGN(outerNode->plan_width)) / *numbatches;
+
+	space_bytes = Min((double) work_mem * 1024L * nparticipants,
+					  (double) MaxAllocSize);
+	space_bytes -= (double) *numbuckets * sizeof(pg_atomic_uint32);
+	space_bytes = Min(space_bytes, Max(2 * batch_bytes, work_mem * 1024.0));
+
+	*space_allowed = MAXALIGN_DOWN((Size) space_bytes);
+}
+
+/*
+ * Return the offset of a shared hash table's tuple space from the start of
+ * its ParallelHashJoinState, which is followed by the participants and by
+ * the flags recording who wrote which batch files.
+ */
+static Size
+ExecHashSharedSpaceOffset(int nparticipants, int nbatch)
+{
+	Size		size;
+
+	size = MAXALIGN(add_size(offsetof(ParallelHashJoinState, participants),
+							 mul_size(nparticipants,
+									  sizeof(ParallelHashJoinParticipant))));
+	size = add_size(size,
+					MAXALIGN(mul_size(mul_size(2, nbatch + 1),
+									  mul_size(nparticipants, sizeof(bool)))));
+
+	return size;
+}
+
+/*
+ * ExecHashTableEstimateShared
+ *		estimate the dynamic shared memory needed for a shared hash table
+ */
+Size
+ExecHashTableEstimateShared(Hash *node, int nparticipants)
+{
+	int			nbuckets;
+	int			nbatch;
+	Size		space_allowed;
+	Size		size;
+
+	ExecChooseSharedHashTableSize(node, nparticipants,
+								  &nbuckets, &nbatch, &space_allowed);
+
+	size = add_size(ExecHashSharedSpaceOffset(nparticipants, nbatch),
+					space_allowed);
+	size = add_size(size, mul_size(nbuckets, sizeof(pg_atomic_uint32)));
+
+	return size;
+}
+
+/*
+ * ExecHashTableInitializeShared
+ *		set up a shared hash table in the space estimated above
+ *
+ * The files of the table belong to 'seg', and are deleted when the last
+ * process detaches from it.
+ */
+void
+ExecHashTableInitializeShared(ParallelHashJoinState *pstate, Hash *node,
+							  int nparticipants, dsm_segment *seg)
+{
+	pg_atomic_uint32 *buckets;
+	int			nbuckets;
+	int			nbatch;
+	Size		space_allowed;
+	int			i;
+
+	ExecChooseSharedHashTableSize(node, nparticipants,
+								  &nbuckets, &nbatch, &space_allowed);
+
+	SpinLockInit(&pstate->mutex);
+	pstate->nparticipants = nparticipants;
+	pstate->nbuckets = nbuckets;
+	pstate->log2_nbuckets = my_log2(nbuckets);
+	pstate->nbatch = nbatch;
+	pstate->spaceAllowed = space_allowed;
+	pstate->spaceOffset = ExecHashSharedSpaceOffset(nparticipants, nbatch);
+	pstate->bucketsOffset = pstate->spaceOffset + space_allowed;
+
+	/* tuples are linked by 32-bit offsets */
+	if (pstate->bucketsOffset > (Size) UINT_MAX)
+		ereport(ERROR,
+				(errcode(ERRCODE_PROGRAM_LIMIT_EXCEEDED),
+				 errmsg("shared hash table is too large")));
+
+	buckets = (pg_atomic_uint32 *) ((char *) pstate + pstate->bucketsOffset);
+	for (i = 0; i < nbuckets; i++)
+		pg_atomic_init_u32(&buckets[i], 0);
+
+	SharedFileSetInit(&pstate->fileset, seg);
+	ExecHashSharedResetState(pstate);
+
+	on_dsm_detach(seg, ExecHashSharedOnDetach, PointerGetDatum(pstate));
+}
+
+/*
+ * ExecHashTableAttachSharedSegment
+ *		let a worker use a shared hash table set up by the master
+ */
+void
+ExecHashTableAttachSharedSegment(ParallelHashJoinState *pstate,
+								 dsm_segment *seg)
+{
+	SharedFileSetAttach(&pstate->fileset, seg);
+	on_dsm_detach(seg, ExecHashSharedOnDetach, PointerGetDatum(pstate));
+}
+
+/*
+ * ExecHashTableReInitializeShared
+ *		reset a shared hash table for a rescan
+ *
+ * The workers of the previous scan must be gone, and the master detached.
+ */
+void
+ExecHashTableReInitializeShared(ParallelHashJoinState *pstate)
+{
+	SharedFileSetDeleteAll(&pstate->fileset);
+	ExecHashSharedResetState(pstate);
+}
+
+/*
+ * Put a shared hash table back the way it is at the start of the join.
+ */
+static void
+ExecHashSharedResetState(ParallelHashJoinState *pstate)
+{
+	pg_atomic_uint32 *buckets;
+	int			i;
+
+	pstate->generation = 0;
+	pstate->phase = PHJ_LOAD;
+	pstate->curbatch = 0;
+	pstate->curpass = 0;
+	pstate->nattached = 0;
+	pstate->narrived = 0;
+	pstate->electing = false;
+	pstate->elector = -1;
+	pstate->closed = false;
+	pstate->overflow = false;
+	pstate->nextfile = 0;
+	pstate->totalTuples = 0;
+	pstate->spaceUsed = 0;
+
+	for (i = 0; i < pstate->nparticipants; i++)
+	{
+		pstate->participants[i].proc = NULL;
+		pstate->participants[i].arrived = false;
+	}
+	memset(ExecHashSharedFileFlag(pstate, true, 0, 0, 0), 0,
+		   2 * (pstate->nbatch + 1) * pstate->nparticipants * sizeof(bool));
+
+	buckets = (pg_atomic_uint32 *) ((char *) pstate + pstate->bucketsOffset);
+	for (i = 0; i < pstate->nbuckets; i++)
+		pg_atomic_write_u32(&buckets[i], 0);
+}
+
+/*
+ * ExecHashTableAttachShared
+ *		start taking part in a shared hash join
+ *
+ * Returns false if the join is over, or closed to latecomers.  Otherwise we
+ * join in whatever phase the shared state shows, after waiting for the
+ * others to finish moving on to it if they are just doing so.
+ */
+bool
+ExecHashTableAttachShared(HashJoinTable hashtable)
+{
+	ParallelHashJoinState *pstate = hashtable->parallel_state;
+	ParallelHashJoinParticipant *me;
+	int			generation;
+	bool		wait;
+
+	Assert(!hashtable->attached);
+	Assert(hashtable->participant < pstate->nparticipants);
+	me = &pstate->participants[hashtable->participant];
+
+	SpinLockAcquire(&pstate->mutex);
+	if (pstate->closed || pstate->phase == PHJ_DONE)
+	{
+		SpinLockRelease(&pstate->mutex);
+		return false;
+	}
+	pstate->nattached++;
+	me->proc = MyProc;
+	generation = pstate->generation;
+	wait = pstate->electing;
+	if (wait)
+	{
+		/* the phase is over, as far as we're concerned */
+		me->arrived = true;
+		pstate->narrived++;
+	}
+	SpinLockRelease(&pstate->mutex);
+
+	hashtable->attached = true;
+
+	if (wait)
+		ExecHashSharedWait(hashtable, generation);
+
+	return true;
+}
+
+/*
+ * ExecHashTableDetachShared
+ *		stop taking part in a shared hash join
+ */
+void
+ExecHashTableDetachShared(HashJoinTable hashtable)
+{
+	Assert(hashtable->attached);
+
+	ExecHashSharedDetach(hashtable->parallel_state, hashtable->participant);
+	hashtable->attached = false;
+}
+
+/*
+ * ExecHashTableHandOffShared
+ *		leave the rest of a shared hash join to the other participants
+ *
+ * If anybody else is attached, detaches and returns true.  Otherwise closes
+ * the join to latecomers, so that we can finish it alone, and returns false.
+ */
+bool
+ExecHashTableHandOffShared(HashJoinTable hashtable)
+{
+	ParallelHashJoinState *pstate = hashtable->parallel_state;
+	bool		alone;
+
+	SpinLockAcquire(&pstate->mutex);
+	alone = (pstate->nattached == 1);
+	if (alone)
+		pstate->closed = true;
+	SpinLockRelease(&pstate->mutex);
+
+	if (alone)
+		return false;
+
+	ExecHashTableDetachShared(hashtable);
+	return true;
+}
+
+/*
+ * ExecHashTableArriveShared
+ *		report that we are done with the current phase of a shared hash join
+ *
+ * Returns once all the participants are, and one of them has moved the
+ * join on to its next phase.
+ */
+void
+ExecHashTableArriveShared(HashJoinTable hashtable)
+{
+	ParallelHashJoinState *pstate = hashtable->parallel_state;
+	int			generation;
+	bool		elected = false;
+
+	Assert(hashtable->attached);
+
+	SpinLockAcquire(&pstate->mutex);
+	Assert(!pstate->electing);
+	pstate->participants[hashtable->participant].arrived = true;
+	generation = pstate->generation;
+	if (++pstate->narrived == pstate->nattached)
+	{
+		pstate->electing = true;
+		pstate->elector = hashtable->participant;
+		elected = true;
+	}
+	SpinLockRelease(&pstate->mutex);
+
+	if (elected)
+		ExecHashSharedNextPhase(hashtable);
+	else
+		ExecHashSharedWait(hashtable, generation);
+}
+
+/*
+ * Wait on our latch for the join to move on from the phase 'generation'.
+ * If the participant that should have moved it on has left instead, do it
+ * ourselves.
+ */
+static void
+ExecHashSharedWait(HashJoinTable hashtable, int generation)
+{
+	ParallelHashJoinState *pstate = hashtable->parallel_state;
+
+	for (;;)
+	{
+		bool		done;
+		bool		elected = false;
+
+		SpinLockAcquire(&pstate->mutex);
+		done = (pstate->generation != generation);
+		if (!done && !pstate->electing &&
+			pstate->narrived == pstate->nattached)
+		{
+			pstate->electing = true;
+			pstate->elector = hashtable->participant;
+			elected = true;
+		}
+		SpinLockRelease(&pstate->mutex);
+
+		if (elected)
+		{
+			ExecHashSharedNextPhase(hashtable);
+			return;
+		}
+		if (done)
+			return;
+
+		WaitLatch(MyLatch, WL_LATCH_SET, 0);
+		ResetLatch(MyLatch);
+		CHECK_FOR_INTERRUPTS();
+	}
+}
+
+/*
+ * Move a shared hash join on to its next phase, once everybody is done with
+ * the current one.  Only the participant elected to do so calls this, so it
+ * may also remove the files that nobody needs any more.
+ */
+static void
+ExecHashSharedNextPhase(HashJoinTable hashtable)
+{
+	ParallelHashJoinState *pstate = hashtable->parallel_state;
+	int			phase = pstate->phase;
+	int			batchno = pstate->curbatch;
+	int			pass = pstate->curpass;
+	int			i;
+
+	if (phase == PHJ_LOAD)
+		phase = PHJ_PROBE;
+	else
+	{
+		Assert(phase == PHJ_PROBE);
+		phase = PHJ_LOAD;
+
+		/* the overflow files this pass was loaded from are used up */
+		if (pass > 0)
+			ExecHashSharedDeleteFiles(pstate, true, batchno, pass);
+
+		if (pstate->overflow)
+		{
+			/* go over the batch again, for the tuples that didn't fit */
+			pass++;
+		}
+		else
+		{
+			ExecHashSharedDeleteFiles(pstate, true, batchno, 0);
+			ExecHashSharedDeleteFiles(pstate, false, batchno, 0);
+
+			/*
+			 * Find the next batch with any inner tuples.  The outer tuples
+			 * of the others can't match anything in an inner join.
+			 */
+			pass = 0;
+			for (batchno++; batchno < pstate->nbatch; batchno++)
+			{
+				for (i = 0; i < pstate->nparticipants; i++)
+				{
+					if (*ExecHashSharedFileFlag(pstate, true, batchno, 0, i))
+						break;
+				}
+				if (i < pstate->nparticipants)
+					break;
+				ExecHashSharedDeleteFiles(pstate, false, batchno, 0);
+			}
+			if (batchno >= pstate->nbatch)
+				phase = PHJ_DONE;
+		}
+
+		/* empty the table for the next load */
+		if (phase == PHJ_LOAD)
+		{
+			for (i = 0; i < pstate->nbuckets; i++)
+				pg_atomic_write_u32(&hashtable->shared_buckets[i], 0);
+		}
+	}
+
+	SpinLockAcquire(&pstate->mutex);
+	pstate->phase = phase;
+	pstate->curbatch = batchno;
+	pstate->curpass = pass;
+	if (phase == PHJ_LOAD)
+	{
+		pstate->overflow = false;
+		pstate->spaceUsed = 0;
+	}
+	pstate->nextfile = 0;
+	pstate->generation++;
+	pstate->narrived = 0;
+	pstate->electing = false;
+	for (i = 0; i < pstate->nparticipants; i++)
+		pstate->participants[i].arrived = false;
+	SpinLockRelease(&pstate->mutex);
+
+	ExecHashSharedWakeAll(pstate);
+}
+
+/*
+ * Detach a participant from a shared hash join.  The others may have been
+ * waiting just for it, so wake them up.
+ */
+static void
+ExecHashSharedDetach(ParallelHashJoinState *pstate, int participant)
+{
+	ParallelHashJoinParticipant *p = &pstate->participants[participant];
+
+	SpinLockAcquire(&pstate->mutex);
+	Assert(p->proc != NULL);
+	pstate->nattached--;
+	if (p->arrived)
+		pstate->narrived--;
+	p->proc = NULL;
+	p->arrived = false;
+	if (pstate->electing && pstate->elector == participant)
+		pstate->electing = false;
+	SpinLockRelease(&pstate->mutex);
+
+	ExecHashSharedWakeAll(pstate);
+}
+
+/*
+ * Set the latches of all the participants attached to a shared hash join.
+ */
+static void
+ExecHashSharedWakeAll(ParallelHashJoinState *pstate)
+{
+	int			i;
+
+	for (i = 0; i < pstate->nparticipants; i++)
+	{
+		PGPROC	   *proc = pstate->participants[i].proc;
+
+		if (proc != NULL && proc != MyProc)
+			SetLatch(&proc->procLatch);
+	}
+}
+
+/*
+ * Callback to detach a process that goes away while still attached to a
+ * shared hash join, say because of an error, lest the others wait for it
+ * forever.
+ */
+static void
+ExecHashSharedOnDetach(dsm_segment *seg, Datum arg)
+{
+	ParallelHashJoinState *pstate;
+	int			i;
+
+	pstate = (ParallelHashJoinState *) DatumGetPointer(arg);
+	for (i = 0; i < pstate->nparticipants; i++)
+	{
+		if (pstate->participants[i].proc == MyProc)
+			ExecHashSharedDetach(pstate, i);
+	}
+}
+
+/*
+ * ExecHashTableEndLoadShared
+ *		finish loading our share of the current pass into a shared table
+ *
+ * Closes the files we wrote, so that the others can read them later.
+ */
+void
+ExecHashTableEndLoadShared(HashJoinTable hashtable)
+{
+	int			i;
+
+	for (i = 1; i < hashtable->nbatch; i++)
+	{
+		if (hashtable->innerBatchFile[i])
+		{
+			BufFileClose(hashtable->innerBatchFile[i]);
+			hashtable->innerBatchFile[i] = NULL;
+		}
+	}
+	if (hashtable->overflowFile)
+	{
+		BufFileClose(hashtable->overflowFile);
+		hashtable->overflowFile = NULL;
+	}
+
+	/* the rest of our chunk is lost, but a new pass starts afresh anyway */
+	hashtable->sharedChunk = NULL;
+	hashtable->sharedChunkFree = 0;
+}
+
+/*
+ * ExecHashTableCreateSharedFile
+ *		create one of our batch files of a shared hash join
+ *
+ * Outer batch files have only pass 0, and inner ones of later passes hold
+ * the tuples that overflowed the pass before.
+ */
+BufFile *
+ExecHashTableCreateSharedFile(HashJoinTable hashtable, bool inner,
+							  int batchno, int pass)
+{
+	ParallelHashJoinState *pstate = hashtable->parallel_state;
+	char		name[MAXPGPATH];
+	BufFile    *file;
+
+	ExecHashSharedFileName(name, inner, batchno, pass,
+						   hashtable->participant);
+	file = BufFileCreateShared(&pstate->fileset, name);
+	*ExecHashSharedFileFlag(pstate, inner, batchno, pass,
+							hashtable->participant) = true;
+
+	return file;
+}
+
+/*
+ * ExecHashTableOpenNextSharedFile
+ *		claim another file of the current batch and pass for us to read
+ *
+ * Each file, whoever wrote it, goes to only one of the participants.
+ * Returns NULL when there are no more.
+ */
+BufFile *
+ExecHashTableOpenNextSharedFile(HashJoinTable hashtable, bool inner)
+{
+	ParallelHashJoinState *pstate = hashtable->parallel_state;
+	int			batchno = hashtable->curbatch;
+	int			pass = inner ? hashtable->curpass : 0;
+
+	for (;;)
+	{
+		char		name[MAXPGPATH];
+		int			participant;
+
+		SpinLockAcquire(&pstate->mutex);
+		participant = pstate->nextfile++;
+		SpinLockRelease(&pstate->mutex);
+
+		if (participant >= pstate->nparticipants)
+			return NULL;
+
+		if (*ExecHashSharedFileFlag(pstate, inner, batchno, pass, participant))
+		{
+			ExecHashSharedFileName(name, inner, batchno, pass, participant);
+			return BufFileOpenShared(&pstate->fileset, name);
+		}
+	}
+}
+
+/*
+ * Return the flag that says whether a participant created a batch file.
+ * They follow the participants: inner files of pass 0 by batch, then outer
+ * files by batch, then overflow files by the parity of their pass, since
+ * those of only two passes can exist at once.
+ */
+static bool *
+ExecHashSharedFileFlag(ParallelHashJoinState *pstate, bool inner,
+					   int batchno, int pass, int participant)
+{
+	bool	   *flags;
+	int			slot;
+
+	flags = (bool *) ((char *) pstate +
+					  MAXALIGN(offsetof(ParallelHashJoinState, participants) +
+							   pstate->nparticipants *
+							   sizeof(ParallelHashJoinParticipant)));
+
+	if (!inner)
+	{
+		Assert(pass == 0);
+		slot = pstate->nbatch + batchno;
+	}
+	else if (pass == 0)
+		slot = batchno;
+	else
+		slot = 2 * pstate->nbatch + pass % 2;
+
+	return &flags[slot * pstate->nparticipants + participant];
+}
+
+/*
+ * Build the name of a batch file within the shared file set.
+ */
+static void
+ExecHashSharedFileName(char *name, bool inner, int batchno, int pass,
+					   int participant)
+{
+	snprintf(name, MAXPGPATH, "%c%d.%d.%d",
+			 inner ? 'i' : 'o', batchno, pass, participant);
+}
+
+/*
+ * Delete the batch files of all the participants for one batch and pass.
+ */
+static void
+ExecHashSharedDeleteFiles(ParallelHashJoinState *pstate, bool inner,
+						  int batchno, int pass)
+{
+	int			i;
+
+	for (i = 0; i < pstate->nparticipants; i++)
+	{
+		bool	   *flag = ExecHashSharedFileFlag(pstate, inner, batchno,
+												  pass, i);
+
+		if (*flag)
+		{
+			char		name[MAXPGPATH];
+
+			ExecHashSharedFileName(name, inner, batchno, pass, i);
+			BufFileDeleteShared(&pstate->fileset, name);
+			*flag = false;
+		}
+	}
+}
@@ -16,6 +16,7 @@
 #include "postgres.h"
 
 #include "access/htup_details.h"
+#include "access/parallel.h"
 #include "executor/executor.h"
 #include "executor/hashjoin.h"
 #include "executor/nodeHash.h"
@@ -47,6 +48,9 @@ static TupleTableSlot *ExecHashJoinGetSavedTuple(HashJoinState *hjstate,
 						  uint32 *hashvalue,
 						  TupleTableSlot *tupleSlot);
 static bool ExecHashJoinNewBatch(HashJoinState *hjstate);
+static bool ExecParallelHashJoinSync(HashJoinState *hjstate);
+static void ExecParallelHashJoinLoad(HashJoinState *hjstate);
+static bool ExecParallelHashJoinNewBatch(HashJoinState *hjstate);
 
 
 /* ----------------------------------------------------------------
@@ -119,6 +123,27 @@ ExecHashJoin(HashJoinState *node)
 				 */
 				Assert(hashtable == NULL);
 
+				/*
+				 * A shared hash table is built by all the participants
+				 * together, so join in with whatever they are doing.
+				 */
+				if (node->hj_Shared != NULL)
+				{
+					hashtable = ExecHashTableCreate((Hash *) hashNode->ps.plan,
+													node->hj_HashOperators,
+													false,
+													node->hj_Shared);
+					node->hj_HashTable = hashtable;
+					hashNode->hashtable = hashtable;
+
+					node->hj_JoinState = HJ_NEED_NEW_BATCH;
+					if (!ExecHashTableAttachShared(hashtable) ||
+						!ExecParallelHashJoinSync(node))
+						return NULL;
+					node->hj_JoinState = HJ_NEED_NEW_OUTER;
+					continue;
+				}
+
 				/*
 				 * If the outer relation is completely empty, and it's not
 				 * right/full join, we can quit without building the hash
@@ -168,7 +193,8 @@ ExecHashJoin(HashJoinState *node)
 				 */
 				hashtable = ExecHashTableCreate((Hash *) hashNode->ps.plan,
 												node->hj_HashOperators,
-												HJ_FILL_INNER(node));
+												HJ_FILL_INNER(node),
+												NULL);
 				node->hj_HashTable = hashtable;
 
 				/*
@@ -250,6 +276,11 @@ ExecHashJoin(HashJoinState *node)
 					 * Save it in the corresponding outer-batch file.
 					 */
 					Assert(batchno > hashtable->curbatch);
+					if (hashtable->parallel_state != NULL &&
+						hashtable->outerBatchFile[batchno] == NULL)
+						hashtable->outerBatchFile[batchno] =
+							ExecHashTableCreateSharedFile(hashtable, false,
+														  batchno, 0);
 					ExecHashJoinSaveTuple(ExecFetchSlotMinimalTuple(outerTupleSlot),
 										  hashvalue,
 										&hashtable->outerBatchFile[batchno]);
@@ -257,6 +288,21 @@ ExecHashJoin(HashJoinState *node)
 					continue;
 				}
 
+				/*
+				 * If not all of a shared batch 0 fitted, it will be probed
+				 * again from a file for the rest, so save the tuple there.
+				 */
+				if (hashtable->saveOuter)
+				{
+					if (hashtable->outerBatchFile[0] == NULL)
+						hashtable->outerBatchFile[0] =
+							ExecHashTableCreateSharedFile(hashtable, false,
+														  0, 0);
+					ExecHashJoinSaveTuple(ExecFetchSlotMinimalTuple(outerTupleSlot),
+										  hashvalue,
+										  &hashtable->outerBatchFile[0]);
+				}
+
 				/* OK, let's scan the bucket for matches */
 				node->hj_JoinState = HJ_SCAN_BUCKET;
 
@@ -296,7 +342,9 @@ ExecHashJoin(HashJoinState *node)
 				if (joinqual == NIL || ExecQual(joinqual, econtext, false))
 				{
 					node->hj_MatchedOuter = true;
-					HeapTupleHeaderSetMatch(HJTUPLE_MINTUPLE(node->hj_CurTuple));
+					/* a shared table is only used for inner joins */
+					if (hashtable->parallel_state == NULL)
+						HeapTupleHeaderSetMatch(HJTUPLE_MINTUPLE(node->hj_CurTuple));
 
 					/* In an antijoin, we never return a matched tuple */
 					if (node->js.jointype == JOIN_ANTI)
@@ -552,6 +600,7 @@ ExecInitHashJoin(HashJoin *node, EState *estate, int eflags)
 	 * initialize hash-specific info
 	 */
 	hjstate->hj_HashTable = NULL;
+	hjstate->hj_Shared = NULL;
 	hjstate->hj_FirstOuterTupleSlot = NULL;
 
 	hjstate->hj_CurHashValue = 0;
@@ -652,7 +701,7 @@ ExecHashJoinOuterGetTuple(PlanState *outerNode,
 	int			curbatch = hashtable->curbatch;
 	TupleTableSlot *slot;
 
-	if (curbatch == 0)			/* if it is the first pass */
+	if (curbatch == 0 && hashtable->curpass == 0)	/* if it is the first pass */
 	{
 		/*
 		 * Check to see if first outer tuple was already fetched by
@@ -691,6 +740,33 @@ ExecHashJoinOuterGetTuple(PlanState *outerNode,
 			slot = ExecProcNode(outerNode);
 		}
 	}
+	else if (hashtable->parallel_state != NULL)
+	{
+		/*
+		 * Read the outer batch files of all the participants, claiming one
+		 * at a time in turn with the others.
+		 */
+		for (;;)
+		{
+			if (hashtable->sharedReadFile == NULL)
+			{
+				hashtable->sharedReadFile =
+					ExecHashTableOpenNextSharedFile(hashtable, false);
+				if (hashtable->sharedReadFile == NULL)
+					break;
+			}
+
+			slot = ExecHashJoinGetSavedTuple(hjstate,
+											 hashtable->sharedReadFile,
+											 hashvalue,
+											 hjstate->hj_OuterTupleSlot);
+			if (!TupIsNull(slot))
+				return slot;
+
+			BufFileClose(hashtable->sharedReadFile);
+			hashtable->sharedReadFile = NULL;
+		}
+	}
 	else if (curbatch < hashtable->nbatch)
 	{
 		BufFile    *file = hashtable->outerBatchFile[curbatch];
@@ -730,6 +806,9 @@ ExecHashJoinNewBatch(HashJoinState *hjstate)
 	TupleTableSlot *slot;
 	uint32		hashvalue;
 
+	if (hashtable->parallel_state != NULL)
+		return ExecParallelHashJoinNewBatch(hjstate);
+
 	nbatch = hashtable->nbatch;
 	curbatch = hashtable->curbatch;
 
@@ -856,6 +935,135 @@ ExecHashJoinNewBatch(HashJoinState *hjstate)
 	return true;
 }
 
+/*
+ * ExecParallelHashJoinNewBatch
+ *		finish probing a batch of a shared hash join, and find more work
+ *
+ * Returns true if there's another batch for us to probe, false if we are
+ * done with the join.
+ */
+static bool
+ExecParallelHashJoinNewBatch(HashJoinState *hjstate)
+{
+	HashJoinTable hashtable = hjstate->hj_HashTable;
+	int			i;
+
+	/* we may have left the join already */
+	if (!hashtable->attached)
+		return false;
+
+	/* the others will read the outer batch files we wrote, if any */
+	for (i = 0; i < hashtable->nbatch; i++)
+	{
+		if (hashtable->outerBatchFile[i])
+		{
+			BufFileClose(hashtable->outerBatchFile[i]);
+			hashtable->outerBatchFile[i] = NULL;
+		}
+	}
+	hashtable->saveOuter = false;
+
+	/*
+	 * The master mustn't wait for the workers to finish probing, since they
+	 * may be waiting for it to read their tuples; see hashjoin.h.
+	 */
+	if (!IsParallelWorker() && ExecHashTableHandOffShared(hashtable))
+		return false;
+
+	ExecHashTableArriveShared(hashtable);
+
+	return ExecParallelHashJoinSync(hjstate);
+}
+
+/*
+ * ExecParallelHashJoinSync
+ *		take part in a shared hash join until there's a batch to probe
+ *
+ * Helps the other participants with each batch they load, and returns true
+ * once they move on to probing one, or false, having detached, when the
+ * join is over.
+ */
+static bool
+ExecParallelHashJoinSync(HashJoinState *hjstate)
+{
+	HashJoinTable hashtable = hjstate->hj_HashTable;
+	ParallelHashJoinState *pstate = hashtable->parallel_state;
+
+	for (;;)
+	{
+		/* nothing changes until all of us, attached, are done with it */
+		hashtable->curbatch = pstate->curbatch;
+		hashtable->curpass = pstate->curpass;
+
+		switch (pstate->phase)
+		{
+			case PHJ_LOAD:
+				ExecParallelHashJoinLoad(hjstate);
+				ExecHashTableArriveShared(hashtable);
+				break;
+
+			case PHJ_PROBE:
+
+				/*
+				 * If the inner relation is completely empty, nobody has
+				 * anything to probe.  Otherwise, if batch 0 didn't all fit,
+				 * we'll need its outer tuples again.
+				 */
+				if (pstate->totalTuples == 0)
+				{
+					ExecHashTableArriveShared(hashtable);
+					break;
+				}
+				hashtable->saveOuter = (hashtable->curbatch == 0 &&
+										hashtable->curpass == 0 &&
+										pstate->overflow);
+				return true;
+
+			case PHJ_DONE:
+				ExecHashTableDetachShared(hashtable);
+				return false;
+
+			default:
+				elog(ERROR, "unrecognized shared hashjoin phase: %d",
+					 pstate->phase);
+		}
+	}
+}
+
+/*
+ * ExecParallelHashJoinLoad
+ *		load our share of the current batch into a shared hash table
+ *
+ * The first pass reads the inner relation itself; later ones read whole
+ * batch files, written by any of the participants.
+ */
+static void
+ExecParallelHashJoinLoad(HashJoinState *hjstate)
+{
+	HashJoinTable hashtable = hjstate->hj_HashTable;
+	BufFile    *file;
+	TupleTableSlot *slot;
+	uint32		hashvalue;
+
+	if (hashtable->curbatch == 0 && hashtable->curpass == 0)
+	{
+		(void) MultiExecProcNode(innerPlanState(hjstate));
+		return;
+	}
+
+	while ((file = ExecHashTableOpenNextSharedFile(hashtable, true)) != NULL)
+	{
+		while ((slot = ExecHashJoinGetSavedTuple(hjstate,
+												 file,
+												 &hashvalue,
+												 hjstate->hj_HashTupleSlot)))
+			ExecHashTableInsert(hashtable, slot, hashvalue);
+		BufFileClose(file);
+	}
+
+	ExecHashTableEndLoadShared(hashtable);
+}
+
 /*
  * ExecHashJoinSaveTuple
  *		save a tuple to a batch file.
@@ -953,6 +1161,7 @@ ExecReScanHashJoin(HashJoinState *node)
 	if (node->hj_HashTable != NULL)
 	{
 		if (node->hj_HashTable->nbatch == 1 &&
+			node->hj_Shared == NULL &&
 			node->js.ps.righttree->chgParam == NULL)
 		{
 			/*
@@ -1011,3 +1220,67 @@ ExecReScanHashJoin(HashJoinState *node)
 	if (node->js.ps.lefttree->chgParam == NULL)
 		ExecReScan(node->js.ps.lefttree);
 }
+
+/* ----------------------------------------------------------------
+ *		ExecHashJoinEstimateShared
+ *
+ *		Estimate the dynamic shared memory needed for a hash table
+ *		shared by nparticipants processes under a Gather node.
+ * ----------------------------------------------------------------
+ */
+Size
+ExecHashJoinEstimateShared(HashJoinState *node, int nparticipants)
+{
+	Hash	   *hashNode = (Hash *) innerPlan(node->js.ps.plan);
+
+	return ExecHashTableEstimateShared(hashNode, nparticipants);
+}
+
+/* ----------------------------------------------------------------
+ *		ExecHashJoinInitializeShared
+ *
+ *		Set up a shared hash table in the space estimated above, and
+ *		build into it rather than a private one.  Only inner joins
+ *		can share their hash table; see hashjoin.h.
+ * ----------------------------------------------------------------
+ */
+void
+ExecHashJoinInitializeShared(HashJoinState *node,
+							 ParallelHashJoinState *pstate,
+							 int nparticipants, dsm_segment *seg)
+{
+	Hash	   *hashNode = (Hash *) innerPlan(node->js.ps.plan);
+
+	Assert(node->js.jointype == JOIN_INNER);
+	ExecHashTableInitializeShared(pstate, hashNode, nparticipants, seg);
+	node->hj_Shared = pstate;
+}
+
+/* ----------------------------------------------------------------
+ *		ExecHashJoinAttachShared
+ *
+ *		In a worker, build into the shared hash table set up by the
+ *		master.
+ * ----------------------------------------------------------------
+ */
+void
+ExecHashJoinAttachShared(HashJoinState *node, ParallelHashJoinState *pstate,
+						 dsm_segment *seg)
+{
+	ExecHashTableAttachSharedSegment(pstate, seg);
+	node->hj_Shared = pstate;
+}
+
+/* ----------------------------------------------------------------
+ *		ExecHashJoinReInitializeShared
+ *
+ *		Reset the shared hash table for a rescan, once the workers
+ *		are gone and the node itself has been rescanned.
+ * ----------------------------------------------------------------
+ */
+void
+ExecHashJoinReInitializeShared(HashJoinState *node)
+{
+	Assert(node->hj_HashTable == NULL);
+	ExecHashTableReInitializeShared(node->hj_Shared);
+}
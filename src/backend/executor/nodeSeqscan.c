@@ -16,13 +16,17 @@
  * INTERFACE ROUTINES
  *		ExecSeqScan				sequentially scans a relation.
  *		ExecSeqNext				retrieve next tuple in sequential order.
+ *		ExecSeqScanInitBatch	sets up to return rows in batches.
+ *		ExecSeqScanBatch		retrieves the next batch of rows.
  *		ExecInitSeqScan			creates and initializes a seqscan node.
  *		ExecEndSeqScan			releases any storage allocated.
  *		ExecReScanSeqScan		rescans the relation
+ *		ExecSeqScanInitializeParallel	joins a parallel heap scan
  */
 #include "postgres.h"
 
 #include "access/relscan.h"
+#include "executor/execBatch.h"
 #include "executor/execdebug.h"
 #include "executor/nodeSeqscan.h"
 #include "utils/rel.h"
@@ -113,6 +117,135 @@ ExecSeqScan(SeqScanState *node)
 					(ExecScanRecheckMtd) SeqRecheck);
 }
 
+/* ----------------------------------------------------------------
+ *		ExecSeqScanInitBatch(node, ncols, cols)
+ *
+ *		Sets up to return the given columns of the node's output in
+ *		batches.  That's possible only if the targetlist consists of
+ *		plain Vars, the requested columns are pass-by-value, and the
+ *		node's quals can all be evaluated on a batch.  Returns NULL if
+ *		not.
+ * ----------------------------------------------------------------
+ */
+TupleBatch *
+ExecSeqScanInitBatch(SeqScanState *node, int ncols, AttrNumber *cols)
+{
+	SeqScan    *plan = (SeqScan *) node->ps.plan;
+	TupleDesc	tupdesc = node->ss_ScanTupleSlot->tts_tupleDescriptor;
+	int			nquals = list_length(plan->plan.qual);
+	TupleBatch *batch;
+	ListCell   *lc;
+	int			i;
+
+	/* EvalPlanQual rechecks need to go through ExecScan */
+	if (node->ps.state->es_epqTuple != NULL)
+		return NULL;
+
+	/*
+	 * The targetlist can't compute anything, since we skip projection; in
+	 * particular a set-returning function would change the number of rows.
+	 */
+	foreach(lc, plan->plan.targetlist)
+	{
+		TargetEntry *tle = (TargetEntry *) lfirst(lc);
+
+		if (!IsA(tle->expr, Var))
+			return NULL;
+	}
+
+	for (i = 0; i < ncols; i++)
+	{
+		TargetEntry *tle;
+		Var		   *var;
+
+		if (cols[i] < 1 || cols[i] > list_length(plan->plan.targetlist))
+			return NULL;
+		tle = (TargetEntry *) list_nth(plan->plan.targetlist, cols[i] - 1);
+		var = (Var *) tle->expr;
+		if (var->varno != plan->scanrelid ||
+			var->varattno <= 0 ||
+			!tupdesc->attrs[var->varattno - 1]->attbyval)
+			return NULL;
+	}
+
+	batch = MakeTupleBatch(ncols + nquals, nquals);
+	for (i = 0; i < ncols; i++)
+	{
+		TargetEntry *tle;
+		AttrNumber	attnum;
+
+		tle = (TargetEntry *) list_nth(plan->plan.targetlist, cols[i] - 1);
+		attnum = ((Var *) tle->expr)->varattno;
+		AddBatchColumn(batch, attnum, tupdesc->attrs[attnum - 1]->attlen);
+	}
+
+	if (!ExecBatchBuildQuals(batch, plan->plan.qual, plan->scanrelid))
+		return NULL;
+
+	return batch;
+}
+
+/* ----------------------------------------------------------------
+ *		ExecSeqScanBatch(node, batch)
+ *
+ *		Fills the batch with the next rows of the relation, and
+ *		evaluates the quals on them.  Returns false if there were
+ *		no more rows.
+ * ----------------------------------------------------------------
+ */
+bool
+ExecSeqScanBatch(SeqScanState *node, TupleBatch *batch)
+{
+	HeapScanDesc scandesc = node->ss_currentScanDesc;
+	ScanDirection direction = node->ps.state->es_direction;
+	TupleTableSlot *slot = node->ss_ScanTupleSlot;
+	int			ncols = batch->ncols;
+	int			nrows = 0;
+	int			col;
+
+	/* heap_getnext would start over if called again after the end */
+	while (nrows < EXEC_BATCH_SIZE && !batch->eof)
+	{
+		HeapTuple	tuple = heap_getnext(scandesc, direction);
+
+		if (tuple == NULL)
+		{
+			ExecClearTuple(slot);
+			batch->eof = true;
+			break;
+		}
+
+		/*
+		 * Deform the tuple in the scan slot, which also keeps the current
+		 * buffer pinned, just as SeqNext does.  Since we only copy out
+		 * pass-by-value columns, the rows don't need the pin afterwards.
+		 */
+		ExecStoreTuple(tuple, slot, scandesc->rs_cbuf, false);
+		slot_getsomeattrs(slot, batch->maxattnum);
+
+		for (col = 0; col < ncols; col++)
+		{
+			AttrNumber	attnum = batch->attnums[col];
+
+			batch->values[col][nrows] = slot->tts_values[attnum - 1];
+			batch->isnull[col][nrows] = slot->tts_isnull[attnum - 1];
+		}
+		nrows++;
+	}
+
+	batch->nrows = nrows;
+	if (nrows == 0)
+	{
+		batch->nselected = 0;
+		return false;
+	}
+
+	ExecBatchQual(batch);
+	InstrCountFiltered1(node, nrows - batch->nselected);
+
+	return true;
+}
+
 /* ----------------------------------------------------------------
  *		InitScanRelation
  *
@@ -272,3 +405,24 @@ ExecReScanSeqScan(SeqScanState *node)
 
 	ExecScanReScan((ScanState *) node);
 }
+
+/* ----------------------------------------------------------------
+ *		ExecSeqScanInitializeParallel
+ *
+ *		Replace the node's private heap scan with one that takes part in
+ *		the given parallel heap scan, so that the node returns only the
+ *		tuples on blocks it claims.  Used by Gather, in the master and in
+ *		each worker, right after ExecInitSeqScan.
+ * ----------------------------------------------------------------
+ */
+void
+ExecSeqScanInitializeParallel(SeqScanState *node, ParallelHeapScanDesc pscan)
+{
+	EState	   *estate = node->ps.state;
+
+	heap_endscan(node->ss_currentScanDesc);
+	node->ss_currentScanDesc =
+		heap_beginscan_parallel(node->ss_currentRelation,
+								estate->es_snapshot,
+								pscan);
+}
@@ -15,6 +15,7 @@
 
 #include "postgres.h"
 
+#include "access/parallel.h"
 #include "executor/execdebug.h"
 #include "executor/nodeSort.h"
 #include "miscadmin.h"
@@ -33,6 +34,10 @@
  *
  *		Initial States:
  *		  -- the outer child is prepared to return the first tuple.
+ *
+ *		In a shared sort, a parallel worker sorts its share of the
+ *		input for the leader and returns no tuples itself, while the
+ *		leader's sort reads no input and merges the participants' runs.
  * ----------------------------------------------------------------
  */
 TupleTableSlot *
@@ -49,6 +54,16 @@ ExecSort(SortState *node)
 	SO1_printf("ExecSort: %s\n",
 			   "entering routine");
 
+	if (node->shared != NULL && IsParallelWorker())
+	{
+		if (!node->sort_Done)
+		{
+			ExecSortShareInput(node);
+			node->sort_Done = true;
+		}
+		return ExecClearTuple(node->ss.ps.ps_ResultTupleSlot);
+	}
+
 	estate = node->ss.ps.state;
 	dir = estate->es_direction;
 	tuplesortstate = (Tuplesortstate *) node->tuplesortstate;
@@ -95,17 +110,23 @@ ExecSort(SortState *node)
 		node->tuplesortstate = (void *) tuplesortstate;
 
 		/*
-		 * Scan the subplan and feed all the tuples to tuplesort.
+		 * Scan the subplan and feed all the tuples to tuplesort.  In a shared
+		 * sort, the participants have already done so, ourselves included.
 		 */
 
-		for (;;)
+		if (node->shared != NULL)
+			tuplesort_attach_leader(tuplesortstate, node->shared);
+		else
 		{
-			slot = ExecProcNode(outerNode);
+			for (;;)
+			{
+				slot = ExecProcNode(outerNode);
 
-			if (TupIsNull(slot))
-				break;
+				if (TupIsNull(slot))
+					break;
 
-			tuplesort_puttupleslot(tuplesortstate, slot);
+				tuplesort_puttupleslot(tuplesortstate, slot);
+			}
 		}
 
 		/*
@@ -175,6 +196,7 @@ ExecInitSort(Sort *node, EState *estate, int eflags)
 	sortstate->bounded = false;
 	sortstate->sort_Done = false;
 	sortstate->tuplesortstate = NULL;
+	sortstate->shared = NULL;
 
 	/*
 	 * Miscellaneous initialization
@@ -327,3 +349,68 @@ ExecReScanSort(SortState *node)
 	else
 		tuplesort_rescan((Tuplesortstate *) node->tuplesortstate);
 }
+
+/* ----------------------------------------------------------------
+ *		ExecSortInitializeShared
+ *
+ *		Makes the sort one participant of a shared sort, whose
+ *		Sharedsort the caller has set up or attached to.  The Gather
+ *		node above coordinates the participants; see nodeGather.c.
+ * ----------------------------------------------------------------
+ */
+void
+ExecSortInitializeShared(SortState *node, Sharedsort *shared)
+{
+	/* the merged output can be neither rewound nor cut short */
+	Assert(!node->randomAccess && !node->bounded);
+
+	node->shared = shared;
+}
+
+/* ----------------------------------------------------------------
+ *		ExecSortShareInput
+ *
+ *		Sorts all the tuples the outer subtree returns in this backend
+ *		as one worker of the shared sort, leaving the sorted run for
+ *		the leader to merge.
+ * ----------------------------------------------------------------
+ */
+void
+ExecSortShareInput(SortState *node)
+{
+	EState	   *estate = node->ss.ps.state;
+	Sort	   *plannode = (Sort *) node->ss.ps.plan;
+	PlanState  *outerNode = outerPlanState(node);
+	ScanDirection dir = estate->es_direction;
+	Tuplesortstate *tuplesortstate;
+	TupleTableSlot *slot;
+
+	Assert(node->shared != NULL);
+
+	estate->es_direction = ForwardScanDirection;
+
+	tuplesortstate = tuplesort_begin_heap(ExecGetResultType(outerNode),
+										  plannode->numCols,
+										  plannode->sortColIdx,
+										  plannode->sortOperators,
+										  plannode->collations,
+										  plannode->nullsFirst,
+										  work_mem,
+										  false);
+	tuplesort_attach_worker(tuplesortstate, node->shared);
+
+	for (;;)
+	{
+		slot = ExecProcNode(outerNode);
+
+		if (TupIsNull(slot))
+			break;
+
+		tuplesort_puttupleslot(tuplesortstate, slot);
+	}
+
+	tuplesort_performsort(tuplesortstate);
+	tuplesort_end(tuplesortstate);
+
+	estate->es_direction = dir;
+}
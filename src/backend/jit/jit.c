@@ -0,0 +1,138 @@
+/*-------------------------------------------------------------------------
+ *
+ * jit.c
+ *	  Provider independent JIT infrastructure.
+ *
+ * Code related to loading JIT providers, redirecting calls into JIT providers
+ * and error handling.  No code specific to a specific JIT implementation
+ * should end up here.
+ *
+ *
+ * Portions Copyright (c) 1996-2015, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *	  src/backend/jit/jit.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "fmgr.h"
+#include "jit/jit.h"
+#include "miscadmin.h"
+
+
+/* GUCs */
+bool		jit_enabled = false;
+char	   *jit_provider = NULL;
+bool		jit_expressions = true;
+bool		jit_tuple_deforming = true;
+double		jit_above_cost = 100000;
+double		jit_optimize_above_cost = 500000;
+
+static JitProviderCallbacks provider;
+static bool provider_successfully_loaded = false;
+static bool provider_failed_loading = false;
+
+
+/*
+ * Load the JIT provider, if not already done.  Returns false if JIT is
+ * disabled or the provider can't be loaded; that isn't an error, callers
+ * just go on without JIT.
+ */
+static bool
+provider_init(void)
+{
+	char		path[MAXPGPATH];
+	struct stat st;
+	JitProviderInit init;
+
+	/* don't even try to load if not enabled */
+	if (!jit_enabled)
+		return false;
+
+	/*
+	 * Don't retry loading after failing - attempting to load JIT provider
+	 * isn't cheap.
+	 */
+	if (provider_failed_loading)
+		return false;
+	if (provider_successfully_loaded)
+		return true;
+
+	/*
+	 * Check whether the shared library exists.  We do that check before
+	 * actually attempting to load the shared library, as loading it is an
+	 * error if it doesn't exist, and that's the normal state of affairs in
+	 * builds without LLVM.
+	 */
+	snprintf(path, MAXPGPATH, "%s/%s%s", pkglib_path, jit_provider, DLSUFFIX);
+	elog(DEBUG1, "probing availability of JIT provider at %s", path);
+	if (stat(path, &st) != 0)
+	{
+		elog(DEBUG1,
+			 "provider not available, disabling JIT for current session");
+		provider_failed_loading = true;
+		return false;
+	}
+
+	/*
+	 * If loading functions fails, signal failure.  We do so because
+	 * load_external_function() might error out despite the above check if
+	 * e.g. the library's dependencies aren't installed.  We want to signal
+	 * ERROR in that case, so the user is notified, but we don't want to
+	 * continually retry.
+	 */
+	provider_failed_loading = true;
+
+	/* and initialize */
+	init = (JitProviderInit)
+		load_external_function(path, "_PG_jit_provider_init", true, NULL);
+	init(&provider);
+
+	provider_successfully_loaded = true;
+	provider_failed_loading = false;
+
+	elog(DEBUG1, "successfully loaded JIT provider in current session");
+
+	return true;
+}
+
+/*
+ * Release resources required by one JIT context.
+ */
+void
+jit_release_context(JitContext *context)
+{
+	if (provider_successfully_loaded)
+		provider.release_context(context);
+}
+
+/*
+ * Ask provider to JIT compile an expression.
+ *
+ * Returns true if successful, false if not.
+ */
+bool
+jit_compile_expr(ExprState *state, ExprContext *econtext)
+{
+	EState	   *estate = econtext->ecxt_estate;
+
+	/* this also takes !jit_enabled into account */
+	if (estate == NULL || !(estate->es_jit_flags & PGJIT_PERFORM))
+		return false;
+
+	/* if no expressions are to be JITed, there's nothing to do */
+	if (!(estate->es_jit_flags & PGJIT_EXPR))
+		return false;
+
+	/* this also takes !jit_enabled into account */
+	if (provider_init())
+		return provider.compile_expr(state, econtext);
+
+	return false;
+}
@@ -0,0 +1,341 @@
+/*-------------------------------------------------------------------------
+ *
+ * llvmjit.c
+ *	  Core part of the LLVM JIT provider.
+ *
+ * Each query that JIT compiles anything gets an LLVMJitContext, with an
+ * MCJIT execution engine of its own.  Every function is generated into a
+ * separate module, which is optimized and then handed to the engine to emit
+ * machine code for.  Addresses of backend functions and of per-query data
+ * are embedded in the generated code as constants, so no symbol resolution
+ * is needed.  Releasing the context, either at executor shutdown or when its
+ * resource owner is released, throws away all code emitted for the query.
+ *
+ * Portions Copyright (c) 1996-2015, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *	  src/backend/jit/llvm/llvmjit.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include <llvm-c/Analysis.h>
+#include <llvm-c/Target.h>
+#include <llvm-c/Transforms/PassManagerBuilder.h>
+#include <llvm-c/Transforms/Scalar.h>
+#include <llvm-c/Transforms/Utils.h>
+
+#include "fmgr.h"
+#include "jit/llvmjit.h"
+#include "portability/instr_time.h"
+#include "utils/memutils.h"
+#include "utils/resowner.h"
+
+PG_MODULE_MAGIC;
+
+
+LLVMTypeRef TypeSizeT;
+LLVMTypeRef TypeDatum;
+LLVMTypeRef TypeStorageBool;
+LLVMTypeRef TypeInt32;
+LLVMTypeRef TypePtr;
+
+/* all live contexts, in TopMemoryContext */
+static List *llvm_contexts = NIL;
+
+static char *llvm_triple = NULL;
+
+
+static void llvm_release_context(JitContext *context);
+static void llvm_resowner_release(ResourceReleasePhase phase, bool isCommit,
+					  bool isTopLevel, void *arg);
+static void llvm_create_engine(LLVMJitContext *context);
+static void llvm_optimize_module(LLVMJitContext *context, LLVMModuleRef mod);
+
+
+/*
+ * Initialize LLVM JIT provider.
+ */
+void
+_PG_jit_provider_init(JitProviderCallbacks *cb)
+{
+	cb->release_context = llvm_release_context;
+	cb->compile_expr = llvm_compile_expr;
+
+	LLVMLinkInMCJIT();
+	LLVMInitializeNativeTarget();
+	LLVMInitializeNativeAsmPrinter();
+	LLVMInitializeNativeAsmParser();
+
+	llvm_triple = LLVMGetDefaultTargetTriple();
+
+	TypeSizeT = LLVMIntType(sizeof(size_t) * BITS_PER_BYTE);
+	TypeDatum = LLVMIntType(SIZEOF_DATUM * BITS_PER_BYTE);
+	TypeStorageBool = LLVMIntType(sizeof(bool) * BITS_PER_BYTE);
+	TypeInt32 = LLVMInt32Type();
+	TypePtr = LLVMPointerType(LLVMInt8Type(), 0);
+
+	RegisterResourceReleaseCallback(llvm_resowner_release, NULL);
+}
+
+/*
+ * Create a context for JITing work.
+ *
+ * The context, including its engine, is owned by CurrentResourceOwner, so
+ * it's cleaned up if the query fails before the executor is shut down.
+ */
+LLVMJitContext *
+llvm_create_context(int jitFlags)
+{
+	LLVMJitContext *context;
+	MemoryContext oldcontext;
+
+	oldcontext = MemoryContextSwitchTo(TopMemoryContext);
+
+	context = (LLVMJitContext *) palloc0(sizeof(LLVMJitContext));
+	context->base.flags = jitFlags;
+	context->base.resowner = CurrentResourceOwner;
+	llvm_contexts = lappend(llvm_contexts, context);
+
+	MemoryContextSwitchTo(oldcontext);
+
+	return context;
+}
+
+/*
+ * Release resources required by one llvm context.
+ *
+ * The context may already be gone if its resource owner was released
+ * earlier, in which case there's nothing to do.
+ */
+static void
+llvm_release_context(JitContext *context)
+{
+	LLVMJitContext *llvm_context = (LLVMJitContext *) context;
+
+	if (!list_member_ptr(llvm_contexts, llvm_context))
+		return;
+
+	llvm_contexts = list_delete_ptr(llvm_contexts, llvm_context);
+
+	/* the engine owns all modules added to it */
+	if (llvm_context->engine)
+		LLVMDisposeExecutionEngine(llvm_context->engine);
+	list_free_deep(llvm_context->deform_functions);
+	pfree(llvm_context);
+}
+
+/*
+ * Resource owner callback, releasing the contexts belonging to the owner
+ * being released.
+ */
+static void
+llvm_resowner_release(ResourceReleasePhase phase, bool isCommit,
+					  bool isTopLevel, void *arg)
+{
+	ListCell   *lc;
+	ListCell   *next;
+
+	if (phase != RESOURCE_RELEASE_AFTER_LOCKS)
+		return;
+
+	for (lc = list_head(llvm_contexts); lc != NULL; lc = next)
+	{
+		LLVMJitContext *context = (LLVMJitContext *) lfirst(lc);
+
+		next = lnext(lc);
+		if (context->base.resowner == CurrentResourceOwner)
+			llvm_release_context(&context->base);
+	}
+}
+
+/*
+ * Return a name for a new function, unique within the context.  The result
+ * is palloc'd in the current memory context.
+ */
+char *
+llvm_expand_funcname(LLVMJitContext *context, const char *basename)
+{
+	return psprintf("%s_%d", basename, context->counter++);
+}
+
+/*
+ * Create a new module to generate a function into.
+ */
+LLVMModuleRef
+llvm_create_module(LLVMJitContext *context)
+{
+	LLVMModuleRef mod;
+
+	if (context->engine == NULL)
+		llvm_create_engine(context);
+
+	mod = LLVMModuleCreateWithName("pg");
+	LLVMSetTarget(mod, llvm_triple);
+	LLVMSetModuleDataLayout(mod,
+						LLVMGetExecutionEngineTargetData(context->engine));
+
+	return mod;
+}
+
+/*
+ * Optimize the module, emit machine code for it and return the address of
+ * the named function in it.  The module is owned by the context afterwards.
+ */
+void *
+llvm_compile_module(LLVMJitContext *context, LLVMModuleRef mod,
+					const char *funcname)
+{
+	instr_time	starttime;
+	instr_time	endtime;
+	void	   *addr;
+
+#ifdef USE_ASSERT_CHECKING
+	if (LLVMVerifyModule(mod, LLVMPrintMessageAction, NULL))
+		elog(ERROR, "failed to verify generated module");
+#endif
+
+	INSTR_TIME_SET_CURRENT(starttime);
+	llvm_optimize_module(context, mod);
+	INSTR_TIME_SET_CURRENT(endtime);
+	INSTR_TIME_ACCUM_DIFF(context->base.instr.optimization_counter,
+						  endtime, starttime);
+
+	INSTR_TIME_SET_CURRENT(starttime);
+	LLVMAddModule(context->engine, mod);
+	addr = (void *) (uintptr_t) LLVMGetFunctionAddress(context->engine,
+													   funcname);
+	INSTR_TIME_SET_CURRENT(endtime);
+	INSTR_TIME_ACCUM_DIFF(context->base.instr.emission_counter,
+						  endtime, starttime);
+
+	if (addr == NULL)
+		elog(ERROR, "failed to JIT: %s", funcname);
+
+	context->base.instr.created_functions++;
+
+	return addr;
+}
+
+/*
+ * Create the execution engine of a context.  It starts out with an empty
+ * module, since MCJIT insists on having one.
+ */
+static void
+llvm_create_engine(LLVMJitContext *context)
+{
+	struct LLVMMCJITCompilerOptions options;
+	LLVMModuleRef mod;
+	char	   *error = NULL;
+
+	LLVMInitializeMCJITCompilerOptions(&options, sizeof(options));
+	if (context->base.flags & PGJIT_OPT3)
+		options.OptLevel = 3;
+	else
+		options.OptLevel = 0;
+
+	mod = LLVMModuleCreateWithName("pg_empty");
+	LLVMSetTarget(mod, llvm_triple);
+
+	if (LLVMCreateMCJITCompilerForModule(&context->engine, mod,
+										 &options, sizeof(options), &error))
+	{
+		context->engine = NULL;
+		elog(ERROR, "failed to create JIT engine: %s", error);
+	}
+}
+
+/*
+ * Run the optimizer over a module.  Without PGJIT_OPT3 only the most
+ * important cleanup, turning the generated stack variables into registers,
+ * is done; that's cheap and makes code emission faster too.
+ */
+static void
+llvm_optimize_module(LLVMJitContext *context, LLVMModuleRef mod)
+{
+	LLVMPassManagerRef llvm_fpm;
+	LLVMPassManagerRef llvm_mpm;
+	LLVMValueRef func;
+
+	llvm_fpm = LLVMCreateFunctionPassManagerForModule(mod);
+	llvm_mpm = LLVMCreatePassManager();
+
+	if (context->base.flags & PGJIT_OPT3)
+	{
+		LLVMPassManagerBuilderRef llvm_pmb;
+
+		llvm_pmb = LLVMPassManagerBuilderCreate();
+		LLVMPassManagerBuilderSetOptLevel(llvm_pmb, 3);
+		LLVMPassManagerBuilderPopulateFunctionPassManager(llvm_pmb, llvm_fpm);
+		LLVMPassManagerBuilderPopulateModulePassManager(llvm_pmb, llvm_mpm);
+		LLVMPassManagerBuilderDispose(llvm_pmb);
+	}
+	else
+		LLVMAddPromoteMemoryToRegisterPass(llvm_fpm);
+
+	LLVMInitializeFunctionPassManager(llvm_fpm);
+	for (func = LLVMGetFirstFunction(mod);
+		 func != NULL;
+		 func = LLVMGetNextFunction(func))
+		LLVMRunFunctionPassManager(llvm_fpm, func);
+	LLVMFinalizeFunctionPassManager(llvm_fpm);
+	LLVMDisposePassManager(llvm_fpm);
+
+	LLVMRunPassManager(llvm_mpm, mod);
+	LLVMDisposePassManager(llvm_mpm);
+}
+
+
+/*
+ * Return a constant pointer of the given type to a backend address.
+ */
+LLVMValueRef
+l_ptr_const(void *ptr, LLVMTypeRef type)
+{
+	LLVMValueRef c = LLVMConstInt(TypeSizeT, (uintptr_t) ptr, false);
+
+	return LLVMConstIntToPtr(c, type);
+}
+
+/*
+ * Return a pointer to the field at the given byte offset within the struct
+ * pointed to by base, typed as a pointer to the given field type.
+ */
+LLVMValueRef
+l_field_ptr(LLVMBuilderRef b, LLVMValueRef base, size_t offset,
+			LLVMTypeRef type)
+{
+	LLVMValueRef v_base;
+	LLVMValueRef v_off;
+	LLVMValueRef v_field;
+
+	v_base = LLVMBuildBitCast(b, base, TypePtr, "");
+	v_off = LLVMConstInt(TypeSizeT, offset, false);
+	v_field = LLVMBuildGEP2(b, LLVMInt8Type(), v_base, &v_off, 1, "");
+
+	return LLVMBuildBitCast(b, v_field, LLVMPointerType(type, 0), "");
+}
+
+/*
+ * Load the field of the given type at the given byte offset within the
+ * struct pointed to by base.
+ */
+LLVMValueRef
+l_load_field(LLVMBuilderRef b, LLVMValueRef base, size_t offset,
+			 LLVMTypeRef type, const char *name)
+{
+	return LLVMBuildLoad2(b, type, l_field_ptr(b, base, offset, type), name);
+}
+
+/*
+ * Emit a call to a backend function, given its address and type.
+ */
+LLVMValueRef
+l_call_ptr(LLVMBuilderRef b, void *fn, LLVMTypeRef fntype,
+		   LLVMValueRef *args, int nargs, const char *name)
+{
+	return LLVMBuildCall2(b, fntype,
+						  l_ptr_const(fn, LLVMPointerType(fntype, 0)),
+						  args, nargs, name);
+}
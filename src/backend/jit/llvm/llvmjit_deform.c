@@ -0,0 +1,450 @@
+/*-------------------------------------------------------------------------
+ *
+ * llvmjit_deform.c
+ *	  Generate code for deforming a heap tuple.
+ *
+ * This gains performance mainly by unrolling the attribute loop of
+ * slot_deform_tuple for a known tuple descriptor: the length, alignment and
+ * by-value-ness of every attribute become constants, offsets are known at
+ * compile time as long as only fixed width NOT NULL attributes precede an
+ * attribute, and null checks are only emitted for nullable attributes.
+ *
+ * Portions Copyright (c) 1996-2015, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *	  src/backend/jit/llvm/llvmjit_deform.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/htup_details.h"
+#include "access/tupmacs.h"
+#include "executor/tuptable.h"
+#include "jit/llvmjit.h"
+#include "utils/memutils.h"
+
+
+/* an already emitted deforming function, cf. LLVMJitContext */
+typedef struct LLVMJitDeformFunction
+{
+	TupleDesc	desc;
+	int			natts;
+	void	   *addr;
+} LLVMJitDeformFunction;
+
+static size_t llvm_varsize_any(void *ptr);
+static LLVMValueRef l_align(LLVMBuilderRef b, LLVMValueRef v_off,
+		char attalign);
+
+
+/*
+ * Return a function that deforms the first natts attributes of the tuple
+ * stored in a slot using the given descriptor, void (*)(TupleTableSlot *).
+ *
+ * The function only handles the common case of a physical tuple none of
+ * whose attributes has been extracted yet, that has at least natts
+ * attributes.  For anything else, or a slot with a different descriptor,
+ * it calls slot_getsomeattrs().
+ */
+void *
+llvm_compile_deform(LLVMJitContext *context, TupleDesc desc, int natts)
+{
+	LLVMJitDeformFunction *df;
+	ListCell   *lc;
+	MemoryContext oldcontext;
+	char	   *funcname;
+	instr_time	starttime;
+	instr_time	endtime;
+	LLVMModuleRef mod;
+	LLVMBuilderRef b;
+	LLVMTypeRef deform_sig;
+	LLVMTypeRef getsomeattrs_sig;
+	LLVMTypeRef size_sig;
+	LLVMTypeRef param_types[2];
+	LLVMValueRef v_deform_fn;
+	LLVMBasicBlockRef b_entry;
+	LLVMBasicBlockRef b_checktuple;
+	LLVMBasicBlockRef b_checknatts;
+	LLVMBasicBlockRef b_fallback;
+	LLVMBasicBlockRef b_out;
+	LLVMBasicBlockRef *attstartblocks;
+	LLVMValueRef v_slot;
+	LLVMValueRef v_tuple;
+	LLVMValueRef v_tupleheader;
+	LLVMValueRef v_infomask;
+	LLVMValueRef v_infomask2;
+	LLVMValueRef v_hoff;
+	LLVMValueRef v_hasnulls;
+	LLVMValueRef v_maxatt;
+	LLVMValueRef v_tupdata_base;
+	LLVMValueRef v_bits;
+	LLVMValueRef v_values;
+	LLVMValueRef v_isnull;
+	LLVMValueRef v_offp;
+	LLVMValueRef v_cond;
+	LLVMValueRef v_args[2];
+	int			known_off = 0;
+	int			attnum;
+
+	/* reuse a function made earlier for the same descriptor, if any */
+	foreach(lc, context->deform_functions)
+	{
+		df = (LLVMJitDeformFunction *) lfirst(lc);
+		if (df->desc == desc && df->natts == natts)
+			return df->addr;
+	}
+
+	funcname = llvm_expand_funcname(context, "deform");
+
+	INSTR_TIME_SET_CURRENT(starttime);
+
+	mod = llvm_create_module(context);
+	b = LLVMCreateBuilder();
+
+	param_types[0] = TypePtr;
+	deform_sig = LLVMFunctionType(LLVMVoidType(), param_types, 1, false);
+	param_types[1] = TypeInt32;
+	getsomeattrs_sig = LLVMFunctionType(LLVMVoidType(), param_types, 2,
+										false);
+	size_sig = LLVMFunctionType(TypeSizeT, param_types, 1, false);
+
+	v_deform_fn = LLVMAddFunction(mod, funcname, deform_sig);
+	v_slot = LLVMGetParam(v_deform_fn, 0);
+
+	b_entry = LLVMAppendBasicBlock(v_deform_fn, "entry");
+	b_checktuple = LLVMAppendBasicBlock(v_deform_fn, "checktuple");
+	b_checknatts = LLVMAppendBasicBlock(v_deform_fn, "checknatts");
+	b_fallback = LLVMAppendBasicBlock(v_deform_fn, "fallback");
+
+	attstartblocks = (LLVMBasicBlockRef *)
+		palloc(sizeof(LLVMBasicBlockRef) * natts);
+	for (attnum = 0; attnum < natts; attnum++)
+		attstartblocks[attnum] =
+			LLVMAppendBasicBlock(v_deform_fn, "attstart");
+	b_out = LLVMAppendBasicBlock(v_deform_fn, "out");
+
+	/*
+	 * Check that the slot has our descriptor and nothing has been extracted
+	 * yet.
+	 */
+	LLVMPositionBuilderAtEnd(b, b_entry);
+	v_offp = LLVMBuildAlloca(b, TypeSizeT, "v_offp");
+	LLVMBuildStore(b, LLVMConstInt(TypeSizeT, 0, false), v_offp);
+	v_cond = LLVMBuildAnd(b,
+						  LLVMBuildICmp(b, LLVMIntEQ,
+										l_load_field(b, v_slot,
+								 offsetof(TupleTableSlot, tts_tupleDescriptor),
+													 TypePtr, "desc"),
+										l_ptr_const(desc, TypePtr), ""),
+						  LLVMBuildICmp(b, LLVMIntEQ,
+										l_load_field(b, v_slot,
+										   offsetof(TupleTableSlot, tts_nvalid),
+													 TypeInt32, "nvalid"),
+										LLVMConstInt(TypeInt32, 0, false), ""),
+						  "");
+	LLVMBuildCondBr(b, v_cond, b_checktuple, b_fallback);
+
+	/* and that there is a physical tuple in it */
+	LLVMPositionBuilderAtEnd(b, b_checktuple);
+	v_tuple = l_load_field(b, v_slot, offsetof(TupleTableSlot, tts_tuple),
+						   TypePtr, "tuple");
+	LLVMBuildCondBr(b, LLVMBuildIsNull(b, v_tuple, ""),
+					b_fallback, b_checknatts);
+
+	/* with at least natts attributes */
+	LLVMPositionBuilderAtEnd(b, b_checknatts);
+	v_tupleheader = l_load_field(b, v_tuple, offsetof(HeapTupleData, t_data),
+								 TypePtr, "tupleheader");
+	v_infomask = l_load_field(b, v_tupleheader,
+							  offsetof(HeapTupleHeaderData, t_infomask),
+							  LLVMInt16Type(), "infomask");
+	v_infomask2 = l_load_field(b, v_tupleheader,
+							   offsetof(HeapTupleHeaderData, t_infomask2),
+							   LLVMInt16Type(), "infomask2");
+	v_hoff = l_load_field(b, v_tupleheader,
+						  offsetof(HeapTupleHeaderData, t_hoff),
+						  LLVMInt8Type(), "hoff");
+	v_hasnulls = LLVMBuildICmp(b, LLVMIntNE,
+							   LLVMBuildAnd(b, v_infomask,
+											LLVMConstInt(LLVMInt16Type(),
+														 HEAP_HASNULL, false),
+											""),
+							   LLVMConstInt(LLVMInt16Type(), 0, false),
+							   "hasnulls");
+	v_maxatt = LLVMBuildAnd(b, v_infomask2,
+							LLVMConstInt(LLVMInt16Type(), HEAP_NATTS_MASK,
+										 false),
+							"maxatt");
+	v_hoff = LLVMBuildZExt(b, v_hoff, TypeSizeT, "");
+	v_tupdata_base = LLVMBuildGEP2(b, LLVMInt8Type(), v_tupleheader,
+								   &v_hoff, 1, "tupdata_base");
+	v_bits = l_field_ptr(b, v_tupleheader,
+						 offsetof(HeapTupleHeaderData, t_bits),
+						 LLVMInt8Type());
+	v_values = l_load_field(b, v_slot, offsetof(TupleTableSlot, tts_values),
+							LLVMPointerType(TypeDatum, 0), "values");
+	v_isnull = l_load_field(b, v_slot, offsetof(TupleTableSlot, tts_isnull),
+							LLVMPointerType(TypeStorageBool, 0), "isnull");
+	v_cond = LLVMBuildICmp(b, LLVMIntUGE, v_maxatt,
+						   LLVMConstInt(LLVMInt16Type(), natts, false), "");
+	LLVMBuildCondBr(b, v_cond, attstartblocks[0], b_fallback);
+
+	/* anything out of the ordinary is left to slot_getsomeattrs */
+	LLVMPositionBuilderAtEnd(b, b_fallback);
+	v_args[0] = v_slot;
+	v_args[1] = LLVMConstInt(TypeInt32, natts, false);
+	l_call_ptr(b, slot_getsomeattrs, getsomeattrs_sig, v_args, 2, "");
+	LLVMBuildRetVoid(b);
+
+	for (attnum = 0; attnum < natts; attnum++)
+	{
+		Form_pg_attribute att = desc->attrs[attnum];
+		LLVMBasicBlockRef b_next;
+		LLVMBasicBlockRef b_notnull;
+		LLVMValueRef v_attoff;
+		LLVMValueRef v_attdatap;
+		LLVMValueRef v_valuep;
+		LLVMValueRef v_isnullp;
+		LLVMValueRef v_idx;
+		LLVMValueRef v_newoff;
+
+		b_next = (attnum + 1 < natts) ? attstartblocks[attnum + 1] : b_out;
+		b_notnull = LLVMAppendBasicBlock(v_deform_fn, "notnull");
+		LLVMMoveBasicBlockAfter(b_notnull, attstartblocks[attnum]);
+
+		v_idx = LLVMConstInt(TypeSizeT, attnum, false);
+
+		LLVMPositionBuilderAtEnd(b, attstartblocks[attnum]);
+		v_valuep = LLVMBuildGEP2(b, TypeDatum, v_values, &v_idx, 1, "");
+		v_isnullp = LLVMBuildGEP2(b, TypeStorageBool, v_isnull, &v_idx, 1,
+								  "");
+
+		if (att->attnotnull)
+			LLVMBuildBr(b, b_notnull);
+		else
+		{
+			LLVMBasicBlockRef b_checknull;
+			LLVMBasicBlockRef b_isnull;
+			LLVMValueRef v_byteidx;
+			LLVMValueRef v_nullbyte;
+			LLVMValueRef v_nullbit;
+
+			b_checknull = LLVMAppendBasicBlock(v_deform_fn, "checknull");
+			b_isnull = LLVMAppendBasicBlock(v_deform_fn, "isnull");
+			LLVMMoveBasicBlockAfter(b_checknull, attstartblocks[attnum]);
+			LLVMMoveBasicBlockAfter(b_isnull, b_checknull);
+
+			LLVMBuildCondBr(b, v_hasnulls, b_checknull, b_notnull);
+
+			/* cf. att_isnull */
+			LLVMPositionBuilderAtEnd(b, b_checknull);
+			v_byteidx = LLVMConstInt(TypeSizeT, attnum >> 3, false);
+			v_nullbyte = LLVMBuildLoad2(b, LLVMInt8Type(),
+										LLVMBuildGEP2(b, LLVMInt8Type(),
+													  v_bits, &v_byteidx, 1,
+													  ""),
+										"nullbyte");
+			v_nullbit = LLVMBuildAnd(b, v_nullbyte,
+									 LLVMConstInt(LLVMInt8Type(),
+												  1 << (attnum & 0x07),
+												  false),
+									 "");
+			v_cond = LLVMBuildICmp(b, LLVMIntEQ, v_nullbit,
+								   LLVMConstInt(LLVMInt8Type(), 0, false), "");
+			LLVMBuildCondBr(b, v_cond, b_isnull, b_notnull);
+
+			LLVMPositionBuilderAtEnd(b, b_isnull);
+			LLVMBuildStore(b, LLVMConstInt(TypeDatum, 0, false), v_valuep);
+			LLVMBuildStore(b, LLVMConstInt(TypeStorageBool, 1, false),
+						   v_isnullp);
+			LLVMBuildBr(b, b_next);
+		}
+
+		LLVMPositionBuilderAtEnd(b, b_notnull);
+
+		/*
+		 * Find the start of the attribute's data.  While all preceding
+		 * attributes are fixed width and can't be NULL its offset is known
+		 * right here; otherwise it has to be computed from the running
+		 * offset, as in slot_deform_tuple.
+		 */
+		if (known_off >= 0 &&
+			(att->attlen != -1 ||
+			 att_align_nominal(known_off, att->attalign) == known_off))
+		{
+			v_attoff = LLVMConstInt(TypeSizeT,
+									att_align_nominal(known_off,
+													  att->attalign),
+									false);
+		}
+		else
+		{
+			LLVMValueRef v_off;
+
+			if (known_off >= 0)
+				v_off = LLVMConstInt(TypeSizeT, known_off, false);
+			else
+				v_off = LLVMBuildLoad2(b, TypeSizeT, v_offp, "off");
+
+			if (att->attlen == -1 && att->attalign != 'c')
+			{
+				/* cf. att_align_pointer: no padding before a short varlena */
+				LLVMValueRef v_firstbyte;
+
+				v_firstbyte = LLVMBuildLoad2(b, LLVMInt8Type(),
+											 LLVMBuildGEP2(b, LLVMInt8Type(),
+														   v_tupdata_base,
+														   &v_off, 1, ""),
+											 "firstbyte");
+				v_cond = LLVMBuildICmp(b, LLVMIntNE, v_firstbyte,
+									   LLVMConstInt(LLVMInt8Type(), 0, false),
+									   "");
+				v_attoff = LLVMBuildSelect(b, v_cond, v_off,
+										   l_align(b, v_off, att->attalign),
+										   "attoff");
+			}
+			else
+				v_attoff = l_align(b, v_off, att->attalign);
+		}
+
+		v_attdatap = LLVMBuildGEP2(b, LLVMInt8Type(), v_tupdata_base,
+								   &v_attoff, 1, "attdatap");
+
+		LLVMBuildStore(b, LLVMConstInt(TypeStorageBool, 0, false), v_isnullp);
+
+		/* cf. fetch_att */
+		if (att->attbyval)
+		{
+			LLVMTypeRef vartype = LLVMIntType(att->attlen * BITS_PER_BYTE);
+			LLVMValueRef v_tmp;
+
+			v_tmp = LLVMBuildLoad2(b, vartype,
+								   LLVMBuildBitCast(b, v_attdatap,
+											 LLVMPointerType(vartype, 0), ""),
+								   "attval");
+			if (att->attlen < SIZEOF_DATUM)
+				v_tmp = LLVMBuildSExt(b, v_tmp, TypeDatum, "");
+			LLVMBuildStore(b, v_tmp, v_valuep);
+		}
+		else
+			LLVMBuildStore(b, LLVMBuildPtrToInt(b, v_attdatap, TypeDatum, ""),
+						   v_valuep);
+
+		/* cf. att_addlength_pointer */
+		if (att->attlen > 0)
+			v_newoff = LLVMBuildAdd(b, v_attoff,
+									LLVMConstInt(TypeSizeT, att->attlen,
+												 false),
+									"");
+		else if (att->attlen == -1)
+			v_newoff = LLVMBuildAdd(b, v_attoff,
+									l_call_ptr(b, llvm_varsize_any, size_sig,
+											   &v_attdatap, 1, "varsize"),
+									"");
+		else
+		{
+			Assert(att->attlen == -2);
+			v_newoff = LLVMBuildAdd(b, v_attoff,
+									l_call_ptr(b, strlen, size_sig,
+											   &v_attdatap, 1, "len"),
+									"");
+			v_newoff = LLVMBuildAdd(b, v_newoff,
+									LLVMConstInt(TypeSizeT, 1, false), "");
+		}
+		LLVMBuildStore(b, v_newoff, v_offp);
+		LLVMBuildBr(b, b_next);
+
+		/* is the offset of the next attribute still known? */
+		if (known_off >= 0 && att->attlen > 0 && att->attnotnull)
+			known_off = att_align_nominal(known_off, att->attalign) +
+				att->attlen;
+		else
+			known_off = -1;
+	}
+
+	/*
+	 * Remember how far we got.  The offsets we used can't be cached in the
+	 * descriptor, so if more attributes are needed later slot_deform_tuple
+	 * is told to take the slow path.
+	 */
+	LLVMPositionBuilderAtEnd(b, b_out);
+	LLVMBuildStore(b, LLVMConstInt(TypeInt32, natts, false),
+				   l_field_ptr(b, v_slot, offsetof(TupleTableSlot, tts_nvalid),
+							   TypeInt32));
+	LLVMBuildStore(b, LLVMBuildLoad2(b, TypeSizeT, v_offp, ""),
+				   l_field_ptr(b, v_slot, offsetof(TupleTableSlot, tts_off),
+							   LLVMIntType(sizeof(long) * BITS_PER_BYTE)));
+	LLVMBuildStore(b, LLVMConstInt(TypeStorageBool, 1, false),
+				   l_field_ptr(b, v_slot, offsetof(TupleTableSlot, tts_slow),
+							   TypeStorageBool));
+	LLVMBuildRetVoid(b);
+
+	LLVMDisposeBuilder(b);
+	pfree(attstartblocks);
+
+	INSTR_TIME_SET_CURRENT(endtime);
+	INSTR_TIME_ACCUM_DIFF(context->base.instr.generation_counter,
+						  endtime, starttime);
+
+	oldcontext = MemoryContextSwitchTo(TopMemoryContext);
+	df = (LLVMJitDeformFunction *) palloc(sizeof(LLVMJitDeformFunction));
+	df->desc = desc;
+	df->natts = natts;
+	df->addr = llvm_compile_module(context, mod, funcname);
+	context->deform_functions = lappend(context->deform_functions, df);
+	MemoryContextSwitchTo(oldcontext);
+
+	pfree(funcname);
+
+	return df->addr;
+}
+
+/*
+ * Round the offset up as required by the given alignment, cf.
+ * att_align_nominal.
+ */
+static LLVMValueRef
+l_align(LLVMBuilderRef b, LLVMValueRef v_off, char attalign)
+{
+	int			alignto;
+
+	switch (attalign)
+	{
+		case 'i':
+			alignto = ALIGNOF_INT;
+			break;
+		case 'c':
+			alignto = 1;
+			break;
+		case 'd':
+			alignto = ALIGNOF_DOUBLE;
+			break;
+		case 's':
+			alignto = ALIGNOF_SHORT;
+			break;
+		default:
+			elog(ERROR, "unknown alignment: %c", attalign);
+			alignto = 0;		/* keep compiler quiet */
+	}
+
+	if (alignto == 1)
+		return v_off;
+
+	/* (off + alignto - 1) & ~(alignto - 1) */
+	return LLVMBuildAnd(b,
+						LLVMBuildAdd(b, v_off,
+									 LLVMConstInt(TypeSizeT, alignto - 1,
+												  false),
+									 ""),
+						LLVMConstInt(TypeSizeT, ~((uint64) alignto - 1),
+									 false),
+						"aligned");
+}
+
+/* VARSIZE_ANY as a function, to be called from generated code */
+static size_t
+llvm_varsize_any(void *ptr)
+{
+	return VARSIZE_ANY(ptr);
+}
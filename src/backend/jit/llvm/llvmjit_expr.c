@@ -0,0 +1,618 @@
+/*-------------------------------------------------------------------------
+ *
+ * llvmjit_expr.c
+ *	  JIT compile flattened expressions.
+ *
+ * The steps of an ExprEvalProgram (see executor/execExpr.h) are turned into
+ * straight-line code, one basic block per step.  Since the program lives in
+ * per-query memory for the rest of the query, the addresses of steps, of the
+ * locations results are stored to and of function call structs can all be
+ * embedded as constants.  Scalar Vars are read directly from the slot's
+ * arrays, after the slot has been deformed far enough for all Vars of the
+ * expression, using a deforming function generated for the slot's
+ * descriptor if tuple deforming is JITed as well.  The more complex steps
+ * call the same helper functions as the interpreter in execQual.c.
+ *
+ * Portions Copyright (c) 1996-2015, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *	  src/backend/jit/llvm/llvmjit_expr.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "executor/execExpr.h"
+#include "executor/executor.h"
+#include "jit/llvmjit.h"
+#include "portability/instr_time.h"
+
+
+static LLVMValueRef l_datum_to_bool(LLVMBuilderRef b, LLVMValueRef v_datum);
+static LLVMValueRef l_bool_to_datum(LLVMBuilderRef b, LLVMValueRef v_bool);
+
+
+/*
+ * JIT compile the flattened program of an expression, and install the
+ * result as the ExprState's evalfunc.
+ *
+ * This is called from ExecFlattenExpr, i.e. on the expression's first
+ * evaluation, so the slots the expression's Vars refer to can be examined.
+ * Returns false, leaving the interpreter in place, if some slot isn't there
+ * yet.
+ */
+bool
+llvm_compile_expr(ExprState *state, ExprContext *econtext)
+{
+	ExprEvalProgram *prog = state->evalprog;
+	EState	   *estate = econtext->ecxt_estate;
+	LLVMJitContext *context;
+	TupleTableSlot *slots[3];
+	int			slotoffs[3];
+	int			slotnatts[3];
+	void	   *deformfuncs[3];
+	char	   *funcname;
+	instr_time	starttime;
+	instr_time	endtime;
+	LLVMModuleRef mod;
+	LLVMBuilderRef b;
+	LLVMTypeRef param_types[4];
+	LLVMTypeRef eval_sig;
+	LLVMTypeRef step_sig;
+	LLVMTypeRef deform_sig;
+	LLVMTypeRef getsomeattrs_sig;
+	LLVMTypeRef getattr_sig;
+	LLVMTypeRef pgfunc_sig;
+	LLVMValueRef v_eval_fn;
+	LLVMValueRef v_econtext;
+	LLVMValueRef v_isnullp;
+	LLVMValueRef v_isdonep;
+	LLVMBasicBlockRef b_entry;
+	LLVMBasicBlockRef b_setdone;
+	LLVMBasicBlockRef *opblocks;
+	int			i;
+
+	slots[0] = econtext->ecxt_innertuple;
+	slots[1] = econtext->ecxt_outertuple;
+	slots[2] = econtext->ecxt_scantuple;
+	slotoffs[0] = offsetof(ExprContext, ecxt_innertuple);
+	slotoffs[1] = offsetof(ExprContext, ecxt_outertuple);
+	slotoffs[2] = offsetof(ExprContext, ecxt_scantuple);
+	memset(slotnatts, 0, sizeof(slotnatts));
+	memset(deformfuncs, 0, sizeof(deformfuncs));
+
+	/*
+	 * Make the checks the interpreter does on the first evaluation of each
+	 * Var now, and find out how many attributes of each slot are needed.
+	 */
+	for (i = 0; i < prog->nsteps; i++)
+	{
+		ExprEvalStep *op = &prog->steps[i];
+		int			slotno;
+
+		switch (op->opcode)
+		{
+			case EEOP_INNER_VAR_FIRST:
+			case EEOP_INNER_VAR:
+				slotno = 0;
+				break;
+			case EEOP_OUTER_VAR_FIRST:
+			case EEOP_OUTER_VAR:
+				slotno = 1;
+				break;
+			case EEOP_SCAN_VAR_FIRST:
+			case EEOP_SCAN_VAR:
+				slotno = 2;
+				break;
+			default:
+				continue;
+		}
+
+		if (slots[slotno] == NULL)
+			return false;
+
+		CheckVarSlotCompatibility(slots[slotno], op->d.var.attnum,
+								  op->d.var.vartype);
+		slotnatts[slotno] = Max(slotnatts[slotno], op->d.var.attnum);
+	}
+
+	if (estate->es_jit == NULL)
+		estate->es_jit = &llvm_create_context(estate->es_jit_flags)->base;
+	context = (LLVMJitContext *) estate->es_jit;
+
+	if (context->base.flags & PGJIT_DEFORM)
+	{
+		for (i = 0; i < 3; i++)
+		{
+			if (slotnatts[i] > 0)
+				deformfuncs[i] =
+					llvm_compile_deform(context,
+										slots[i]->tts_tupleDescriptor,
+										slotnatts[i]);
+		}
+	}
+
+	funcname = llvm_expand_funcname(context, "evalexpr");
+
+	INSTR_TIME_SET_CURRENT(starttime);
+
+	mod = llvm_create_module(context);
+	b = LLVMCreateBuilder();
+
+	param_types[0] = TypePtr;
+	param_types[1] = TypePtr;
+	param_types[2] = TypePtr;
+	param_types[3] = TypePtr;
+	eval_sig = LLVMFunctionType(TypeDatum, param_types, 4, false);
+	step_sig = LLVMFunctionType(LLVMVoidType(), param_types, 2, false);
+	deform_sig = LLVMFunctionType(LLVMVoidType(), param_types, 1, false);
+	pgfunc_sig = LLVMFunctionType(TypeDatum, param_types, 1, false);
+	param_types[1] = TypeInt32;
+	getsomeattrs_sig = LLVMFunctionType(LLVMVoidType(), param_types, 2,
+										false);
+	getattr_sig = LLVMFunctionType(TypeDatum, param_types, 3, false);
+
+	v_eval_fn = LLVMAddFunction(mod, funcname, eval_sig);
+	v_econtext = LLVMGetParam(v_eval_fn, 1);
+	v_isnullp = LLVMGetParam(v_eval_fn, 2);
+	v_isdonep = LLVMGetParam(v_eval_fn, 3);
+
+	b_entry = LLVMAppendBasicBlock(v_eval_fn, "entry");
+	b_setdone = LLVMAppendBasicBlock(v_eval_fn, "setdone");
+	opblocks = (LLVMBasicBlockRef *)
+		palloc(sizeof(LLVMBasicBlockRef) * prog->nsteps);
+	for (i = 0; i < prog->nsteps; i++)
+		opblocks[i] = LLVMAppendBasicBlock(v_eval_fn, "op");
+
+	/* if (isDone) *isDone = ExprSingleResult */
+	LLVMPositionBuilderAtEnd(b, b_entry);
+	LLVMBuildCondBr(b, LLVMBuildIsNull(b, v_isdonep, ""),
+					opblocks[0], b_setdone);
+	LLVMPositionBuilderAtEnd(b, b_setdone);
+	LLVMBuildStore(b, LLVMConstInt(TypeInt32, ExprSingleResult, false),
+				   LLVMBuildBitCast(b, v_isdonep,
+									LLVMPointerType(TypeInt32, 0), ""));
+	LLVMBuildBr(b, opblocks[0]);
+
+	for (i = 0; i < prog->nsteps; i++)
+	{
+		ExprEvalStep *op = &prog->steps[i];
+		LLVMValueRef v_resvaluep;
+		LLVMValueRef v_resnullp;
+		LLVMValueRef v_op;
+		LLVMValueRef v_args[3];
+
+		LLVMPositionBuilderAtEnd(b, opblocks[i]);
+
+		v_resvaluep = l_ptr_const(op->resvalue, LLVMPointerType(TypeDatum, 0));
+		v_resnullp = l_ptr_const(op->resnull,
+								 LLVMPointerType(TypeStorageBool, 0));
+		v_op = l_ptr_const(op, TypePtr);
+
+		switch (op->opcode)
+		{
+			case EEOP_DONE:
+				{
+					LLVMValueRef v_value;
+					LLVMValueRef v_null;
+
+					v_value = LLVMBuildLoad2(b, TypeDatum,
+											 l_ptr_const(&prog->resvalue,
+											LLVMPointerType(TypeDatum, 0)),
+											 "");
+					v_null = LLVMBuildLoad2(b, TypeStorageBool,
+											l_ptr_const(&prog->resnull,
+									   LLVMPointerType(TypeStorageBool, 0)),
+											"");
+					LLVMBuildStore(b, v_null,
+								   LLVMBuildBitCast(b, v_isnullp,
+								   LLVMPointerType(TypeStorageBool, 0), ""));
+					LLVMBuildRet(b, v_value);
+					break;
+				}
+
+			case EEOP_INNER_VAR_FIRST:
+			case EEOP_INNER_VAR:
+			case EEOP_OUTER_VAR_FIRST:
+			case EEOP_OUTER_VAR:
+			case EEOP_SCAN_VAR_FIRST:
+			case EEOP_SCAN_VAR:
+				{
+					AttrNumber	attnum = op->d.var.attnum;
+					int			slotno;
+					LLVMValueRef v_slot;
+
+					if (op->opcode == EEOP_INNER_VAR_FIRST ||
+						op->opcode == EEOP_INNER_VAR)
+						slotno = 0;
+					else if (op->opcode == EEOP_OUTER_VAR_FIRST ||
+							 op->opcode == EEOP_OUTER_VAR)
+						slotno = 1;
+					else
+						slotno = 2;
+
+					v_slot = l_load_field(b, v_econtext, slotoffs[slotno],
+										  TypePtr, "slot");
+
+					if (attnum <= 0)
+					{
+						/* system attribute, leave it to slot_getattr */
+						v_args[0] = v_slot;
+						v_args[1] = LLVMConstInt(TypeInt32, attnum, true);
+						v_args[2] = LLVMBuildBitCast(b, v_resnullp, TypePtr,
+													 "");
+						LLVMBuildStore(b,
+									   l_call_ptr(b, slot_getattr, getattr_sig,
+												  v_args, 3, ""),
+									   v_resvaluep);
+					}
+					else
+					{
+						LLVMBasicBlockRef b_deform;
+						LLVMBasicBlockRef b_fetch;
+						LLVMValueRef v_nvalid;
+						LLVMValueRef v_values;
+						LLVMValueRef v_nulls;
+						LLVMValueRef v_idx;
+
+						b_deform = LLVMInsertBasicBlock(opblocks[i], "deform");
+						LLVMMoveBasicBlockAfter(b_deform, opblocks[i]);
+						b_fetch = LLVMInsertBasicBlock(opblocks[i], "fetch");
+						LLVMMoveBasicBlockAfter(b_fetch, b_deform);
+
+						/*
+						 * Deform the slot for all Vars of this expression
+						 * unless it's been done far enough for this one.
+						 */
+						v_nvalid = l_load_field(b, v_slot,
+										  offsetof(TupleTableSlot, tts_nvalid),
+												TypeInt32, "nvalid");
+						LLVMBuildCondBr(b,
+										LLVMBuildICmp(b, LLVMIntSGE, v_nvalid,
+											 LLVMConstInt(TypeInt32, attnum,
+														  false), ""),
+										b_fetch, b_deform);
+
+						LLVMPositionBuilderAtEnd(b, b_deform);
+						if (deformfuncs[slotno])
+							l_call_ptr(b, deformfuncs[slotno], deform_sig,
+									   &v_slot, 1, "");
+						else
+						{
+							v_args[0] = v_slot;
+							v_args[1] = LLVMConstInt(TypeInt32,
+													 slotnatts[slotno], false);
+							l_call_ptr(b, slot_getsomeattrs, getsomeattrs_sig,
+									   v_args, 2, "");
+						}
+						LLVMBuildBr(b, b_fetch);
+
+						LLVMPositionBuilderAtEnd(b, b_fetch);
+						v_values = l_load_field(b, v_slot,
+										  offsetof(TupleTableSlot, tts_values),
+											  LLVMPointerType(TypeDatum, 0),
+												"values");
+						v_nulls = l_load_field(b, v_slot,
+										  offsetof(TupleTableSlot, tts_isnull),
+										LLVMPointerType(TypeStorageBool, 0),
+											   "nulls");
+						v_idx = LLVMConstInt(TypeSizeT, attnum - 1, false);
+						LLVMBuildStore(b,
+									   LLVMBuildLoad2(b, TypeDatum,
+											  LLVMBuildGEP2(b, TypeDatum,
+															v_values, &v_idx,
+															1, ""),
+													  ""),
+									   v_resvaluep);
+						LLVMBuildStore(b,
+									   LLVMBuildLoad2(b, TypeStorageBool,
+											  LLVMBuildGEP2(b, TypeStorageBool,
+															v_nulls, &v_idx,
+															1, ""),
+													  ""),
+									   v_resnullp);
+					}
+					LLVMBuildBr(b, opblocks[i + 1]);
+					break;
+				}
+
+			case EEOP_CONST:
+				LLVMBuildStore(b,
+							   LLVMConstInt(TypeDatum, op->d.constval.value,
+											false),
+							   v_resvaluep);
+				LLVMBuildStore(b,
+							   LLVMConstInt(TypeStorageBool,
+											op->d.constval.isnull, false),
+							   v_resnullp);
+				LLVMBuildBr(b, opblocks[i + 1]);
+				break;
+
+			case EEOP_PARAM_EXEC:
+				v_args[0] = v_op;
+				v_args[1] = v_econtext;
+				l_call_ptr(b, ExecEvalStepParamExec, step_sig, v_args, 2, "");
+				LLVMBuildBr(b, opblocks[i + 1]);
+				break;
+
+			case EEOP_FUNCEXPR:
+			case EEOP_FUNCEXPR_STRICT:
+			case EEOP_FUNCEXPR_FUSAGE:
+			case EEOP_FUNCEXPR_STRICT_FUSAGE:
+				{
+					FunctionCallInfo fcinfo = op->d.func.fcinfo;
+					LLVMValueRef v_fcinfo = l_ptr_const(fcinfo, TypePtr);
+					LLVMValueRef v_fcinfo_isnullp;
+
+					if (op->opcode == EEOP_FUNCEXPR_STRICT ||
+						op->opcode == EEOP_FUNCEXPR_STRICT_FUSAGE)
+					{
+						LLVMBasicBlockRef b_nullresult;
+						LLVMBasicBlockRef b_call;
+						int			argno;
+
+						b_nullresult = LLVMInsertBasicBlock(opblocks[i],
+															"nullresult");
+						LLVMMoveBasicBlockAfter(b_nullresult, opblocks[i]);
+
+						/* a NULL argument gives a NULL result */
+						for (argno = 0; argno < op->d.func.nargs; argno++)
+						{
+							LLVMValueRef v_argnull;
+
+							b_call = LLVMInsertBasicBlock(b_nullresult,
+														  "checkarg");
+							v_argnull = LLVMBuildLoad2(b, TypeStorageBool,
+										  l_ptr_const(&fcinfo->argnull[argno],
+										LLVMPointerType(TypeStorageBool, 0)),
+													   "argnull");
+							LLVMBuildCondBr(b,
+											LLVMBuildICmp(b, LLVMIntNE,
+														  v_argnull,
+											LLVMConstInt(TypeStorageBool, 0,
+														 false), ""),
+											b_nullresult, b_call);
+							LLVMPositionBuilderAtEnd(b, b_call);
+						}
+
+						/* the call itself is emitted below */
+						b_call = LLVMGetInsertBlock(b);
+
+						LLVMPositionBuilderAtEnd(b, b_nullresult);
+						LLVMBuildStore(b, LLVMConstInt(TypeDatum, 0, false),
+									   v_resvaluep);
+						LLVMBuildStore(b, LLVMConstInt(TypeStorageBool, 1,
+													   false),
+									   v_resnullp);
+						LLVMBuildBr(b, opblocks[i + 1]);
+
+						LLVMPositionBuilderAtEnd(b, b_call);
+					}
+
+					if (op->opcode == EEOP_FUNCEXPR_FUSAGE ||
+						op->opcode == EEOP_FUNCEXPR_STRICT_FUSAGE)
+					{
+						v_args[0] = v_op;
+						v_args[1] = v_econtext;
+						l_call_ptr(b, ExecEvalStepFuncUsage, step_sig,
+								   v_args, 2, "");
+					}
+					else
+					{
+						/* call the function directly, cf. FunctionCallInvoke */
+						v_fcinfo_isnullp = l_field_ptr(b, v_fcinfo,
+									  offsetof(FunctionCallInfoData, isnull),
+													   TypeStorageBool);
+						LLVMBuildStore(b, LLVMConstInt(TypeStorageBool, 0,
+													   false),
+									   v_fcinfo_isnullp);
+						LLVMBuildStore(b,
+									   l_call_ptr(b, op->d.func.fn_addr,
+												  pgfunc_sig, &v_fcinfo, 1,
+												  "funcresult"),
+									   v_resvaluep);
+						LLVMBuildStore(b,
+									   LLVMBuildLoad2(b, TypeStorageBool,
+													  v_fcinfo_isnullp, ""),
+									   v_resnullp);
+					}
+					LLVMBuildBr(b, opblocks[i + 1]);
+					break;
+				}
+
+			case EEOP_BOOL_AND_STEP_FIRST:
+			case EEOP_BOOL_AND_STEP:
+			case EEOP_BOOL_AND_STEP_LAST:
+			case EEOP_BOOL_OR_STEP_FIRST:
+			case EEOP_BOOL_OR_STEP:
+			case EEOP_BOOL_OR_STEP_LAST:
+				{
+					bool		isand;
+					bool		islast;
+					LLVMValueRef v_anynullp;
+					LLVMBasicBlockRef b_isnull;
+					LLVMBasicBlockRef b_notnull;
+					LLVMValueRef v_decided;
+
+					isand = (op->opcode == EEOP_BOOL_AND_STEP_FIRST ||
+							 op->opcode == EEOP_BOOL_AND_STEP ||
+							 op->opcode == EEOP_BOOL_AND_STEP_LAST);
+					islast = (op->opcode == EEOP_BOOL_AND_STEP_LAST ||
+							  op->opcode == EEOP_BOOL_OR_STEP_LAST);
+					v_anynullp = l_ptr_const(op->d.boolexpr.anynull,
+										LLVMPointerType(TypeStorageBool, 0));
+
+					b_isnull = LLVMInsertBasicBlock(opblocks[i], "isnull");
+					LLVMMoveBasicBlockAfter(b_isnull, opblocks[i]);
+					b_notnull = LLVMInsertBasicBlock(opblocks[i], "notnull");
+					LLVMMoveBasicBlockAfter(b_notnull, b_isnull);
+
+					if (op->opcode == EEOP_BOOL_AND_STEP_FIRST ||
+						op->opcode == EEOP_BOOL_OR_STEP_FIRST)
+						LLVMBuildStore(b, LLVMConstInt(TypeStorageBool, 0,
+													   false),
+									   v_anynullp);
+
+					LLVMBuildCondBr(b,
+									LLVMBuildICmp(b, LLVMIntNE,
+											  LLVMBuildLoad2(b, TypeStorageBool,
+															 v_resnullp, ""),
+											LLVMConstInt(TypeStorageBool, 0,
+														 false), ""),
+									b_isnull, b_notnull);
+
+					/*
+					 * A NULL argument is remembered; for the last argument
+					 * the result is already NULL then.
+					 */
+					LLVMPositionBuilderAtEnd(b, b_isnull);
+					if (!islast)
+						LLVMBuildStore(b, LLVMConstInt(TypeStorageBool, 1,
+													   false),
+									   v_anynullp);
+					LLVMBuildBr(b, opblocks[i + 1]);
+
+					/*
+					 * FALSE decides an AND, TRUE an OR.  Otherwise, after
+					 * the last argument, the result is NULL if any argument
+					 * was.
+					 */
+					LLVMPositionBuilderAtEnd(b, b_notnull);
+					v_decided = l_datum_to_bool(b,
+												LLVMBuildLoad2(b, TypeDatum,
+															   v_resvaluep,
+															   ""));
+					if (isand)
+						v_decided = LLVMBuildNot(b, v_decided, "");
+
+					if (!islast)
+						LLVMBuildCondBr(b, v_decided,
+										opblocks[op->d.boolexpr.jumpdone],
+										opblocks[i + 1]);
+					else
+					{
+						LLVMBasicBlockRef b_checkanynull;
+						LLVMBasicBlockRef b_setnull;
+
+						b_checkanynull = LLVMInsertBasicBlock(opblocks[i + 1],
+															  "checkanynull");
+						b_setnull = LLVMInsertBasicBlock(opblocks[i + 1],
+														 "setnull");
+
+						LLVMBuildCondBr(b, v_decided,
+										opblocks[op->d.boolexpr.jumpdone],
+										b_checkanynull);
+
+						LLVMPositionBuilderAtEnd(b, b_checkanynull);
+						LLVMBuildCondBr(b,
+										LLVMBuildICmp(b, LLVMIntNE,
+											  LLVMBuildLoad2(b, TypeStorageBool,
+															 v_anynullp, ""),
+											LLVMConstInt(TypeStorageBool, 0,
+														 false), ""),
+										b_setnull, opblocks[i + 1]);
+
+						LLVMPositionBuilderAtEnd(b, b_setnull);
+						LLVMBuildStore(b, LLVMConstInt(TypeDatum, 0, false),
+									   v_resvaluep);
+						LLVMBuildStore(b, LLVMConstInt(TypeStorageBool, 1,
+													   false),
+									   v_resnullp);
+						LLVMBuildBr(b, opblocks[i + 1]);
+					}
+					break;
+				}
+
+			case EEOP_BOOL_NOT:
+				{
+					LLVMBasicBlockRef b_notnull;
+					LLVMValueRef v_value;
+
+					b_notnull = LLVMInsertBasicBlock(opblocks[i + 1],
+													 "notnull");
+
+					/* a NULL argument gives a NULL result */
+					LLVMBuildCondBr(b,
+									LLVMBuildICmp(b, LLVMIntNE,
+											  LLVMBuildLoad2(b, TypeStorageBool,
+															 v_resnullp, ""),
+											LLVMConstInt(TypeStorageBool, 0,
+														 false), ""),
+									opblocks[i + 1], b_notnull);
+
+					LLVMPositionBuilderAtEnd(b, b_notnull);
+					v_value = l_datum_to_bool(b,
+											  LLVMBuildLoad2(b, TypeDatum,
+															 v_resvaluep, ""));
+					LLVMBuildStore(b,
+								   l_bool_to_datum(b,
+												   LLVMBuildNot(b, v_value,
+																"")),
+								   v_resvaluep);
+					LLVMBuildBr(b, opblocks[i + 1]);
+					break;
+				}
+
+			case EEOP_NULLTEST_ISNULL:
+			case EEOP_NULLTEST_ISNOTNULL:
+				{
+					LLVMValueRef v_isnull;
+
+					v_isnull = LLVMBuildICmp(b,
+									 op->opcode == EEOP_NULLTEST_ISNULL ?
+											 LLVMIntNE : LLVMIntEQ,
+											 LLVMBuildLoad2(b, TypeStorageBool,
+															v_resnullp, ""),
+											 LLVMConstInt(TypeStorageBool, 0,
+														  false), "");
+					LLVMBuildStore(b, l_bool_to_datum(b, v_isnull),
+								   v_resvaluep);
+					LLVMBuildStore(b, LLVMConstInt(TypeStorageBool, 0, false),
+								   v_resnullp);
+					LLVMBuildBr(b, opblocks[i + 1]);
+					break;
+				}
+
+			case EEOP_EXPR:
+				v_args[0] = v_op;
+				v_args[1] = v_econtext;
+				l_call_ptr(b, ExecEvalStepExpr, step_sig, v_args, 2, "");
+				LLVMBuildBr(b, opblocks[i + 1]);
+				break;
+
+			case EEOP_LAST:
+				Assert(false);
+				break;
+		}
+	}
+
+	LLVMDisposeBuilder(b);
+	pfree(opblocks);
+
+	INSTR_TIME_SET_CURRENT(endtime);
+	INSTR_TIME_ACCUM_DIFF(context->base.instr.generation_counter,
+						  endtime, starttime);
+
+	state->evalfunc = (ExprStateEvalFunc)
+		llvm_compile_module(context, mod, funcname);
+
+	pfree(funcname);
+
+	return true;
+}
+
+/* cf. DatumGetBool */
+static LLVMValueRef
+l_datum_to_bool(LLVMBuilderRef b, LLVMValueRef v_datum)
+{
+	return LLVMBuildICmp(b, LLVMIntNE,
+						 LLVMBuildTrunc(b, v_datum, TypeStorageBool, ""),
+						 LLVMConstInt(TypeStorageBool, 0, false), "");
+}
+
+/* cf. BoolGetDatum */
+static LLVMValueRef
+l_bool_to_datum(LLVMBuilderRef b, LLVMValueRef v_bool)
+{
+	return LLVMBuildZExt(b, v_bool, TypeDatum, "");
+}
@@ -15,11 +15,13 @@
 
 #include "postgres.h"
 
+#include <limits.h>
 #include <math.h>
 
 #include "access/sysattr.h"
 #include "catalog/pg_class.h"
 #include "catalog/pg_operator.h"
+#include "catalog/pg_type.h"
 #include "foreign/fdwapi.h"
 #include "nodes/makefuncs.h"
 #include "nodes/nodeFuncs.h"
@@ -69,6 +71,9 @@ static void set_rel_pathlist(PlannerInfo *root, RelOptInfo *rel,
 				 Index rti, RangeTblEntry *rte);
 static void set_plain_rel_size(PlannerInfo *root, RelOptInfo *rel,
 				   RangeTblEntry *rte);
+static bool rel_is_parallel_safe(PlannerInfo *root, RelOptInfo *rel,
+					 RangeTblEntry *rte);
+static void create_parallel_paths(PlannerInfo *root, RelOptInfo *rel);
 static void set_plain_rel_pathlist(PlannerInfo *root, RelOptInfo *rel,
 					   RangeTblEntry *rte);
 static void set_foreign_size(PlannerInfo *root, RelOptInfo *rel,
@@ -391,6 +396,152 @@ set_plain_rel_size(PlannerInfo *root, RelOptInfo *rel, RangeTblEntry *rte)
 	set_baserel_size_estimates(root, rel);
 }
 
+/*
+ * rel_is_parallel_safe
+ *	  Can a scan of this plain relation be run inside parallel workers?
+ *
+ * Workers can't see the leader's local buffers, so temporary tables are out,
+ * and everything evaluated at scan level must be safe to run in a worker.
+ */
+static bool
+rel_is_parallel_safe(PlannerInfo *root, RelOptInfo *rel, RangeTblEntry *rte)
+{
+	ListCell   *lc;
+
+	if (!root->glob->parallelModeOK || root->rowMarks != NIL)
+		return false;
+	if (rte->relkind != RELKIND_RELATION ||
+		get_rel_persistence(rte->relid) == RELPERSISTENCE_TEMP)
+		return false;
+
+	foreach(lc, rel->baserestrictinfo)
+	{
+		RestrictInfo *rinfo = (RestrictInfo *) lfirst(lc);
+
+		if (has_parallel_hazard((Node *) rinfo->clause))
+			return false;
+	}
+
+	/*
+	 * Tuples travel from the workers as minimal tuples, which can't carry
+	 * the typmod registrations that anonymous record types rely on.
+	 */
+	foreach(lc, rel->reltargetlist)
+	{
+		Node	   *expr = (Node *) lfirst(lc);
+
+		if (exprType(expr) == RECORDOID || has_parallel_hazard(expr))
+			return false;
+	}
+
+	return true;
+}
+
+/*
+ * pathkeys_parallel_safe
+ *	  Can the participants of a Gather sort the relation by these pathkeys?
+ *
+ * Each sort key must be computable from the relation's own columns.  As
+ * with the target list, whatever the sort might evaluate must be safe to run
+ * in a worker, and anonymous records can't travel between backends.
+ */
+static bool
+pathkeys_parallel_safe(RelOptInfo *rel, List *pathkeys)
+{
+	ListCell   *lc;
+
+	foreach(lc, pathkeys)
+	{
+		PathKey    *pathkey = (PathKey *) lfirst(lc);
+		EquivalenceClass *ec = pathkey->pk_eclass;
+		bool		found = false;
+		ListCell   *lc2;
+
+		if (ec->ec_has_volatile)
+			return false;
+
+		foreach(lc2, ec->ec_members)
+		{
+			EquivalenceMember *em = (EquivalenceMember *) lfirst(lc2);
+			Node	   *expr = (Node *) em->em_expr;
+
+			if (em->em_is_const || em->em_is_child ||
+				!bms_is_subset(em->em_relids, rel->relids))
+				continue;
+			if (exprType(expr) == RECORDOID ||
+				contain_agg_clause(expr) ||
+				contain_window_function(expr) ||
+				has_parallel_hazard(expr))
+				return false;
+			found = true;
+		}
+
+		if (!found)
+			return false;
+	}
+
+	return true;
+}
+
+/*
+ * create_parallel_paths
+ *	  Build a Gather path over a parallel sequential scan of the relation
+ *
+ * If the relation is all the query scans, also consider having the workers
+ * sort it into the order the query wants.
+ */
+static void
+create_parallel_paths(PlannerInfo *root, RelOptInfo *rel)
+{
+	int			parallel_degree = compute_parallel_degree(rel->pages);
+
+	if (parallel_degree <= 0)
+		return;
+
+	add_path(rel, (Path *)
+			 create_gather_path(root, rel,
+								create_seqscan_path(root, rel, NULL),
+								parallel_degree, NIL));
+
+	if (root->query_pathkeys != NIL &&
+		rel->reloptkind == RELOPT_BASEREL &&
+		bms_equal(rel->relids, root->all_baserels) &&
+		pathkeys_parallel_safe(rel, root->query_pathkeys))
+		add_path(rel, (Path *)
+				 create_gather_path(root, rel,
+									create_seqscan_path(root, rel, NULL),
+									parallel_degree, root->query_pathkeys));
+}
+
+/*
+ * compute_parallel_degree
+ *	  Decide how many workers should scan a relation of the given size
+ *
+ * The number of workers grows with the logarithm (base 3) of the relation
+ * size: one worker at min_parallel_relation_size, one more each time the
+ * relation triples, capped at max_parallel_degree.  Returns 0 if the
+ * relation is too small to be worth scanning in parallel.
+ */
+int
+compute_parallel_degree(BlockNumber pages)
+{
+	int			parallel_threshold = Max(min_parallel_relation_size, 1);
+	int			parallel_degree = 1;
+
+	if (max_parallel_degree <= 0 || pages < (BlockNumber) parallel_threshold)
+		return 0;
+
+	while (parallel_degree < max_parallel_degree &&
+		   parallel_threshold <= INT_MAX / 3 &&
+		   pages >= (BlockNumber) (parallel_threshold * 3))
+	{
+		parallel_degree++;
+		parallel_threshold *= 3;
+	}
+
+	return parallel_degree;
+}
+
 /*
  * set_plain_rel_pathlist
  *	  Build access paths for a plain relation (no subquery, no inheritance)
@@ -410,6 +561,16 @@ set_plain_rel_pathlist(PlannerInfo *root, RelOptInfo *rel, RangeTblEntry *rte)
 	/* Consider sequential scan */
 	add_path(rel, create_seqscan_path(root, rel, required_outer));
 
+	/*
+	 * Consider a parallel sequential scan under a Gather node.  Joins of the
+	 * rel may also be done in parallel, if it can be scanned that way.
+	 */
+	if (required_outer == NULL && rel_is_parallel_safe(root, rel, rte))
+	{
+		rel->consider_parallel = true;
+		create_parallel_paths(root, rel);
+	}
+
 	/* Consider index scans */
 	create_index_paths(root, rel);
 
@@ -1241,6 +1402,7 @@ set_subquery_pathlist(PlannerInfo *root, RelOptInfo *rel,
 	 */
 	if (parse->hasAggs ||
 		parse->groupClause ||
+		parse->groupingSets ||
 		parse->havingQual ||
 		parse->distinctClause ||
 		parse->sortClause ||
@@ -2099,7 +2261,8 @@ subquery_push_qual(Query *subquery, RangeTblEntry *rte, Index rti, Node *qual)
 		 * subquery uses grouping or aggregation, put it in HAVING (since the
 		 * qual really refers to the group-result rows).
 		 */
-		if (subquery->hasAggs || subquery->groupClause || subquery->havingQual)
+		if (subquery->hasAggs || subquery->groupClause ||
+			subquery->groupingSets || subquery->havingQual)
 			subquery->havingQual = make_and_qual(subquery->havingQual, qual);
 		else
 			subquery->jointree->quals =
@@ -2348,6 +2511,10 @@ print_path(PlannerInfo *root, Path *path, int indent)
 			ptype = "Unique";
 			subpath = ((UniquePath *) path)->subpath;
 			break;
+		case T_GatherPath:
+			ptype = "Gather";
+			subpath = ((GatherPath *) path)->subpath;
+			break;
 		case T_NestPath:
 			ptype = "NestLoop";
 			join = true;
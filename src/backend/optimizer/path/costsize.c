@@ -75,6 +75,7 @@
 
 #include "access/htup_details.h"
 #include "executor/executor.h"
+#include "executor/nodeAgg.h"
 #include "executor/nodeHash.h"
 #include "miscadmin.h"
 #include "nodes/nodeFuncs.h"
@@ -101,6 +102,8 @@ double		random_page_cost = DEFAULT_RANDOM_PAGE_COST;
 double		cpu_tuple_cost = DEFAULT_CPU_TUPLE_COST;
 double		cpu_index_tuple_cost = DEFAULT_CPU_INDEX_TUPLE_COST;
 double		cpu_operator_cost = DEFAULT_CPU_OPERATOR_COST;
+double		parallel_tuple_cost = DEFAULT_PARALLEL_TUPLE_COST;
+double		parallel_setup_cost = DEFAULT_PARALLEL_SETUP_COST;
 
 int			effective_cache_size = DEFAULT_EFFECTIVE_CACHE_SIZE;
 
@@ -118,6 +121,9 @@ bool		enable_material = true;
 bool		enable_mergejoin = true;
 bool		enable_hashjoin = true;
 
+int			max_parallel_degree = 0;
+int			min_parallel_relation_size = 1024;		/* in blocks */
+
 typedef struct
 {
 	PlannerInfo *root;
@@ -144,6 +150,7 @@ static double calc_joinrel_size_estimate(PlannerInfo *root,
 static void set_rel_width(PlannerInfo *root, RelOptInfo *rel);
 static double relation_byte_size(double tuples, int width);
 static double page_size(double tuples, int width);
+static Cost seqscan_disk_cost(RelOptInfo *baserel);
 
 
 /*
@@ -1397,6 +1404,121 @@ cost_merge_append(Path *path, PlannerInfo *root,
 	path->total_cost = startup_cost + run_cost + input_total_cost;
 }
 
+/*
+ * cost_gather
+ *	  Determines and returns the cost of scanning a relation sequentially
+ *	  with the help of parallel workers.
+ *
+ * The subpath is an ordinary sequential scan of the whole relation, costed
+ * by cost_seqscan.  Its disk cost stays the same, since the participants
+ * share the I/O bandwidth, but its CPU cost is divided among them.  The
+ * master's share of the scan shrinks as the workers grow in number, since
+ * it also has to read their output; beyond three workers or so, we assume
+ * the master does nothing but that.  On top of this we charge for starting
+ * the workers, and for passing each tuple through a queue.
+ *
+ * If the path has pathkeys, each participant instead sorts its share of the
+ * tuples and writes the result to a temporary file, and nothing goes through
+ * the queues.  The master then reads all the files back and merges them,
+ * much as a MergeAppend does, before it can return the first tuple.
+ *
+ * The subpath may also be a hash join of two such scans.  Then the building
+ * of the shared hash table is divided among the participants as well, but
+ * not the reading of the inner relation from disk.
+ */
+void
+cost_gather(GatherPath *path, PlannerInfo *root, RelOptInfo *baserel)
+{
+	Path	   *subpath = path->subpath;
+	double		spc_seq_page_cost;
+	double		parallel_divisor;
+	double		leader_contribution;
+	Cost		disk_run_cost;
+	Cost		cpu_run_cost;
+	Path		sort_path;
+	double		npages;
+	double		logN;
+	Cost		comparison_cost;
+
+	path->path.rows = subpath->rows;
+
+	parallel_divisor = path->num_workers;
+	leader_contribution = 1.0 - (0.3 * path->num_workers);
+	if (leader_contribution > 0)
+		parallel_divisor += leader_contribution;
+
+	if (IsA(subpath, HashPath))
+	{
+		JoinPath   *jpath = (JoinPath *) subpath;
+		Cost		inner_disk_cost;
+
+		inner_disk_cost = seqscan_disk_cost(jpath->innerjoinpath->parent);
+		disk_run_cost = seqscan_disk_cost(jpath->outerjoinpath->parent);
+		cpu_run_cost = subpath->total_cost - subpath->startup_cost -
+			disk_run_cost;
+
+		path->path.startup_cost = parallel_setup_cost + inner_disk_cost +
+			(subpath->startup_cost - inner_disk_cost) / parallel_divisor;
+		path->path.total_cost = path->path.startup_cost + disk_run_cost +
+			cpu_run_cost / parallel_divisor +
+			parallel_tuple_cost * path->path.rows;
+		return;
+	}
+
+	/* cost_seqscan charged this much for disk; the rest of its run is CPU */
+	get_tablespace_page_costs(baserel->reltablespace,
+							  NULL,
+							  &spc_seq_page_cost);
+	disk_run_cost = spc_seq_page_cost * baserel->pages;
+	cpu_run_cost = subpath->total_cost - subpath->startup_cost - disk_run_cost;
+
+	path->path.startup_cost = subpath->startup_cost + parallel_setup_cost;
+
+	if (path->path.pathkeys == NIL)
+	{
+		path->path.total_cost = path->path.startup_cost + disk_run_cost +
+			cpu_run_cost / parallel_divisor +
+			parallel_tuple_cost * path->path.rows;
+		return;
+	}
+
+	/* Each participant sorts its share, all at the same time */
+	cost_sort(&sort_path, root, path->path.pathkeys,
+			  0.0, path->path.rows / parallel_divisor, baserel->width,
+			  0.0, work_mem, -1.0);
+
+	/* ... and writes it out, and then the master reads it all back */
+	npages = page_size(path->path.rows, baserel->width);
+
+	/* Merging the participants' runs costs about as much as MergeAppend */
+	logN = LOG2(path->num_workers + 1.0);
+	comparison_cost = 2.0 * cpu_operator_cost;
+
+	path->path.startup_cost += disk_run_cost +
+		cpu_run_cost / parallel_divisor +
+		sort_path.startup_cost +
+		spc_seq_page_cost * npages / parallel_divisor +
+		comparison_cost * (path->num_workers + 1.0) * logN;
+	path->path.total_cost = path->path.startup_cost +
+		spc_seq_page_cost * npages +
+		path->path.rows * (comparison_cost * logN + cpu_operator_cost);
+}
+
+/*
+ * seqscan_disk_cost
+ *	  The disk cost cost_seqscan charges for reading a relation.
+ */
+static Cost
+seqscan_disk_cost(RelOptInfo *baserel)
+{
+	double		spc_seq_page_cost;
+
+	get_tablespace_page_costs(baserel->reltablespace,
+							  NULL,
+							  &spc_seq_page_cost);
+	return spc_seq_page_cost * baserel->pages;
+}
+
 /*
  * cost_material
  *	  Determines and returns the cost of materializing a relation, including
@@ -1546,6 +1668,68 @@ cost_agg(Path *path, PlannerInfo *root,
 	path->total_cost = total_cost;
 }
 
+/*
+ * cost_hashagg_spill
+ *		Adds to the cost of a hashed Agg the I/O of spilling input tuples to
+ *		temporary files, if its hash table is expected to outgrow work_mem.
+ *
+ * aggcosts can be NULL, as for cost_agg.  input_width is the width of the
+ * input tuples, which is both what a group's entry in the hash table stores
+ * and what gets written to the files.
+ */
+void
+cost_hashagg_spill(Path *path, const AggClauseCosts *aggcosts,
+				   double numGroups, double input_tuples, int input_width)
+{
+	double		hashentrysize;
+	double		tablebytes;
+	double		work_mem_bytes = work_mem * 1024.0;
+	double		nbatches;
+	double		depth;
+	double		spilled_tuples;
+	double		npageaccesses;
+	Cost		spill_cost;
+
+	/* Estimate per-hash-entry space at tuple width... */
+	hashentrysize = MAXALIGN(input_width) + MAXALIGN(sizeof(MinimalTupleData));
+	/* plus space for pass-by-ref transition values... */
+	if (aggcosts)
+		hashentrysize += aggcosts->transitionSpace;
+	/* plus the per-hash-entry overhead */
+	hashentrysize += hash_agg_entry_size(aggcosts ? aggcosts->numAggs : 0);
+
+	tablebytes = hashentrysize * numGroups;
+	if (tablebytes <= work_mem_bytes)
+		return;
+
+	/*
+	 * Once the table is full, the input tuples of the groups that didn't
+	 * make it are spread over HASHAGG_NUM_PARTITIONS files, each of which is
+	 * read back later as a new input that may spill again in turn.  With the
+	 * groups evenly spread, each level of that recursion writes the tuples
+	 * of the groups that don't fit in memory, and it takes about
+	 * log(nbatches) levels to the base HASHAGG_NUM_PARTITIONS for every batch
+	 * to fit.  The files are written and read in blocks, so charge them as
+	 * cost_sort charges its runs, as mostly sequential access.
+	 */
+	nbatches = ceil(tablebytes / work_mem_bytes);
+	depth = ceil(log(nbatches) / log((double) HASHAGG_NUM_PARTITIONS));
+	depth = Max(depth, 1.0);
+	spilled_tuples = input_tuples * (1.0 - work_mem_bytes / tablebytes);
+	npageaccesses = 2.0 * page_size(spilled_tuples, input_width) * depth;
+	spill_cost = npageaccesses * (seq_page_cost * 0.75 + random_page_cost * 0.25);
+
+	/* every spilled tuple is also copied out and hashed again, per level */
+	spill_cost += 2.0 * cpu_operator_cost * spilled_tuples * depth;
+
+	/*
+	 * The first files are written before the first group is emitted, but
+	 * reading them back happens while emitting.
+	 */
+	path->startup_cost += spill_cost / 2;
+	path->total_cost += spill_cost;
+}
+
 /*
  * cost_windowagg
  *		Determines and returns the cost of performing a WindowAgg plan node,
@@ -2454,6 +2638,7 @@ initial_cost_hashjoin(PlannerInfo *root, JoinCostWorkspace *workspace,
 	ExecChooseHashTableSize(inner_path_rows,
 							inner_path->parent->width,
 							true,		/* useskew */
+							1,			/* nparticipants */
 							&numbuckets,
 							&numbatches,
 							&num_skew_mcvs);
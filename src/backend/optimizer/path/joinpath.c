@@ -16,7 +16,10 @@
 
 #include <math.h>
 
+#include "catalog/pg_type.h"
 #include "executor/executor.h"
+#include "nodes/nodeFuncs.h"
+#include "optimizer/clauses.h"
 #include "optimizer/cost.h"
 #include "optimizer/pathnode.h"
 #include "optimizer/paths.h"
@@ -42,6 +45,14 @@ static void hash_inner_and_outer(PlannerInfo *root, RelOptInfo *joinrel,
 					 JoinType jointype, SpecialJoinInfo *sjinfo,
 					 SemiAntiJoinFactors *semifactors,
 					 Relids param_source_rels, Relids extra_lateral_rels);
+static void try_parallel_hashjoin_path(PlannerInfo *root,
+						   RelOptInfo *joinrel,
+						   RelOptInfo *outerrel,
+						   RelOptInfo *innerrel,
+						   SpecialJoinInfo *sjinfo,
+						   SemiAntiJoinFactors *semifactors,
+						   List *restrict_clauses,
+						   List *hashclauses);
 static List *select_mergejoin_clauses(PlannerInfo *root,
 						 RelOptInfo *joinrel,
 						 RelOptInfo *outerrel,
@@ -500,6 +511,80 @@ try_hashjoin_path(PlannerInfo *root,
 	}
 }
 
+/*
+ * try_parallel_hashjoin_path
+ *	  Consider a Gather node over an inner hash join of parallel sequential
+ *	  scans of two base relations, which all the participants build one
+ *	  shared hash table for.
+ */
+static void
+try_parallel_hashjoin_path(PlannerInfo *root,
+						   RelOptInfo *joinrel,
+						   RelOptInfo *outerrel,
+						   RelOptInfo *innerrel,
+						   SpecialJoinInfo *sjinfo,
+						   SemiAntiJoinFactors *semifactors,
+						   List *restrict_clauses,
+						   List *hashclauses)
+{
+	JoinCostWorkspace workspace;
+	Path	   *outer_path;
+	Path	   *inner_path;
+	HashPath   *hash_path;
+	int			parallel_degree;
+	ListCell   *lc;
+
+	if (outerrel->reloptkind != RELOPT_BASEREL || !outerrel->consider_parallel ||
+		innerrel->reloptkind != RELOPT_BASEREL || !innerrel->consider_parallel)
+		return;
+
+	/*
+	 * Whatever the join itself evaluates must be safe to run in a worker,
+	 * and as for a scan, its output can't include anonymous records.
+	 */
+	foreach(lc, restrict_clauses)
+	{
+		RestrictInfo *rinfo = (RestrictInfo *) lfirst(lc);
+
+		if (has_parallel_hazard((Node *) rinfo->clause))
+			return;
+	}
+	foreach(lc, joinrel->reltargetlist)
+	{
+		Node	   *expr = (Node *) lfirst(lc);
+
+		if (exprType(expr) == RECORDOID || has_parallel_hazard(expr))
+			return;
+	}
+
+	parallel_degree = compute_parallel_degree(Max(outerrel->pages,
+												  innerrel->pages));
+	if (parallel_degree <= 0)
+		return;
+
+	outer_path = create_seqscan_path(root, outerrel, NULL);
+	inner_path = create_seqscan_path(root, innerrel, NULL);
+
+	initial_cost_hashjoin(root, &workspace, JOIN_INNER, hashclauses,
+						  outer_path, inner_path,
+						  sjinfo, semifactors);
+	hash_path = create_hashjoin_path(root,
+									 joinrel,
+									 JOIN_INNER,
+									 &workspace,
+									 sjinfo,
+									 semifactors,
+									 outer_path,
+									 inner_path,
+									 restrict_clauses,
+									 NULL,
+									 hashclauses);
+
+	add_path(joinrel, (Path *)
+			 create_gather_path(root, joinrel, (Path *) hash_path,
+								parallel_degree, NIL));
+}
+
 /*
  * clause_sides_match_join
  *	  Determine whether a join clause is of the right form to use in this join.
@@ -1343,6 +1428,20 @@ hash_inner_and_outer(PlannerInfo *root,
 									  hashclauses);
 				}
 			}
+
+			/*
+			 * An inner join can also be done by the workers of a Gather
+			 * node, sharing the hash table.
+			 */
+			if (jointype == JOIN_INNER && bms_is_empty(extra_lateral_rels))
+				try_parallel_hashjoin_path(root,
+										   joinrel,
+										   outerrel,
+										   innerrel,
+										   sjinfo,
+										   semifactors,
+										   restrictlist,
+										   hashclauses);
 		}
 	}
 }
@@ -55,6 +55,7 @@ static Plan *create_append_plan(PlannerInfo *root, AppendPath *best_path);
 static Plan *create_merge_append_plan(PlannerInfo *root, MergeAppendPath *best_path);
 static Result *create_result_plan(PlannerInfo *root, ResultPath *best_path);
 static Material *create_material_plan(PlannerInfo *root, MaterialPath *best_path);
+static Gather *create_gather_plan(PlannerInfo *root, GatherPath *best_path);
 static Plan *create_unique_plan(PlannerInfo *root, UniquePath *best_path);
 static SeqScan *create_seqscan_plan(PlannerInfo *root, Path *best_path,
 					List *tlist, List *scan_clauses);
@@ -171,6 +172,7 @@ static EquivalenceMember *find_ec_member_for_tle(EquivalenceClass *ec,
 					   TargetEntry *tle,
 					   Relids relids);
 static Material *make_material(Plan *lefttree);
+static Gather *make_gather(Plan *lefttree, int num_workers);
 
 
 /*
@@ -267,6 +269,10 @@ create_plan_recurse(PlannerInfo *root, Path *best_path)
 			plan = create_unique_plan(root,
 									  (UniquePath *) best_path);
 			break;
+		case T_Gather:
+			plan = (Plan *) create_gather_plan(root,
+											   (GatherPath *) best_path);
+			break;
 		default:
 			elog(ERROR, "unrecognized node type: %d",
 				 (int) best_path->pathtype);
@@ -884,6 +890,37 @@ create_material_plan(PlannerInfo *root, MaterialPath *best_path)
 	return plan;
 }
 
+/*
+ * create_gather_plan
+ *	  Create a Gather plan for 'best_path' and (recursively) plans
+ *	  for its subpaths.
+ *
+ *	  Returns a Plan node.
+ */
+static Gather *
+create_gather_plan(PlannerInfo *root, GatherPath *best_path)
+{
+	Gather	   *plan;
+	Plan	   *subplan;
+
+	subplan = create_plan_recurse(root, best_path->subpath);
+
+	/* Don't ship excess columns through the tuple queues */
+	disuse_physical_tlist(root, subplan, best_path->subpath);
+
+	/* The participants sort what they scan, if an order is wanted */
+	if (best_path->path.pathkeys != NIL)
+		subplan = (Plan *) make_sort_from_pathkeys(root, subplan,
+												   best_path->path.pathkeys,
+												   -1.0);
+
+	plan = make_gather(subplan, best_path->num_workers);
+
+	copy_path_costsize(&plan->plan, (Path *) best_path);
+
+	return plan;
+}
+
 /*
  * create_unique_plan
  *	  Create a Unique plan for 'best_path' and (recursively) plans
@@ -1029,6 +1066,7 @@ create_unique_plan(PlannerInfo *root, UniquePath *best_path)
 								 numGroupCols,
 								 groupColIdx,
 								 groupOperators,
+								 NIL,
 								 numGroups,
 								 subplan);
 	}
@@ -4317,6 +4355,22 @@ make_material(Plan *lefttree)
 	return node;
 }
 
+static Gather *
+make_gather(Plan *lefttree, int num_workers)
+{
+	Gather	   *node = makeNode(Gather);
+	Plan	   *plan = &node->plan;
+
+	/* cost should be inserted by caller */
+	plan->targetlist = lefttree->targetlist;
+	plan->qual = NIL;
+	plan->lefttree = lefttree;
+	plan->righttree = NULL;
+	node->num_workers = num_workers;
+
+	return node;
+}
+
 /*
  * materialize_finished_plan: stick a Material node atop a completed plan
  *
@@ -4357,6 +4411,7 @@ Agg *
 make_agg(PlannerInfo *root, List *tlist, List *qual,
 		 AggStrategy aggstrategy, const AggClauseCosts *aggcosts,
 		 int numGroupCols, AttrNumber *grpColIdx, Oid *grpOperators,
+		 List *groupingSets,
 		 long numGroups,
 		 Plan *lefttree)
 {
@@ -4370,6 +4425,8 @@ make_agg(PlannerInfo *root, List *tlist, List *qual,
 	node->grpColIdx = grpColIdx;
 	node->grpOperators = grpOperators;
 	node->numGroups = numGroups;
+	node->groupingSets = groupingSets;
+	node->chain = NIL;
 
 	copy_plan_costsize(plan, lefttree); /* only care about copying size */
 	cost_agg(&agg_path, root,
@@ -4378,14 +4435,18 @@ make_agg(PlannerInfo *root, List *tlist, List *qual,
 			 lefttree->startup_cost,
 			 lefttree->total_cost,
 			 lefttree->plan_rows);
+	if (aggstrategy == AGG_HASHED)
+		cost_hashagg_spill(&agg_path, aggcosts, numGroups,
+						   lefttree->plan_rows, lefttree->plan_width);
 	plan->startup_cost = agg_path.startup_cost;
 	plan->total_cost = agg_path.total_cost;
 
 	/*
 	 * We will produce a single output tuple if not grouping, and a tuple per
-	 * group otherwise.
+	 * group otherwise.  (A plain Agg with grouping sets has only empty sets,
+	 * one row for each; the caller counted them in numGroups.)
 	 */
-	if (aggstrategy == AGG_PLAIN)
+	if (aggstrategy == AGG_PLAIN && groupingSets == NIL)
 		plan->plan_rows = 1;
 	else
 		plan->plan_rows = numGroups;
@@ -4811,7 +4872,7 @@ make_modifytable(PlannerInfo *root,
 				 CmdType operation, bool canSetTag,
 				 List *resultRelations, List *subplans,
 				 List *withCheckOptionLists, List *returningLists,
-				 List *rowMarks, int epqParam)
+				 List *rowMarks, OnConflictExpr *onconflict, int epqParam)
 {
 	ModifyTable *node = makeNode(ModifyTable);
 	Plan	   *plan = &node->plan;
@@ -4865,6 +4926,31 @@ make_modifytable(PlannerInfo *root,
 	node->rowMarks = rowMarks;
 	node->epqParam = epqParam;
 
+	if (!onconflict)
+	{
+		node->onConflictAction = ONCONFLICT_NONE;
+		node->onConflictSet = NIL;
+		node->onConflictWhere = NULL;
+		node->arbiterIndexes = NIL;
+		node->exclRelRTI = 0;
+		node->exclRelTlist = NIL;
+	}
+	else
+	{
+		node->onConflictAction = onconflict->action;
+		node->onConflictSet = onconflict->onConflictSet;
+		node->onConflictWhere = onconflict->onConflictWhere;
+
+		/*
+		 * Work out which unique indexes serve as arbiters, throwing an error
+		 * if the inference specification matches none of them.
+		 */
+		node->arbiterIndexes = infer_arbiter_indexes(root);
+
+		node->exclRelRTI = onconflict->exclRelIndex;
+		node->exclRelTlist = onconflict->exclRelTlist;
+	}
+
 	/*
 	 * For each result relation that is a foreign table, allow the FDW to
 	 * construct private plan data, and accumulate it all into a list.
@@ -4931,6 +5017,7 @@ is_projection_capable_plan(Plan *plan)
 		case T_Unique:
 		case T_SetOp:
 		case T_LockRows:
+		case T_Gather:
 		case T_Limit:
 		case T_ModifyTable:
 		case T_Append:
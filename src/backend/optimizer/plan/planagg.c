@@ -89,14 +89,15 @@ preprocess_minmax_aggregates(PlannerInfo *root, List *tlist)
 	/*
 	 * Reject unoptimizable cases.
 	 *
-	 * We don't handle GROUP BY or windowing, because our current
-	 * implementations of grouping require looking at all the rows anyway, and
-	 * so there's not much point in optimizing MIN/MAX.  (Note: relaxing this
-	 * would likely require some restructuring in grouping_planner(), since it
-	 * performs assorted processing related to these features between calling
-	 * preprocess_minmax_aggregates and optimize_minmax_aggregates.)
+	 * We don't handle GROUP BY (including grouping sets) or windowing,
+	 * because our current implementations of grouping require looking at all
+	 * the rows anyway, and so there's not much point in optimizing MIN/MAX.
+	 * (Note: relaxing this would likely require some restructuring in
+	 * grouping_planner(), since it performs assorted processing related to
+	 * these features between calling preprocess_minmax_aggregates and
+	 * optimize_minmax_aggregates.)
 	 */
-	if (parse->groupClause || parse->hasWindowFuncs)
+	if (parse->groupClause || parse->groupingSets || parse->hasWindowFuncs)
 		return;
 
 	/*
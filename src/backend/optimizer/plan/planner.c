@@ -18,8 +18,11 @@
 #include <limits.h>
 
 #include "access/htup_details.h"
+#include "access/parallel.h"
+#include "access/xact.h"
+#include "catalog/catalog.h"
 #include "executor/executor.h"
-#include "executor/nodeAgg.h"
+#include "jit/jit.h"
 #include "miscadmin.h"
 #include "nodes/makefuncs.h"
 #ifdef OPTIMIZER_DEBUG
@@ -36,10 +39,14 @@
 #include "optimizer/subselect.h"
 #include "optimizer/tlist.h"
 #include "parser/analyze.h"
+#include "parser/parse_agg.h"
 #include "parser/parsetree.h"
 #include "rewrite/rewriteManip.h"
+#include "storage/bufmgr.h"
+#include "storage/dsm_impl.h"
 #include "utils/rel.h"
 #include "utils/selfuncs.h"
+#include "utils/snapmgr.h"
 
 
 /* GUC parameter */
@@ -59,12 +66,14 @@ planner_hook_type planner_hook = NULL;
 #define EXPRKIND_LIMIT			6
 #define EXPRKIND_APPINFO		7
 #define EXPRKIND_PHV			8
+#define EXPRKIND_ARBITER_ELEM	9
 
 /* Passthrough data for standard_qp_callback */
 typedef struct
 {
 	List	   *tlist;			/* preprocessed query targetlist */
 	List	   *activeWindows;	/* active windows, if any */
+	List	   *groupClause;	/* overrides parse->groupClause */
 } standard_qp_extra;
 
 /* Local functions */
@@ -78,6 +87,22 @@ static double preprocess_limit(PlannerInfo *root,
 				 int64 *offset_est, int64 *count_est);
 static bool limit_needed(Query *parse);
 static void preprocess_groupclause(PlannerInfo *root);
+static List *extract_rollup_sets(List *groupingSets);
+static List *make_rollup_groupclause(List *groupClause, List *rollup);
+static double estimate_rollup_groups(PlannerInfo *root, List *rollup,
+					   double path_rows);
+static Plan *build_grouping_chain(PlannerInfo *root,
+					 List *tlist,
+					 const AggClauseCosts *agg_costs,
+					 bool need_sort_for_grouping,
+					 List *rollup_lists,
+					 List *rollup_groupclauses,
+					 double *rollup_numgroups,
+					 AttrNumber *groupColIdx,
+					 long numGroups,
+					 Plan *result_plan);
+static AttrNumber *remap_groupColIdx(PlannerInfo *root, List *groupClause,
+				  AttrNumber *groupColIdx);
 static void standard_qp_callback(PlannerInfo *root, void *extra);
 static bool choose_hashed_grouping(PlannerInfo *root,
 					   double tuple_fraction, double limit_tuples,
@@ -179,6 +204,27 @@ standard_planner(Query *parse, int cursorOptions, ParamListInfo boundParams)
 	glob->transientPlan = false;
 	glob->hasRowSecurity = false;
 
+	/*
+	 * Assess whether it's feasible to use parallel mode for this query.
+	 * Only plain read-only SELECTs qualify; parallel workers cannot assign
+	 * transaction IDs, lock rows, or take part in serializable
+	 * transactions, and they need dynamic shared memory to talk to us.
+	 *
+	 * While the workers run, our own transaction state must not change
+	 * either, so the query must be run to completion by itself, which the
+	 * caller vouches for with CURSOR_OPT_PARALLEL_OK, and must not call
+	 * anything that might write, which we approximate by requiring every
+	 * function anywhere in the query to be immutable.
+	 */
+	glob->parallelModeOK = (cursorOptions & CURSOR_OPT_PARALLEL_OK) != 0 &&
+		parse->commandType == CMD_SELECT &&
+		!parse->hasModifyingCTE && parse->rowMarks == NIL &&
+		parse->utilityStmt == NULL &&
+		max_parallel_degree > 0 && IsUnderPostmaster &&
+		!IsParallelWorker() && !IsolationIsSerializable() &&
+		dynamic_shared_memory_type != DSM_IMPL_NONE &&
+		!contain_mutable_functions((Node *) parse);
+
 	/* Determine what fraction of the plan is likely to be scanned */
 	if (cursorOptions & CURSOR_OPT_FAST_PLAN)
 	{
@@ -257,6 +303,25 @@ standard_planner(Query *parse, int cursorOptions, ParamListInfo boundParams)
 	result->nParamExec = glob->nParamExec;
 	result->hasRowSecurity = glob->hasRowSecurity;
 
+	result->jitFlags = PGJIT_NONE;
+	if (jit_enabled && jit_above_cost >= 0 &&
+		top_plan->total_cost > jit_above_cost)
+	{
+		result->jitFlags |= PGJIT_PERFORM;
+
+		/*
+		 * Decide how much effort should be put into generating better code.
+		 */
+		if (jit_optimize_above_cost >= 0 &&
+			top_plan->total_cost > jit_optimize_above_cost)
+			result->jitFlags |= PGJIT_OPT3;
+
+		if (jit_expressions)
+			result->jitFlags |= PGJIT_EXPR;
+		if (jit_tuple_deforming)
+			result->jitFlags |= PGJIT_DEFORM;
+	}
+
 	return result;
 }
 
@@ -442,6 +507,28 @@ subquery_planner(PlannerGlobal *glob, Query *parse,
 		preprocess_expression(root, (Node *) parse->returningList,
 							  EXPRKIND_TARGET);
 
+	/* Also need to preprocess expressions within ON CONFLICT UPDATE */
+	if (parse->onConflict)
+	{
+		parse->onConflict->arbiterElems = (List *)
+			preprocess_expression(root,
+								  (Node *) parse->onConflict->arbiterElems,
+								  EXPRKIND_ARBITER_ELEM);
+		parse->onConflict->arbiterWhere =
+			preprocess_expression(root,
+								  parse->onConflict->arbiterWhere,
+								  EXPRKIND_QUAL);
+		parse->onConflict->onConflictSet = (List *)
+			preprocess_expression(root,
+								  (Node *) parse->onConflict->onConflictSet,
+								  EXPRKIND_TARGET);
+		parse->onConflict->onConflictWhere =
+			preprocess_expression(root,
+								  parse->onConflict->onConflictWhere,
+								  EXPRKIND_QUAL);
+		/* exclRelTlist contains only Vars, so no preprocessing needed */
+	}
+
 	preprocess_qual_conditions(root, (Node *) parse->jointree);
 
 	parse->havingQual = preprocess_expression(root, parse->havingQual,
@@ -522,6 +609,10 @@ subquery_planner(PlannerGlobal *glob, Query *parse,
 	 * don't emit a bogus aggregated row. (This could be done better, but it
 	 * seems not worth optimizing.)
 	 *
+	 * With grouping sets, a HAVING clause that doesn't use aggregates can
+	 * still depend on which set a row belongs to (the grouping columns absent
+	 * from the set read as null), so we leave all of HAVING alone.
+	 *
 	 * Note that both havingQual and parse->jointree->quals are in
 	 * implicitly-ANDed-list form at this point, even though they are declared
 	 * as Node *.
@@ -531,7 +622,8 @@ subquery_planner(PlannerGlobal *glob, Query *parse,
 	{
 		Node	   *havingclause = (Node *) lfirst(l);
 
-		if (contain_agg_clause(havingclause) ||
+		if (parse->groupingSets ||
+			contain_agg_clause(havingclause) ||
 			contain_volatile_functions(havingclause) ||
 			contain_subplans(havingclause))
 		{
@@ -612,6 +704,7 @@ subquery_planner(PlannerGlobal *glob, Query *parse,
 											 withCheckOptionLists,
 											 returningLists,
 											 rowMarks,
+											 parse->onConflict,
 											 SS_assign_special_param(root));
 		}
 	}
@@ -1056,6 +1149,7 @@ inheritance_planner(PlannerInfo *root)
 									 withCheckOptionLists,
 									 returningLists,
 									 rowMarks,
+									 NULL,
 									 SS_assign_special_param(root));
 }
 
@@ -1189,14 +1283,41 @@ grouping_planner(PlannerInfo *root, double tuple_fraction)
 		bool		use_hashed_grouping = false;
 		WindowFuncLists *wflists = NULL;
 		List	   *activeWindows = NIL;
+		List	   *rollup_lists = NIL;
+		List	   *rollup_groupclauses = NIL;
+		double	   *rollup_numgroups = NULL;
 
 		MemSet(&agg_costs, 0, sizeof(AggClauseCosts));
 
 		/* A recursive query should always have setOperations */
 		Assert(!root->hasRecursion);
 
-		/* Preprocess GROUP BY clause, if any */
-		if (parse->groupClause)
+		/* Preprocess grouping sets or GROUP BY clause, if any */
+		if (parse->groupingSets)
+		{
+			List	   *sets;
+			ListCell   *lc;
+
+			/*
+			 * Grouping sets are always implemented by sorting: rows of the
+			 * different sets can't share one hash table, and one pass over
+			 * sorted input serves a whole rollup of sets.
+			 */
+			if (!grouping_is_sortable(parse->groupClause))
+				ereport(ERROR,
+						(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+						 errmsg("could not implement GROUP BY"),
+						 errdetail("Grouping sets can only be implemented by sorting, and some of the datatypes only support hashing.")));
+
+			sets = expand_grouping_sets(parse->groupingSets, -1);
+			rollup_lists = extract_rollup_sets(sets);
+			foreach(lc, rollup_lists)
+				rollup_groupclauses =
+					lappend(rollup_groupclauses,
+							make_rollup_groupclause(parse->groupClause,
+													(List *) lfirst(lc)));
+		}
+		else if (parse->groupClause)
 			preprocess_groupclause(root);
 		numGroupCols = list_length(parse->groupClause);
 
@@ -1270,6 +1391,7 @@ grouping_planner(PlannerInfo *root, double tuple_fraction)
 		 * grouping/aggregation operations.
 		 */
 		if (parse->groupClause ||
+			parse->groupingSets ||
 			parse->distinctClause ||
 			parse->hasAggs ||
 			parse->hasWindowFuncs ||
@@ -1281,6 +1403,10 @@ grouping_planner(PlannerInfo *root, double tuple_fraction)
 		/* Set up data needed by standard_qp_callback */
 		qp_extra.tlist = tlist;
 		qp_extra.activeWindows = activeWindows;
+		if (parse->groupingSets)
+			qp_extra.groupClause = (List *) linitial(rollup_groupclauses);
+		else
+			qp_extra.groupClause = parse->groupClause;
 
 		/*
 		 * Generate the best unsorted and presorted paths for this Query (but
@@ -1309,7 +1435,31 @@ grouping_planner(PlannerInfo *root, double tuple_fraction)
 		 */
 		dNumGroups = 1;			/* in case not grouping */
 
-		if (parse->groupClause)
+		if (parse->groupingSets)
+		{
+			ListCell   *lc;
+			int			i = 0;
+
+			/* Each grouping set contributes its own groups */
+			rollup_numgroups = (double *)
+				palloc(sizeof(double) * list_length(rollup_lists));
+			dNumGroups = 0;
+			foreach(lc, rollup_lists)
+			{
+				rollup_numgroups[i] =
+					estimate_rollup_groups(root, (List *) lfirst(lc),
+										   path_rows);
+				dNumGroups += rollup_numgroups[i];
+				i++;
+			}
+
+			/*
+			 * The output of the different sets is interleaved and in no
+			 * useful order, so assume we must read all the tuples.
+			 */
+			tuple_fraction = 0.0;
+		}
+		else if (parse->groupClause)
 		{
 			List	   *groupExprs;
 
@@ -1442,7 +1592,13 @@ grouping_planner(PlannerInfo *root, double tuple_fraction)
 		/*
 		 * Consider whether we want to use hashing instead of sorting.
 		 */
-		if (parse->groupClause)
+		if (parse->groupingSets)
+		{
+			/* Grouping sets are always sorted; see above */
+			use_hashed_grouping = false;
+			numGroups = (long) Min(dNumGroups, (double) LONG_MAX);
+		}
+		else if (parse->groupClause)
 		{
 			/*
 			 * If grouping, decide whether to use sorted or hashed grouping.
@@ -1517,7 +1673,8 @@ grouping_planner(PlannerInfo *root, double tuple_fraction)
 			current_pathkeys = best_path->pathkeys;
 
 			/* Detect if we'll need an explicit sort for grouping */
-			if (parse->groupClause && !use_hashed_grouping &&
+			if ((parse->groupClause || parse->groupingSets) &&
+				!use_hashed_grouping &&
 			  !pathkeys_contained_in(root->group_pathkeys, current_pathkeys))
 			{
 				need_sort_for_grouping = true;
@@ -1594,11 +1751,29 @@ grouping_planner(PlannerInfo *root, double tuple_fraction)
 												numGroupCols,
 												groupColIdx,
 									extract_grouping_ops(parse->groupClause),
+												NIL,
 												numGroups,
 												result_plan);
 				/* Hashed aggregation produces randomly-ordered results */
 				current_pathkeys = NIL;
 			}
+			else if (parse->groupingSets)
+			{
+				/* Sorted aggregation over grouping sets --- sort if needed */
+				result_plan = build_grouping_chain(root,
+												   tlist,
+												   &agg_costs,
+												   need_sort_for_grouping,
+												   rollup_lists,
+												   rollup_groupclauses,
+												   rollup_numgroups,
+												   groupColIdx,
+												   numGroups,
+												   result_plan);
+
+				/* The rows of the different grouping sets are interleaved */
+				current_pathkeys = NIL;
+			}
 			else if (parse->hasAggs)
 			{
 				/* Plain aggregate plan --- sort if needed */
@@ -1637,6 +1812,7 @@ grouping_planner(PlannerInfo *root, double tuple_fraction)
 												numGroupCols,
 												groupColIdx,
 									extract_grouping_ops(parse->groupClause),
+												NIL,
 												numGroups,
 												result_plan);
 			}
@@ -1852,7 +2028,8 @@ grouping_planner(PlannerInfo *root, double tuple_fraction)
 		 * result was already mostly unique).  If not, use the number of
 		 * distinct-groups calculated previously.
 		 */
-		if (parse->groupClause || root->hasHavingQual || parse->hasAggs)
+		if (parse->groupClause || parse->groupingSets ||
+			root->hasHavingQual || parse->hasAggs)
 			dNumDistinctRows = result_plan->plan_rows;
 		else
 			dNumDistinctRows = dNumGroups;
@@ -1893,6 +2070,7 @@ grouping_planner(PlannerInfo *root, double tuple_fraction)
 								 extract_grouping_cols(parse->distinctClause,
 													result_plan->targetlist),
 								 extract_grouping_ops(parse->distinctClause),
+											NIL,
 											numDistinctRows,
 											result_plan);
 			/* Hashed aggregation produces randomly-ordered results */
@@ -2002,6 +2180,187 @@ grouping_planner(PlannerInfo *root, double tuple_fraction)
 	return result_plan;
 }
 
+/*
+ * build_grouping_chain
+ *		Build the Agg node implementing a query with grouping sets.
+ *
+ * The first rollup is computed by the returned Agg node itself, from its
+ * input sorted on that rollup's grouping columns (we add the Sort here if
+ * need_sort_for_grouping).  Each further rollup becomes an Agg node in the
+ * top node's chain list, whose lefttree is a Sort node describing the order
+ * the executor must re-sort the input into for that rollup.  Those Sort
+ * nodes are never executed as such; nodeAgg.c does the sorting itself while
+ * it reads its input, which is why they are not charged for their input.
+ */
+static Plan *
+build_grouping_chain(PlannerInfo *root,
+					 List *tlist,
+					 const AggClauseCosts *agg_costs,
+					 bool need_sort_for_grouping,
+					 List *rollup_lists,
+					 List *rollup_groupclauses,
+					 double *rollup_numgroups,
+					 AttrNumber *groupColIdx,
+					 long numGroups,
+					 Plan *result_plan)
+{
+	Query	   *parse = root->parse;
+	List	   *top_sets = (List *) linitial(rollup_lists);
+	List	   *top_groupclause = (List *) linitial(rollup_groupclauses);
+	AttrNumber *top_grpColIdx;
+	int			top_numcols = list_length(linitial(top_sets));
+	List	   *chain = NIL;
+	ListCell   *lc1;
+	ListCell   *lc2;
+	Index		maxref;
+	int			i;
+	Agg		   *agg;
+
+	/*
+	 * Remember where each grouping column is found in the input, so that
+	 * setrefs.c can tell GROUPING() expressions which input columns to check
+	 * against the grouping set being projected.
+	 */
+	maxref = 0;
+	foreach(lc1, parse->groupClause)
+	{
+		SortGroupClause *gc = (SortGroupClause *) lfirst(lc1);
+
+		maxref = Max(maxref, gc->tleSortGroupRef);
+	}
+
+	root->grouping_map = (AttrNumber *)
+		palloc0(sizeof(AttrNumber) * (maxref + 1));
+
+	i = 0;
+	foreach(lc1, parse->groupClause)
+	{
+		SortGroupClause *gc = (SortGroupClause *) lfirst(lc1);
+
+		root->grouping_map[gc->tleSortGroupRef] = groupColIdx[i++];
+	}
+
+	top_grpColIdx = remap_groupColIdx(root, top_groupclause, groupColIdx);
+
+	if (need_sort_for_grouping)
+		result_plan = (Plan *) make_sort_from_groupcols(root,
+														top_groupclause,
+														top_grpColIdx,
+														result_plan);
+
+	i = 1;
+	lc2 = lnext(list_head(rollup_groupclauses));
+	for_each_cell(lc1, lnext(list_head(rollup_lists)))
+	{
+		List	   *sets = (List *) lfirst(lc1);
+		List	   *groupClause = (List *) lfirst(lc2);
+		AttrNumber *new_grpColIdx;
+		Plan	   *sort_plan;
+		Plan	   *agg_plan;
+
+		/*
+		 * Only the first rollup can contain the empty set (every rollup ends
+		 * with a superset of it), so every chained rollup has some columns
+		 * to sort by.
+		 */
+		Assert(linitial(sets) != NIL);
+
+		new_grpColIdx = remap_groupColIdx(root, groupClause, groupColIdx);
+
+		sort_plan = (Plan *) make_sort_from_groupcols(root,
+													  groupClause,
+													  new_grpColIdx,
+													  result_plan);
+		sort_plan->startup_cost -= result_plan->total_cost;
+		sort_plan->total_cost -= result_plan->total_cost;
+
+		agg_plan = (Plan *) make_agg(root,
+									 tlist,
+									 (List *) parse->havingQual,
+									 AGG_SORTED,
+									 agg_costs,
+									 list_length(linitial(sets)),
+									 new_grpColIdx,
+									 extract_grouping_ops(groupClause),
+									 sets,
+							(long) Min(rollup_numgroups[i], (double) LONG_MAX),
+									 sort_plan);
+
+		/* The chained nodes are needed only for their grouping info */
+		sort_plan->targetlist = NIL;
+		sort_plan->lefttree = NULL;
+		agg_plan->targetlist = NIL;
+		agg_plan->qual = NIL;
+
+		chain = lappend(chain, agg_plan);
+
+		lc2 = lnext(lc2);
+		i++;
+	}
+
+	agg = make_agg(root,
+				   tlist,
+				   (List *) parse->havingQual,
+				   (top_numcols > 0) ? AGG_SORTED : AGG_PLAIN,
+				   agg_costs,
+				   top_numcols,
+				   top_grpColIdx,
+				   extract_grouping_ops(top_groupclause),
+				   top_sets,
+				   numGroups,
+				   result_plan);
+	agg->chain = chain;
+
+	/*
+	 * All the chained work happens inside the top node, so charge it there.
+	 * Each chained Agg's cost already includes that of its Sort.
+	 */
+	foreach(lc1, chain)
+		agg->plan.total_cost += ((Plan *) lfirst(lc1))->total_cost;
+
+	return (Plan *) agg;
+}
+
+/*
+ * remap_groupColIdx
+ *		Return the grouping column indexes for a rollup's groupClause.
+ *
+ * groupColIdx holds the subplan tlist indexes of the grouping columns in
+ * the order of parse->groupClause; the rollup wants them in its own order.
+ */
+static AttrNumber *
+remap_groupColIdx(PlannerInfo *root, List *groupClause,
+				  AttrNumber *groupColIdx)
+{
+	AttrNumber *new_grpColIdx;
+	ListCell   *lc;
+	int			i;
+
+	new_grpColIdx = (AttrNumber *)
+		palloc0(sizeof(AttrNumber) * list_length(groupClause));
+
+	i = 0;
+	foreach(lc, groupClause)
+	{
+		SortGroupClause *gc = (SortGroupClause *) lfirst(lc);
+		ListCell   *gl;
+		int			j = 0;
+
+		foreach(gl, root->parse->groupClause)
+		{
+			SortGroupClause *pgc = (SortGroupClause *) lfirst(gl);
+
+			if (pgc->tleSortGroupRef == gc->tleSortGroupRef)
+				break;
+			j++;
+		}
+		Assert(gl != NULL);
+		new_grpColIdx[i++] = groupColIdx[j];
+	}
+
+	return new_grpColIdx;
+}
+
 /*
  * add_tlist_costs_to_plan
  *
@@ -2598,6 +2957,138 @@ preprocess_groupclause(PlannerInfo *root)
 	parse->groupClause = new_groupclause;
 }
 
+/*
+ * extract_rollup_sets
+ *		Divide a query's grouping sets into rollups.
+ *
+ * A rollup is a list of grouping sets, longest first, in which each set is
+ * contained in the one before it; all of its sets can be computed in a
+ * single pass over input sorted on the columns of its first set.  Every
+ * rollup beyond the first costs an extra sort, so we want as few of them as
+ * possible.  We take the sets (as returned by expand_grouping_sets, which
+ * sorts them shortest first) longest first and add each one to the first
+ * rollup whose last set contains it.  That finds the obvious answer for
+ * ROLLUP and does reasonably for everything else.
+ *
+ * Note that the empty set, if present, always ends up in the first rollup.
+ */
+static List *
+extract_rollup_sets(List *groupingSets)
+{
+	List	   *sets = NIL;
+	List	   *rollups = NIL;
+	ListCell   *lc;
+
+	foreach(lc, groupingSets)
+		sets = lcons(lfirst(lc), sets);
+
+	foreach(lc, sets)
+	{
+		List	   *gset = (List *) lfirst(lc);
+		ListCell   *lc2;
+
+		foreach(lc2, rollups)
+		{
+			List	   *rollup = (List *) lfirst(lc2);
+
+			if (list_difference_int(gset, (List *) llast(rollup)) == NIL)
+			{
+				lfirst(lc2) = lappend(rollup, gset);
+				break;
+			}
+		}
+
+		if (lc2 == NULL)
+			rollups = lappend(rollups, list_make1(gset));
+	}
+
+	return rollups;
+}
+
+/*
+ * make_rollup_groupclause
+ *		Build the ordered groupClause for one rollup.
+ *
+ * We list the columns of the rollup's shortest set first, followed by those
+ * each successively longer set adds, so that every set of the rollup is a
+ * leading prefix of the result.  That is what lets one sort order serve all
+ * the sets.
+ */
+static List *
+make_rollup_groupclause(List *groupClause, List *rollup)
+{
+	List	   *result = NIL;
+	List	   *sets = NIL;
+	ListCell   *lc;
+
+	foreach(lc, rollup)
+		sets = lcons(lfirst(lc), sets);
+
+	foreach(lc, sets)
+	{
+		ListCell   *lc2;
+
+		foreach(lc2, (List *) lfirst(lc))
+		{
+			Index		ref = (Index) lfirst_int(lc2);
+			ListCell   *gl;
+
+			foreach(gl, groupClause)
+			{
+				SortGroupClause *gc = (SortGroupClause *) lfirst(gl);
+
+				if (gc->tleSortGroupRef == ref)
+				{
+					if (!list_member_ptr(result, gc))
+						result = lappend(result, gc);
+					break;
+				}
+			}
+			Assert(gl != NULL);
+		}
+	}
+
+	return result;
+}
+
+/*
+ * estimate_rollup_groups
+ *		Estimate the number of groups produced by all the sets of a rollup.
+ */
+static double
+estimate_rollup_groups(PlannerInfo *root, List *rollup, double path_rows)
+{
+	Query	   *parse = root->parse;
+	double		result = 0;
+	ListCell   *lc;
+
+	foreach(lc, rollup)
+	{
+		List	   *gset = (List *) lfirst(lc);
+		List	   *groupExprs = NIL;
+		ListCell   *lc2;
+
+		/* The empty set produces exactly one row */
+		if (gset == NIL)
+		{
+			result += 1;
+			continue;
+		}
+
+		foreach(lc2, gset)
+		{
+			TargetEntry *tle = get_sortgroupref_tle((Index) lfirst_int(lc2),
+													parse->targetList);
+
+			groupExprs = lappend(groupExprs, tle->expr);
+		}
+
+		result += estimate_num_groups(root, groupExprs, path_rows);
+	}
+
+	return result;
+}
+
 /*
  * Compute query_pathkeys and other pathkeys during plan generation
  */
@@ -2608,17 +3099,20 @@ standard_qp_callback(PlannerInfo *root, void *extra)
 	standard_qp_extra *qp_extra = (standard_qp_extra *) extra;
 	List	   *tlist = qp_extra->tlist;
 	List	   *activeWindows = qp_extra->activeWindows;
+	List	   *groupClause = qp_extra->groupClause;
 
 	/*
 	 * Calculate pathkeys that represent grouping/ordering requirements.  The
 	 * sortClause is certainly sort-able, but GROUP BY and DISTINCT might not
-	 * be, in which case we just leave their pathkeys empty.
+	 * be, in which case we just leave their pathkeys empty.  With grouping
+	 * sets, the groupClause we're handed is that of the rollup computed
+	 * directly from the input, in its sort order.
 	 */
-	if (parse->groupClause &&
-		grouping_is_sortable(parse->groupClause))
+	if (groupClause &&
+		grouping_is_sortable(groupClause))
 		root->group_pathkeys =
 			make_pathkeys_for_sortclauses(root,
-										  parse->groupClause,
+										  groupClause,
 										  tlist);
 	else
 		root->group_pathkeys = NIL;
@@ -2696,7 +3190,6 @@ choose_hashed_grouping(PlannerInfo *root,
 	int			numGroupCols = list_length(parse->groupClause);
 	bool		can_hash;
 	bool		can_sort;
-	Size		hashentrysize;
 	List	   *target_pathkeys;
 	List	   *current_pathkeys;
 	Path		hashed_p;
@@ -2732,21 +3225,6 @@ choose_hashed_grouping(PlannerInfo *root,
 	if (!enable_hashagg)
 		return false;
 
-	/*
-	 * Don't do it if it doesn't look like the hashtable will fit into
-	 * work_mem.
-	 */
-
-	/* Estimate per-hash-entry space at tuple width... */
-	hashentrysize = MAXALIGN(path_width) + MAXALIGN(sizeof(MinimalTupleData));
-	/* plus space for pass-by-ref transition values... */
-	hashentrysize += agg_costs->transitionSpace;
-	/* plus the per-hash-entry overhead */
-	hashentrysize += hash_agg_entry_size(agg_costs->numAggs);
-
-	if (hashentrysize * dNumGroups > work_mem * 1024L)
-		return false;
-
 	/*
 	 * When we have both GROUP BY and DISTINCT, use the more-rigorous of
 	 * DISTINCT and ORDER BY as the assumed required output sort order. This
@@ -2780,6 +3258,8 @@ choose_hashed_grouping(PlannerInfo *root,
 			 numGroupCols, dNumGroups,
 			 cheapest_path->startup_cost, cheapest_path->total_cost,
 			 path_rows);
+	/* A hash table that won't fit into work_mem spills to disk */
+	cost_hashagg_spill(&hashed_p, agg_costs, dNumGroups, path_rows, path_width);
 	/* Result of hashed agg is always unsorted */
 	if (target_pathkeys)
 		cost_sort(&hashed_p, root, target_pathkeys, hashed_p.total_cost,
@@ -2866,7 +3346,6 @@ choose_hashed_distinct(PlannerInfo *root,
 	int			numDistinctCols = list_length(parse->distinctClause);
 	bool		can_sort;
 	bool		can_hash;
-	Size		hashentrysize;
 	List	   *current_pathkeys;
 	List	   *needed_pathkeys;
 	Path		hashed_p;
@@ -2900,19 +3379,6 @@ choose_hashed_distinct(PlannerInfo *root,
 	if (!enable_hashagg)
 		return false;
 
-	/*
-	 * Don't do it if it doesn't look like the hashtable will fit into
-	 * work_mem.
-	 */
-
-	/* Estimate per-hash-entry space at tuple width... */
-	hashentrysize = MAXALIGN(path_width) + MAXALIGN(sizeof(MinimalTupleData));
-	/* plus the per-hash-entry overhead */
-	hashentrysize += hash_agg_entry_size(0);
-
-	if (hashentrysize * dNumDistinctRows > work_mem * 1024L)
-		return false;
-
 	/*
 	 * See if the estimated cost is no more than doing it the other way. While
 	 * avoiding the need for sorted input is usually a win, the fact that the
@@ -2930,6 +3396,8 @@ choose_hashed_distinct(PlannerInfo *root,
 			 numDistinctCols, dNumDistinctRows,
 			 cheapest_startup_cost, cheapest_total_cost,
 			 path_rows);
+	cost_hashagg_spill(&hashed_p, NULL, dNumDistinctRows, path_rows,
+					   path_width);
 
 	/*
 	 * Result of hashed agg is always unsorted, so if ORDER BY is present we
@@ -3043,8 +3511,8 @@ make_subplanTargetList(PlannerInfo *root,
 	 * If we're not grouping or aggregating, there's nothing to do here;
 	 * query_planner should receive the unmodified target list.
 	 */
-	if (!parse->hasAggs && !parse->groupClause && !root->hasHavingQual &&
-		!parse->hasWindowFuncs)
+	if (!parse->hasAggs && !parse->groupClause && !parse->groupingSets &&
+		!root->hasHavingQual && !parse->hasWindowFuncs)
 	{
 		*need_tlist_eval = true;
 		return tlist;
@@ -3771,3 +4239,50 @@ plan_cluster_use_sort(Oid tableOid, Oid indexOid)
 
 	return (seqScanAndSortPath.total_cost < indexScanPath->path.total_cost);
 }
+
+/*
+ * plan_create_index_workers
+ *		Decide how many parallel workers a btree index build should use
+ *
+ * heap is the table being indexed, and index the (already created) index.
+ * Returns 0 if the index should be built serially.  The workers run the
+ * index's expressions and predicate, so those must be safe to evaluate in a
+ * worker; and each participant needs a worthwhile share of
+ * maintenance_work_mem for its sort.
+ *
+ * Note: caller had better already hold some type of lock on the table.
+ */
+int
+plan_create_index_workers(Relation heap, Relation index)
+{
+	int			parallel_degree;
+
+	if (max_parallel_degree <= 0 || !IsUnderPostmaster ||
+		IsParallelWorker() || dynamic_shared_memory_type == DSM_IMPL_NONE)
+		return 0;
+
+	/* The workers take over the active snapshot, so there must be one */
+	if (!ActiveSnapshotSet())
+		return 0;
+
+	/*
+	 * Workers can't see the leader's local buffers, and builds on system
+	 * catalogs may have to wait for concurrent inserters, which we leave to
+	 * the serial code.
+	 */
+	if (RelationUsesLocalBuffers(heap) || IsSystemRelation(heap))
+		return 0;
+
+	if (has_parallel_hazard((Node *) RelationGetIndexExpressions(index)) ||
+		has_parallel_hazard((Node *) RelationGetIndexPredicate(index)))
+		return 0;
+
+	parallel_degree = compute_parallel_degree(RelationGetNumberOfBlocks(heap));
+
+	/* Leave each participant, the leader included, at least 32MB to sort in */
+	while (parallel_degree > 0 &&
+		   maintenance_work_mem / (parallel_degree + 1) < 32 * 1024L)
+		parallel_degree--;
+
+	return parallel_degree;
+}
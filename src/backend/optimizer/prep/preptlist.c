@@ -76,6 +76,17 @@ preprocess_targetlist(PlannerInfo *root, List *tlist)
 		tlist = expand_targetlist(tlist, command_type,
 								  result_relation, range_table);
 
+	/*
+	 * The ON CONFLICT DO UPDATE targetlist gets the same treatment as an
+	 * UPDATE's, so that it produces a complete row for the target.
+	 */
+	if (parse->onConflict)
+		parse->onConflict->onConflictSet =
+			expand_targetlist(parse->onConflict->onConflictSet,
+							  CMD_UPDATE,
+							  result_relation,
+							  range_table);
+
 	/*
 	 * Add necessary junk columns for rowmarked rels.  These values are needed
 	 * for locking of rels selected FOR UPDATE/SHARE, and to do EvalPlanQual
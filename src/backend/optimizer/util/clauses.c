@@ -98,6 +98,7 @@ static bool contain_volatile_functions_walker(Node *node, void *context);
 static bool contain_volatile_functions_not_nextval_walker(Node *node, void *context);
 static bool contain_nonstrict_functions_walker(Node *node, void *context);
 static bool contain_leaky_functions_walker(Node *node, void *context);
+static bool has_parallel_hazard_walker(Node *node, void *context);
 static Relids find_nonnullable_rels_walker(Node *node, bool top_level);
 static List *find_nonnullable_vars_walker(Node *node, bool top_level);
 static bool is_strict_saop(ScalarArrayOpExpr *expr, bool falseOK);
@@ -417,6 +418,11 @@ contain_agg_clause_walker(Node *node, void *context)
 		Assert(((Aggref *) node)->agglevelsup == 0);
 		return true;			/* abort the tree traversal and return true */
 	}
+	if (IsA(node, GroupingFunc))
+	{
+		Assert(((GroupingFunc *) node)->agglevelsup == 0);
+		return true;			/* abort the tree traversal and return true */
+	}
 	Assert(!IsA(node, SubLink));
 	return expression_tree_walker(node, contain_agg_clause_walker, context);
 }
@@ -949,6 +955,40 @@ contain_mutable_functions_walker(Node *node, void *context)
 }
 
 
+/*****************************************************************************
+ *		Check clauses for things a parallel worker can't evaluate
+ *****************************************************************************/
+
+/*
+ * has_parallel_hazard
+ *	  Recursively search for anything in a clause that a parallel worker
+ *	  could not evaluate the same way the master would.
+ *
+ * A worker has the master's snapshot and GUC settings but nothing else, so
+ * we reject mutable functions, which might depend on or change other state;
+ * subplans, which we don't ship to workers; and Params, whose values we
+ * don't ship either.
+ */
+bool
+has_parallel_hazard(Node *node)
+{
+	if (contain_mutable_functions(node) || contain_subplans(node))
+		return true;
+	return has_parallel_hazard_walker(node, NULL);
+}
+
+static bool
+has_parallel_hazard_walker(Node *node, void *context)
+{
+	if (node == NULL)
+		return false;
+	if (IsA(node, Param) ||
+		IsA(node, CurrentOfExpr))
+		return true;			/* abort the tree traversal and return true */
+	return expression_tree_walker(node, has_parallel_hazard_walker, context);
+}
+
+
 /*****************************************************************************
  *		Check clauses for volatile functions
  *****************************************************************************/
@@ -1225,6 +1265,14 @@ contain_nonstrict_functions_walker(Node *node, void *context)
 		/* an aggregate could return non-null with null input */
 		return true;
 	}
+	if (IsA(node, GroupingFunc))
+	{
+		/*
+		 * A GroupingFunc doesn't evaluate its arguments, and therefore must
+		 * be treated as nonstrict.
+		 */
+		return true;
+	}
 	if (IsA(node, WindowFunc))
 	{
 		/* a window function could return non-null with null input */
@@ -4304,6 +4352,7 @@ inline_function(Oid funcid, Oid result_type, Oid result_collid,
 		querytree->jointree->fromlist ||
 		querytree->jointree->quals ||
 		querytree->groupClause ||
+		querytree->groupingSets ||
 		querytree->havingQual ||
 		querytree->windowClause ||
 		querytree->distinctClause ||
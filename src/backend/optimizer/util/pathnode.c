@@ -1069,6 +1069,39 @@ create_material_path(RelOptInfo *rel, Path *subpath)
 	return pathnode;
 }
 
+/*
+ * create_gather_path
+ *	  Creates a path corresponding to a Gather plan over the given
+ *	  sequential scan path, or inner hash join of two sequential scans,
+ *	  returning the pathnode.
+ *
+ * 'pathkeys' are the sort order the participants should produce together,
+ * or NIL to have them return their tuples as they come.
+ */
+GatherPath *
+create_gather_path(PlannerInfo *root, RelOptInfo *rel, Path *subpath,
+				   int nworkers, List *pathkeys)
+{
+	GatherPath *pathnode = makeNode(GatherPath);
+
+	Assert(subpath->parent == rel);
+	Assert(subpath->pathtype == T_SeqScan ||
+		   subpath->pathtype == T_HashJoin);
+	Assert(subpath->param_info == NULL);
+
+	pathnode->path.pathtype = T_Gather;
+	pathnode->path.parent = rel;
+	pathnode->path.param_info = NULL;
+	pathnode->path.pathkeys = pathkeys;
+
+	pathnode->subpath = subpath;
+	pathnode->num_workers = nworkers;
+
+	cost_gather(pathnode, root, rel);
+
+	return pathnode;
+}
+
 /*
  * create_unique_path
  *	  Creates a path representing elimination of distinct rows from the
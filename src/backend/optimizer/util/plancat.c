@@ -25,6 +25,7 @@
 #include "access/transam.h"
 #include "access/xlog.h"
 #include "catalog/catalog.h"
+#include "catalog/dependency.h"
 #include "catalog/heap.h"
 #include "foreign/fdwapi.h"
 #include "miscadmin.h"
@@ -51,6 +52,8 @@ get_relation_info_hook_type get_relation_info_hook = NULL;
 
 
 static int32 get_rel_data_width(Relation rel, int32 *attr_widths);
+static bool infer_collation_opclass_match(InferenceElem *elem,
+							  Relation idxRel, List *idxExprs);
 static List *get_relation_constraints(PlannerInfo *root,
 						 Oid relationObjectId, RelOptInfo *rel,
 						 bool include_notnull);
@@ -393,6 +396,297 @@ get_relation_info(PlannerInfo *root, Oid relationObjectId, bool inhparent,
 		(*get_relation_info_hook) (root, relationObjectId, inhparent, rel);
 }
 
+/*
+ * infer_arbiter_indexes -
+ *	  Determine the unique indexes used to arbitrate speculative insertion.
+ *
+ * Uses the inference clause expressions and predicate of an INSERT ... ON
+ * CONFLICT to find matching unique indexes among those defined and ready on
+ * the target relation.  The indexed columns and expressions must match
+ * exactly (in any order), but the clause's WHERE need only imply a partial
+ * index's predicate.  Opclass and collation are only considered when the
+ * clause specifies them; otherwise every index that matches in other
+ * respects is accepted.
+ *
+ * Returns NIL for DO NOTHING without an inference specification, meaning
+ * that every unique index of the relation is an arbiter.
+ */
+List *
+infer_arbiter_indexes(PlannerInfo *root)
+{
+	OnConflictExpr *onconflict = root->parse->onConflict;
+
+	/* Iteration state */
+	Relation	relation;
+	Oid			relationObjectId;
+	Index		varno;
+	Oid			indexOidFromConstraint = InvalidOid;
+	List	   *indexList;
+	ListCell   *l;
+
+	/* Normalized inference attributes and inference expressions: */
+	Bitmapset  *inferAttrs = NULL;
+	List	   *inferElems = NIL;
+
+	/* Results */
+	List	   *results = NIL;
+
+	/*
+	 * Quickly return NIL for ON CONFLICT DO NOTHING without an inference
+	 * specification or named constraint.  DO UPDATE always has one or the
+	 * other; the parser checked that.
+	 */
+	if (onconflict->arbiterElems == NIL &&
+		onconflict->constraint == InvalidOid)
+		return NIL;
+
+	/*
+	 * We need not lock the relation since it was already locked by the
+	 * parser or rewriter.
+	 */
+	varno = root->parse->resultRelation;
+	relationObjectId = rt_fetch(varno, root->parse->rtable)->relid;
+
+	relation = heap_open(relationObjectId, NoLock);
+
+	/*
+	 * Build a bitmapset of the plain attributes named in the inference
+	 * clause, and a separate list of its expressions, which is the form in
+	 * which index definitions are cataloged.
+	 */
+	foreach(l, onconflict->arbiterElems)
+	{
+		InferenceElem *elem = (InferenceElem *) lfirst(l);
+		Var		   *var;
+		int			attno;
+
+		if (!IsA(elem, InferenceElem))
+			elog(ERROR, "unrecognized node type: %d", (int) nodeTag(elem));
+
+		if (!IsA(elem->expr, Var))
+		{
+			/* If not a plain Var, just shove it in inferElems for now */
+			inferElems = lappend(inferElems, elem->expr);
+			continue;
+		}
+
+		var = (Var *) elem->expr;
+		attno = var->varattno;
+
+		if (attno == 0)
+			ereport(ERROR,
+					(errcode(ERRCODE_INVALID_COLUMN_REFERENCE),
+					 errmsg("whole row unique index inference specifications are not supported")));
+
+		inferAttrs = bms_add_member(inferAttrs,
+								 attno - FirstLowInvalidHeapAttributeNumber);
+	}
+
+	/* Look up the index of a named constraint */
+	if (onconflict->constraint != InvalidOid)
+	{
+		indexOidFromConstraint = get_constraint_index(onconflict->constraint);
+
+		if (indexOidFromConstraint == InvalidOid)
+			ereport(ERROR,
+					(errcode(ERRCODE_WRONG_OBJECT_TYPE),
+			 errmsg("constraint in ON CONFLICT clause has no associated index")));
+	}
+
+	/* Now try to match each of the target relation's indexes */
+	indexList = RelationGetIndexList(relation);
+
+	foreach(l, indexList)
+	{
+		Oid			indexoid = lfirst_oid(l);
+		Relation	idxRel;
+		Form_pg_index idxForm;
+		Bitmapset  *indexedAttrs;
+		List	   *idxExprs;
+		List	   *predExprs;
+		AttrNumber	natt;
+		ListCell   *el;
+
+		/*
+		 * Take the lock the executor will want anyway.  Non-immediate
+		 * indexes are left for the executor to complain about, since it has
+		 * to check that when no inference clause is given, too.
+		 */
+		idxRel = index_open(indexoid, RowExclusiveLock);
+		idxForm = idxRel->rd_index;
+
+		/*
+		 * Unlike get_relation_info(), ignore indcheckxmin: uniqueness checks
+		 * only care about the latest committed tuple versions.
+		 */
+		if (!IndexIsValid(idxForm))
+			goto next;
+
+		/* A named constraint may be an exclusion constraint, too */
+		if (indexOidFromConstraint == idxForm->indexrelid)
+		{
+			if (!idxForm->indisunique &&
+				onconflict->action == ONCONFLICT_UPDATE)
+				ereport(ERROR,
+						(errcode(ERRCODE_WRONG_OBJECT_TYPE),
+						 errmsg("ON CONFLICT DO UPDATE not supported with exclusion constraints")));
+
+			results = lappend_oid(results, idxForm->indexrelid);
+			list_free(indexList);
+			index_close(idxRel, NoLock);
+			heap_close(relation, NoLock);
+			return results;
+		}
+		else if (indexOidFromConstraint != InvalidOid)
+			goto next;
+
+		/* Inference proper only considers unique indexes */
+		if (!idxForm->indisunique)
+			goto next;
+
+		/* Plain (non-expression) index attributes must match exactly */
+		indexedAttrs = NULL;
+		for (natt = 0; natt < idxForm->indnatts; natt++)
+		{
+			int			attno = idxForm->indkey.values[natt];
+
+			if (attno != 0)
+				indexedAttrs = bms_add_member(indexedAttrs,
+								 attno - FirstLowInvalidHeapAttributeNumber);
+		}
+
+		if (!bms_equal(indexedAttrs, inferAttrs))
+			goto next;
+
+		/* Index expressions are cataloged with varno 1 */
+		idxExprs = RelationGetIndexExpressions(idxRel);
+		if (idxExprs && varno != 1)
+			ChangeVarNodes((Node *) idxExprs, 1, varno, 0);
+
+		/* Each expression element must appear in the index definition */
+		foreach(el, onconflict->arbiterElems)
+		{
+			InferenceElem *elem = (InferenceElem *) lfirst(el);
+
+			/*
+			 * Check collation and opclass here, for expressions and plain
+			 * attributes alike.
+			 */
+			if (!infer_collation_opclass_match(elem, idxRel, idxExprs))
+				goto next;
+
+			/* Plain Vars were already checked above */
+			if (IsA(elem->expr, Var))
+				continue;
+
+			/*
+			 * infer_collation_opclass_match() already did the work when a
+			 * collation or opclass was given.
+			 */
+			if (elem->infercollid != InvalidOid ||
+				elem->inferopclass != InvalidOid ||
+				list_member(idxExprs, elem->expr))
+				continue;
+
+			goto next;
+		}
+
+		/*
+		 * Conversely, the inference clause must not be missing any of the
+		 * index's expressions.
+		 */
+		if (list_difference(idxExprs, inferElems) != NIL)
+			goto next;
+
+		/*
+		 * If it's a partial index, its predicate must be implied by the ON
+		 * CONFLICT's WHERE clause.
+		 */
+		predExprs = RelationGetIndexPredicate(idxRel);
+		if (predExprs && varno != 1)
+			ChangeVarNodes((Node *) predExprs, 1, varno, 0);
+
+		if (!predicate_implied_by(predExprs, (List *) onconflict->arbiterWhere))
+			goto next;
+
+		results = lappend_oid(results, idxForm->indexrelid);
+next:
+		index_close(idxRel, NoLock);
+	}
+
+	list_free(indexList);
+	heap_close(relation, NoLock);
+
+	if (results == NIL)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_COLUMN_REFERENCE),
+				 errmsg("there is no unique or exclusion constraint matching the ON CONFLICT specification")));
+
+	return results;
+}
+
+/*
+ * infer_collation_opclass_match - ensure infer element opclass/collation match
+ *
+ * Given an inference element that names an opclass and/or collation, check
+ * that some attribute of the index matches the element's expression while
+ * using that opclass (compared by opfamily and input type) and collation.
+ * Returns true if the element specifies neither.
+ */
+static bool
+infer_collation_opclass_match(InferenceElem *elem, Relation idxRel,
+							  List *idxExprs)
+{
+	AttrNumber	natt;
+	Oid			inferopfamily = InvalidOid;		/* OID of opclass opfamily */
+	Oid			inferopcinputtype = InvalidOid;	/* OID of opclass input type */
+	int			nplain = 0;		/* # plain attrs observed */
+
+	if (elem->infercollid == InvalidOid && elem->inferopclass == InvalidOid)
+		return true;
+
+	if (elem->inferopclass)
+	{
+		inferopfamily = get_opclass_family(elem->inferopclass);
+		inferopcinputtype = get_opclass_input_type(elem->inferopclass);
+	}
+
+	for (natt = 1; natt <= idxRel->rd_att->natts; natt++)
+	{
+		Oid			opfamily = idxRel->rd_opfamily[natt - 1];
+		Oid			opcinputtype = idxRel->rd_opcintype[natt - 1];
+		Oid			collation = idxRel->rd_indcollation[natt - 1];
+		int			attno = idxRel->rd_index->indkey.values[natt - 1];
+
+		if (attno != 0)
+			nplain++;
+
+		if (elem->inferopclass != InvalidOid &&
+			(inferopfamily != opfamily || inferopcinputtype != opcinputtype))
+			continue;
+
+		if (elem->infercollid != InvalidOid &&
+			elem->infercollid != collation)
+			continue;
+
+		/* One matching index attribute is good enough */
+		if (IsA(elem->expr, Var))
+		{
+			if (((Var *) elem->expr)->varattno == attno)
+				return true;
+		}
+		else if (attno == 0)
+		{
+			Node	   *nattExpr = list_nth(idxExprs, (natt - 1) - nplain);
+
+			if (equal(elem->expr, nattExpr))
+				return true;
+		}
+	}
+
+	return false;
+}
+
 /*
  * estimate_rel_size - estimate # pages and # tuples in a table or index
  *
@@ -482,6 +482,8 @@ assign_collations_walker(Node *node, assign_collations_context *context)
 		case T_RangeTblRef:
 		case T_JoinExpr:
 		case T_FromExpr:
+		case T_OnConflictExpr:
+		case T_InferenceElem:
 		case T_SortGroupClause:
 			(void) expression_tree_walker(node,
 										  assign_collations_walker,
@@ -491,7 +493,9 @@ assign_collations_walker(Node *node, assign_collations_context *context)
 			 * When we're invoked on a query's jointree, we don't need to do
 			 * anything with join nodes except recurse through them to process
 			 * WHERE/ON expressions.  So just stop here.  Likewise, we don't
-			 * need to do anything when invoked on sort/group lists.
+			 * need to do anything when invoked on sort/group lists, or on an
+			 * ON CONFLICT clause (an inference element's collation, if any,
+			 * was given explicitly and is stored separately).
 			 */
 			return false;
 		case T_Query:
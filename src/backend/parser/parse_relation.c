@@ -577,8 +577,11 @@ scanRTEForColumn(ParseState *pstate, RangeTblEntry *rte, char *colname,
 
 	/*
 	 * If the RTE represents a real table, consider system column names.
+	 * ON CONFLICT's EXCLUDED pseudo relation is marked as a composite type
+	 * and has no system columns.
 	 */
-	if (rte->rtekind == RTE_RELATION)
+	if (rte->rtekind == RTE_RELATION &&
+		rte->relkind != RELKIND_COMPOSITE_TYPE)
 	{
 		/* quick check to see if name could be a system column */
 		attnum = specialAttNum(colname);
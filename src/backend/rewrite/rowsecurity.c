@@ -139,6 +139,17 @@ prepend_row_security_policies(Query* root, RangeTblEntry* rte, int rt_index)
 		return false;
 	}
 
+	/*
+	 * The UPDATE path of INSERT ... ON CONFLICT DO UPDATE would need both the
+	 * INSERT and the UPDATE policies applied to the same row, which we don't
+	 * support yet.
+	 */
+	if (rt_index == root->resultRelation && root->onConflict &&
+		root->onConflict->action == ONCONFLICT_UPDATE)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("INSERT ... ON CONFLICT DO UPDATE is not supported on tables with row level security enabled")));
+
 	/*
 	 * We may end up getting called multiple times for the same RTE, so check
 	 * to make sure we aren't doing double-work.
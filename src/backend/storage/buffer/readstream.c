@@ -0,0 +1,282 @@
+/*-------------------------------------------------------------------------
+ *
+ * readstream.c
+ *	  Look-ahead reading of a stream of blocks of a relation.
+ *
+ * A read stream is driven by a callback that names the blocks to read, one
+ * at a time, in the order the caller wants them.  The stream asks for them
+ * ahead of time and keeps them in a small circular queue.  Whenever it runs
+ * out of pinned buffers, it takes the run of consecutive blocks at the head
+ * of the queue (at most io_combine_limit of them) and reads it with one
+ * ReadBuffers call, which turns into a single vectored read for the blocks
+ * that aren't cached.  The blocks queued behind that run are passed to the
+ * kernel as prefetch hints at the same time, so that their I/O is in flight
+ * while the caller works through the run.  At the default
+ * effective_io_concurrency of 1, blocks that carry on from the ones before
+ * them get no hint, since kernel readahead takes care of sequential reads
+ * on local disks, and does so better without our interference.  A higher
+ * setting says that the storage wants more requests in flight than
+ * readahead keeps going, as network block storage does, so then sequential
+ * runs are hinted too.
+ *
+ * How far ahead the stream looks is governed by effective_io_concurrency:
+ * the queue holds that many runs beyond the one being read.  With
+ * prefetching disabled the stream still combines reads, but looks no
+ * further ahead than one run.  Prefetching is also suspended while runs
+ * keep being cut short by blocks found in shared buffers, since checking
+ * the buffer table for each queued block costs something and mostly finds
+ * nothing to do when the relation is cached.
+ *
+ * Only the blocks of the current run are pinned, so a stream holds at most
+ * io_combine_limit pins, which keeps it from hogging a small strategy ring.
+ *
+ *
+ * Portions Copyright (c) 1996-2015, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/storage/buffer/readstream.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "miscadmin.h"
+#include "storage/readstream.h"
+
+/* upper limit on the number of blocks a stream queues up */
+#define MAX_READ_STREAM_DISTANCE	512
+
+struct ReadStream
+{
+	Relation	rel;
+	ForkNumber	forknum;
+	BufferAccessStrategy strategy;
+	ReadStreamBlockCB callback;
+	void	   *callback_private;
+	size_t		per_block_data_size;
+
+	int			distance;		/* size of the queue */
+	int			combine_limit;	/* max blocks per ReadBuffers call */
+	bool		prefetch;		/* issue prefetch hints? */
+	bool		prefetch_sequential;	/* ... even for sequential runs? */
+	bool		cached;			/* was the last run cut short by a hit? */
+	bool		exhausted;		/* callback has returned InvalidBlockNumber */
+
+	/*
+	 * Circular queue of upcoming blocks, starting at index head.  Of the
+	 * nqueued entries, the first npinned have their buffers pinned already,
+	 * and the first nprefetched have been pinned or prefetched.
+	 */
+	int			head;
+	int			nqueued;
+	int			npinned;
+	int			nprefetched;
+	BlockNumber *blocks;
+	Buffer	   *buffers;
+	char	   *per_block_data;
+};
+
+/* index into the queue arrays of the i'th entry from the head */
+#define QUEUE_INDEX(stream, i)	(((stream)->head + (i)) % (stream)->distance)
+
+static void *
+read_stream_per_block_data(ReadStream *stream, int index)
+{
+	if (stream->per_block_data_size == 0)
+		return NULL;
+	return stream->per_block_data + index * stream->per_block_data_size;
+}
+
+/*
+ * Issue prefetch hints for the queue entries from the from'th on, one
+ * request per run of consecutive blocks.  The from'th entry is never the
+ * head of the queue.
+ *
+ * Unless prefetch_sequential is set, a run that just continues the blocks
+ * before it is left alone: the kernel is already reading ahead of a
+ * sequential read, and a hint for the blocks it was about to read anyway
+ * only keeps its readahead from growing.
+ */
+static void
+read_stream_prefetch(ReadStream *stream, int from)
+{
+	int			i = from;
+
+	Assert(from > 0);
+
+	while (i < stream->nqueued)
+	{
+		BlockNumber first = stream->blocks[QUEUE_INDEX(stream, i)];
+		int			n = 1;
+
+		while (i + n < stream->nqueued &&
+			   stream->blocks[QUEUE_INDEX(stream, i + n)] == first + n)
+			n++;
+
+		if (stream->prefetch_sequential ||
+			stream->blocks[QUEUE_INDEX(stream, i - 1)] + 1 != first)
+			PrefetchBuffers(stream->rel, stream->forknum, first, n);
+		i += n;
+	}
+
+	stream->nprefetched = Max(stream->nprefetched, stream->nqueued);
+}
+
+/*
+ * BeginReadStream -- set up a stream of reads of the given fork
+ *
+ * The callback is not called until the first ReadStreamNextBuffer call.
+ * per_block_data_size bytes of space are set aside for each queued block,
+ * for the callback to remember whatever it decided about the block.
+ */
+ReadStream *
+BeginReadStream(Relation rel, ForkNumber forknum,
+				BufferAccessStrategy strategy,
+				ReadStreamBlockCB callback, void *callback_private,
+				size_t per_block_data_size)
+{
+	ReadStream *stream;
+
+	stream = (ReadStream *) palloc0(sizeof(ReadStream));
+	stream->rel = rel;
+	stream->forknum = forknum;
+	stream->strategy = strategy;
+	stream->callback = callback;
+	stream->callback_private = callback_private;
+	stream->per_block_data_size = MAXALIGN(per_block_data_size);
+
+	/*
+	 * Don't let a stream pin more than its share of shared buffers, in case
+	 * they are very few.
+	 */
+	stream->combine_limit = Min(io_combine_limit,
+								Max(NBuffers / MaxBackends, 1));
+	stream->prefetch = (target_prefetch_pages > 0);
+	stream->prefetch_sequential = (target_prefetch_pages > 1);
+	stream->distance = Min((target_prefetch_pages + 1) * io_combine_limit,
+						   MAX_READ_STREAM_DISTANCE);
+
+	stream->blocks = (BlockNumber *)
+		palloc(stream->distance * sizeof(BlockNumber));
+	stream->buffers = (Buffer *) palloc(stream->distance * sizeof(Buffer));
+	if (stream->per_block_data_size > 0)
+		stream->per_block_data =
+			palloc(stream->distance * stream->per_block_data_size);
+
+	return stream;
+}
+
+/*
+ * ReadStreamNextBuffer -- return the next block of the stream, pinned
+ *
+ * Returns InvalidBuffer once the callback has run out of blocks.  The
+ * caller is responsible for releasing the buffer.  If per_block_data isn't
+ * NULL, *per_block_data is set to the block's private data, which stays
+ * valid until the next call.
+ */
+Buffer
+ReadStreamNextBuffer(ReadStream *stream, void **per_block_data)
+{
+	Buffer		buffer;
+
+	if (stream->npinned == 0)
+	{
+		Buffer		buffers[MAX_IO_COMBINE_LIMIT];
+		BlockNumber first;
+		int			nblocks;
+		int			npinned;
+		int			i;
+
+		/* top up the queue */
+		while (!stream->exhausted && stream->nqueued < stream->distance)
+		{
+			int			index = QUEUE_INDEX(stream, stream->nqueued);
+			BlockNumber blkno;
+
+			blkno = stream->callback(stream->callback_private,
+									 read_stream_per_block_data(stream, index));
+			if (blkno == InvalidBlockNumber)
+				stream->exhausted = true;
+			else
+			{
+				stream->blocks[index] = blkno;
+				stream->nqueued++;
+			}
+		}
+
+		if (stream->nqueued == 0)
+			return InvalidBuffer;
+
+		/* find the run of consecutive blocks at the head */
+		first = stream->blocks[stream->head];
+		nblocks = 1;
+		while (nblocks < stream->nqueued &&
+			   nblocks < stream->combine_limit &&
+			   stream->blocks[QUEUE_INDEX(stream, nblocks)] == first + nblocks)
+			nblocks++;
+
+		/* tell the kernel about the blocks after it, then read it */
+		if (stream->prefetch && !stream->cached)
+			read_stream_prefetch(stream, Max(stream->nprefetched, nblocks));
+
+		npinned = ReadBuffers(stream->rel, stream->forknum, first, nblocks,
+							  stream->strategy, buffers);
+		for (i = 0; i < npinned; i++)
+			stream->buffers[QUEUE_INDEX(stream, i)] = buffers[i];
+		stream->npinned = npinned;
+		stream->cached = (npinned < nblocks);
+	}
+
+	buffer = stream->buffers[stream->head];
+	if (per_block_data)
+		*per_block_data = read_stream_per_block_data(stream, stream->head);
+
+	stream->head = QUEUE_INDEX(stream, 1);
+	stream->nqueued--;
+	stream->npinned--;
+	if (stream->nprefetched > 0)
+		stream->nprefetched--;
+
+	return buffer;
+}
+
+/*
+ * ResetReadStream -- forget the queued blocks
+ *
+ * Releases the buffers the stream has pinned and not handed out yet.  The
+ * next ReadStreamNextBuffer call starts asking the callback again, so this
+ * is what to do when the callback's position is changed, as on a rescan.
+ */
+void
+ResetReadStream(ReadStream *stream)
+{
+	while (stream->npinned > 0)
+	{
+		ReleaseBuffer(stream->buffers[stream->head]);
+		stream->head = QUEUE_INDEX(stream, 1);
+		stream->npinned--;
+	}
+
+	stream->head = 0;
+	stream->nqueued = 0;
+	stream->nprefetched = 0;
+	stream->cached = false;
+	stream->exhausted = false;
+}
+
+/*
+ * EndReadStream -- release a stream's buffers and free it
+ */
+void
+EndReadStream(ReadStream *stream)
+{
+	ResetReadStream(stream);
+
+	pfree(stream->blocks);
+	pfree(stream->buffers);
+	if (stream->per_block_data)
+		pfree(stream->per_block_data);
+	pfree(stream);
+}
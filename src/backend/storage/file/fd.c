@@ -63,6 +63,9 @@
 #include <sys/stat.h>
 #include <unistd.h>
 #include <fcntl.h>
+#ifndef WIN32
+#include <sys/uio.h>
+#endif
 #ifdef HAVE_SYS_RESOURCE_H
 #include <sys/resource.h>		/* for getrlimit */
 #endif
@@ -102,6 +105,19 @@
  */
 #define FD_MINFREE				10
 
+/*
+ * Number of buffers FileReadv passes to one readv() call: enough for the
+ * longest read the buffer manager combines, unless IOV_MAX says otherwise.
+ * POSIX guarantees at least 16.
+ */
+#if !defined(IOV_MAX)
+#define FILE_READV_MAX_BUFFERS	16
+#elif IOV_MAX < 32
+#define FILE_READV_MAX_BUFFERS	IOV_MAX
+#else
+#define FILE_READV_MAX_BUFFERS	32
+#endif
+
 
 /*
  * A number of platforms allow individual processes to open many more files
@@ -151,6 +167,7 @@ int			max_safe_fds = 32;	/* default if not changed */
 /* these are the assigned bits in fdstate below: */
 #define FD_TEMPORARY		(1 << 0)	/* T = delete when closed */
 #define FD_XACT_TEMPORARY	(1 << 1)	/* T = delete at eoXact */
+#define FD_TEMP_FILE_LIMIT	(1 << 2)	/* T = respect temp_file_limit */
 
 typedef struct vfd
 {
@@ -1055,8 +1072,8 @@ OpenTemporaryFile(bool interXact)
 											 DEFAULTTABLESPACE_OID,
 											 true);
 
-	/* Mark it for deletion at close */
-	VfdCache[file].fdstate |= FD_TEMPORARY;
+	/* Mark it for deletion at close and temporary file size limit */
+	VfdCache[file].fdstate |= FD_TEMPORARY | FD_TEMP_FILE_LIMIT;
 
 	/* Register it with the current resource owner */
 	if (!interXact)
@@ -1085,24 +1102,8 @@ OpenTemporaryFileInTablespace(Oid tblspcOid, bool rejectError)
 	char		tempfilepath[MAXPGPATH];
 	File		file;
 
-	/*
-	 * Identify the tempfile directory for this tablespace.
-	 *
-	 * If someone tries to specify pg_global, use pg_default instead.
-	 */
-	if (tblspcOid == DEFAULTTABLESPACE_OID ||
-		tblspcOid == GLOBALTABLESPACE_OID)
-	{
-		/* The default tablespace is {datadir}/base */
-		snprintf(tempdirpath, sizeof(tempdirpath), "base/%s",
-				 PG_TEMP_FILES_DIR);
-	}
-	else
-	{
-		/* All other tablespaces are accessed via symlinks */
-		snprintf(tempdirpath, sizeof(tempdirpath), "pg_tblspc/%u/%s/%s",
-				 tblspcOid, TABLESPACE_VERSION_DIRECTORY, PG_TEMP_FILES_DIR);
-	}
+	/* Identify the tempfile directory for this tablespace. */
+	TempTablespacePath(tempdirpath, tblspcOid);
 
 	/*
 	 * Generate a tempfile name that should be unique within the current
@@ -1141,6 +1142,203 @@ OpenTemporaryFileInTablespace(Oid tblspcOid, bool rejectError)
 	return file;
 }
 
+/*
+ * Construct the path of the temporary-files directory for a tablespace.
+ * The result is written into "path", which must be MAXPGPATH bytes long.
+ *
+ * If someone tries to specify pg_global, use pg_default instead.
+ */
+void
+TempTablespacePath(char *path, Oid tablespace)
+{
+	if (tablespace == InvalidOid ||
+		tablespace == DEFAULTTABLESPACE_OID ||
+		tablespace == GLOBALTABLESPACE_OID)
+	{
+		/* The default tablespace is {datadir}/base */
+		snprintf(path, MAXPGPATH, "base/%s", PG_TEMP_FILES_DIR);
+	}
+	else
+	{
+		/* All other tablespaces are accessed via symlinks */
+		snprintf(path, MAXPGPATH, "pg_tblspc/%u/%s/%s",
+				 tablespace, TABLESPACE_VERSION_DIRECTORY, PG_TEMP_FILES_DIR);
+	}
+}
+
+/*
+ * Register a named temporary file with the current resource owner.
+ * Subroutine for PathNameCreateTemporaryFile and PathNameOpenTemporaryFile.
+ */
+static void
+RegisterTemporaryFile(File file)
+{
+	ResourceOwnerEnlargeFiles(CurrentResourceOwner);
+	ResourceOwnerRememberFile(CurrentResourceOwner, file);
+	VfdCache[file].resowner = CurrentResourceOwner;
+
+	/* Backup mechanism for closing at end of xact. */
+	VfdCache[file].fdstate |= FD_XACT_TEMPORARY;
+	have_xact_temporary_files = true;
+}
+
+/*
+ * Create a new file with a caller-chosen name in a temporary-files
+ * directory.  Unlike OpenTemporaryFile, the file is not deleted when it is
+ * closed, so that other backends can open it by name afterwards; removing
+ * it is the responsibility of whoever defined the name (see
+ * sharedfileset.c).  The directory containing the file is created on
+ * demand.
+ *
+ * The File is closed, but not deleted, at end of transaction.  Its size
+ * counts towards temp_file_limit of the backend that writes it.
+ *
+ * If the file can't be created and error_on_failure is false, returns a
+ * value <= 0 instead of throwing an error.
+ */
+File
+PathNameCreateTemporaryFile(const char *path, bool error_on_failure)
+{
+	File		file;
+
+	/*
+	 * Open the file.  Note: we don't use O_EXCL, in case there is an orphaned
+	 * temp file that can be reused.
+	 */
+	file = PathNameOpenFile((FileName) path,
+							O_RDWR | O_CREAT | O_TRUNC | PG_BINARY,
+							0600);
+	if (file <= 0)
+	{
+		char		tempdirpath[MAXPGPATH];
+		char	   *sep;
+
+		/*
+		 * We might need to create the tablespace's tempfile directory, if no
+		 * one has yet done so.  As in OpenTemporaryFileInTablespace, ignore
+		 * the mkdir result and let the second open attempt decide.
+		 */
+		strlcpy(tempdirpath, path, MAXPGPATH);
+		sep = strrchr(tempdirpath, '/');
+		if (sep != NULL)
+		{
+			*sep = '\0';
+			mkdir(tempdirpath, S_IRWXU);
+		}
+
+		file = PathNameOpenFile((FileName) path,
+								O_RDWR | O_CREAT | O_TRUNC | PG_BINARY,
+								0600);
+		if (file <= 0)
+		{
+			if (error_on_failure)
+				ereport(ERROR,
+						(errcode_for_file_access(),
+						 errmsg("could not create temporary file \"%s\": %m",
+								path)));
+			return file;
+		}
+	}
+
+	/* Mark it for temp_file_limit accounting. */
+	VfdCache[file].fdstate |= FD_TEMP_FILE_LIMIT;
+
+	/* Register it for automatic close. */
+	RegisterTemporaryFile(file);
+
+	return file;
+}
+
+/*
+ * Open a file that was created with PathNameCreateTemporaryFile, possibly in
+ * another backend.  Files opened this way don't count against the
+ * temp_file_limit of the caller, are read-only and are automatically closed
+ * at the end of the transaction but are not deleted on close.
+ *
+ * Returns a value <= 0 if the file does not exist; any other failure
+ * results in an error.
+ */
+File
+PathNameOpenTemporaryFile(const char *path)
+{
+	File		file;
+
+	file = PathNameOpenFile((FileName) path, O_RDONLY | PG_BINARY, 0);
+
+	/* If no such file, then we don't raise an error. */
+	if (file <= 0)
+	{
+		if (errno != ENOENT)
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not open temporary file \"%s\": %m",
+							path)));
+		return file;
+	}
+
+	/* Register it for automatic close. */
+	RegisterTemporaryFile(file);
+
+	return file;
+}
+
+/*
+ * Delete a file created with PathNameCreateTemporaryFile, reporting its size
+ * to the statistics collector and to log_temp_files just as FileClose does
+ * for ordinary temporary files.  Returns true if the file existed.
+ */
+bool
+PathNameDeleteTemporaryFile(const char *path, bool error_on_failure)
+{
+	struct stat filestats;
+	int			stat_errno;
+
+	/* Get the final size for pgstat reporting. */
+	if (stat(path, &filestats) != 0)
+		stat_errno = errno;
+	else
+		stat_errno = 0;
+
+	/*
+	 * Unlike FileClose's automatic file deletion code, we tolerate
+	 * non-existence to support BufFileDeleteShared which doesn't know how
+	 * many segments it has to delete until it runs out.
+	 */
+	if (stat_errno == ENOENT)
+		return false;
+
+	if (unlink(path) < 0)
+	{
+		if (errno != ENOENT)
+			ereport(error_on_failure ? ERROR : LOG,
+					(errcode_for_file_access(),
+					 errmsg("could not unlink temporary file \"%s\": %m",
+							path)));
+		return false;
+	}
+
+	if (stat_errno == 0)
+	{
+		pgstat_report_tempfile(filestats.st_size);
+
+		if (log_temp_files >= 0)
+		{
+			if ((filestats.st_size / 1024) >= log_temp_files)
+				ereport(LOG,
+						(errmsg("temporary file: path \"%s\", size %lu",
+								path,
+								(unsigned long) filestats.st_size)));
+		}
+	}
+	else
+	{
+		errno = stat_errno;
+		elog(LOG, "could not stat file \"%s\": %m", path);
+	}
+
+	return true;
+}
+
 /*
  * close a file when done with it
  */
@@ -1169,6 +1367,13 @@ FileClose(File file)
 		vfdP->fd = VFD_CLOSED;
 	}
 
+	if (vfdP->fdstate & FD_TEMP_FILE_LIMIT)
+	{
+		/* Subtract its size from current usage (do first in case of error) */
+		temporary_files_size -= vfdP->fileSize;
+		vfdP->fileSize = 0;
+	}
+
 	/*
 	 * Delete the file if it was temporary, and make a log entry if wanted
 	 */
@@ -1186,10 +1391,6 @@ FileClose(File file)
 		 */
 		vfdP->fdstate &= ~FD_TEMPORARY;
 
-		/* Subtract its size from current usage (do first in case of error) */
-		temporary_files_size -= vfdP->fileSize;
-		vfdP->fileSize = 0;
-
 		/* first try the stat() */
 		if (stat(vfdP->fileName, &filestats))
 			stat_errno = errno;
@@ -1267,6 +1468,39 @@ FilePrefetch(File file, off_t offset, int amount)
 #endif
 }
 
+/*
+ * FileWriteback - ask the kernel to start writing back the given range of
+ * the file.
+ *
+ * This is only a hint; the data is not guaranteed to be on disk afterwards,
+ * but the kernel is told not to let it accumulate in its page cache.  Doing
+ * so during a checkpoint makes the final fsync() much cheaper.
+ */
+void
+FileWriteback(File file, off_t offset, off_t nbytes)
+{
+	int			returnCode;
+
+	Assert(FileIsValid(file));
+
+	DO_DB(elog(LOG, "FileWriteback: %d (%s) " INT64_FORMAT " " INT64_FORMAT,
+			   file, VfdCache[file].fileName,
+			   (int64) offset, (int64) nbytes));
+
+	/*
+	 * Caution: do not call pg_flush_data with nbytes = 0, it could trash the
+	 * file's seek position.  We prefer to define that as a no-op here.
+	 */
+	if (nbytes <= 0)
+		return;
+
+	returnCode = FileAccess(file);
+	if (returnCode < 0)
+		return;
+
+	pg_flush_data(VfdCache[file].fd, offset, nbytes);
+}
+
 int
 FileRead(File file, char *buffer, int amount)
 {
@@ -1322,6 +1556,82 @@ retry:
 	return returnCode;
 }
 
+/*
+ * FileReadv - read into several buffers of the same size at once
+ *
+ * Reads nbuffers * amount bytes from the current seek position, filling the
+ * buffers in order, with as few system calls as the platform allows.  The
+ * result is the number of bytes read, or -1 with errno set, just like
+ * FileRead's; a short result means the data ended at EOF.
+ */
+int
+FileReadv(File file, char **buffers, int nbuffers, int amount)
+{
+	int			total = 0;
+	int			returnCode;
+
+	Assert(FileIsValid(file));
+
+	DO_DB(elog(LOG, "FileReadv: %d (%s) " INT64_FORMAT " %d*%d",
+			   file, VfdCache[file].fileName,
+			   (int64) VfdCache[file].seekPos,
+			   nbuffers, amount));
+
+	returnCode = FileAccess(file);
+	if (returnCode < 0)
+		return returnCode;
+
+#ifndef WIN32
+	while (nbuffers > 0)
+	{
+		struct iovec iov[FILE_READV_MAX_BUFFERS];
+		int			niov = Min(nbuffers, FILE_READV_MAX_BUFFERS);
+		int			i;
+
+		for (i = 0; i < niov; i++)
+		{
+			iov[i].iov_base = buffers[i];
+			iov[i].iov_len = amount;
+		}
+
+retry:
+		returnCode = readv(VfdCache[file].fd, iov, niov);
+		if (returnCode < 0)
+		{
+			/* OK to retry if interrupted */
+			if (errno == EINTR)
+				goto retry;
+
+			/* Trouble, so assume we don't know the file position anymore */
+			VfdCache[file].seekPos = FileUnknownPos;
+			return returnCode;
+		}
+
+		VfdCache[file].seekPos += returnCode;
+		total += returnCode;
+		if (returnCode < niov * amount)
+			break;				/* EOF */
+		buffers += niov;
+		nbuffers -= niov;
+	}
+#else
+	/* no readv() here; see FileRead for the error handling */
+	while (nbuffers > 0)
+	{
+		returnCode = FileRead(file, buffers[0], amount);
+		if (returnCode < 0)
+			return returnCode;
+		total += returnCode;
+		if (returnCode < amount)
+			break;				/* EOF */
+		buffers++;
+		nbuffers--;
+	}
+#endif
+
+	return total;
+}
+
 int
 FileWrite(File file, char *buffer, int amount)
 {
@@ -1346,7 +1656,7 @@ FileWrite(File file, char *buffer, int amount)
 	 * message if we do that.  All current callers would just throw error
 	 * immediately anyway, so this is safe at present.
 	 */
-	if (temp_file_limit >= 0 && (VfdCache[file].fdstate & FD_TEMPORARY))
+	if (temp_file_limit >= 0 && (VfdCache[file].fdstate & FD_TEMP_FILE_LIMIT))
 	{
 		off_t		newPos = VfdCache[file].seekPos + amount;
 
@@ -1376,7 +1686,7 @@ retry:
 		VfdCache[file].seekPos += returnCode;
 
 		/* maintain fileSize and temporary_files_size if it's a temp file */
-		if (VfdCache[file].fdstate & FD_TEMPORARY)
+		if (VfdCache[file].fdstate & FD_TEMP_FILE_LIMIT)
 		{
 			off_t		newPos = VfdCache[file].seekPos;
 
@@ -1533,7 +1843,7 @@ FileTruncate(File file, off_t offset)
 	if (returnCode == 0 && VfdCache[file].fileSize > offset)
 	{
 		/* adjust our state for truncation of a temp file */
-		Assert(VfdCache[file].fdstate & FD_TEMPORARY);
+		Assert(VfdCache[file].fdstate & FD_TEMP_FILE_LIMIT);
 		temporary_files_size -= VfdCache[file].fileSize - offset;
 		VfdCache[file].fileSize = offset;
 	}
@@ -2085,6 +2395,26 @@ TempTablespacesAreSet(void)
 	return (numTempTableSpaces >= 0);
 }
 
+/*
+ * GetTempTablespaces
+ *
+ * Populate an array with the OIDs of the tablespaces that should be used for
+ * temporary files.  Return the number that were copied into the output
+ * array, which is at most numSpaces.  Zero means the database's default
+ * tablespace should be used.
+ */
+int
+GetTempTablespaces(Oid *tableSpaces, int numSpaces)
+{
+	int			i;
+
+	Assert(TempTablespacesAreSet());
+	for (i = 0; i < numTempTableSpaces && i < numSpaces; ++i)
+		tableSpaces[i] = tempTableSpaces[i];
+
+	return i;
+}
+
 /*
  * GetNextTempTableSpace
  *
@@ -2188,7 +2518,8 @@ CleanupTempFiles(bool isProcExit)
 		{
 			unsigned short fdstate = VfdCache[i].fdstate;
 
-			if ((fdstate & FD_TEMPORARY) && VfdCache[i].fileName != NULL)
+			if ((fdstate & (FD_TEMPORARY | FD_XACT_TEMPORARY)) &&
+				VfdCache[i].fileName != NULL)
 			{
 				/*
 				 * If we're in the process of exiting a backend process, close
@@ -0,0 +1,272 @@
+/*-------------------------------------------------------------------------
+ *
+ * sharedfileset.c
+ *	  Shared temporary file management.
+ *
+ * Portions Copyright (c) 1996-2015, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * IDENTIFICATION
+ *	  src/backend/storage/file/sharedfileset.c
+ *
+ * NOTES:
+ *
+ * SharedFileSets provide a temporary namespace (think directory) so that
+ * files can be discovered by name, and a shared ownership semantics so that
+ * shared files survive until the last user detaches.  All files belonging
+ * to one set are created directly in the temporary-files directory of one
+ * of the set's tablespaces, with names of the form
+ *
+ *		pgsql_tmp<creator pid>.<set number>.fileset.<name>
+ *
+ * so that they are removed by RemovePgTempFiles after a crash like any
+ * other temporary file, and so that SharedFileSetDeleteAll can find them
+ * with a simple directory scan.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include "access/hash.h"
+#include "catalog/pg_tablespace.h"
+#include "commands/tablespace.h"
+#include "miscadmin.h"
+#include "storage/sharedfileset.h"
+
+static void SharedFileSetOnDetach(dsm_segment *segment, Datum datum);
+static void SharedFileSetPrefix(char *prefix, SharedFileSet *fileset);
+static void SharedFilePath(char *path, SharedFileSet *fileset,
+			   const char *name);
+static Oid	ChooseTablespace(const SharedFileSet *fileset, const char *name);
+
+/*
+ * Initialize a space for temporary files that can be opened by other
+ * backends.  Other backends must attach to it before accessing it.
+ * Associate this SharedFileSet with 'seg'.  Any contained files will be
+ * deleted when the last backend detaches.
+ *
+ * Files will be distributed over the tablespaces configured in
+ * temp_tablespaces.
+ *
+ * If seg is NULL, the caller is responsible for calling
+ * SharedFileSetDeleteAll.
+ */
+void
+SharedFileSetInit(SharedFileSet *fileset, dsm_segment *seg)
+{
+	static uint32 counter = 0;
+
+	SpinLockInit(&fileset->mutex);
+	fileset->refcnt = 1;
+	fileset->creator_pid = MyProcPid;
+	fileset->number = counter;
+	counter = (counter + 1) % INT_MAX;
+
+	/* Capture the tablespace OIDs so that all backends agree on them. */
+	PrepareTempTablespaces();
+	fileset->ntablespaces =
+		GetTempTablespaces(&fileset->tablespaces[0],
+						   lengthof(fileset->tablespaces));
+	if (fileset->ntablespaces == 0)
+	{
+		fileset->tablespaces[0] = MyDatabaseTableSpace ?
+			MyDatabaseTableSpace : DEFAULTTABLESPACE_OID;
+		fileset->ntablespaces = 1;
+	}
+
+	/* Register our cleanup callback. */
+	if (seg)
+		on_dsm_detach(seg, SharedFileSetOnDetach, PointerGetDatum(fileset));
+}
+
+/*
+ * Attach to a set of files that was created with SharedFileSetInit.
+ */
+void
+SharedFileSetAttach(SharedFileSet *fileset, dsm_segment *seg)
+{
+	bool		success;
+
+	SpinLockAcquire(&fileset->mutex);
+	if (fileset->refcnt == 0)
+		success = false;
+	else
+	{
+		++fileset->refcnt;
+		success = true;
+	}
+	SpinLockRelease(&fileset->mutex);
+
+	if (!success)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("could not attach to a SharedFileSet that is already destroyed")));
+
+	/* Register our cleanup callback. */
+	on_dsm_detach(seg, SharedFileSetOnDetach, PointerGetDatum(fileset));
+}
+
+/*
+ * Create a new file in the given set.  It is an error to create a file
+ * whose name is already in use in this set.
+ */
+File
+SharedFileSetCreate(SharedFileSet *fileset, const char *name)
+{
+	char		path[MAXPGPATH];
+
+	SharedFilePath(path, fileset, name);
+	return PathNameCreateTemporaryFile(path, true);
+}
+
+/*
+ * Open a file that was created with SharedFileSetCreate(), possibly in
+ * another backend.  Returns a value <= 0 if there is no such file.
+ */
+File
+SharedFileSetOpen(SharedFileSet *fileset, const char *name)
+{
+	char		path[MAXPGPATH];
+
+	SharedFilePath(path, fileset, name);
+	return PathNameOpenTemporaryFile(path);
+}
+
+/*
+ * Delete a file that was created with SharedFileSetCreate().
+ * Return true if the file existed, false if it didn't.
+ */
+bool
+SharedFileSetDelete(SharedFileSet *fileset, const char *name,
+					bool error_on_failure)
+{
+	char		path[MAXPGPATH];
+
+	SharedFilePath(path, fileset, name);
+	return PathNameDeleteTemporaryFile(path, error_on_failure);
+}
+
+/*
+ * Delete all files in the set.
+ */
+void
+SharedFileSetDeleteAll(SharedFileSet *fileset)
+{
+	char		prefix[MAXPGPATH];
+	int			i;
+
+	SharedFileSetPrefix(prefix, fileset);
+
+	for (i = 0; i < fileset->ntablespaces; ++i)
+	{
+		char		dirpath[MAXPGPATH];
+		DIR		   *dir;
+		struct dirent *de;
+		int			j;
+
+		/* Don't scan the same directory twice. */
+		for (j = 0; j < i; ++j)
+			if (fileset->tablespaces[j] == fileset->tablespaces[i])
+				break;
+		if (j < i)
+			continue;
+
+		TempTablespacePath(dirpath, fileset->tablespaces[i]);
+		dir = AllocateDir(dirpath);
+		if (dir == NULL)
+		{
+			/* If no file was ever created there, the directory may not exist */
+			if (errno == ENOENT)
+				continue;
+			ereport(LOG,
+					(errcode_for_file_access(),
+					 errmsg("could not open directory \"%s\": %m", dirpath)));
+			continue;
+		}
+
+		while ((de = ReadDir(dir, dirpath)) != NULL)
+		{
+			char		path[MAXPGPATH];
+
+			if (strncmp(de->d_name, prefix, strlen(prefix)) != 0)
+				continue;
+
+			/* A name too long to be ours can't belong to the set */
+			if (snprintf(path, MAXPGPATH, "%s/%s",
+						 dirpath, de->d_name) >= MAXPGPATH)
+				continue;
+			PathNameDeleteTemporaryFile(path, false);
+		}
+
+		FreeDir(dir);
+	}
+}
+
+/*
+ * Callback function that will be invoked when this backend detaches from a
+ * DSM segment holding a SharedFileSet that it has created or attached to.
+ * If we are the last to detach, then try to remove the files.  Everything
+ * here is best effort, because this might run during error cleanup.
+ */
+static void
+SharedFileSetOnDetach(dsm_segment *segment, Datum datum)
+{
+	bool		unlink_all = false;
+	SharedFileSet *fileset = (SharedFileSet *) DatumGetPointer(datum);
+
+	SpinLockAcquire(&fileset->mutex);
+	Assert(fileset->refcnt > 0);
+	if (--fileset->refcnt == 0)
+		unlink_all = true;
+	SpinLockRelease(&fileset->mutex);
+
+	/*
+	 * If we are the last to detach, we delete the files.  There is no need
+	 * for locking because no one else can be attached at this point.
+	 */
+	if (unlink_all)
+		SharedFileSetDeleteAll(fileset);
+}
+
+/*
+ * Build the file name prefix shared by all files of a set.
+ */
+static void
+SharedFileSetPrefix(char *prefix, SharedFileSet *fileset)
+{
+	snprintf(prefix, MAXPGPATH, "%s%lu.%u.fileset.",
+			 PG_TEMP_FILE_PREFIX,
+			 (unsigned long) fileset->creator_pid, fileset->number);
+}
+
+/*
+ * Build the path of a named file within a set.
+ */
+static void
+SharedFilePath(char *path, SharedFileSet *fileset, const char *name)
+{
+	char		dirpath[MAXPGPATH];
+	char		prefix[MAXPGPATH];
+
+	Assert(strchr(name, '/') == NULL);
+
+	TempTablespacePath(dirpath, ChooseTablespace(fileset, name));
+	SharedFileSetPrefix(prefix, fileset);
+	if (snprintf(path, MAXPGPATH, "%s/%s%s",
+				 dirpath, prefix, name) >= MAXPGPATH)
+		elog(ERROR, "path of shared file \"%s\" is too long", name);
+}
+
+/*
+ * Sorting hat to determine which tablespace a given shared temporary file
+ * belongs in.
+ */
+static Oid
+ChooseTablespace(const SharedFileSet *fileset, const char *name)
+{
+	uint32		hash = DatumGetUInt32(hash_any((const unsigned char *) name,
+											   strlen(name)));
+
+	return fileset->tablespaces[hash % fileset->ntablespaces];
+}
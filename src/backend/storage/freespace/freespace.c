@@ -108,6 +108,7 @@ static Size fsm_space_cat_to_avail(uint8 cat);
 static int fsm_set_and_search(Relation rel, FSMAddress addr, uint16 slot,
 				   uint8 newValue, uint8 minValue);
 static BlockNumber fsm_search(Relation rel, uint8 min_cat);
+static void fsm_bubble_up(Relation rel, FSMAddress addr, uint8 value);
 static uint8 fsm_vacuum_page(Relation rel, FSMAddress addr, bool *eof);
 
 
@@ -188,6 +189,46 @@ RecordPageWithFreeSpace(Relation rel, BlockNumber heapBlk, Size spaceAvail)
 	fsm_set_and_search(rel, addr, slot, new_cat, 0);
 }
 
+/*
+ * RecordNewPagesWithFreeSpace - update info about a range of new pages.
+ *
+ * This is meant for pages just added to the end of the relation in bulk,
+ * which each have spaceAvail free.  Unlike RecordPageWithFreeSpace, the
+ * upper levels of the tree are updated too, so that other backends can
+ * find the new pages right away instead of after the next vacuum.
+ */
+void
+RecordNewPagesWithFreeSpace(Relation rel, BlockNumber startBlk,
+							BlockNumber nblocks, Size spaceAvail)
+{
+	uint8		new_cat = fsm_space_avail_to_cat(spaceAvail);
+	BlockNumber heapBlk = startBlk;
+	BlockNumber endBlk = startBlk + nblocks;
+
+	while (heapBlk < endBlk)
+	{
+		FSMAddress	addr;
+		uint16		slot;
+		Buffer		buf;
+		Page		page;
+		bool		changed = false;
+
+		/* Set the leaf slots of all our pages on this bottom-level page */
+		addr = fsm_get_location(heapBlk, &slot);
+		buf = fsm_readbuf(rel, addr, true);
+		LockBuffer(buf, BUFFER_LOCK_EXCLUSIVE);
+		page = BufferGetPage(buf);
+		for (; slot < SlotsPerFSMPage && heapBlk < endBlk; slot++, heapBlk++)
+			changed |= fsm_set_avail(page, slot, new_cat);
+		if (changed)
+			MarkBufferDirtyHint(buf, false);
+		UnlockReleaseBuffer(buf);
+
+		/* and make sure the levels above know about them */
+		fsm_bubble_up(rel, addr, new_cat);
+	}
+}
+
 /*
  * XLogRecordPageWithFreeSpace - like RecordPageWithFreeSpace, for use in
  *		WAL replay
@@ -633,6 +674,32 @@ fsm_set_and_search(Relation rel, FSMAddress addr, uint16 slot,
 	return newslot;
 }
 
+/*
+ * Raise the slot of each ancestor of the given page to at least 'value'.
+ */
+static void
+fsm_bubble_up(Relation rel, FSMAddress addr, uint8 value)
+{
+	while (addr.level != FSM_ROOT_LEVEL)
+	{
+		uint16		parentslot;
+		Buffer		buf;
+		Page		page;
+
+		addr = fsm_get_parent(addr, &parentslot);
+
+		buf = fsm_readbuf(rel, addr, true);
+		LockBuffer(buf, BUFFER_LOCK_EXCLUSIVE);
+		page = BufferGetPage(buf);
+		if (fsm_get_avail(page, parentslot) < value)
+		{
+			fsm_set_avail(page, parentslot, value);
+			MarkBufferDirtyHint(buf, false);
+		}
+		UnlockReleaseBuffer(buf);
+	}
+}
+
 /*
  * Search the tree for a heap page with at least min_cat of free space
  */
@@ -19,6 +19,7 @@
 #include "miscadmin.h"
 #include "storage/ipc.h"
 #include "storage/sinvaladt.h"
+#include "utils/catcache.h"
 #include "utils/inval.h"
 
 
@@ -54,6 +55,9 @@ static void ProcessCatchupEvent(void);
 void
 SendSharedInvalidMessages(const SharedInvalidationMessage *msgs, int n)
 {
+	/* shared catalog cache must be clean before anyone sees the messages */
+	SharedCatCacheInvalidate(msgs, n);
+
 	SIInsertDataEntries(msgs, n);
 }
 
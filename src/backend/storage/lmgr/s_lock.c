@@ -21,6 +21,12 @@
 #include "storage/s_lock.h"
 #include "storage/barrier.h"
 
+#define MIN_SPINS_PER_DELAY 10
+#define MAX_SPINS_PER_DELAY 1000
+#define NUM_DELAYS			1000
+#define MIN_DELAY_USEC		1000L
+#define MAX_DELAY_USEC		1000000L
+
 slock_t		dummy_spinlock;
 
 static int	spins_per_delay = DEFAULT_SPINS_PER_DELAY;
@@ -30,25 +36,80 @@ static int	spins_per_delay = DEFAULT_SPINS_PER_DELAY;
  * s_lock_stuck() - complain about a stuck spinlock
  */
 static void
-s_lock_stuck(volatile slock_t *lock, const char *file, int line)
+s_lock_stuck(void *p, const char *file, int line)
 {
 #if defined(S_LOCK_TEST)
 	fprintf(stderr,
 			"\nStuck spinlock (%p) detected at %s:%d.\n",
-			lock, file, line);
+			p, file, line);
 	exit(1);
 #else
 	elog(PANIC, "stuck spinlock (%p) detected at %s:%d",
-		 lock, file, line);
+		 p, file, line);
 #endif
 }
 
-
 /*
  * s_lock(lock) - platform-independent portion of waiting for a spinlock.
+ *
+ * See perform_spin_delay() for a description of the delay logic.
  */
 int
 s_lock(volatile slock_t *lock, const char *file, int line)
+{
+	SpinDelayStatus delayStatus;
+
+	init_spin_delay(&delayStatus, (void *) lock, file, line);
+
+	while (TAS_SPIN(lock))
+	{
+		perform_spin_delay(&delayStatus);
+	}
+
+	finish_spin_delay(&delayStatus);
+
+	return delayStatus.delays;
+}
+
+#ifdef USE_DEFAULT_S_UNLOCK
+void
+s_unlock(volatile slock_t *lock)
+{
+#ifdef TAS_ACTIVE_WORD
+	/* HP's PA-RISC */
+	*TAS_ACTIVE_WORD(lock) = -1;
+#else
+	*lock = 0;
+#endif
+}
+#endif
+
+/*
+ * Spin delay support.  The logic here is shared between s_lock() and other
+ * spinlock-like loops, e.g. the one acquiring a buffer header lock, which
+ * is a bit in an atomic variable rather than a slock_t.
+ */
+
+/*
+ * init_spin_delay() - prepare to wait for a spinlock-like lock.
+ */
+void
+init_spin_delay(SpinDelayStatus *status, void *ptr,
+				const char *file, int line)
+{
+	status->spins = 0;
+	status->delays = 0;
+	status->cur_delay = 0;
+	status->ptr = ptr;
+	status->file = file;
+	status->line = line;
+}
+
+/*
+ * perform_spin_delay() - wait once for a spinlock-like lock.
+ */
+void
+perform_spin_delay(SpinDelayStatus *status)
 {
 	/*
 	 * We loop tightly for awhile, then delay using pg_usleep() and try again.
@@ -83,48 +144,43 @@ s_lock(volatile slock_t *lock, const char *file, int line)
 	 * the probability of unintended failure) than to fix the total time
 	 * spent.
 	 */
-#define MIN_SPINS_PER_DELAY 10
-#define MAX_SPINS_PER_DELAY 1000
-#define NUM_DELAYS			1000
-#define MIN_DELAY_USEC		1000L
-#define MAX_DELAY_USEC		1000000L
 
-	int			spins = 0;
-	int			delays = 0;
-	int			cur_delay = 0;
+	/* CPU-specific delay each time through the loop */
+	SPIN_DELAY();
 
-	while (TAS_SPIN(lock))
+	/* Block the process every spins_per_delay tries */
+	if (++(status->spins) >= spins_per_delay)
 	{
-		/* CPU-specific delay each time through the loop */
-		SPIN_DELAY();
+		if (++(status->delays) > NUM_DELAYS)
+			s_lock_stuck(status->ptr, status->file, status->line);
 
-		/* Block the process every spins_per_delay tries */
-		if (++spins >= spins_per_delay)
-		{
-			if (++delays > NUM_DELAYS)
-				s_lock_stuck(lock, file, line);
+		if (status->cur_delay == 0)		/* first time to delay? */
+			status->cur_delay = MIN_DELAY_USEC;
 
-			if (cur_delay == 0) /* first time to delay? */
-				cur_delay = MIN_DELAY_USEC;
-
-			pg_usleep(cur_delay);
+		pg_usleep(status->cur_delay);
 
 #if defined(S_LOCK_TEST)
-			fprintf(stdout, "*");
-			fflush(stdout);
+		fprintf(stdout, "*");
+		fflush(stdout);
 #endif
 
-			/* increase delay by a random fraction between 1X and 2X */
-			cur_delay += (int) (cur_delay *
+		/* increase delay by a random fraction between 1X and 2X */
+		status->cur_delay += (int) (status->cur_delay *
 					  ((double) random() / (double) MAX_RANDOM_VALUE) + 0.5);
-			/* wrap back to minimum delay when max is exceeded */
-			if (cur_delay > MAX_DELAY_USEC)
-				cur_delay = MIN_DELAY_USEC;
+		/* wrap back to minimum delay when max is exceeded */
+		if (status->cur_delay > MAX_DELAY_USEC)
+			status->cur_delay = MIN_DELAY_USEC;
 
-			spins = 0;
-		}
+		status->spins = 0;
 	}
+}
 
+/*
+ * finish_spin_delay() - adjust spins_per_delay after acquiring the lock.
+ */
+void
+finish_spin_delay(SpinDelayStatus *status)
+{
 	/*
 	 * If we were able to acquire the lock without delaying, it's a good
 	 * indication we are in a multiprocessor.  If we had to delay, it's a sign
@@ -140,7 +196,7 @@ s_lock(volatile slock_t *lock, const char *file, int line)
 	 * backend might not live long enough to converge on a good value.  That
 	 * is handled by the two routines below.
 	 */
-	if (cur_delay == 0)
+	if (status->cur_delay == 0)
 	{
 		/* we never had to delay */
 		if (spins_per_delay < MAX_SPINS_PER_DELAY)
@@ -151,22 +207,8 @@ s_lock(volatile slock_t *lock, const char *file, int line)
 		if (spins_per_delay > MIN_SPINS_PER_DELAY)
 			spins_per_delay = Max(spins_per_delay - 1, MIN_SPINS_PER_DELAY);
 	}
-	return delays;
 }
 
-#ifdef USE_DEFAULT_S_UNLOCK
-void
-s_unlock(volatile slock_t *lock)
-{
-#ifdef TAS_ACTIVE_WORD
-	/* HP's PA-RISC */
-	*TAS_ACTIVE_WORD(lock) = -1;
-#else
-	*lock = 0;
-#endif
-}
-#endif
-
 /*
  * Set local copy of spins_per_delay during backend startup.
  *
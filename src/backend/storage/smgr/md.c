@@ -43,6 +43,9 @@
 #define FSYNCS_PER_ABSORB		10
 #define UNLINKS_PER_ABSORB		10
 
+/* largest number of zeroed blocks mdzeroextend writes with one write() */
+#define MD_ZEROEXTEND_MAX_BLOCKS	64
+
 /*
  * Special values for the segno arg to RememberFsyncRequest.
  *
@@ -554,6 +557,93 @@ mdextend(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 	Assert(_mdnblocks(reln, forknum, v) <= ((BlockNumber) RELSEG_SIZE));
 }
 
+/*
+ *	mdzeroextend() -- Add nblocks zero-filled blocks to the specified relation,
+ *		starting at blocknum.
+ *
+ *		This is equivalent to calling mdextend() with an all-zeroes page for
+ *		each block, but writes as many blocks per write() as it can.  The
+ *		zeroes are really written out, rather than leaving a hole in the
+ *		file, so that running out of disk space is reported here and not
+ *		when the buffers are eventually written back.
+ */
+void
+mdzeroextend(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
+			 int nblocks, bool skipFsync)
+{
+	char	   *zerobuf;
+	int			bufblocks;
+
+	Assert(nblocks > 0);
+
+	/* This assert is too expensive to have on normally ... */
+#ifdef CHECK_WRITE_VS_EXTEND
+	Assert(blocknum >= mdnblocks(reln, forknum));
+#endif
+
+	/* As in mdextend, never create a block numbered InvalidBlockNumber */
+	if ((uint64) blocknum + nblocks > (uint64) InvalidBlockNumber)
+		ereport(ERROR,
+				(errcode(ERRCODE_PROGRAM_LIMIT_EXCEEDED),
+				 errmsg("cannot extend file \"%s\" beyond %u blocks",
+						relpath(reln->smgr_rnode, forknum),
+						InvalidBlockNumber)));
+
+	bufblocks = Min(nblocks, MD_ZEROEXTEND_MAX_BLOCKS);
+	zerobuf = palloc0((Size) bufblocks * BLCKSZ);
+
+	while (nblocks > 0)
+	{
+		MdfdVec    *v;
+		off_t		seekpos;
+		int			segblocks;
+		int			amount;
+		int			nbytes;
+
+		v = _mdfd_getseg(reln, forknum, blocknum, skipFsync, EXTENSION_CREATE);
+
+		seekpos = (off_t) BLCKSZ *(blocknum % ((BlockNumber) RELSEG_SIZE));
+
+		/* don't write across a segment boundary */
+		segblocks = Min(bufblocks, RELSEG_SIZE - blocknum % RELSEG_SIZE);
+		segblocks = Min(segblocks, nblocks);
+		amount = segblocks * BLCKSZ;
+
+		if (FileSeek(v->mdfd_vfd, seekpos, SEEK_SET) != seekpos)
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not seek to block %u in file \"%s\": %m",
+							blocknum, FilePathName(v->mdfd_vfd))));
+
+		if ((nbytes = FileWrite(v->mdfd_vfd, zerobuf, amount)) != amount)
+		{
+			if (nbytes < 0)
+				ereport(ERROR,
+						(errcode_for_file_access(),
+						 errmsg("could not extend file \"%s\": %m",
+								FilePathName(v->mdfd_vfd)),
+						 errhint("Check free disk space.")));
+			/* short write: complain appropriately */
+			ereport(ERROR,
+					(errcode(ERRCODE_DISK_FULL),
+					 errmsg("could not extend file \"%s\": wrote only %d of %d bytes at block %u",
+							FilePathName(v->mdfd_vfd),
+							nbytes, amount, blocknum),
+					 errhint("Check free disk space.")));
+		}
+
+		if (!skipFsync && !SmgrIsTemp(reln))
+			register_dirty_segment(reln, forknum, v);
+
+		Assert(_mdnblocks(reln, forknum, v) <= ((BlockNumber) RELSEG_SIZE));
+
+		blocknum += segblocks;
+		nblocks -= segblocks;
+	}
+
+	pfree(zerobuf);
+}
+
 /*
  *	mdopen() -- Open the specified relation.
  *
@@ -643,22 +733,36 @@ mdclose(SMgrRelation reln, ForkNumber forknum)
 }
 
 /*
- *	mdprefetch() -- Initiate asynchronous read of the specified block of a relation
+ *	mdprefetch() -- Initiate asynchronous read of the specified blocks of a relation
+ *
+ * The range is split at segment boundaries, so that each file gets a single
+ * hint for its part of it.
  */
 void
-mdprefetch(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum)
+mdprefetch(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
+		   BlockNumber nblocks)
 {
 #ifdef USE_PREFETCH
-	off_t		seekpos;
-	MdfdVec    *v;
+	while (nblocks > 0)
+	{
+		BlockNumber nfetch;
+		off_t		seekpos;
+		MdfdVec    *v;
 
-	v = _mdfd_getseg(reln, forknum, blocknum, false, EXTENSION_FAIL);
+		v = _mdfd_getseg(reln, forknum, blocknum, false, EXTENSION_FAIL);
 
-	seekpos = (off_t) BLCKSZ *(blocknum % ((BlockNumber) RELSEG_SIZE));
+		seekpos = (off_t) BLCKSZ *(blocknum % ((BlockNumber) RELSEG_SIZE));
 
-	Assert(seekpos < (off_t) BLCKSZ * RELSEG_SIZE);
+		Assert(seekpos < (off_t) BLCKSZ * RELSEG_SIZE);
 
-	(void) FilePrefetch(v->mdfd_vfd, seekpos, BLCKSZ);
+		nfetch = Min(nblocks,
+					 RELSEG_SIZE - (blocknum % ((BlockNumber) RELSEG_SIZE)));
+
+		(void) FilePrefetch(v->mdfd_vfd, seekpos, BLCKSZ * nfetch);
+
+		nblocks -= nfetch;
+		blocknum += nfetch;
+	}
 #endif   /* USE_PREFETCH */
 }
 
@@ -729,6 +833,80 @@ mdread(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 	}
 }
 
+/*
+ *	mdreadv() -- Read a range of consecutive blocks from a relation.
+ *
+ *		buffers[i] receives block blocknum + i.  The blocks are read with one
+ *		vectored read per segment.  If that comes up short, the remaining
+ *		blocks are read one at a time with mdread(), so that running into EOF
+ *		is reported (or zeroed) exactly as for a single-block read.
+ */
+void
+mdreadv(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
+		char **buffers, BlockNumber nblocks)
+{
+	while (nblocks > 0)
+	{
+		BlockNumber nread;
+		BlockNumber ndone;
+		off_t		seekpos;
+		int			nbytes;
+		MdfdVec    *v;
+
+		TRACE_POSTGRESQL_SMGR_MD_READ_START(forknum, blocknum,
+											reln->smgr_rnode.node.spcNode,
+											reln->smgr_rnode.node.dbNode,
+											reln->smgr_rnode.node.relNode,
+											reln->smgr_rnode.backend);
+
+		v = _mdfd_getseg(reln, forknum, blocknum, false, EXTENSION_FAIL);
+
+		seekpos = (off_t) BLCKSZ *(blocknum % ((BlockNumber) RELSEG_SIZE));
+
+		Assert(seekpos < (off_t) BLCKSZ * RELSEG_SIZE);
+
+		/* don't read past the end of this segment */
+		nread = Min(nblocks,
+					RELSEG_SIZE - (blocknum % ((BlockNumber) RELSEG_SIZE)));
+
+		if (FileSeek(v->mdfd_vfd, seekpos, SEEK_SET) != seekpos)
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not seek to block %u in file \"%s\": %m",
+							blocknum, FilePathName(v->mdfd_vfd))));
+
+		nbytes = FileReadv(v->mdfd_vfd, buffers, nread, BLCKSZ);
+
+		TRACE_POSTGRESQL_SMGR_MD_READ_DONE(forknum, blocknum,
+										   reln->smgr_rnode.node.spcNode,
+										   reln->smgr_rnode.node.dbNode,
+										   reln->smgr_rnode.node.relNode,
+										   reln->smgr_rnode.backend,
+										   nbytes,
+										   BLCKSZ * nread);
+
+		if (nbytes < 0)
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not read blocks %u..%u in file \"%s\": %m",
+							blocknum, blocknum + nread - 1,
+							FilePathName(v->mdfd_vfd))));
+
+		ndone = nbytes / BLCKSZ;
+		if (ndone < nread)
+		{
+			/* short read: let mdread deal with the rest */
+			for (; ndone < nblocks; ndone++)
+				mdread(reln, forknum, blocknum + ndone, buffers[ndone]);
+			return;
+		}
+
+		nblocks -= nread;
+		blocknum += nread;
+		buffers += nread;
+	}
+}
+
 /*
  *	mdwrite() -- Write the supplied block at the appropriate location.
  *
@@ -798,6 +976,58 @@ mdwrite(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 		register_dirty_segment(reln, forknum, v);
 }
 
+/*
+ *	mdwriteback() -- Tell the kernel to write pages back to storage.
+ *
+ * This accepts a range of blocks because flushing several pages at once is
+ * considerably more efficient than doing so individually.
+ */
+void
+mdwriteback(SMgrRelation reln, ForkNumber forknum,
+			BlockNumber blocknum, BlockNumber nblocks)
+{
+	/*
+	 * Issue flush requests in as few requests as possible; have to split at
+	 * segment boundaries though, since those are actually separate files.
+	 */
+	while (nblocks > 0)
+	{
+		BlockNumber nflush = nblocks;
+		off_t		seekpos;
+		MdfdVec    *v;
+		int			segnum_start,
+					segnum_end;
+
+		v = _mdfd_getseg(reln, forknum, blocknum, true /* not used */ ,
+						 EXTENSION_RETURN_NULL);
+
+		/*
+		 * We might be flushing buffers of already removed relations, that's
+		 * ok, just ignore that case.
+		 */
+		if (!v)
+			return;
+
+		/* compute offset inside the current segment */
+		segnum_start = blocknum / RELSEG_SIZE;
+
+		/* compute number of desired writes within the current segment */
+		segnum_end = (blocknum + nblocks - 1) / RELSEG_SIZE;
+		if (segnum_start != segnum_end)
+			nflush = RELSEG_SIZE - (blocknum % ((BlockNumber) RELSEG_SIZE));
+
+		Assert(nflush >= 1);
+		Assert(nflush <= nblocks);
+
+		seekpos = (off_t) BLCKSZ *(blocknum % ((BlockNumber) RELSEG_SIZE));
+
+		FileWriteback(v->mdfd_vfd, seekpos, (off_t) BLCKSZ * nflush);
+
+		nblocks -= nflush;
+		blocknum += nflush;
+	}
+}
+
 /*
  *	mdnblocks() -- Get the number of blocks stored in a relation.
  *
@@ -47,12 +47,18 @@ typedef struct f_smgr
 											bool isRedo);
 	void		(*smgr_extend) (SMgrRelation reln, ForkNumber forknum,
 						 BlockNumber blocknum, char *buffer, bool skipFsync);
+	void		(*smgr_zeroextend) (SMgrRelation reln, ForkNumber forknum,
+							BlockNumber blocknum, int nblocks, bool skipFsync);
 	void		(*smgr_prefetch) (SMgrRelation reln, ForkNumber forknum,
-											  BlockNumber blocknum);
+							 BlockNumber blocknum, BlockNumber nblocks);
 	void		(*smgr_read) (SMgrRelation reln, ForkNumber forknum,
 										  BlockNumber blocknum, char *buffer);
+	void		(*smgr_readv) (SMgrRelation reln, ForkNumber forknum,
+					BlockNumber blocknum, char **buffers, BlockNumber nblocks);
 	void		(*smgr_write) (SMgrRelation reln, ForkNumber forknum,
 						 BlockNumber blocknum, char *buffer, bool skipFsync);
+	void		(*smgr_writeback) (SMgrRelation reln, ForkNumber forknum,
+							   BlockNumber blocknum, BlockNumber nblocks);
 	BlockNumber (*smgr_nblocks) (SMgrRelation reln, ForkNumber forknum);
 	void		(*smgr_truncate) (SMgrRelation reln, ForkNumber forknum,
 											  BlockNumber nblocks);
@@ -66,8 +72,8 @@ typedef struct f_smgr
 static const f_smgr smgrsw[] = {
 	/* magnetic disk */
 	{mdinit, NULL, mdclose, mdcreate, mdexists, mdunlink, mdextend,
-		mdprefetch, mdread, mdwrite, mdnblocks, mdtruncate, mdimmedsync,
-		mdpreckpt, mdsync, mdpostckpt
+		mdzeroextend, mdprefetch, mdread, mdreadv, mdwrite, mdwriteback,
+		mdnblocks, mdtruncate, mdimmedsync, mdpreckpt, mdsync, mdpostckpt
 	}
 };
 
@@ -603,12 +609,30 @@ smgrextend(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 }
 
 /*
- *	smgrprefetch() -- Initiate asynchronous read of the specified block of a relation.
+ *	smgrzeroextend() -- Add nblocks zero-filled blocks to a file.
+ *
+ *		Like calling smgrextend() for each of blocknum .. blocknum + nblocks - 1
+ *		with an all-zeroes page, but lets the storage manager do it with
+ *		fewer, larger writes.
+ */
+void
+smgrzeroextend(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
+			   int nblocks, bool skipFsync)
+{
+	(*(smgrsw[reln->smgr_which].smgr_zeroextend)) (reln, forknum, blocknum,
+												   nblocks, skipFsync);
+}
+
+/*
+ *	smgrprefetch() -- Initiate asynchronous read of the specified blocks of a
+ *					  relation.
  */
 void
-smgrprefetch(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum)
+smgrprefetch(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
+			 BlockNumber nblocks)
 {
-	(*(smgrsw[reln->smgr_which].smgr_prefetch)) (reln, forknum, blocknum);
+	(*(smgrsw[reln->smgr_which].smgr_prefetch)) (reln, forknum, blocknum,
+												 nblocks);
 }
 
 /*
@@ -626,6 +650,22 @@ smgrread(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 	(*(smgrsw[reln->smgr_which].smgr_read)) (reln, forknum, blocknum, buffer);
 }
 
+/*
+ *	smgrreadv() -- read a range of consecutive blocks from a relation into
+ *				   the supplied buffers.
+ *
+ *		buffers[i] receives block blocknum + i.  This is equivalent to
+ *		calling smgrread() for each block, but lets the storage manager
+ *		combine the reads into fewer system calls.
+ */
+void
+smgrreadv(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
+		  char **buffers, BlockNumber nblocks)
+{
+	(*(smgrsw[reln->smgr_which].smgr_readv)) (reln, forknum, blocknum,
+											  buffers, nblocks);
+}
+
 /*
  *	smgrwrite() -- Write the supplied buffer out.
  *
@@ -649,6 +689,18 @@ smgrwrite(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 											  buffer, skipFsync);
 }
 
+/*
+ *	smgrwriteback() -- Trigger kernel writeback for the supplied range of
+ *					   blocks.
+ */
+void
+smgrwriteback(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
+			  BlockNumber nblocks)
+{
+	(*(smgrsw[reln->smgr_which].smgr_writeback)) (reln, forknum, blocknum,
+												  nblocks);
+}
+
 /*
  *	smgrnblocks() -- Calculate the number of blocks in the
  *					 supplied relation.
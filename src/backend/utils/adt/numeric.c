@@ -3023,6 +3023,64 @@ int8_avg_accum(PG_FUNCTION_ARGS)
 	PG_RETURN_POINTER(state);
 }
 
+/*
+ * Add a number of int8 values to the transition state of int8_avg_accum, as
+ * if they had been passed to it one at a time; the state is created if
+ * statedatum is a null pointer.  The values are given by their count and
+ * their sum, which is sum_hi * 2^32 + sum_lo.  fcinfo must be set up for
+ * calling int8_avg_accum as an aggregate transition function.
+ *
+ * This is used by the batch mode of plain aggregation, see nodeAgg.c.
+ */
+Datum
+int8_avg_accum_batch(FunctionCallInfo fcinfo, Datum statedatum,
+					 int64 count, int64 sum_hi, int64 sum_lo)
+{
+	NumericAggState *state = (NumericAggState *) DatumGetPointer(statedatum);
+	NumericVar	X;
+	NumericVar	lo;
+	NumericVar	shift;
+	MemoryContext old_context;
+
+	/* Create the state data on the first call */
+	if (state == NULL)
+		state = makeNumericAggState(fcinfo, false);
+
+	if (count == 0)
+		return PointerGetDatum(state);
+
+	/* compute the sum in short-lived context */
+	init_var(&X);
+	init_var(&lo);
+	init_var(&shift);
+	int8_to_numericvar(sum_hi, &X);
+	int8_to_numericvar(INT64CONST(0x100000000), &shift);
+	mul_var(&X, &shift, &X, 0);
+	int8_to_numericvar(sum_lo, &lo);
+	add_var(&X, &lo, &X);
+
+	/* all the inputs had dscale 0, see do_numeric_accum */
+	if (state->maxScale == 0)
+		state->maxScaleCount += count;
+
+	/* The rest of this needs to work in the aggregate context */
+	old_context = MemoryContextSwitchTo(state->agg_context);
+
+	if (state->N > 0)
+		add_var(&X, &(state->sumX), &(state->sumX));
+	else
+		set_var_from_var(&X, &(state->sumX));
+	state->N += count;
+
+	MemoryContextSwitchTo(old_context);
+
+	free_var(&X);
+	free_var(&lo);
+	free_var(&shift);
+
+	return PointerGetDatum(state);
+}
+
 
 /*
  * Inverse transition functions to go with the above.
@@ -3536,6 +3594,29 @@ int4_avg_accum(PG_FUNCTION_ARGS)
 	PG_RETURN_ARRAYTYPE_P(transarray);
 }
 
+/*
+ * Add the count and sum of a number of int2 or int4 values to the
+ * transition array of int2_avg_accum or int4_avg_accum, as if they had been
+ * passed to it one at a time.  The array is modified in place, as those
+ * functions do when invoked as an aggregate.
+ *
+ * This is used by the batch mode of plain aggregation, see nodeAgg.c.
+ */
+void
+int_avg_accum_batch(Datum transdatum, int64 count, int64 sum)
+{
+	ArrayType  *transarray = DatumGetArrayTypeP(transdatum);
+	Int8TransTypeData *transdata;
+
+	if (ARR_HASNULL(transarray) ||
+		ARR_SIZE(transarray) != ARR_OVERHEAD_NONULLS(1) + sizeof(Int8TransTypeData))
+		elog(ERROR, "expected 2-element int8 array");
+
+	transdata = (Int8TransTypeData *) ARR_DATA_PTR(transarray);
+	transdata->count += count;
+	transdata->sum += sum;
+}
+
 Datum
 int2_avg_accum_inv(PG_FUNCTION_ARGS)
 {
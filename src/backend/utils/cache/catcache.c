@@ -24,11 +24,14 @@
 #include "access/xact.h"
 #include "catalog/pg_operator.h"
 #include "catalog/pg_type.h"
+#include "funcapi.h"
 #include "miscadmin.h"
 #ifdef CATCACHE_STATS
 #include "storage/ipc.h"		/* for on_proc_exit */
 #endif
 #include "storage/lmgr.h"
+#include "storage/lwlock.h"
+#include "storage/shmem.h"
 #include "utils/builtins.h"
 #include "utils/fmgroids.h"
 #include "utils/inval.h"
@@ -36,7 +39,9 @@
 #include "utils/rel.h"
 #include "utils/resowner_private.h"
 #include "utils/syscache.h"
+#include "utils/snapmgr.h"
 #include "utils/tqual.h"
+#include "utils/tuplestore.h"
 
 
  /* #define CACHEDEBUG */	/* turns DEBUG elogs on */
@@ -72,6 +77,12 @@
 /* Cache management header --- pointer is NULL until created */
 static CatCacheHeader *CacheHdr = NULL;
 
+/* GUC parameter: limit on total size of all catcaches, in kB (0 = none) */
+int			catalog_cache_max_size = 0;
+
+/* Approximate memory consumed by a cache entry, for the size limit */
+#define CatCTupSize(ct)		(sizeof(CatCTup) + (ct)->tuple.t_len)
+
 
 static uint32 CatalogCacheComputeHashValue(CatCache *cache, int nkeys,
 							 ScanKey cur_skey);
@@ -83,6 +94,7 @@ static void CatCachePrintStats(int code, Datum arg);
 #endif
 static void CatCacheRemoveCTup(CatCache *cache, CatCTup *ct);
 static void CatCacheRemoveCList(CatCache *cache, CatCList *cl);
+static void CatCacheEvict(CatCTup *keep);
 static void CatalogCacheInitializeCache(CatCache *cache);
 static CatCTup *CatalogCacheCreateEntry(CatCache *cache, HeapTuple ntp,
 						uint32 hashValue, Index hashIndex,
@@ -371,8 +383,10 @@ CatCacheRemoveCTup(CatCache *cache, CatCTup *ct)
 		return;					/* nothing left to do */
 	}
 
-	/* delink from linked list */
+	/* delink from linked lists */
 	dlist_delete(&ct->cache_elem);
+	dlist_delete(&ct->lru_elem);
+	CacheHdr->ch_size -= CatCTupSize(ct);
 
 	/* free associated tuple data */
 	if (ct->tuple.t_data != NULL)
@@ -423,6 +437,44 @@ CatCacheRemoveCList(CatCache *cache, CatCList *cl)
 	pfree(cl);
 }
 
+/*
+ *		CatCacheEvict
+ *
+ * Remove least recently used entries, across all caches, until their total
+ * size is within catalog_cache_max_size again.
+ *
+ * Entries that are referenced, directly or through a CatCList, can't be
+ * removed; they are evidently in use, so we move them to the front of the
+ * LRU list and keep going.  "keep" is the entry being added by our caller,
+ * which must survive too.  We give up after looking at each entry once,
+ * so a limit that is too small to hold the working set just means we keep
+ * evicting whatever isn't pinned.
+ */
+static void
+CatCacheEvict(CatCTup *keep)
+{
+	Size		limit = (Size) catalog_cache_max_size * 1024;
+	int			nleft = CacheHdr->ch_ntup;
+
+	while (CacheHdr->ch_size > limit && nleft-- > 0)
+	{
+		CatCTup    *ct;
+
+		ct = dlist_container(CatCTup, lru_elem,
+							 dlist_tail_node(&CacheHdr->ch_lru_list));
+
+		if (ct == keep || ct->refcount > 0 ||
+			(ct->c_list != NULL && ct->c_list->refcount > 0))
+		{
+			dlist_move_head(&CacheHdr->ch_lru_list, &ct->lru_elem);
+			continue;
+		}
+
+		ct->my_cache->cc_evictions++;
+		CatCacheRemoveCTup(ct->my_cache, ct);
+	}
+}
+
 
 /*
  *	CatalogCacheIdInvalidate
@@ -762,6 +814,8 @@ InitCatCache(int id,
 		CacheHdr = (CatCacheHeader *) palloc(sizeof(CatCacheHeader));
 		slist_init(&CacheHdr->ch_caches);
 		CacheHdr->ch_ntup = 0;
+		dlist_init(&CacheHdr->ch_lru_list);
+		CacheHdr->ch_size = 0;
 #ifdef CATCACHE_STATS
 		/* set up to dump stats at backend exit */
 		on_proc_exit(CatCachePrintStats, 0);
@@ -1088,6 +1142,493 @@ IndexScanOK(CatCache *cache, ScanKey cur_skey)
 	return true;
 }
 
+/*
+ *					shared catalog cache
+ *
+ * The shared catalog cache is a read-mostly hash table in shared memory that
+ * holds copies of positive catcache tuples, so that a backend whose local
+ * cache misses (typically a freshly started one) can avoid a catalog index
+ * scan.  It sits underneath the per-backend caches: a local miss first
+ * probes the shared table, and a tuple found there is copied into the local
+ * cache exactly as if it had been read from the catalog.  Negative entries
+ * and CatCLists are kept only locally.
+ *
+ * Entries are removed by the same catcache invalidation messages that flush
+ * the local caches.  SendSharedInvalidMessages calls SharedCatCacheInvalidate
+ * before queuing the messages, so by the time any backend can see a message
+ * the shared table no longer holds the stale tuple.  Since the messages are
+ * sent only after the modifying transaction has become visible, a backend
+ * that loads a tuple from the catalog might still have read the old version
+ * if its snapshot predates the commit.  To keep such a tuple out of the
+ * shared table, each partition has a counter that is advanced by every
+ * invalidation falling into it; a loader reads the counter before taking its
+ * catalog snapshot and only publishes the tuple if the counter is unchanged
+ * afterwards.
+ *
+ * Transactions that have an XID assigned may be looking at catalog changes
+ * of their own that are not yet committed, so they bypass the shared table
+ * altogether.
+ *
+ * The tuples live in fixed-size slots.  Once all slots of a partition are in
+ * use, a new tuple replaces one chosen by a clock sweep over usage counts
+ * that lookups bump, so the table keeps the tuples in current use rather
+ * than whichever came first.  The entries of a dropped database are removed
+ * by dropdb(), as no invalidation message would ever reach them.
+ */
+
+/* GUC parameter: size of the shared catalog cache, in kB (0 = disabled) */
+int			shared_catalog_cache_size = 0;
+
+/* Tuples larger than this are not kept in the shared cache */
+#define SHARED_CATCACHE_MAX_TUPLE	512
+
+/* Usage count limit of a slot, see SharedCatCacheGetSlot */
+#define SHARED_CATCACHE_MAX_USAGE	3
+
+typedef struct SharedCatCacheTag
+{
+	int			cacheId;		/* syscache identifier */
+	Oid			dbId;			/* database, or InvalidOid if shared catalog */
+	uint32		hashValue;		/* catcache hash value of the keys */
+} SharedCatCacheTag;
+
+/* Hash table entry, telling which slot holds the tuple with a given tag */
+typedef struct SharedCatCacheEnt
+{
+	SharedCatCacheTag tag;		/* hash key --- must be first */
+	int			slot;			/* index into SharedCatCache->slots */
+} SharedCatCacheEnt;
+
+/*
+ * A slot holding one tuple.  The slots are divided evenly among the hash
+ * partitions; a slot is only used for tags falling into its partition, and
+ * is protected by that partition's lock.
+ */
+typedef struct SharedCatCacheSlot
+{
+	bool		used;			/* does the slot hold a tuple? */
+	uint8		usage_count;	/* recent hits, for replacement */
+	SharedCatCacheTag tag;		/* tag of the tuple, if used */
+	Oid			reloid;			/* catalog the tuple belongs to */
+	ItemPointerData t_self;		/* TID of the catalog tuple */
+	uint32		t_len;			/* length of tuple data */
+	char		t_data[SHARED_CATCACHE_MAX_TUPLE];	/* HeapTupleHeader */
+} SharedCatCacheSlot;
+
+/* Shared state */
+typedef struct SharedCatCacheCtl
+{
+	/* per-partition invalidation counters and clock hands */
+	uint64		invalCount[NUM_SHARED_CATCACHE_PARTITIONS];
+	int			clockHand[NUM_SHARED_CATCACHE_PARTITIONS];
+	int			slotsPerPartition;
+	SharedCatCacheSlot slots[FLEXIBLE_ARRAY_MEMBER];
+} SharedCatCacheCtl;
+
+static HTAB *SharedCatCacheHash = NULL;
+static SharedCatCacheCtl *SharedCatCache = NULL;
+
+#define SharedCatCachePartition(hashcode) \
+	((hashcode) % NUM_SHARED_CATCACHE_PARTITIONS)
+#define SharedCatCachePartitionLock(hashcode) \
+	(&MainLWLockArray[SHARED_CATCACHE_LWLOCK_OFFSET + \
+		SharedCatCachePartition(hashcode)].lock)
+#define SharedCatCachePartitionLockByIndex(i) \
+	(&MainLWLockArray[SHARED_CATCACHE_LWLOCK_OFFSET + (i)].lock)
+
+/*
+ * Number of slots of each partition that fit in shared_catalog_cache_size
+ */
+static int
+SharedCatCacheSlotsPerPartition(void)
+{
+	long		nslots;
+
+	nslots = ((long) shared_catalog_cache_size * 1024L) /
+		(long) sizeof(SharedCatCacheSlot);
+
+	return (int) Max(nslots / NUM_SHARED_CATCACHE_PARTITIONS, 1);
+}
+
+/*
+ * CatCacheShmemSize
+ *		Estimate space needed for the shared catalog cache
+ */
+Size
+CatCacheShmemSize(void)
+{
+	Size		nslots;
+	Size		size;
+
+	if (shared_catalog_cache_size <= 0)
+		return 0;
+
+	nslots = mul_size(SharedCatCacheSlotsPerPartition(),
+					  NUM_SHARED_CATCACHE_PARTITIONS);
+	size = offsetof(SharedCatCacheCtl, slots);
+	size = add_size(size, mul_size(nslots, sizeof(SharedCatCacheSlot)));
+	size = MAXALIGN(size);
+	size = add_size(size, hash_estimate_size(nslots,
+											 sizeof(SharedCatCacheEnt)));
+
+	return size;
+}
+
+/*
+ * CatCacheShmemInit
+ *		Allocate and initialize the shared catalog cache
+ */
+void
+CatCacheShmemInit(void)
+{
+	HASHCTL		info;
+	int			slotsPerPartition;
+	long		nslots;
+	bool		found;
+
+	if (shared_catalog_cache_size <= 0)
+		return;
+
+	slotsPerPartition = SharedCatCacheSlotsPerPartition();
+	nslots = (long) slotsPerPartition * NUM_SHARED_CATCACHE_PARTITIONS;
+
+	SharedCatCache = (SharedCatCacheCtl *)
+		ShmemInitStruct("Shared Catalog Cache",
+						offsetof(SharedCatCacheCtl, slots) +
+						nslots * sizeof(SharedCatCacheSlot),
+						&found);
+	if (!found)
+	{
+		MemSet(SharedCatCache, 0, offsetof(SharedCatCacheCtl, slots));
+		SharedCatCache->slotsPerPartition = slotsPerPartition;
+		MemSet(SharedCatCache->slots, 0, nslots * sizeof(SharedCatCacheSlot));
+	}
+
+	/*
+	 * A partition never has more entries than slots, so the hash table can
+	 * be of fixed size without ever running out of entries.
+	 */
+	MemSet(&info, 0, sizeof(info));
+	info.keysize = sizeof(SharedCatCacheTag);
+	info.entrysize = sizeof(SharedCatCacheEnt);
+	info.num_partitions = NUM_SHARED_CATCACHE_PARTITIONS;
+
+	SharedCatCacheHash = ShmemInitHash("Shared Catalog Cache Lookup Table",
+									   nslots, nslots,
+									   &info,
+									   HASH_ELEM | HASH_BLOBS |
+									   HASH_PARTITION | HASH_FIXED_SIZE);
+}
+
+/*
+ * Can this search use the shared catalog cache?
+ */
+static bool
+SharedCatCacheUsable(CatCache *cache)
+{
+	if (SharedCatCacheHash == NULL)
+		return false;
+
+	/* The invalidation machinery isn't running in bootstrap mode */
+	if (IsBootstrapProcessingMode())
+		return false;
+
+	/* Logical decoding reads the catalogs with a historic snapshot */
+	if (HistoricSnapshotActive())
+		return false;
+
+	/* We might see our own uncommitted catalog changes */
+	if (TransactionIdIsValid(GetTopTransactionIdIfAny()))
+		return false;
+
+	/* Not yet connected to a database? */
+	if (!cache->cc_relisshared && !OidIsValid(MyDatabaseId))
+		return false;
+
+	return true;
+}
+
+static void
+SharedCatCacheInitTag(SharedCatCacheTag *tag, CatCache *cache,
+					  uint32 hashValue)
+{
+	/* zero any padding, since the tag is hashed and compared as a blob */
+	MemSet(tag, 0, sizeof(SharedCatCacheTag));
+	tag->cacheId = cache->id;
+	tag->dbId = cache->cc_relisshared ? InvalidOid : MyDatabaseId;
+	tag->hashValue = hashValue;
+}
+
+/*
+ * Empty a slot, removing its tuple from the hash table.  Caller must hold
+ * the slot's partition lock exclusively.
+ */
+static void
+SharedCatCacheFreeSlot(SharedCatCacheSlot *slot)
+{
+	Assert(slot->used);
+	hash_search(SharedCatCacheHash, &slot->tag, HASH_REMOVE, NULL);
+	slot->used = false;
+}
+
+/*
+ * Choose a slot of the given partition for a new tuple.
+ *
+ * This is a clock sweep, as the buffer manager does for shared buffers: the
+ * partition's clock hand moves over its slots, decrementing their usage
+ * counts, until it finds one that is unused or whose count has dropped to
+ * zero.  The tuple held by that slot is evicted.  Caller must hold the
+ * partition lock exclusively.
+ */
+static int
+SharedCatCacheGetSlot(int partition)
+{
+	int			slotsPerPartition = SharedCatCache->slotsPerPartition;
+	int		   *hand = &SharedCatCache->clockHand[partition];
+
+	for (;;)
+	{
+		int			slotno = partition * slotsPerPartition + *hand;
+		SharedCatCacheSlot *slot = &SharedCatCache->slots[slotno];
+
+		if (++(*hand) >= slotsPerPartition)
+			*hand = 0;
+
+		if (!slot->used)
+			return slotno;
+		if (slot->usage_count == 0)
+		{
+			SharedCatCacheFreeSlot(slot);
+			return slotno;
+		}
+		slot->usage_count--;
+	}
+}
+
+/*
+ * SharedCatCacheLookup
+ *
+ * Look for a tuple matching the search keys.  If one is found, a palloc'd
+ * copy is returned.  Otherwise NULL is returned; the caller should then read
+ * the tuple from the catalog and pass it to SharedCatCacheInsert along with
+ * the partition's invalidation counter, which we return in *invalCount.
+ */
+static HeapTuple
+SharedCatCacheLookup(CatCache *cache, uint32 hashValue, ScanKey cur_skey,
+					 uint64 *invalCount)
+{
+	SharedCatCacheTag tag;
+	SharedCatCacheEnt *entry;
+	uint32		hashcode;
+	LWLock	   *partitionLock;
+	HeapTuple	ntp = NULL;
+
+	SharedCatCacheInitTag(&tag, cache, hashValue);
+	hashcode = get_hash_value(SharedCatCacheHash, &tag);
+	partitionLock = SharedCatCachePartitionLock(hashcode);
+
+	LWLockAcquire(partitionLock, LW_SHARED);
+
+	entry = (SharedCatCacheEnt *)
+		hash_search_with_hash_value(SharedCatCacheHash, &tag, hashcode,
+									HASH_FIND, NULL);
+	if (entry != NULL)
+	{
+		SharedCatCacheSlot *slot = &SharedCatCache->slots[entry->slot];
+
+		/* copy the tuple out, so that we can release the lock quickly */
+		ntp = (HeapTuple) palloc(HEAPTUPLESIZE + slot->t_len);
+		ntp->t_len = slot->t_len;
+		ntp->t_self = slot->t_self;
+		ntp->t_tableOid = slot->reloid;
+		ntp->t_data = (HeapTupleHeader) ((char *) ntp + HEAPTUPLESIZE);
+		memcpy(ntp->t_data, slot->t_data, slot->t_len);
+
+		/*
+		 * We only hold the lock in shared mode, so concurrent hits may lose
+		 * each other's increments.  That only makes the count a little less
+		 * accurate, which the clock sweep doesn't need it to be.
+		 */
+		if (slot->usage_count < SHARED_CATCACHE_MAX_USAGE)
+			slot->usage_count++;
+	}
+	*invalCount = SharedCatCache->invalCount[SharedCatCachePartition(hashcode)];
+
+	LWLockRelease(partitionLock);
+
+	if (ntp != NULL)
+	{
+		bool		res;
+
+		/* different keys can have the same hash value, so check them */
+		HeapKeyTest(ntp, cache->cc_tupdesc, cache->cc_nkeys, cur_skey, res);
+		if (!res)
+		{
+			heap_freetuple(ntp);
+			ntp = NULL;
+		}
+	}
+
+	return ntp;
+}
+
+/*
+ * SharedCatCacheInsert
+ *
+ * Publish a tuple that we just read from the catalog, unless an invalidation
+ * has hit its partition since SharedCatCacheLookup read invalCount.  If the
+ * partition is full, the tuple replaces the one chosen by
+ * SharedCatCacheGetSlot.  Tuples that are too large are silently not cached.
+ */
+static void
+SharedCatCacheInsert(CatCache *cache, uint32 hashValue, HeapTuple tuple,
+					 uint64 invalCount)
+{
+	SharedCatCacheTag tag;
+	SharedCatCacheEnt *entry;
+	uint32		hashcode;
+	int			partition;
+	LWLock	   *partitionLock;
+
+	if (tuple->t_len > SHARED_CATCACHE_MAX_TUPLE)
+		return;
+
+	SharedCatCacheInitTag(&tag, cache, hashValue);
+	hashcode = get_hash_value(SharedCatCacheHash, &tag);
+	partition = SharedCatCachePartition(hashcode);
+	partitionLock = SharedCatCachePartitionLock(hashcode);
+
+	LWLockAcquire(partitionLock, LW_EXCLUSIVE);
+
+	if (SharedCatCache->invalCount[partition] == invalCount &&
+		hash_search_with_hash_value(SharedCatCacheHash, &tag, hashcode,
+									HASH_FIND, NULL) == NULL)
+	{
+		int			slotno = SharedCatCacheGetSlot(partition);
+		SharedCatCacheSlot *slot = &SharedCatCache->slots[slotno];
+		bool		found;
+
+		/* can't fail, see CatCacheShmemInit */
+		entry = (SharedCatCacheEnt *)
+			hash_search_with_hash_value(SharedCatCacheHash, &tag, hashcode,
+										HASH_ENTER, &found);
+		Assert(!found);
+		entry->slot = slotno;
+
+		slot->used = true;
+		slot->usage_count = 1;
+		slot->tag = tag;
+		slot->reloid = cache->cc_reloid;
+		slot->t_self = tuple->t_self;
+		slot->t_len = tuple->t_len;
+		memcpy(slot->t_data, tuple->t_data, tuple->t_len);
+	}
+
+	LWLockRelease(partitionLock);
+}
+
+/*
+ * Remove the entry for one catcache invalidation message, if any
+ */
+static void
+SharedCatCacheInvalidateTuple(int cacheId, Oid dbId, uint32 hashValue)
+{
+	SharedCatCacheTag tag;
+	SharedCatCacheEnt *entry;
+	uint32		hashcode;
+	LWLock	   *partitionLock;
+
+	MemSet(&tag, 0, sizeof(tag));
+	tag.cacheId = cacheId;
+	tag.dbId = dbId;
+	tag.hashValue = hashValue;
+
+	hashcode = get_hash_value(SharedCatCacheHash, &tag);
+	partitionLock = SharedCatCachePartitionLock(hashcode);
+
+	LWLockAcquire(partitionLock, LW_EXCLUSIVE);
+	SharedCatCache->invalCount[SharedCatCachePartition(hashcode)]++;
+	entry = (SharedCatCacheEnt *)
+		hash_search_with_hash_value(SharedCatCacheHash, &tag, hashcode,
+									HASH_FIND, NULL);
+	if (entry != NULL)
+		SharedCatCacheFreeSlot(&SharedCatCache->slots[entry->slot]);
+	LWLockRelease(partitionLock);
+}
+
+/*
+ * Remove all entries of a database, and of one catalog of it unless catId
+ * is InvalidOid
+ */
+static void
+SharedCatCacheInvalidateMatching(Oid dbId, Oid catId)
+{
+	int			nslots;
+	int			i;
+
+	/* lock all partitions, in order to avoid deadlocks */
+	for (i = 0; i < NUM_SHARED_CATCACHE_PARTITIONS; i++)
+	{
+		LWLockAcquire(SharedCatCachePartitionLockByIndex(i), LW_EXCLUSIVE);
+		SharedCatCache->invalCount[i]++;
+	}
+
+	nslots = SharedCatCache->slotsPerPartition * NUM_SHARED_CATCACHE_PARTITIONS;
+	for (i = 0; i < nslots; i++)
+	{
+		SharedCatCacheSlot *slot = &SharedCatCache->slots[i];
+
+		if (slot->used && slot->tag.dbId == dbId &&
+			(!OidIsValid(catId) || slot->reloid == catId))
+			SharedCatCacheFreeSlot(slot);
+	}
+
+	for (i = NUM_SHARED_CATCACHE_PARTITIONS; --i >= 0;)
+		LWLockRelease(SharedCatCachePartitionLockByIndex(i));
+}
+
+/*
+ * SharedCatCacheDropDatabase
+ *
+ * Remove all entries of a database that is being dropped.  Nothing else
+ * would remove them, and a later database could get the same OID.
+ */
+void
+SharedCatCacheDropDatabase(Oid dbId)
+{
+	if (SharedCatCacheHash == NULL)
+		return;
+
+	Assert(OidIsValid(dbId));
+	SharedCatCacheInvalidateMatching(dbId, InvalidOid);
+}
+
+/*
+ * SharedCatCacheInvalidate
+ *
+ * Apply a batch of invalidation messages to the shared catalog cache.  This
+ * must be called before the messages are made visible to other backends.
+ */
+void
+SharedCatCacheInvalidate(const SharedInvalidationMessage *msgs, int n)
+{
+	int			i;
+
+	if (SharedCatCacheHash == NULL)
+		return;
+
+	for (i = 0; i < n; i++)
+	{
+		const SharedInvalidationMessage *msg = &msgs[i];
+
+		if (msg->id >= 0)
+			SharedCatCacheInvalidateTuple(msg->cc.id, msg->cc.dbId,
+										  msg->cc.hashValue);
+		else if (msg->id == SHAREDINVALCATALOG_ID)
+			SharedCatCacheInvalidateMatching(msg->cat.dbId, msg->cat.catId);
+	}
+}
+
 /*
  *	SearchCatCache
  *
@@ -1120,6 +1661,8 @@ SearchCatCache(CatCache *cache,
 	Relation	relation;
 	SysScanDesc scandesc;
 	HeapTuple	ntp;
+	bool		use_shared;
+	uint64		invalCount = 0;
 
 	/* Make sure we're in a xact, even if this ends up being a cache hit */
 	Assert(IsTransactionState());
@@ -1130,9 +1673,7 @@ SearchCatCache(CatCache *cache,
 	if (cache->cc_tupdesc == NULL)
 		CatalogCacheInitializeCache(cache);
 
-#ifdef CATCACHE_STATS
 	cache->cc_searches++;
-#endif
 
 	/*
 	 * initialize the search key information
@@ -1186,6 +1727,7 @@ SearchCatCache(CatCache *cache,
 		 * near the front of the hashbucket's list.)
 		 */
 		dlist_move_head(bucket, &ct->cache_elem);
+		dlist_move_head(&CacheHdr->ch_lru_list, &ct->lru_elem);
 
 		/*
 		 * If it's a positive entry, bump its refcount and return it. If it's
@@ -1200,9 +1742,7 @@ SearchCatCache(CatCache *cache,
 			CACHE3_elog(DEBUG2, "SearchCatCache(%s): found in bucket %d",
 						cache->cc_relname, hashIndex);
 
-#ifdef CATCACHE_STATS
 			cache->cc_hits++;
-#endif
 
 			return &ct->tuple;
 		}
@@ -1211,9 +1751,7 @@ SearchCatCache(CatCache *cache,
 			CACHE3_elog(DEBUG2, "SearchCatCache(%s): found neg entry in bucket %d",
 						cache->cc_relname, hashIndex);
 
-#ifdef CATCACHE_STATS
 			cache->cc_neg_hits++;
-#endif
 
 			return NULL;
 		}
@@ -1233,7 +1771,40 @@ SearchCatCache(CatCache *cache,
 	 * will eventually age out of the cache, so there's no functional problem.
 	 * This case is rare enough that it's not worth expending extra cycles to
 	 * detect.
+	 *
+	 * Before going to the catalog, check whether another backend has already
+	 * put the tuple into the shared catalog cache.
 	 */
+	use_shared = SharedCatCacheUsable(cache);
+	if (use_shared)
+	{
+		ntp = SharedCatCacheLookup(cache, hashValue, cur_skey, &invalCount);
+		if (ntp != NULL)
+		{
+			ct = CatalogCacheCreateEntry(cache, ntp,
+										 hashValue, hashIndex,
+										 false);
+			heap_freetuple(ntp);
+
+			ResourceOwnerEnlargeCatCacheRefs(CurrentResourceOwner);
+			ct->refcount++;
+			ResourceOwnerRememberCatCacheRef(CurrentResourceOwner, &ct->tuple);
+
+			CACHE3_elog(DEBUG2, "SearchCatCache(%s): copied from shared cache into bucket %d",
+						cache->cc_relname, hashIndex);
+
+			cache->cc_shared_hits++;
+
+			return &ct->tuple;
+		}
+
+		/*
+		 * The catalog snapshot must be taken after reading invalCount; see
+		 * the comments at the head of the shared catalog cache code.
+		 */
+		InvalidateCatalogSnapshot();
+	}
+
 	relation = heap_open(cache->cc_reloid, AccessShareLock);
 
 	scandesc = systable_beginscan(relation,
@@ -1300,9 +1871,10 @@ SearchCatCache(CatCache *cache,
 	CACHE3_elog(DEBUG2, "SearchCatCache(%s): put in bucket %d",
 				cache->cc_relname, hashIndex);
 
-#ifdef CATCACHE_STATS
 	cache->cc_newloads++;
-#endif
+
+	if (use_shared)
+		SharedCatCacheInsert(cache, hashValue, &ct->tuple, invalCount);
 
 	return &ct->tuple;
 }
@@ -1479,6 +2051,19 @@ SearchCatCacheList(CatCache *cache,
 		 */
 		dlist_move_head(&cache->cc_lists, &cl->cache_elem);
 
+		/*
+		 * The members do count as used for the purposes of LRU eviction,
+		 * though; otherwise a frequently used list would be lost whenever
+		 * one of its members reached the end of the LRU list.  Don't bother
+		 * unless there's a size limit.
+		 */
+		if (catalog_cache_max_size > 0)
+		{
+			for (i = 0; i < cl->n_members; i++)
+				dlist_move_head(&CacheHdr->ch_lru_list,
+								&cl->members[i]->lru_elem);
+		}
+
 		/* Bump the list's refcount and return it */
 		ResourceOwnerEnlargeCatCacheListRefs(CurrentResourceOwner);
 		cl->refcount++;
@@ -1733,9 +2318,11 @@ CatalogCacheCreateEntry(CatCache *cache, HeapTuple ntp,
 	ct->hash_value = hashValue;
 
 	dlist_push_head(&cache->cc_bucket[hashIndex], &ct->cache_elem);
+	dlist_push_head(&CacheHdr->ch_lru_list, &ct->lru_elem);
 
 	cache->cc_ntup++;
 	CacheHdr->ch_ntup++;
+	CacheHdr->ch_size += CatCTupSize(ct);
 
 	/*
 	 * If the hash table has become too full, enlarge the buckets array. Quite
@@ -1744,6 +2331,11 @@ CatalogCacheCreateEntry(CatCache *cache, HeapTuple ntp,
 	if (cache->cc_ntup > cache->cc_nbuckets * 2)
 		RehashCatCache(cache);
 
+	/* Make room if we're over the size limit */
+	if (catalog_cache_max_size > 0 &&
+		CacheHdr->ch_size > (Size) catalog_cache_max_size * 1024)
+		CatCacheEvict(ct);
+
 	return ct;
 }
 
@@ -1934,3 +2526,79 @@ PrintCatCacheListLeakWarning(CatCList *list)
 		 list->my_cache->cc_relname, list->my_cache->id,
 		 list, list->refcount);
 }
+
+
+/*
+ * pg_catcache_stats
+ *
+ *	SQL-callable function reporting, for each of this backend's catcaches,
+ *	the number of entries and counts of hits, misses and evictions.  A miss
+ *	is a search that had to read the catalog, whether or not a matching
+ *	tuple was found.
+ */
+Datum
+pg_catcache_stats(PG_FUNCTION_ARGS)
+{
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	TupleDesc	tupdesc;
+	Tuplestorestate *tupstore;
+	MemoryContext per_query_ctx;
+	MemoryContext oldcontext;
+	slist_iter	iter;
+
+	/* check to see if caller supports us returning a tuplestore */
+	if (rsinfo == NULL || !IsA(rsinfo, ReturnSetInfo))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("set-valued function called in context that cannot accept a set")));
+	if (!(rsinfo->allowedModes & SFRM_Materialize))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("materialize mode required, but it is not " \
+						"allowed in this context")));
+
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+
+	/* need to build tuplestore in query context */
+	per_query_ctx = rsinfo->econtext->ecxt_per_query_memory;
+	oldcontext = MemoryContextSwitchTo(per_query_ctx);
+
+	tupdesc = CreateTupleDescCopy(tupdesc);
+	tupstore =
+		tuplestore_begin_heap(rsinfo->allowedModes & SFRM_Materialize_Random,
+							  false, work_mem);
+
+	MemoryContextSwitchTo(oldcontext);
+
+	slist_foreach(iter, &CacheHdr->ch_caches)
+	{
+		CatCache   *cache = slist_container(CatCache, cc_next, iter.cur);
+		Datum		values[9];
+		bool		nulls[9];
+
+		MemSet(nulls, 0, sizeof(nulls));
+
+		values[0] = Int32GetDatum(cache->id);
+		values[1] = ObjectIdGetDatum(cache->cc_reloid);
+		values[2] = ObjectIdGetDatum(cache->cc_indexoid);
+		values[3] = Int64GetDatum(cache->cc_ntup);
+		values[4] = Int64GetDatum(cache->cc_hits);
+		values[5] = Int64GetDatum(cache->cc_neg_hits);
+		values[6] = Int64GetDatum(cache->cc_searches - cache->cc_hits -
+								  cache->cc_neg_hits);
+		values[7] = Int64GetDatum(cache->cc_evictions);
+		values[8] = Int64GetDatum(cache->cc_shared_hits);
+
+		tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+	}
+
+	/* clean up and return the tuplestore */
+	tuplestore_donestoring(tupstore);
+
+	rsinfo->returnMode = SFRM_Materialize;
+	rsinfo->setResult = tupstore;
+	rsinfo->setDesc = tupdesc;
+
+	return (Datum) 0;
+}
@@ -58,6 +58,7 @@
 #include "catalog/storage.h"
 #include "commands/policy.h"
 #include "commands/trigger.h"
+#include "funcapi.h"
 #include "miscadmin.h"
 #include "optimizer/clauses.h"
 #include "optimizer/planmain.h"
@@ -109,10 +110,25 @@ typedef struct relidcacheent
 {
 	Oid			reloid;
 	Relation	reldesc;
+	dlist_node	lru_elem;		/* list member of RelationIdLRU */
 } RelIdCacheEnt;
 
 static HTAB *RelationIdCache;
 
+/*
+ * All RelationIdCache entries, most recently used first.  Used to find
+ * entries to evict when there are more than relation_cache_max_entries.
+ */
+static dlist_head RelationIdLRU = DLIST_STATIC_INIT(RelationIdLRU);
+
+/* GUC parameter: limit on number of relcache entries (0 = no limit) */
+int			relation_cache_max_entries = 0;
+
+/* Statistics reported by pg_relcache_stats() */
+static long relcacheHits = 0L;
+static long relcacheMisses = 0L;
+static long relcacheEvictions = 0L;
+
 /*
  * This flag is false until we have prepared the critical relcache entries
  * that are needed to do indexscans on the tables read by relcache building.
@@ -188,6 +204,7 @@ do { \
 		Relation _old_rel = hentry->reldesc; \
 		Assert(replace_allowed); \
 		hentry->reldesc = (RELATION); \
+		dlist_move_head(&RelationIdLRU, &hentry->lru_elem); \
 		if (RelationHasReferenceCountZero(_old_rel)) \
 			RelationDestroyRelation(_old_rel, false); \
 		else if (!IsBootstrapProcessingMode()) \
@@ -195,7 +212,10 @@ do { \
 				 RelationGetRelationName(_old_rel)); \
 	} \
 	else \
+	{ \
 		hentry->reldesc = (RELATION); \
+		dlist_push_head(&RelationIdLRU, &hentry->lru_elem); \
+	} \
 } while(0)
 
 #define RelationIdCacheLookup(ID, RELATION) \
@@ -219,6 +239,8 @@ do { \
 	if (hentry == NULL) \
 		elog(WARNING, "failed to delete relcache entry for OID %u", \
 			 (RELATION)->rd_id); \
+	else \
+		dlist_delete(&hentry->lru_elem); \
 } while(0)
 
 
@@ -245,6 +267,7 @@ static HTAB *OpClassCache = NULL;
 
 static void RelationDestroyRelation(Relation relation, bool remember_tupdesc);
 static void RelationClearRelation(Relation relation, bool rebuild);
+static void RelationCacheEvict(void);
 
 static void RelationReloadIndexInfo(Relation relation);
 static void RelationFlushRelation(Relation relation);
@@ -1740,6 +1763,7 @@ formrdesc(const char *relationName, Oid relationReltype,
 Relation
 RelationIdGetRelation(Oid relationId)
 {
+	RelIdCacheEnt *hentry;
 	Relation	rd;
 
 	/* Make sure we're in an xact, even if this ends up being a cache hit */
@@ -1747,11 +1771,19 @@ RelationIdGetRelation(Oid relationId)
 
 	/*
 	 * first try to find reldesc in the cache
+	 *
+	 * This is RelationIdCacheLookup, except that we also mark the entry as
+	 * recently used.
 	 */
-	RelationIdCacheLookup(relationId, rd);
-
-	if (RelationIsValid(rd))
+	hentry = (RelIdCacheEnt *) hash_search(RelationIdCache,
+										   (void *) &relationId,
+										   HASH_FIND, NULL);
+	if (hentry)
 	{
+		rd = hentry->reldesc;
+		dlist_move_head(&RelationIdLRU, &hentry->lru_elem);
+		relcacheHits++;
+
 		RelationIncrementReferenceCount(rd);
 		/* revalidate cache entry if necessary */
 		if (!rd->rd_isvalid)
@@ -1774,6 +1806,7 @@ RelationIdGetRelation(Oid relationId)
 	 * no reldesc in the cache, so have RelationBuildDesc() build one and add
 	 * it.
 	 */
+	relcacheMisses++;
 	rd = RelationBuildDesc(relationId, true);
 	if (RelationIsValid(rd))
 		RelationIncrementReferenceCount(rd);
@@ -2610,6 +2643,84 @@ AtEOXact_RelationCache(bool isCommit)
 	eoxact_list_overflowed = false;
 	NextEOXactTupleDescNum = 0;
 	EOXactTupleDescArrayLen = 0;
+
+	/*
+	 * Trim the cache if it's grown too large.  This is a convenient place to
+	 * do it, since no entries are referenced anymore and none belong to a
+	 * transaction in progress.
+	 */
+	if (relation_cache_max_entries > 0 &&
+		hash_get_num_entries(RelationIdCache) > relation_cache_max_entries &&
+		!IsBootstrapProcessingMode())
+		RelationCacheEvict();
+}
+
+/*
+ * RelationCacheEvict
+ *
+ *	Remove least recently used relcache entries until there are no more
+ *	than relation_cache_max_entries of them, or nothing more can be removed.
+ *
+ * Only entries that can be rebuilt from the catalogs at any time are
+ * candidates: nailed entries, entries that are still referenced, and entries
+ * for relations created or assigned a new relfilenode in the current
+ * transaction are skipped.  Skipped entries are moved to the front of the
+ * LRU list so that we don't keep looking at them.
+ */
+static void
+RelationCacheEvict(void)
+{
+	long		nleft = hash_get_num_entries(RelationIdCache);
+
+	while (hash_get_num_entries(RelationIdCache) > relation_cache_max_entries &&
+		   nleft-- > 0)
+	{
+		RelIdCacheEnt *hentry;
+		Relation	relation;
+
+		hentry = dlist_container(RelIdCacheEnt, lru_elem,
+								 dlist_tail_node(&RelationIdLRU));
+		relation = hentry->reldesc;
+
+		if (relation->rd_isnailed ||
+			!RelationHasReferenceCountZero(relation) ||
+			relation->rd_createSubid != InvalidSubTransactionId ||
+			relation->rd_newRelfilenodeSubid != InvalidSubTransactionId)
+		{
+			dlist_move_head(&RelationIdLRU, &hentry->lru_elem);
+			continue;
+		}
+
+		relcacheEvictions++;
+		RelationClearRelation(relation, false);
+	}
+}
+
+/*
+ * pg_relcache_stats
+ *
+ *	SQL-callable function reporting the size of this backend's relcache,
+ *	along with counts of lookups that were satisfied from the cache, lookups
+ *	that had to build a new entry, and entries evicted because of
+ *	relation_cache_max_entries.
+ */
+Datum
+pg_relcache_stats(PG_FUNCTION_ARGS)
+{
+	TupleDesc	tupdesc;
+	Datum		values[4];
+	bool		nulls[4];
+
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+
+	MemSet(nulls, 0, sizeof(nulls));
+	values[0] = Int64GetDatum(hash_get_num_entries(RelationIdCache));
+	values[1] = Int64GetDatum(relcacheHits);
+	values[2] = Int64GetDatum(relcacheMisses);
+	values[3] = Int64GetDatum(relcacheEvictions);
+
+	PG_RETURN_DATUM(HeapTupleGetDatum(heap_form_tuple(tupdesc, values, nulls)));
 }
 
 /*
@@ -416,6 +416,35 @@ MemoryContextIsEmpty(MemoryContext context)
 	return (*context->methods->is_empty) (context);
 }
 
+/*
+ * MemoryContextMemAllocated
+ *		Total memory obtained from malloc() for a context, and optionally
+ *		for all of its descendants too.
+ *
+ * This counts whole blocks, including space not yet handed out by palloc,
+ * so it is what the context actually costs rather than what is in use.
+ */
+Size
+MemoryContextMemAllocated(MemoryContext context, bool recurse)
+{
+	Size		total;
+
+	AssertArg(MemoryContextIsValid(context));
+
+	total = context->mem_allocated;
+	if (recurse)
+	{
+		MemoryContext child;
+
+		for (child = context->firstchild;
+			 child != NULL;
+			 child = child->nextchild)
+			total += MemoryContextMemAllocated(child, true);
+	}
+
+	return total;
+}
+
 /*
  * MemoryContextStats
  *		Print statistics about the named context and all its descendants.
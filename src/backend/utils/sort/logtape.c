@@ -66,6 +66,15 @@
  * care that all calls for a single LogicalTapeSet are made in the same
  * palloc context.
  *
+ * To support sorts performed cooperatively by several processes, a tape can
+ * also be bound to a caller-supplied BufFile, normally one created in a
+ * SharedFileSet.  An "exported" tape is written strictly sequentially into
+ * such a file, without any of the block recycling machinery above, and the
+ * file is closed at the end of the write pass.  Another process can then
+ * "import" the file as a read-only tape of its own tape set.  Since the data
+ * of an exported tape is never interleaved with that of other tapes, the
+ * reader needs no knowledge of the writer's indirect blocks.
+ *
  * Portions Copyright (c) 1996-2015, PostgreSQL Global Development Group
  * Portions Copyright (c) 1994, Regents of the University of California
  *
@@ -134,6 +143,15 @@ typedef struct LogicalTape
 	long		curBlockNumber; /* this block's logical blk# within tape */
 	int			pos;			/* next read/write position in buffer */
 	int			nbytes;			/* total # of valid bytes in buffer */
+
+	/*
+	 * If the tape has been exported or imported, extfile is the BufFile it
+	 * is written to or read from, and none of the fields above are used.
+	 * An exported tape's file is closed (and extfile reset to NULL) at the
+	 * end of its write pass, after which the tape reads as empty.
+	 */
+	BufFile    *extfile;		/* external file, or NULL */
+	bool		exported;		/* T if tape was exported */
 } LogicalTape;
 
 /*
@@ -553,6 +571,8 @@ LogicalTapeSetCreate(int ntapes)
 		lt->curBlockNumber = 0L;
 		lt->pos = 0;
 		lt->nbytes = 0;
+		lt->extfile = NULL;
+		lt->exported = false;
 	}
 	return lts;
 }
@@ -572,6 +592,8 @@ LogicalTapeSetClose(LogicalTapeSet *lts)
 	for (i = 0; i < lts->nTapes; i++)
 	{
 		lt = &lts->tapes[i];
+		if (lt->extfile)
+			BufFileClose(lt->extfile);
 		for (ib = lt->indirect; ib != NULL; ib = nextib)
 		{
 			nextib = ib->nextup;
@@ -630,6 +652,16 @@ LogicalTapeWrite(LogicalTapeSet *lts, int tapenum,
 	lt = &lts->tapes[tapenum];
 	Assert(lt->writing);
 
+	/* Exported tapes are written straight through to their file */
+	if (lt->extfile)
+	{
+		if (BufFileWrite(lt->extfile, ptr, size) != size)
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not write to temporary file: %m")));
+		return;
+	}
+
 	/* Allocate data buffer and first indirect block on first write */
 	if (lt->buffer == NULL)
 		lt->buffer = (char *) palloc(BLCKSZ);
@@ -689,6 +721,28 @@ LogicalTapeRewind(LogicalTapeSet *lts, int tapenum, bool forWrite)
 	Assert(tapenum >= 0 && tapenum < lts->nTapes);
 	lt = &lts->tapes[tapenum];
 
+	if (lt->extfile || lt->exported)
+	{
+		if (forWrite)
+			elog(ERROR, "cannot rewind an exported or imported tape for writing");
+		if (lt->writing)
+		{
+			/*
+			 * Completion of the write pass of an exported tape.  Closing the
+			 * file flushes it and makes it available to other backends.
+			 */
+			BufFileClose(lt->extfile);
+			lt->extfile = NULL;
+			lt->writing = false;
+		}
+		else if (lt->extfile &&
+				 BufFileSeek(lt->extfile, 0, 0L, SEEK_SET) != 0)
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not rewind temporary file: %m")));
+		return;
+	}
+
 	if (!forWrite)
 	{
 		if (lt->writing)
@@ -778,6 +832,9 @@ LogicalTapeRead(LogicalTapeSet *lts, int tapenum,
 	lt = &lts->tapes[tapenum];
 	Assert(!lt->writing);
 
+	if (lt->extfile)
+		return BufFileRead(lt->extfile, ptr, size);
+
 	while (size > 0)
 	{
 		if (lt->pos >= lt->nbytes)
@@ -815,6 +872,53 @@ LogicalTapeRead(LogicalTapeSet *lts, int tapenum,
 	return nread;
 }
 
+/*
+ * Export a logical tape.
+ *
+ * All data subsequently written to the tape goes sequentially into 'file',
+ * which the caller must have created and must not otherwise touch; normally
+ * it is a shared BufFile that another backend will read with
+ * LogicalTapeImport.  This must be called before anything has been written
+ * to the tape.  Rewinding the tape for read completes the write pass and
+ * closes the file; the tape reads as empty in this backend afterwards.
+ *
+ * Exported tapes cannot be frozen, backspaced or seeked.
+ */
+void
+LogicalTapeExport(LogicalTapeSet *lts, int tapenum, BufFile *file)
+{
+	LogicalTape *lt;
+
+	Assert(tapenum >= 0 && tapenum < lts->nTapes);
+	lt = &lts->tapes[tapenum];
+	Assert(lt->writing && lt->indirect == NULL && !lt->exported);
+
+	lt->extfile = file;
+	lt->exported = true;
+}
+
+/*
+ * Import a logical tape.
+ *
+ * The tape becomes a read-only tape whose contents are those of 'file',
+ * typically written by another backend through an exported tape.  The tape
+ * set takes ownership of the file and closes it when the set is closed.
+ * The tape can be rewound and read any number of times, but not written,
+ * frozen, backspaced or seeked.
+ */
+void
+LogicalTapeImport(LogicalTapeSet *lts, int tapenum, BufFile *file)
+{
+	LogicalTape *lt;
+
+	Assert(tapenum >= 0 && tapenum < lts->nTapes);
+	lt = &lts->tapes[tapenum];
+	Assert(lt->writing && lt->indirect == NULL && !lt->exported);
+
+	lt->extfile = file;
+	lt->writing = false;
+}
+
 /*
  * "Freeze" the contents of a tape so that it can be read multiple times
  * and/or read backwards.  Once a tape is frozen, its contents will not
@@ -835,6 +939,8 @@ LogicalTapeFreeze(LogicalTapeSet *lts, int tapenum)
 	Assert(tapenum >= 0 && tapenum < lts->nTapes);
 	lt = &lts->tapes[tapenum];
 	Assert(lt->writing);
+	if (lt->extfile)
+		elog(ERROR, "cannot freeze an exported tape");
 
 	/*
 	 * Completion of a write phase.  Flush last partial data block, flush any
@@ -11,24 +11,20 @@
  * algorithm.
  *
  * See Knuth, volume 3, for more than you want to know about the external
- * sorting algorithm.  We divide the input into sorted runs using replacement
- * selection, in the form of a priority tree implemented as a heap
- * (essentially his Algorithm 5.2.3H), then merge the runs using polyphase
+ * sorting algorithm.  We divide the input into sorted runs by quicksorting
+ * workMem-sized batches of tuples, then merge the runs using polyphase
  * merge, Knuth's Algorithm 5.4.2D.  The logical "tapes" used by Algorithm D
  * are implemented by logtape.c, which avoids space wastage by recycling
  * disk space as soon as each block is read from its "tape".
  *
- * We do not form the initial runs using Knuth's recommended replacement
- * selection data structure (Algorithm 5.4.1R), because it uses a fixed
- * number of records in memory at all times.  Since we are dealing with
- * tuples that may vary considerably in size, we want to be able to vary
- * the number of records kept in memory to ensure full utilization of the
- * allowed sort memory space.  So, we keep the tuples in a variable-size
- * heap, with the next record to go out at the top of the heap.  Like
- * Algorithm 5.4.1R, each record is stored with the run number that it
- * must go into, and we use (run number, key) as the ordering key for the
- * heap.  When the run number at the top of the heap changes, we know that
- * no more records of the prior run are left in the heap.
+ * We used to form the initial runs by replacement selection, keeping the
+ * tuples in a heap (Knuth's Algorithm 5.2.3H) and emitting just enough of
+ * them to stay within workMem.  That produces runs averaging twice the size
+ * of memory, but every tuple costs a trip down a heap that is far larger
+ * than the CPU caches, so with today's workMem sizes it loses badly to
+ * quicksort, whose memory access pattern is sequential and cache-friendly.
+ * Having half as many runs rarely costs an extra merge pass, since even a
+ * modest workMem allows a high merge order.
  *
  * The approximate amount of memory allowed for any one sort operation
  * is specified in kilobytes by the caller (most pass work_mem).  Initially,
@@ -36,13 +32,11 @@
  * we haven't exceeded workMem.  If we reach the end of the input without
  * exceeding workMem, we sort the array using qsort() and subsequently return
  * tuples just by scanning the tuple array sequentially.  If we do exceed
- * workMem, we construct a heap using Algorithm H and begin to emit tuples
- * into sorted runs in temporary tapes, emitting just enough tuples at each
- * step to get back within the workMem limit.  Whenever the run number at
- * the top of the heap changes, we begin a new run with a new output tape
- * (selected per Algorithm D).  After the end of the input is reached,
- * we dump out remaining tuples in memory into a final run (or two),
- * then merge the runs using Algorithm D.
+ * workMem, we qsort the array and write it out as a run on a temporary tape
+ * (selected per Algorithm D), then go on absorbing tuples into the emptied
+ * array until memory fills up again.  After the end of the input is reached,
+ * we dump out the remaining tuples in memory into a final run, then merge
+ * the runs using Algorithm D.
  *
  * When merging runs, we use a heap containing just the frontmost tuple from
  * each source run; we repeatedly output the smallest tuple and insert the
@@ -86,6 +80,18 @@
  * we preread from a tape, so as to maintain the locality of access described
  * above.  Nonetheless, with large workMem we can have many tapes.
  *
+ * A sort can also be divided among several cooperating backends, to speed
+ * up very large sorts such as those of CREATE INDEX, or of a Sort under a
+ * Gather node.  The backends share a Sharedsort object, placed in a dynamic
+ * shared memory segment by whoever coordinates the operation.  Each
+ * "worker" sort is fed part of the input and sorts it independently in the
+ * usual way, except that its final output, whether it comes from memory or
+ * from the final merge of its runs, is written as a single run to a shared
+ * temporary file.  The "leader" sort receives no input of its own: once
+ * all workers have finished, it imports each worker's file as a logical
+ * tape and merges those runs on-the-fly as the caller fetches tuples.
+ * Shared sorts never support random access or bounded output.
+ *
  *
  * Portions Copyright (c) 1996-2015, PostgreSQL Global Development Group
  * Portions Copyright (c) 1994, Regents of the University of California
@@ -108,6 +114,7 @@
 #include "miscadmin.h"
 #include "pg_trace.h"
 #include "utils/datum.h"
+#include "storage/sharedfileset.h"
 #include "utils/logtape.h"
 #include "utils/lsyscache.h"
 #include "utils/memutils.h"
@@ -155,11 +162,10 @@ bool		optimize_bounded_sort = true;
  * representation, where the key is (typically) a pass by value proxy for a
  * pass by reference type.
  *
- * While building initial runs, tupindex holds the tuple's run number.  During
- * merge passes, we re-use it to hold the input tape number that each tuple in
- * the heap was read from, or to hold the index of the next tuple pre-read
- * from the same tape in the case of pre-read entries.  tupindex goes unused
- * if the sort occurs entirely in memory.
+ * During merge passes, tupindex holds the input tape number that each tuple
+ * in the heap was read from, or the index of the next tuple pre-read from the
+ * same tape in the case of pre-read entries.  tupindex goes unused while
+ * absorbing and sorting input tuples.
  */
 typedef struct
 {
@@ -196,9 +202,25 @@ typedef enum
  * tape during a preread cycle (see discussion at top of file).
  */
 #define MINORDER		6		/* minimum merge order */
+#define MAXORDER		500		/* maximum merge order */
 #define TAPE_BUFFER_OVERHEAD		(BLCKSZ * 3)
 #define MERGE_BUFFER_SIZE			(BLCKSZ * 32)
 
+/*
+ * Shared state of a sort performed by several backends.  This lives in
+ * dynamic shared memory; see tuplesort_initialize_shared().
+ */
+struct Sharedsort
+{
+	slock_t		mutex;			/* protects the counters below */
+	int			nWorkers;		/* maximum number of workers */
+	int			workersAttached;	/* # of workers that have attached */
+	int			workersFinished;	/* # of workers that wrote their run */
+
+	/* Temporary files holding each worker's output run */
+	SharedFileSet fileset;
+};
+
 typedef int (*SortTupleComparator) (const SortTuple *a, const SortTuple *b,
 												Tuplesortstate *state);
 
@@ -261,13 +283,13 @@ struct Tuplesortstate
 
 	/*
 	 * This array holds the tuples now in sort memory.  If we are in state
-	 * INITIAL, the tuples are in no particular order; if we are in state
-	 * SORTEDINMEM, the tuples are in final sorted order; in states BUILDRUNS
-	 * and FINALMERGE, the tuples are organized in "heap" order per Algorithm
-	 * H.  (Note that memtupcount only counts the tuples that are part of the
-	 * heap --- during merge passes, memtuples[] entries beyond tapeRange are
-	 * never in the heap and are used to hold pre-read tuples.)  In state
-	 * SORTEDONTAPE, the array is not used.
+	 * INITIAL or BUILDRUNS, the tuples are in no particular order; if we are
+	 * in state SORTEDINMEM, the tuples are in final sorted order; in states
+	 * BOUNDED and FINALMERGE, the tuples are organized in "heap" order per
+	 * Algorithm H.  (Note that memtupcount only counts the tuples that are
+	 * part of the heap --- during merge passes, memtuples[] entries beyond
+	 * tapeRange are never in the heap and are used to hold pre-read tuples.)
+	 * In state SORTEDONTAPE, the array is not used.
 	 */
 	SortTuple  *memtuples;		/* array of SortTuple structs */
 	int			memtupcount;	/* number of tuples currently present */
@@ -386,6 +408,16 @@ struct Tuplesortstate
 	int			datumTypeLen;
 	bool		datumTypeByVal;
 
+	/*
+	 * These variables are used only by sorts that cooperate with other
+	 * backends through a Sharedsort; shared is NULL otherwise.  worker is
+	 * this sort's worker number, or -1 in the leader.  nParticipants is the
+	 * number of workers whose runs the leader merges.
+	 */
+	Sharedsort *shared;
+	int			worker;
+	int			nParticipants;
+
 	/*
 	 * Resource snapshot for time of sort start.
 	 */
@@ -398,6 +430,8 @@ struct Tuplesortstate
 #define COPYTUP(state,stup,tup) ((*(state)->copytup) (state, stup, tup))
 #define WRITETUP(state,tape,stup)	((*(state)->writetup) (state, tape, stup))
 #define READTUP(state,stup,tape,len) ((*(state)->readtup) (state, stup, tape, len))
+#define WORKER(state)		((state)->shared && (state)->worker != -1)
+#define LEADER(state)		((state)->shared && (state)->worker == -1)
 #define LACKMEM(state)		((state)->availMem < 0)
 #define USEMEM(state,amt)	((state)->availMem -= (amt))
 #define FREEMEM(state,amt)	((state)->availMem += (amt))
@@ -455,18 +489,26 @@ static Tuplesortstate *tuplesort_begin_common(int workMem, bool randomAccess);
 static void puttuple_common(Tuplesortstate *state, SortTuple *tuple);
 static bool consider_abort_common(Tuplesortstate *state);
 static void inittapes(Tuplesortstate *state);
+static void inittapestate(Tuplesortstate *state, int maxTapes);
 static void selectnewtape(Tuplesortstate *state);
 static void mergeruns(Tuplesortstate *state);
 static void mergeonerun(Tuplesortstate *state);
+static void mergeoutput(Tuplesortstate *state, int destTape);
 static void beginmerge(Tuplesortstate *state);
 static void mergepreread(Tuplesortstate *state);
 static void mergeprereadone(Tuplesortstate *state, int srcTape);
 static void dumptuples(Tuplesortstate *state, bool alltuples);
+static void tuplesort_sort_memtuples(Tuplesortstate *state);
+static void sharedsort_filename(char *filename, int worker);
+static void worker_export_result(Tuplesortstate *state);
+static void leader_takeover_runs(Tuplesortstate *state);
 static void make_bounded_heap(Tuplesortstate *state);
 static void sort_bounded_heap(Tuplesortstate *state);
 static void tuplesort_heap_insert(Tuplesortstate *state, SortTuple *tuple,
-					  int tupleindex, bool checkIndex);
-static void tuplesort_heap_siftup(Tuplesortstate *state, bool checkIndex);
+					  int tupleindex);
+static void tuplesort_heap_replace_top(Tuplesortstate *state,
+						   SortTuple *tuple, int tupleindex);
+static void tuplesort_heap_delete_top(Tuplesortstate *state);
 static void reversedirection(Tuplesortstate *state);
 static unsigned int getlen(Tuplesortstate *state, int tapenum, bool eofOK);
 static void markrunend(Tuplesortstate *state, int tapenum);
@@ -590,6 +632,10 @@ tuplesort_begin_common(int workMem, bool randomAccess)
 
 	state->result_tape = -1;	/* flag that result tape has not been formed */
 
+	state->shared = NULL;
+	state->worker = -1;
+	state->nParticipants = 0;
+
 	MemoryContextSwitchTo(oldcontext);
 
 	return state;
@@ -949,6 +995,7 @@ tuplesort_set_bound(Tuplesortstate *state, int64 bound)
 	Assert(state->status == TSS_INITIAL);
 	Assert(state->memtupcount == 0);
 	Assert(!state->bounded);
+	Assert(state->shared == NULL);
 
 #ifdef DEBUG_BOUNDED_SORT
 	/* Honor GUC setting that disables the feature (for easy testing) */
@@ -977,6 +1024,126 @@ tuplesort_set_bound(Tuplesortstate *state, int64 bound)
 	state->sortKeys->abbrev_full_comparator = NULL;
 }
 
+/*
+ * tuplesort_estimate_shared
+ *
+ *	Report the amount of shared memory needed for a Sharedsort.
+ */
+Size
+tuplesort_estimate_shared(void)
+{
+	return MAXALIGN(sizeof(Sharedsort));
+}
+
+/*
+ * tuplesort_initialize_shared
+ *
+ *	Initialize a Sharedsort in the dynamic shared memory segment 'seg', for
+ *	a sort that at most nWorkers worker backends will contribute to.  This
+ *	is done once, by the backend that sets up the segment; the temporary
+ *	files of the sort are removed when the last backend detaches from it.
+ */
+void
+tuplesort_initialize_shared(Sharedsort *shared, int nWorkers,
+							dsm_segment *seg)
+{
+	Assert(nWorkers > 0);
+
+	SpinLockInit(&shared->mutex);
+	shared->nWorkers = nWorkers;
+	shared->workersAttached = 0;
+	shared->workersFinished = 0;
+	SharedFileSetInit(&shared->fileset, seg);
+}
+
+/*
+ * tuplesort_reinitialize_shared
+ *
+ *	Reset a Sharedsort so that the same backends can perform another sort
+ *	with it, as when a query is rescanned.  The caller must make sure that
+ *	no backend is still using the previous sort, workers or leader; their
+ *	files are removed.
+ */
+void
+tuplesort_reinitialize_shared(Sharedsort *shared)
+{
+	SharedFileSetDeleteAll(&shared->fileset);
+	shared->workersAttached = 0;
+	shared->workersFinished = 0;
+}
+
+/*
+ * tuplesort_attach_shared
+ *
+ *	Attach a backend other than the one that initialized it to a Sharedsort.
+ */
+void
+tuplesort_attach_shared(Sharedsort *shared, dsm_segment *seg)
+{
+	SharedFileSetAttach(&shared->fileset, seg);
+}
+
+/*
+ * tuplesort_attach_worker
+ *
+ *	Make a newly begun sort one of the workers of a shared sort.
+ *
+ * The caller feeds the worker its share of the input as usual and then calls
+ * tuplesort_performsort, which leaves the sorted result in a shared file for
+ * the leader.  No tuples can be fetched from a worker sort.
+ */
+void
+tuplesort_attach_worker(Tuplesortstate *state, Sharedsort *shared)
+{
+	int			worker;
+
+	/* Assert we're called before loading any tuples */
+	Assert(state->status == TSS_INITIAL);
+	Assert(state->memtupcount == 0);
+	Assert(state->shared == NULL);
+
+	if (state->randomAccess || state->bounded)
+		elog(ERROR, "shared sorts do not support random access or bounded output");
+
+	SpinLockAcquire(&shared->mutex);
+	worker = shared->workersAttached;
+	if (worker < shared->nWorkers)
+		shared->workersAttached++;
+	SpinLockRelease(&shared->mutex);
+
+	if (worker >= shared->nWorkers)
+		elog(ERROR, "too many workers attached to shared sort");
+
+	state->shared = shared;
+	state->worker = worker;
+}
+
+/*
+ * tuplesort_attach_leader
+ *
+ *	Make a newly begun sort the leader of a shared sort.
+ *
+ * No tuples may be supplied to the leader; a backend that wants to sort part
+ * of the input itself should run a separate worker sort.  The caller must
+ * make sure that every worker that attached to the Sharedsort has completed
+ * tuplesort_performsort (for instance by waiting for the worker processes to
+ * exit) before calling tuplesort_performsort on the leader.  The leader then
+ * returns the merged output of all the workers.
+ */
+void
+tuplesort_attach_leader(Tuplesortstate *state, Sharedsort *shared)
+{
+	Assert(state->status == TSS_INITIAL);
+	Assert(state->memtupcount == 0);
+	Assert(state->shared == NULL);
+
+	if (state->randomAccess || state->bounded)
+		elog(ERROR, "shared sorts do not support random access or bounded output");
+
+	state->shared = shared;
+	state->worker = -1;
+}
+
 /*
  * tuplesort_end
  *
@@ -1391,7 +1558,8 @@ puttuple_common(Tuplesortstate *state, SortTuple *tuple)
 			inittapes(state);
 
 			/*
-			 * Dump tuples until we are back under the limit.
+			 * Sort the tuples collected so far and write them out as the
+			 * first run.
 			 */
 			dumptuples(state, false);
 			break;
@@ -1414,36 +1582,24 @@ puttuple_common(Tuplesortstate *state, SortTuple *tuple)
 			}
 			else
 			{
-				/* discard top of heap, sift up, insert new tuple */
+				/* discard top of heap, replacing it with the new tuple */
 				free_sort_tuple(state, &state->memtuples[0]);
-				tuplesort_heap_siftup(state, false);
-				tuplesort_heap_insert(state, tuple, 0, false);
+				tuplesort_heap_replace_top(state, tuple, 0);
 			}
 			break;
 
 		case TSS_BUILDRUNS:
 
 			/*
-			 * Insert the tuple into the heap, with run number currentRun if
-			 * it can go into the current run, else run number currentRun+1.
-			 * The tuple can go into the current run if it is >= the first
-			 * not-yet-output tuple.  (Actually, it could go into the current
-			 * run if it is >= the most recently output tuple ... but that
-			 * would require keeping around the tuple we last output, and it's
-			 * simplest to let writetup free each tuple as soon as it's
-			 * written.)
-			 *
-			 * Note there will always be at least one tuple in the heap at
-			 * this point; see dumptuples.
+			 * Save the tuple into the unsorted array.  dumptuples always
+			 * leaves at least one free slot.
 			 */
-			Assert(state->memtupcount > 0);
-			if (COMPARETUP(state, tuple, &state->memtuples[0]) >= 0)
-				tuplesort_heap_insert(state, tuple, state->currentRun, true);
-			else
-				tuplesort_heap_insert(state, tuple, state->currentRun + 1, true);
+			Assert(state->memtupcount < state->memtupsize);
+			state->memtuples[state->memtupcount++] = *tuple;
 
 			/*
-			 * If we are over the memory limit, dump tuples till we're under.
+			 * If we are over the memory limit or out of array slots, sort
+			 * the array and write it out as a run.
 			 */
 			dumptuples(state, false);
 			break;
@@ -1513,22 +1669,33 @@ tuplesort_performsort(Tuplesortstate *state)
 	{
 		case TSS_INITIAL:
 
+			/*
+			 * A leader has no input of its own.  Its runs are the ones the
+			 * workers wrote; set up to merge them.
+			 */
+			if (LEADER(state))
+			{
+				leader_takeover_runs(state);
+				state->eof_reached = false;
+				state->markpos_block = 0L;
+				state->markpos_offset = 0;
+				state->markpos_eof = false;
+				break;
+			}
+
 			/*
 			 * We were able to accumulate all the tuples within the allowed
 			 * amount of memory.  Just qsort 'em and we're done.
 			 */
-			if (state->memtupcount > 1)
+			tuplesort_sort_memtuples(state);
+
+			/* A worker hands its sorted tuples over to the leader */
+			if (WORKER(state))
 			{
-				/* Can we use the single-key sort function? */
-				if (state->onlyKey != NULL)
-					qsort_ssup(state->memtuples, state->memtupcount,
-							   state->onlyKey);
-				else
-					qsort_tuple(state->memtuples,
-								state->memtupcount,
-								state->comparetup,
-								state);
+				worker_export_result(state);
+				break;
 			}
+
 			state->current = 0;
 			state->eof_reached = false;
 			state->markpos_offset = 0;
@@ -1554,10 +1721,12 @@ tuplesort_performsort(Tuplesortstate *state)
 		case TSS_BUILDRUNS:
 
 			/*
-			 * Finish tape-based sort.  First, flush all tuples remaining in
-			 * memory out to tape; then merge until we have a single remaining
-			 * run (or, if !randomAccess, one run per tape). Note that
-			 * mergeruns sets the correct state->status.
+			 * Finish tape-based sort.  First, sort the tuples remaining in
+			 * memory and write them out as the last run; then merge until we
+			 * have a single remaining run (or, if !randomAccess, one run per
+			 * tape).  Note that mergeruns sets the correct state->status.  In
+			 * a worker, it also performs the final merge into the worker's
+			 * shared output.
 			 */
 			dumptuples(state, true);
 			mergeruns(state);
@@ -1599,6 +1768,8 @@ tuplesort_gettuple_common(Tuplesortstate *state, bool forward,
 {
 	unsigned int tuplen;
 
+	Assert(!WORKER(state));
+
 	switch (state->status)
 	{
 		case TSS_SORTEDINMEM:
@@ -1752,7 +1923,6 @@ tuplesort_gettuple_common(Tuplesortstate *state, bool forward,
 					state->availMem += tuplen;
 					state->mergeavailmem[srcTape] += tuplen;
 				}
-				tuplesort_heap_siftup(state, false);
 				if ((tupIndex = state->mergenext[srcTape]) == 0)
 				{
 					/*
@@ -1764,17 +1934,21 @@ tuplesort_gettuple_common(Tuplesortstate *state, bool forward,
 					mergeprereadone(state, srcTape);
 
 					/*
-					 * if still no data, we've reached end of run on this tape
+					 * if still no data, we've reached end of run on this
+					 * tape; remove the returned tuple from the heap
 					 */
 					if ((tupIndex = state->mergenext[srcTape]) == 0)
+					{
+						tuplesort_heap_delete_top(state);
 						return true;
+					}
 				}
-				/* pull next preread tuple from list, insert in heap */
+				/* pull next preread tuple from list, replace top of heap */
 				newtup = &state->memtuples[tupIndex];
 				state->mergenext[srcTape] = newtup->tupindex;
 				if (state->mergenext[srcTape] == 0)
 					state->mergelast[srcTape] = 0;
-				tuplesort_heap_insert(state, newtup, srcTape, false);
+				tuplesort_heap_replace_top(state, newtup, srcTape);
 				/* put the now-unused memtuples entry on the freelist */
 				newtup->tupindex = state->mergefreelist;
 				state->mergefreelist = tupIndex;
@@ -1992,8 +2166,17 @@ tuplesort_merge_order(int64 allowedMem)
 	mOrder = (allowedMem - TAPE_BUFFER_OVERHEAD) /
 		(MERGE_BUFFER_SIZE + TAPE_BUFFER_OVERHEAD);
 
-	/* Even in minimum memory, use at least a MINORDER merge */
+	/*
+	 * Even in minimum memory, use at least a MINORDER merge.  On the other
+	 * hand, even when we have lots of memory, do not use more than a MAXORDER
+	 * merge.  Tapes are pretty cheap, but the merge heap is not: beyond a few
+	 * hundred entries it no longer stays in the CPU caches, and each input
+	 * tape gets a smaller preread buffer.  It is better to give the tapes we
+	 * have larger buffers, so that each preread cycle reads more data
+	 * sequentially from every tape.
+	 */
 	mOrder = Max(mOrder, MINORDER);
+	mOrder = Min(mOrder, MAXORDER);
 
 	return mOrder;
 }
@@ -2007,9 +2190,7 @@ static void
 inittapes(Tuplesortstate *state)
 {
 	int			maxTapes,
-				ntuples,
 				j;
-	int64		tapeSpace;
 
 	/* Compute number of tapes to use: merge order plus 1 */
 	maxTapes = tuplesort_merge_order(state->allowedMem) + 1;
@@ -2021,15 +2202,46 @@ inittapes(Tuplesortstate *state)
 	 */
 	maxTapes = Min(maxTapes, state->memtupsize / 2);
 
-	state->maxTapes = maxTapes;
-	state->tapeRange = maxTapes - 1;
-
 #ifdef TRACE_SORT
 	if (trace_sort)
 		elog(LOG, "switching to external sort with %d tapes: %s",
 			 maxTapes, pg_rusage_show(&state->ru_start));
 #endif
 
+	inittapestate(state, maxTapes);
+
+	state->currentRun = 0;
+
+	/*
+	 * Initialize variables of Algorithm D (step D1).
+	 */
+	for (j = 0; j < maxTapes; j++)
+	{
+		state->tp_fib[j] = 1;
+		state->tp_runs[j] = 0;
+		state->tp_dummy[j] = 1;
+		state->tp_tapenum[j] = j;
+	}
+	state->tp_fib[state->tapeRange] = 0;
+	state->tp_dummy[state->tapeRange] = 0;
+
+	state->Level = 1;
+	state->destTape = 0;
+
+	state->status = TSS_BUILDRUNS;
+}
+
+/*
+ * inittapestate - create the tape set and per-tape arrays for maxTapes tapes
+ */
+static void
+inittapestate(Tuplesortstate *state, int maxTapes)
+{
+	int64		tapeSpace;
+
+	state->maxTapes = maxTapes;
+	state->tapeRange = maxTapes - 1;
+
 	/*
 	 * Decrease availMem to reflect the space needed for tape buffers; but
 	 * don't decrease it to the point that we have no room for tuples. (That
@@ -2051,9 +2263,12 @@ inittapes(Tuplesortstate *state)
 	PrepareTempTablespaces();
 
 	/*
-	 * Create the tape set and allocate the per-tape data arrays.
+	 * Create the tape set and allocate the per-tape data arrays.  A worker
+	 * needs one more tape, outside the control of Algorithm D, to export its
+	 * result on.
 	 */
-	state->tapeset = LogicalTapeSetCreate(maxTapes);
+	state->tapeset = LogicalTapeSetCreate(WORKER(state) ? maxTapes + 1 :
+										  maxTapes);
 
 	state->mergeactive = (bool *) palloc0(maxTapes * sizeof(bool));
 	state->mergenext = (int *) palloc0(maxTapes * sizeof(int));
@@ -2064,45 +2279,6 @@ inittapes(Tuplesortstate *state)
 	state->tp_runs = (int *) palloc0(maxTapes * sizeof(int));
 	state->tp_dummy = (int *) palloc0(maxTapes * sizeof(int));
 	state->tp_tapenum = (int *) palloc0(maxTapes * sizeof(int));
-
-	/*
-	 * Convert the unsorted contents of memtuples[] into a heap. Each tuple is
-	 * marked as belonging to run number zero.
-	 *
-	 * NOTE: we pass false for checkIndex since there's no point in comparing
-	 * indexes in this step, even though we do intend the indexes to be part
-	 * of the sort key...
-	 */
-	ntuples = state->memtupcount;
-	state->memtupcount = 0;		/* make the heap empty */
-	for (j = 0; j < ntuples; j++)
-	{
-		/* Must copy source tuple to avoid possible overwrite */
-		SortTuple	stup = state->memtuples[j];
-
-		tuplesort_heap_insert(state, &stup, 0, false);
-	}
-	Assert(state->memtupcount == ntuples);
-
-	state->currentRun = 0;
-
-	/*
-	 * Initialize variables of Algorithm D (step D1).
-	 */
-	for (j = 0; j < maxTapes; j++)
-	{
-		state->tp_fib[j] = 1;
-		state->tp_runs[j] = 0;
-		state->tp_dummy[j] = 1;
-		state->tp_tapenum[j] = j;
-	}
-	state->tp_fib[state->tapeRange] = 0;
-	state->tp_dummy[state->tapeRange] = 0;
-
-	state->Level = 1;
-	state->destTape = 0;
-
-	state->status = TSS_BUILDRUNS;
 }
 
 /*
@@ -2161,9 +2337,11 @@ mergeruns(Tuplesortstate *state)
 	 * If we produced only one initial run (quite likely if the total data
 	 * volume is between 1X and 2X workMem), we can just use that tape as the
 	 * finished output, rather than doing a useless merge.  (This obvious
-	 * optimization is not in Knuth's algorithm.)
+	 * optimization is not in Knuth's algorithm.)  That doesn't work in a
+	 * shared sort, whose worker must copy the run to its shared output and
+	 * whose leader's tapes cannot be frozen.
 	 */
-	if (state->currentRun == 1)
+	if (state->currentRun == 1 && state->shared == NULL)
 	{
 		state->result_tape = state->tp_tapenum[state->destTape];
 		/* must freeze and rewind the finished output tape */
@@ -2220,6 +2398,9 @@ mergeruns(Tuplesortstate *state)
 				/* Initialize for the final merge pass */
 				beginmerge(state);
 				state->status = TSS_FINALMERGE;
+				/* A worker performs the final merge into its shared output */
+				if (WORKER(state))
+					worker_export_result(state);
 				return;
 			}
 		}
@@ -2300,11 +2481,6 @@ static void
 mergeonerun(Tuplesortstate *state)
 {
 	int			destTape = state->tp_tapenum[state->tapeRange];
-	int			srcTape;
-	int			tupIndex;
-	SortTuple  *tup;
-	int64		priorAvail,
-				spaceFreed;
 
 	/*
 	 * Start the merge by loading one tuple from each active source tape into
@@ -2312,10 +2488,35 @@ mergeonerun(Tuplesortstate *state)
 	 */
 	beginmerge(state);
 
+	mergeoutput(state, destTape);
+	state->tp_runs[state->tapeRange]++;
+
+#ifdef TRACE_SORT
+	if (trace_sort)
+		elog(LOG, "finished %d-way merge step: %s", state->activeTapes,
+			 pg_rusage_show(&state->ru_start));
+#endif
+}
+
+/*
+ * mergeoutput - perform a merge set up by beginmerge, writing it to destTape
+ *
+ * destTape is an actual tape number.  The output is terminated by an
+ * end-of-run marker.
+ */
+static void
+mergeoutput(Tuplesortstate *state, int destTape)
+{
+	int			srcTape;
+	int			tupIndex;
+	SortTuple  *tup;
+	int64		priorAvail,
+				spaceFreed;
+
 	/*
-	 * Execute merge by repeatedly extracting lowest tuple in heap, writing it
-	 * out, and replacing it with next tuple from same tape (if there is
-	 * another one).
+	 * Execute merge by repeatedly writing out the lowest tuple in the heap,
+	 * and replacing it with next tuple from same tape (if there is another
+	 * one).
 	 */
 	while (state->memtupcount > 0)
 	{
@@ -2326,22 +2527,23 @@ mergeonerun(Tuplesortstate *state)
 		/* writetup adjusted total free space, now fix per-tape space */
 		spaceFreed = state->availMem - priorAvail;
 		state->mergeavailmem[srcTape] += spaceFreed;
-		/* compact the heap */
-		tuplesort_heap_siftup(state, false);
 		if ((tupIndex = state->mergenext[srcTape]) == 0)
 		{
 			/* out of preloaded data on this tape, try to read more */
 			mergepreread(state);
 			/* if still no data, we've reached end of run on this tape */
 			if ((tupIndex = state->mergenext[srcTape]) == 0)
+			{
+				tuplesort_heap_delete_top(state);
 				continue;
+			}
 		}
-		/* pull next preread tuple from list, insert in heap */
+		/* pull next preread tuple from list, replace top of heap */
 		tup = &state->memtuples[tupIndex];
 		state->mergenext[srcTape] = tup->tupindex;
 		if (state->mergenext[srcTape] == 0)
 			state->mergelast[srcTape] = 0;
-		tuplesort_heap_insert(state, tup, srcTape, false);
+		tuplesort_heap_replace_top(state, tup, srcTape);
 		/* put the now-unused memtuples entry on the freelist */
 		tup->tupindex = state->mergefreelist;
 		state->mergefreelist = tupIndex;
@@ -2350,16 +2552,9 @@ mergeonerun(Tuplesortstate *state)
 
 	/*
 	 * When the heap empties, we're done.  Write an end-of-run marker on the
-	 * output tape, and increment its count of real runs.
+	 * output tape.
 	 */
 	markrunend(state, destTape);
-	state->tp_runs[state->tapeRange]++;
-
-#ifdef TRACE_SORT
-	if (trace_sort)
-		elog(LOG, "finished %d-way merge step: %s", state->activeTapes,
-			 pg_rusage_show(&state->ru_start));
-#endif
 }
 
 /*
@@ -2444,7 +2639,7 @@ beginmerge(Tuplesortstate *state)
 			state->mergenext[srcTape] = tup->tupindex;
 			if (state->mergenext[srcTape] == 0)
 				state->mergelast[srcTape] = 0;
-			tuplesort_heap_insert(state, tup, srcTape, false);
+			tuplesort_heap_insert(state, tup, srcTape);
 			/* put the now-unused memtuples entry on the freelist */
 			tup->tupindex = state->mergefreelist;
 			state->mergefreelist = tupIndex;
@@ -2541,67 +2736,252 @@ mergeprereadone(Tuplesortstate *state, int srcTape)
 }
 
 /*
- * dumptuples - remove tuples from heap and write to tape
+ * dumptuples - sort the tuples in memory and write them out as a run
  *
  * This is used during initial-run building, but not during merging.
  *
- * When alltuples = false, dump only enough tuples to get under the
- * availMem limit (and leave at least one tuple in the heap in any case,
- * since puttuple assumes it always has a tuple to compare to).  We also
- * insist there be at least one free slot in the memtuples[] array.
- *
- * When alltuples = true, dump everything currently in memory.
- * (This case is only used at end of input data.)
- *
- * If we empty the heap, close out the current run and return (this should
- * only happen at end of input data).  If we see that the tuple run number
- * at the top of the heap has changed, start a new run.
+ * When alltuples = false, do nothing unless we have run out of memory or of
+ * memtuples[] slots; in that case, write out everything in memory, so that
+ * puttuple always finds a free slot afterwards.  When alltuples = true,
+ * write out whatever is in memory.  (This case is only used at end of input
+ * data.)
  */
 static void
 dumptuples(Tuplesortstate *state, bool alltuples)
 {
-	while (alltuples ||
-		   (LACKMEM(state) && state->memtupcount > 1) ||
-		   state->memtupcount >= state->memtupsize)
+	int			memtupwrite;
+	int			i;
+
+	if (!alltuples &&
+		!LACKMEM(state) && state->memtupcount < state->memtupsize)
+		return;
+
+	/*
+	 * A final call can find memory empty, if the input ran out just as a run
+	 * had been written.  Don't write an empty run then; every run but the
+	 * first must be preceded by selectnewtape(), and we don't want to call it
+	 * without a run to follow.
+	 */
+	if (state->memtupcount == 0)
+	{
+		Assert(alltuples && state->currentRun > 0);
+		return;
+	}
+
+	/* Select the tape for this run, unless it is the first */
+	if (state->currentRun > 0)
+		selectnewtape(state);
+
+#ifdef TRACE_SORT
+	if (trace_sort)
+		elog(LOG, "starting quicksort of run %d: %s",
+			 state->currentRun, pg_rusage_show(&state->ru_start));
+#endif
+
+	tuplesort_sort_memtuples(state);
+
+#ifdef TRACE_SORT
+	if (trace_sort)
+		elog(LOG, "finished quicksort of run %d: %s",
+			 state->currentRun, pg_rusage_show(&state->ru_start));
+#endif
+
+	memtupwrite = state->memtupcount;
+	for (i = 0; i < memtupwrite; i++)
 	{
-		/*
-		 * Dump the heap's frontmost entry, and sift up to remove it from the
-		 * heap.
-		 */
-		Assert(state->memtupcount > 0);
 		WRITETUP(state, state->tp_tapenum[state->destTape],
-				 &state->memtuples[0]);
-		tuplesort_heap_siftup(state, true);
+				 &state->memtuples[i]);
+		state->memtupcount--;
+	}
+	Assert(state->memtupcount == 0);
 
-		/*
-		 * If the heap is empty *or* top run number has changed, we've
-		 * finished the current run.
-		 */
-		if (state->memtupcount == 0 ||
-			state->currentRun != state->memtuples[0].tupindex)
-		{
-			markrunend(state, state->tp_tapenum[state->destTape]);
-			state->currentRun++;
-			state->tp_runs[state->destTape]++;
-			state->tp_dummy[state->destTape]--; /* per Alg D step D2 */
+	markrunend(state, state->tp_tapenum[state->destTape]);
+	state->currentRun++;
+	state->tp_runs[state->destTape]++;
+	state->tp_dummy[state->destTape]--; /* per Alg D step D2 */
 
 #ifdef TRACE_SORT
-			if (trace_sort)
-				elog(LOG, "finished writing%s run %d to tape %d: %s",
-					 (state->memtupcount == 0) ? " final" : "",
-					 state->currentRun, state->destTape,
-					 pg_rusage_show(&state->ru_start));
+	if (trace_sort)
+		elog(LOG, "finished writing run %d to tape %d: %s",
+			 state->currentRun, state->destTape,
+			 pg_rusage_show(&state->ru_start));
 #endif
+}
 
-			/*
-			 * Done if heap is empty, else prepare for new run.
-			 */
-			if (state->memtupcount == 0)
-				break;
-			Assert(state->currentRun == state->memtuples[0].tupindex);
-			selectnewtape(state);
-		}
+/*
+ * tuplesort_sort_memtuples - sort the tuples in memtuples[] in place
+ */
+static void
+tuplesort_sort_memtuples(Tuplesortstate *state)
+{
+	if (state->memtupcount > 1)
+	{
+		/* Can we use the single-key sort function? */
+		if (state->onlyKey != NULL)
+			qsort_ssup(state->memtuples, state->memtupcount,
+					   state->onlyKey);
+		else
+			qsort_tuple(state->memtuples,
+						state->memtupcount,
+						state->comparetup,
+						state);
+	}
+}
+
+/*
+ * sharedsort_filename - name of the shared file holding a worker's output
+ */
+static void
+sharedsort_filename(char *filename, int worker)
+{
+	snprintf(filename, MAXPGPATH, "sort_worker%d", worker);
+}
+
+/*
+ * worker_export_result - write a worker's sorted output for the leader
+ *
+ * This is called when a worker sort has either sorted all its tuples in
+ * memory, or set up the final merge of its runs.  The sorted tuples are
+ * written as a single run to a shared file named after the worker number,
+ * where the leader will look for it, and the worker is counted as finished.
+ */
+static void
+worker_export_result(Tuplesortstate *state)
+{
+	Sharedsort *shared = state->shared;
+	char		filename[MAXPGPATH];
+	int			destTape;
+
+	Assert(WORKER(state));
+
+	if (state->tapeset == NULL)
+	{
+		/* Sorted in memory; we need a tape set just for the output tape */
+		state->tapeset = LogicalTapeSetCreate(1);
+		destTape = 0;
+	}
+	else
+		destTape = state->maxTapes; /* the spare tape from inittapestate */
+
+	sharedsort_filename(filename, state->worker);
+	LogicalTapeExport(state->tapeset, destTape,
+					  BufFileCreateShared(&shared->fileset, filename));
+
+	if (state->status == TSS_FINALMERGE)
+		mergeoutput(state, destTape);
+	else
+	{
+		int			i;
+
+		for (i = 0; i < state->memtupcount; i++)
+			WRITETUP(state, destTape, &state->memtuples[i]);
+		state->memtupcount = 0;
+		markrunend(state, destTape);
 	}
+
+	/* Close the file, which makes it ready for the leader to open */
+	LogicalTapeRewind(state->tapeset, destTape, false);
+
+	SpinLockAcquire(&shared->mutex);
+	shared->workersFinished++;
+	SpinLockRelease(&shared->mutex);
+
+	state->result_tape = destTape;
+	state->status = TSS_SORTEDONTAPE;
+
+#ifdef TRACE_SORT
+	if (trace_sort)
+		elog(LOG, "worker %d finished writing its sorted output: %s",
+			 state->worker, pg_rusage_show(&state->ru_start));
+#endif
+}
+
+/*
+ * leader_takeover_runs - set up a leader sort to merge the workers' runs
+ *
+ * Each worker has left exactly one sorted run in a shared file.  We import
+ * those files as the input tapes of a new tape set, one tape per worker,
+ * and set up the state of Algorithm D as though we had written the runs
+ * ourselves.  mergeruns() then finds one run on every input tape, so the
+ * workers' runs are merged in a single pass, on-the-fly as the caller
+ * fetches tuples.
+ */
+static void
+leader_takeover_runs(Tuplesortstate *state)
+{
+	Sharedsort *shared = state->shared;
+	char		filename[MAXPGPATH];
+	int			nParticipants;
+	int			workersFinished;
+	int			j;
+
+	Assert(LEADER(state));
+	Assert(state->memtupcount == 0);
+
+	SpinLockAcquire(&shared->mutex);
+	nParticipants = shared->workersAttached;
+	workersFinished = shared->workersFinished;
+	SpinLockRelease(&shared->mutex);
+
+	if (workersFinished != nParticipants)
+		elog(ERROR, "only %d of %d sort workers have finished",
+			 workersFinished, nParticipants);
+
+	state->nParticipants = nParticipants;
+
+	/* With no workers, there is nothing to sort */
+	if (nParticipants == 0)
+	{
+		state->current = 0;
+		state->status = TSS_SORTEDINMEM;
+		return;
+	}
+
+	/*
+	 * We need at least one memtuples[] slot per input tape for the merge
+	 * heap, and one more for preread.
+	 */
+	if (state->memtupsize < 2 * nParticipants)
+	{
+		FREEMEM(state, GetMemoryChunkSpace(state->memtuples));
+		state->memtupsize = 2 * nParticipants;
+		state->memtuples = (SortTuple *)
+			repalloc(state->memtuples,
+					 state->memtupsize * sizeof(SortTuple));
+		USEMEM(state, GetMemoryChunkSpace(state->memtuples));
+	}
+	state->growmemtuples = false;
+
+#ifdef TRACE_SORT
+	if (trace_sort)
+		elog(LOG, "leader taking over the runs of %d sort workers: %s",
+			 nParticipants, pg_rusage_show(&state->ru_start));
+#endif
+
+	/* One input tape per worker, plus the unused output tape */
+	inittapestate(state, nParticipants + 1);
+
+	for (j = 0; j < nParticipants; j++)
+	{
+		sharedsort_filename(filename, j);
+		LogicalTapeImport(state->tapeset, j,
+						  BufFileOpenShared(&shared->fileset, filename));
+		state->tp_fib[j] = 1;
+		state->tp_runs[j] = 1;
+		state->tp_dummy[j] = 0;
+		state->tp_tapenum[j] = j;
+	}
+	state->tp_fib[state->tapeRange] = 0;
+	state->tp_runs[state->tapeRange] = 0;
+	state->tp_dummy[state->tapeRange] = 0;
+	state->tp_tapenum[state->tapeRange] = state->tapeRange;
+
+	state->Level = 1;
+	state->destTape = 0;
+	state->currentRun = nParticipants;
+	state->status = TSS_BUILDRUNS;
+
+	mergeruns(state);
 }
 
 /*
@@ -2759,16 +3139,8 @@ tuplesort_get_stats(Tuplesortstate *state,
 
 /*
  * Heap manipulation routines, per Knuth's Algorithm 5.2.3H.
- *
- * Compare two SortTuples.  If checkIndex is true, use the tuple index
- * as the front of the sort key; otherwise, no.
  */
 
-#define HEAPCOMPARE(tup1,tup2) \
-	(checkIndex && ((tup1)->tupindex != (tup2)->tupindex) ? \
-	 ((tup1)->tupindex) - ((tup2)->tupindex) : \
-	 COMPARETUP(state, tup1, tup2))
-
 /*
  * Convert the existing unordered array of SortTuples to a bounded heap,
  * discarding all but the smallest "state->bound" tuples.
@@ -2777,10 +3149,6 @@ tuplesort_get_stats(Tuplesortstate *state,
  * at the root (array entry zero), instead of the smallest as in the normal
  * sort case.  This allows us to discard the largest entry cheaply.
  * Therefore, we temporarily reverse the sort direction.
- *
- * We assume that all entries in a bounded heap will always have tupindex
- * zero; it therefore doesn't matter that HEAPCOMPARE() doesn't reverse
- * the direction of comparison for tupindexes.
  */
 static void
 make_bounded_heap(Tuplesortstate *state)
@@ -2798,27 +3166,25 @@ make_bounded_heap(Tuplesortstate *state)
 	state->memtupcount = 0;		/* make the heap empty */
 	for (i = 0; i < tupcount; i++)
 	{
-		if (state->memtupcount >= state->bound &&
-		  COMPARETUP(state, &state->memtuples[i], &state->memtuples[0]) <= 0)
+		/* Must copy source tuple to avoid possible overwrite */
+		SortTuple	stup = state->memtuples[i];
+
+		if (state->memtupcount < state->bound)
+		{
+			/* Insert next tuple into heap */
+			tuplesort_heap_insert(state, &stup, 0);
+		}
+		else if (COMPARETUP(state, &stup, &state->memtuples[0]) <= 0)
 		{
 			/* New tuple would just get thrown out, so skip it */
-			free_sort_tuple(state, &state->memtuples[i]);
+			free_sort_tuple(state, &stup);
 			CHECK_FOR_INTERRUPTS();
 		}
 		else
 		{
-			/* Insert next tuple into heap */
-			/* Must copy source tuple to avoid possible overwrite */
-			SortTuple	stup = state->memtuples[i];
-
-			tuplesort_heap_insert(state, &stup, 0, false);
-
-			/* If heap too full, discard largest entry */
-			if (state->memtupcount > state->bound)
-			{
-				free_sort_tuple(state, &state->memtuples[0]);
-				tuplesort_heap_siftup(state, false);
-			}
+			/* Heap is full; discard largest entry in favor of new tuple */
+			free_sort_tuple(state, &state->memtuples[0]);
+			tuplesort_heap_replace_top(state, &stup, 0);
 		}
 	}
 
@@ -2848,7 +3214,7 @@ sort_bounded_heap(Tuplesortstate *state)
 		SortTuple	stup = state->memtuples[0];
 
 		/* this sifts-up the next-largest entry and decreases memtupcount */
-		tuplesort_heap_siftup(state, false);
+		tuplesort_heap_delete_top(state);
 		state->memtuples[state->memtupcount] = stup;
 	}
 	state->memtupcount = tupcount;
@@ -2875,7 +3241,7 @@ sort_bounded_heap(Tuplesortstate *state)
  */
 static void
 tuplesort_heap_insert(Tuplesortstate *state, SortTuple *tuple,
-					  int tupleindex, bool checkIndex)
+					  int tupleindex)
 {
 	SortTuple  *memtuples;
 	int			j;
@@ -2902,7 +3268,7 @@ tuplesort_heap_insert(Tuplesortstate *state, SortTuple *tuple,
 	{
 		int			i = (j - 1) >> 1;
 
-		if (HEAPCOMPARE(tuple, &memtuples[i]) >= 0)
+		if (COMPARETUP(state, tuple, &memtuples[i]) >= 0)
 			break;
 		memtuples[j] = memtuples[i];
 		j = i;
@@ -2911,24 +3277,32 @@ tuplesort_heap_insert(Tuplesortstate *state, SortTuple *tuple,
 }
 
 /*
- * The tuple at state->memtuples[0] has been removed from the heap.
- * Decrement memtupcount, and sift up to maintain the heap invariant.
+ * Replace the tuple at state->memtuples[0] with a new tuple, maintaining
+ * the heap invariant.  The heap size is unchanged.
+ *
+ * This does one pass down the heap from the root, per Knuth's Algorithm H
+ * steps H3-H8.  Merges use it in preference to deleting the top entry and
+ * inserting its replacement, which would take two passes through the heap,
+ * the second one from a leaf that is unlikely to be in cache.
+ *
+ * The same caveat applies to *tuple as for tuplesort_heap_insert: it must
+ * not point into the heap itself.
  */
 static void
-tuplesort_heap_siftup(Tuplesortstate *state, bool checkIndex)
+tuplesort_heap_replace_top(Tuplesortstate *state, SortTuple *tuple,
+						   int tupleindex)
 {
 	SortTuple  *memtuples = state->memtuples;
-	SortTuple  *tuple;
 	int			i,
 				n;
 
-	if (--state->memtupcount <= 0)
-		return;
+	Assert(state->memtupcount >= 1);
 
 	CHECK_FOR_INTERRUPTS();
 
+	tuple->tupindex = tupleindex;
+
 	n = state->memtupcount;
-	tuple = &memtuples[n];		/* tuple that must be reinserted */
 	i = 0;						/* i is where the "hole" is */
 	for (;;)
 	{
@@ -2937,9 +3311,9 @@ tuplesort_heap_siftup(Tuplesortstate *state, bool checkIndex)
 		if (j >= n)
 			break;
 		if (j + 1 < n &&
-			HEAPCOMPARE(&memtuples[j], &memtuples[j + 1]) > 0)
+			COMPARETUP(state, &memtuples[j], &memtuples[j + 1]) > 0)
 			j++;
-		if (HEAPCOMPARE(tuple, &memtuples[j]) <= 0)
+		if (COMPARETUP(state, tuple, &memtuples[j]) <= 0)
 			break;
 		memtuples[i] = memtuples[j];
 		i = j;
@@ -2947,6 +3321,26 @@ tuplesort_heap_siftup(Tuplesortstate *state, bool checkIndex)
 	memtuples[i] = *tuple;
 }
 
+/*
+ * Remove the tuple at state->memtuples[0] from the heap.  Decrement
+ * memtupcount, and sift up to maintain the heap invariant.
+ */
+static void
+tuplesort_heap_delete_top(Tuplesortstate *state)
+{
+	SortTuple  *tuple;
+
+	if (--state->memtupcount <= 0)
+		return;
+
+	/*
+	 * The last entry of the heap is now just past its end, so it can be
+	 * used as the replacement for the top entry.
+	 */
+	tuple = &state->memtuples[state->memtupcount];
+	tuplesort_heap_replace_top(state, tuple, tuple->tupindex);
+}
+
 /*
  * Function to reverse the sort direction from its current state
  *
@@ -96,6 +96,12 @@
  * unrelated tuple stored into a slot recently freed by VACUUM.  If either
  * check fails, one may assume that there is no live descendant version.
  *
+ * A tuple that is being inserted speculatively (by INSERT ... ON CONFLICT)
+ * has a speculative insertion token in its t_ctid instead of its own TID,
+ * until the insertion is either confirmed or the tuple is killed.  The token
+ * is stored in the block number, and the offset number is set to the special
+ * value SpecTokenOffsetNumber, which can never be a valid offset.
+ *
  * Following the fixed header fields, the nulls bitmap is stored (beginning
  * at t_bits).  The bitmap is *not* stored if t_infomask shows that there
  * are no nulls in the tuple.  If an OID field is present (as indicated by
@@ -453,6 +459,29 @@ do { \
   (tup)->t_infomask2 &= ~HEAP_ONLY_TUPLE \
 )
 
+/*
+ * Special value used in t_ctid.ip_posid to indicate that t_ctid holds a
+ * speculative insertion token rather than a real TID.  This must be higher
+ * than MaxOffsetNumber, so that it cannot be mistaken for a valid offset.
+ */
+#define SpecTokenOffsetNumber		0xfffe
+
+#define HeapTupleHeaderIsSpeculative(tup) \
+( \
+	(tup)->t_ctid.ip_posid == SpecTokenOffsetNumber \
+)
+
+#define HeapTupleHeaderGetSpeculativeToken(tup) \
+( \
+	AssertMacro(HeapTupleHeaderIsSpeculative(tup)), \
+	ItemPointerGetBlockNumber(&(tup)->t_ctid) \
+)
+
+#define HeapTupleHeaderSetSpeculativeToken(tup, token)	\
+( \
+	ItemPointerSet(&(tup)->t_ctid, token, SpecTokenOffsetNumber) \
+)
+
 #define HeapTupleHeaderHasMatch(tup) \
 ( \
   (tup)->t_infomask2 & HEAP_TUPLE_HAS_MATCH \
@@ -20,6 +20,7 @@
 #include "access/xlogreader.h"
 #include "catalog/pg_index.h"
 #include "lib/stringinfo.h"
+#include "nodes/execnodes.h"
 #include "storage/bufmgr.h"
 
 /* There's room for a 16-bit vacuum cycle ID in BTPageOpaqueData */
@@ -634,6 +635,8 @@ extern Datum btbulkdelete(PG_FUNCTION_ARGS);
 extern Datum btvacuumcleanup(PG_FUNCTION_ARGS);
 extern Datum btcanreturn(PG_FUNCTION_ARGS);
 extern Datum btoptions(PG_FUNCTION_ARGS);
+extern void btbuildCallback(Relation index, HeapTuple htup, Datum *values,
+				bool *isnull, bool tupleIsAlive, void *state);
 
 /*
  * prototypes for functions in nbtinsert.c
@@ -710,12 +713,37 @@ extern void BTreeShmemInit(void);
  */
 typedef struct BTSpool BTSpool; /* opaque type known only within nbtsort.c */
 
+/* Working state for btbuild and its callback */
+typedef struct BTBuildState
+{
+	bool		isUnique;
+	bool		haveDead;
+	Relation	heapRel;
+	BTSpool    *spool;
+
+	/*
+	 * spool2 is needed only when the index is an unique index. Dead tuples
+	 * are put into spool2 instead of spool in order to avoid uniqueness
+	 * check.
+	 */
+	BTSpool    *spool2;
+	double		indtuples;
+
+	/*
+	 * In a parallel build, the leader's spools merge the sorted runs that
+	 * the participants left in the parallel context's segment.
+	 */
+	struct ParallelContext *pcxt;
+} BTBuildState;
+
 extern BTSpool *_bt_spoolinit(Relation heap, Relation index,
 			  bool isunique, bool isdead);
 extern void _bt_spooldestroy(BTSpool *btspool);
 extern void _bt_spool(BTSpool *btspool, ItemPointer self,
 		  Datum *values, bool *isnull);
 extern void _bt_leafbuild(BTSpool *btspool, BTSpool *spool2);
+extern double _bt_parallel_heapscan(BTBuildState *buildstate, Relation index,
+					  IndexInfo *indexInfo);
 
 /*
  * prototypes for functions in nbtxlog.c
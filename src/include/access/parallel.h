@@ -0,0 +1,56 @@
+/*-------------------------------------------------------------------------
+ *
+ * parallel.h
+ *	  Infrastructure for launching parallel workers
+ *
+ * Portions Copyright (c) 1996-2015, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/access/parallel.h
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include "access/xlogdefs.h"
+#include "lib/ilist.h"
+#include "postmaster/bgworker.h"
+#include "storage/dsm.h"
+#include "storage/shm_toc.h"
+
+typedef void (*parallel_worker_main_type) (dsm_segment *seg, shm_toc *toc);
+
+typedef struct ParallelContext
+{
+	dlist_node	node;
+	SubTransactionId subid;
+	int			nworkers;		/* number of workers requested */
+	int			nworkers_launched;		/* number actually registered */
+	parallel_worker_main_type entrypoint;
+	shm_toc_estimator estimator;
+	dsm_segment *seg;
+	shm_toc    *toc;
+	BackgroundWorkerHandle **worker;
+	bool		save_set_latch_on_sigusr1;
+} ParallelContext;
+
+extern int	ParallelWorkerNumber;
+
+#define IsParallelWorker()		(ParallelWorkerNumber >= 0)
+
+extern ParallelContext *CreateParallelContext(parallel_worker_main_type entrypoint,
+					  int nworkers);
+extern void InitializeParallelDSM(ParallelContext *pcxt);
+extern void ReinitializeParallelDSM(ParallelContext *pcxt);
+extern void LaunchParallelWorkers(ParallelContext *pcxt);
+extern bool ParallelWorkersStopped(ParallelContext *pcxt);
+extern void CheckParallelWorkerErrors(ParallelContext *pcxt);
+extern void WaitForParallelWorkersToFinish(ParallelContext *pcxt);
+extern void DestroyParallelContext(ParallelContext *pcxt);
+
+extern void AtEOSubXact_Parallel(bool isCommit, SubTransactionId mySubId);
+extern void AtEOXact_Parallel(bool isCommit);
+
+#endif   /* PARALLEL_H */
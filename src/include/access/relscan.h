@@ -19,6 +19,27 @@
 #include "access/htup_details.h"
 #include "access/itup.h"
 #include "access/tupdesc.h"
+#include "storage/readstream.h"
+#include "storage/spin.h"
+
+/*
+ * Shared state for parallel heap scan.
+ *
+ * Each backend participating in a parallel heap scan has its own
+ * HeapScanDesc in backend-private memory, and those objects all contain
+ * a pointer to this structure.  The information here must be sufficient
+ * to properly initialize each new HeapScanDesc as workers join the scan,
+ * and it must act as a font of block numbers for those workers.
+ */
+typedef struct ParallelHeapScanDescData
+{
+	Oid			phs_relid;		/* OID of relation to scan */
+	bool		phs_syncscan;	/* report location to syncscan logic? */
+	BlockNumber phs_nblocks;	/* # blocks in relation at start of scan */
+	slock_t		phs_mutex;		/* mutual exclusion for block number fields */
+	BlockNumber phs_startblock; /* starting block number */
+	BlockNumber phs_cblock;		/* current block number */
+}	ParallelHeapScanDescData;
 
 
 typedef struct HeapScanDescData
@@ -41,6 +62,13 @@ typedef struct HeapScanDescData
 	BlockNumber	rs_numblocks;	/* number of blocks to scan */
 	BufferAccessStrategy rs_strategy;	/* access strategy for reads */
 	bool		rs_syncscan;	/* report location to syncscan logic? */
+	ParallelHeapScanDesc rs_parallel;	/* parallel scan information */
+	ReadStream *rs_stream;		/* read-ahead for forward scans, or NULL */
+
+	/* state of the read stream's callback */
+	bool		rs_stream_inited;	/* false = callback not started yet */
+	BlockNumber rs_stream_next;	/* next block to hand to the stream */
+	BlockNumber rs_stream_left;	/* # of blocks still to hand to it */
 
 	/* scan current state */
 	bool		rs_inited;		/* false = scan not init'd yet */
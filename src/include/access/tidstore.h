@@ -0,0 +1,67 @@
+/*-------------------------------------------------------------------------
+ *
+ * tidstore.h
+ *	  Compact, block-grouped storage for a set of heap TIDs
+ *
+ *
+ * Portions Copyright (c) 1996-2015, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/access/tidstore.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef TIDSTORE_H
+#define TIDSTORE_H
+
+#include "storage/block.h"
+#include "storage/itemptr.h"
+#include "storage/off.h"
+
+/*
+ * Per-block entry.  The entries are kept in block number order at the start
+ * of the store; see tidstore.c for the meaning of ts_container.
+ */
+typedef struct TidStoreBlock
+{
+	BlockNumber ts_blkno;
+	uint32		ts_container;
+} TidStoreBlock;
+
+/*
+ * TidStore
+ *
+ *		ts_size			total size of the store, including this header
+ *		ts_num_tids		number of TIDs stored
+ *		ts_num_blocks	number of entries in ts_blocks
+ *		ts_data_used	bytes of the data area in use, at the end of the store
+ *		ts_blocks		variable-length array of block entries
+ *
+ * The store contains no pointers, so it can be copied or placed in shared
+ * memory as one chunk.
+ */
+typedef struct TidStore
+{
+	Size		ts_size;
+	int64		ts_num_tids;
+	int			ts_num_blocks;
+	Size		ts_data_used;
+	TidStoreBlock ts_blocks[FLEXIBLE_ARRAY_MEMBER];
+} TidStore;
+
+extern Size tidstore_size_for_blocks(BlockNumber nblocks);
+extern Size tidstore_estimate(Size max_bytes);
+extern TidStore *tidstore_create(Size max_bytes);
+extern TidStore *tidstore_init(void *space, Size size);
+extern void tidstore_reset(TidStore *ts);
+extern bool tidstore_is_full(TidStore *ts);
+extern void tidstore_add_offsets(TidStore *ts, BlockNumber blkno,
+					 OffsetNumber *offsets, int noffsets);
+extern bool tidstore_lookup(TidStore *ts, ItemPointer tid);
+extern int tidstore_get_offsets(TidStore *ts, int blockindex,
+					 BlockNumber *blkno, OffsetNumber *offsets);
+
+#define tidstore_num_tids(ts)		((ts)->ts_num_tids)
+#define tidstore_num_blocks(ts)		((ts)->ts_num_blocks)
+
+#endif   /* TIDSTORE_H */
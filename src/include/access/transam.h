@@ -134,6 +134,14 @@ typedef struct VariableCacheData
 	 */
 	TransactionId latestCompletedXid;	/* newest XID that has committed or
 										 * aborted */
+
+	/*
+	 * Number of top-level transactions with XIDs completed (committed or
+	 * aborted) since startup, plus one.  Whenever this hasn't changed, a
+	 * snapshot taken earlier is still valid; see GetSnapshotData().  Zero is
+	 * never a valid value.
+	 */
+	uint64		xactCompletionCount;
 } VariableCacheData;
 
 typedef VariableCacheData *VariableCache;
@@ -67,6 +67,11 @@ typedef struct tupleConstr
  * context and go away when the context is freed.  We set the tdrefcount
  * field of such a descriptor to -1, while reference-counted descriptors
  * always have tdrefcount >= 0.
+ *
+ * tdnfixedatts caches the length of the run of leading fixed-width attributes,
+ * whose offsets are fixed as long as none of them is null; the tuple
+ * deforming code computes it, and the offsets, on first use.  Anything that
+ * changes an attribute's length or alignment must reset it to -1.
  */
 typedef struct tupleDesc
 {
@@ -78,6 +83,8 @@ typedef struct tupleDesc
 	int32		tdtypmod;		/* typmod for tuple type */
 	bool		tdhasoid;		/* tuple has oid attribute in its header */
 	int			tdrefcount;		/* reference count, or -1 if not counting */
+	int			tdnfixedatts;	/* # of leading fixed-width attributes, or -1
+								 * if not yet computed; see heaptuple.c */
 }	*TupleDesc;
 
 
@@ -3951,6 +3951,10 @@ DATA(insert OID = 2510 (  pg_prepared_statement PGNSP PGUID 12 1 1000 0 0 f f f
 DESCR("get the prepared statements for this session");
 DATA(insert OID = 2511 (  pg_cursor PGNSP PGUID 12 1 1000 0 0 f f f f t t s 0 0 2249 "" "{25,25,16,16,16,1184}" "{o,o,o,o,o,o}" "{name,statement,is_holdable,is_binary,is_scrollable,creation_time}" _null_ pg_cursor _null_ _null_ _null_ ));
 DESCR("get the open cursors for this session");
+DATA(insert OID = 3277 (  pg_catcache_stats PGNSP PGUID 12 1 100 0 0 f f f f t t v 0 0 2249 "" "{23,26,26,20,20,20,20,20,20}" "{o,o,o,o,o,o,o,o,o}" "{cache_id,relid,indexrelid,entries,hits,neg_hits,misses,evictions,shared_hits}" _null_ pg_catcache_stats _null_ _null_ _null_ ));
+DESCR("statistics: catalog caches of this session");
+DATA(insert OID = 3278 (  pg_relcache_stats PGNSP PGUID 12 1 0 0 0 f f f f t f v 0 0 2249 "" "{20,20,20,20}" "{o,o,o,o}" "{entries,hits,misses,evictions}" _null_ pg_relcache_stats _null_ _null_ _null_ ));
+DESCR("statistics: relation cache of this session");
 DATA(insert OID = 2599 (  pg_timezone_abbrevs	PGNSP PGUID 12 1 1000 0 0 f f f f t t s 0 0 2249 "" "{25,1186,16}" "{o,o,o}" "{abbrev,utc_offset,is_dst}" _null_ pg_timezone_abbrevs _null_ _null_ _null_ ));
 DESCR("get the available time zone abbreviations");
 DATA(insert OID = 2856 (  pg_timezone_names		PGNSP PGUID 12 1 1000 0 0 f f f f t t s 0 0 2249 "" "{25,25,1186,16}" "{o,o,o,o}" "{name,abbrev,utc_offset,is_dst}" _null_ pg_timezone_names _null_ _null_ _null_ ));
@@ -138,6 +138,7 @@ extern int	vacuum_freeze_min_age;
 extern int	vacuum_freeze_table_age;
 extern int	vacuum_multixact_freeze_min_age;
 extern int	vacuum_multixact_freeze_table_age;
+extern int	max_parallel_vacuum_workers;
 
 
 /* in commands/vacuum.c */
@@ -0,0 +1,89 @@
+/*-------------------------------------------------------------------------
+ *
+ * execBatch.h
+ *	  Batch-at-a-time execution support.
+ *
+ * A node that supports it can hand its parent up to EXEC_BATCH_SIZE rows
+ * per call, as one array of values per requested column, instead of one
+ * TupleTableSlot at a time.  Rows that failed the node's quals are not
+ * removed from the arrays; they're just not marked in the selection array.
+ * Only pass-by-value columns are transported this way, so the values stay
+ * valid after the scan has moved on to another page.
+ *
+ * Currently only SeqScan produces batches, and only plain Agg consumes them.
+ *
+ *
+ * Portions Copyright (c) 1996-2015, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/executor/execBatch.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef EXECBATCH_H
+#define EXECBATCH_H
+
+#include "nodes/execnodes.h"
+
+#define EXEC_BATCH_SIZE		1024
+
+/*
+ * Comparison of an integer column with a constant, the only kind of qual
+ * that can be evaluated on a batch.
+ */
+typedef enum BatchCmpType
+{
+	BATCH_CMP_LT,
+	BATCH_CMP_LE,
+	BATCH_CMP_EQ,
+	BATCH_CMP_GE,
+	BATCH_CMP_GT,
+	BATCH_CMP_NE
+} BatchCmpType;
+
+typedef struct BatchQual
+{
+	int			col;			/* batch column compared */
+	BatchCmpType cmptype;		/* column <cmptype> constval */
+	int64		constval;
+} BatchQual;
+
+typedef struct TupleBatch
+{
+	/* set up by ExecInitBatch */
+	int			maxcols;		/* allocated length of column arrays */
+	int			ncols;			/* number of columns transported */
+	AttrNumber *attnums;		/* source attribute of each column */
+	int16	   *attlens;		/* and its length */
+	AttrNumber	maxattnum;		/* largest of the attnums */
+	int			nquals;			/* number of quals */
+	BatchQual  *quals;			/* quals, all of which must be true */
+
+	/* filled in by each ExecProcNodeBatch call */
+	bool		eof;			/* source has run out of rows (the consumer
+								 * must reset this when rescanning) */
+	int			nrows;			/* number of rows in the arrays */
+	int			nselected;		/* number of rows passing the quals */
+	bool	   *selected;		/* per row, does it pass the quals? */
+	Datum	  **values;			/* per column, nrows values */
+	bool	  **isnull;			/* per column, nrows null flags */
+} TupleBatch;
+
+/* GUC */
+extern bool batch_execution;
+
+extern TupleBatch *MakeTupleBatch(int maxcols, int maxquals);
+extern int	AddBatchColumn(TupleBatch *batch, AttrNumber attnum,
+			   int16 attlen);
+extern bool ExecBatchBuildQuals(TupleBatch *batch, List *qual, Index scanrelid);
+extern void ExecBatchQual(TupleBatch *batch);
+
+/* aggregation kernels, run over the selected rows of one column */
+extern int64 ExecBatchCount(TupleBatch *batch, int col);
+extern int64 ExecBatchSumInt(TupleBatch *batch, int col, int64 *sum);
+extern int64 ExecBatchSumInt8(TupleBatch *batch, int col,
+				 int64 *sum_hi, int64 *sum_lo);
+extern bool ExecBatchMaxInt(TupleBatch *batch, int col, int64 *result);
+extern bool ExecBatchMinInt(TupleBatch *batch, int col, int64 *result);
+
+#endif   /* EXECBATCH_H */
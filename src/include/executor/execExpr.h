@@ -0,0 +1,147 @@
+/*-------------------------------------------------------------------------
+ *
+ * execExpr.h
+ *	  Flattened representation of expression trees, used by execQual.c
+ *
+ * Expressions built from the most common node types (Vars, Consts, function
+ * and operator calls, AND/OR/NOT, simple null tests) are translated, on
+ * their first evaluation, into a linear array of steps.  Each step computes
+ * one value and stores it wherever its consumer wants it, typically straight
+ * into the argument array of the function that will use it, so running the
+ * expression needs neither recursion nor an indirect call per node.  Any
+ * other node type becomes a single step that runs the ordinary evalfunc of
+ * its ExprState subtree.
+ *
+ *
+ * Portions Copyright (c) 1996-2015, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/executor/execExpr.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef EXECEXPR_H
+#define EXECEXPR_H
+
+#include "nodes/execnodes.h"
+
+/*
+ * Step opcodes.  The *_FIRST variants of the Var opcodes make the one-time
+ * checks done by ExecEvalScalarVar, then overwrite their own opcode with the
+ * plain variant.
+ */
+typedef enum ExprEvalOp
+{
+	EEOP_DONE,					/* end of program */
+
+	EEOP_INNER_VAR_FIRST,
+	EEOP_OUTER_VAR_FIRST,
+	EEOP_SCAN_VAR_FIRST,
+	EEOP_INNER_VAR,
+	EEOP_OUTER_VAR,
+	EEOP_SCAN_VAR,
+
+	EEOP_CONST,
+	EEOP_PARAM_EXEC,
+
+	/* function call; _STRICT checks for null arguments first */
+	EEOP_FUNCEXPR,
+	EEOP_FUNCEXPR_STRICT,
+	/* same, but also collect function usage statistics */
+	EEOP_FUNCEXPR_FUSAGE,
+	EEOP_FUNCEXPR_STRICT_FUSAGE,
+
+	/* one step after each argument of an AND or OR */
+	EEOP_BOOL_AND_STEP_FIRST,
+	EEOP_BOOL_AND_STEP,
+	EEOP_BOOL_AND_STEP_LAST,
+	EEOP_BOOL_OR_STEP_FIRST,
+	EEOP_BOOL_OR_STEP,
+	EEOP_BOOL_OR_STEP_LAST,
+	EEOP_BOOL_NOT,
+
+	EEOP_NULLTEST_ISNULL,
+	EEOP_NULLTEST_ISNOTNULL,
+
+	/* evaluate a non-flattened ExprState subtree */
+	EEOP_EXPR,
+
+	EEOP_LAST					/* must be last */
+} ExprEvalOp;
+
+typedef struct ExprEvalStep
+{
+	ExprEvalOp	opcode;
+
+	/* where to store the result of this step */
+	Datum	   *resvalue;
+	bool	   *resnull;
+
+	union
+	{
+		/* for EEOP_*_VAR* */
+		struct
+		{
+			AttrNumber	attnum;
+			Oid			vartype;	/* for the one-time type check */
+		}			var;
+
+		/* for EEOP_CONST */
+		struct
+		{
+			Datum		value;
+			bool		isnull;
+		}			constval;
+
+		/* for EEOP_PARAM_EXEC */
+		struct
+		{
+			int			paramid;
+		}			param;
+
+		/* for EEOP_FUNCEXPR* */
+		struct
+		{
+			FunctionCallInfo fcinfo;
+			PGFunction	fn_addr;
+			int			nargs;
+		}			func;
+
+		/* for EEOP_BOOL_*_STEP* */
+		struct
+		{
+			bool	   *anynull;	/* shared by all steps of one AND/OR */
+			int			jumpdone;	/* step to go to once result is known */
+		}			boolexpr;
+
+		/* for EEOP_EXPR */
+		struct
+		{
+			ExprState  *state;
+		}			expr;
+	}			d;
+} ExprEvalStep;
+
+/*
+ * A flattened expression.  The program is allocated in the per-query memory
+ * context and hung off the ExprState of the expression's root node.
+ */
+typedef struct ExprEvalProgram
+{
+	ExprEvalStep *steps;
+	int			nsteps;
+	int			maxsteps;
+
+	/* result of the whole expression */
+	Datum		resvalue;
+	bool		resnull;
+} ExprEvalProgram;
+
+/* functions in execQual.c, also used by JIT compiled expressions */
+extern void CheckVarSlotCompatibility(TupleTableSlot *slot, AttrNumber attnum,
+						  Oid vartype);
+extern void ExecEvalStepParamExec(ExprEvalStep *op, ExprContext *econtext);
+extern void ExecEvalStepFuncUsage(ExprEvalStep *op, ExprContext *econtext);
+extern void ExecEvalStepExpr(ExprEvalStep *op, ExprContext *econtext);
+
+#endif   /* EXECEXPR_H */
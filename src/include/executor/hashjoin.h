@@ -15,7 +15,9 @@
 #define HASHJOIN_H
 
 #include "nodes/execnodes.h"
+#include "port/atomics.h"
 #include "storage/buffile.h"
+#include "storage/sharedfileset.h"
 
 /* ----------------------------------------------------------------
  *				hash-join hash table structures
@@ -54,6 +56,9 @@
  * inner batch file.  Subsequently, while reading either inner or outer batch
  * files, we might find tuples that no longer belong to the current batch;
  * if so, we just dump them out to the correct batch file.
+ *
+ * A hash join under a Gather node instead shares one hash table among all
+ * the participants; see ParallelHashJoinState below.
  * ----------------------------------------------------------------
  */
 
@@ -63,7 +68,12 @@
 
 typedef struct HashJoinTupleData
 {
-	struct HashJoinTupleData *next;		/* link to next tuple in same bucket */
+	/* link to next tuple in same bucket */
+	union
+	{
+		struct HashJoinTupleData *unshared;
+		uint32		shared;		/* offset in a shared table, or 0 */
+	}			next;
 	uint32		hashvalue;		/* tuple's hash code */
 	/* Tuple data, in MinimalTuple format, follows on a MAXALIGN boundary */
 }	HashJoinTupleData;
@@ -122,6 +132,75 @@ typedef struct HashMemoryChunkData *HashMemoryChunk;
 #define HASH_CHUNK_SIZE			(32 * 1024L)
 #define HASH_CHUNK_THRESHOLD	(HASH_CHUNK_SIZE / 4)
 
+/*
+ * A hash join whose outer and inner plans are both parallel sequential scans
+ * under a Gather node shares its hash table among the participants, master
+ * included.  The ParallelHashJoinState lives in the Gather node's dynamic
+ * shared memory segment, followed by flags recording which participants
+ * created which batch files, then the space for tuples and finally the
+ * bucket array.  Since each process may map the segment at a different
+ * address, buckets and tuples link to tuples by their offset from the start
+ * of the ParallelHashJoinState.
+ *
+ * The number of batches is fixed from the planner's estimate before the
+ * join starts.  The participants work through the batches together, each
+ * batch in two phases: PHJ_LOAD, in which they insert the batch's inner
+ * tuples into the shared table, and PHJ_PROBE, in which they look up the
+ * batch's outer tuples in it.  During batch 0, they get their tuples from
+ * the scans, and write those of later batches to batch files of their own
+ * in the shared file set; later, each participant claims whole files to
+ * read, written by any participant.  If the inner tuples of a batch don't
+ * all fit, the rest go to overflow files, and the batch is processed again
+ * for those, against all of its outer tuples; this is why only inner joins
+ * are done this way.
+ *
+ * Every participant attached to the join must finish a phase before any of
+ * them may start on the next one.  A participant that has run out of work
+ * waits on its latch for the others, so the master, which must keep reading
+ * the workers' tuples lest they block, never waits at the end of a probe:
+ * unless it is alone, it detaches instead, and leaves the rest of the join
+ * to the workers.  If it is alone, it closes the join to latecomers and
+ * carries on by itself.
+ */
+#define PHJ_LOAD				0
+#define PHJ_PROBE				1
+#define PHJ_DONE				2
+
+typedef struct ParallelHashJoinParticipant
+{
+	struct PGPROC *proc;		/* NULL unless attached */
+	bool		arrived;		/* done with the current phase? */
+} ParallelHashJoinParticipant;
+
+struct ParallelHashJoinState
+{
+	slock_t		mutex;			/* protects the fields up to spaceUsed */
+	int			generation;		/* bumped whenever the phase changes */
+	int			phase;			/* PHJ_LOAD, PHJ_PROBE or PHJ_DONE */
+	int			curbatch;		/* batch being processed */
+	int			curpass;		/* pass over it, counting overflows */
+	int			nattached;		/* participants attached right now */
+	int			narrived;		/* how many of them are done with phase */
+	bool		electing;		/* has one of them taken the next step? */
+	int			elector;		/* if so, which one */
+	bool		closed;			/* no more participants may attach */
+	bool		overflow;		/* some inner tuples didn't fit this pass */
+	int			nextfile;		/* whose batch file to claim next */
+	double		totalTuples;	/* # inner tuples hashed in batch 0 */
+	Size		spaceUsed;		/* tuple space given out this pass */
+
+	/* The rest is fixed when the state is initialized */
+	int			nparticipants;	/* master and workers */
+	int			nbuckets;		/* # buckets in the shared table */
+	int			log2_nbuckets;	/* its log2 */
+	int			nbatch;			/* number of batches */
+	Size		spaceAllowed;	/* size of the tuple space */
+	Size		spaceOffset;	/* offsets of the tuple space... */
+	Size		bucketsOffset;	/* ... and of the bucket array */
+	SharedFileSet fileset;		/* holds all the batch files */
+	ParallelHashJoinParticipant participants[FLEXIBLE_ARRAY_MEMBER];
+};
+
 typedef struct HashJoinTableData
 {
 	int			nbuckets;		/* # buckets in the in-memory hash table */
@@ -184,6 +263,21 @@ typedef struct HashJoinTableData
 
 	/* used for dense allocation of tuples (into linked chunks) */
 	HashMemoryChunk chunks;		/*  one list for the whole batch */
+
+	/*
+	 * The rest is used only by a shared hash table.  buckets and chunks are
+	 * then unused, and the batch file arrays hold the files we write.
+	 */
+	ParallelHashJoinState *parallel_state;	/* NULL if not shared */
+	pg_atomic_uint32 *shared_buckets;	/* the shared bucket array */
+	int			participant;	/* our slot in the shared state */
+	bool		attached;		/* are we taking part in the join? */
+	int			curpass;		/* pass over curbatch */
+	bool		saveOuter;		/* keep batch 0's outer tuples in a file? */
+	char	   *sharedChunk;	/* part of the tuple space we're filling */
+	Size		sharedChunkFree;	/* bytes left in it */
+	BufFile    *overflowFile;	/* inner tuples that didn't fit this pass */
+	BufFile    *sharedReadFile; /* batch file we are reading, if any */
 }	HashJoinTableData;
 
 #endif   /* HASHJOIN_H */
@@ -16,6 +16,13 @@
 
 #include "nodes/execnodes.h"
 
+/*
+ * A hashed Agg that runs out of work_mem spreads the input tuples of the
+ * groups it can't keep in memory over this many temporary files.
+ */
+#define HASHAGG_PARTITION_BITS	4
+#define HASHAGG_NUM_PARTITIONS	(1 << HASHAGG_PARTITION_BITS)
+
 extern AggState *ExecInitAgg(Agg *node, EState *estate, int eflags);
 extern TupleTableSlot *ExecAgg(AggState *node);
 extern void ExecEndAgg(AggState *node);
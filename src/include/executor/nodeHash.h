@@ -15,6 +15,8 @@
 #define NODEHASH_H
 
 #include "nodes/execnodes.h"
+#include "storage/buffile.h"
+#include "storage/dsm.h"
 
 extern HashState *ExecInitHash(Hash *node, EState *estate, int eflags);
 extern TupleTableSlot *ExecHash(HashState *node);
@@ -23,7 +25,7 @@ extern void ExecEndHash(HashState *node);
 extern void ExecReScanHash(HashState *node);
 
 extern HashJoinTable ExecHashTableCreate(Hash *node, List *hashOperators,
-					bool keepNulls);
+					bool keepNulls, ParallelHashJoinState *pstate);
 extern void ExecHashTableDestroy(HashJoinTable hashtable);
 extern void ExecHashTableInsert(HashJoinTable hashtable,
 					TupleTableSlot *slot,
@@ -45,9 +47,28 @@ extern bool ExecScanHashTableForUnmatched(HashJoinState *hjstate,
 extern void ExecHashTableReset(HashJoinTable hashtable);
 extern void ExecHashTableResetMatchFlags(HashJoinTable hashtable);
 extern void ExecChooseHashTableSize(double ntuples, int tupwidth, bool useskew,
+						int nparticipants,
 						int *numbuckets,
 						int *numbatches,
 						int *num_skew_mcvs);
 extern int	ExecHashGetSkewBucket(HashJoinTable hashtable, uint32 hashvalue);
 
+/* shared hash tables, for a hash join under Gather */
+extern Size ExecHashTableEstimateShared(Hash *node, int nparticipants);
+extern void ExecHashTableInitializeShared(ParallelHashJoinState *pstate,
+							  Hash *node, int nparticipants,
+							  dsm_segment *seg);
+extern void ExecHashTableAttachSharedSegment(ParallelHashJoinState *pstate,
+								 dsm_segment *seg);
+extern void ExecHashTableReInitializeShared(ParallelHashJoinState *pstate);
+extern bool ExecHashTableAttachShared(HashJoinTable hashtable);
+extern void ExecHashTableDetachShared(HashJoinTable hashtable);
+extern bool ExecHashTableHandOffShared(HashJoinTable hashtable);
+extern void ExecHashTableArriveShared(HashJoinTable hashtable);
+extern void ExecHashTableEndLoadShared(HashJoinTable hashtable);
+extern BufFile *ExecHashTableCreateSharedFile(HashJoinTable hashtable,
+							  bool inner, int batchno, int pass);
+extern BufFile *ExecHashTableOpenNextSharedFile(HashJoinTable hashtable,
+								bool inner);
+
 #endif   /* NODEHASH_H */
@@ -16,11 +16,19 @@
 
 #include "nodes/execnodes.h"
 #include "storage/buffile.h"
+#include "storage/dsm.h"
 
 extern HashJoinState *ExecInitHashJoin(HashJoin *node, EState *estate, int eflags);
 extern TupleTableSlot *ExecHashJoin(HashJoinState *node);
 extern void ExecEndHashJoin(HashJoinState *node);
 extern void ExecReScanHashJoin(HashJoinState *node);
+extern Size ExecHashJoinEstimateShared(HashJoinState *node, int nparticipants);
+extern void ExecHashJoinInitializeShared(HashJoinState *node,
+							 ParallelHashJoinState *pstate,
+							 int nparticipants, dsm_segment *seg);
+extern void ExecHashJoinAttachShared(HashJoinState *node,
+						 ParallelHashJoinState *pstate, dsm_segment *seg);
+extern void ExecHashJoinReInitializeShared(HashJoinState *node);
 
 extern void ExecHashJoinSaveTuple(MinimalTuple tuple, uint32 hashvalue,
 					  BufFile **fileptr);
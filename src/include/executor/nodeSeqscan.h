@@ -14,11 +14,18 @@
 #ifndef NODESEQSCAN_H
 #define NODESEQSCAN_H
 
+#include "access/heapam.h"
+#include "executor/execBatch.h"
 #include "nodes/execnodes.h"
 
 extern SeqScanState *ExecInitSeqScan(SeqScan *node, EState *estate, int eflags);
 extern TupleTableSlot *ExecSeqScan(SeqScanState *node);
+extern TupleBatch *ExecSeqScanInitBatch(SeqScanState *node, int ncols,
+					 AttrNumber *cols);
+extern bool ExecSeqScanBatch(SeqScanState *node, TupleBatch *batch);
 extern void ExecEndSeqScan(SeqScanState *node);
 extern void ExecReScanSeqScan(SeqScanState *node);
+extern void ExecSeqScanInitializeParallel(SeqScanState *node,
+							  ParallelHeapScanDesc pscan);
 
 #endif   /* NODESEQSCAN_H */
@@ -15,6 +15,7 @@
 #define NODESORT_H
 
 #include "nodes/execnodes.h"
+#include "utils/tuplesort.h"
 
 extern SortState *ExecInitSort(Sort *node, EState *estate, int eflags);
 extern TupleTableSlot *ExecSort(SortState *node);
@@ -22,5 +23,7 @@ extern void ExecEndSort(SortState *node);
 extern void ExecSortMarkPos(SortState *node);
 extern void ExecSortRestrPos(SortState *node);
 extern void ExecReScanSort(SortState *node);
+extern void ExecSortInitializeShared(SortState *node, Sharedsort *shared);
+extern void ExecSortShareInput(SortState *node);
 
 #endif   /* NODESORT_H */
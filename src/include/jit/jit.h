@@ -0,0 +1,91 @@
+/*-------------------------------------------------------------------------
+ *
+ * jit.h
+ *	  Provider independent JIT infrastructure.
+ *
+ * Portions Copyright (c) 1996-2015, PostgreSQL Global Development Group
+ *
+ * src/include/jit/jit.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef JIT_H
+#define JIT_H
+
+#include "nodes/execnodes.h"
+#include "portability/instr_time.h"
+#include "utils/resowner.h"
+
+
+/* Flags determining what kind of JIT operations to perform */
+#define PGJIT_NONE	   0
+#define PGJIT_PERFORM  (1 << 0)
+#define PGJIT_OPT3	   (1 << 1)
+#define PGJIT_EXPR	   (1 << 2)
+#define PGJIT_DEFORM   (1 << 3)
+
+
+typedef struct JitInstrumentation
+{
+	/* number of emitted functions */
+	int			created_functions;
+
+	/* accumulated time to generate code */
+	instr_time	generation_counter;
+
+	/* accumulated time for optimization */
+	instr_time	optimization_counter;
+
+	/* accumulated time for code emission */
+	instr_time	emission_counter;
+} JitInstrumentation;
+
+/*
+ * Per-query JIT state, created by the provider the first time something is
+ * compiled for a query and hung off the EState.  It is owned by the resource
+ * owner that was current at that time, so that it's released on abort.
+ */
+typedef struct JitContext
+{
+	/* see PGJIT_* above */
+	int			flags;
+
+	ResourceOwner resowner;
+
+	JitInstrumentation instr;
+} JitContext;
+
+typedef struct JitProviderCallbacks JitProviderCallbacks;
+
+extern void _PG_jit_provider_init(JitProviderCallbacks *cb);
+typedef void (*JitProviderInit) (JitProviderCallbacks *cb);
+typedef void (*JitProviderReleaseContextCB) (JitContext *context);
+typedef bool (*JitProviderCompileExprCB) (ExprState *state,
+													  ExprContext *econtext);
+
+struct JitProviderCallbacks
+{
+	JitProviderReleaseContextCB release_context;
+	JitProviderCompileExprCB compile_expr;
+};
+
+
+/* GUCs */
+extern bool jit_enabled;
+extern char *jit_provider;
+extern bool jit_expressions;
+extern bool jit_tuple_deforming;
+extern double jit_above_cost;
+extern double jit_optimize_above_cost;
+
+
+extern void jit_release_context(JitContext *context);
+
+/*
+ * Functions for JITing expressions.  The JIT provider may replace the
+ * ExprState's evalfunc with a compiled version; if it returns false the
+ * interpreter is used as before.
+ */
+extern bool jit_compile_expr(ExprState *state, ExprContext *econtext);
+
+#endif   /* JIT_H */
@@ -0,0 +1,74 @@
+/*-------------------------------------------------------------------------
+ *
+ * llvmjit.h
+ *	  LLVM JIT provider.
+ *
+ * Portions Copyright (c) 1996-2015, PostgreSQL Global Development Group
+ *
+ * src/include/jit/llvmjit.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef LLVMJIT_H
+#define LLVMJIT_H
+
+#ifndef USE_LLVM
+#error "llvmjit.h should only be included by code dealing with llvm"
+#endif
+
+#include <llvm-c/Core.h>
+#include <llvm-c/ExecutionEngine.h>
+
+#include "access/tupdesc.h"
+#include "jit/jit.h"
+#include "nodes/pg_list.h"
+
+
+typedef struct LLVMJitContext
+{
+	JitContext	base;
+
+	/* number of functions generated, used to make up unique names */
+	int			counter;
+
+	/* all code of this context is emitted by this engine */
+	LLVMExecutionEngineRef engine;
+
+	/* deforming functions already emitted, see llvm_compile_deform */
+	List	   *deform_functions;
+} LLVMJitContext;
+
+
+/* type and struct definitions, set up once in _PG_jit_provider_init */
+extern LLVMTypeRef TypeSizeT;
+extern LLVMTypeRef TypeDatum;
+extern LLVMTypeRef TypeStorageBool;
+extern LLVMTypeRef TypeInt32;
+extern LLVMTypeRef TypePtr;
+
+
+extern LLVMJitContext *llvm_create_context(int jitFlags);
+extern char *llvm_expand_funcname(LLVMJitContext *context,
+					 const char *basename);
+extern LLVMModuleRef llvm_create_module(LLVMJitContext *context);
+extern void *llvm_compile_module(LLVMJitContext *context, LLVMModuleRef mod,
+					const char *funcname);
+
+/* code generation helpers, in llvmjit.c */
+extern LLVMValueRef l_ptr_const(void *ptr, LLVMTypeRef type);
+extern LLVMValueRef l_field_ptr(LLVMBuilderRef b, LLVMValueRef base,
+			size_t offset, LLVMTypeRef type);
+extern LLVMValueRef l_load_field(LLVMBuilderRef b, LLVMValueRef base,
+			 size_t offset, LLVMTypeRef type, const char *name);
+extern LLVMValueRef l_call_ptr(LLVMBuilderRef b, void *fn,
+		   LLVMTypeRef fntype, LLVMValueRef *args, int nargs,
+		   const char *name);
+
+/* in llvmjit_deform.c */
+extern void *llvm_compile_deform(LLVMJitContext *context, TupleDesc desc,
+					int natts);
+
+/* in llvmjit_expr.c */
+extern bool llvm_compile_expr(ExprState *state, ExprContext *econtext);
+
+#endif   /* LLVMJIT_H */
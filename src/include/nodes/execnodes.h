@@ -41,13 +41,17 @@
  *		ExclusionOps		Per-column exclusion operators, or NULL if none
  *		ExclusionProcs		Underlying function OIDs for ExclusionOps
  *		ExclusionStrats		Opclass strategy numbers for ExclusionOps
+ *		UniqueOps			Theses are like Exclusion*, but for unique indexes
+ *		UniqueProcs
+ *		UniqueStrats
  *		Unique				is it a unique index?
  *		ReadyForInserts		is it valid for inserts?
  *		Concurrent			are we doing a concurrent index build?
  *		BrokenHotChain		did we detect any broken HOT chains?
+ *		ParallelWorkers		# of workers requested (excludes leader)
  *
- * ii_Concurrent and ii_BrokenHotChain are used only during index build;
- * they're conventionally set to false otherwise.
+ * ii_Concurrent, ii_BrokenHotChain and ii_ParallelWorkers are used only
+ * during index build; they're conventionally zeroed otherwise.
  * ----------------
  */
 typedef struct IndexInfo
@@ -62,10 +66,14 @@ typedef struct IndexInfo
 	Oid		   *ii_ExclusionOps;	/* array with one entry per column */
 	Oid		   *ii_ExclusionProcs;		/* array with one entry per column */
 	uint16	   *ii_ExclusionStrats;		/* array with one entry per column */
+	Oid		   *ii_UniqueOps;	/* array with one entry per column */
+	Oid		   *ii_UniqueProcs; /* array with one entry per column */
+	uint16	   *ii_UniqueStrats;	/* array with one entry per column */
 	bool		ii_Unique;
 	bool		ii_ReadyForInserts;
 	bool		ii_Concurrent;
 	bool		ii_BrokenHotChain;
+	int			ii_ParallelWorkers;
 } IndexInfo;
 
 /* ----------------
@@ -308,6 +316,8 @@ typedef struct JunkFilter
  *		ConstraintExprs			array of constraint-checking expr states
  *		junkFilter				for removing junk attributes from tuples
  *		projectReturning		for computing a RETURNING list
+ *		onConflictSetProj		for computing ON CONFLICT DO UPDATE SET
+ *		onConflictSetWhere		list of ON CONFLICT DO UPDATE exprs (qual)
  * ----------------
  */
 typedef struct ResultRelInfo
@@ -329,6 +339,8 @@ typedef struct ResultRelInfo
 	List	  **ri_ConstraintExprs;
 	JunkFilter *ri_junkFilter;
 	ProjectionInfo *ri_projectReturning;
+	ProjectionInfo *ri_onConflictSetProj;
+	List	   *ri_onConflictSetWhere;
 } ResultRelInfo;
 
 /* ----------------
@@ -407,6 +419,14 @@ typedef struct EState
 	HeapTuple  *es_epqTuple;	/* array of EPQ substitute tuples */
 	bool	   *es_epqTupleSet; /* true if EPQ tuple is provided */
 	bool	   *es_epqScanDone; /* true if EPQ tuple has been fetched */
+
+	/*
+	 * JIT information.  es_jit_flags indicates whether JIT should be
+	 * performed and with which options; es_jit is created on-demand when JIT
+	 * compiling.
+	 */
+	int			es_jit_flags;
+	struct JitContext *es_jit;
 } EState;
 
 
@@ -538,7 +558,10 @@ typedef HASH_SEQ_STATUS TupleHashIterator;
  * local run-time state (such as Var, Const, or Param).
  *
  * To save on dispatch overhead, each ExprState node contains a function
- * pointer to the routine to execute to evaluate the node.
+ * pointer to the routine to execute to evaluate the node.  Expressions made
+ * of common node types are additionally flattened into a linear program the
+ * first time they are evaluated (see executor/execExpr.h); the program is
+ * kept in evalprog of the root node.
  * ----------------
  */
 
@@ -554,6 +577,7 @@ struct ExprState
 	NodeTag		type;
 	Expr	   *expr;			/* associated Expr node */
 	ExprStateEvalFunc evalfunc; /* routine to run to execute node */
+	struct ExprEvalProgram *evalprog;	/* flattened form, or NULL */
 };
 
 /* ----------------
@@ -594,6 +618,21 @@ typedef struct AggrefExprState
 	int			aggno;			/* ID number for agg within its plan node */
 } AggrefExprState;
 
+/* ----------------
+ *		GroupingFuncExprState node
+ *
+ * The list of column numbers refers to the input tuples of the Agg node to
+ * which the GroupingFunc belongs; it is empty if that node has no grouping
+ * sets, in which case the result is always zero.
+ * ----------------
+ */
+typedef struct GroupingFuncExprState
+{
+	ExprState	xprstate;
+	struct AggState *aggstate;
+	List	   *clauses;		/* integer list of column numbers */
+} GroupingFuncExprState;
+
 /* ----------------
  *		WindowFuncExprState node
  * ----------------
@@ -1090,6 +1129,14 @@ typedef struct ModifyTableState
 	List	  **mt_arowmarks;	/* per-subplan ExecAuxRowMark lists */
 	EPQState	mt_epqstate;	/* for evaluating EvalPlanQual rechecks */
 	bool		fireBSTriggers; /* do we need to fire stmt triggers? */
+	OnConflictAction mt_onconflict;		/* ON CONFLICT type */
+	List	   *mt_arbiterindexes;		/* unique index OIDs to arbitrate
+										 * taking alt path */
+	TupleTableSlot *mt_existing;	/* slot to store existing target tuple in */
+	List	   *mt_excludedtlist;		/* the excluded pseudo relation's
+										 * tlist  */
+	TupleTableSlot *mt_conflproj;		/* CONFLICT ... SET ... projection
+										 * target */
 } ModifyTableState;
 
 /* ----------------
@@ -1648,12 +1695,15 @@ typedef struct MergeJoinState
  *		hj_JoinState			current state of ExecHashJoin state machine
  *		hj_MatchedOuter			true if found a join match for current outer
  *		hj_OuterNotEmpty		true if outer relation known not empty
+ *		hj_Shared				state of a hash table shared under Gather,
+ *								or NULL
  * ----------------
  */
 
 /* these structs are defined in executor/hashjoin.h: */
 typedef struct HashJoinTupleData *HashJoinTuple;
 typedef struct HashJoinTableData *HashJoinTable;
+typedef struct ParallelHashJoinState ParallelHashJoinState;
 
 typedef struct HashJoinState
 {
@@ -1675,6 +1725,7 @@ typedef struct HashJoinState
 	int			hj_JoinState;
 	bool		hj_MatchedOuter;
 	bool		hj_OuterNotEmpty;
+	ParallelHashJoinState *hj_Shared;
 } HashJoinState;
 
 
@@ -1714,6 +1765,7 @@ typedef struct SortState
 	bool		bounded_Done;	/* value of bounded we did the sort with */
 	int64		bound_Done;		/* value of bound we did the sort with */
 	void	   *tuplesortstate; /* private state of tuplesort.c */
+	struct Sharedsort *shared;	/* shared sort under Gather, if any */
 } SortState;
 
 /* ---------------------
@@ -1737,11 +1789,16 @@ typedef struct GroupState
  *	input group during evaluation of an Agg node's output tuple(s).  We
  *	create a second ExprContext, tmpcontext, in which to evaluate input
  *	expressions and run the aggregate transition functions.
+ *
+ *	With grouping sets, the transition values of each set live in a separate
+ *	ExprContext's per-tuple memory (aggcontexts[]), and aggcontext points at
+ *	the one for current_set.  pergroup then holds numaggs entries per set.
  * -------------------------
  */
 /* these structs are private in nodeAgg.c: */
 typedef struct AggStatePerAggData *AggStatePerAgg;
 typedef struct AggStatePerGroupData *AggStatePerGroup;
+typedef struct AggStatePerPhaseData *AggStatePerPhase;
 
 typedef struct AggState
 {
@@ -1758,12 +1815,40 @@ typedef struct AggState
 	/* these fields are used in AGG_PLAIN and AGG_SORTED modes: */
 	AggStatePerGroup pergroup;	/* per-Aggref-per-group working state */
 	HeapTuple	grp_firstTuple; /* copy of first tuple of current group */
+	struct TupleBatch *batch;	/* input batch, if reading input in batches */
+	/* these fields are used with grouping sets: */
+	int			numphases;		/* number of phases, one per rollup */
+	int			current_phase;	/* phase whose input we are reading */
+	AggStatePerPhase phases;	/* array of all phases */
+	int			maxsets;		/* most grouping sets in any phase */
+	int			current_set;	/* set whose transition values are in use */
+	ExprContext **aggcontexts;	/* per-set contexts for transition values */
+	Bitmapset  *all_grouped_cols;	/* all columns grouped in any set */
+	int			gset_finished;	/* number of leading sets done with group */
+	int			projected_set;	/* next finished set to emit */
+	Bitmapset  *nulled_cols;	/* grouped columns nulled in projected row */
+	bool		input_done;		/* current phase's input exhausted? */
+	struct Tuplesortstate *sort_in;	/* sorted input of current phase */
+	struct Tuplesortstate *sort_out;	/* input of next phase, being built */
+	TupleTableSlot *sort_slot;	/* slot for reading sort_in */
 	/* these fields are used in AGG_HASHED mode: */
 	TupleHashTable hashtable;	/* hash table with one entry per group */
 	TupleTableSlot *hashslot;	/* slot for loading hash table */
 	List	   *hash_needed;	/* list of columns needed in hash table */
 	bool		table_filled;	/* hash table filled yet? */
 	TupleHashIterator hashiter; /* for iterating through hash table */
+	/* these fields are used to spill AGG_HASHED input beyond work_mem: */
+	Size		hash_entry_size;	/* estimated memory per group */
+	Size		hash_mem_used;	/* memory used by hash table, as last measured
+								 * plus estimates for groups added since */
+	long		hash_mem_check_at;	/* # of groups at which to measure it */
+	bool		hash_spill_mode;	/* table is full, spill new groups? */
+	bool		hash_spilled;	/* did we spill anything since (re)start? */
+	struct HashAggSpill *hash_spill;	/* spill files of current pass */
+	List	   *hash_batches;	/* spilled batches not yet processed */
+	struct HashAggBatch *hash_cur_batch;	/* batch being read, or NULL */
+	TupleTableSlot *hash_spill_slot;	/* slot for reading spilled tuples */
+	int			hash_batches_used;		/* number of batches processed */
 } AggState;
 
 /* ----------------
@@ -1940,4 +2025,33 @@ typedef struct LimitState
 	TupleTableSlot *subSlot;	/* tuple last obtained from subplan */
 } LimitState;
 
+/* ----------------
+ *	 GatherState information
+ *
+ *		Gather nodes launch parallel workers on their first call, and
+ *		return tuples read from the workers' queues interleaved with
+ *		tuples produced by running the child plan locally.  When the
+ *		child is a Sort, the participants instead share one sort, and
+ *		the tuples all come from the local Sort's merge of their runs.
+ *		When it is a HashJoin, they share its hash table.
+ * ----------------
+ */
+typedef struct GatherState
+{
+	PlanState	ps;				/* its first field is NodeTag */
+	bool		initialized;	/* have we tried to launch workers? */
+	struct ParallelContext *pcxt;	/* parallel context, if any */
+	struct ParallelHeapScanDescData *pscan; /* shared scan state */
+	struct Sharedsort *sharedsort;	/* shared state of a Sort child */
+	struct ParallelHeapScanDescData *inner_pscan;	/* HashJoin's inner scan */
+	ParallelHashJoinState *sharedhash;	/* shared state of a HashJoin child */
+	int			nreaders;		/* number of queues still being read */
+	int			nextreader;		/* next queue to try */
+	struct shm_mq **queue;		/* queues still being read */
+	struct shm_mq_handle **reader;	/* our handles for those queues */
+	bool		need_to_scan_locally;	/* does the child have rows left? */
+	int			nworkers_launched;	/* for EXPLAIN ANALYZE */
+	TupleTableSlot *funnel_slot;	/* slot for tuples from workers */
+} GatherState;
+
 #endif   /* EXECNODES_H */
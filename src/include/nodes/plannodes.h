@@ -72,6 +72,8 @@ typedef struct PlannedStmt
 
 	bool		hasRowSecurity;	/* row security applied? */
 
+	int			jitFlags;		/* which forms of JIT should be performed */
+
 } PlannedStmt;
 
 /* macro for fetching the Plan associated with a SubPlan node */
@@ -182,6 +184,12 @@ typedef struct ModifyTable
 	List	   *fdwPrivLists;	/* per-target-table FDW private data lists */
 	List	   *rowMarks;		/* PlanRowMarks (non-locking only) */
 	int			epqParam;		/* ID of Param for EvalPlanQual re-eval */
+	OnConflictAction onConflictAction;	/* ON CONFLICT action */
+	List	   *arbiterIndexes; /* List of ON CONFLICT arbiter index OIDs  */
+	List	   *onConflictSet;	/* SET for INSERT ON CONFLICT DO UPDATE */
+	Node	   *onConflictWhere;	/* WHERE for ON CONFLICT UPDATE */
+	Index		exclRelRTI;		/* RTI of the EXCLUDED pseudo relation */
+	List	   *exclRelTlist;	/* tlist of the EXCLUDED pseudo relation */
 } ModifyTable;
 
 /* ----------------
@@ -649,6 +657,15 @@ typedef struct Group
  * executor startup.  (It is possible that there are no aggregate functions;
  * this could happen if they get optimized away by constant-folding, or if
  * we are using the Agg node to implement hash-based grouping.)
+ *
+ * With grouping sets, groupingSets holds the sets this node computes, as
+ * integer lists of ressortgrouprefs ordered from longest to shortest; each
+ * set must be a leading prefix of the grpColIdx columns, so that one pass
+ * over input sorted on grpColIdx computes all of them.  Sets that cannot
+ * share that ordering are computed by the nodes in chain: each is an Agg
+ * whose lefttree is a (never executed) Sort node describing the order its
+ * input must be re-sorted into.  Only the grouping fields of chained nodes
+ * are used; the top node's tlist and quals are used to project every row.
  * ---------------
  */
 typedef enum AggStrategy
@@ -666,6 +683,8 @@ typedef struct Agg
 	AttrNumber *grpColIdx;		/* their indexes in the target list */
 	Oid		   *grpOperators;	/* equality operators to compare with */
 	long		numGroups;		/* estimated number of groups in input */
+	List	   *groupingSets;	/* grouping sets to use */
+	List	   *chain;			/* chained Agg/Sort nodes */
 } Agg;
 
 /* ----------------
@@ -781,6 +800,19 @@ typedef struct Limit
 	Node	   *limitCount;		/* COUNT parameter, or NULL if none */
 } Limit;
 
+/* ----------------
+ *		gather node
+ *
+ * Gather collects the output of its child, a parallel-aware sequential
+ * scan, from num_workers background workers and from the master itself.
+ * ----------------
+ */
+typedef struct Gather
+{
+	Plan		plan;
+	int			num_workers;	/* number of workers to request */
+} Gather;
+
 
 /*
  * RowMarkType -
@@ -103,6 +103,7 @@ typedef struct PlannerGlobal
 
 	bool		hasRowSecurity;	/* row security applied? */
 
+	bool		parallelModeOK;	/* parallel mode potentially OK? */
 } PlannerGlobal;
 
 /* macro for fetching the Plan associated with a SubPlan node */
@@ -260,6 +261,9 @@ typedef struct PlannerInfo
 
 	/* optional private data for join_search_hook, e.g., GEQO */
 	void	   *join_search_private;
+
+	/* for GroupingFunc fixup in setrefs */
+	AttrNumber *grouping_map;
 } PlannerInfo;
 
 
@@ -320,6 +324,8 @@ typedef struct PlannerInfo
  *				appropriate projections have been done (ie, output width)
  *		consider_startup - true if there is any value in keeping paths for
  *						   this rel on the basis of having cheap startup cost
+ *		consider_parallel - true if the rel may be scanned by the workers of
+ *							a Gather node (only plain base relations)
  *		reltargetlist - List of Var and PlaceHolderVar nodes for the values
  *						we need to output from this relation.
  *						List is in no particular order, but all rels of an
@@ -430,6 +436,7 @@ typedef struct RelOptInfo
 
 	/* per-relation planner control flags */
 	bool		consider_startup;		/* keep cheap-startup-cost paths? */
+	bool		consider_parallel;		/* may workers scan it? */
 
 	/* materialization information */
 	List	   *reltargetlist;	/* Vars to be output by scan of relation */
@@ -1018,6 +1025,19 @@ typedef struct UniquePath
 	List	   *uniq_exprs;		/* expressions to be made unique */
 } UniquePath;
 
+/*
+ * GatherPath runs several copies of a sequential scan in parallel worker
+ * processes, and collects their output.  If path.pathkeys is not NIL, the
+ * participants sort their output into a shared sort, which the master merges
+ * to return it in that order.
+ */
+typedef struct GatherPath
+{
+	Path		path;
+	Path	   *subpath;		/* path for each worker */
+	int			num_workers;	/* number of workers sought to help */
+} GatherPath;
+
 /*
  * All join-type paths share these fields.
  */
@@ -152,6 +152,18 @@
 #define USE_PREFETCH
 #endif
 
+/*
+ * Default value for checkpoint_flush_after.  Asking the kernel to start
+ * writeback early is only cheap where sync_file_range() exists; elsewhere
+ * pg_flush_data() falls back to posix_fadvise(DONTNEED), which also evicts
+ * the data from the page cache, so leave the feature off by default there.
+ */
+#ifdef HAVE_SYNC_FILE_RANGE
+#define DEFAULT_CHECKPOINT_FLUSH_AFTER 32
+#else
+#define DEFAULT_CHECKPOINT_FLUSH_AFTER 0
+#endif
+
 /*
  * USE_SSL code should be compiled only when compiling with an SSL
  * implementation.  (Currently, only OpenSSL is supported, but we might add
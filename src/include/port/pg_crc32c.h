@@ -0,0 +1,104 @@
+/*-------------------------------------------------------------------------
+ *
+ * pg_crc32c.h
+ *	  Routines for computing CRC-32C checksums.
+ *
+ * The speed of CRC-32C calculation has a big impact on performance, so we
+ * jump through some hoops to get the best implementation for each
+ * platform.  Some CPU architectures have special instructions for speeding
+ * up CRC calculations (e.g. Intel SSE 4.2, ARMv8 CRC Extension); on other
+ * platforms we use the Slicing-by-8 algorithm which uses lookup tables.
+ *
+ * The public interface consists of four macros:
+ *
+ * INIT_CRC32C(crc)
+ *		Initialize a CRC accumulator
+ *
+ * COMP_CRC32C(crc, data, len)
+ *		Accumulate some (more) bytes into a CRC
+ *
+ * FIN_CRC32C(crc)
+ *		Finish a CRC calculation
+ *
+ * EQ_CRC32C(c1, c2)
+ *		Check for equality of two CRCs.
+ *
+ * All implementations produce the same result, so the choice can be made
+ * independently on each machine without affecting the on-disk format.
+ *
+ * Which implementation is used is decided at compile time from what the
+ * compiler tells us about the target.  If the compiler can generate the
+ * special instructions only for selected functions, we build both the
+ * hardware-accelerated and the Slicing-by-8 version and choose between them
+ * at runtime, after checking whether the CPU supports the instructions.
+ *
+ * Portions Copyright (c) 1996-2015, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/port/pg_crc32c.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef PG_CRC32C_H
+#define PG_CRC32C_H
+
+/*
+ * Decide which implementation(s) to build.
+ */
+#if defined(__SSE4_2__)
+/* compiler targets SSE 4.2 unconditionally, so use it unconditionally */
+#define USE_SSE42_CRC32C
+#elif (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__) && \
+	!defined(__clang__) && \
+	(__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+/* gcc 4.9 and up can compile the SSE 4.2 intrinsics for a single function */
+#define USE_SSE42_CRC32C_WITH_RUNTIME_CHECK
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+/* MSVC makes the SSE 4.2 intrinsics available without any special flags */
+#define USE_SSE42_CRC32C_WITH_RUNTIME_CHECK
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+/* compiler targets ARMv8 with the CRC Extension unconditionally */
+#define USE_ARMV8_CRC32C
+#elif defined(__aarch64__) && defined(__linux__) && defined(__GNUC__) && \
+	!defined(__clang__) && __GNUC__ >= 6
+/* gcc 6 and up can target the CRC Extension for a single function */
+#define USE_ARMV8_CRC32C_WITH_RUNTIME_CHECK
+#else
+#define USE_SLICING_BY_8_CRC32C
+#endif
+
+/* Slicing-by-8 is always built, as the fallback for the runtime check */
+extern uint32 pg_comp_crc32c_sb8(uint32 crc, const void *data, size_t len);
+
+#if defined(USE_SSE42_CRC32C) || defined(USE_SSE42_CRC32C_WITH_RUNTIME_CHECK)
+extern uint32 pg_comp_crc32c_sse42(uint32 crc, const void *data, size_t len);
+#endif
+#if defined(USE_ARMV8_CRC32C) || defined(USE_ARMV8_CRC32C_WITH_RUNTIME_CHECK)
+extern uint32 pg_comp_crc32c_armv8(uint32 crc, const void *data, size_t len);
+#endif
+
+#if defined(USE_SSE42_CRC32C_WITH_RUNTIME_CHECK) || \
+	defined(USE_ARMV8_CRC32C_WITH_RUNTIME_CHECK)
+/* function pointer, set to the best implementation on first call */
+extern uint32 (*pg_comp_crc32c) (uint32 crc, const void *data, size_t len);
+#endif
+
+#define INIT_CRC32C(crc) ((crc) = 0xFFFFFFFF)
+#define FIN_CRC32C(crc)	((crc) ^= 0xFFFFFFFF)
+#define EQ_CRC32C(c1, c2) ((c1) == (c2))
+
+#if defined(USE_SSE42_CRC32C)
+#define COMP_CRC32C(crc, data, len) \
+	((crc) = pg_comp_crc32c_sse42((crc), (data), (len)))
+#elif defined(USE_ARMV8_CRC32C)
+#define COMP_CRC32C(crc, data, len) \
+	((crc) = pg_comp_crc32c_armv8((crc), (data), (len)))
+#elif defined(USE_SLICING_BY_8_CRC32C)
+#define COMP_CRC32C(crc, data, len) \
+	((crc) = pg_comp_crc32c_sb8((crc), (data), (len)))
+#else
+#define COMP_CRC32C(crc, data, len) \
+	((crc) = pg_comp_crc32c((crc), (data), (len)))
+#endif
+
+#endif   /* PG_CRC32C_H */
@@ -54,6 +54,32 @@ extern int	bgwriter_lru_maxpages;
 extern double bgwriter_lru_multiplier;
 extern bool track_io_timing;
 extern int	target_prefetch_pages;
+extern int	checkpoint_flush_after;
+extern int	io_combine_limit;
+
+/* upper limit for checkpoint_flush_after */
+#define WRITEBACK_MAX_PENDING_FLUSHES 256
+
+/* upper limit for io_combine_limit, the most blocks ReadBuffers reads at once */
+#define MAX_IO_COMBINE_LIMIT 32
+
+/*
+ * Backend-local statistics about buffer pinning and victim selection.
+ * These are never reset; callers interested in a single query take the
+ * difference of two snapshots.
+ */
+typedef struct BufferPinStats
+{
+	long		shared_pins;	/* # of times a shared buffer was first pinned */
+	long		refcount_spills;	/* # of private refcounts moved to the
+									 * overflow hash table */
+	long		refcount_hash_hits;		/* # of private refcount lookups
+										 * satisfied by the hash table */
+	long		clock_sweep_ticks;		/* # of buffers examined by the clock
+										 * sweep */
+} BufferPinStats;
+
+extern PGDLLIMPORT BufferPinStats pgBufferPinStats;
 
 /* in buf_init.c */
 extern PGDLLIMPORT char *BufferBlocks;
@@ -146,10 +172,15 @@ extern PGDLLIMPORT int32 *LocalRefCount;
  */
 extern void PrefetchBuffer(Relation reln, ForkNumber forkNum,
 			   BlockNumber blockNum);
+extern void PrefetchBuffers(Relation reln, ForkNumber forkNum,
+				BlockNumber blockNum, int nblocks);
 extern Buffer ReadBuffer(Relation reln, BlockNumber blockNum);
 extern Buffer ReadBufferExtended(Relation reln, ForkNumber forkNum,
 				   BlockNumber blockNum, ReadBufferMode mode,
 				   BufferAccessStrategy strategy);
+extern int ReadBuffers(Relation reln, ForkNumber forkNum,
+			BlockNumber blockNum, int nblocks,
+			BufferAccessStrategy strategy, Buffer *buffers);
 extern Buffer ReadBufferWithoutRelcache(RelFileNode rnode,
 						  ForkNumber forkNum, BlockNumber blockNum,
 						  ReadBufferMode mode, BufferAccessStrategy strategy);
@@ -165,6 +196,7 @@ extern void InitBufferPoolAccess(void);
 extern void InitBufferPoolBackend(void);
 extern void AtEOXact_Buffers(bool isCommit);
 extern void PrintBufferLeakWarning(Buffer buffer);
+extern int	GetPinnedBufferCount(void);
 extern void CheckPointBuffers(int flags);
 extern BlockNumber BufferGetBlockNumber(Buffer buffer);
 extern BlockNumber RelationGetNumberOfBlocksInFork(Relation relation,
@@ -67,9 +67,16 @@ extern int	max_safe_fds;
 /* Operations on virtual Files --- equivalent to Unix kernel file ops */
 extern File PathNameOpenFile(FileName fileName, int fileFlags, int fileMode);
 extern File OpenTemporaryFile(bool interXact);
+extern File PathNameCreateTemporaryFile(const char *path,
+							bool error_on_failure);
+extern File PathNameOpenTemporaryFile(const char *path);
+extern bool PathNameDeleteTemporaryFile(const char *path,
+							bool error_on_failure);
 extern void FileClose(File file);
 extern int	FilePrefetch(File file, off_t offset, int amount);
+extern void FileWriteback(File file, off_t offset, off_t nbytes);
 extern int	FileRead(File file, char *buffer, int amount);
+extern int	FileReadv(File file, char **buffers, int nbuffers, int amount);
 extern int	FileWrite(File file, char *buffer, int amount);
 extern int	FileSync(File file);
 extern off_t FileSeek(File file, off_t offset, int whence);
@@ -102,7 +109,9 @@ extern void set_max_safe_fds(void);
 extern void closeAllVfds(void);
 extern void SetTempTablespaces(Oid *tableSpaces, int numSpaces);
 extern bool TempTablespacesAreSet(void);
+extern int	GetTempTablespaces(Oid *tableSpaces, int numSpaces);
 extern Oid	GetNextTempTableSpace(void);
+extern void TempTablespacePath(char *path, Oid tablespace);
 extern void AtEOXact_Files(void);
 extern void AtEOSubXact_Files(bool isCommit, SubTransactionId mySubid,
 				  SubTransactionId parentSubid);
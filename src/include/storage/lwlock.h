@@ -154,14 +154,20 @@ extern PGDLLIMPORT LWLockPadded *MainLWLockArray;
 #define LOG2_NUM_PREDICATELOCK_PARTITIONS  4
 #define NUM_PREDICATELOCK_PARTITIONS  (1 << LOG2_NUM_PREDICATELOCK_PARTITIONS)
 
+/* Number of partitions of the shared catalog cache hashtable */
+#define LOG2_NUM_SHARED_CATCACHE_PARTITIONS  4
+#define NUM_SHARED_CATCACHE_PARTITIONS  (1 << LOG2_NUM_SHARED_CATCACHE_PARTITIONS)
+
 /* Offsets for various chunks of preallocated lwlocks. */
 #define BUFFER_MAPPING_LWLOCK_OFFSET	NUM_INDIVIDUAL_LWLOCKS
 #define LOCK_MANAGER_LWLOCK_OFFSET		\
 	(BUFFER_MAPPING_LWLOCK_OFFSET + NUM_BUFFER_PARTITIONS)
 #define PREDICATELOCK_MANAGER_LWLOCK_OFFSET \
 	(LOCK_MANAGER_LWLOCK_OFFSET + NUM_LOCK_PARTITIONS)
-#define NUM_FIXED_LWLOCKS \
+#define SHARED_CATCACHE_LWLOCK_OFFSET \
 	(PREDICATELOCK_MANAGER_LWLOCK_OFFSET + NUM_PREDICATELOCK_PARTITIONS)
+#define NUM_FIXED_LWLOCKS \
+	(SHARED_CATCACHE_LWLOCK_OFFSET + NUM_SHARED_CATCACHE_PARTITIONS)
 
 typedef enum LWLockMode
 {
@@ -14,6 +14,7 @@
 #ifndef _PROC_H_
 #define _PROC_H_
 
+#include "access/clog.h"
 #include "access/xlogdefs.h"
 #include "lib/ilist.h"
 #include "storage/latch.h"
@@ -134,6 +135,28 @@ struct PGPROC
 
 	struct XidCache subxids;	/* cache for subtransaction XIDs */
 
+	/*
+	 * Support for group XID clearing at transaction end; see
+	 * ProcArrayGroupClearXid().
+	 */
+	bool		procArrayGroupMember;	/* true while waiting in the group */
+	pg_atomic_uint32 procArrayGroupNext;	/* next group member, or
+											 * INVALID_PGPROCNO */
+	TransactionId procArrayGroupMemberXid;	/* latestXid to pass to
+											 * ProcArrayEndTransaction */
+
+	/*
+	 * Support for group CLOG status updates at transaction end; see
+	 * TransactionGroupUpdateXidStatus().
+	 */
+	bool		clogGroupMember;	/* true while waiting in the group */
+	pg_atomic_uint32 clogGroupNext;	/* next group member, or
+									 * INVALID_PGPROCNO */
+	TransactionId clogGroupMemberXid;	/* top-level XID to set status for */
+	XidStatus	clogGroupMemberXidStatus;	/* status to set */
+	int			clogGroupMemberPage;	/* CLOG page holding the XIDs */
+	XLogRecPtr	clogGroupMemberLsn; /* WAL location of commit record */
+
 	/* Per-backend LWLock.  Protects fields below. */
 	LWLock	   *backendLock;	/* protects the fields below */
 
@@ -147,6 +170,9 @@ struct PGPROC
 
 /* NOTE: "typedef struct PGPROC PGPROC" appears in storage/lock.h. */
 
+/* Marks the end of a list of PGPROCs linked by pgprocno */
+#define INVALID_PGPROCNO		0x7FFFFFFF
+
 
 extern PGDLLIMPORT PGPROC *MyProc;
 extern PGDLLIMPORT struct PGXACT *MyPgXact;
@@ -195,6 +221,10 @@ typedef struct PROC_HDR
 	PGPROC	   *autovacFreeProcs;
 	/* Head of list of bgworker free PGPROC structures */
 	PGPROC	   *bgworkerFreeProcs;
+	/* First pgprocno of the group waiting for XID clearing */
+	pg_atomic_uint32 procArrayGroupFirst;
+	/* First pgprocno of the group waiting for CLOG status update */
+	pg_atomic_uint32 clogGroupFirst;
 	/* WALWriter process's latch */
 	Latch	   *walwriterLatch;
 	/* Checkpointer process's latch */
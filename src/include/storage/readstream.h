@@ -0,0 +1,42 @@
+/*-------------------------------------------------------------------------
+ *
+ * readstream.h
+ *	  Look-ahead reading of a stream of blocks of a relation.
+ *
+ * A read stream hands out pinned buffers for a sequence of blocks chosen by
+ * a callback, reading consecutive blocks with one system call and telling
+ * the kernel about blocks further ahead before they are needed.
+ *
+ * Portions Copyright (c) 1996-2015, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/storage/readstream.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef READSTREAM_H
+#define READSTREAM_H
+
+#include "storage/bufmgr.h"
+
+/*
+ * Callback returning the next block to read, or InvalidBlockNumber at the
+ * end of the stream.  per_block_data points to per_block_data_size bytes
+ * that the callback can fill in; they are handed back along with the
+ * block's buffer by ReadStreamNextBuffer.
+ */
+typedef BlockNumber (*ReadStreamBlockCB) (void *callback_private,
+													  void *per_block_data);
+
+/* ReadStream is an opaque type whose details are not known outside readstream.c. */
+typedef struct ReadStream ReadStream;
+
+extern ReadStream *BeginReadStream(Relation rel, ForkNumber forknum,
+				BufferAccessStrategy strategy,
+				ReadStreamBlockCB callback, void *callback_private,
+				size_t per_block_data_size);
+extern Buffer ReadStreamNextBuffer(ReadStream *stream, void **per_block_data);
+extern void ResetReadStream(ReadStream *stream);
+extern void EndReadStream(ReadStream *stream);
+
+#endif   /* READSTREAM_H */
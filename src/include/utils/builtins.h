@@ -1021,6 +1021,8 @@ extern Datum int2_accum_inv(PG_FUNCTION_ARGS);
 extern Datum int4_accum_inv(PG_FUNCTION_ARGS);
 extern Datum int8_accum_inv(PG_FUNCTION_ARGS);
 extern Datum int8_avg_accum(PG_FUNCTION_ARGS);
+extern Datum int8_avg_accum_batch(FunctionCallInfo fcinfo, Datum statedatum,
+					 int64 count, int64 sum_hi, int64 sum_lo);
 extern Datum numeric_avg(PG_FUNCTION_ARGS);
 extern Datum numeric_sum(PG_FUNCTION_ARGS);
 extern Datum numeric_var_pop(PG_FUNCTION_ARGS);
@@ -1032,6 +1034,7 @@ extern Datum int4_sum(PG_FUNCTION_ARGS);
 extern Datum int8_sum(PG_FUNCTION_ARGS);
 extern Datum int2_avg_accum(PG_FUNCTION_ARGS);
 extern Datum int4_avg_accum(PG_FUNCTION_ARGS);
+extern void int_avg_accum_batch(Datum transdatum, int64 count, int64 sum);
 extern Datum int2_avg_accum_inv(PG_FUNCTION_ARGS);
 extern Datum int4_avg_accum_inv(PG_FUNCTION_ARGS);
 extern Datum int8_avg(PG_FUNCTION_ARGS);
@@ -1223,4 +1226,10 @@ extern Datum pg_prepared_statement(PG_FUNCTION_ARGS);
 /* utils/mmgr/portalmem.c */
 extern Datum pg_cursor(PG_FUNCTION_ARGS);
 
+/* utils/cache/catcache.c */
+extern Datum pg_catcache_stats(PG_FUNCTION_ARGS);
+
+/* utils/cache/relcache.c */
+extern Datum pg_relcache_stats(PG_FUNCTION_ARGS);
+
 #endif   /* BUILTINS_H */
@@ -23,6 +23,7 @@
 #include "access/htup.h"
 #include "access/skey.h"
 #include "lib/ilist.h"
+#include "storage/sinval.h"
 #include "utils/relcache.h"
 
 /*
@@ -52,16 +53,20 @@ typedef struct catcache
 												 * heap scans */
 	bool		cc_isname[CATCACHE_MAXKEYS];	/* flag "name" key columns */
 	dlist_head	cc_lists;		/* list of CatCList structs */
-#ifdef CATCACHE_STATS
 	long		cc_searches;	/* total # searches against this cache */
 	long		cc_hits;		/* # of matches against existing entry */
 	long		cc_neg_hits;	/* # of matches against negative entry */
 	long		cc_newloads;	/* # of successful loads of new entry */
+	long		cc_shared_hits; /* # of new entries copied from the shared
+								 * catalog cache rather than loaded */
 
 	/*
 	 * cc_searches - (cc_hits + cc_neg_hits + cc_newloads) is number of failed
 	 * searches, each of which will result in loading a negative entry
 	 */
+	long		cc_evictions;	/* # of entries evicted to stay within
+								 * catalog_cache_max_size */
+#ifdef CATCACHE_STATS
 	long		cc_invals;		/* # of entries invalidated from cache */
 	long		cc_lsearches;	/* total # list-searches */
 	long		cc_lhits;		/* # of matches against existing lists */
@@ -83,6 +88,12 @@ typedef struct catctup
 	 */
 	dlist_node	cache_elem;		/* list member of per-bucket list */
 
+	/*
+	 * All tuples, in all caches, are also members of a global LRU list that
+	 * is used to evict entries when catalog_cache_max_size is exceeded.
+	 */
+	dlist_node	lru_elem;		/* list member of global LRU list */
+
 	/*
 	 * The tuple may also be a member of at most one CatCList.  (If a single
 	 * catcache is list-searched with varying numbers of keys, we may have to
@@ -155,12 +166,22 @@ typedef struct catcacheheader
 {
 	slist_head	ch_caches;		/* head of list of CatCache structs */
 	int			ch_ntup;		/* # of tuples in all caches */
+	dlist_head	ch_lru_list;	/* all tuples, most recently used first */
+	Size		ch_size;		/* approximate memory used by all tuples */
 } CatCacheHeader;
 
 
+/* GUC parameters */
+extern int	catalog_cache_max_size;
+extern int	shared_catalog_cache_size;
+
+
 /* this extern duplicates utils/memutils.h... */
 extern PGDLLIMPORT MemoryContext CacheMemoryContext;
 
+extern Size CatCacheShmemSize(void);
+extern void CatCacheShmemInit(void);
+
 extern void CreateCacheMemoryContext(void);
 extern void AtEOXact_CatCache(bool isCommit);
 
@@ -186,6 +207,9 @@ extern void ReleaseCatCacheList(CatCList *list);
 extern void ResetCatalogCaches(void);
 extern void CatalogCacheFlushCatalog(Oid catId);
 extern void CatalogCacheIdInvalidate(int cacheId, uint32 hashValue);
+extern void SharedCatCacheInvalidate(const SharedInvalidationMessage *msgs,
+						 int n);
+extern void SharedCatCacheDropDatabase(Oid dbId);
 extern void PrepareToInvalidateCacheTuple(Relation relation,
 							  HeapTuple tuple,
 							  HeapTuple newtuple,
@@ -16,6 +16,8 @@
 #ifndef LOGTAPE_H
 #define LOGTAPE_H
 
+#include "storage/buffile.h"
+
 /* LogicalTapeSet is an opaque type whose details are not known outside logtape.c. */
 
 typedef struct LogicalTapeSet LogicalTapeSet;
@@ -33,6 +35,10 @@ extern void LogicalTapeWrite(LogicalTapeSet *lts, int tapenum,
 				 void *ptr, size_t size);
 extern void LogicalTapeRewind(LogicalTapeSet *lts, int tapenum, bool forWrite);
 extern void LogicalTapeFreeze(LogicalTapeSet *lts, int tapenum);
+extern void LogicalTapeExport(LogicalTapeSet *lts, int tapenum,
+				  BufFile *file);
+extern void LogicalTapeImport(LogicalTapeSet *lts, int tapenum,
+				  BufFile *file);
 extern bool LogicalTapeBackspace(LogicalTapeSet *lts, int tapenum,
 					 size_t size);
 extern bool LogicalTapeSeek(LogicalTapeSet *lts, int tapenum,
@@ -10,7 +10,8 @@
  * We have three slightly different variants of a 32-bit CRC calculation:
  * CRC-32C (Castagnoli polynomial), CRC-32 (Ethernet polynomial), and a legacy
  * CRC-32 version that uses the lookup table in a funny way. They all consist
- * of four macros:
+ * of four macros.  CRC-32C is defined in port/pg_crc32c.h, as it has
+ * platform-specific implementations; the others are defined here.
  *
  * INIT_<variant>(crc)
  *		Initialize a CRC accumulator
@@ -39,6 +40,8 @@
 #define CRCDLLIMPORT PGDLLIMPORT
 #endif
 
+#include "port/pg_crc32c.h"
+
 typedef uint32 pg_crc32;
 
 /*
@@ -46,13 +49,9 @@ typedef uint32 pg_crc32;
  *
  * We use all-ones as the initial register contents and final bit inversion.
  * This is the same algorithm used e.g. in iSCSI. See RFC 3385 for more
- * details on the choice of polynomial.
+ * details on the choice of polynomial.  INIT_CRC32C, COMP_CRC32C,
+ * FIN_CRC32C and EQ_CRC32C come from port/pg_crc32c.h.
  */
-#define INIT_CRC32C(crc) ((crc) = 0xFFFFFFFF)
-#define FIN_CRC32C(crc)	((crc) ^= 0xFFFFFFFF)
-#define COMP_CRC32C(crc, data, len)	\
-	COMP_CRC32_NORMAL_TABLE(crc, data, len, pg_crc32c_table)
-#define EQ_CRC32C(c1, c2) ((c1) == (c2))
 
 /*
  * CRC-32, the same used e.g. in Ethernet.
@@ -114,8 +113,7 @@ do {															  \
 	} \
 } while (0)
 
-/* Constant tables for CRC-32C and CRC-32 polynomials */
-extern CRCDLLIMPORT const uint32 pg_crc32c_table[];
+/* Constant table for CRC-32 polynomials */
 extern CRCDLLIMPORT const uint32 pg_crc32_table[];
 
 #endif   /* PG_CRC_H */
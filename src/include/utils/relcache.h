@@ -121,6 +121,9 @@ extern void RelationCacheInitFilePreInvalidate(void);
 extern void RelationCacheInitFilePostInvalidate(void);
 extern void RelationCacheInitFileRemove(void);
 
+/* GUC parameter */
+extern int	relation_cache_max_entries;
+
 /* should be used only by relcache.c and catcache.c */
 extern bool criticalRelcachesBuilt;
 
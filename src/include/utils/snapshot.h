@@ -86,11 +86,24 @@ typedef struct SnapshotData
 	bool		takenDuringRecovery;	/* recovery-shaped snapshot? */
 	bool		copied;			/* false if it's a static snapshot */
 
+	/*
+	 * Value of ShmemVariableCache->xactCompletionCount when the snapshot was
+	 * built, or zero if it can't be reused by GetSnapshotData().
+	 */
+	uint64		snapXactCompletionCount;
+
 	/*
 	 * note: all ids in subxip[] are >= xmin, but we don't bother filtering
 	 * out any that are >= xmax
 	 */
 	CommandId	curcid;			/* in my xact, CID < curcid are visible */
+
+	/*
+	 * An extra return value for HeapTupleSatisfiesDirty, not used in MVCC
+	 * snapshots.
+	 */
+	uint32		speculativeToken;
+
 	uint32		active_count;	/* refcount on ActiveSnapshot stack */
 	uint32		regd_count;		/* refcount on RegisteredSnapshots */
 
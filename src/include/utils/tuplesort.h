@@ -23,6 +23,7 @@
 #include "access/itup.h"
 #include "executor/tuptable.h"
 #include "fmgr.h"
+#include "storage/dsm.h"
 #include "utils/relcache.h"
 
 
@@ -31,6 +32,12 @@
  */
 typedef struct Tuplesortstate Tuplesortstate;
 
+/*
+ * Sharedsort is the shared state of a sort divided among several backends;
+ * it is likewise opaque, and lives in a dynamic shared memory segment.
+ */
+typedef struct Sharedsort Sharedsort;
+
 /*
  * We provide multiple interfaces to what is essentially the same code,
  * since different callers have different data to be sorted and want to
@@ -81,6 +88,14 @@ extern Tuplesortstate *tuplesort_begin_datum(Oid datumType,
 
 extern void tuplesort_set_bound(Tuplesortstate *state, int64 bound);
 
+extern Size tuplesort_estimate_shared(void);
+extern void tuplesort_initialize_shared(Sharedsort *shared, int nWorkers,
+							dsm_segment *seg);
+extern void tuplesort_reinitialize_shared(Sharedsort *shared);
+extern void tuplesort_attach_shared(Sharedsort *shared, dsm_segment *seg);
+extern void tuplesort_attach_worker(Tuplesortstate *state, Sharedsort *shared);
+extern void tuplesort_attach_leader(Tuplesortstate *state, Sharedsort *shared);
+
 extern void tuplesort_puttupleslot(Tuplesortstate *state,
 					   TupleTableSlot *slot);
 extern void tuplesort_putheaptuple(Tuplesortstate *state, HeapTuple tup);
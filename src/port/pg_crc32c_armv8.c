@@ -0,0 +1,87 @@
+/*-------------------------------------------------------------------------
+ *
+ * pg_crc32c_armv8.c
+ *	  Compute CRC-32C checksum using ARMv8 CRC Extension instructions
+ *
+ * Portions Copyright (c) 1996-2015, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/port/pg_crc32c_armv8.c
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "c.h"
+
+#include "port/pg_crc32c.h"
+
+#if defined(USE_ARMV8_CRC32C) || defined(USE_ARMV8_CRC32C_WITH_RUNTIME_CHECK)
+
+/*
+ * Unless the compiler already targets the CRC Extension, ask gcc to
+ * generate the crc32c instructions for this file only.  The caller must
+ * check that the CPU supports them before calling pg_comp_crc32c_armv8();
+ * see pg_crc32c_choose.c.
+ */
+#ifndef USE_ARMV8_CRC32C
+#pragma GCC target ("+crc")
+#endif
+
+#include <arm_acle.h>
+
+uint32
+pg_comp_crc32c_armv8(uint32 crc, const void *data, size_t len)
+{
+	const unsigned char *p = data;
+	const unsigned char *pend = p + len;
+
+	/*
+	 * ARMv8 doesn't require alignment, but aligned memory access is
+	 * significantly faster.  Process leading bytes so that the loop below
+	 * starts with a pointer aligned to eight bytes.
+	 */
+	if (!PointerIsAligned(p, uint16) && p + 1 <= pend)
+	{
+		crc = __crc32cb(crc, *p);
+		p += 1;
+	}
+	if (!PointerIsAligned(p, uint32) && p + 2 <= pend)
+	{
+		crc = __crc32ch(crc, *(const uint16 *) p);
+		p += 2;
+	}
+	if (!PointerIsAligned(p, uint64) && p + 4 <= pend)
+	{
+		crc = __crc32cw(crc, *(const uint32 *) p);
+		p += 4;
+	}
+
+	/* Process eight bytes at a time, as far as we can. */
+	while (p + 8 <= pend)
+	{
+		crc = __crc32cd(crc, *(const uint64 *) p);
+		p += 8;
+	}
+
+	/* Process remaining 0-7 bytes. */
+	if (p + 4 <= pend)
+	{
+		crc = __crc32cw(crc, *(const uint32 *) p);
+		p += 4;
+	}
+	if (p + 2 <= pend)
+	{
+		crc = __crc32ch(crc, *(const uint16 *) p);
+		p += 2;
+	}
+	if (p < pend)
+	{
+		crc = __crc32cb(crc, *p);
+	}
+
+	return crc;
+}
+
+#endif   /* USE_ARMV8_CRC32C || USE_ARMV8_CRC32C_WITH_RUNTIME_CHECK */
@@ -0,0 +1,84 @@
+/*-------------------------------------------------------------------------
+ *
+ * pg_crc32c_choose.c
+ *	  Choose which CRC-32C implementation to use, at runtime.
+ *
+ * Try to use the special CRC instructions if the CPU supports them, and
+ * fall back to the slicing-by-8 implementation otherwise.  The check is
+ * done on the first call, through the pg_comp_crc32c function pointer,
+ * which then points directly to the chosen implementation.
+ *
+ * Portions Copyright (c) 1996-2015, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/port/pg_crc32c_choose.c
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "c.h"
+
+#include "port/pg_crc32c.h"
+
+#if defined(USE_SSE42_CRC32C_WITH_RUNTIME_CHECK)
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+
+static bool
+pg_crc32c_hw_available(void)
+{
+	unsigned int exx[4] = {0, 0, 0, 0};
+
+#if defined(_MSC_VER)
+	__cpuid((int *) exx, 1);
+#else
+	__get_cpuid(1, &exx[0], &exx[1], &exx[2], &exx[3]);
+#endif
+
+	/* SSE 4.2 support is reported in bit 20 of ECX */
+	return (exx[2] & (1 << 20)) != 0;
+}
+
+#define pg_comp_crc32c_hw pg_comp_crc32c_sse42
+
+#elif defined(USE_ARMV8_CRC32C_WITH_RUNTIME_CHECK)
+
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+
+static bool
+pg_crc32c_hw_available(void)
+{
+	return (getauxval(AT_HWCAP) & HWCAP_CRC32) != 0;
+}
+
+#define pg_comp_crc32c_hw pg_comp_crc32c_armv8
+
+#endif
+
+#ifdef pg_comp_crc32c_hw
+
+/*
+ * This gets called on the first call. It replaces the function pointer
+ * so that subsequent calls are routed directly to the chosen implementation.
+ */
+static uint32
+pg_comp_crc32c_choose(uint32 crc, const void *data, size_t len)
+{
+	if (pg_crc32c_hw_available())
+		pg_comp_crc32c = pg_comp_crc32c_hw;
+	else
+		pg_comp_crc32c = pg_comp_crc32c_sb8;
+
+	return pg_comp_crc32c(crc, data, len);
+}
+
+uint32		(*pg_comp_crc32c) (uint32 crc, const void *data, size_t len) = pg_comp_crc32c_choose;
+
+#endif   /* pg_comp_crc32c_hw */
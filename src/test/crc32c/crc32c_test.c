@@ -0,0 +1,208 @@
+/*-------------------------------------------------------------------------
+ *
+ * crc32c_test.c
+ *	  Check and benchmark the CRC-32C implementations in src/port.
+ *
+ * Every implementation compiled into this build is first checked against
+ * known CRC-32C values and against the slicing-by-8 implementation, for
+ * all alignments and lengths of a small buffer.  Then each one is timed on
+ * buffers of typical WAL record and page sizes, and the throughput is
+ * reported in bytes per nanosecond, plus bytes per cycle on x86 where the
+ * time stamp counter can be read.
+ *
+ * Usage: crc32c_test [total megabytes per measurement]
+ *
+ * Copyright (c) 2015, PostgreSQL Global Development Group
+ *
+ * src/test/crc32c/crc32c_test.c
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres_fe.h"
+
+#include <sys/time.h>
+
+#include "port/pg_crc32c.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_RDTSC
+#endif
+
+typedef uint32 (*crc_func) (uint32 crc, const void *data, size_t len);
+
+typedef struct
+{
+	const char *name;
+	crc_func	func;
+} crc_impl;
+
+static crc_impl impls[] = {
+	{"slicing-by-8", pg_comp_crc32c_sb8},
+#if defined(USE_SSE42_CRC32C_WITH_RUNTIME_CHECK) || \
+	defined(USE_ARMV8_CRC32C_WITH_RUNTIME_CHECK)
+	{"runtime choice", NULL},	/* filled in from pg_comp_crc32c */
+#endif
+#if defined(USE_SSE42_CRC32C)
+	{"SSE 4.2", pg_comp_crc32c_sse42},
+#endif
+#if defined(USE_ARMV8_CRC32C)
+	{"ARMv8", pg_comp_crc32c_armv8},
+#endif
+};
+
+static const size_t sizes[] = {64, 512, 8192, 65536};
+
+static uint32
+crc_of(crc_func func, const void *data, size_t len)
+{
+	uint32		crc = 0xFFFFFFFF;
+
+	crc = func(crc, data, len);
+	return crc ^ 0xFFFFFFFF;
+}
+
+/*
+ * Check an implementation.  Returns false on failure.
+ */
+static bool
+check_impl(const crc_impl *impl, const unsigned char *buf)
+{
+	size_t		align;
+	size_t		len;
+
+	/* test vectors from RFC 3720, section B.4 */
+	static const unsigned char zeros[32] = {0};
+	unsigned char ones[32];
+	unsigned char incr[32];
+
+	memset(ones, 0xFF, sizeof(ones));
+	for (len = 0; len < sizeof(incr); len++)
+		incr[len] = (unsigned char) len;
+
+	if (crc_of(impl->func, "123456789", 9) != 0xE3069283 ||
+		crc_of(impl->func, zeros, 32) != 0x8A9136AA ||
+		crc_of(impl->func, ones, 32) != 0x62A8AB43 ||
+		crc_of(impl->func, incr, 32) != 0x46DD794E)
+	{
+		fprintf(stderr, "%s: wrong result for test vector\n", impl->name);
+		return false;
+	}
+
+	for (align = 0; align < 8; align++)
+	{
+		for (len = 0; len < 256; len++)
+		{
+			if (crc_of(impl->func, buf + align, len) !=
+				crc_of(pg_comp_crc32c_sb8, buf + align, len))
+			{
+				fprintf(stderr, "%s: mismatch at alignment %d, length %d\n",
+						impl->name, (int) align, (int) len);
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+static void
+bench_impl(const crc_impl *impl, const unsigned char *buf, size_t total)
+{
+	int			i;
+
+	for (i = 0; i < lengthof(sizes); i++)
+	{
+		size_t		size = sizes[i];
+		size_t		loops = total / size;
+		size_t		n;
+		struct timeval start,
+					stop;
+		double		elapsed_ns;
+		uint32		crc = 0xFFFFFFFF;
+#ifdef HAVE_RDTSC
+		uint64		tsc_start,
+					tsc_stop;
+#endif
+
+		gettimeofday(&start, NULL);
+#ifdef HAVE_RDTSC
+		tsc_start = __rdtsc();
+#endif
+		for (n = 0; n < loops; n++)
+			crc = impl->func(crc, buf, size);
+#ifdef HAVE_RDTSC
+		tsc_stop = __rdtsc();
+#endif
+		gettimeofday(&stop, NULL);
+
+		elapsed_ns = (stop.tv_sec - start.tv_sec) * 1e9 +
+			(stop.tv_usec - start.tv_usec) * 1e3;
+
+		printf("%-16s %6d bytes: %8.3f bytes/ns",
+			   impl->name, (int) size,
+			   elapsed_ns > 0 ? (double) loops * size / elapsed_ns : 0.0);
+#ifdef HAVE_RDTSC
+		printf("  %8.3f bytes/cycle",
+			   tsc_stop > tsc_start ?
+			   (double) loops * size / (tsc_stop - tsc_start) : 0.0);
+#endif
+		/* print the CRC too, so that the loop can't be optimized away */
+		printf("  (crc %08X)\n", crc);
+	}
+}
+
+int
+main(int argc, char **argv)
+{
+	int			mb = 256;
+	size_t		total;
+	unsigned char *buf;
+	size_t		i;
+	bool		ok = true;
+
+	if (argc > 1)
+		mb = atoi(argv[1]);
+	if (mb <= 0)
+	{
+		fprintf(stderr, "usage: %s [megabytes]\n", argv[0]);
+		exit(1);
+	}
+	total = (size_t) mb * 1024 * 1024;
+
+	buf = malloc(sizes[lengthof(sizes) - 1] + 8);
+	if (buf == NULL)
+	{
+		fprintf(stderr, "out of memory\n");
+		exit(1);
+	}
+	srandom(12345);
+	for (i = 0; i < sizes[lengthof(sizes) - 1] + 8; i++)
+		buf[i] = (unsigned char) random();
+
+	for (i = 0; i < lengthof(impls); i++)
+	{
+#if defined(USE_SSE42_CRC32C_WITH_RUNTIME_CHECK) || \
+	defined(USE_ARMV8_CRC32C_WITH_RUNTIME_CHECK)
+		if (impls[i].func == NULL)
+		{
+			/* make the first call go through the chooser */
+			uint32		dummy = 0;
+
+			COMP_CRC32C(dummy, buf, 1);
+			impls[i].func = pg_comp_crc32c;
+		}
+#endif
+		if (!check_impl(&impls[i], buf))
+			ok = false;
+	}
+	if (!ok)
+		exit(1);
+	printf("all implementations passed\n\n");
+
+	for (i = 0; i < lengthof(impls); i++)
+		bench_impl(&impls[i], buf, total);
+
+	free(buf);
+	return 0;
+}
@@ -0,0 +1,36 @@
+# INSERT...ON CONFLICT DO UPDATE test
+#
+# This test shows that a conflicting row that is not visible to the snapshot
+# of a REPEATABLE READ transaction cannot be updated, while READ COMMITTED
+# mode updates it.
+
+setup
+{
+  CREATE TABLE upsert (key int primary key, val text);
+}
+
+teardown
+{
+  DROP TABLE upsert;
+}
+
+session "s1"
+setup
+{
+  BEGIN ISOLATION LEVEL READ COMMITTED;
+}
+step "insert1" { INSERT INTO upsert(key, val) VALUES(1, 'insert1') ON CONFLICT (key) DO UPDATE set val = upsert.val || ' updated by insert1'; }
+step "c1" { COMMIT; }
+
+session "s2"
+step "begin2rc" { BEGIN ISOLATION LEVEL READ COMMITTED; }
+step "begin2rr" { BEGIN ISOLATION LEVEL REPEATABLE READ; }
+step "snap2" { SELECT count(*) FROM upsert; }
+step "insert2" { INSERT INTO upsert(key, val) VALUES(1, 'insert2') ON CONFLICT (key) DO UPDATE set val = upsert.val || ' updated by insert2'; }
+step "donothing2" { INSERT INTO upsert(key, val) VALUES(1, 'donothing2') ON CONFLICT DO NOTHING; }
+step "select2" { SELECT * FROM upsert; }
+step "c2" { COMMIT; }
+
+permutation "begin2rc" "snap2" "insert1" "insert2" "c1" "select2" "c2"
+permutation "begin2rr" "snap2" "insert1" "insert2" "c1" "select2" "c2"
+permutation "begin2rr" "snap2" "insert1" "donothing2" "c1" "select2" "c2"
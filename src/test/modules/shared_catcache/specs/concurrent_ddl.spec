@@ -0,0 +1,33 @@
+# Shared catalog cache vs. concurrent DDL
+#
+# s1 and s3 look the function up while s2 replaces it.  Until s2 commits,
+# they must keep seeing the old definition (s3 takes it from the shared
+# cache, having never looked it up before); once s2 commits, both must see
+# the new one.  s2 itself sees its own change before committing.
+
+setup
+{
+    CREATE FUNCTION shcc_f() RETURNS text LANGUAGE sql AS $$SELECT 'old'::text$$;
+}
+
+teardown
+{
+    DROP FUNCTION shcc_f();
+}
+
+session "s1"
+step "s1_call"		{ SELECT shcc_f(); }
+
+session "s2"
+step "s2_begin"		{ BEGIN; }
+step "s2_replace"	{ CREATE OR REPLACE FUNCTION shcc_f() RETURNS text LANGUAGE sql AS $$SELECT 'new'::text$$; }
+step "s2_call"		{ SELECT shcc_f(); }
+step "s2_commit"	{ COMMIT; }
+step "s2_abort"		{ ROLLBACK; }
+
+session "s3"
+step "s3_call"		{ SELECT shcc_f(); }
+
+permutation "s1_call" "s2_begin" "s2_replace" "s2_call" "s1_call" "s3_call" "s2_commit" "s1_call" "s3_call"
+permutation "s1_call" "s2_begin" "s2_replace" "s3_call" "s2_abort" "s1_call" "s3_call"
+permutation "s2_begin" "s2_replace" "s1_call" "s2_commit" "s3_call" "s1_call"
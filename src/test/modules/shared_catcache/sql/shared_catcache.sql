@@ -0,0 +1,121 @@
+--
+-- Shared catalog cache
+--
+SHOW shared_catalog_cache_size;
+
+CREATE FUNCTION shcc_f() RETURNS int LANGUAGE sql AS 'SELECT 1';
+
+-- the first session to look the function up publishes its tuple, and a new
+-- session then finds it in shared memory rather than in pg_proc
+SELECT shcc_f();
+\c -
+SELECT shcc_f();
+SELECT sum(shared_hits) > 0 AS shared_hit FROM pg_catcache_stats()
+  WHERE indexrelid = 'pg_proc_oid_index'::regclass;
+
+-- committed changes reach new sessions
+CREATE OR REPLACE FUNCTION shcc_f() RETURNS int LANGUAGE sql AS 'SELECT 2';
+\c -
+SELECT shcc_f();
+ALTER FUNCTION shcc_f() RENAME TO shcc_g;
+\c -
+SELECT shcc_g();
+SELECT shcc_f();
+
+-- uncommitted ones don't
+BEGIN;
+CREATE OR REPLACE FUNCTION shcc_g() RETURNS int LANGUAGE sql AS 'SELECT 3';
+SELECT shcc_g();
+ROLLBACK;
+SELECT shcc_g();
+\c -
+SELECT shcc_g();
+
+-- columns, through pg_attribute and the relation cache
+CREATE TABLE shcc_t (a int, b text);
+INSERT INTO shcc_t VALUES (1, 'one');
+SELECT * FROM shcc_t;
+\c -
+SELECT * FROM shcc_t;
+ALTER TABLE shcc_t RENAME COLUMN b TO c;
+ALTER TABLE shcc_t ADD COLUMN d int DEFAULT 4;
+\c -
+SELECT * FROM shcc_t;
+SELECT b FROM shcc_t;
+
+-- tuples too large to be shared still work
+DO $$
+BEGIN
+  EXECUTE format('CREATE FUNCTION shcc_long() RETURNS int LANGUAGE sql AS %L',
+                 'SELECT length(' || quote_literal(repeat('x', 1000)) || ')');
+END
+$$;
+SELECT shcc_long();
+\c -
+SELECT shcc_long();
+
+-- once the shared cache is full, newly read tuples replace ones that
+-- haven't been used lately, so the last function called still gets shared
+DO $$
+BEGIN
+  FOR i IN 1..3000 LOOP
+    EXECUTE format('CREATE FUNCTION shcc_many_%s() RETURNS int LANGUAGE sql AS %L',
+                   i, 'SELECT ' || i);
+  END LOOP;
+END
+$$;
+\c -
+DO $$
+BEGIN
+  FOR i IN 1..3000 LOOP
+    EXECUTE format('SELECT shcc_many_%s()', i);
+  END LOOP;
+END
+$$;
+-- count the shared hits on pg_proc that running a query takes; the two
+-- measurements are alike, so the second finds what it needs locally
+CREATE FUNCTION shcc_proc_hits(query text) RETURNS numeric LANGUAGE plpgsql AS $$
+DECLARE
+  before numeric;
+  after numeric;
+BEGIN
+  before := (SELECT sum(shared_hits) FROM pg_catcache_stats()
+             WHERE indexrelid = 'pg_proc_oid_index'::regclass);
+  EXECUTE query;
+  after := (SELECT sum(shared_hits) FROM pg_catcache_stats()
+            WHERE indexrelid = 'pg_proc_oid_index'::regclass);
+  RETURN after - before;
+END
+$$;
+\c -
+SELECT shcc_proc_hits('SELECT shcc_many_1()') >= 0 AS warmed_up;
+SELECT shcc_proc_hits('SELECT shcc_many_3000()');
+DROP FUNCTION shcc_proc_hits(text);
+DO $$
+BEGIN
+  FOR i IN 1..3000 LOOP
+    EXECUTE format('DROP FUNCTION shcc_many_%s()', i);
+  END LOOP;
+END
+$$;
+
+-- a database created after a DROP DATABASE sees none of the old rows
+\set regdb :DBNAME
+CREATE DATABASE shcc_db;
+\c shcc_db
+CREATE FUNCTION shcc_f() RETURNS int LANGUAGE sql AS 'SELECT 5';
+\c shcc_db
+SELECT shcc_f();
+\c :regdb
+DROP DATABASE shcc_db;
+CREATE DATABASE shcc_db;
+\c shcc_db
+SELECT shcc_f();
+\c :regdb
+DROP DATABASE shcc_db;
+
+DROP FUNCTION shcc_g();
+DROP FUNCTION shcc_long();
+DROP TABLE shcc_t;
+\c -
+SELECT shcc_g();
@@ -0,0 +1,28 @@
+CREATE EXTENSION test_deform;
+
+--
+-- Leading fixed-width columns, with and without nulls among them, followed
+-- by variable-width ones.  The contents must come back the same whichever
+-- way the tuples are deformed.
+--
+CREATE TABLE deform_fixed (a int4 NOT NULL, b int8, c int2, d float8,
+						   e text, f int4);
+INSERT INTO deform_fixed
+	SELECT i, CASE WHEN i % 3 = 0 THEN NULL ELSE i * 10 END,
+		   CASE WHEN i % 5 = 0 THEN NULL ELSE i END, i / 2.0,
+		   repeat('x', i), i
+	FROM generate_series(1, 20) i;
+SELECT * FROM deform_fixed ORDER BY a;
+SELECT a, f FROM deform_fixed WHERE b IS NULL ORDER BY a;
+SELECT d, e FROM deform_fixed WHERE c IS NULL ORDER BY a;
+
+-- A table that was altered after the fixed offsets were cached.
+ALTER TABLE deform_fixed DROP COLUMN b;
+ALTER TABLE deform_fixed ADD COLUMN g int4 DEFAULT 42;
+SELECT * FROM deform_fixed WHERE a <= 6 ORDER BY a;
+
+-- The timings are unpredictable; just make sure the function runs.
+SELECT test_deform('deform_fixed', 10) >= 0 AS ok;
+
+CREATE TABLE deform_empty (a int4);
+SELECT test_deform('deform_empty');
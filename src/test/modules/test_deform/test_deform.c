@@ -0,0 +1,98 @@
+/*--------------------------------------------------------------------------
+ *
+ * test_deform.c
+ *		Microbenchmark for heap tuple deforming.
+ *
+ * Copyright (c) 2015, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *		src/test/modules/test_deform/test_deform.c
+ *
+ * -------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include "access/heapam.h"
+#include "access/htup_details.h"
+#include "executor/tuptable.h"
+#include "fmgr.h"
+#include "miscadmin.h"
+#include "portability/instr_time.h"
+#include "utils/rel.h"
+#include "utils/snapmgr.h"
+
+PG_MODULE_MAGIC;
+
+PG_FUNCTION_INFO_V1(test_deform);
+
+/*
+ * Measure the cost of extracting all attributes of the tuples of a table.
+ *
+ * The tuples are copied into local memory first, so that what we time is
+ * the deforming itself rather than buffer access and visibility checks.
+ * Returns the average number of nanoseconds spent per tuple.
+ */
+Datum
+test_deform(PG_FUNCTION_ARGS)
+{
+	Oid			relid = PG_GETARG_OID(0);
+	int32		repeat_count = PG_GETARG_INT32(1);
+	Relation	rel;
+	HeapScanDesc scan;
+	HeapTuple	tuple;
+	HeapTuple  *tuples;
+	int			ntuples = 0;
+	int			maxtuples = 1024;
+	TupleTableSlot *slot;
+	instr_time	start_time;
+	instr_time	end_time;
+	int32		i;
+	int			j;
+
+	if (repeat_count <= 0)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("repeat count must be a positive integer")));
+
+	rel = heap_open(relid, AccessShareLock);
+
+	/* Collect private copies of all visible tuples. */
+	tuples = (HeapTuple *) palloc(maxtuples * sizeof(HeapTuple));
+	scan = heap_beginscan(rel, GetActiveSnapshot(), 0, NULL);
+	while ((tuple = heap_getnext(scan, ForwardScanDirection)) != NULL)
+	{
+		if (ntuples >= maxtuples)
+		{
+			maxtuples *= 2;
+			tuples = (HeapTuple *) repalloc(tuples,
+											maxtuples * sizeof(HeapTuple));
+		}
+		tuples[ntuples++] = heap_copytuple(tuple);
+	}
+	heap_endscan(scan);
+
+	slot = MakeSingleTupleTableSlot(RelationGetDescr(rel));
+
+	INSTR_TIME_SET_CURRENT(start_time);
+	for (i = 0; i < repeat_count; i++)
+	{
+		for (j = 0; j < ntuples; j++)
+		{
+			ExecStoreTuple(tuples[j], slot, InvalidBuffer, false);
+			slot_getallattrs(slot);
+		}
+		CHECK_FOR_INTERRUPTS();
+	}
+	INSTR_TIME_SET_CURRENT(end_time);
+	INSTR_TIME_SUBTRACT(end_time, start_time);
+
+	ExecDropSingleTupleTableSlot(slot);
+	heap_close(rel, AccessShareLock);
+
+	if (ntuples == 0)
+		PG_RETURN_FLOAT8(0.0);
+
+	PG_RETURN_FLOAT8(INSTR_TIME_GET_DOUBLE(end_time) * 1e9 /
+					 ((double) ntuples * repeat_count));
+}
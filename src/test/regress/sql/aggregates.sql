@@ -590,3 +590,84 @@ drop view aggordview1;
 -- variadic aggregates
 select least_agg(q1,q2) from int8_tbl;
 select least_agg(variadic array[q1,q2]) from int8_tbl;
+
+-- hashed aggregation that exceeds work_mem must spill, not fail
+create function explain_hashagg(query text) returns setof text
+language plpgsql as
+$$
+declare
+    ln text;
+begin
+    for ln in
+        execute format('explain (analyze, costs off, timing off) %s', query)
+    loop
+        -- how many batches it takes depends on allocation overheads
+        ln := regexp_replace(ln, 'Hash Batches: \d+', 'Hash Batches: N');
+        continue when ln like 'Planning time%' or ln like 'Execution time%';
+        return next ln;
+    end loop;
+end;
+$$;
+begin;
+set local work_mem = '64kB';
+set local enable_sort = off;
+select explain_hashagg('select count(*), sum(c), min(c), max(c) from
+  (select g % 5000 as k, count(*) as c
+     from generate_series(1, 20000) g group by 1) s');
+select count(*), sum(c), min(c), max(c) from
+  (select g % 5000 as k, count(*) as c
+     from generate_series(1, 20000) g group by 1) s;
+-- a few groups whose transition values outgrow the per-group estimate
+set local work_mem = '2MB';
+select explain_hashagg('select count(*), sum(length(s)) from
+  (select g / 5000 as k, string_agg(repeat(''x'', 200), '','') as s
+     from generate_series(1, 20000) g group by 1) s');
+select count(*), sum(length(s)) from
+  (select g / 5000 as k, string_agg(repeat('x', 200), ',') as s
+     from generate_series(1, 20000) g group by 1) s;
+select explain_hashagg('select k, array_length(a, 1) from
+  (select g / 5000 as k, array_agg(lpad(g::text, 200)) as a
+     from generate_series(1, 20000) g group by 1) s');
+select k, array_length(a, 1),
+       (select min(x::int) from unnest(a) x),
+       (select max(x::int) from unnest(a) x) from
+  (select g / 5000 as k, array_agg(lpad(g::text, 200)) as a
+     from generate_series(1, 20000) g group by 1) s order by k;
+-- the planner picks hashing even though it expects to spill, when that
+-- is still cheaper than sorting
+set local work_mem = '64kB';
+reset enable_sort;
+explain (costs off)
+  select unique2, sum(ten) from tenk1 group by 1;
+select count(*), sum(s) from
+  (select unique2, sum(ten) as s from tenk1 group by 1) ss;
+rollback;
+drop function explain_hashagg(text);
+
+-- batch execution of plain aggregates must agree with row-at-a-time
+create temp table batch_agg (i2 int2, i4 int4, i8 int8, f8 float8);
+insert into batch_agg
+  select case when g % 7 = 0 then null else (g % 200 - 100)::int2 end,
+         g * (case when g % 2 = 0 then -1 else 1 end),
+         case when g % 11 = 0 then null
+              else g::int8 * 1000000000000 * (case when g % 3 = 0 then -1 else 1 end) end,
+         g / 4.0
+  from generate_series(1, 5000) g;
+insert into batch_agg values (null, null, 9223372036854775807, null),
+  (null, null, 9223372036854775807, null);
+select count(*), count(i2), sum(i2), sum(i4), sum(i8), avg(i2), avg(i4),
+       avg(i8), min(i2), max(i4), min(i8), max(i8), sum(f8)
+  from batch_agg;
+select count(*), sum(i4), avg(i2), max(i8)
+  from batch_agg where i4 < 1000 and -50 <= i2 and i2 <> 3;
+select count(*) from batch_agg where i4 > 10000000;
+select sum(i4) from batch_agg having count(*) > 5000;
+set batch_execution = off;
+select count(*), count(i2), sum(i2), sum(i4), sum(i8), avg(i2), avg(i4),
+       avg(i8), min(i2), max(i4), min(i8), max(i8), sum(f8)
+  from batch_agg;
+select count(*), sum(i4), avg(i2), max(i8)
+  from batch_agg where i4 < 1000 and -50 <= i2 and i2 <> 3;
+select count(*) from batch_agg where i4 > 10000000;
+select sum(i4) from batch_agg having count(*) > 5000;
+reset batch_execution;
@@ -0,0 +1,45 @@
+--
+-- Test limits on the size of the catalog and relation caches
+--
+
+-- a tiny limit evicts everything that isn't in use
+SET catalog_cache_max_size = 1;
+
+CREATE TABLE cachelimit_t (a int, b text);
+
+SELECT a.attname, format_type(a.atttypid, a.atttypmod)
+  FROM pg_attribute a
+  WHERE a.attrelid = 'cachelimit_t'::regclass AND a.attnum > 0
+  ORDER BY a.attnum;
+
+SELECT sum(evictions) > 0 AS catcache_evicted FROM pg_catcache_stats();
+
+-- entries are reloaded as needed
+SELECT 'cachelimit_t'::regclass, 'int4'::regtype, 'pg_catalog.=(int4,int4)'::regoperator;
+SELECT sum(misses) > 0 AS catcache_reloaded FROM pg_catcache_stats();
+
+RESET catalog_cache_max_size;
+
+-- relcache entries are evicted at end of transaction
+SET relation_cache_max_entries = 1;
+
+CREATE TABLE cachelimit_u (a int PRIMARY KEY);
+INSERT INTO cachelimit_u VALUES (1), (2);
+SELECT * FROM cachelimit_u WHERE a = 1;
+
+SELECT evictions > 0 AS relcache_evicted FROM pg_relcache_stats();
+
+-- relations created in the current transaction must survive
+BEGIN;
+CREATE TABLE cachelimit_v (a int);
+INSERT INTO cachelimit_v VALUES (1);
+SELECT * FROM cachelimit_v;
+ROLLBACK;
+
+-- evicted entries are rebuilt when needed, and see later changes
+ALTER TABLE cachelimit_u ADD COLUMN b int DEFAULT 42;
+SELECT * FROM cachelimit_u ORDER BY a;
+
+RESET relation_cache_max_entries;
+
+DROP TABLE cachelimit_t, cachelimit_u;
@@ -965,6 +965,65 @@ RESET enable_indexscan;
 explain (costs off)
   select * from tenk1 where (thousand, tenthous) in ((1,1001), (null,null));
 
+--
+-- Parallel btree builds
+--
+CREATE TABLE parallel_build AS SELECT * FROM tenk1;
+DELETE FROM parallel_build WHERE ten = 0;
+SET max_parallel_degree = 2;
+SET min_parallel_relation_size = 0;
+SET maintenance_work_mem = '96MB';
+-- the size of a worker's run files depends on how the scan split the rows
+SET log_temp_files = -1;
+SET client_min_messages = debug1;
+CREATE INDEX parallel_build_stringu1 ON parallel_build (stringu1);
+CREATE UNIQUE INDEX parallel_build_unique1 ON parallel_build (unique1);
+CREATE INDEX parallel_build_expr ON parallel_build (lower(stringu2::text))
+  WHERE hundred > 50;
+REINDEX INDEX parallel_build_stringu1;
+RESET client_min_messages;
+-- too little memory to give a worker its share
+SET maintenance_work_mem = '32MB';
+SET client_min_messages = debug1;
+CREATE INDEX parallel_build_two ON parallel_build (two);
+RESET client_min_messages;
+RESET maintenance_work_mem;
+-- duplicates are caught whichever participants hold them
+DROP INDEX parallel_build_unique1;
+INSERT INTO parallel_build SELECT * FROM tenk1 WHERE unique1 = 4242;
+-- whether a worker or the leader notices the duplicate varies
+\set VERBOSITY terse
+CREATE UNIQUE INDEX parallel_build_unique1 ON parallel_build (unique1);
+\set VERBOSITY default
+DELETE FROM parallel_build WHERE unique1 = 4242;
+INSERT INTO parallel_build SELECT * FROM tenk1 WHERE unique1 = 4242;
+CREATE UNIQUE INDEX parallel_build_unique1 ON parallel_build (unique1);
+-- the indexes hold what a sequential scan sees
+SET enable_seqscan = off;
+SET enable_bitmapscan = off;
+EXPLAIN (COSTS OFF)
+SELECT count(*), sum(unique1) FROM parallel_build WHERE stringu1 > 'M';
+SELECT count(*), sum(unique1) FROM parallel_build WHERE stringu1 > 'M';
+SELECT count(*), sum(unique1) FROM parallel_build WHERE unique1 > 5000;
+SELECT count(*), sum(unique1) FROM parallel_build
+  WHERE lower(stringu2::text) > 'm' AND hundred > 50;
+RESET enable_seqscan;
+RESET enable_bitmapscan;
+SET enable_indexscan = off;
+SET enable_indexonlyscan = off;
+SET enable_bitmapscan = off;
+SELECT count(*), sum(unique1) FROM parallel_build WHERE stringu1 > 'M';
+SELECT count(*), sum(unique1) FROM parallel_build WHERE unique1 > 5000;
+SELECT count(*), sum(unique1) FROM parallel_build
+  WHERE lower(stringu2::text) > 'm' AND hundred > 50;
+RESET enable_indexscan;
+RESET enable_indexonlyscan;
+RESET enable_bitmapscan;
+RESET min_parallel_relation_size;
+RESET log_temp_files;
+RESET max_parallel_degree;
+DROP TABLE parallel_build;
+
 --
 -- REINDEX SCHEMA
 --
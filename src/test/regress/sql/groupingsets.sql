@@ -0,0 +1,77 @@
+--
+-- grouping sets
+--
+-- test data sources
+create temp view gstest1(a,b,v)
+  as values (1,1,10),(1,1,11),(1,2,12),(1,2,13),(1,3,14),
+            (2,3,15),
+            (3,3,16),(3,4,17),
+            (4,1,18),(4,1,19);
+
+-- basic functionality
+select a, b, sum(v), count(*) from gstest1 group by rollup (a,b) order by a, b;
+select a, b, sum(v), count(*) from gstest1 group by cube (a,b) order by a, b;
+select a, b, sum(v) from gstest1 group by grouping sets ((a),(b),()) order by a, b;
+select a, b, sum(v), count(*) from gstest1 group by a, rollup (b) order by a, b;
+
+-- HAVING sees the grouping columns as null in sets that omit them
+select a, sum(v) from gstest1 group by rollup (a) having a is distinct from 1 order by a;
+
+-- DISTINCT and ORDER BY aggregates need a sort per grouping set
+select a, count(distinct b), string_agg(v::text, ',' order by v)
+  from gstest1 group by rollup (a) order by a;
+
+-- empty input: only the empty grouping sets produce rows
+select a, b, sum(v), count(*) from gstest1 where false
+  group by grouping sets ((a,b),());
+select sum(v), count(*) from gstest1 where false group by ();
+select sum(v), count(*) from gstest1 where false group by grouping sets ((),());
+
+-- GROUPING() tells the sets apart, also in HAVING and ORDER BY
+select a, b, grouping(a,b), sum(v), count(*) from gstest1
+  group by rollup (a,b) order by a, b;
+select a, b, grouping(a), grouping(b), grouping(b,a), sum(v) from gstest1
+  group by grouping sets ((a),(b),()) order by 3, 4, a, b;
+select a, b, sum(v) from gstest1
+  group by cube (a,b) having grouping(a) = 1 order by b;
+select a, sum(v) from gstest1
+  group by rollup (a) order by grouping(a) desc, a;
+select a + 1 as x, grouping(a + 1), sum(v) from gstest1
+  group by rollup (a + 1) order by 1;
+-- without grouping sets it is always zero
+select a, grouping(a), sum(v) from gstest1 group by a order by a;
+select a, b, grouping(a,b) from gstest1 group by grouping sets ((a,b)) order by a, b;
+-- outer-level GROUPING() in a subquery, and under a window function
+select a, (select grouping(a) * 10 + x from (values (1)) v(x)) from gstest1
+  group by rollup (a) order by a;
+select a, grouping(a), rank() over (order by grouping(a)) from gstest1
+  group by rollup (a) order by a;
+-- arguments must be grouping expressions of the same level
+select grouping(a) from gstest1;
+select a, grouping(b) from gstest1 group by a;
+select a from gstest1 where grouping(a) = 0 group by a;
+select sum(grouping(a)) from gstest1 group by a;
+
+-- rescan
+select * from (values (1),(2)) x(n),
+  lateral (select a, sum(v) from gstest1 where a = n group by rollup (a)) s
+  order by n, a;
+
+-- plans
+explain (costs off)
+  select a, b, sum(v) from gstest1 group by rollup (a,b);
+explain (costs off)
+  select a, b, sum(v) from gstest1 group by grouping sets ((a),(b));
+
+-- deparsing
+create temp view gstest_view as
+  select a, b, sum(v) from gstest1 group by cube (a,b);
+select pg_get_viewdef('gstest_view'::regclass, true);
+drop view gstest_view;
+create temp view gstest_view as
+  select a, grouping(a, b) as g from gstest1 group by cube (a,b);
+select pg_get_viewdef('gstest_view'::regclass, true);
+explain (costs off, verbose)
+  select * from gstest_view where g > 0;
+drop view gstest_view;
+drop view gstest1;
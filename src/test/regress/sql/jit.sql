@@ -0,0 +1,90 @@
+--
+-- JIT
+--
+-- The JIT sections below only appear in builds configured --with-llvm;
+-- jit_1.out is the expected output of builds without it, where the same
+-- queries simply run interpreted.
+--
+
+create function explain_jit(query text) returns setof text
+language plpgsql as
+$$
+declare
+    ln text;
+begin
+    for ln in
+        execute format('explain (analyze, costs off, timing off) %s', query)
+    loop
+        continue when ln like 'Planning time%' or ln like 'Execution time%';
+        return next ln;
+    end loop;
+end;
+$$;
+
+-- columns of every kind, with nulls, so deforming takes each path
+create temp table jit_tbl (
+    a int4, b text, c int8, d int2, e numeric, f bool, g float8, h name);
+insert into jit_tbl
+  select i,
+         case when i % 7 = 0 then null else repeat('x', i % 20) end,
+         case when i % 5 = 0 then null else i * 1000000000::int8 end,
+         (i % 100)::int2,
+         case when i % 3 = 0 then null else i / 7.0 end,
+         case when i % 11 = 0 then null else i % 2 = 0 end,
+         i / 3.0,
+         'n' || i
+  from generate_series(1, 1000) i;
+
+set jit = on;
+set jit_above_cost = 0;
+set jit_optimize_above_cost = -1;
+
+-- expressions: quals, projection, and aggregate arguments
+select explain_jit('select a * 2 + d, length(b) from jit_tbl
+  where c > 5000000000 and f and b like ''x%''');
+select sum(a * 2 + d), sum(length(b)), count(*) from jit_tbl
+  where c > 5000000000 and f and b like 'x%';
+select explain_jit('select count(c), sum(e), max(h), sum(g)
+  from jit_tbl where e is not null or b is null');
+select count(c), sum(e), max(h), sum(g)
+  from jit_tbl where e is not null or b is null;
+
+-- the same queries interpreted
+set jit = off;
+select explain_jit('select a * 2 + d, length(b) from jit_tbl
+  where c > 5000000000 and f and b like ''x%''');
+select sum(a * 2 + d), sum(length(b)), count(*) from jit_tbl
+  where c > 5000000000 and f and b like 'x%';
+select count(c), sum(e), max(h), sum(g)
+  from jit_tbl where e is not null or b is null;
+set jit = on;
+
+-- deforming is compiled along with the expressions that fetch columns, and
+-- counts among the functions generated
+select explain_jit('select h, g, f, e, d, c, b, a from jit_tbl
+  where a between 500 and 503');
+select h, g, f, e, d, c, b, a from jit_tbl where a between 500 and 503
+  order by a;
+set jit_tuple_deforming = off;
+select explain_jit('select h, g, f, e, d, c, b, a from jit_tbl
+  where a between 500 and 503');
+select h, g, f, e, d, c, b, a from jit_tbl where a between 500 and 503
+  order by a;
+reset jit_tuple_deforming;
+
+-- with optimization
+set jit_optimize_above_cost = 0;
+select explain_jit('select h, g, f, e, d, c, b, a from jit_tbl
+  where a between 500 and 503');
+select h, g, f, e, d, c, b, a from jit_tbl where a between 500 and 503
+  order by a;
+
+-- nothing is compiled below jit_above_cost
+set jit_above_cost = 1e9;
+select explain_jit('select count(*) from jit_tbl where a > 0');
+
+reset jit_above_cost;
+reset jit_optimize_above_cost;
+reset jit;
+drop table jit_tbl;
+drop function explain_jit(text);
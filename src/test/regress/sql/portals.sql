@@ -484,3 +484,27 @@ fetch all from c;
 move backward all in c;
 fetch all from c;
 rollback;
+
+-- Check scroll cursors over a plain heap scan, which reads ahead of the
+-- cursor in forward direction; moving backward or rewinding must drop
+-- the pages read ahead and still see every row once
+CREATE TABLE cursor_stream (a int, b text);
+INSERT INTO cursor_stream SELECT g, repeat('x', 1000) FROM generate_series(1, 100) g;
+BEGIN;
+DECLARE c SCROLL CURSOR FOR SELECT a, ctid FROM cursor_stream;
+MOVE FORWARD 20 IN c;
+FETCH BACKWARD 10 FROM c;
+FETCH FORWARD 12 FROM c;
+-- rewinding after that rescans the table
+FETCH ABSOLUTE 1 FROM c;
+MOVE FORWARD 90 IN c;
+FETCH FORWARD ALL FROM c;
+FETCH BACKWARD 3 FROM c;
+-- and rewinding in the middle of a forward scan
+FETCH ABSOLUTE 1 FROM c;
+MOVE FORWARD 40 IN c;
+FETCH ABSOLUTE 2 FROM c;
+FETCH FORWARD 8 FROM c;
+FETCH LAST FROM c;
+ROLLBACK;
+DROP TABLE cursor_stream;
@@ -0,0 +1,224 @@
+--
+-- PARALLEL
+--
+
+create function explain_parallel(query text) returns setof text
+language plpgsql as
+$$
+declare
+    ln text;
+begin
+    for ln in
+        execute format('explain (analyze, costs off, timing off) %s', query)
+    loop
+        -- how the rows divide among the participants varies from run to run
+        ln := regexp_replace(ln, 'actual rows=\d+', 'actual rows=N');
+        continue when ln like '%Rows Removed by Filter%';
+        continue when ln like 'Planning time%' or ln like 'Execution time%';
+        return next ln;
+    end loop;
+end;
+$$;
+
+-- encourage use of parallel plans
+set parallel_setup_cost = 0;
+set parallel_tuple_cost = 0;
+set min_parallel_relation_size = 0;
+set max_parallel_degree = 2;
+
+explain (costs off)
+  select count(*) from tenk1 where stringu1 = 'GAAAAA';
+select count(*) from tenk1 where stringu1 = 'GAAAAA';
+
+-- the workers really start, and return what a plain scan does
+select explain_parallel('select * from tenk1 where ten = 3');
+select sum(unique1), count(*) from tenk1 where ten = 3;
+set max_parallel_degree = 0;
+explain (costs off)
+  select sum(unique1), count(*) from tenk1 where ten = 3;
+select sum(unique1), count(*) from tenk1 where ten = 3;
+set max_parallel_degree = 2;
+
+-- the participants can sort what they scan, and the master merges their runs
+explain (costs off)
+  select unique1, ten from tenk1 where ten < 5 order by ten, unique1 desc;
+select md5(string_agg(unique1 || ':' || ten, ',')) from
+  (select unique1, ten from tenk1 where ten < 5
+   order by ten, unique1 desc) ss;
+set max_parallel_degree = 0;
+select md5(string_agg(unique1 || ':' || ten, ',')) from
+  (select unique1, ten from tenk1 where ten < 5
+   order by ten, unique1 desc) ss;
+set max_parallel_degree = 2;
+
+-- ... but not by anything a worker can't evaluate
+explain (costs off)
+  select unique1 from tenk1 order by random();
+
+-- a rescan starts the shared sort over
+set enable_indexscan = off;
+set enable_indexonlyscan = off;
+set enable_bitmapscan = off;
+explain (costs off)
+  select g, (select unique1 from
+               (select unique1 from tenk1 where ten < 5
+                order by unique1 desc offset 0) ss
+             where unique1 % 5000 = g offset 1 limit 1)
+  from generate_series(1, 3) g;
+select g, (select unique1 from
+             (select unique1 from tenk1 where ten < 5
+              order by unique1 desc offset 0) ss
+           where unique1 % 5000 = g offset 1 limit 1)
+  from generate_series(1, 3) g;
+reset enable_indexscan;
+reset enable_indexonlyscan;
+reset enable_bitmapscan;
+
+-- the participants build one shared hash table and all probe it
+set enable_indexscan = off;
+set enable_indexonlyscan = off;
+set enable_bitmapscan = off;
+set enable_mergejoin = off;
+explain (costs off)
+  select tenk1.unique1, onek.ten from tenk1 join onek
+    on tenk1.unique1 = onek.unique1;
+select md5(string_agg(s, ',' order by s)) from
+  (select tenk1.unique1 || ':' || onek.ten as s from tenk1 join onek
+     on tenk1.unique1 = onek.unique1) ss;
+set max_parallel_degree = 0;
+select md5(string_agg(s, ',' order by s)) from
+  (select tenk1.unique1 || ':' || onek.ten as s from tenk1 join onek
+     on tenk1.unique1 = onek.unique1) ss;
+set max_parallel_degree = 2;
+
+-- ... in several batches, and in several passes over a batch that holds
+-- more than the estimate foresaw
+set work_mem = '64kB';
+select count(*), sum(tenk1.unique1 + tenk2.ten) from tenk1 join tenk2
+  on tenk1.unique1 = tenk2.unique1;
+-- (its statistics must stay stale)
+create table pskew with (autovacuum_enabled = off) as
+  select g as id, g as v from generate_series(1, 1000) g;
+analyze pskew;
+insert into pskew select 7, g from generate_series(1, 10000) g;
+explain (costs off)
+  select count(*), sum(pskew.v + tenk1.unique1) from tenk1 join pskew
+    on pskew.id = tenk1.unique1;
+select count(*), sum(pskew.v + tenk1.unique1) from tenk1 join pskew
+  on pskew.id = tenk1.unique1;
+set max_parallel_degree = 0;
+select count(*), sum(pskew.v + tenk1.unique1) from tenk1 join pskew
+  on pskew.id = tenk1.unique1;
+set max_parallel_degree = 2;
+drop table pskew;
+
+-- a rescan builds the shared hash table again
+explain (costs off)
+  select g, (select count(*) from
+               (select tenk1.unique1 from tenk1 join onek
+                  on tenk1.unique1 = onek.unique1 offset 0) ss
+             where unique1 % 5000 = g)
+  from generate_series(1, 3) g;
+select g, (select count(*) from
+             (select tenk1.unique1 from tenk1 join onek
+                on tenk1.unique1 = onek.unique1 offset 0) ss
+           where unique1 % 5000 = g)
+  from generate_series(1, 3) g;
+reset enable_indexscan;
+reset enable_indexonlyscan;
+reset enable_bitmapscan;
+reset enable_mergejoin;
+reset work_mem;
+
+-- the workers see the master's own uncommitted changes
+create table ptest as select * from tenk1;
+analyze ptest;
+begin;
+delete from ptest where unique1 < 5000;
+update ptest set ten = ten + 1 where ten = 3;
+explain (costs off)
+  select count(*), sum(ten) from ptest where ten > 2;
+select count(*), sum(ten) from ptest where ten > 2;
+rollback;
+select count(*), sum(ten) from ptest where ten > 2;
+drop table ptest;
+
+-- rescans restart the workers
+set enable_hashjoin = off;
+set enable_mergejoin = off;
+set enable_material = off;
+set enable_indexscan = off;
+set enable_indexonlyscan = off;
+set enable_bitmapscan = off;
+explain (costs off)
+  select count(*) from tenk2 join tenk1 on tenk1.hundred = tenk2.hundred
+    where tenk2.thousand = 0;
+select count(*) from tenk2 join tenk1 on tenk1.hundred = tenk2.hundred
+  where tenk2.thousand = 0;
+reset enable_hashjoin;
+reset enable_mergejoin;
+reset enable_material;
+reset enable_indexscan;
+reset enable_indexonlyscan;
+reset enable_bitmapscan;
+
+-- volatile functions, row locks and temporary tables keep the scan serial
+explain (costs off)
+  select count(*) from tenk1 where random() < 0.5;
+explain (costs off)
+  select * from tenk1 where stringu1 = 'GAAAAA' for update;
+create temp table ptemp as select * from tenk1;
+analyze ptemp;
+explain (costs off)
+  select count(*) from ptemp where stringu1 = 'GAAAAA';
+drop table ptemp;
+
+-- so does a serializable transaction
+begin isolation level serializable;
+explain (costs off)
+  select count(*) from tenk1 where stringu1 = 'GAAAAA';
+commit;
+
+-- the master's transaction state can't change while workers use a copy of
+-- it: a query calling a function that might write stays serial, and a write
+-- the planner can't foresee is refused
+begin;
+create table big (id int primary key, v int);
+insert into big select g, g from generate_series(1, 100000) g;
+analyze big;
+create function bump(int) returns int language plpgsql as
+$$
+begin
+    update big set v = v + 1 where id = $1;
+    return $1;
+end;
+$$;
+explain (costs off)
+  select count(bump(id)) from big where v >= 0;
+select count(bump(id)) from big where v >= 0;
+create function bump_sfunc(int, int) returns int language plpgsql as
+$$
+begin
+    update big set v = v + 1 where id = $2;
+    return coalesce($1, 0) + 1;
+end;
+$$;
+create aggregate bump_count(int) (sfunc = bump_sfunc, stype = int);
+explain (costs off)
+  select bump_count(id) from big where v >= 0;
+\set VERBOSITY terse
+select bump_count(id) from big where v >= 0;
+\set VERBOSITY default
+rollback;
+
+-- errors raised in a worker reach the master
+\set VERBOSITY terse
+select count(*) from tenk1 where 1 / (unique1 - 7777) > 1;
+\set VERBOSITY default
+
+reset max_parallel_degree;
+reset min_parallel_relation_size;
+reset parallel_tuple_cost;
+reset parallel_setup_cost;
+
+drop function explain_parallel(text);
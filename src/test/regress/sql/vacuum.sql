@@ -60,5 +60,46 @@ VACUUM FULL pg_database;
 VACUUM FULL vaccluster;
 VACUUM FULL vactst;
 
+-- lazy VACUUM must remove exactly the index entries of dead tuples, whether
+-- a page has many, a few or just one or two of them
+CREATE TABLE vactid (i INT, t TEXT);
+INSERT INTO vactid SELECT g, 'tuple ' || g FROM generate_series(1, 20000) g;
+CREATE INDEX vactid_i ON vactid (i);
+DELETE FROM vactid WHERE i <= 5000 AND i % 2 = 0;
+DELETE FROM vactid WHERE i > 5000 AND i <= 10000 AND i % 97 = 0;
+DELETE FROM vactid WHERE i > 10000 AND i % 30 = 0;
+VACUUM vactid;
+-- new tuples may reuse the freed line pointers
+INSERT INTO vactid SELECT -g, 'new ' || g FROM generate_series(1, 5000) g;
+SET enable_seqscan = off;
+SET enable_bitmapscan = off;
+SELECT count(*), sum(i) FROM vactid WHERE i > 0;
+SELECT count(*) FROM vactid WHERE i > 0 AND t <> ('tuple ' || i);
+SELECT * FROM vactid WHERE i IN (2, 4998, 5044, 9991, 10020, 19980);
+SELECT count(*), min(i) FROM vactid WHERE i < 0;
+RESET enable_seqscan;
+RESET enable_bitmapscan;
+DROP TABLE vactid;
+
+-- indexes vacuumed in parallel, if workers are available
+SET max_parallel_vacuum_workers = 2;
+CREATE TABLE vacpar (i INT, j INT) WITH (autovacuum_enabled = off);
+INSERT INTO vacpar SELECT g, -g FROM generate_series(1, 40000) g;
+CREATE INDEX vacpar_i ON vacpar (i);
+CREATE INDEX vacpar_j ON vacpar (j);
+DELETE FROM vacpar WHERE i % 3 = 0;
+-- the DETAIL lines carry timings, so keep them out
+\set VERBOSITY terse
+VACUUM (VERBOSE) vacpar;
+\set VERBOSITY default
+SET enable_seqscan = off;
+SET enable_bitmapscan = off;
+SELECT count(*), sum(i) FROM vacpar WHERE i > 0;
+SELECT count(*), sum(j) FROM vacpar WHERE j < 0;
+RESET enable_seqscan;
+RESET enable_bitmapscan;
+RESET max_parallel_vacuum_workers;
+DROP TABLE vacpar;
+
 DROP TABLE vaccluster;
 DROP TABLE vactst;
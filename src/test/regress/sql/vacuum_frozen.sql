@@ -0,0 +1,32 @@
+--
+-- VACUUM of all-frozen pages
+--
+-- Pages marked all-frozen are skipped by later vacuums, so anything that
+-- sets a new xmax on such a page must clear the bit.  Only the page counts
+-- in the VERBOSE output are deterministic, hence the terse verbosity.
+--
+
+\set VERBOSITY terse
+
+CREATE TABLE vacfrz (a INT, b INT8) WITH (autovacuum_enabled = off);
+INSERT INTO vacfrz SELECT g, g FROM generate_series(1, 20000) g;
+VACUUM (FREEZE, VERBOSE) vacfrz;
+-- everything is frozen now, so nothing is scanned
+VACUUM (FREEZE, VERBOSE) vacfrz;
+
+-- the old page is full, so heap_update marks the old tuple before
+-- relocating it; both the old and the new page must be vacuumed again
+UPDATE vacfrz SET b = -b WHERE a = 10000;
+VACUUM (FREEZE, VERBOSE) vacfrz;
+VACUUM (FREEZE, VERBOSE) vacfrz;
+
+-- a row lock clears the bit as well
+BEGIN;
+SELECT * FROM vacfrz WHERE a = 1 FOR UPDATE;
+COMMIT;
+VACUUM (FREEZE, VERBOSE) vacfrz;
+VACUUM (FREEZE, VERBOSE) vacfrz;
+
+SELECT count(*), sum(b) FROM vacfrz;
+
+DROP TABLE vacfrz;